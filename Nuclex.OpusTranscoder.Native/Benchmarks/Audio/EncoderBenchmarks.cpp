@@ -0,0 +1,146 @@
+#pragma region Apache License 2.0
+/*
+Nuclex Opus Transcoder
+Copyright (C) 2024 Markus Ewald / Nuclex Development Labs
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#pragma endregion // Apache License 2.0
+
+// If the application is compiled as a DLL, this ensures symbols are exported
+#define NUCLEX_OPUSTRANSCODER_SOURCE 1
+
+#include "../../Source/Config.h"
+#include "../../Source/Audio/Track.h"
+#include "../../Source/Audio/OpusEncoder.h"
+#include "../SyntheticSignal.h"
+#include "../ThroughputMeter.h"
+
+#include <Nuclex/Support/Threading/StopSource.h>
+#include <Nuclex/Audio/Storage/VirtualFile.h>
+
+#include <celero/Celero.h>
+
+namespace {
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Number of frames in each benchmarked track, 10 seconds at 48 kHz</summary>
+  const std::size_t BenchmarkFrameCount = 480000;
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Does absolutely nothing</summary>
+  void doNothing(float) {}
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Provides a synthetic track that will be encoded to Opus</summary>
+  /// <typeparam name="TChannelCount">Number of channels, 2 or 6 (5.1)</typeparam>
+  /// <remarks>
+  ///   The encoder doesn't change the track, so unlike the kernel benchmarks, there's
+  ///   no need to restore it between runs. The signal clips lightly, which is what
+  ///   the transcoder typically has to encode.
+  /// </remarks>
+  template<std::size_t TChannelCount>
+  class EncoderFixture : public celero::TestFixture {
+
+    /// <summary>Initializes a new encoder fixture</summary>
+    public: EncoderFixture() :
+      Track(
+        Nuclex::OpusTranscoder::Benchmarks::SyntheticSignal::CreateTrack(
+          TChannelCount,
+          Nuclex::OpusTranscoder::Benchmarks::SignalShape::LightlyClipping,
+          BenchmarkFrameCount
+        )
+      ),
+      Canceler(Nuclex::Support::Threading::StopSource::Create()->GetToken()),
+      ProgressCallback(Nuclex::Support::Events::Delegate<void(float)>::Create<&doNothing>()) {}
+
+    /// <summary>Encodes the fixture's track to Opus</summary>
+    /// <param name="meter">Meter that will measure the encoding</param>
+    /// <param name="bitrate">Bitrate the track will be encoded with</param>
+    /// <param name="effort">Effort the Opus encoder will invest</param>
+    public: void Encode(
+      Nuclex::OpusTranscoder::Benchmarks::ThroughputMeter &meter, float bitrate, float effort
+    ) {
+      using Nuclex::OpusTranscoder::Benchmarks::ThroughputMeter;
+
+      std::shared_ptr<const Nuclex::Audio::Storage::VirtualFile> encodedFile;
+      {
+        ThroughputMeter::MeasuredRun run(meter, this->Track->Samples.size());
+        encodedFile = Nuclex::OpusTranscoder::Audio::OpusEncoder::Encode(
+          this->Track, bitrate, effort, this->Canceler, this->ProgressCallback
+        );
+      }
+      celero::DoNotOptimizeAway(encodedFile->GetSize());
+    }
+
+    /// <summary>Track that will be encoded</summary>
+    public: std::shared_ptr<Nuclex::OpusTranscoder::Audio::Track> Track;
+    /// <summary>Stop token that is never triggered</summary>
+    public: std::shared_ptr<const Nuclex::Support::Threading::StopToken> Canceler;
+    /// <summary>Progress callback that discards all progress reports</summary>
+    public: Nuclex::Support::Events::Delegate<void(float)> ProgressCallback;
+
+  };
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Stereo track that will be encoded</summary>
+  typedef EncoderFixture<2> StereoEncoderFixture;
+  /// <summary>5.1 surround track that will be encoded</summary>
+  typedef EncoderFixture<6> FiveDotOneEncoderFixture;
+
+  // ------------------------------------------------------------------------------------------- //
+
+  using Nuclex::OpusTranscoder::Benchmarks::ThroughputMeter;
+
+  ThroughputMeter stereoLeastEffort(u8"OpusEncoder stereo 192 kbps, effort 0.0");
+  ThroughputMeter stereoMediumEffort(u8"OpusEncoder stereo 192 kbps, effort 0.5");
+  ThroughputMeter stereoMostEffort(u8"OpusEncoder stereo 192 kbps, effort 1.0");
+  ThroughputMeter fiveDotOneLeastEffort(u8"OpusEncoder 5.1 448 kbps, effort 0.0");
+  ThroughputMeter fiveDotOneMostEffort(u8"OpusEncoder 5.1 448 kbps, effort 1.0");
+
+  // ------------------------------------------------------------------------------------------- //
+
+} // anonymous namespace
+
+// --------------------------------------------------------------------------------------------- //
+
+// The encoder has no cheap baseline of its own, so each group is measured relative
+// to encoding with the least effort, which shows what the higher efforts cost.
+
+BASELINE_F(StereoOpusEncoding, LeastEffort, StereoEncoderFixture, 5, 1) {
+  Encode(stereoLeastEffort, 192.0f, 0.0f);
+}
+
+BENCHMARK_F(StereoOpusEncoding, MediumEffort, StereoEncoderFixture, 5, 1) {
+  Encode(stereoMediumEffort, 192.0f, 0.5f);
+}
+
+BENCHMARK_F(StereoOpusEncoding, MostEffort, StereoEncoderFixture, 5, 1) {
+  Encode(stereoMostEffort, 192.0f, 1.0f);
+}
+
+// --------------------------------------------------------------------------------------------- //
+
+BASELINE_F(FiveDotOneOpusEncoding, LeastEffort, FiveDotOneEncoderFixture, 5, 1) {
+  Encode(fiveDotOneLeastEffort, 448.0f, 0.0f);
+}
+
+BENCHMARK_F(FiveDotOneOpusEncoding, MostEffort, FiveDotOneEncoderFixture, 5, 1) {
+  Encode(fiveDotOneMostEffort, 448.0f, 1.0f);
+}
+
+// --------------------------------------------------------------------------------------------- //
@@ -0,0 +1,455 @@
+#pragma region Apache License 2.0
+/*
+Nuclex Opus Transcoder
+Copyright (C) 2024 Markus Ewald / Nuclex Development Labs
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#pragma endregion // Apache License 2.0
+
+// If the application is compiled as a DLL, this ensures symbols are exported
+#define NUCLEX_OPUSTRANSCODER_SOURCE 1
+
+#include "../../Source/Config.h"
+#include "../../Source/Audio/Track.h"
+#include "../../Source/Audio/ClippingDetector.h"
+#include "../../Source/Audio/HalfwaveTucker.h"
+#include "../../Source/Audio/Normalizer.h"
+#include "../../Source/Audio/ChannelLayoutTransformer.h"
+#include "../SyntheticSignal.h"
+#include "../ThroughputMeter.h"
+
+#include <Nuclex/Support/Threading/StopSource.h>
+
+#include <celero/Celero.h>
+
+namespace {
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Number of frames in each benchmarked track, 10 seconds at 48 kHz</summary>
+  const std::size_t BenchmarkFrameCount = 480000;
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Does absolutely nothing</summary>
+  void doNothing(float) {}
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Provides a synthetic track that the benchmarked operations can work on</summary>
+  /// <typeparam name="TChannelCount">Number of channels the track will have</typeparam>
+  /// <typeparam name="TShape">How loud the track's signal is mastered</typeparam>
+  /// <typeparam name="TFindClipping">
+  ///   Whether the clipping half-waves are recorded in the track up front, for operations
+  ///   that work on the half-waves found by the clipping detector
+  /// </typeparam>
+  /// <remarks>
+  ///   Everything is generated in the constructor rather than in Celero's setUp() so that
+  ///   generating the signal is never measured. Operations change the track in place,
+  ///   so each benchmark restores it from the pristine source first.
+  /// </remarks>
+  template<
+    std::size_t TChannelCount,
+    Nuclex::OpusTranscoder::Benchmarks::SignalShape TShape,
+    bool TFindClipping = false
+  >
+  class TrackFixture : public celero::TestFixture {
+
+    /// <summary>Initializes a new track fixture</summary>
+    public: TrackFixture() :
+      Source(
+        Nuclex::OpusTranscoder::Benchmarks::SyntheticSignal::CreateTrack(
+          TChannelCount, TShape, BenchmarkFrameCount
+        )
+      ),
+      Track(std::make_shared<Nuclex::OpusTranscoder::Audio::Track>()),
+      Canceler(Nuclex::Support::Threading::StopSource::Create()->GetToken()),
+      ProgressCallback(Nuclex::Support::Events::Delegate<void(float)>::Create<&doNothing>()) {
+      if constexpr(TFindClipping) {
+        Nuclex::OpusTranscoder::Audio::ClippingDetector::FindClippingHalfwaves(
+          this->Source, this->Canceler, this->ProgressCallback
+        );
+      }
+
+      // Grow the working track to the source's size once, so restoring it
+      // in the benchmarks won't allocate anymore
+      RestoreTrack();
+    }
+
+    /// <summary>Overwrites the working track with the pristine source track</summary>
+    public: void RestoreTrack() {
+      Nuclex::OpusTranscoder::Benchmarks::SyntheticSignal::CopyTrack(*this->Source, *this->Track);
+    }
+
+    /// <summary>Counts the samples in the source track</summary>
+    /// <returns>The number of samples over all channels of the source track</returns>
+    public: std::uint64_t CountSamples() const {
+      return static_cast<std::uint64_t>(this->Source->Samples.size());
+    }
+
+    /// <summary>Pristine track the working track is restored from</summary>
+    public: std::shared_ptr<Nuclex::OpusTranscoder::Audio::Track> Source;
+    /// <summary>Track the benchmarked operations work on</summary>
+    public: std::shared_ptr<Nuclex::OpusTranscoder::Audio::Track> Track;
+    /// <summary>Stop token that is never triggered</summary>
+    public: std::shared_ptr<const Nuclex::Support::Threading::StopToken> Canceler;
+    /// <summary>Progress callback that discards all progress reports</summary>
+    public: Nuclex::Support::Events::Delegate<void(float)> ProgressCallback;
+
+  };
+
+  // ------------------------------------------------------------------------------------------- //
+
+  using Nuclex::OpusTranscoder::Benchmarks::SignalShape;
+
+  /// <summary>Clean mono track</summary>
+  typedef TrackFixture<1, SignalShape::Clean> MonoCleanFixture;
+  /// <summary>Mono track with occasional clipping</summary>
+  typedef TrackFixture<1, SignalShape::LightlyClipping> MonoLightlyClippingFixture;
+  /// <summary>Mono track where most half-waves clip</summary>
+  typedef TrackFixture<1, SignalShape::Brickwalled> MonoBrickwalledFixture;
+  /// <summary>Clean stereo track</summary>
+  typedef TrackFixture<2, SignalShape::Clean> StereoCleanFixture;
+  /// <summary>Stereo track with occasional clipping</summary>
+  typedef TrackFixture<2, SignalShape::LightlyClipping> StereoLightlyClippingFixture;
+  /// <summary>Stereo track where most half-waves clip</summary>
+  typedef TrackFixture<2, SignalShape::Brickwalled> StereoBrickwalledFixture;
+  /// <summary>Clean 5.1 surround track</summary>
+  typedef TrackFixture<6, SignalShape::Clean> FiveDotOneCleanFixture;
+  /// <summary>5.1 surround track with occasional clipping</summary>
+  typedef TrackFixture<6, SignalShape::LightlyClipping> FiveDotOneLightlyClippingFixture;
+  /// <summary>5.1 surround track where most half-waves clip</summary>
+  typedef TrackFixture<6, SignalShape::Brickwalled> FiveDotOneBrickwalledFixture;
+  /// <summary>Clean 7.1 surround track</summary>
+  typedef TrackFixture<8, SignalShape::Clean> SevenDotOneCleanFixture;
+  /// <summary>7.1 surround track with occasional clipping</summary>
+  typedef TrackFixture<8, SignalShape::LightlyClipping> SevenDotOneLightlyClippingFixture;
+  /// <summary>7.1 surround track where most half-waves clip</summary>
+  typedef TrackFixture<8, SignalShape::Brickwalled> SevenDotOneBrickwalledFixture;
+
+  /// <summary>Stereo track with occasional clipping that has been scanned for clipping</summary>
+  typedef TrackFixture<2, SignalShape::LightlyClipping, true> StereoLightlyClippedFixture;
+  /// <summary>Brickwalled stereo track that has been scanned for clipping</summary>
+  typedef TrackFixture<2, SignalShape::Brickwalled, true> StereoBrickwalledClippedFixture;
+  /// <summary>5.1 surround track with occasional clipping and scanned for clipping</summary>
+  typedef TrackFixture<6, SignalShape::LightlyClipping, true> FiveDotOneLightlyClippedFixture;
+  /// <summary>Brickwalled 5.1 surround track that has been scanned for clipping</summary>
+  typedef TrackFixture<6, SignalShape::Brickwalled, true> FiveDotOneBrickwalledClippedFixture;
+
+  // ------------------------------------------------------------------------------------------- //
+
+  using Nuclex::OpusTranscoder::Benchmarks::ThroughputMeter;
+
+  ThroughputMeter monoCleanDetection(u8"FindClippingHalfwaves mono clean");
+  ThroughputMeter monoLightlyClippingDetection(u8"FindClippingHalfwaves mono light");
+  ThroughputMeter monoBrickwalledDetection(u8"FindClippingHalfwaves mono brickwalled");
+  ThroughputMeter stereoCleanDetection(u8"FindClippingHalfwaves stereo clean");
+  ThroughputMeter stereoLightlyClippingDetection(u8"FindClippingHalfwaves stereo light");
+  ThroughputMeter stereoBrickwalledDetection(u8"FindClippingHalfwaves stereo brickwalled");
+  ThroughputMeter fiveDotOneCleanDetection(u8"FindClippingHalfwaves 5.1 clean");
+  ThroughputMeter fiveDotOneLightlyClippingDetection(u8"FindClippingHalfwaves 5.1 light");
+  ThroughputMeter fiveDotOneBrickwalledDetection(u8"FindClippingHalfwaves 5.1 brickwalled");
+  ThroughputMeter sevenDotOneCleanDetection(u8"FindClippingHalfwaves 7.1 clean");
+  ThroughputMeter sevenDotOneLightlyClippingDetection(u8"FindClippingHalfwaves 7.1 light");
+  ThroughputMeter sevenDotOneBrickwalledDetection(u8"FindClippingHalfwaves 7.1 brickwalled");
+
+  ThroughputMeter stereoLightlyClippingTucking(u8"TuckClippingHalfwaves stereo light");
+  ThroughputMeter stereoBrickwalledTucking(u8"TuckClippingHalfwaves stereo brickwalled");
+  ThroughputMeter fiveDotOneLightlyClippingTucking(u8"TuckClippingHalfwaves 5.1 light");
+  ThroughputMeter fiveDotOneBrickwalledTucking(u8"TuckClippingHalfwaves 5.1 brickwalled");
+
+  ThroughputMeter stereoPeakScan(u8"UpdatePeakAmplitudes stereo");
+  ThroughputMeter stereoAmplification(u8"Amplify stereo");
+  ThroughputMeter fiveDotOnePeakScan(u8"UpdatePeakAmplitudes 5.1");
+  ThroughputMeter fiveDotOneAmplification(u8"Amplify 5.1");
+
+  ThroughputMeter monoUpmix(u8"UpmixToStereo from mono");
+  ThroughputMeter fiveDotOneDownmix(u8"DownmixToStereo from 5.1");
+  ThroughputMeter fiveDotOneReweave(u8"ReweaveToVorbisLayout from 5.1");
+  ThroughputMeter sevenDotOneDownmix(u8"DownmixToStereo from 7.1");
+  ThroughputMeter sevenDotOneToFiveDotOne(u8"DownmixToFiveDotOne from 7.1");
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Scans the fixture's track for clipping half-waves</summary>
+  /// <param name="fixture">Fixture providing the track that will be scanned</param>
+  /// <param name="meter">Meter that will measure the scan</param>
+  template<typename TFixture>
+  void findClippingHalfwaves(TFixture &fixture, ThroughputMeter &meter) {
+    fixture.RestoreTrack();
+
+    ThroughputMeter::MeasuredRun run(meter, fixture.CountSamples());
+    Nuclex::OpusTranscoder::Audio::ClippingDetector::FindClippingHalfwaves(
+      fixture.Track, fixture.Canceler, fixture.ProgressCallback
+    );
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Tucks in the clipping half-waves of the fixture's track</summary>
+  /// <param name="fixture">Fixture providing the track whose half-waves will be tucked</param>
+  /// <param name="meter">Meter that will measure the tucking</param>
+  template<typename TFixture>
+  void tuckClippingHalfwaves(TFixture &fixture, ThroughputMeter &meter) {
+    fixture.RestoreTrack();
+
+    ThroughputMeter::MeasuredRun run(meter, fixture.CountSamples());
+    Nuclex::OpusTranscoder::Audio::HalfwaveTucker::TuckClippingHalfwaves(
+      fixture.Track, fixture.Canceler, fixture.ProgressCallback
+    );
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Looks for the peak amplitudes in the fixture's track</summary>
+  /// <param name="fixture">Fixture providing the track that will be scanned</param>
+  /// <param name="meter">Meter that will measure the scan</param>
+  template<typename TFixture>
+  void updatePeakAmplitudes(TFixture &fixture, ThroughputMeter &meter) {
+    fixture.RestoreTrack();
+
+    float maximumAmplitude = 0.0f, maximumBassAmplitude = 0.0f;
+    {
+      ThroughputMeter::MeasuredRun run(meter, fixture.CountSamples());
+      Nuclex::OpusTranscoder::Audio::Normalizer::UpdatePeakAmplitudes(
+        fixture.Track, maximumAmplitude, maximumBassAmplitude,
+        fixture.Canceler, fixture.ProgressCallback
+      );
+    }
+    celero::DoNotOptimizeAway(maximumAmplitude);
+    celero::DoNotOptimizeAway(maximumBassAmplitude);
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Amplifies the fixture's track so its peaks hit the signal ceiling</summary>
+  /// <param name="fixture">Fixture providing the track that will be amplified</param>
+  /// <param name="meter">Meter that will measure the amplification</param>
+  template<typename TFixture>
+  void amplify(TFixture &fixture, ThroughputMeter &meter) {
+    fixture.RestoreTrack();
+
+    // Clean signals peak at 0.7 (about -3 dB), so this amplifies every sample
+    ThroughputMeter::MeasuredRun run(meter, fixture.CountSamples());
+    Nuclex::OpusTranscoder::Audio::Normalizer::Amplify(
+      fixture.Track, 0.7f, 0.7f, false, fixture.Canceler, fixture.ProgressCallback
+    );
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+} // anonymous namespace
+
+// --------------------------------------------------------------------------------------------- //
+
+// Each group's baseline only restores the track, which every benchmark in the group
+// does before running its operation, so Celero's baseline multiples show the cost of
+// the operations alone. The throughput meters leave the restore out entirely.
+
+BASELINE_F(MonoClippingDetection, Restore, MonoCleanFixture, 10, 1) {
+  RestoreTrack();
+}
+
+BENCHMARK_F(MonoClippingDetection, Clean, MonoCleanFixture, 10, 1) {
+  findClippingHalfwaves(*this, monoCleanDetection);
+}
+
+BENCHMARK_F(MonoClippingDetection, LightlyClipping, MonoLightlyClippingFixture, 10, 1) {
+  findClippingHalfwaves(*this, monoLightlyClippingDetection);
+}
+
+BENCHMARK_F(MonoClippingDetection, Brickwalled, MonoBrickwalledFixture, 10, 1) {
+  findClippingHalfwaves(*this, monoBrickwalledDetection);
+}
+
+// --------------------------------------------------------------------------------------------- //
+
+BASELINE_F(StereoClippingDetection, Restore, StereoCleanFixture, 10, 1) {
+  RestoreTrack();
+}
+
+BENCHMARK_F(StereoClippingDetection, Clean, StereoCleanFixture, 10, 1) {
+  findClippingHalfwaves(*this, stereoCleanDetection);
+}
+
+BENCHMARK_F(StereoClippingDetection, LightlyClipping, StereoLightlyClippingFixture, 10, 1) {
+  findClippingHalfwaves(*this, stereoLightlyClippingDetection);
+}
+
+BENCHMARK_F(StereoClippingDetection, Brickwalled, StereoBrickwalledFixture, 10, 1) {
+  findClippingHalfwaves(*this, stereoBrickwalledDetection);
+}
+
+// --------------------------------------------------------------------------------------------- //
+
+BASELINE_F(FiveDotOneClippingDetection, Restore, FiveDotOneCleanFixture, 10, 1) {
+  RestoreTrack();
+}
+
+BENCHMARK_F(FiveDotOneClippingDetection, Clean, FiveDotOneCleanFixture, 10, 1) {
+  findClippingHalfwaves(*this, fiveDotOneCleanDetection);
+}
+
+BENCHMARK_F(
+  FiveDotOneClippingDetection, LightlyClipping, FiveDotOneLightlyClippingFixture, 10, 1
+) {
+  findClippingHalfwaves(*this, fiveDotOneLightlyClippingDetection);
+}
+
+BENCHMARK_F(FiveDotOneClippingDetection, Brickwalled, FiveDotOneBrickwalledFixture, 10, 1) {
+  findClippingHalfwaves(*this, fiveDotOneBrickwalledDetection);
+}
+
+// --------------------------------------------------------------------------------------------- //
+
+BASELINE_F(SevenDotOneClippingDetection, Restore, SevenDotOneCleanFixture, 10, 1) {
+  RestoreTrack();
+}
+
+BENCHMARK_F(SevenDotOneClippingDetection, Clean, SevenDotOneCleanFixture, 10, 1) {
+  findClippingHalfwaves(*this, sevenDotOneCleanDetection);
+}
+
+BENCHMARK_F(
+  SevenDotOneClippingDetection, LightlyClipping, SevenDotOneLightlyClippingFixture, 10, 1
+) {
+  findClippingHalfwaves(*this, sevenDotOneLightlyClippingDetection);
+}
+
+BENCHMARK_F(SevenDotOneClippingDetection, Brickwalled, SevenDotOneBrickwalledFixture, 10, 1) {
+  findClippingHalfwaves(*this, sevenDotOneBrickwalledDetection);
+}
+
+// --------------------------------------------------------------------------------------------- //
+
+BASELINE_F(StereoHalfwaveTucking, Restore, StereoLightlyClippedFixture, 10, 1) {
+  RestoreTrack();
+}
+
+BENCHMARK_F(StereoHalfwaveTucking, LightlyClipping, StereoLightlyClippedFixture, 10, 1) {
+  tuckClippingHalfwaves(*this, stereoLightlyClippingTucking);
+}
+
+BENCHMARK_F(StereoHalfwaveTucking, Brickwalled, StereoBrickwalledClippedFixture, 10, 1) {
+  tuckClippingHalfwaves(*this, stereoBrickwalledTucking);
+}
+
+// --------------------------------------------------------------------------------------------- //
+
+BASELINE_F(FiveDotOneHalfwaveTucking, Restore, FiveDotOneLightlyClippedFixture, 10, 1) {
+  RestoreTrack();
+}
+
+BENCHMARK_F(
+  FiveDotOneHalfwaveTucking, LightlyClipping, FiveDotOneLightlyClippedFixture, 10, 1
+) {
+  tuckClippingHalfwaves(*this, fiveDotOneLightlyClippingTucking);
+}
+
+BENCHMARK_F(FiveDotOneHalfwaveTucking, Brickwalled, FiveDotOneBrickwalledClippedFixture, 10, 1) {
+  tuckClippingHalfwaves(*this, fiveDotOneBrickwalledTucking);
+}
+
+// --------------------------------------------------------------------------------------------- //
+
+BASELINE_F(StereoNormalization, Restore, StereoCleanFixture, 10, 1) {
+  RestoreTrack();
+}
+
+BENCHMARK_F(StereoNormalization, UpdatePeakAmplitudes, StereoCleanFixture, 10, 1) {
+  updatePeakAmplitudes(*this, stereoPeakScan);
+}
+
+BENCHMARK_F(StereoNormalization, Amplify, StereoCleanFixture, 10, 1) {
+  amplify(*this, stereoAmplification);
+}
+
+// --------------------------------------------------------------------------------------------- //
+
+BASELINE_F(FiveDotOneNormalization, Restore, FiveDotOneCleanFixture, 10, 1) {
+  RestoreTrack();
+}
+
+BENCHMARK_F(FiveDotOneNormalization, UpdatePeakAmplitudes, FiveDotOneCleanFixture, 10, 1) {
+  updatePeakAmplitudes(*this, fiveDotOnePeakScan);
+}
+
+BENCHMARK_F(FiveDotOneNormalization, Amplify, FiveDotOneCleanFixture, 10, 1) {
+  amplify(*this, fiveDotOneAmplification);
+}
+
+// --------------------------------------------------------------------------------------------- //
+
+BASELINE_F(MonoLayoutTransform, Restore, MonoCleanFixture, 10, 1) {
+  RestoreTrack();
+}
+
+BENCHMARK_F(MonoLayoutTransform, UpmixToStereo, MonoCleanFixture, 10, 1) {
+  RestoreTrack();
+
+  ThroughputMeter::MeasuredRun run(monoUpmix, CountSamples());
+  Nuclex::OpusTranscoder::Audio::ChannelLayoutTransformer::UpmixToStereo(
+    this->Track, this->Canceler, this->ProgressCallback
+  );
+}
+
+// --------------------------------------------------------------------------------------------- //
+
+BASELINE_F(FiveDotOneLayoutTransform, Restore, FiveDotOneCleanFixture, 10, 1) {
+  RestoreTrack();
+}
+
+BENCHMARK_F(FiveDotOneLayoutTransform, DownmixToStereo, FiveDotOneCleanFixture, 10, 1) {
+  RestoreTrack();
+
+  ThroughputMeter::MeasuredRun run(fiveDotOneDownmix, CountSamples());
+  Nuclex::OpusTranscoder::Audio::ChannelLayoutTransformer::DownmixToStereo(
+    this->Track, 0.5f, this->Canceler, this->ProgressCallback
+  );
+}
+
+BENCHMARK_F(FiveDotOneLayoutTransform, ReweaveToVorbisLayout, FiveDotOneCleanFixture, 10, 1) {
+  RestoreTrack();
+
+  ThroughputMeter::MeasuredRun run(fiveDotOneReweave, CountSamples());
+  Nuclex::OpusTranscoder::Audio::ChannelLayoutTransformer::ReweaveToVorbisLayout(
+    this->Track, this->Canceler, this->ProgressCallback
+  );
+}
+
+// --------------------------------------------------------------------------------------------- //
+
+BASELINE_F(SevenDotOneLayoutTransform, Restore, SevenDotOneCleanFixture, 10, 1) {
+  RestoreTrack();
+}
+
+BENCHMARK_F(SevenDotOneLayoutTransform, DownmixToStereo, SevenDotOneCleanFixture, 10, 1) {
+  RestoreTrack();
+
+  ThroughputMeter::MeasuredRun run(sevenDotOneDownmix, CountSamples());
+  Nuclex::OpusTranscoder::Audio::ChannelLayoutTransformer::DownmixToStereo(
+    this->Track, 0.5f, this->Canceler, this->ProgressCallback
+  );
+}
+
+BENCHMARK_F(SevenDotOneLayoutTransform, DownmixToFiveDotOne, SevenDotOneCleanFixture, 10, 1) {
+  RestoreTrack();
+
+  ThroughputMeter::MeasuredRun run(sevenDotOneToFiveDotOne, CountSamples());
+  Nuclex::OpusTranscoder::Audio::ChannelLayoutTransformer::DownmixToFiveDotOne(
+    this->Track, this->Canceler, this->ProgressCallback
+  );
+}
+
+// --------------------------------------------------------------------------------------------- //
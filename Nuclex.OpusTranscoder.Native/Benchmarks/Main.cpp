@@ -0,0 +1,48 @@
+#pragma region Apache License 2.0
+/*
+Nuclex Opus Transcoder
+Copyright (C) 2024 Markus Ewald / Nuclex Development Labs
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#pragma endregion // Apache License 2.0
+
+// If the application is compiled as a DLL, this ensures symbols are exported
+#define NUCLEX_OPUSTRANSCODER_SOURCE 1
+
+#include "../Source/Config.h"
+#include "./ThroughputMeter.h"
+
+#include <iostream> // for std::cout
+
+#include <celero/Celero.h>
+
+// --------------------------------------------------------------------------------------------- //
+
+/// <summary>Entry point for the benchmark executable</summary>
+/// <param name="argc">The number of command line arguments provided</param>
+/// <param name="argv">The values of all command line arguments</param>
+/// <returns>The exit code the benchmark executable has terminated with</returns>
+/// <remarks>
+///   Celero handles the command line and prints its own results. Afterwards, the sample
+///   throughput and memory use of each benchmarked operation is printed as a second table.
+/// </remarks>
+int main(int argc, char *argv[]) {
+  celero::Run(argc, argv);
+
+  Nuclex::OpusTranscoder::Benchmarks::ThroughputMeter::PrintAll(std::cout);
+
+  return 0;
+}
+
+// --------------------------------------------------------------------------------------------- //
@@ -0,0 +1,164 @@
+#pragma region Apache License 2.0
+/*
+Nuclex Opus Transcoder
+Copyright (C) 2024 Markus Ewald / Nuclex Development Labs
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#pragma endregion // Apache License 2.0
+
+// If the application is compiled as a DLL, this ensures symbols are exported
+#define NUCLEX_OPUSTRANSCODER_SOURCE 1
+
+#include "../../Source/Config.h"
+#include "../../Source/Audio/MemoryFile.h"
+#include "../../Source/Services/Transcoder.h"
+#include "../SyntheticSignal.h"
+#include "../ThroughputMeter.h"
+
+#include <Nuclex/Audio/Storage/AudioLoader.h>
+#include <Nuclex/Audio/KnownChannelLayouts.h>
+
+#include <filesystem> // for std::filesystem::temp_directory_path()
+#include <optional> // for std::optional
+#include <stdexcept> // for std::runtime_error
+
+#include <celero/Celero.h>
+
+namespace {
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Number of frames in each benchmarked file, 10 seconds at 48 kHz</summary>
+  const std::size_t BenchmarkFrameCount = 480000;
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Provides a synthetic .wav file that will be transcoded as a whole</summary>
+  /// <typeparam name="TChannelCount">Number of channels the input file will have</typeparam>
+  /// <typeparam name="TShape">How loud the input file's signal is mastered</typeparam>
+  /// <remarks>
+  ///   The input file is held in memory so reading it doesn't depend on the disk. The Opus
+  ///   file is written to the temporary directory and deleted again after each run.
+  /// </remarks>
+  template<std::size_t TChannelCount, Nuclex::OpusTranscoder::Benchmarks::SignalShape TShape>
+  class TranscoderFixture : public celero::TestFixture {
+
+    /// <summary>Initializes a new transcoder fixture</summary>
+    public: TranscoderFixture() :
+      Loader(std::make_shared<Nuclex::Audio::Storage::AudioLoader>()),
+      InputFile(
+        Nuclex::OpusTranscoder::Benchmarks::SyntheticSignal::CreateWaveFile(
+          TChannelCount, TShape, BenchmarkFrameCount
+        )
+      ),
+      OutputPath(
+        (std::filesystem::temp_directory_path() / u8"nuclex-opustranscoder-benchmark.opus").
+        u8string()
+      ) {}
+
+    /// <summary>Transcodes the input file to Opus in stereo at 192 kbps</summary>
+    /// <param name="meter">Meter that will measure the transcode</param>
+    /// <param name="preventClipping">Whether clipping prevention will be enabled</param>
+    /// <param name="declipIteratively">Whether the track will be declipped iteratively</param>
+    public: void Transcode(
+      Nuclex::OpusTranscoder::Benchmarks::ThroughputMeter &meter,
+      bool preventClipping,
+      bool declipIteratively
+    ) {
+      using Nuclex::OpusTranscoder::Benchmarks::ThroughputMeter;
+
+      // The transcoder is set up outside of the measurement, like the user would
+      // configure it once before starting a transcode
+      Nuclex::OpusTranscoder::Services::Transcoder transcoder(this->Loader);
+      transcoder.EnableClippingPrevention(preventClipping);
+      transcoder.EnableIterativeDeclipping(declipIteratively);
+      transcoder.SetOutputChannels(Nuclex::Audio::KnownChannelLayouts::Stereo);
+      transcoder.SetTargetBitrate(192.0f);
+
+      std::optional<bool> outcome;
+      {
+        ThroughputMeter::MeasuredRun run(meter, BenchmarkFrameCount * TChannelCount);
+        transcoder.TranscodeAudioFile(
+          this->InputFile, u8"nuclex-opustranscoder-benchmark.wav", this->OutputPath
+        );
+        transcoder.Join();
+        outcome = transcoder.GetOutcome();
+      }
+
+      std::error_code errorCode;
+      std::filesystem::remove(std::filesystem::u8path(this->OutputPath), errorCode);
+
+      // A failed transcode would be far quicker than a real one and make
+      // the throughput meaningless, so don't let it go unnoticed
+      if(!outcome.has_value() || !outcome.value()) {
+        throw std::runtime_error(transcoder.GetCurrentStepMessage());
+      }
+    }
+
+    /// <summary>Audio loader the transcoder uses to decode the input file</summary>
+    public: std::shared_ptr<Nuclex::Audio::Storage::AudioLoader> Loader;
+    /// <summary>Synthetic .wav file that will be transcoded</summary>
+    public: std::shared_ptr<const Nuclex::Audio::Storage::VirtualFile> InputFile;
+    /// <summary>Path the Opus file will be written to</summary>
+    public: std::string OutputPath;
+
+  };
+
+  // ------------------------------------------------------------------------------------------- //
+
+  using Nuclex::OpusTranscoder::Benchmarks::SignalShape;
+
+  /// <summary>Stereo .wav file with occasional clipping</summary>
+  typedef TranscoderFixture<2, SignalShape::LightlyClipping> StereoLightlyClippingFixture;
+  /// <summary>Stereo .wav file where most half-waves clip</summary>
+  typedef TranscoderFixture<2, SignalShape::Brickwalled> StereoBrickwalledFixture;
+  /// <summary>5.1 surround .wav file where most half-waves clip</summary>
+  typedef TranscoderFixture<6, SignalShape::Brickwalled> FiveDotOneBrickwalledFixture;
+
+  // ------------------------------------------------------------------------------------------- //
+
+  using Nuclex::OpusTranscoder::Benchmarks::ThroughputMeter;
+
+  ThroughputMeter stereoPlainTranscode(u8"Transcoder stereo light, no declipping");
+  ThroughputMeter stereoLightlyClippingTranscode(u8"Transcoder stereo light, iterative");
+  ThroughputMeter stereoBrickwalledTranscode(u8"Transcoder stereo brickwalled, iterative");
+  ThroughputMeter fiveDotOneBrickwalledTranscode(u8"Transcoder 5.1 brickwalled, iterative");
+
+  // ------------------------------------------------------------------------------------------- //
+
+} // anonymous namespace
+
+// --------------------------------------------------------------------------------------------- //
+
+// The baseline transcodes without any clipping prevention, so the multiples Celero
+// reports for the other benchmarks are the cost of iterative declipping on top of
+// a plain decode and encode.
+
+BASELINE_F(IterativeDeclipping, NoDeclipping, StereoLightlyClippingFixture, 3, 1) {
+  Transcode(stereoPlainTranscode, false, false);
+}
+
+BENCHMARK_F(IterativeDeclipping, StereoLightlyClipping, StereoLightlyClippingFixture, 3, 1) {
+  Transcode(stereoLightlyClippingTranscode, true, true);
+}
+
+BENCHMARK_F(IterativeDeclipping, StereoBrickwalled, StereoBrickwalledFixture, 3, 1) {
+  Transcode(stereoBrickwalledTranscode, true, true);
+}
+
+BENCHMARK_F(IterativeDeclipping, FiveDotOneBrickwalled, FiveDotOneBrickwalledFixture, 3, 1) {
+  Transcode(fiveDotOneBrickwalledTranscode, true, true);
+}
+
+// --------------------------------------------------------------------------------------------- //
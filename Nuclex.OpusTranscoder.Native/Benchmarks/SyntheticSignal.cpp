@@ -0,0 +1,277 @@
+#pragma region Apache License 2.0
+/*
+Nuclex Opus Transcoder
+Copyright (C) 2024 Markus Ewald / Nuclex Development Labs
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#pragma endregion // Apache License 2.0
+
+// If the application is compiled as a DLL, this ensures symbols are exported
+#define NUCLEX_OPUSTRANSCODER_SOURCE 1
+
+#include "./SyntheticSignal.h"
+
+#include "../Source/Audio/Track.h"
+#include "../Source/Audio/MemoryFile.h"
+
+#include <algorithm> // for std::clamp()
+#include <cmath> // for std::sin(), std::tanh(), std::lround()
+#include <cstdint> // for std::uint32_t, std::int16_t
+#include <stdexcept> // for std::runtime_error
+#include <vector> // for std::vector
+
+namespace {
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Two times PI, the length of one full sine period</summary>
+  const double TwoPi = 6.283185307179586476925286766559;
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Looks up the speaker positions of the channels in a layout</summary>
+  /// <param name="channelCount">Number of channels in the layout</param>
+  /// <returns>The placement of each channel in the order of .wav files</returns>
+  std::vector<Nuclex::Audio::ChannelPlacement> getChannelPlacements(std::size_t channelCount) {
+    using Nuclex::Audio::ChannelPlacement;
+
+    switch(channelCount) {
+      case 1: {
+        return { ChannelPlacement::FrontCenter };
+      }
+      case 2: {
+        return { ChannelPlacement::FrontLeft, ChannelPlacement::FrontRight };
+      }
+      case 6: {
+        return {
+          ChannelPlacement::FrontLeft, ChannelPlacement::FrontRight,
+          ChannelPlacement::FrontCenter, ChannelPlacement::LowFrequencyEffects,
+          ChannelPlacement::BackLeft, ChannelPlacement::BackRight
+        };
+      }
+      case 8: {
+        return {
+          ChannelPlacement::FrontLeft, ChannelPlacement::FrontRight,
+          ChannelPlacement::FrontCenter, ChannelPlacement::LowFrequencyEffects,
+          ChannelPlacement::BackLeft, ChannelPlacement::BackRight,
+          ChannelPlacement::SideLeft, ChannelPlacement::SideRight
+        };
+      }
+      default: {
+        throw std::runtime_error(u8"Synthetic signals can be mono, stereo, 5.1 or 7.1 only");
+      }
+    }
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Generates the interleaved samples of a synthetic signal</summary>
+  /// <param name="samples">Buffer that will receive the interleaved samples</param>
+  /// <param name="channelCount">Number of channels to generate</param>
+  /// <param name="shape">How loud the signal should be mastered</param>
+  /// <param name="frameCount">Number of frames to generate</param>
+  /// <param name="cutOffAtFullScale">
+  ///   Whether samples going over full scale will be cut off as they would be when
+  ///   the signal is stored as integers
+  /// </param>
+  void generateSamples(
+    float *samples,
+    std::size_t channelCount,
+    Nuclex::OpusTranscoder::Benchmarks::SignalShape shape,
+    std::size_t frameCount,
+    bool cutOffAtFullScale
+  ) {
+    using Nuclex::OpusTranscoder::Benchmarks::SignalShape;
+    using Nuclex::OpusTranscoder::Benchmarks::SyntheticSignal;
+
+    std::uint32_t noiseState = 12345; // fixed seed so every run sees the same signal
+    double sampleRate = static_cast<double>(SyntheticSignal::SampleRate);
+    for(std::size_t frameIndex = 0; frameIndex < frameCount; ++frameIndex) {
+      double time = static_cast<double>(frameIndex) / sampleRate;
+
+      for(std::size_t channelIndex = 0; channelIndex < channelCount; ++channelIndex) {
+        double bassFrequency = 55.0 * static_cast<double>(1 + channelIndex % 4);
+        double melodyFrequency = 440.0 + 97.0 * static_cast<double>(channelIndex);
+        double phase = static_cast<double>(channelIndex);
+
+        noiseState = noiseState * 1664525U + 1013904223U;
+        double noise = static_cast<double>(noiseState >> 8) / 8388608.0 - 1.0;
+
+        // The sine waves and noise add up to 1.0 at most and the swell varies between
+        // half and full volume, so the loudest peaks of the mix reach full scale
+        double swell = 0.75 + 0.25 * std::sin(TwoPi * 0.3 * time + phase);
+        double value = swell * (
+          0.6 * std::sin(TwoPi * bassFrequency * time) +
+          0.3 * std::sin(TwoPi * melodyFrequency * time + phase) +
+          0.1 * noise
+        );
+
+        switch(shape) {
+          case SignalShape::LightlyClipping: {
+            value *= 1.05; // only the loudest peaks go over
+            break;
+          }
+          case SignalShape::Brickwalled: {
+            value = std::tanh(value * 3.0) * 1.05; // compressed so nearly all peaks go over
+            break;
+          }
+          default: {
+            value *= 0.7; // about -3 dB
+            break;
+          }
+        }
+
+        float sample = static_cast<float>(value);
+        if(cutOffAtFullScale) {
+          sample = std::clamp(sample, -1.0f, 1.0f);
+        }
+        samples[frameIndex * channelCount + channelIndex] = sample;
+      }
+    }
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Appends an integer to a byte buffer in little endian format</summary>
+  /// <param name="contents">Buffer the integer will be appended to</param>
+  /// <param name="value">Integer that will be appended</param>
+  /// <param name="byteCount">Number of bytes the integer will take up</param>
+  void appendLittleEndian(
+    std::vector<std::byte> &contents, std::uint32_t value, std::size_t byteCount
+  ) {
+    for(std::size_t index = 0; index < byteCount; ++index) {
+      contents.push_back(static_cast<std::byte>((value >> (index * 8)) & 0xFF));
+    }
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Appends a four-character chunk identifier to a byte buffer</summary>
+  /// <param name="contents">Buffer the identifier will be appended to</param>
+  /// <param name="identifier">Four characters that will be appended</param>
+  void appendFourCC(std::vector<std::byte> &contents, const char *identifier) {
+    for(std::size_t index = 0; index < 4; ++index) {
+      contents.push_back(static_cast<std::byte>(identifier[index]));
+    }
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+} // anonymous namespace
+
+namespace Nuclex::OpusTranscoder::Benchmarks {
+
+  // ------------------------------------------------------------------------------------------- //
+
+  const std::size_t SyntheticSignal::SampleRate = 48000;
+
+  // ------------------------------------------------------------------------------------------- //
+
+  std::shared_ptr<Audio::Track> SyntheticSignal::CreateTrack(
+    std::size_t channelCount, SignalShape shape, std::size_t frameCount
+  ) {
+    std::vector<Nuclex::Audio::ChannelPlacement> placements = (
+      getChannelPlacements(channelCount)
+    );
+
+    std::shared_ptr<Audio::Track> track = std::make_shared<Audio::Track>();
+    track->SampleRate = SampleRate;
+    track->Channels.resize(channelCount);
+    for(std::size_t index = 0; index < channelCount; ++index) {
+      track->Channels[index].InputOrder = index;
+      track->Channels[index].Placement = placements[index];
+    }
+
+    track->Samples.resize(frameCount * channelCount);
+    generateSamples(track->Samples.data(), channelCount, shape, frameCount, false);
+
+    return track;
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  std::shared_ptr<Audio::MemoryFile> SyntheticSignal::CreateWaveFile(
+    std::size_t channelCount, SignalShape shape, std::size_t frameCount
+  ) {
+    std::vector<Nuclex::Audio::ChannelPlacement> placements = (
+      getChannelPlacements(channelCount)
+    );
+
+    std::vector<float> samples(frameCount * channelCount);
+    generateSamples(samples.data(), channelCount, shape, frameCount, true);
+
+    // Files with more than two channels need the extensible format to say which
+    // speaker each channel belongs to, otherwise readers have to guess
+    bool isExtensible = (channelCount > 2);
+    std::uint32_t formatChunkSize = isExtensible ? 40 : 16;
+    std::uint32_t dataChunkSize = static_cast<std::uint32_t>(samples.size() * 2);
+
+    std::vector<std::byte> contents;
+    contents.reserve(static_cast<std::size_t>(28 + formatChunkSize) + dataChunkSize);
+
+    appendFourCC(contents, u8"RIFF");
+    appendLittleEndian(contents, 4 + (8 + formatChunkSize) + (8 + dataChunkSize), 4);
+    appendFourCC(contents, u8"WAVE");
+
+    appendFourCC(contents, u8"fmt ");
+    appendLittleEndian(contents, formatChunkSize, 4);
+    appendLittleEndian(contents, isExtensible ? 0xFFFE : 1, 2); // extensible or PCM
+    appendLittleEndian(contents, static_cast<std::uint32_t>(channelCount), 2);
+    appendLittleEndian(contents, static_cast<std::uint32_t>(SampleRate), 4);
+    appendLittleEndian(contents, static_cast<std::uint32_t>(SampleRate * channelCount * 2), 4);
+    appendLittleEndian(contents, static_cast<std::uint32_t>(channelCount * 2), 2);
+    appendLittleEndian(contents, 16, 2); // bits per sample
+    if(isExtensible) {
+      std::uint32_t channelMask = 0;
+      for(Nuclex::Audio::ChannelPlacement placement : placements) {
+        channelMask |= static_cast<std::uint32_t>(placement);
+      }
+
+      appendLittleEndian(contents, 22, 2); // size of the extension
+      appendLittleEndian(contents, 16, 2); // valid bits per sample
+      appendLittleEndian(contents, channelMask, 4);
+
+      // KSDATAFORMAT_SUBTYPE_PCM, 00000001-0000-0010-8000-00aa00389b71
+      const std::uint8_t pcmSubFormat[16] = {
+        0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x10, 0x00,
+        0x80, 0x00, 0x00, 0xAA, 0x00, 0x38, 0x9B, 0x71
+      };
+      for(std::uint8_t value : pcmSubFormat) {
+        contents.push_back(static_cast<std::byte>(value));
+      }
+    }
+
+    appendFourCC(contents, u8"data");
+    appendLittleEndian(contents, dataChunkSize, 4);
+    for(float sample : samples) {
+      std::int16_t value = static_cast<std::int16_t>(std::lround(sample * 32767.0f));
+      appendLittleEndian(contents, static_cast<std::uint16_t>(value), 2);
+    }
+
+    return std::make_shared<Audio::MemoryFile>(std::move(contents));
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  void SyntheticSignal::CopyTrack(const Audio::Track &source, Audio::Track &target) {
+    target.Samples = source.Samples;
+    target.IsPlanar = source.IsPlanar;
+    target.SampleRate = source.SampleRate;
+    target.Channels = source.Channels;
+    target.Iteration = source.Iteration;
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+} // namespace Nuclex::OpusTranscoder::Benchmarks
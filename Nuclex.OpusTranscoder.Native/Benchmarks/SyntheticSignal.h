@@ -0,0 +1,111 @@
+#pragma region Apache License 2.0
+/*
+Nuclex Opus Transcoder
+Copyright (C) 2024 Markus Ewald / Nuclex Development Labs
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#pragma endregion // Apache License 2.0
+
+#ifndef NUCLEX_OPUSTRANSCODER_BENCHMARKS_SYNTHETICSIGNAL_H
+#define NUCLEX_OPUSTRANSCODER_BENCHMARKS_SYNTHETICSIGNAL_H
+
+#include "../Source/Config.h"
+
+#include <memory> // for std::shared_ptr
+#include <cstddef> // for std::size_t
+
+namespace Nuclex::OpusTranscoder::Audio {
+
+  // ------------------------------------------------------------------------------------------- //
+
+  class Track;
+  class MemoryFile;
+
+  // ------------------------------------------------------------------------------------------- //
+
+} // namespace Nuclex::OpusTranscoder::Audio
+
+namespace Nuclex::OpusTranscoder::Benchmarks {
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>How loud the synthetic signal is mastered</summary>
+  enum class SignalShape {
+
+    /// <summary>Peaks stay well below full scale, nothing clips</summary>
+    Clean,
+    /// <summary>Occasional peaks go over full scale, like a hot CD master</summary>
+    LightlyClipping,
+    /// <summary>Most half-waves go over full scale, like a loudness war master</summary>
+    Brickwalled
+
+  };
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Generates reproducible audio signals to benchmark with</summary>
+  /// <remarks>
+  ///   Each channel is a mix of a few sine waves with its own frequencies, a slowly
+  ///   swelling volume and a bit of noise from a fixed seed, so the same call always
+  ///   produces the same samples, but half-waves vary in length and height like in music.
+  /// </remarks>
+  class SyntheticSignal {
+
+    /// <summary>Sample rate of all generated signals</summary>
+    public: static const std::size_t SampleRate;
+
+    /// <summary>Generates an interleaved track in the specified layout</summary>
+    /// <param name="channelCount">Number of channels, 1, 2, 6 (5.1) or 8 (7.1)</param>
+    /// <param name="shape">How loud the signal should be mastered</param>
+    /// <param name="frameCount">Number of frames the track will have</param>
+    /// <returns>A new track holding the generated samples</returns>
+    /// <remarks>
+    ///   Peaks going over full scale are kept, like in the decoded Opus stream of a loud
+    ///   master, so the clipping detector has half-waves to find.
+    /// </remarks>
+    public: static std::shared_ptr<Audio::Track> CreateTrack(
+      std::size_t channelCount, SignalShape shape, std::size_t frameCount
+    );
+
+    /// <summary>Generates a 16-bit PCM .wav file in memory</summary>
+    /// <param name="channelCount">Number of channels, 1, 2, 6 (5.1) or 8 (7.1)</param>
+    /// <param name="shape">How loud the signal should be mastered</param>
+    /// <param name="frameCount">Number of frames the file will have</param>
+    /// <returns>A new memory file holding the generated .wav file</returns>
+    /// <remarks>
+    ///   Peaks going over full scale are cut off, as they have to be in 16-bit samples.
+    ///   This lets whole transcodes be benchmarked without the disk getting in the way
+    ///   of reading the input file.
+    /// </remarks>
+    public: static std::shared_ptr<Audio::MemoryFile> CreateWaveFile(
+      std::size_t channelCount, SignalShape shape, std::size_t frameCount
+    );
+
+    /// <summary>Resets a track to the samples and channels of another track</summary>
+    /// <param name="source">Track whose samples and channels will be copied</param>
+    /// <param name="target">Track that will be overwritten with the copy</param>
+    /// <remarks>
+    ///   Operations that change a track in place need a fresh copy for each run.
+    ///   Once the target has been grown to the size of the source, copying into it
+    ///   again doesn't allocate, so the copy stays out of the measured allocations.
+    /// </remarks>
+    public: static void CopyTrack(const Audio::Track &source, Audio::Track &target);
+
+  };
+
+  // ------------------------------------------------------------------------------------------- //
+
+} // namespace Nuclex::OpusTranscoder::Benchmarks
+
+#endif // NUCLEX_OPUSTRANSCODER_BENCHMARKS_SYNTHETICSIGNAL_H
@@ -0,0 +1,179 @@
+#pragma region Apache License 2.0
+/*
+Nuclex Opus Transcoder
+Copyright (C) 2024 Markus Ewald / Nuclex Development Labs
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#pragma endregion // Apache License 2.0
+
+// If the application is compiled as a DLL, this ensures symbols are exported
+#define NUCLEX_OPUSTRANSCODER_SOURCE 1
+
+#include "./ThroughputMeter.h"
+
+#include "../Source/Audio/SampleBuffer.h" // for SampleMemory
+
+#include <algorithm> // for std::max()
+#include <atomic> // for std::atomic
+#include <cstdlib> // for std::malloc(), std::free()
+#include <iomanip> // for std::setw(), std::setprecision()
+#include <new> // for std::bad_alloc
+
+namespace {
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Number of times the global operator new has been called</summary>
+  /// <remarks>
+  ///   Encoders and the thread pool may allocate from other threads while a benchmark
+  ///   runs, so this is atomic even though the meters themselves are not.
+  /// </remarks>
+  std::atomic<std::uint64_t> globalAllocationCount(0);
+
+  /// <summary>First meter that has been registered</summary>
+  Nuclex::OpusTranscoder::Benchmarks::ThroughputMeter *firstMeter = nullptr;
+  /// <summary>Meter that has been registered last</summary>
+  Nuclex::OpusTranscoder::Benchmarks::ThroughputMeter *lastMeter = nullptr;
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Allocates memory and counts the allocation</summary>
+  /// <param name="byteCount">Number of bytes that will be allocated</param>
+  /// <returns>The allocated memory</returns>
+  void *countedAllocate(std::size_t byteCount) {
+    globalAllocationCount.fetch_add(1, std::memory_order_relaxed);
+
+    void *memory = std::malloc((byteCount == 0) ? 1 : byteCount);
+    if(memory == nullptr) {
+      throw std::bad_alloc();
+    }
+
+    return memory;
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+} // anonymous namespace
+
+// The global allocation functions are replaced for the whole benchmark executable so that
+// allocations made inside the transcoder's code, its libraries and the standard library
+// are all counted. Over-aligned allocations are left to the default implementation.
+
+void *operator new(std::size_t byteCount) { return countedAllocate(byteCount); }
+void *operator new[](std::size_t byteCount) { return countedAllocate(byteCount); }
+void operator delete(void *memory) noexcept { std::free(memory); }
+void operator delete[](void *memory) noexcept { std::free(memory); }
+void operator delete(void *memory, std::size_t) noexcept { std::free(memory); }
+void operator delete[](void *memory, std::size_t) noexcept { std::free(memory); }
+
+namespace Nuclex::OpusTranscoder::Benchmarks {
+
+  // ------------------------------------------------------------------------------------------- //
+
+  ThroughputMeter::MeasuredRun::MeasuredRun(ThroughputMeter &meter, std::uint64_t sampleCount) :
+    meter(meter),
+    sampleCount(sampleCount),
+    startAllocationCount(CountAllocations()),
+    startSampleByteCount(Audio::SampleMemory::GetAllocatedByteCount()),
+    peakMeasurement(Audio::SampleMemory::BeginPeakMeasurement()),
+    startTime(std::chrono::steady_clock::now()) {}
+
+  // ------------------------------------------------------------------------------------------- //
+
+  ThroughputMeter::MeasuredRun::~MeasuredRun() {
+    std::chrono::steady_clock::duration elapsed = (
+      std::chrono::steady_clock::now() - this->startTime
+    );
+    std::size_t peakSampleByteCount = (
+      Audio::SampleMemory::EndPeakMeasurement(this->peakMeasurement)
+    );
+    if(peakSampleByteCount >= this->startSampleByteCount) {
+      peakSampleByteCount -= this->startSampleByteCount;
+    } else {
+      peakSampleByteCount = 0;
+    }
+
+    ++this->meter.runCount;
+    this->meter.sampleCount += this->sampleCount;
+    this->meter.allocationCount += CountAllocations() - this->startAllocationCount;
+    this->meter.peakSampleByteCount = std::max(
+      this->meter.peakSampleByteCount, peakSampleByteCount
+    );
+    this->meter.seconds += std::chrono::duration<double>(elapsed).count();
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  ThroughputMeter::ThroughputMeter(const std::string &name) :
+    name(name),
+    runCount(0),
+    sampleCount(0),
+    allocationCount(0),
+    peakSampleByteCount(0),
+    seconds(0.0),
+    next(nullptr) {
+    if(lastMeter == nullptr) {
+      firstMeter = this;
+    } else {
+      lastMeter->next = this;
+    }
+    lastMeter = this;
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  std::uint64_t ThroughputMeter::CountAllocations() {
+    return globalAllocationCount.load(std::memory_order_relaxed);
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  void ThroughputMeter::PrintAll(std::ostream &stream) {
+    stream << std::endl;
+    stream << std::left << std::setw(44) << u8"Operation";
+    stream << std::right << std::setw(8) << u8"Runs";
+    stream << std::setw(14) << u8"MSamples/s";
+    stream << std::setw(14) << u8"Allocs/run";
+    stream << std::setw(18) << u8"Peak sample MiB";
+    stream << std::endl;
+    stream << std::string(98, '-') << std::endl;
+
+    stream << std::fixed;
+    for(const ThroughputMeter *meter = firstMeter; meter != nullptr; meter = meter->next) {
+      if(meter->runCount == 0) {
+        continue;
+      }
+
+      double runCount = static_cast<double>(meter->runCount);
+      double samplesPerSecond = 0.0;
+      if(meter->seconds > 0.0) {
+        samplesPerSecond = static_cast<double>(meter->sampleCount) / meter->seconds;
+      }
+
+      stream << std::left << std::setw(44) << meter->name;
+      stream << std::right << std::setw(8) << meter->runCount;
+      stream << std::setw(14) << std::setprecision(2) << (samplesPerSecond / 1000000.0);
+      stream << std::setw(14) << std::setprecision(1) << (
+        static_cast<double>(meter->allocationCount) / runCount
+      );
+      stream << std::setw(18) << std::setprecision(2) << (
+        static_cast<double>(meter->peakSampleByteCount) / (1024.0 * 1024.0)
+      );
+      stream << std::endl;
+    }
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+} // namespace Nuclex::OpusTranscoder::Benchmarks
@@ -0,0 +1,115 @@
+#pragma region Apache License 2.0
+/*
+Nuclex Opus Transcoder
+Copyright (C) 2024 Markus Ewald / Nuclex Development Labs
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#pragma endregion // Apache License 2.0
+
+#ifndef NUCLEX_OPUSTRANSCODER_BENCHMARKS_THROUGHPUTMETER_H
+#define NUCLEX_OPUSTRANSCODER_BENCHMARKS_THROUGHPUTMETER_H
+
+#include "../Source/Config.h"
+
+#include <chrono> // for std::chrono::steady_clock
+#include <cstddef> // for std::size_t
+#include <cstdint> // for std::uint64_t
+#include <ostream> // for std::ostream
+#include <string> // for std::string
+
+namespace Nuclex::OpusTranscoder::Benchmarks {
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Measures the sample throughput and memory use of a benchmarked operation</summary>
+  /// <remarks>
+  ///   <para>
+  ///     Celero reports the time per iteration, which includes copying the input track
+  ///     the operation works on. Each benchmark therefore also has a meter that only
+  ///     measures the operation itself and relates it to the number of samples processed.
+  ///     Besides samples per second, it keeps track of the heap allocations made during
+  ///     the operation and the peak amount of sample memory it needed on top of the
+  ///     samples that were already allocated when it began.
+  ///   </para>
+  ///   <para>
+  ///     Meters register themselves when they're constructed and are meant to be
+  ///     static objects. The benchmarks run one after another, so they aren't synchronized.
+  ///   </para>
+  /// </remarks>
+  class ThroughputMeter {
+
+    /// <summary>Measures a single run of the operation while it is in scope</summary>
+    public: class MeasuredRun {
+
+      /// <summary>Begins measuring a run of the operation</summary>
+      /// <param name="meter">Meter the measurements will be added to</param>
+      /// <param name="sampleCount">Number of samples the operation will process</param>
+      public: MeasuredRun(ThroughputMeter &meter, std::uint64_t sampleCount);
+
+      /// <summary>Adds the measurements since construction to the meter</summary>
+      public: ~MeasuredRun();
+
+      /// <summary>Meter the measurements will be added to</summary>
+      private: ThroughputMeter &meter;
+      /// <summary>Number of samples the operation processes</summary>
+      private: std::uint64_t sampleCount;
+      /// <summary>Number of heap allocations made up to the beginning of the run</summary>
+      private: std::uint64_t startAllocationCount;
+      /// <summary>Bytes allocated for samples when the run began</summary>
+      private: std::size_t startSampleByteCount;
+      /// <summary>Identifier of the sample memory measurement of the run</summary>
+      private: std::size_t peakMeasurement;
+      /// <summary>Time at which the run began</summary>
+      private: std::chrono::steady_clock::time_point startTime;
+
+    };
+
+    /// <summary>Initializes a new throughput meter and registers it</summary>
+    /// <param name="name">Name under which the meter's results are printed</param>
+    public: ThroughputMeter(const std::string &name);
+
+    /// <summary>Counts the heap allocations the process has made so far</summary>
+    /// <returns>The number of times the global operator new has been called</returns>
+    public: static std::uint64_t CountAllocations();
+
+    /// <summary>Prints the results of all registered meters as a table</summary>
+    /// <param name="stream">Stream the table will be written to</param>
+    /// <remarks>
+    ///   Meters whose operation never ran (because Celero was told to run only some of
+    ///   the benchmarks) are left out of the table.
+    /// </remarks>
+    public: static void PrintAll(std::ostream &stream);
+
+    /// <summary>Name under which the meter's results are printed</summary>
+    private: std::string name;
+    /// <summary>How many times the operation ran</summary>
+    private: std::uint64_t runCount;
+    /// <summary>Total number of samples processed over all runs</summary>
+    private: std::uint64_t sampleCount;
+    /// <summary>Total number of heap allocations made over all runs</summary>
+    private: std::uint64_t allocationCount;
+    /// <summary>Most sample memory any run needed on top of what it started with</summary>
+    private: std::size_t peakSampleByteCount;
+    /// <summary>Total time spent in the operation over all runs, in seconds</summary>
+    private: double seconds;
+    /// <summary>Next meter in the list of registered meters</summary>
+    private: ThroughputMeter *next;
+
+  };
+
+  // ------------------------------------------------------------------------------------------- //
+
+} // namespace Nuclex::OpusTranscoder::Benchmarks
+
+#endif // NUCLEX_OPUSTRANSCODER_BENCHMARKS_THROUGHPUTMETER_H
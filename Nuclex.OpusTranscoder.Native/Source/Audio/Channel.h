@@ -24,7 +24,8 @@ limitations under the License.
 
 #include <Nuclex/Audio/ChannelPlacement.h>
 
-#include "./ClippingHalfwave.h"
+#include "./ClippingHalfwaveTable.h"
+#include "./SampleBuffer.h"
 
 #include <vector>
 
@@ -43,7 +44,9 @@ namespace Nuclex::OpusTranscoder::Audio {
     /// <summary>Placement from which this channel is supposed to play</summary>
     public: Nuclex::Audio::ChannelPlacement Placement;
     /// <summary>Detected clipping instances</summary>
-    public: std::vector<ClippingHalfwave> ClippingHalfwaves;
+    public: ClippingHalfwaveTable ClippingHalfwaves;
+    /// <summary>Samples of this channel if the track stores its channels planar</summary>
+    public: SampleBuffer Samples;
 
   };
 
@@ -22,6 +22,15 @@ limitations under the License.
 
 #include "./ChannelLayoutTransformer.h"
 
+#include <algorithm> // for std::min(), std::fill_n()
+#include <stdexcept> // for std::runtime_error
+
+#if defined(NUCLEX_OPUSTRANSCODER_HAVE_SSE2)
+  #include <emmintrin.h> // for SSE2 intrinsics
+#elif defined(NUCLEX_OPUSTRANSCODER_HAVE_NEON)
+  #include <arm_neon.h> // for NEON intrinsics
+#endif
+
 namespace {
 
   // ------------------------------------------------------------------------------------------- //
@@ -31,6 +40,16 @@ namespace {
 
   // ------------------------------------------------------------------------------------------- //
 
+  /// <summary>Number of frames that are mixed together by one pass of the kernel</summary>
+  const std::size_t FramesPerBatch = 4;
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Number of frames after which cancellation is checked and progress reported</summary>
+  const std::size_t FramesPerChunk = 0x3000; // must be a multiple of FramesPerBatch
+
+  // ------------------------------------------------------------------------------------------- //
+
   /// <summary>Linearly interpolates between two values</summary>
   /// <param name="from">Interpolation value at 0.0</param>
   /// <param name="to">Interpolation value at 1.0</param>
@@ -42,120 +61,504 @@ namespace {
 
   // ------------------------------------------------------------------------------------------- //
 
-} // anonymous namespace
+  /// <summary>Factors by which each input channel contributes to each output channel</summary>
+  template<std::size_t InputChannelCount, std::size_t OutputChannelCount>
+  struct MixingMatrix {
 
-namespace Nuclex::OpusTranscoder::Audio {
+    /// <summary>Contribution of each input channel (column) to each output channel (row)</summary>
+    public: float Factors[OutputChannelCount][InputChannelCount];
+
+  };
 
   // ------------------------------------------------------------------------------------------- //
 
-  void ChannelLayoutTransformer::DownmixToStereo(
-    const std::shared_ptr<Track> &track,
-    float nightmodeLevel,
+  /// <summary>Mixes a single interleaved frame according to a mixing matrix</summary>
+  /// <param name="read">Address of the input frame</param>
+  /// <param name="write">Address at which the output frame will be stored</param>
+  /// <param name="matrix">Matrix that specifies how the channels are mixed</param>
+  /// <remarks>
+  ///   The input frame is read completely before anything is written, so this works
+  ///   in-place even if the output frame overlaps the input frame.
+  /// </remarks>
+  template<std::size_t InputChannelCount, std::size_t OutputChannelCount>
+  inline void mixFrame(
+    const float *read, float *write,
+    const MixingMatrix<InputChannelCount, OutputChannelCount> &matrix
+  ) {
+    float inputs[InputChannelCount];
+    for(std::size_t channelIndex = 0; channelIndex < InputChannelCount; ++channelIndex) {
+      inputs[channelIndex] = read[channelIndex];
+    }
+
+    // Summed in input channel order, same as the vectorized kernel, so that
+    // the results are identical no matter which of the two mixed a frame.
+    for(std::size_t outputIndex = 0; outputIndex < OutputChannelCount; ++outputIndex) {
+      float sum = 0.0f;
+      for(std::size_t channelIndex = 0; channelIndex < InputChannelCount; ++channelIndex) {
+        sum += inputs[channelIndex] * matrix.Factors[outputIndex][channelIndex];
+      }
+      write[outputIndex] = sum;
+    }
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Mixes a batch of interleaved frames according to a mixing matrix</summary>
+  /// <param name="read">Address of the first input frame</param>
+  /// <param name="write">Address at which the first output frame will be stored</param>
+  /// <param name="matrix">Matrix that specifies how the channels are mixed</param>
+  /// <remarks>
+  ///   Each vector lane holds the same channel of a different frame, so all frames
+  ///   in the batch are mixed by the same instructions. Like mixFrame(), all inputs
+  ///   are read before any output is written.
+  /// </remarks>
+  template<std::size_t InputChannelCount, std::size_t OutputChannelCount>
+  inline void mixFrameBatch(
+    const float *read, float *write,
+    const MixingMatrix<InputChannelCount, OutputChannelCount> &matrix
+  ) {
+    static_assert(FramesPerBatch == 4, u8"Kernel mixes as many frames as fit in a vector");
+
+    float mixed[OutputChannelCount][FramesPerBatch];
+#if defined(NUCLEX_OPUSTRANSCODER_HAVE_SSE2)
+    {
+      __m128 inputs[InputChannelCount];
+      for(std::size_t channelIndex = 0; channelIndex < InputChannelCount; ++channelIndex) {
+        inputs[channelIndex] = _mm_setr_ps(
+          read[channelIndex],
+          read[channelIndex + InputChannelCount],
+          read[channelIndex + InputChannelCount * 2],
+          read[channelIndex + InputChannelCount * 3]
+        );
+      }
+      for(std::size_t outputIndex = 0; outputIndex < OutputChannelCount; ++outputIndex) {
+        __m128 sum = _mm_setzero_ps();
+        for(std::size_t channelIndex = 0; channelIndex < InputChannelCount; ++channelIndex) {
+          sum = _mm_add_ps(
+            sum,
+            _mm_mul_ps(inputs[channelIndex], _mm_set1_ps(matrix.Factors[outputIndex][channelIndex]))
+          );
+        }
+        _mm_storeu_ps(mixed[outputIndex], sum);
+      }
+    }
+#elif defined(NUCLEX_OPUSTRANSCODER_HAVE_NEON)
+    {
+      float32x4_t inputs[InputChannelCount];
+      for(std::size_t channelIndex = 0; channelIndex < InputChannelCount; ++channelIndex) {
+        float lanes[FramesPerBatch] = {
+          read[channelIndex],
+          read[channelIndex + InputChannelCount],
+          read[channelIndex + InputChannelCount * 2],
+          read[channelIndex + InputChannelCount * 3]
+        };
+        inputs[channelIndex] = vld1q_f32(lanes);
+      }
+      for(std::size_t outputIndex = 0; outputIndex < OutputChannelCount; ++outputIndex) {
+        float32x4_t sum = vdupq_n_f32(0.0f);
+        for(std::size_t channelIndex = 0; channelIndex < InputChannelCount; ++channelIndex) {
+          sum = vaddq_f32( // not vmlaq_f32(), it may fuse and round differently from mixFrame()
+            sum,
+            vmulq_n_f32(inputs[channelIndex], matrix.Factors[outputIndex][channelIndex])
+          );
+        }
+        vst1q_f32(mixed[outputIndex], sum);
+      }
+    }
+#else
+    {
+      float inputs[InputChannelCount][FramesPerBatch];
+      for(std::size_t channelIndex = 0; channelIndex < InputChannelCount; ++channelIndex) {
+        for(std::size_t lane = 0; lane < FramesPerBatch; ++lane) {
+          inputs[channelIndex][lane] = read[channelIndex + InputChannelCount * lane];
+        }
+      }
+      for(std::size_t outputIndex = 0; outputIndex < OutputChannelCount; ++outputIndex) {
+        for(std::size_t lane = 0; lane < FramesPerBatch; ++lane) {
+          float sum = 0.0f;
+          for(std::size_t channelIndex = 0; channelIndex < InputChannelCount; ++channelIndex) {
+            sum += inputs[channelIndex][lane] * matrix.Factors[outputIndex][channelIndex];
+          }
+          mixed[outputIndex][lane] = sum;
+        }
+      }
+    }
+#endif
+
+    for(std::size_t lane = 0; lane < FramesPerBatch; ++lane) {
+      for(std::size_t outputIndex = 0; outputIndex < OutputChannelCount; ++outputIndex) {
+        write[outputIndex] = mixed[outputIndex][lane];
+      }
+      write += OutputChannelCount;
+    }
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Mixes a range of interleaved frames in-place</summary>
+  /// <param name="samples">Interleaved samples of the track being mixed</param>
+  /// <param name="startFrameIndex">Index of the first frame that will be mixed</param>
+  /// <param name="frameCount">Number of frames that will be mixed</param>
+  /// <param name="matrix">Matrix that specifies how the channels are mixed</param>
+  /// <remarks>
+  ///   When there are fewer output channels than input channels, the frames are
+  ///   processed front to back, otherwise back to front, so no input sample is
+  ///   overwritten before it has been read.
+  /// </remarks>
+  template<std::size_t InputChannelCount, std::size_t OutputChannelCount>
+  void mixFrames(
+    float *samples, std::uint64_t startFrameIndex, std::size_t frameCount,
+    MixingMatrix<InputChannelCount, OutputChannelCount> matrix // copy, can't alias samples
+  ) {
+    const float *read = samples + startFrameIndex * InputChannelCount;
+    float *write = samples + startFrameIndex * OutputChannelCount;
+
+    std::size_t batchedFrameCount = frameCount - (frameCount % FramesPerBatch);
+    if constexpr(OutputChannelCount <= InputChannelCount) {
+      for(std::size_t index = 0; index < batchedFrameCount; index += FramesPerBatch) {
+        mixFrameBatch(read, write, matrix);
+        read += InputChannelCount * FramesPerBatch;
+        write += OutputChannelCount * FramesPerBatch;
+      }
+      for(std::size_t index = batchedFrameCount; index < frameCount; ++index) {
+        mixFrame(read, write, matrix);
+        read += InputChannelCount;
+        write += OutputChannelCount;
+      }
+    } else {
+      std::size_t remainingFrameCount = frameCount;
+      while(remainingFrameCount > (frameCount - batchedFrameCount)) {
+        remainingFrameCount -= FramesPerBatch;
+        mixFrameBatch(
+          read + remainingFrameCount * InputChannelCount,
+          write + remainingFrameCount * OutputChannelCount,
+          matrix
+        );
+      }
+      while(remainingFrameCount > 0) {
+        --remainingFrameCount;
+        mixFrame(
+          read + remainingFrameCount * InputChannelCount,
+          write + remainingFrameCount * OutputChannelCount,
+          matrix
+        );
+      }
+    }
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Folds the gains of the input channels into a mixing matrix</summary>
+  /// <param name="matrix">Mixing matrix whose factors will be adjusted</param>
+  /// <param name="channelGains">
+  ///   Factor by which each input channel will be amplified. If empty, the matrix is
+  ///   left as it is.
+  /// </param>
+  template<std::size_t InputChannelCount, std::size_t OutputChannelCount>
+  void applyChannelGains(
+    MixingMatrix<InputChannelCount, OutputChannelCount> &matrix,
+    const std::vector<float> &channelGains
+  ) {
+    if(channelGains.empty()) {
+      return;
+    }
+    if(channelGains.size() != InputChannelCount) {
+      throw std::runtime_error(u8"Number of channel gains must match the track's channel count");
+    }
+
+    for(std::size_t outputIndex = 0; outputIndex < OutputChannelCount; ++outputIndex) {
+      for(std::size_t channelIndex = 0; channelIndex < InputChannelCount; ++channelIndex) {
+        matrix.Factors[outputIndex][channelIndex] *= channelGains[channelIndex];
+      }
+    }
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Mixes the channel planes of a planar track to a new channel layout</summary>
+  /// <param name="track">Planar track whose channels will be mixed</param>
+  /// <param name="matrix">Matrix that specifies how the channels are mixed</param>
+  /// <param name="canceler">Token by which the operation can be signalled to cancel</param>
+  /// <param name="progressCallback">Callback to which progress reports should be sent</param>
+  /// <remarks>
+  ///   Output channels that are a plain copy of one input channel simply take over
+  ///   its plane, so re-weaving channels doesn't touch any samples at all. The channel
+  ///   list is resized to hold the output planes, its placements are left to the caller.
+  /// </remarks>
+  template<std::size_t InputChannelCount, std::size_t OutputChannelCount>
+  void mixPlanarTrack(
+    const std::shared_ptr<Nuclex::OpusTranscoder::Audio::Track> &track,
+    const MixingMatrix<InputChannelCount, OutputChannelCount> &matrix,
     const std::shared_ptr<const Nuclex::Support::Threading::StopToken> &canceler,
     Nuclex::Support::Events::Delegate<void(float)> &progressCallback
   ) {
-    if((track->Channels.size() != 6) && (track->Channels.size() != 8)) {
-      throw std::runtime_error(u8"Only 5.1 and 7.1 surround can be downmixed to stereo");
+    using Nuclex::OpusTranscoder::Audio::SampleBuffer;
+
+    std::uint64_t frameCount = track->CountFrames();
+
+    // Find the output channels that are just copies of an input channel. Those don't
+    // need to be mixed, the input channel's plane can be handed over as it is.
+    const std::size_t invalid = std::size_t(-1);
+    std::size_t sourceChannels[OutputChannelCount];
+    std::size_t remainingUseCounts[InputChannelCount] = {};
+    for(std::size_t outputIndex = 0; outputIndex < OutputChannelCount; ++outputIndex) {
+      sourceChannels[outputIndex] = invalid;
+
+      std::size_t contributorCount = 0;
+      for(std::size_t channelIndex = 0; channelIndex < InputChannelCount; ++channelIndex) {
+        if(matrix.Factors[outputIndex][channelIndex] != 0.0f) {
+          ++contributorCount;
+          if(matrix.Factors[outputIndex][channelIndex] == 1.0f) {
+            sourceChannels[outputIndex] = channelIndex;
+          }
+        }
+      }
+      if(contributorCount == 1) {
+        if(sourceChannels[outputIndex] != invalid) {
+          ++remainingUseCounts[sourceChannels[outputIndex]];
+        }
+      } else {
+        sourceChannels[outputIndex] = invalid;
+      }
+    } // for each output channel
+
+    SampleBuffer planes[OutputChannelCount];
+    for(std::size_t outputIndex = 0; outputIndex < OutputChannelCount; ++outputIndex) {
+      if(sourceChannels[outputIndex] == invalid) {
+        planes[outputIndex].resize(static_cast<std::size_t>(frameCount));
+      }
     }
 
-    struct ChannelContribution {
-      public: ChannelContribution(std::size_t offset, float factor) :
-        InterleaveOffset(offset),
-        Factor(factor) {}
-      public: std::size_t InterleaveOffset;
-      public: float Factor;
-    };
+    track->Statistics.Reset(OutputChannelCount, frameCount);
 
-    // Create a list of channels that should contribute to each of the stereo channels.
-    // For now, we'll only consider 5.1 and 7.1 layouts.
-    std::vector<ChannelContribution> mapping[2];
+    std::uint64_t mixedFrameCount = 0;
+    while(mixedFrameCount < frameCount) {
+      std::size_t chunkFrameCount = static_cast<std::size_t>(
+        std::min<std::uint64_t>(frameCount - mixedFrameCount, FramesPerChunk)
+      );
+      std::size_t chunkStartIndex = static_cast<std::size_t>(mixedFrameCount);
+
+      const float *outputs[OutputChannelCount];
+      for(std::size_t outputIndex = 0; outputIndex < OutputChannelCount; ++outputIndex) {
+        if(sourceChannels[outputIndex] != invalid) {
+          outputs[outputIndex] = (
+            track->Channels[sourceChannels[outputIndex]].Samples.data() + chunkStartIndex
+          );
+          continue;
+        }
+
+        // Sum up the contributing input planes. Each run is a plain multiply-add
+        // over contiguous memory, the compiler vectorizes that on its own.
+        float *target = planes[outputIndex].data() + chunkStartIndex;
+        std::fill_n(target, chunkFrameCount, 0.0f);
+        for(std::size_t channelIndex = 0; channelIndex < InputChannelCount; ++channelIndex) {
+          float factor = matrix.Factors[outputIndex][channelIndex];
+          if(factor != 0.0f) {
+            const float *source = (
+              track->Channels[channelIndex].Samples.data() + chunkStartIndex
+            );
+            for(std::size_t index = 0; index < chunkFrameCount; ++index) {
+              target[index] += source[index] * factor;
+            }
+          }
+        }
+        outputs[outputIndex] = target;
+      } // for each output channel
+
+      track->Statistics.AccumulatePlanar(outputs, chunkStartIndex, chunkFrameCount);
+      mixedFrameCount += chunkFrameCount;
+
+      canceler->ThrowIfCanceled();
+      progressCallback(static_cast<float>(mixedFrameCount) / static_cast<float>(frameCount));
+    }
+
+    // Hand the input planes over to the outputs copying them. If an input channel
+    // is copied to several outputs, only the last one can take over its plane.
+    for(std::size_t outputIndex = 0; outputIndex < OutputChannelCount; ++outputIndex) {
+      std::size_t channelIndex = sourceChannels[outputIndex];
+      if(channelIndex != invalid) {
+        --remainingUseCounts[channelIndex];
+        if(remainingUseCounts[channelIndex] == 0) {
+          planes[outputIndex].swap(track->Channels[channelIndex].Samples);
+        } else {
+          planes[outputIndex] = track->Channels[channelIndex].Samples;
+        }
+      }
+    }
+
+    if(track->Channels.size() < OutputChannelCount) {
+      track->Channels.resize(OutputChannelCount);
+    }
     for(std::size_t index = 0; index < track->Channels.size(); ++index) {
-      switch(track->Channels[index].Placement) {
+      if(index < OutputChannelCount) {
+        track->Channels[index].Samples.swap(planes[index]);
+      } else {
+        SampleBuffer().swap(track->Channels[index].Samples);
+      }
+    }
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Mixes all samples in a track to a new channel layout in-place</summary>
+  /// <param name="track">Track whose samples will be mixed</param>
+  /// <param name="matrix">Matrix that specifies how the channels are mixed</param>
+  /// <param name="canceler">Token by which the operation can be signalled to cancel</param>
+  /// <param name="progressCallback">Callback to which progress reports should be sent</param>
+  /// <remarks>
+  ///   Only the samples and their statistics are touched, updating the channel list
+  ///   is up to the caller.
+  /// </remarks>
+  template<std::size_t InputChannelCount, std::size_t OutputChannelCount>
+  void mixTrack(
+    const std::shared_ptr<Nuclex::OpusTranscoder::Audio::Track> &track,
+    const MixingMatrix<InputChannelCount, OutputChannelCount> &matrix,
+    const std::shared_ptr<const Nuclex::Support::Threading::StopToken> &canceler,
+    Nuclex::Support::Events::Delegate<void(float)> &progressCallback
+  ) {
+    if(track->IsPlanar) {
+      mixPlanarTrack(track, matrix, canceler, progressCallback);
+      return;
+    }
+
+    std::uint64_t frameCount = track->CountFrames();
+    if constexpr(InputChannelCount < OutputChannelCount) {
+      track->Samples.resize(frameCount * OutputChannelCount);
+    }
+
+    // The statistics are re-collected from each chunk right after mixing it,
+    // while the mixed samples are still in the cache
+    track->Statistics.Reset(OutputChannelCount, frameCount);
+
+    // Chunks are processed in the same direction as the frames inside them,
+    // so each chunk only overwrites samples that have already been mixed
+    std::uint64_t mixedFrameCount = 0;
+    while(mixedFrameCount < frameCount) {
+      std::size_t chunkFrameCount = static_cast<std::size_t>(
+        std::min<std::uint64_t>(frameCount - mixedFrameCount, FramesPerChunk)
+      );
+      std::uint64_t chunkStartIndex;
+      if constexpr(OutputChannelCount <= InputChannelCount) {
+        chunkStartIndex = mixedFrameCount;
+      } else {
+        chunkStartIndex = frameCount - mixedFrameCount - chunkFrameCount;
+      }
+
+      mixFrames(track->Samples.data(), chunkStartIndex, chunkFrameCount, matrix);
+      track->Statistics.Accumulate(
+        track->Samples.data() + chunkStartIndex * OutputChannelCount,
+        chunkStartIndex, chunkFrameCount
+      );
+      mixedFrameCount += chunkFrameCount;
+
+      canceler->ThrowIfCanceled();
+      progressCallback(static_cast<float>(mixedFrameCount) / static_cast<float>(frameCount));
+    }
+
+    if constexpr(OutputChannelCount < InputChannelCount) {
+      track->Samples.resize(frameCount * OutputChannelCount);
+      track->Samples.shrink_to_fit();
+    }
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Builds the mixing matrix for a downmix from surround to stereo</summary>
+  /// <param name="track">Track with the 5.1 or 7.1 surround channels to downmix</param>
+  /// <param name="nightmodeLevel">
+  ///   How much the alternative Nightmode downmix formula will be used
+  /// </param>
+  /// <returns>The mixing matrix that downmixes the track's channels to stereo</returns>
+  template<std::size_t InputChannelCount>
+  MixingMatrix<InputChannelCount, 2> makeStereoDownmixMatrix(
+    const Nuclex::OpusTranscoder::Audio::Track &track, float nightmodeLevel
+  ) {
+    MixingMatrix<InputChannelCount, 2> matrix = {};
+    std::size_t contributionCounts[2] = { 0, 0 };
+
+    // Fill in the channels that should contribute to each of the stereo channels.
+    // For now, we'll only consider 5.1 and 7.1 layouts.
+    for(std::size_t index = 0; index < InputChannelCount; ++index) {
+      switch(track.Channels[index].Placement) {
         case Nuclex::Audio::ChannelPlacement::FrontCenter: {
           float contribution = lerp(Diagonal, 1.0f, nightmodeLevel);
-          mapping[0].emplace_back(index, contribution);
-          mapping[1].emplace_back(index, contribution);
+          matrix.Factors[0][index] = contribution;
+          matrix.Factors[1][index] = contribution;
+          ++contributionCounts[0];
+          ++contributionCounts[1];
           break;
         }
         case Nuclex::Audio::ChannelPlacement::FrontLeft: {
-          float contribution = lerp(1.0f, 0.3f, nightmodeLevel);
-          mapping[0].emplace_back(index, contribution);
+          matrix.Factors[0][index] = lerp(1.0f, 0.3f, nightmodeLevel);
+          ++contributionCounts[0];
           break;
         }
         case Nuclex::Audio::ChannelPlacement::FrontRight: {
-          float contribution = lerp(1.0f, 0.3f, nightmodeLevel);
-          mapping[1].emplace_back(index, contribution);
+          matrix.Factors[1][index] = lerp(1.0f, 0.3f, nightmodeLevel);
+          ++contributionCounts[1];
           break;
         }
         case Nuclex::Audio::ChannelPlacement::SideLeft:
         case Nuclex::Audio::ChannelPlacement::BackLeft: {
-          float contribution = lerp(Diagonal, 0.3f, nightmodeLevel);
-          // Nope, side left and back left are split 50%/50% already
-          //if(6 < track->Channels.size()) {
-          //  contribution /= 2.0f; // If side AND back channel present, each adds half
-          //}
-          mapping[0].emplace_back(index, contribution);
+          // Not halved for 7.1, side left and back left are split 50%/50% already
+          matrix.Factors[0][index] = lerp(Diagonal, 0.3f, nightmodeLevel);
+          ++contributionCounts[0];
           break;
         }
         case Nuclex::Audio::ChannelPlacement::SideRight:
         case Nuclex::Audio::ChannelPlacement::BackRight: {
-          float contribution = lerp(Diagonal, 0.3f, nightmodeLevel);
-          // Nope, side right and back right are split 50%/50% already
-          //if(6 < track->Channels.size()) {
-          //  contribution /= 2.0f; // If side AND back channel present, each adds half
-          //}
-          mapping[1].emplace_back(index, contribution);
+          // Not halved for 7.1, side right and back right are split 50%/50% already
+          matrix.Factors[1][index] = lerp(Diagonal, 0.3f, nightmodeLevel);
+          ++contributionCounts[1];
           break;
         }
         default: { break; }
       }
     }
-    
+
     // If the expected channels were there, we should have 3 contributions for
     // each stereo channel now (or 4 with split back/side channels)
-    if((mapping[0].size() != 3) && (mapping[0].size() != 4)) {
+    if((contributionCounts[0] != 3) && (contributionCounts[0] != 4)) {
       throw std::runtime_error(
         u8"Channel layout is non-standard and can't be downmixed to stereo"
       );
     }
-    if(mapping[1].size() != mapping[0].size()) {
+    if(contributionCounts[1] != contributionCounts[0]) {
       throw std::runtime_error(
         u8"Channel layout is non-standard and can't be downmixed to stereo"
       );
     }
 
-    // Now use the list of channel contributions to downmix the channels in-place
-    {
-      std::size_t channelCount = track->Channels.size();
-      std::uint64_t frameCount = track->Samples.size() / channelCount;
+    return matrix;
+  }
 
-      float *write = track->Samples.data();
-      const float *read = write;
-      for(std::uint64_t index = 0; index < frameCount; ++index) {
-        float left = 0.0f, right = 0.0f;
+  // ------------------------------------------------------------------------------------------- //
 
-        for(const ChannelContribution &contribution : mapping[0]) {
-          left += read[contribution.InterleaveOffset] * contribution.Factor;
-        }
-        for(const ChannelContribution &contribution : mapping[1]) {
-          right += read[contribution.InterleaveOffset] * contribution.Factor;
-        }
+} // anonymous namespace
 
-        write[0] = left;
-        write[1] = right;
+namespace Nuclex::OpusTranscoder::Audio {
 
-        if((index & 0x2fff) == 0) {
-          canceler->ThrowIfCanceled();
-          progressCallback(static_cast<float>(index) / static_cast<float>(frameCount));
-        }
+  // ------------------------------------------------------------------------------------------- //
 
-        read += channelCount;
-        write += 2;
-      }
+  void ChannelLayoutTransformer::DownmixToStereo(
+    const std::shared_ptr<Track> &track,
+    float nightmodeLevel,
+    const std::shared_ptr<const Nuclex::Support::Threading::StopToken> &canceler,
+    Nuclex::Support::Events::Delegate<void(float)> &progressCallback,
+    const std::vector<float> &channelGains /* = std::vector<float>() */
+  ) {
+    if((track->Channels.size() != 6) && (track->Channels.size() != 8)) {
+      throw std::runtime_error(u8"Only 5.1 and 7.1 surround can be downmixed to stereo");
+    }
 
-      // Now we've got stereo, truncate the samples we no longer need
-      track->Samples.resize(frameCount * 2);
-      track->Samples.shrink_to_fit();
+    if(track->Channels.size() == 6) {
+      MixingMatrix<6, 2> matrix = makeStereoDownmixMatrix<6>(*track, nightmodeLevel);
+      applyChannelGains(matrix, channelGains);
+      mixTrack(track, matrix, canceler, progressCallback);
+    } else {
+      MixingMatrix<8, 2> matrix = makeStereoDownmixMatrix<8>(*track, nightmodeLevel);
+      applyChannelGains(matrix, channelGains);
+      mixTrack(track, matrix, canceler, progressCallback);
     }
 
     // Set the records straight, we've downmixed the input to stereo,
@@ -172,7 +575,8 @@ namespace Nuclex::OpusTranscoder::Audio {
   void ChannelLayoutTransformer::DownmixToFiveDotOne(
     const std::shared_ptr<Track> &track,
     const std::shared_ptr<const Nuclex::Support::Threading::StopToken> &canceler,
-    Nuclex::Support::Events::Delegate<void(float)> &progressCallback
+    Nuclex::Support::Events::Delegate<void(float)> &progressCallback,
+    const std::vector<float> &channelGains /* = std::vector<float>() */
   ) {
     if(track->Channels.size() != 8) {
       throw std::runtime_error(u8"Only 7.1 surround can be downmixed to 5.1 surround");
@@ -198,7 +602,7 @@ namespace Nuclex::OpusTranscoder::Audio {
           break;
         }
         case Nuclex::Audio::ChannelPlacement::LowFrequencyEffects: {
-          fullMapping[3] = index; // actually has spot 6, handled  in the downmix loop
+          fullMapping[3] = index; // actually has spot 6, handled in the mixing matrix
           break;
         }
         case Nuclex::Audio::ChannelPlacement::SideLeft: {
@@ -231,52 +635,21 @@ namespace Nuclex::OpusTranscoder::Audio {
       }
     }
 
-    // Now use the list of channel contributions to downmix the channels in-place
+    // Turn the two lists into a mixing matrix and use it to downmix the channels in-place.
+    // The LFE channel is listed fourth in the full mapping, but goes to spot 6.
     {
-      std::size_t channelCount = track->Channels.size();
-      std::uint64_t frameCount = track->Samples.size() / channelCount;
-
-      float *write = track->Samples.data();
-      const float *read = write;
-
-      // For the first 4 frames, we are in risk of overwriting channels if their ordering
-      // puts them in harms way (i.e. if input starts 'left'-'center'-'right' and we write
-      // 'left'-'right'-... oops, we just overwrite the original 'center' value). Since
-      // we're turned eight into six channels, after three iterations, the risk is gone.
-      for(std::uint64_t index = 0; index < std::min<std::uint64_t>(frameCount, 3); ++index) {
-        float temp[8] = { read[0], read[1], read[2], read[3], read[4], read[5], read[6], read[7] };
-        write[0] = temp[fullMapping[0]];
-        write[1] = temp[fullMapping[1]];
-        write[2] = temp[fullMapping[2]];
-        write[3] = (temp[halfMapping[0]] + temp[halfMapping[1]]);
-        write[4] = (temp[halfMapping[2]] + temp[halfMapping[3]]);
-        write[5] = temp[fullMapping[3]];
-
-        read += 8;
-        write += 6;
-      }
-
-      // From iteration 3 onwards, we don't need to copy the channels anymore.
-      for(std::uint64_t index = 3; index < frameCount; ++index) {
-        write[0] = read[fullMapping[0]];
-        write[1] = read[fullMapping[1]];
-        write[2] = read[fullMapping[2]];
-        write[3] = (read[halfMapping[0]] + read[halfMapping[1]]);
-        write[4] = (read[halfMapping[2]] + read[halfMapping[3]]);
-        write[5] = read[fullMapping[3]];
-
-        if((index & 0x2fff) == 0) {
-          canceler->ThrowIfCanceled();
-          progressCallback(static_cast<float>(index) / static_cast<float>(frameCount));
-        }
-
-        read += 8;
-        write += 6;
-      }
-
-      // Now we've got 5.1, truncate the samples we no longer need
-      track->Samples.resize(frameCount * 6);
-      track->Samples.shrink_to_fit();
+      MixingMatrix<8, 6> matrix = {};
+      matrix.Factors[0][fullMapping[0]] = 1.0f;
+      matrix.Factors[1][fullMapping[1]] = 1.0f;
+      matrix.Factors[2][fullMapping[2]] = 1.0f;
+      matrix.Factors[3][halfMapping[0]] = 1.0f;
+      matrix.Factors[3][halfMapping[1]] = 1.0f;
+      matrix.Factors[4][halfMapping[2]] = 1.0f;
+      matrix.Factors[4][halfMapping[3]] = 1.0f;
+      matrix.Factors[5][fullMapping[3]] = 1.0f;
+      applyChannelGains(matrix, channelGains);
+
+      mixTrack(track, matrix, canceler, progressCallback);
     }
 
     // Set the records straight, we've downmixed the input to 5.1 surround
@@ -294,6 +667,7 @@ namespace Nuclex::OpusTranscoder::Audio {
     track->Channels[4].Placement = Nuclex::Audio::ChannelPlacement::BackRight;
     track->Channels[5].InputOrder = 5;
     track->Channels[5].Placement = Nuclex::Audio::ChannelPlacement::LowFrequencyEffects;
+    track->Statistics.SetBassChannel(5);
   }
 
   // ------------------------------------------------------------------------------------------- //
@@ -301,7 +675,8 @@ namespace Nuclex::OpusTranscoder::Audio {
   void ChannelLayoutTransformer::UpmixToStereo(
     const std::shared_ptr<Track> &track,
     const std::shared_ptr<const Nuclex::Support::Threading::StopToken> &canceler,
-    Nuclex::Support::Events::Delegate<void(float)> &progressCallback
+    Nuclex::Support::Events::Delegate<void(float)> &progressCallback,
+    const std::vector<float> &channelGains /* = std::vector<float>() */
   ) {
     if(track->Channels.size() != 1) {
       throw std::runtime_error(u8"Only mono can be upmixed to stereo");
@@ -310,28 +685,15 @@ namespace Nuclex::OpusTranscoder::Audio {
       throw std::runtime_error(u8"Non-standad mono channel can not be upmixed to stereo");
     }
 
-    // Because the data doubles in size, we have to do the in-place conversion
-    // in reverse, otherwise we'd overwrite samples. Goodbye cache prefetcher.
+    // Because the data doubles in size, the in-place conversion runs in reverse,
+    // otherwise we'd overwrite samples. The mixing kernel takes care of that.
     {
-      std::uint64_t frameCount = track->Samples.size();
-      track->Samples.resize(frameCount * 2);
-
-      float *write = track->Samples.data() + (frameCount * 2) - 2;
-      const float *read = track->Samples.data() + frameCount - 1;
-
-      for(std::uint64_t index = 0; index < frameCount; ++index) {
-        float sample = read[0];
-        write[0] = sample; // * Diagonal
-        write[1] = sample; // * Diagonal
-
-        if((index & 0x2fff) == 0) {
-          canceler->ThrowIfCanceled();
-          progressCallback(static_cast<float>(index) / static_cast<float>(frameCount));
-        }
+      MixingMatrix<1, 2> matrix = {};
+      matrix.Factors[0][0] = 1.0f; // * Diagonal
+      matrix.Factors[1][0] = 1.0f; // * Diagonal
+      applyChannelGains(matrix, channelGains);
 
-        read -= 1;
-        write -= 2;
-      }
+      mixTrack(track, matrix, canceler, progressCallback);
     }
 
     // Update the channel descriptions to indicate two channels, stereo.
@@ -347,7 +709,8 @@ namespace Nuclex::OpusTranscoder::Audio {
   void ChannelLayoutTransformer::ReweaveToVorbisLayout(
     const std::shared_ptr<Track> &track,
     const std::shared_ptr<const Nuclex::Support::Threading::StopToken> &canceler,
-    Nuclex::Support::Events::Delegate<void(float)> &progressCallback
+    Nuclex::Support::Events::Delegate<void(float)> &progressCallback,
+    const std::vector<float> &channelGains /* = std::vector<float>() */
   ) {
     if(track->Channels.size() != 6) {
       throw std::runtime_error(u8"Only 5.1 surround can be re-weaved to the Vorbis layout");
@@ -399,30 +762,16 @@ namespace Nuclex::OpusTranscoder::Audio {
       }
     }
 
-    // Now use the list of channel contributions to downmix the channels in-place
+    // Now use the mapping table to re-weave the channels in-place. The mixing matrix
+    // only has a single 1.0 in each row, so each output channel copies one input channel.
     {
-      std::size_t channelCount = track->Channels.size();
-      std::uint64_t frameCount = track->Samples.size() / channelCount;
-
-      float *write = track->Samples.data();
-      const float *read = write;
-      for(std::uint64_t index = 0; index < frameCount; ++index) {
-        float temp[6] = { read[0], read[1], read[2], read[3], read[4], read[5] };
-        write[0] = temp[mapping[0]];
-        write[1] = temp[mapping[1]];
-        write[2] = temp[mapping[2]];
-        write[3] = temp[mapping[3]];
-        write[4] = temp[mapping[4]];
-        write[5] = temp[mapping[5]];
-
-        if((index & 0x2fff) == 0) {
-          canceler->ThrowIfCanceled();
-          progressCallback(static_cast<float>(index) / static_cast<float>(frameCount));
-        }
-
-        read += 6;
-        write += 6;
+      MixingMatrix<6, 6> matrix = {};
+      for(std::size_t index = 0; index < 6; ++index) {
+        matrix.Factors[index][mapping[index]] = 1.0f;
       }
+      applyChannelGains(matrix, channelGains);
+
+      mixTrack(track, matrix, canceler, progressCallback);
     }
 
     // We've re-ordered the input channels to 5.1 surround in
@@ -440,6 +789,7 @@ namespace Nuclex::OpusTranscoder::Audio {
     track->Channels[4].Placement = Nuclex::Audio::ChannelPlacement::BackRight;
     track->Channels[5].InputOrder = 5;
     track->Channels[5].Placement = Nuclex::Audio::ChannelPlacement::LowFrequencyEffects;
+    track->Statistics.SetBassChannel(5);
   }
 
   // ------------------------------------------------------------------------------------------- //
@@ -27,12 +27,18 @@ limitations under the License.
 #include <Nuclex/Support/Events/Delegate.h>
 
 #include <memory> // for std::shared_ptr
+#include <vector> // for std::vector
 
 namespace Nuclex::OpusTranscoder::Audio {
 
   // ------------------------------------------------------------------------------------------- //
 
   /// <summary>Changes channel layouts, upmixing, downmixing or re-weaving accordingly</summary>
+  /// <remarks>
+  ///   All methods can apply a gain to each input channel as part of the mix, which
+  ///   lets normalization (see <see cref="Normalizer::CalculateChannelGains" />) ride
+  ///   along with the layout change instead of needing its own pass over the samples.
+  /// </remarks>
   class ChannelLayoutTransformer {
 
     /// <summary>Performs a downmix of the track's channels to stereo</summary>
@@ -42,41 +48,57 @@ namespace Nuclex::OpusTranscoder::Audio {
     /// </param>
     /// <param name="canceler">Token by which the operation can be signalled to cancel</param>
     /// <param name="progressCallback">Callback to which progress reports should be sent</param>
+    /// <param name="channelGains">
+    ///   Optional factor by which each input channel is amplified while mixing
+    /// </param>
     public: static void DownmixToStereo(
       const std::shared_ptr<Track> &track, // can be 5.1 or 7.1
       float nightmodeLevel,
       const std::shared_ptr<const Nuclex::Support::Threading::StopToken> &canceler,
-      Nuclex::Support::Events::Delegate<void(float)> &progressCallback
+      Nuclex::Support::Events::Delegate<void(float)> &progressCallback,
+      const std::vector<float> &channelGains = std::vector<float>()
     );
 
     /// <summary>Performs a downmix of the track's channels to 5.1 surround</summary>
     /// <param name-"track">Track that will be downmixed</param>
     /// <param name="canceler">Token by which the operation can be signalled to cancel</param>
     /// <param name="progressCallback">Callback to which progress reports should be sent</param>
+    /// <param name="channelGains">
+    ///   Optional factor by which each input channel is amplified while mixing
+    /// </param>
     public: static void DownmixToFiveDotOne(
       const std::shared_ptr<Track> &track, // must be 7.1
       const std::shared_ptr<const Nuclex::Support::Threading::StopToken> &canceler,
-      Nuclex::Support::Events::Delegate<void(float)> &progressCallback
+      Nuclex::Support::Events::Delegate<void(float)> &progressCallback,
+      const std::vector<float> &channelGains = std::vector<float>()
     );
 
     /// <summary>Performs an upmix of a mono input channel to stereo</summary>
     /// <param name-"track">Track that will be upmixed</param>
     /// <param name="canceler">Token by which the operation can be signalled to cancel</param>
     /// <param name="progressCallback">Callback to which progress reports should be sent</param>
+    /// <param name="channelGains">
+    ///   Optional factor by which each input channel is amplified while mixing
+    /// </param>
     public: static void UpmixToStereo(
       const std::shared_ptr<Track> &track, // must be mono
       const std::shared_ptr<const Nuclex::Support::Threading::StopToken> &canceler,
-      Nuclex::Support::Events::Delegate<void(float)> &progressCallback
+      Nuclex::Support::Events::Delegate<void(float)> &progressCallback,
+      const std::vector<float> &channelGains = std::vector<float>()
     );
 
     /// <summary>Reorders the channels of the input file to the Vorbis order</summary>
     /// <param name-"track">Track in which the channels will be reordered</param>
     /// <param name="canceler">Token by which the operation can be signalled to cancel</param>
     /// <param name="progressCallback">Callback to which progress reports should be sent</param>
+    /// <param name="channelGains">
+    ///   Optional factor by which each input channel is amplified while mixing
+    /// </param>
     public: static void ReweaveToVorbisLayout(
       const std::shared_ptr<Track> &track, // must be 5.1
       const std::shared_ptr<const Nuclex::Support::Threading::StopToken> &canceler,
-      Nuclex::Support::Events::Delegate<void(float)> &progressCallback
+      Nuclex::Support::Events::Delegate<void(float)> &progressCallback,
+      const std::vector<float> &channelGains = std::vector<float>()
     );
 
   };
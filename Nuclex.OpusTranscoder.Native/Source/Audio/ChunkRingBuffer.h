@@ -0,0 +1,109 @@
+#pragma region Apache License 2.0
+/*
+Nuclex Opus Transcoder
+Copyright (C) 2024 Markus Ewald / Nuclex Development Labs
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#pragma endregion // Apache License 2.0
+
+#ifndef NUCLEX_OPUSTRANSCODER_AUDIO_CHUNKRINGBUFFER_H
+#define NUCLEX_OPUSTRANSCODER_AUDIO_CHUNKRINGBUFFER_H
+
+#include "../Config.h"
+
+#include <atomic> // for std::atomic
+#include <vector> // for std::vector
+#include <cstddef> // for std::size_t
+
+namespace Nuclex::OpusTranscoder::Audio {
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Bounded queue through which one thread can hand items to another thread</summary>
+  /// <typeparam name="TItem">Type of items that will be passed through the queue</typeparam>
+  /// <remarks>
+  ///   <para>
+  ///     This is a lock-free single-producer, single-consumer ring buffer. Exactly one
+  ///     thread may call <see cref="TryPush" /> and exactly one (other) thread may call
+  ///     <see cref="TryPop" />. Neither call ever blocks, so waiting (and checking for
+  ///     cancellation while doing so) is up to the caller.
+  ///   </para>
+  ///   <para>
+  ///     The transcoder's pipeline uses these to pass pointers to pre-allocated audio
+  ///     chunks between its stages, so items should be cheap to copy.
+  ///   </para>
+  /// </remarks>
+  template<typename TItem>
+  class ChunkRingBuffer {
+
+    /// <summary>Initializes a new ring buffer</summary>
+    /// <param name="capacity">Maximum number of items the ring buffer can hold</param>
+    public: ChunkRingBuffer(std::size_t capacity) :
+      items(capacity + 1),
+      readIndex(0),
+      writeIndex(0) {}
+
+    /// <summary>Attempts to append an item to the ring buffer</summary>
+    /// <param name="item">Item that will be appended</param>
+    /// <returns>True if the item was appended, false if the ring buffer was full</returns>
+    public: bool TryPush(const TItem &item) {
+      std::size_t currentWriteIndex = this->writeIndex.load(std::memory_order_relaxed);
+      std::size_t nextWriteIndex = currentWriteIndex + 1;
+      if(nextWriteIndex == this->items.size()) {
+        nextWriteIndex = 0;
+      }
+
+      // One slot always stays empty so a full buffer can be told apart from an empty one
+      if(nextWriteIndex == this->readIndex.load(std::memory_order_acquire)) {
+        return false;
+      }
+
+      this->items[currentWriteIndex] = item;
+      this->writeIndex.store(nextWriteIndex, std::memory_order_release);
+      return true;
+    }
+
+    /// <summary>Attempts to take the oldest item from the ring buffer</summary>
+    /// <param name="item">Receives the item if one was available</param>
+    /// <returns>True if an item was taken, false if the ring buffer was empty</returns>
+    public: bool TryPop(TItem &item) {
+      std::size_t currentReadIndex = this->readIndex.load(std::memory_order_relaxed);
+      if(currentReadIndex == this->writeIndex.load(std::memory_order_acquire)) {
+        return false;
+      }
+
+      item = this->items[currentReadIndex];
+
+      std::size_t nextReadIndex = currentReadIndex + 1;
+      if(nextReadIndex == this->items.size()) {
+        nextReadIndex = 0;
+      }
+      this->readIndex.store(nextReadIndex, std::memory_order_release);
+      return true;
+    }
+
+    /// <summary>Slots that store the items in the ring buffer</summary>
+    private: std::vector<TItem> items;
+    /// <summary>Index of the slot the consumer will read from next</summary>
+    private: alignas(64) std::atomic<std::size_t> readIndex;
+    /// <summary>Index of the slot the producer will write to next</summary>
+    private: alignas(64) std::atomic<std::size_t> writeIndex;
+
+  };
+
+  // ------------------------------------------------------------------------------------------- //
+
+} // namespace Nuclex::OpusTranscoder::Audio
+
+#endif // NUCLEX_OPUSTRANSCODER_AUDIO_CHUNKRINGBUFFER_H
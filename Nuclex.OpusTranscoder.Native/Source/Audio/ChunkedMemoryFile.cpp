@@ -0,0 +1,140 @@
+#pragma region Apache License 2.0
+/*
+Nuclex Opus Transcoder
+Copyright (C) 2024 Markus Ewald / Nuclex Development Labs
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#pragma endregion // Apache License 2.0
+
+// If the application is compiled as a DLL, this ensures symbols are exported
+#define NUCLEX_OPUSTRANSCODER_SOURCE 1
+
+#include "./ChunkedMemoryFile.h"
+
+#include <cassert> // for assert()
+#include <algorithm> // for std::copy_n(), std::min()
+
+namespace Nuclex::OpusTranscoder::Audio {
+
+  // ------------------------------------------------------------------------------------------- //
+
+  // Large enough that a feature-length surround track needs only a few dozen chunks,
+  // small enough that the unused space at the end of the last one doesn't matter.
+  const std::size_t ChunkedMemoryFile::ChunkSize = 4 * 1024 * 1024;
+
+  // ------------------------------------------------------------------------------------------- //
+
+  ChunkedMemoryFile::ChunkedMemoryFile(std::uint64_t expectedSize /* = 0 */) :
+    chunks(),
+    size(0) {
+    Reserve(expectedSize);
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  void ChunkedMemoryFile::Reserve(std::uint64_t byteCount) {
+    std::size_t requiredChunkCount = static_cast<std::size_t>(
+      (byteCount + ChunkSize - 1) / ChunkSize
+    );
+
+    // The chunk list may be reallocated, but the chunks it points to never move
+    this->chunks.reserve(requiredChunkCount);
+    while(this->chunks.size() < requiredChunkCount) {
+      this->chunks.emplace_back(new std::byte[ChunkSize]);
+    }
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  void ChunkedMemoryFile::ReadAt(
+    std::uint64_t start, std::size_t byteCount, std::byte *buffer
+  ) const {
+    assert((start < this->size) && u8"Read starts within file boundaries");
+    assert((this->size >= start + byteCount) && u8"Read ends within file boundaries");
+
+    while(0 < byteCount) {
+      std::size_t chunkIndex = static_cast<std::size_t>(start / ChunkSize);
+      std::size_t chunkOffset = static_cast<std::size_t>(start % ChunkSize);
+      std::size_t byteCountToCopy = std::min(ChunkSize - chunkOffset, byteCount);
+
+      std::copy_n(this->chunks[chunkIndex].get() + chunkOffset, byteCountToCopy, buffer);
+
+      buffer += byteCountToCopy;
+      start += byteCountToCopy;
+      byteCount -= byteCountToCopy;
+    }
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  std::size_t ChunkedMemoryFile::ReadSpan(
+    std::uint64_t start, std::size_t byteCount, const std::byte *&data
+  ) const {
+    assert((start <= this->size) && u8"Span starts within file boundaries");
+
+    byteCount = static_cast<std::size_t>(std::min<std::uint64_t>(this->size - start, byteCount));
+    if(byteCount == 0) {
+      data = nullptr;
+      return 0;
+    }
+
+    std::size_t chunkIndex = static_cast<std::size_t>(start / ChunkSize);
+    std::size_t chunkOffset = static_cast<std::size_t>(start % ChunkSize);
+
+    data = this->chunks[chunkIndex].get() + chunkOffset;
+    return std::min(ChunkSize - chunkOffset, byteCount);
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  void ChunkedMemoryFile::WriteAt(
+    std::uint64_t start, std::size_t byteCount, const std::byte *buffer
+  ) {
+    assert((start <= this->size) && u8"Write starts within or at the end of the file");
+
+    std::uint64_t endIndex = start + byteCount;
+    if(this->size < endIndex) {
+      Reserve(endIndex);
+      this->size = endIndex;
+    }
+
+    while(0 < byteCount) {
+      std::size_t chunkIndex = static_cast<std::size_t>(start / ChunkSize);
+      std::size_t chunkOffset = static_cast<std::size_t>(start % ChunkSize);
+      std::size_t byteCountToCopy = std::min(ChunkSize - chunkOffset, byteCount);
+
+      std::copy_n(buffer, byteCountToCopy, this->chunks[chunkIndex].get() + chunkOffset);
+
+      buffer += byteCountToCopy;
+      start += byteCountToCopy;
+      byteCount -= byteCountToCopy;
+    }
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  void ChunkedMemoryFile::WriteTo(Nuclex::Audio::Storage::VirtualFile &target) const {
+    std::uint64_t offset = 0;
+    for(std::size_t chunkIndex = 0; offset < this->size; ++chunkIndex) {
+      std::size_t byteCount = static_cast<std::size_t>(
+        std::min<std::uint64_t>(ChunkSize, this->size - offset)
+      );
+      target.WriteAt(offset, byteCount, this->chunks[chunkIndex].get());
+      offset += byteCount;
+    }
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+} // namespace Nuclex::OpusTranscoder::Audio
@@ -0,0 +1,118 @@
+#pragma region Apache License 2.0
+/*
+Nuclex Opus Transcoder
+Copyright (C) 2024 Markus Ewald / Nuclex Development Labs
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#pragma endregion // Apache License 2.0
+
+#ifndef NUCLEX_OPUSTRANSCODER_AUDIO_CHUNKEDMEMORYFILE_H
+#define NUCLEX_OPUSTRANSCODER_AUDIO_CHUNKEDMEMORYFILE_H
+
+#include "../Config.h"
+#include "./SpanningFile.h"
+
+#include <Nuclex/Audio/Storage/VirtualFile.h>
+
+#include <vector> // for std::vector
+#include <memory> // for std::unique_ptr
+#include <cstddef> // for std::byte
+
+namespace Nuclex::OpusTranscoder::Audio {
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Virtual file that keeps its contents in a list of large memory chunks</summary>
+  /// <remarks>
+  ///   <para>
+  ///     An Opus stream for a long surround track can grow to hundreds of MiB. Appending
+  ///     that to a single vector would reallocate and copy it over and over. This file
+  ///     instead adds fixed-size chunks as it grows and never moves any of them.
+  ///   </para>
+  ///   <para>
+  ///     If the caller knows roughly how large the file will become, it can reserve
+  ///     the chunks up front, so no allocations happen while the encoder is writing.
+  ///   </para>
+  /// </remarks>
+  class ChunkedMemoryFile :
+    public Nuclex::Audio::Storage::VirtualFile,
+    public SpanningFile {
+
+    /// <summary>Size of each memory chunk in bytes</summary>
+    public: static const std::size_t ChunkSize;
+
+    /// <summary>Initializes a new, empty chunked memory file</summary>
+    /// <param name="expectedSize">Number of bytes to reserve memory for</param>
+    public: ChunkedMemoryFile(std::uint64_t expectedSize = 0);
+
+    /// <summary>Frees all memory used by the instance</summary>
+    public: ~ChunkedMemoryFile() override = default;
+
+    /// <summary>Makes sure that memory chunks for the specified size are allocated</summary>
+    /// <param name="byteCount">Number of bytes the file should be able to hold</param>
+    public: void Reserve(std::uint64_t byteCount);
+
+    /// <summary>Determines the current size of the file in bytes</summary>
+    /// <returns>The size of the file in bytes</returns>
+    public: std::uint64_t GetSize() const override { return this->size; }
+
+    /// <summary>Reads data from the file</summary>
+    /// <param name="start">Offset in the file at which to begin reading</param>
+    /// <param name="byteCount">Number of bytes that will be read</param>
+    /// <parma name="buffer">Buffer into which the data will be read</param>
+    public: void ReadAt(
+      std::uint64_t start, std::size_t byteCount, std::byte *buffer
+    ) const override;
+
+    /// <summary>Provides direct access to the contents of the file at an offset</summary>
+    /// <param name="start">Offset in the file of the first byte that is needed</param>
+    /// <param name="byteCount">Number of bytes that are needed</param>
+    /// <param name="data">Receives the address of the byte at the offset</param>
+    /// <returns>The number of bytes that can be read from the address</returns>
+    /// <remarks>
+    ///   Spans end at the boundaries of the memory chunks, so a span is at most
+    ///   <see cref="ChunkSize" /> bytes long.
+    /// </remarks>
+    public: std::size_t ReadSpan(
+      std::uint64_t start, std::size_t byteCount, const std::byte *&data
+    ) const override;
+
+    /// <summary>Writes data into the file</summary>
+    /// <param name="start">Offset at which writing will begin in the file</param>
+    /// <param name="byteCount">Number of bytes that should be written</param>
+    /// <param name="buffer">Buffer holding the data that should be written</param>
+    public: void WriteAt(
+      std::uint64_t start, std::size_t byteCount, const std::byte *buffer
+    ) override;
+
+    /// <summary>Writes the entire contents of the file into another file</summary>
+    /// <param name="target">File into which the contents will be written</param>
+    /// <remarks>
+    ///   The chunks are handed to the target file directly, one write per chunk,
+    ///   without going through an intermediate buffer.
+    /// </remarks>
+    public: void WriteTo(Nuclex::Audio::Storage::VirtualFile &target) const;
+
+    /// <summary>Memory chunks holding the contents of the file</summary>
+    private: std::vector<std::unique_ptr<std::byte[]>> chunks;
+    /// <summary>Current size of the file in bytes</summary>
+    private: std::uint64_t size;
+
+  };
+
+  // ------------------------------------------------------------------------------------------- //
+
+} // namespace Nuclex::OpusTranscoder::Audio
+
+#endif // NUCLEX_OPUSTRANSCODER_AUDIO_CHUNKEDMEMORYFILE_H
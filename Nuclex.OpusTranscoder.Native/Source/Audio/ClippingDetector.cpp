@@ -21,162 +21,513 @@ limitations under the License.
 #define NUCLEX_OPUSTRANSCODER_SOURCE 1
 
 #include "./ClippingDetector.h"
+#include "./WorkPartitioner.h"
 
-#include <algorithm>
+#include <Nuclex/Support/Threading/ThreadPool.h>
+
+#include <cassert> // for assert()
+#include <algorithm> // for std::min(), std::max()
+#include <atomic> // for std::atomic
+#include <future> // for std::future
+#include <functional> // for std::ref(), std::cref()
+
+#if defined(NUCLEX_OPUSTRANSCODER_HAVE_AVX2)
+  #include <immintrin.h> // for AVX2 intrinsics
+#elif defined(NUCLEX_OPUSTRANSCODER_HAVE_SSE2)
+  #include <emmintrin.h> // for SSE2 intrinsics
+#elif defined(NUCLEX_OPUSTRANSCODER_HAVE_NEON)
+  #include <arm_neon.h> // for NEON intrinsics
+#endif
 
 namespace {
 
   // ------------------------------------------------------------------------------------------- //
 
-  /// <summary>Value that is used to indicate an invalid index in a list</summary>
-  const std::size_t InvalidIndex = std::size_t(-1);
+  /// <summary>Checks whether a newly found half-wave intersects an existing one</summary>
+  /// <param name="existingHalfwave">Existing half-wave the new one is checked against</param>
+  /// <param name="clippingHalfwave">New half-wave to match to the existing one</param>
+  /// <returns>True if the two half-waves intersect or touch</returns>
+  bool halfwavesIntersect(
+    const Nuclex::OpusTranscoder::Audio::ClippingHalfwave &existingHalfwave,
+    const Nuclex::OpusTranscoder::Audio::ClippingHalfwave &clippingHalfwave
+  ) {
+
+    // We assume that touching means it's the same half-wave.
+    //
+    // If an audio codec completely reinvented the waveform, we'd risk associating
+    // a half-wave that isn't directly related to a newly discovered clipping peak
+    // and wildly scaling that one around without effect.
+    //
+    // So far, Opus seems to have a high correlation between input waveform and
+    // output waveform, as it should be.
+    //
+    bool beginsInside = (
+      (clippingHalfwave.PriorZeroCrossingIndex >= existingHalfwave.PriorZeroCrossingIndex) &&
+      (clippingHalfwave.PriorZeroCrossingIndex < existingHalfwave.NextZeroCrossingIndex)
+    );
+    bool endsInside = (
+      (existingHalfwave.NextZeroCrossingIndex >= clippingHalfwave.NextZeroCrossingIndex) &&
+      (existingHalfwave.PriorZeroCrossingIndex < clippingHalfwave.NextZeroCrossingIndex)
+    );
+    bool envelops = (
+      (clippingHalfwave.PriorZeroCrossingIndex < existingHalfwave.PriorZeroCrossingIndex) &&
+      (clippingHalfwave.NextZeroCrossingIndex >= existingHalfwave.NextZeroCrossingIndex)
+    );
+
+    return (beginsInside || endsInside || envelops);
+
+  }
 
   // ------------------------------------------------------------------------------------------- //
 
-  /// <summary>
-  ///   Checks if the first half-wave's start sample is earlier then the second one's
-  /// </summary>
-  /// <param name="first">First half-wave that will be compared</param>
-  /// <param name="second">Second half-wave that will be compared</param>
-  /// <returns>True if the first half-wave begins earlier than the second</returns?
-  bool halfwaveStartIndexIsLess(
-    const Nuclex::OpusTranscoder::Audio::ClippingHalfwave &first,
-    const Nuclex::OpusTranscoder::Audio::ClippingHalfwave &second
+  /// <summary>Skips over all half-waves that end before another half-wave begins</summary>
+  /// <param name="halfwaves">Ordered list of half-waves that will be skipped through</param>
+  /// <param name="index">Index in the list that will be advanced</param>
+  /// <param name="clippingHalfwave">Half-wave before which the skipped ones end</param>
+  /// <remarks>
+  ///   After this, the half-wave at the index is the only one that can intersect the
+  ///   provided half-wave's start, so it's also the earliest one that can intersect at all.
+  /// </remarks>
+  void skipHalfwavesEndingBefore(
+    const Nuclex::OpusTranscoder::Audio::ClippingHalfwaveTable &halfwaves,
+    std::size_t &index,
+    const Nuclex::OpusTranscoder::Audio::ClippingHalfwave &clippingHalfwave
   ) {
-    return first.PriorZeroCrossingIndex < second.PriorZeroCrossingIndex;
+    std::size_t count = halfwaves.size();
+    while(index < count) {
+      if(clippingHalfwave.PriorZeroCrossingIndex < halfwaves.GetNextZeroCrossingIndex(index)) {
+        break;
+      }
+      ++index;
+    }
   }
 
   // ------------------------------------------------------------------------------------------- //
 
-  /// <summary>Inserts a clipping halfwave into a list preserving its ordering</summary>
-  /// <param name="halfwaves">Existing list of half-waves</param>
-  /// <param name="halfwaveToInsert">Half-wave that wil be inserted int othe list</param>
-  void insertOrdered(
-    std::vector<Nuclex::OpusTranscoder::Audio::ClippingHalfwave> &halfwaves,
-    const Nuclex::OpusTranscoder::Audio::ClippingHalfwave &halfwaveToInsert
+  /// <summary>Number of frames the clipping scan checks for clipping samples at once</summary>
+  /// <remarks>
+  ///   Blocks are checked across all channels in one go, so the actual number of samples
+  ///   tested per block is this times the channel count. 512 frames of 7.1 audio are 16 KiB,
+  ///   which comfortably stays in the L1 cache for the exact scan of dirty blocks.
+  /// </remarks>
+  const std::size_t ScanBlockFrameCount = 512;
+
+  /// <summary>Number of frames after which progress is reported to the caller</summary>
+  /// <remarks>
+  ///   That's roughly every 0.25 seconds of audio data being processed, or 14400
+  ///   progress updates per hour of data. Must be a multiple of the scan block size.
+  /// </remarks>
+  const std::size_t ProgressReportFrameCount = ScanBlockFrameCount * 24;
+
+  /// <summary>Number of half-waves after which an update reports its progress</summary>
+  /// <remarks>
+  ///   Re-measuring a half-wave only touches its own samples, so this is far cheaper per
+  ///   step than the frame-wise scan. Heavily clipped tracks have hundreds of thousands
+  ///   of half-waves per channel, so this still yields plenty of progress updates.
+  /// </remarks>
+  const std::size_t ProgressReportHalfwaveCount = 256;
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Checks whether any of the specified samples exceeds the ±1.0 ceiling</summary>
+  /// <param name="samples">Samples that will be checked for clipping</param>
+  /// <param name="sampleCount">Number of samples that will be checked</param>
+  /// <returns>True if at least one of the samples is clipping</returns>
+  bool containsClippingSamples(const float *samples, std::size_t sampleCount) {
+    const float *end = samples + sampleCount;
+
+#if defined(NUCLEX_OPUSTRANSCODER_HAVE_AVX2)
+    {
+      const __m256 absoluteMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7FFFFFFF));
+      const __m256 ceiling = _mm256_set1_ps(1.0f);
+
+      __m256 clipping = _mm256_setzero_ps();
+      while(samples + 16 <= end) {
+        __m256 first = _mm256_and_ps(_mm256_loadu_ps(samples), absoluteMask);
+        __m256 second = _mm256_and_ps(_mm256_loadu_ps(samples + 8), absoluteMask);
+        clipping = _mm256_or_ps(clipping, _mm256_cmp_ps(first, ceiling, _CMP_GT_OQ));
+        clipping = _mm256_or_ps(clipping, _mm256_cmp_ps(second, ceiling, _CMP_GT_OQ));
+        samples += 16;
+      }
+      if(_mm256_movemask_ps(clipping) != 0) {
+        return true;
+      }
+    }
+#elif defined(NUCLEX_OPUSTRANSCODER_HAVE_SSE2)
+    {
+      const __m128 absoluteMask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+      const __m128 ceiling = _mm_set1_ps(1.0f);
+
+      __m128 clipping = _mm_setzero_ps();
+      while(samples + 8 <= end) {
+        __m128 first = _mm_and_ps(_mm_loadu_ps(samples), absoluteMask);
+        __m128 second = _mm_and_ps(_mm_loadu_ps(samples + 4), absoluteMask);
+        clipping = _mm_or_ps(clipping, _mm_cmpgt_ps(first, ceiling));
+        clipping = _mm_or_ps(clipping, _mm_cmpgt_ps(second, ceiling));
+        samples += 8;
+      }
+      if(_mm_movemask_ps(clipping) != 0) {
+        return true;
+      }
+    }
+#elif defined(NUCLEX_OPUSTRANSCODER_HAVE_NEON)
+    {
+      const float32x4_t ceiling = vdupq_n_f32(1.0f);
+
+      uint32x4_t clipping = vdupq_n_u32(0);
+      while(samples + 8 <= end) {
+        float32x4_t first = vabsq_f32(vld1q_f32(samples));
+        float32x4_t second = vabsq_f32(vld1q_f32(samples + 4));
+        clipping = vorrq_u32(clipping, vcgtq_f32(first, ceiling));
+        clipping = vorrq_u32(clipping, vcgtq_f32(second, ceiling));
+        samples += 8;
+      }
+      uint32x2_t folded = vorr_u32(vget_low_u32(clipping), vget_high_u32(clipping));
+      if((vget_lane_u32(folded, 0) | vget_lane_u32(folded, 1)) != 0) {
+        return true;
+      }
+    }
+#endif
+
+    // Whatever didn't fill a whole vector (or everything if no vector instructions
+    // are available) gets checked the plain way
+    while(samples < end) {
+      if(1.0f < std::abs(*samples)) {
+        return true;
+      }
+      ++samples;
+    }
+
+    return false;
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Determines the extents and peak of the half-wave around a clipping sample</summary>
+  /// <param name="track">Track containing the clipping sample</param>
+  /// <param name="channelIndex">Index of the channel the clipping sample is in</param>
+  /// <param name="sampleIndex">Index of the clipping sample</param>
+  /// <returns>The clipping half-wave the sample is a part of</returns>
+  /// <remarks>
+  ///   This reproduces what a sample-by-sample scan from the beginning of the channel
+  ///   would have recorded, including the signed peak taken from the very first sample.
+  /// </remarks>
+  Nuclex::OpusTranscoder::Audio::ClippingHalfwave measureClippingHalfwave(
+    const Nuclex::OpusTranscoder::Audio::Track &track,
+    std::size_t channelIndex,
+    std::size_t sampleIndex
   ) {
-    std::vector<Nuclex::OpusTranscoder::Audio::ClippingHalfwave>::iterator insertionIt = (
-      std::lower_bound(
-        halfwaves.begin(), halfwaves.end(),
-        halfwaveToInsert,
-        &halfwaveStartIndexIsLess
-      )
+    std::size_t frameCount = static_cast<std::size_t>(track.CountFrames());
+    std::size_t sampleStride = track.GetSampleStride();
+    const float *channelSamples = track.GetChannelSamples(channelIndex);
+
+    bool isBelowZero = (channelSamples[sampleIndex * sampleStride] < 0.0f);
+
+    // Walk back to the sample directly after the previous zero crossing
+    std::size_t priorZeroCrossingIndex = sampleIndex;
+    while(0 < priorZeroCrossingIndex) {
+      bool priorIsBelowZero = (
+        channelSamples[(priorZeroCrossingIndex - 1) * sampleStride] < 0.0f
+      );
+      if(priorIsBelowZero != isBelowZero) {
+        break;
+      }
+      --priorZeroCrossingIndex;
+    }
+
+    // The sequential scan seeds its peak with the very first sample of the channel,
+    // sign and all, and only resets it to zero after recording a clipping half-wave.
+    float clippingPeak = 0.0f;
+    std::size_t clippingPeakIndex = priorZeroCrossingIndex;
+    std::size_t index = priorZeroCrossingIndex;
+    if(index == 0) {
+      clippingPeak = channelSamples[0];
+      ++index;
+    }
+
+    // Walk forward to the next zero crossing, picking up the highest clipping sample
+    while(index < frameCount) {
+      float sample = channelSamples[index * sampleStride];
+      if((sample < 0.0f) != isBelowZero) {
+        break;
+      }
+
+      if(1.0f < std::abs(sample)) {
+        if(clippingPeak < std::abs(sample)) {
+          clippingPeak = std::abs(sample);
+          clippingPeakIndex = index;
+        }
+      }
+
+      ++index;
+    }
+
+    return Nuclex::OpusTranscoder::Audio::ClippingHalfwave(
+      priorZeroCrossingIndex, clippingPeakIndex, index, clippingPeak
     );
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Records all clipping half-waves found in a range of blocks</summary>
+  /// <param name="track">Track that will be scanned for clipping half-waves</param>
+  /// <param name="startIndex">Index of the first frame that will be scanned</param>
+  /// <param name="endIndex">Index one past the last frame that will be scanned</param>
+  /// <param name="halfwaves">Receives the clipping half-waves found in each channel</param>
+  /// <param name="nextUnscannedIndices">
+  ///   Index of the first frame in each channel that isn't covered by a recorded clipping
+  ///   half-wave yet (half-waves can extend far beyond the block they're found in)
+  /// </param>
+  /// <param name="statistics">
+  ///   Statistics covering the track's current samples or null. If provided, the clipping
+  ///   bitmap in the statistics is used to skip blocks instead of looking at the samples.
+  /// </param>
+  void scanBlocksForClipping(
+    const Nuclex::OpusTranscoder::Audio::Track &track,
+    std::size_t startIndex, std::size_t endIndex,
+    std::vector<Nuclex::OpusTranscoder::Audio::ClippingHalfwaveTable> &halfwaves,
+    std::vector<std::size_t> &nextUnscannedIndices,
+    const Nuclex::OpusTranscoder::Audio::TrackStatistics *statistics
+  ) {
+    std::size_t channelCount = track.Channels.size();
+    std::size_t sampleStride = track.GetSampleStride();
+
+    // Clipping is rare enough that nearly all blocks are clean. So we check each block
+    // of samples for all channels at once, skip it entirely if nothing clips and only
+    // look at the individual samples in the few blocks that do.
+    for(
+      std::size_t blockStartIndex = startIndex;
+      blockStartIndex < endIndex;
+      blockStartIndex += ScanBlockFrameCount
+    ) {
+      std::size_t blockEndIndex = std::min(blockStartIndex + ScanBlockFrameCount, endIndex);
+
+      if(statistics != nullptr) {
+        if(likely(!statistics->MayContainClipping(blockStartIndex, blockEndIndex))) {
+          continue;
+        }
+      } else if(track.IsPlanar) {
+        bool blockClips = false;
+        for(std::size_t channelIndex = 0; channelIndex < channelCount; ++channelIndex) {
+          const float *blockSamples = track.GetChannelSamples(channelIndex) + blockStartIndex;
+          if(containsClippingSamples(blockSamples, blockEndIndex - blockStartIndex)) {
+            blockClips = true;
+            break;
+          }
+        }
+        if(likely(!blockClips)) {
+          continue;
+        }
+      } else {
+        const float *blockSamples = track.Samples.data() + (blockStartIndex * channelCount);
+        std::size_t blockSampleCount = (blockEndIndex - blockStartIndex) * channelCount;
+        if(likely(!containsClippingSamples(blockSamples, blockSampleCount))) {
+          continue;
+        }
+      }
+
+      for(std::size_t channelIndex = 0; channelIndex < channelCount; ++channelIndex) {
+        const float *channelSamples = track.GetChannelSamples(channelIndex);
+        std::size_t index = std::max(blockStartIndex, nextUnscannedIndices[channelIndex]);
+        while(index < blockEndIndex) {
+          float sample = channelSamples[index * sampleStride];
+          if(1.0f < std::abs(sample)) {
+            Nuclex::OpusTranscoder::Audio::ClippingHalfwave halfwave = (
+              measureClippingHalfwave(track, channelIndex, index)
+            );
+            halfwaves[channelIndex].push_back(halfwave);
+            index = halfwave.NextZeroCrossingIndex;
+          } else {
+            ++index;
+          }
+        } // while samples in the block remain to be checked
 
-    halfwaves.insert(insertionIt, halfwaveToInsert);
+        nextUnscannedIndices[channelIndex] = std::max(nextUnscannedIndices[channelIndex], index);
+      } // for each channel
+    } // for each block
   }
 
   // ------------------------------------------------------------------------------------------- //
 
-  /// <summary>
-  ///   Looks for an existing clipping half-wave that intersects with the found one
-  /// </summary>
-  /// <param name="halfwaves">Existing half-waves</param>
-  /// <param name="clippingHalfwave">New half-wave to match to an existing one</param>
-  /// <returns>The index of the maching existing half-wave or -1 if none is found</returns>
-  std::size_t findExistingClippingHalfwave(
-    const std::vector<Nuclex::OpusTranscoder::Audio::ClippingHalfwave> &halfwaves,
-    const Nuclex::OpusTranscoder::Audio::ClippingHalfwave &clippingHalfwave
+  /// <summary>Looks for clipping half-waves in a range of frames on a worker thread</summary>
+  /// <param name="track">Track that will be scanned for clipping half-waves</param>
+  /// <param name="startIndex">Index of the first frame that will be scanned</param>
+  /// <param name="endIndex">Index one past the last frame that will be scanned</param>
+  /// <param name="canceler">Token by which the operation can be signalled to cancel</param>
+  /// <param name="scannedFrameCount">Counter that will be advanced while scanning</param>
+  /// <returns>The clipping half-waves found in each channel</returns>
+  /// <remarks>
+  ///   A clipping half-wave that extends into the neighbouring range will be found
+  ///   by the jobs scanning both ranges when it has clipping samples in either.
+  /// </remarks>
+  std::vector<Nuclex::OpusTranscoder::Audio::ClippingHalfwaveTable> findClippingHalfwavesInRange(
+    const std::shared_ptr<Nuclex::OpusTranscoder::Audio::Track> &track,
+    std::size_t startIndex, std::size_t endIndex,
+    const std::shared_ptr<const Nuclex::Support::Threading::StopToken> &canceler,
+    std::atomic<std::uint64_t> &scannedFrameCount
   ) {
+    std::size_t channelCount = track->Channels.size();
 
-    // We assume that touching means it's the same half-wave.
-    //
-    // If an audio codec completely reinvented the waveform, we'd risk associating
-    // a half-wave that isn't directly related to a newly discovered clipping peak
-    // and wildly scaling that one around without effect.
-    //
-    // So far, Opus seems to have a high correlation between input waveform and
-    // output waveform, as it should be.
-    //
-    std::size_t count = halfwaves.size();
-    for(std::size_t index = 0; index < count; ++index) {
-      bool beginsInside = (
-        (clippingHalfwave.PriorZeroCrossingIndex >= halfwaves[index].PriorZeroCrossingIndex) &&
-        (clippingHalfwave.PriorZeroCrossingIndex < halfwaves[index].NextZeroCrossingIndex)
-      );
-      bool endsInside = (
-        (halfwaves[index].NextZeroCrossingIndex >= clippingHalfwave.NextZeroCrossingIndex) &&
-        (halfwaves[index].PriorZeroCrossingIndex < clippingHalfwave.NextZeroCrossingIndex)
-      );
-      bool envelops = (
-        (clippingHalfwave.PriorZeroCrossingIndex < halfwaves[index].PriorZeroCrossingIndex) &&
-        (clippingHalfwave.NextZeroCrossingIndex >= halfwaves[index].NextZeroCrossingIndex)
+    std::vector<Nuclex::OpusTranscoder::Audio::ClippingHalfwaveTable> halfwaves(channelCount);
+    std::vector<std::size_t> nextUnscannedIndices(channelCount, startIndex);
+
+    const Nuclex::OpusTranscoder::Audio::TrackStatistics *statistics = nullptr;
+    if(track->Statistics.Covers(channelCount, track->CountFrames())) {
+      statistics = &track->Statistics;
+    }
+
+    while(startIndex < endIndex) {
+      std::size_t stepEndIndex = std::min(startIndex + ProgressReportFrameCount, endIndex);
+      scanBlocksForClipping(
+        *track, startIndex, stepEndIndex, halfwaves, nextUnscannedIndices, statistics
       );
-      if(beginsInside || endsInside || envelops) {
-        return index;
-      }
+
+      canceler->ThrowIfCanceled();
+      scannedFrameCount.fetch_add(stepEndIndex - startIndex, std::memory_order_relaxed);
+
+      startIndex = stepEndIndex;
     }
 
-    // If this point is reached, none of the existing half-waves intersected.
-    return InvalidIndex;
+    return halfwaves;
+  }
+
+  // ------------------------------------------------------------------------------------------- //
 
+  /// <summary>Counts the clipping half-waves recorded in all channels of a track</summary>
+  /// <param name="track">Track whose clipping half-waves will be counted</param>
+  /// <returns>The total number of clipping half-waves in the track</returns>
+  std::uint64_t countHalfwaves(const Nuclex::OpusTranscoder::Audio::Track &track) {
+    std::uint64_t halfwaveCount = 0;
+    for(std::size_t channelIndex = 0; channelIndex < track.Channels.size(); ++channelIndex) {
+      halfwaveCount += track.Channels[channelIndex].ClippingHalfwaves.size();
+    }
+    return halfwaveCount;
   }
 
   // ------------------------------------------------------------------------------------------- //
 
-  Nuclex::OpusTranscoder::Audio::ClippingHalfwave getHalfwaveAroundSample(
-    const std::shared_ptr<Nuclex::OpusTranscoder::Audio::Track> &sourceTrack,
+  /// <summary>Re-measures the clipping half-waves in one channel</summary>
+  /// <param name="track">Track in which the half-waves of a channel will be updated</param>
+  /// <param name="samples">Sample array that will be scanned</param>
+  /// <param name="channelIndex">Index of the channel whose half-waves will be updated</param>
+  /// <param name="canceler">Token by which the operation can be signalled to cancel</param>
+  /// <param name="updatedHalfwaveCount">Counter that will be advanced while updating</param>
+  /// <returns>The number of half-ways in the channel that are still clipping</returns>
+  std::size_t updateClippingHalfwavesInChannel(
+    const std::shared_ptr<Nuclex::OpusTranscoder::Audio::Track> &track,
+    const Nuclex::OpusTranscoder::Audio::SampleBuffer &samples,
     std::size_t channelIndex,
-    std::uint64_t sampleIndex
+    const std::shared_ptr<const Nuclex::Support::Threading::StopToken> &canceler,
+    std::atomic<std::uint64_t> &updatedHalfwaveCount
   ) {
-    std::size_t channelCount = sourceTrack->Channels.size();
+    using Nuclex::OpusTranscoder::Audio::ClippingHalfwaveTable;
 
-    const float *forwardRead = sourceTrack->SampleAt(channelIndex, sampleIndex);
+    std::size_t channelCount = track->Channels.size();
+    ClippingHalfwaveTable &clippingHalfwaves = track->Channels[channelIndex].ClippingHalfwaves;
 
-    bool startsAboveZero = (forwardRead[0] >= 0.0f);
+    std::size_t clippingPeakCount = 0;
 
-    // Figure out the earliest sample that is still on the same side of the zero line
-    // as the sample from which the search started. As per usual conventions, The start index
-    // is inclusive, so it points at the same that is already on the same side.
-    std::uint64_t priorCrossingIndex = sampleIndex;
-    {
-      const float *backwardRead = forwardRead;
-      while(0 < priorCrossingIndex) {
-        backwardRead -= channelCount; // Step back to before index counter
-        bool priorIsAboveZero = (backwardRead[0] >= 0.0f); // Preceding sample!
+    std::size_t clippingHalfwaveCount = clippingHalfwaves.size();
+    for(std::size_t clipIndex = 0; clipIndex < clippingHalfwaveCount; ++clipIndex) {
+      std::uint64_t startIndex = clippingHalfwaves.GetPriorZeroCrossingIndex(clipIndex);
+      std::uint64_t endIndex = clippingHalfwaves.GetNextZeroCrossingIndex(clipIndex);
+
+      // Re-scan the samples in this half-wave and determine their current
+      // peak amplitude and the index of the peak amplitude sample.
+      float peak = 0.0f;
+      std::size_t peakIndex = startIndex;
+      {
+        const float *halfwaveSamples = (
+          samples.data() + (startIndex * channelCount) + channelIndex
+        );
+        for(std::uint64_t sampleIndex = startIndex; sampleIndex < endIndex; ++sampleIndex) {
+          if(peak < std::abs(halfwaveSamples[0])) {
+            peak = std::abs(halfwaveSamples[0]);
+            peakIndex = sampleIndex;
+          }
+          halfwaveSamples += channelCount;
+        } // for each sample in a clipping halfwave
+      } // beauty scope to determine peak and peak index
+
+      // Now we know the new peak, update the recorded peak in the half-wave with it.
+      // At this point, we also count up the 'IneffectiveIterationCount' for any
+      // peaks that remain unchanged compared to the previous iteration to allow us
+      // to give up on those that we can't get moving.
+      //clippingHalfwaves[clipIndex].PeakIndex = peakIndex;
+      if(peak != clippingHalfwaves.GetPeakAmplitude(clipIndex)) {
+        clippingHalfwaves.ResetIneffectiveIterationCount(clipIndex);
+        clippingHalfwaves.SetPeakAmplitude(clipIndex, peak);
+      } else {
+        clippingHalfwaves.IncrementIneffectiveIterationCount(clipIndex);
+      }
 
-        if(priorIsAboveZero != startsAboveZero) {
-          break;
+      // Count the total number of half-waves that are still clipping. This count is
+      // also the exit condition in the rectifying loop, so if a half-wave has not
+      // improved after 10 (increasingly drastic) attempts, don't count it anymore,
+      // as it is now considered a lost cause.
+      if(1.0f < peak) {
+        if(clippingHalfwaves.GetIneffectiveIterationCount(clipIndex) < 10) {
+          ++clippingPeakCount;
         }
+      }
 
-        // Adjust index *after* checking sample, so when loop breaks,
-        // the index is still on sample that starts the half-wave
-        --priorCrossingIndex;
+      if((clipIndex + 1) % ProgressReportHalfwaveCount == 0) {
+        canceler->ThrowIfCanceled();
+        updatedHalfwaveCount.fetch_add(ProgressReportHalfwaveCount, std::memory_order_relaxed);
       }
-    }
+    } // for each clipping halfwave
 
-    // Now scan forward until the next zero crossing. The end index is exclusive, so we want
-    // the end index to be of the first sample that has crossed the zero line. We also do
-    // an immediate step forward because we expect the start sample to be a valid index.
-    std::uint64_t nextCrossingIndex = sampleIndex;
-    {
-      // We don't need to re-check the starting sample (and want the end to be at least
-      // on starting sample + 1), so skip over it.
-      forwardRead += channelCount;
-      ++nextCrossingIndex;
+    updatedHalfwaveCount.fetch_add(
+      clippingHalfwaveCount % ProgressReportHalfwaveCount, std::memory_order_relaxed
+    );
 
-      std::uint64_t endIndex = sourceTrack->Samples.size();
-      while(nextCrossingIndex < endIndex) {
-        bool isAboveZero = (forwardRead[0] >= 0.0f);
+    return clippingPeakCount;
+  }
 
-        if(isAboveZero != startsAboveZero) {
-          break;
-        }
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Finds the zero crossings before and after a sample</summary>
+  /// <typeparam name="TSampleReader">Functor that returns the sample at an index</typeparam>
+  /// <param name="readSample">Provides the samples of the channel being searched</param>
+  /// <param name="sampleIndex">Index of the sample the search starts at</param>
+  /// <param name="endIndex">Index one past the last sample in the channel</param>
+  /// <param name="priorCrossingIndex">Receives the index of the half-wave's first sample</param>
+  /// <param name="nextCrossingIndex">Receives the index one past the half-wave's end</param>
+  template<typename TSampleReader>
+  void findZeroCrossingsAround(
+    const TSampleReader &readSample, std::uint64_t sampleIndex, std::uint64_t endIndex,
+    std::uint64_t &priorCrossingIndex, std::uint64_t &nextCrossingIndex
+  ) {
+    bool startsAboveZero = (readSample(sampleIndex) >= 0.0f);
 
-        // In this direction, we advance both index and read pointer at the same time
-        // because we want the index return to be one past the last sample that is
-        // within the half-wave.
-        ++nextCrossingIndex;
-        forwardRead += channelCount;
+    // Figure out the earliest sample that is still on the same side of the zero line
+    // as the sample from which the search started. As per usual conventions, The start index
+    // is inclusive, so it points at the same that is already on the same side.
+    priorCrossingIndex = sampleIndex;
+    while(0 < priorCrossingIndex) {
+      bool priorIsAboveZero = (readSample(priorCrossingIndex - 1) >= 0.0f); // Preceding sample!
+      if(priorIsAboveZero != startsAboveZero) {
+        break;
       }
+
+      // Adjust index *after* checking sample, so when loop breaks,
+      // the index is still on sample that starts the half-wave
+      --priorCrossingIndex;
     }
 
-    // Obviously, the sampleIndex will likely not be the peak and we leave the peak
-    // at 0.0 because the actual peak is unknown to us (it is in the other, decoded
-    // sample array). So an Update() call is needed to fix that, too.
-    return Nuclex::OpusTranscoder::Audio::ClippingHalfwave(
-      priorCrossingIndex, sampleIndex, nextCrossingIndex, 0.0f
-    );
+    // Now scan forward until the next zero crossing. The end index is exclusive, so we want
+    // the end index to be of the first sample that has crossed the zero line. We don't need
+    // to re-check the starting sample (and want the end to be at least on starting
+    // sample + 1), so skip over it.
+    nextCrossingIndex = sampleIndex + 1;
+    while(nextCrossingIndex < endIndex) {
+      bool isAboveZero = (readSample(nextCrossingIndex) >= 0.0f);
+      if(isAboveZero != startsAboveZero) {
+        break;
+      }
+
+      ++nextCrossingIndex;
+    }
   }
 
   // ------------------------------------------------------------------------------------------- //
@@ -192,87 +543,109 @@ namespace Nuclex::OpusTranscoder::Audio {
     const std::shared_ptr<const Nuclex::Support::Threading::StopToken> &canceler,
     Nuclex::Support::Events::Delegate<void(float)> &progressCallback
   ) {
+    track->AdviseAccessPattern(SampleAccessPattern::Sequential); // one pass front to back
+
     std::size_t channelCount = track->Channels.size();
-    std::size_t frameCount = track->Samples.size() / channelCount;
+    std::size_t frameCount = static_cast<std::size_t>(track->CountFrames());
 
-    // We'll process each channel separately, otherwise keeping track of the start and
-    // end indices of each clipping half-wave becomes just to complicated...
+    std::vector<ClippingHalfwaveTable> halfwaves(channelCount);
+    std::vector<std::size_t> nextUnscannedIndices(channelCount, 0);
+
+    // If the statistics still describe the samples, their clipping bitmap tells us
+    // which blocks need a closer look without having to go through all the samples
+    const TrackStatistics *statistics = nullptr;
+    if(track->Statistics.Covers(channelCount, frameCount)) {
+      statistics = &track->Statistics;
+    }
+
+    for(
+      std::size_t startIndex = 0;
+      startIndex < frameCount;
+      startIndex += ProgressReportFrameCount
+    ) {
+      std::size_t endIndex = std::min(startIndex + ProgressReportFrameCount, frameCount);
+      scanBlocksForClipping(
+        *track, startIndex, endIndex, halfwaves, nextUnscannedIndices, statistics
+      );
+
+      canceler->ThrowIfCanceled();
+      progressCallback(static_cast<float>(endIndex) / static_cast<float>(frameCount));
+    }
+
+    // This replaces any clipping instances from previous runs of this method
     for(std::size_t channelIndex = 0; channelIndex < channelCount; ++channelIndex) {
-      Channel &channel = track->Channels[channelIndex];
-      const float *read = track->Samples.data() + channelIndex;
-
-      // In case this method is run repeatedly, clear the previous clipping instances
-      channel.ClippingHalfwaves.clear();
-
-      float clippingPeak = *read;
-      std::size_t clippingPeakIndex = 0;
-      std::size_t wasClipping = (1.0f < std::abs(clippingPeak));
-
-      bool wasBelowZero = (clippingPeak < 0.0f);
-      std::size_t zeroCrossingIndex = 0;
-
-      read += channelCount;
-
-      // Now look for clipping samples. We'll keep track of when the signal crossed
-      // over the zero line so that we can identify the half wave in which clipping
-      // is occurring (our partner class will scale the whole half-wave down then)
-      for(std::size_t index = 1; index < frameCount; ++index) {
-        float sample = *read;
-
-        // Check if this sample is on the other side of the zero line. If so,
-        // either just update the indices or, if the previous half-wave had one or
-        // more clipping samples, record the clipping half-wave in the list.
-        bool isBelowZero = (sample < 0.0f);
-        if(wasBelowZero != isBelowZero) {
-          if(wasClipping) {
-            channel.ClippingHalfwaves.emplace_back(
-              zeroCrossingIndex, clippingPeakIndex, index, clippingPeak
-            );
+      track->Channels[channelIndex].ClippingHalfwaves.Swap(halfwaves[channelIndex]);
+    }
+  }
 
-            wasClipping = false;
-            clippingPeak = 0.0f;
-          }
+  // ------------------------------------------------------------------------------------------- //
 
-          zeroCrossingIndex = index;
-          wasBelowZero = isBelowZero;
-        } // is current sample cross zero line
-
-        // Check if the current sample is clipping. If so, update the maximum amplitude and
-        // flip the flag so that we know to record this half-wave at the next zero crossing.
-        bool isClipping = (1.0f < std::abs(sample));
-        if(isClipping) {
-          wasClipping = true;
-          if(clippingPeak < std::abs(sample)) {
-            clippingPeak = std::abs(sample);
-            clippingPeakIndex = index;
-          }
-        } // if current sample is clipping
-
-        // Give a progress update all 12287 samples. That's roughly every 0.25 seconds
-        // of audio data being processed, or 14400 progress updates per hour of data.
-        if((index & 0x2fff) == 0) {
-          canceler->ThrowIfCanceled();
-          progressCallback(
-            (static_cast<float>(channelIndex) / static_cast<float>(channelCount)) +
-            (
-              static_cast<float>(index) /
-              static_cast<float>(frameCount) /
-              static_cast<float>(channelCount)
-            )
-          );
-        } // if progress report interval hit
+  void ClippingDetector::FindClippingHalfwaves(
+    const std::shared_ptr<Track> &track,
+    Nuclex::Support::Threading::ThreadPool &threadPool,
+    const std::shared_ptr<const Nuclex::Support::Threading::StopToken> &canceler,
+    Nuclex::Support::Events::Delegate<void(float)> &progressCallback
+  ) {
+    track->AdviseAccessPattern(SampleAccessPattern::Sequential); // each job scans forward
 
-        read += channelCount;
-      } // for each sample in the channel
+    std::size_t channelCount = track->Channels.size();
+    std::size_t frameCount = static_cast<std::size_t>(track->CountFrames());
 
-      // If the clipping flag is still set after reaching the end of the channel,
-      // record the ongoing half-wave up to the final sample as a clipping half-wave.
-      if(wasClipping) {
-        channel.ClippingHalfwaves.emplace_back(
-          zeroCrossingIndex, clippingPeakIndex, frameCount, clippingPeak
+    // Split the track into ranges of frames (rather than channels, which would give
+    // us seven jobs at most and have every job read through all the interleaved samples)
+    std::vector<std::size_t> boundaries = WorkPartitioner::SplitFrameRange(
+      frameCount, ScanBlockFrameCount
+    );
+    std::size_t rangeCount = boundaries.size() - 1;
+
+    std::atomic<std::uint64_t> scannedFrameCount(0);
+    std::vector<std::future<std::vector<ClippingHalfwaveTable>>> futures;
+    futures.reserve(rangeCount);
+    try {
+      for(std::size_t rangeIndex = 0; rangeIndex < rangeCount; ++rangeIndex) {
+        futures.push_back(
+          threadPool.Schedule(
+            &findClippingHalfwavesInRange,
+            track, boundaries[rangeIndex], boundaries[rangeIndex + 1],
+            canceler, std::ref(scannedFrameCount)
+          )
         );
       }
-    } // for each channel
+    }
+    catch(const std::exception &) {
+      WorkPartitioner::WaitForAll(futures); // they reference our counter
+      throw;
+    }
+
+    WorkPartitioner::WaitForAll(futures, scannedFrameCount, frameCount, progressCallback);
+
+    // Join the half-waves from all ranges. A half-wave crossing a range boundary may have
+    // been found on both sides, but it will have been measured identically each time.
+    std::vector<ClippingHalfwaveTable> halfwaves(channelCount);
+    std::vector<std::uint64_t> channelEndIndices(channelCount, 0);
+    for(std::size_t rangeIndex = 0; rangeIndex < rangeCount; ++rangeIndex) {
+      std::vector<ClippingHalfwaveTable> rangeHalfwaves = futures[rangeIndex].get();
+      for(std::size_t channelIndex = 0; channelIndex < channelCount; ++channelIndex) {
+        const ClippingHalfwaveTable &channelHalfwaves = rangeHalfwaves[channelIndex];
+
+        std::size_t halfwaveCount = channelHalfwaves.size();
+        for(std::size_t index = 0; index < halfwaveCount; ++index) {
+          bool isDuplicate = (
+            channelHalfwaves.GetPriorZeroCrossingIndex(index) < channelEndIndices[channelIndex]
+          );
+          if(!isDuplicate) {
+            halfwaves[channelIndex].push_back(channelHalfwaves[index]);
+            channelEndIndices[channelIndex] = channelHalfwaves.GetNextZeroCrossingIndex(index);
+          }
+        }
+      } // for each channel
+    } // for each range
+
+    for(std::size_t channelIndex = 0; channelIndex < channelCount; ++channelIndex) {
+      track->Channels[channelIndex].ClippingHalfwaves.Swap(halfwaves[channelIndex]);
+    }
+
+    progressCallback(1.0f);
   }
 
   // ------------------------------------------------------------------------------------------- //
@@ -286,33 +659,92 @@ namespace Nuclex::OpusTranscoder::Audio {
 
     // Process the clipping half-waves for each channel
     for(std::size_t channelIndex = 0; channelIndex < channelCount; ++channelIndex) {
-      std::vector<ClippingHalfwave> decodedClippingHalfwaves = (
+      const ClippingHalfwaveTable &decodedClippingHalfwaves = (
         decodedTrack->Channels[channelIndex].ClippingHalfwaves
       );
-      std::size_t decodedClippingHalfwaveCount = decodedClippingHalfwaves.size();
+      ClippingHalfwaveTable &existingClippingHalfwaves = (
+        sourceTrack->Channels[channelIndex].ClippingHalfwaves
+      );
+
+      // Both lists are ordered, so we can walk through them side by side. Half-waves that
+      // are newly discovered go into a separate list (which is ordered, too, because
+      // the decoded half-waves are) and get merged with the existing ones at the end.
+      ClippingHalfwaveTable newClippingHalfwaves;
+      std::size_t existingIndex = 0;
+      std::size_t newIndex = 0;
 
       // Check each clipping instance in the decodedTrack
+      std::size_t decodedClippingHalfwaveCount = decodedClippingHalfwaves.size();
       for(std::size_t index = 0; index < decodedClippingHalfwaveCount; ++index) {
+        ClippingHalfwave decodedClippingHalfwave = decodedClippingHalfwaves[index];
 
-        std::size_t existingIndex = findExistingClippingHalfwave(
-          sourceTrack->Channels[channelIndex].ClippingHalfwaves,
-          decodedClippingHalfwaves[index]
+        skipHalfwavesEndingBefore(
+          existingClippingHalfwaves, existingIndex, decodedClippingHalfwave
         );
-        if(existingIndex == InvalidIndex) {
-          insertOrdered(
-            sourceTrack->Channels[channelIndex].ClippingHalfwaves,
-            getHalfwaveAroundSample(
-              sourceTrack, channelIndex, decodedClippingHalfwaves[index].PeakIndex
-            )
+        skipHalfwavesEndingBefore(newClippingHalfwaves, newIndex, decodedClippingHalfwave);
+
+        // If both lists have an intersecting half-wave, take the earlier one,
+        // which is the one that would come first if the lists were already merged.
+        bool matchesExisting = (
+          (existingIndex < existingClippingHalfwaves.size()) &&
+          halfwavesIntersect(existingClippingHalfwaves[existingIndex], decodedClippingHalfwave)
+        );
+        bool matchesNew = (
+          (newIndex < newClippingHalfwaves.size()) &&
+          halfwavesIntersect(newClippingHalfwaves[newIndex], decodedClippingHalfwave)
+        );
+        if(matchesExisting && matchesNew) {
+          matchesExisting = (
+            existingClippingHalfwaves.GetPriorZeroCrossingIndex(existingIndex) <
+            newClippingHalfwaves.GetPriorZeroCrossingIndex(newIndex)
           );
+          matchesNew = !matchesExisting;
+        }
+
+        if(matchesExisting) {
+          existingClippingHalfwaves.SetPeakAmplitude(
+            existingIndex, decodedClippingHalfwave.PeakAmplitude
+          );
+        } else if(matchesNew) {
+          newClippingHalfwaves.SetPeakAmplitude(newIndex, decodedClippingHalfwave.PeakAmplitude);
         } else {
-          ClippingHalfwave &existingClippingHalfwave = (
-            sourceTrack->Channels[channelIndex].ClippingHalfwaves[existingIndex]
+          newClippingHalfwaves.push_back(
+            GetHalfwaveAroundSample(sourceTrack, channelIndex, decodedClippingHalfwave.PeakIndex)
           );
-          existingClippingHalfwave.PeakAmplitude = decodedClippingHalfwaves[index].PeakAmplitude;
         }
-      }
+      } // for each decoded clipping half-wave
+
+      // Merge the newly discovered half-waves into the existing ones in one go. The new ones
+      // are taken first so they end up in front of any existing ones with the same start.
+      if(!newClippingHalfwaves.empty()) {
+        std::size_t existingCount = existingClippingHalfwaves.size();
+        std::size_t newCount = newClippingHalfwaves.size();
+
+        ClippingHalfwaveTable mergedClippingHalfwaves;
+        mergedClippingHalfwaves.reserve(existingCount + newCount);
+
+        existingIndex = 0;
+        newIndex = 0;
+        while((existingIndex < existingCount) || (newIndex < newCount)) {
+          bool takeNew = (
+            (existingIndex >= existingCount) || (
+              (newIndex < newCount) && (
+                newClippingHalfwaves.GetPriorZeroCrossingIndex(newIndex) <=
+                existingClippingHalfwaves.GetPriorZeroCrossingIndex(existingIndex)
+              )
+            )
+          );
+          if(takeNew) {
+            mergedClippingHalfwaves.push_back(newClippingHalfwaves[newIndex]);
+            ++newIndex;
+          } else {
+            mergedClippingHalfwaves.push_back(existingClippingHalfwaves[existingIndex]);
+            ++existingIndex;
+          }
+        }
 
+        existingClippingHalfwaves.Swap(mergedClippingHalfwaves);
+      }
     } // for each channel
   }
 
@@ -320,82 +752,132 @@ namespace Nuclex::OpusTranscoder::Audio {
 
   std::size_t ClippingDetector::Update(
     const std::shared_ptr<Track> &track,
-    const std::vector<float> &samples,
+    const SampleBuffer &samples,
     const std::shared_ptr<const Nuclex::Support::Threading::StopToken> &canceler,
     Nuclex::Support::Events::Delegate<void(float)> &progressCallback
   ) {
-    assert(samples.size() == track->Samples.size());
+    assert(samples.size() == track->CountFrames() * track->Channels.size());
 
     std::size_t clippingPeakCount = 0;
 
+    std::size_t channelCount = track->Channels.size();
+    std::uint64_t totalHalfwaveCount = countHalfwaves(*track);
+    std::atomic<std::uint64_t> updatedHalfwaveCount(0);
+
     // We'll process each channel separately, otherwise keeping track of the start and
     // end indices of each clipping half-wave becomes just to complicated...
-    std::size_t channelCount = track->Channels.size();
     for(std::size_t channelIndex = 0; channelIndex < channelCount; ++channelIndex) {
-      std::vector<ClippingHalfwave> &clippingHalfwaves = (
-        track->Channels[channelIndex].ClippingHalfwaves
+      clippingPeakCount += updateClippingHalfwavesInChannel(
+        track, samples, channelIndex, canceler, updatedHalfwaveCount
       );
+      if(totalHalfwaveCount > 0) {
+        progressCallback(
+          static_cast<float>(updatedHalfwaveCount.load(std::memory_order_relaxed)) /
+          static_cast<float>(totalHalfwaveCount)
+        );
+      }
+    } // for each channel
 
-      std::size_t clippingHalfwaveCount = clippingHalfwaves.size();
-      for(std::size_t clipIndex = 0; clipIndex < clippingHalfwaveCount; ++clipIndex) {
+    canceler->ThrowIfCanceled();
+    progressCallback(1.0f);
 
-        // Re-scan the samples in this half-wave and determine their current
-        // peak amplitude and the index of the peak amplitude sample.
-        float peak = 0.0f;
-        std::size_t peakIndex = clippingHalfwaves[clipIndex].PriorZeroCrossingIndex;
-        {
-          const float *halfwaveSamples = (
-            samples.data() +
-            (clippingHalfwaves[clipIndex].PriorZeroCrossingIndex * channelCount) +
-            channelIndex
-          );
-          for(
-            std::uint64_t sampleIndex = clippingHalfwaves[clipIndex].PriorZeroCrossingIndex;
-            sampleIndex < clippingHalfwaves[clipIndex].NextZeroCrossingIndex;
-            ++sampleIndex
-          ) {
-            if(peak < std::abs(halfwaveSamples[0])) {
-              peak = std::abs(halfwaveSamples[0]);
-              peakIndex = sampleIndex;
-            }
-            halfwaveSamples += channelCount;
-          } // for each sample in a clipping halfwave
-        } // beauty scope to determine peak and peak index
-
-        // Now we know the new peak, update the recorded peak in the half-wave with it.
-        // At this point, we also count up the 'IneffectiveIterationCount' for any
-        // peaks that remain unchanged compared to the previous iteration to allow us
-        // to give up on those that we can't get moving.
-        //clippingHalfwaves[clipIndex].PeakIndex = peakIndex;
-        if(peak != clippingHalfwaves[clipIndex].PeakAmplitude) {
-          clippingHalfwaves[clipIndex].IneffectiveIterationCount = 0;
-          clippingHalfwaves[clipIndex].PeakAmplitude = peak;
-        } else {
-          ++clippingHalfwaves[clipIndex].IneffectiveIterationCount;
-        }
+    return clippingPeakCount;
+  }
 
-        // Count the total number of half-waves that are still clipping. This count is
-        // also the exit condition in the rectifying loop, so if a half-wave has not
-        // improved after 10 (increasingly drastic) attempts, don't count it anymore,
-        // as it is now considered a lost cause.
-        if(1.0f < peak) {
-          if(clippingHalfwaves[clipIndex].IneffectiveIterationCount < 10) {
-            ++clippingPeakCount;
-          }
-        }
+  // ------------------------------------------------------------------------------------------- //
 
-      } // for each clipping halfwave
-    } // for each channel
+  std::size_t ClippingDetector::Update(
+    const std::shared_ptr<Track> &track,
+    const SampleBuffer &samples,
+    Nuclex::Support::Threading::ThreadPool &threadPool,
+    const std::shared_ptr<const Nuclex::Support::Threading::StopToken> &canceler,
+    Nuclex::Support::Events::Delegate<void(float)> &progressCallback
+  ) {
+    assert(samples.size() == track->CountFrames() * track->Channels.size());
+
+    // Each channel has its own list of half-waves, so the channels can be
+    // updated independently of each other without any synchronization.
+    std::size_t channelCount = track->Channels.size();
+    std::uint64_t totalHalfwaveCount = countHalfwaves(*track);
+
+    std::atomic<std::uint64_t> updatedHalfwaveCount(0);
+    std::vector<std::future<std::size_t>> futures;
+    futures.reserve(channelCount);
+    try {
+      for(std::size_t channelIndex = 0; channelIndex < channelCount; ++channelIndex) {
+        futures.push_back(
+          threadPool.Schedule(
+            &updateClippingHalfwavesInChannel, track, std::cref(samples), channelIndex,
+            canceler, std::ref(updatedHalfwaveCount)
+          )
+        );
+      }
+    }
+    catch(const std::exception &) {
+      WorkPartitioner::WaitForAll(futures); // they reference our counter and samples
+      throw;
+    }
+
+    if(totalHalfwaveCount > 0) {
+      WorkPartitioner::WaitForAll(
+        futures, updatedHalfwaveCount, totalHalfwaveCount, progressCallback
+      );
+    } else {
+      WorkPartitioner::WaitForAll(futures);
+    }
+
+    std::size_t clippingPeakCount = 0;
+    for(std::size_t channelIndex = 0; channelIndex < channelCount; ++channelIndex) {
+      clippingPeakCount += futures[channelIndex].get();
+    }
+
+    canceler->ThrowIfCanceled();
+    progressCallback(1.0f);
 
     return clippingPeakCount;
   }
 
   // ------------------------------------------------------------------------------------------- //
 
+  ClippingHalfwave ClippingDetector::GetHalfwaveAroundSample(
+    const std::shared_ptr<Track> &sourceTrack,
+    std::size_t channelIndex,
+    std::uint64_t sampleIndex
+  ) {
+    std::uint64_t priorCrossingIndex, nextCrossingIndex;
+    if(sourceTrack->IsCompact()) {
+      const CompactSampleStore &samples = sourceTrack->CompactSamples;
+      findZeroCrossingsAround(
+        [&samples, channelIndex](std::uint64_t index) {
+          return samples.GetSample(channelIndex, index);
+        },
+        sampleIndex, sourceTrack->CountFrames(), priorCrossingIndex, nextCrossingIndex
+      );
+    } else {
+      const float *channelSamples = sourceTrack->GetChannelSamples(channelIndex);
+      std::size_t sampleStride = sourceTrack->GetSampleStride();
+      findZeroCrossingsAround(
+        [channelSamples, sampleStride](std::uint64_t index) {
+          return channelSamples[index * sampleStride];
+        },
+        sampleIndex, sourceTrack->CountFrames(), priorCrossingIndex, nextCrossingIndex
+      );
+    }
+
+    // Obviously, the sampleIndex will likely not be the peak and we leave the peak
+    // at 0.0 because the actual peak is unknown to us (it is in the other, decoded
+    // sample array). So an Update() call is needed to fix that, too.
+    return ClippingHalfwave(
+      priorCrossingIndex, sampleIndex, nextCrossingIndex, 0.0f
+    );
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
   void ClippingDetector::DebugVerifyConsistency(const std::shared_ptr<Track> &track) {
     std::size_t channelCount = track->Channels.size();
     for(std::size_t channelIndex = 0; channelIndex < channelCount; ++channelIndex) {
-      std::vector<ClippingHalfwave> &clippingHalfwaves = (
+      const ClippingHalfwaveTable &clippingHalfwaves = (
         track->Channels[channelIndex].ClippingHalfwaves
       );
 
@@ -404,10 +886,10 @@ namespace Nuclex::OpusTranscoder::Audio {
       std::size_t clippingHalfwaveCount = clippingHalfwaves.size();
       for(std::size_t clipIndex = 0; clipIndex < clippingHalfwaveCount; ++clipIndex) {
         assert(
-          (clippingHalfwaves[clipIndex].PriorZeroCrossingIndex >= previousHalfwaveEnd) &&
+          (clippingHalfwaves.GetPriorZeroCrossingIndex(clipIndex) >= previousHalfwaveEnd) &&
           u8"Clipping half-waves must not intersect each other or be duplicated"
         );
-        previousHalfwaveEnd = clippingHalfwaves[clipIndex].NextZeroCrossingIndex;
+        previousHalfwaveEnd = clippingHalfwaves.GetNextZeroCrossingIndex(clipIndex);
       }
     }
   }
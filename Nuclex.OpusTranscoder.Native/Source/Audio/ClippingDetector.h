@@ -28,6 +28,16 @@ limitations under the License.
 
 #include <memory> // for std::shared_ptr
 
+namespace Nuclex::Support::Threading {
+
+  // ------------------------------------------------------------------------------------------- //
+
+  class ThreadPool;
+
+  // ------------------------------------------------------------------------------------------- //
+
+} // namespace Nuclex::Support::Threading
+
 namespace Nuclex::OpusTranscoder::Audio {
 
   // ------------------------------------------------------------------------------------------- //
@@ -46,6 +56,25 @@ namespace Nuclex::OpusTranscoder::Audio {
       Nuclex::Support::Events::Delegate<void(float)> &progressCallback
     );
 
+    /// <summary>
+    ///   Scans all channels in the track and records instances of clipping, splitting
+    ///   the track into ranges that are scanned by the threads of a thread pool
+    /// </summary>
+    /// <param name-"track">Track that will be scanned for clipping half-waves</param>
+    /// <param name="threadPool">Thread pool on which the ranges will be scanned</param>
+    /// <param name="canceler">Token by which the operation can be signalled to cancel</param>
+    /// <param name="progressCallback">Callback to which progress reports should be sent</param>
+    /// <remarks>
+    ///   The recorded half-waves are identical to those found by the single-threaded scan.
+    ///   Progress reports are sent from the calling thread only.
+    /// </remarks>
+    public: static void FindClippingHalfwaves(
+      const std::shared_ptr<Track> &track,
+      Nuclex::Support::Threading::ThreadPool &threadPool,
+      const std::shared_ptr<const Nuclex::Support::Threading::StopToken> &canceler,
+      Nuclex::Support::Events::Delegate<void(float)> &progressCallback
+    );
+
     /// <summary>
     ///   Integrates a new scan into an existing scan, copying the new peaks where existing
     ///   half-waves have been rediscovered and inserting entirely new clipping instances
@@ -69,11 +98,45 @@ namespace Nuclex::OpusTranscoder::Audio {
     /// <returns>The number of half-ways that are still suffering from clipping</returns>
     public: static std::size_t Update(
       const std::shared_ptr<Track> &track,
-      const std::vector<float> &samples,
+      const SampleBuffer &samples,
       const std::shared_ptr<const Nuclex::Support::Threading::StopToken> &canceler,
       Nuclex::Support::Events::Delegate<void(float)> &progressCallback
     );
 
+    /// <summary>
+    ///   Updates the existing clipping half-waves in the track, with each channel
+    ///   being processed by one thread of a thread pool
+    /// </summary>
+    /// <param name-"track">
+    ///   Track in which the existing clipping half-waves will be re-examined
+    /// </param>
+    /// <param name="samples">Sample array that will be scanned</param>
+    /// <param name="threadPool">Thread pool on which the channels will be processed</param>
+    /// <param name="canceler">Token by which the operation can be signalled to cancel</param>
+    /// <param name="progressCallback">Callback to which progress reports should be sent</param>
+    /// <returns>The number of half-ways that are still suffering from clipping</returns>
+    public: static std::size_t Update(
+      const std::shared_ptr<Track> &track,
+      const SampleBuffer &samples,
+      Nuclex::Support::Threading::ThreadPool &threadPool,
+      const std::shared_ptr<const Nuclex::Support::Threading::StopToken> &canceler,
+      Nuclex::Support::Events::Delegate<void(float)> &progressCallback
+    );
+
+    /// <summary>Determines the extents of the half-wave a sample belongs to</summary>
+    /// <param name="sourceTrack">Track in which the half-wave will be looked up</param>
+    /// <param name="channelIndex">Index of the channel the sample is in</param>
+    /// <param name="sampleIndex">Index of the sample around which to look</param>
+    /// <returns>
+    ///   A half-wave reaching from the prior to the next zero crossing, with its peak
+    ///   index set to the sample and its peak amplitude left at zero
+    /// </returns>
+    public: static ClippingHalfwave GetHalfwaveAroundSample(
+      const std::shared_ptr<Track> &sourceTrack,
+      std::size_t channelIndex,
+      std::uint64_t sampleIndex
+    );
+
     /// <summary>Verifies the consistency of a set of clipping half-waves</summary>
     /// <param name="track">Track in which the consistency will be verified</param>
     public: static void DebugVerifyConsistency(
@@ -41,7 +41,9 @@ namespace Nuclex::OpusTranscoder::Audio {
       NextZeroCrossingIndex(endIndex),
       IneffectiveIterationCount(0),
       PeakAmplitude(peakAmplitude),
-      VolumeQuotient(1.0f) {}
+      VolumeQuotient(1.0f),
+      PreviousPeakAmplitude(0.0f),
+      PreviousVolumeQuotient(0.0f) {}
 
     /// <summary>Index of the sample at which the half-wave begins at the zero line</summary>
     public: std::uint64_t PriorZeroCrossingIndex;
@@ -56,6 +58,10 @@ namespace Nuclex::OpusTranscoder::Audio {
     public: float PeakAmplitude;
     /// <summary>Quotient by which the volume was scaled to de-clip the halfwave</summary>
     public: float VolumeQuotient;
+    /// <summary>Peak amplitude measured before the current quotient was chosen</summary>
+    public: float PreviousPeakAmplitude;
+    /// <summary>Volume quotient tried before the current one, zero if there is none</summary>
+    public: float PreviousVolumeQuotient;
 
   };
 
@@ -0,0 +1,221 @@
+#pragma region Apache License 2.0
+/*
+Nuclex Opus Transcoder
+Copyright (C) 2024 Markus Ewald / Nuclex Development Labs
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#pragma endregion // Apache License 2.0
+
+// If the application is compiled as a DLL, this ensures symbols are exported
+#define NUCLEX_OPUSTRANSCODER_SOURCE 1
+
+#include "./ClippingHalfwaveTable.h"
+
+#include <algorithm> // for std::min()
+#include <stdexcept> // for std::runtime_error
+
+namespace {
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Number of frames covered by each block of half-waves</summary>
+  const std::uint64_t FramesPerBlock = std::uint64_t(1) << 32;
+
+  // ------------------------------------------------------------------------------------------- //
+
+} // anonymous namespace
+
+namespace Nuclex::OpusTranscoder::Audio {
+
+  // ------------------------------------------------------------------------------------------- //
+
+  void ClippingHalfwaveTable::clear() {
+    this->blocks.clear();
+    this->startOffsets.clear();
+    this->lengths.clear();
+    this->peakOffsets.clear();
+    this->ineffectiveIterationCounts.clear();
+    this->peakAmplitudes.clear();
+    this->volumeQuotients.clear();
+    this->previousPeakAmplitudes.clear();
+    this->previousVolumeQuotients.clear();
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  void ClippingHalfwaveTable::reserve(std::size_t capacity) {
+    this->startOffsets.reserve(capacity);
+    this->lengths.reserve(capacity);
+    this->peakOffsets.reserve(capacity);
+    this->ineffectiveIterationCounts.reserve(capacity);
+    this->peakAmplitudes.reserve(capacity);
+    this->volumeQuotients.reserve(capacity);
+    this->previousPeakAmplitudes.reserve(capacity);
+    this->previousVolumeQuotients.reserve(capacity);
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  void ClippingHalfwaveTable::push_back(const ClippingHalfwave &halfwave) {
+    assert(
+      (empty() || (GetPriorZeroCrossingIndex(size() - 1) <= halfwave.PriorZeroCrossingIndex)) &&
+      u8"Half-waves are appended in order"
+    );
+    assert(
+      (halfwave.PriorZeroCrossingIndex <= halfwave.PeakIndex) &&
+      (halfwave.PeakIndex <= halfwave.NextZeroCrossingIndex) &&
+      u8"Half-wave peak lies within the half-wave"
+    );
+
+    // A track would need to run for more than a day at 48 kHz without ever crossing
+    // the zero line for this to happen. It's no use continuing in that case.
+    std::uint64_t length = halfwave.NextZeroCrossingIndex - halfwave.PriorZeroCrossingIndex;
+    if(length >= FramesPerBlock) {
+      throw std::runtime_error(u8"Clipping half-wave is too long to be recorded");
+    }
+
+    // Start a new block if this half-wave lies beyond the current one
+    std::uint64_t baseIndex = halfwave.PriorZeroCrossingIndex & ~(FramesPerBlock - 1);
+    if(this->blocks.empty() || (this->blocks.back().BaseIndex != baseIndex)) {
+      this->blocks.push_back(Block { baseIndex, size() });
+    }
+
+    this->startOffsets.push_back(
+      static_cast<std::uint32_t>(halfwave.PriorZeroCrossingIndex - baseIndex)
+    );
+    this->lengths.push_back(static_cast<std::uint32_t>(length));
+    this->peakOffsets.push_back(
+      static_cast<std::uint32_t>(halfwave.PeakIndex - halfwave.PriorZeroCrossingIndex)
+    );
+    this->ineffectiveIterationCounts.push_back(
+      static_cast<std::uint8_t>(std::min<std::size_t>(halfwave.IneffectiveIterationCount, 255))
+    );
+    this->peakAmplitudes.push_back(halfwave.PeakAmplitude);
+    this->volumeQuotients.push_back(halfwave.VolumeQuotient);
+    this->previousPeakAmplitudes.push_back(halfwave.PreviousPeakAmplitude);
+    this->previousVolumeQuotients.push_back(halfwave.PreviousVolumeQuotient);
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  ClippingHalfwave ClippingHalfwaveTable::operator[](std::size_t index) const {
+    std::uint64_t startIndex = getBaseIndex(index) + this->startOffsets[index];
+
+    ClippingHalfwave halfwave(
+      startIndex,
+      startIndex + this->peakOffsets[index],
+      startIndex + this->lengths[index],
+      this->peakAmplitudes[index]
+    );
+    halfwave.IneffectiveIterationCount = this->ineffectiveIterationCounts[index];
+    halfwave.VolumeQuotient = this->volumeQuotients[index];
+    halfwave.PreviousPeakAmplitude = this->previousPeakAmplitudes[index];
+    halfwave.PreviousVolumeQuotient = this->previousVolumeQuotients[index];
+
+    return halfwave;
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  void ClippingHalfwaveTable::Update(std::size_t index, const ClippingHalfwave &halfwave) {
+    assert(
+      (GetPriorZeroCrossingIndex(index) == halfwave.PriorZeroCrossingIndex) &&
+      (GetNextZeroCrossingIndex(index) == halfwave.NextZeroCrossingIndex) &&
+      u8"Extents of the updated half-wave remain unchanged"
+    );
+
+    this->ineffectiveIterationCounts[index] = (
+      static_cast<std::uint8_t>(std::min<std::size_t>(halfwave.IneffectiveIterationCount, 255))
+    );
+    this->peakAmplitudes[index] = halfwave.PeakAmplitude;
+    this->volumeQuotients[index] = halfwave.VolumeQuotient;
+    this->previousPeakAmplitudes[index] = halfwave.PreviousPeakAmplitude;
+    this->previousVolumeQuotients[index] = halfwave.PreviousVolumeQuotient;
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  std::size_t ClippingHalfwaveTable::FindFirstEndingAfter(std::uint64_t frameIndex) const {
+
+    // Half-waves are ordered and don't intersect, so their end indices are ordered, too
+    std::size_t first = 0;
+    std::size_t count = size();
+    while(0 < count) {
+      std::size_t step = count / 2;
+      if(GetNextZeroCrossingIndex(first + step) <= frameIndex) {
+        first += step + 1;
+        count -= step + 1;
+      } else {
+        count = step;
+      }
+    }
+
+    return first;
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  std::size_t ClippingHalfwaveTable::FindFirstStartingFrom(std::uint64_t frameIndex) const {
+    std::size_t first = 0;
+    std::size_t count = size();
+    while(0 < count) {
+      std::size_t step = count / 2;
+      if(GetPriorZeroCrossingIndex(first + step) < frameIndex) {
+        first += step + 1;
+        count -= step + 1;
+      } else {
+        count = step;
+      }
+    }
+
+    return first;
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  void ClippingHalfwaveTable::CopyFrom(const ClippingHalfwaveTable &other) {
+    this->blocks.assign(other.blocks.begin(), other.blocks.end());
+    this->startOffsets.assign(other.startOffsets.begin(), other.startOffsets.end());
+    this->lengths.assign(other.lengths.begin(), other.lengths.end());
+    this->peakOffsets.assign(other.peakOffsets.begin(), other.peakOffsets.end());
+    this->ineffectiveIterationCounts.assign(
+      other.ineffectiveIterationCounts.begin(), other.ineffectiveIterationCounts.end()
+    );
+    this->peakAmplitudes.assign(other.peakAmplitudes.begin(), other.peakAmplitudes.end());
+    this->volumeQuotients.assign(other.volumeQuotients.begin(), other.volumeQuotients.end());
+    this->previousPeakAmplitudes.assign(
+      other.previousPeakAmplitudes.begin(), other.previousPeakAmplitudes.end()
+    );
+    this->previousVolumeQuotients.assign(
+      other.previousVolumeQuotients.begin(), other.previousVolumeQuotients.end()
+    );
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  void ClippingHalfwaveTable::Swap(ClippingHalfwaveTable &other) noexcept {
+    this->blocks.swap(other.blocks);
+    this->startOffsets.swap(other.startOffsets);
+    this->lengths.swap(other.lengths);
+    this->peakOffsets.swap(other.peakOffsets);
+    this->ineffectiveIterationCounts.swap(other.ineffectiveIterationCounts);
+    this->peakAmplitudes.swap(other.peakAmplitudes);
+    this->volumeQuotients.swap(other.volumeQuotients);
+    this->previousPeakAmplitudes.swap(other.previousPeakAmplitudes);
+    this->previousVolumeQuotients.swap(other.previousVolumeQuotients);
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+} // namespace Nuclex::OpusTranscoder::Audio
@@ -0,0 +1,290 @@
+#pragma region Apache License 2.0
+/*
+Nuclex Opus Transcoder
+Copyright (C) 2024 Markus Ewald / Nuclex Development Labs
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#pragma endregion // Apache License 2.0
+
+#ifndef NUCLEX_OPUSTRANSCODER_AUDIO_CLIPPINGHALFWAVETABLE_H
+#define NUCLEX_OPUSTRANSCODER_AUDIO_CLIPPINGHALFWAVETABLE_H
+
+#include "../Config.h"
+#include "./ClippingHalfwave.h"
+
+#include <vector> // for std::vector
+#include <cstdint> // for std::uint64_t, std::uint32_t, std::uint8_t
+#include <cassert> // for assert()
+
+namespace Nuclex::OpusTranscoder::Audio {
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Compact, ordered list of the clipping half-waves in a channel</summary>
+  /// <remarks>
+  ///   <para>
+  ///     Each column is stored in its own array, so passes that only look at some of
+  ///     the values (i.e. the extents of each half-wave) don't drag the others through
+  ///     the cache, too. Frame indices are stored as 32 bit offsets from the base index
+  ///     of the block of 2^32 frames they're in, which needs very little bookkeeping
+  ///     because half-waves can only be appended in order.
+  ///   </para>
+  ///   <para>
+  ///     An entry takes up 29 bytes compared to the 48 of a <see cref="ClippingHalfwave" />.
+  ///     The extents are 12 of those, which is all the scan passes ever read. The peak,
+  ///     quotient and iteration count take another 9, and the last 8 are the previous
+  ///     attempt <see cref="HalfwaveTucker::PredictVolumeQuotient" /> needs. Only the
+  ///     iterative declipper reads those, but they have to follow their half-wave when
+  ///     tables are merged, copied or cached, so they're kept as two more columns
+  ///     rather than in a side table that would need to be kept in step.
+  ///   </para>
+  ///   <para>
+  ///     The method names of the container part mirror those of std::vector, so code
+  ///     walking through the half-waves reads the same as before. The indexing operator
+  ///     returns a copy, though, changes need to go through the setters.
+  ///   </para>
+  /// </remarks>
+  class ClippingHalfwaveTable {
+
+    /// <summary>Initializes a new, empty half-wave table</summary>
+    public: ClippingHalfwaveTable() = default;
+
+    /// <summary>Counts the number of half-waves stored in the table</summary>
+    /// <returns>The number of half-waves in the table</returns>
+    public: std::size_t size() const { return this->startOffsets.size(); }
+
+    /// <summary>Checks whether the table is empty</summary>
+    /// <returns>True if there are no half-waves in the table</returns>
+    public: bool empty() const { return this->startOffsets.empty(); }
+
+    /// <summary>Removes all half-waves from the table, keeping the allocated memory</summary>
+    public: void clear();
+
+    /// <summary>Allocates memory for the specified number of half-waves</summary>
+    /// <param name="capacity">Number of half-waves to reserve memory for</param>
+    public: void reserve(std::size_t capacity);
+
+    /// <summary>Appends a half-wave to the end of the table</summary>
+    /// <param name="halfwave">Half-wave that will be appended</param>
+    /// <remarks>
+    ///   The half-wave must not start before the last half-wave in the table.
+    /// </remarks>
+    public: void push_back(const ClippingHalfwave &halfwave);
+
+    /// <summary>Appends a new half-wave to the end of the table</summary>
+    /// <param name="startIndex">Index of the sample at which the half-wave begins</param>
+    /// <param name="peakIndex">Index of the sample with the highest amplitude</param>
+    /// <param name="endIndex">Index one past the last sample in the half-wave</param>
+    /// <param name="peakAmplitude">Highest amplitude within the half-wave</param>
+    public: void emplace_back(
+      std::uint64_t startIndex, std::uint64_t peakIndex, std::uint64_t endIndex,
+      float peakAmplitude
+    ) {
+      push_back(ClippingHalfwave(startIndex, peakIndex, endIndex, peakAmplitude));
+    }
+
+    /// <summary>Retrieves a copy of the half-wave at the specified index</summary>
+    /// <param name="index">Index of the half-wave that will be retrieved</param>
+    /// <returns>A copy of the half-wave at the specified index</returns>
+    public: ClippingHalfwave operator[](std::size_t index) const;
+
+    /// <summary>Retrieves a copy of the last half-wave in the table</summary>
+    /// <returns>A copy of the last half-wave</returns>
+    public: ClippingHalfwave back() const { return operator[](size() - 1); }
+
+    /// <summary>Looks up the index at which a half-wave begins</summary>
+    /// <param name="index">Index of the half-wave whose start will be looked up</param>
+    /// <returns>The index of the first sample in the half-wave</returns>
+    public: inline std::uint64_t GetPriorZeroCrossingIndex(std::size_t index) const;
+
+    /// <summary>Looks up the index at which a half-wave ends</summary>
+    /// <param name="index">Index of the half-wave whose end will be looked up</param>
+    /// <returns>The index one past the last sample in the half-wave</returns>
+    public: inline std::uint64_t GetNextZeroCrossingIndex(std::size_t index) const;
+
+    /// <summary>Looks up the index of the highest sample in a half-wave</summary>
+    /// <param name="index">Index of the half-wave whose peak will be looked up</param>
+    /// <returns>The index of the sample with the highest amplitude</returns>
+    public: inline std::uint64_t GetPeakIndex(std::size_t index) const;
+
+    /// <summary>Looks up the peak amplitude recorded for a half-wave</summary>
+    /// <param name="index">Index of the half-wave whose peak will be looked up</param>
+    /// <returns>The peak amplitude of the half-wave</returns>
+    public: float GetPeakAmplitude(std::size_t index) const {
+      return this->peakAmplitudes[index];
+    }
+
+    /// <summary>Records a new peak amplitude for a half-wave</summary>
+    /// <param name="index">Index of the half-wave whose peak will be updated</param>
+    /// <param name="peakAmplitude">New peak amplitude of the half-wave</param>
+    public: void SetPeakAmplitude(std::size_t index, float peakAmplitude) {
+      this->peakAmplitudes[index] = peakAmplitude;
+    }
+
+    /// <summary>Looks up the volume quotient by which a half-wave gets scaled</summary>
+    /// <param name="index">Index of the half-wave whose quotient will be looked up</param>
+    /// <returns>The volume quotient of the half-wave</returns>
+    public: float GetVolumeQuotient(std::size_t index) const {
+      return this->volumeQuotients[index];
+    }
+
+    /// <summary>Records a new volume quotient for a half-wave</summary>
+    /// <param name="index">Index of the half-wave whose quotient will be updated</param>
+    /// <param name="volumeQuotient">New volume quotient of the half-wave</param>
+    public: void SetVolumeQuotient(std::size_t index, float volumeQuotient) {
+      this->volumeQuotients[index] = volumeQuotient;
+    }
+
+    /// <summary>Looks up how many iterations failed to change a half-wave's peak</summary>
+    /// <param name="index">Index of the half-wave whose count will be looked up</param>
+    /// <returns>The number of consecutive ineffective iterations</returns>
+    public: std::size_t GetIneffectiveIterationCount(std::size_t index) const {
+      return this->ineffectiveIterationCounts[index];
+    }
+
+    /// <summary>Resets the number of ineffective iterations of a half-wave to zero</summary>
+    /// <param name="index">Index of the half-wave whose count will be reset</param>
+    public: void ResetIneffectiveIterationCount(std::size_t index) {
+      this->ineffectiveIterationCounts[index] = 0;
+    }
+
+    /// <summary>Counts up the number of ineffective iterations of a half-wave</summary>
+    /// <param name="index">Index of the half-wave whose count will be incremented</param>
+    /// <remarks>
+    ///   The count saturates rather than wrapping around, so a half-wave given up on
+    ///   stays given up on, no matter how many more iterations are run.
+    /// </remarks>
+    public: void IncrementIneffectiveIterationCount(std::size_t index) {
+      if(this->ineffectiveIterationCounts[index] < 255) {
+        ++this->ineffectiveIterationCounts[index];
+      }
+    }
+
+    /// <summary>
+    ///   Stores the peak amplitude, volume quotient, ineffective iteration count and
+    ///   the previous attempt of a half-wave retrieved from the table earlier
+    /// </summary>
+    /// <param name="index">Index of the half-wave that will be updated</param>
+    /// <param name="halfwave">Half-wave whose values will be stored</param>
+    /// <remarks>
+    ///   The extents of a half-wave can't be changed, as that could break the ordering.
+    /// </remarks>
+    public: void Update(std::size_t index, const ClippingHalfwave &halfwave);
+
+    /// <summary>Finds the first half-wave that ends after the specified frame</summary>
+    /// <param name="frameIndex">Index of the frame the half-wave should end after</param>
+    /// <returns>
+    ///   The index of the first half-wave that ends after the specified frame or
+    ///   the number of half-waves in the table if there is no such half-wave
+    /// </returns>
+    public: std::size_t FindFirstEndingAfter(std::uint64_t frameIndex) const;
+
+    /// <summary>Finds the first half-wave that doesn't start before the specified frame</summary>
+    /// <param name="frameIndex">Index of the frame the half-wave should not start before</param>
+    /// <returns>
+    ///   The index of the first half-wave starting at or after the specified frame or
+    ///   the number of half-waves in the table if there is no such half-wave
+    /// </returns>
+    public: std::size_t FindFirstStartingFrom(std::uint64_t frameIndex) const;
+
+    /// <summary>Replaces the contents of this table with those of another table</summary>
+    /// <param name="other">Table whose contents will be copied</param>
+    /// <remarks>
+    ///   The memory already allocated by this table is reused, so once the table has
+    ///   grown to the size of the other table, further copies won't allocate anything.
+    /// </remarks>
+    public: void CopyFrom(const ClippingHalfwaveTable &other);
+
+    /// <summary>Swaps the contents of this table with those of another table</summary>
+    /// <param name="other">Table this table will swap its contents with</param>
+    public: void Swap(ClippingHalfwaveTable &other) noexcept;
+
+    /// <summary>Looks up the base index of the block a half-wave is in</summary>
+    /// <param name="index">Index of the half-wave whose block will be looked up</param>
+    /// <returns>The frame index all of the half-wave's offsets are relative to</returns>
+    private: inline std::uint64_t getBaseIndex(std::size_t index) const;
+
+    /// <summary>Frame index bits above the 32 stored for each half-wave</summary>
+    private: struct Block {
+
+      /// <summary>Frame index the offsets of the half-waves in the block are relative to</summary>
+      public: std::uint64_t BaseIndex;
+      /// <summary>Index of the first half-wave in the block</summary>
+      public: std::size_t FirstHalfwaveIndex;
+
+    };
+
+    /// <summary>All blocks that have half-waves in them, in order</summary>
+    private: std::vector<Block> blocks;
+    /// <summary>Start index of each half-wave, relative to its block's base index</summary>
+    private: std::vector<std::uint32_t> startOffsets;
+    /// <summary>Number of samples in each half-wave</summary>
+    private: std::vector<std::uint32_t> lengths;
+    /// <summary>Index of each half-wave's peak, relative to its start index</summary>
+    private: std::vector<std::uint32_t> peakOffsets;
+    /// <summary>Number of consecutive iterations that failed to change the peak</summary>
+    private: std::vector<std::uint8_t> ineffectiveIterationCounts;
+    /// <summary>Peak amplitude each half-wave has in the current iteration</summary>
+    private: std::vector<float> peakAmplitudes;
+    /// <summary>Quotient by which the volume of each half-wave is scaled</summary>
+    private: std::vector<float> volumeQuotients;
+    /// <summary>Peak amplitude of each half-wave before its current quotient was chosen</summary>
+    private: std::vector<float> previousPeakAmplitudes;
+    /// <summary>Quotient each half-wave was scaled by before the current one</summary>
+    private: std::vector<float> previousVolumeQuotients;
+
+  };
+
+  // ------------------------------------------------------------------------------------------- //
+
+  inline std::uint64_t ClippingHalfwaveTable::GetPriorZeroCrossingIndex(
+    std::size_t index
+  ) const {
+    return getBaseIndex(index) + this->startOffsets[index];
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  inline std::uint64_t ClippingHalfwaveTable::GetNextZeroCrossingIndex(
+    std::size_t index
+  ) const {
+    return getBaseIndex(index) + this->startOffsets[index] + this->lengths[index];
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  inline std::uint64_t ClippingHalfwaveTable::GetPeakIndex(std::size_t index) const {
+    return getBaseIndex(index) + this->startOffsets[index] + this->peakOffsets[index];
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  inline std::uint64_t ClippingHalfwaveTable::getBaseIndex(std::size_t index) const {
+    assert((index < this->startOffsets.size()) && u8"Half-wave index is within bounds");
+
+    // Unless a track is longer than a day, there will only ever be a single block,
+    // so searching for the block the half-wave is in is almost always skipped.
+    std::size_t blockIndex = this->blocks.size() - 1;
+    while(index < this->blocks[blockIndex].FirstHalfwaveIndex) {
+      --blockIndex;
+    }
+
+    return this->blocks[blockIndex].BaseIndex;
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+} // namespace Nuclex::OpusTranscoder::Audio
+
+#endif // NUCLEX_OPUSTRANSCODER_AUDIO_CLIPPINGHALFWAVETABLE_H
@@ -0,0 +1,294 @@
+#pragma region Apache License 2.0
+/*
+Nuclex Opus Transcoder
+Copyright (C) 2024 Markus Ewald / Nuclex Development Labs
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#pragma endregion // Apache License 2.0
+
+// If the application is compiled as a DLL, this ensures symbols are exported
+#define NUCLEX_OPUSTRANSCODER_SOURCE 1
+
+#include "./CompactSampleStore.h"
+
+#include <algorithm> // for std::min()
+#include <cassert> // for assert()
+#include <cmath> // for std::nearbyint()
+#include <cstring> // for std::memcpy()
+
+namespace {
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Factor by which 16 bit integers are scaled to the float range</summary>
+  const float Int16Scale = 32768.0f;
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Factor by which 24 bit integers are scaled to the float range</summary>
+  const float Int24Scale = 8388608.0f;
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Checks if a sample can be stored as an integer without any loss</summary>
+  /// <param name="sample">Sample that will be checked</param>
+  /// <param name="scale">Scale of the integer format, i.e. 32768 for 16 bits</param>
+  /// <returns>True if the sample is exactly representable in the integer format</returns>
+  /// <remarks>
+  ///   Multiplying by a power of two only changes the exponent, so this is exact, too.
+  ///   NaNs and infinities fail the comparisons and will be kept as floats.
+  /// </remarks>
+  inline bool isExactInteger(float sample, float scale) {
+    float scaled = sample * scale;
+    return (
+      (scaled == std::nearbyint(scaled)) &&
+      (-scale <= scaled) &&
+      (scaled < scale)
+    );
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Determines the smallest width in which a run of samples can be stored</summary>
+  /// <param name="samples">Samples that will be checked</param>
+  /// <param name="stride">Distance between two consecutive samples</param>
+  /// <param name="count">Number of samples that will be checked</param>
+  /// <returns>The number of bytes each sample needs, either 2, 3 or 4</returns>
+  std::size_t determineSampleWidth(const float *samples, std::size_t stride, std::size_t count) {
+    std::size_t width = 2;
+    for(std::size_t index = 0; index < count; ++index) {
+      float sample = samples[index * stride];
+      if(width == 2) {
+        if(isExactInteger(sample, Int16Scale)) {
+          continue;
+        }
+        width = 3;
+      }
+      if(!isExactInteger(sample, Int24Scale)) {
+        return 4;
+      }
+    }
+
+    return width;
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+} // anonymous namespace
+
+namespace Nuclex::OpusTranscoder::Audio {
+
+  // ------------------------------------------------------------------------------------------- //
+
+  // Small enough that a block of a seldom burst of float samples (i.e. from dithering
+  // being turned off for a moment) doesn't bloat much, large enough that the per-block
+  // offset is negligible (8 bytes per 16 KiB of float samples)
+  const std::size_t CompactSampleStore::FramesPerBlock = 4096;
+
+  // ------------------------------------------------------------------------------------------- //
+
+  CompactSampleStore::CompactSampleStore() :
+    frameCount(0),
+    channels() {}
+
+  // ------------------------------------------------------------------------------------------- //
+
+  void CompactSampleStore::Assign(
+    const float *const *channelSamples, std::size_t channelCount,
+    std::size_t sampleStride, std::uint64_t frameCount
+  ) {
+    std::size_t blockCount = static_cast<std::size_t>(
+      (frameCount + FramesPerBlock - 1) / FramesPerBlock
+    );
+
+    std::vector<CompactChannel> newChannels(channelCount);
+    for(std::size_t channelIndex = 0; channelIndex < channelCount; ++channelIndex) {
+      CompactChannel &channel = newChannels[channelIndex];
+      const float *samples = channelSamples[channelIndex];
+
+      // First pass: find out how wide each block has to be, so the exact amount
+      // of memory can be allocated rather than growing (and copying) the buffer
+      channel.BlockOffsets.resize(blockCount + 1);
+      channel.BlockOffsets[0] = 0;
+      for(std::size_t blockIndex = 0; blockIndex < blockCount; ++blockIndex) {
+        std::uint64_t blockStartIndex = std::uint64_t(blockIndex) * FramesPerBlock;
+        std::size_t blockFrameCount = static_cast<std::size_t>(
+          std::min<std::uint64_t>(FramesPerBlock, frameCount - blockStartIndex)
+        );
+        std::size_t width = determineSampleWidth(
+          samples + (blockStartIndex * sampleStride), sampleStride, blockFrameCount
+        );
+        channel.BlockOffsets[blockIndex + 1] = (
+          channel.BlockOffsets[blockIndex] + (width * blockFrameCount)
+        );
+      }
+
+      // Second pass: store each block in the width that was determined for it
+      channel.Data.resize(static_cast<std::size_t>(channel.BlockOffsets[blockCount]));
+      for(std::size_t blockIndex = 0; blockIndex < blockCount; ++blockIndex) {
+        std::uint64_t blockStartIndex = std::uint64_t(blockIndex) * FramesPerBlock;
+        std::size_t blockFrameCount = static_cast<std::size_t>(
+          std::min<std::uint64_t>(FramesPerBlock, frameCount - blockStartIndex)
+        );
+        std::size_t width = static_cast<std::size_t>(
+          channel.BlockOffsets[blockIndex + 1] - channel.BlockOffsets[blockIndex]
+        ) / blockFrameCount;
+
+        const float *read = samples + (blockStartIndex * sampleStride);
+        std::uint8_t *write = (
+          channel.Data.data() + static_cast<std::size_t>(channel.BlockOffsets[blockIndex])
+        );
+        if(width == 2) {
+          for(std::size_t index = 0; index < blockFrameCount; ++index) {
+            std::int16_t value = static_cast<std::int16_t>(read[index * sampleStride] * Int16Scale);
+            std::memcpy(write, &value, sizeof(value));
+            write += 2;
+          }
+        } else if(width == 3) {
+          for(std::size_t index = 0; index < blockFrameCount; ++index) {
+            std::int32_t value = static_cast<std::int32_t>(read[index * sampleStride] * Int24Scale);
+            write[0] = static_cast<std::uint8_t>(value);
+            write[1] = static_cast<std::uint8_t>(value >> 8);
+            write[2] = static_cast<std::uint8_t>(value >> 16);
+            write += 3;
+          }
+        } else {
+          for(std::size_t index = 0; index < blockFrameCount; ++index) {
+            std::memcpy(write, read + (index * sampleStride), sizeof(float));
+            write += 4;
+          }
+        }
+      } // for each block
+    } // for each channel
+
+    this->channels.swap(newChannels);
+    this->frameCount = frameCount;
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  void CompactSampleStore::Clear() {
+    std::vector<CompactChannel>().swap(this->channels);
+    this->frameCount = 0;
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  std::size_t CompactSampleStore::GetMemoryUsage() const {
+    std::size_t byteCount = 0;
+    for(std::size_t index = 0; index < this->channels.size(); ++index) {
+      byteCount += this->channels[index].Data.size();
+      byteCount += this->channels[index].BlockOffsets.size() * sizeof(std::uint64_t);
+    }
+
+    return byteCount;
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  float CompactSampleStore::GetSample(std::size_t channelIndex, std::uint64_t frameIndex) const {
+    assert((frameIndex < this->frameCount) && u8"Sample index lies within the store");
+
+    float sample;
+    expandSamples(
+      this->channels[channelIndex],
+      static_cast<std::size_t>(frameIndex / FramesPerBlock),
+      static_cast<std::size_t>(frameIndex % FramesPerBlock),
+      1, &sample, 1
+    );
+
+    return sample;
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  void CompactSampleStore::InterleaveFrames(
+    std::uint64_t startFrameIndex, std::size_t frameCount, float *target
+  ) const {
+    assert(
+      (startFrameIndex + frameCount <= this->frameCount) &&
+      u8"Expanded frames lie within the store"
+    );
+
+    std::size_t channelCount = this->channels.size();
+
+    std::uint64_t frameIndex = startFrameIndex;
+    std::uint64_t endFrameIndex = startFrameIndex + frameCount;
+    while(frameIndex < endFrameIndex) {
+      std::size_t blockIndex = static_cast<std::size_t>(frameIndex / FramesPerBlock);
+      std::size_t startIndex = static_cast<std::size_t>(frameIndex % FramesPerBlock);
+      std::size_t count = static_cast<std::size_t>(
+        std::min<std::uint64_t>(FramesPerBlock - startIndex, endFrameIndex - frameIndex)
+      );
+
+      float *write = target + static_cast<std::size_t>(frameIndex - startFrameIndex) * channelCount;
+      for(std::size_t channelIndex = 0; channelIndex < channelCount; ++channelIndex) {
+        expandSamples(
+          this->channels[channelIndex], blockIndex, startIndex, count,
+          write + channelIndex, channelCount
+        );
+      }
+
+      frameIndex += count;
+    } // while frames remain
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  void CompactSampleStore::expandSamples(
+    const CompactChannel &channel, std::size_t blockIndex,
+    std::size_t startIndex, std::size_t count,
+    float *target, std::size_t targetStride
+  ) const {
+    std::uint64_t blockStartIndex = std::uint64_t(blockIndex) * FramesPerBlock;
+    std::size_t blockFrameCount = static_cast<std::size_t>(
+      std::min<std::uint64_t>(FramesPerBlock, this->frameCount - blockStartIndex)
+    );
+    std::size_t width = static_cast<std::size_t>(
+      channel.BlockOffsets[blockIndex + 1] - channel.BlockOffsets[blockIndex]
+    ) / blockFrameCount;
+
+    const std::uint8_t *read = (
+      channel.Data.data() + static_cast<std::size_t>(channel.BlockOffsets[blockIndex]) +
+      (startIndex * width)
+    );
+    if(width == 2) {
+      for(std::size_t index = 0; index < count; ++index) {
+        std::int16_t value;
+        std::memcpy(&value, read, sizeof(value));
+        target[index * targetStride] = static_cast<float>(value) / Int16Scale;
+        read += 2;
+      }
+    } else if(width == 3) {
+      for(std::size_t index = 0; index < count; ++index) {
+        std::int32_t value = static_cast<std::int32_t>(
+          static_cast<std::uint32_t>(read[0]) |
+          (static_cast<std::uint32_t>(read[1]) << 8) |
+          (static_cast<std::uint32_t>(read[2]) << 16) |
+          ((read[2] & 0x80) ? 0xFF000000u : 0u) // sign extension
+        );
+        target[index * targetStride] = static_cast<float>(value) / Int24Scale;
+        read += 3;
+      }
+    } else {
+      for(std::size_t index = 0; index < count; ++index) {
+        std::memcpy(target + (index * targetStride), read, sizeof(float));
+        read += 4;
+      }
+    }
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+} // namespace Nuclex::OpusTranscoder::Audio
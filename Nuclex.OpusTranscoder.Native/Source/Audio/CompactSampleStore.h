@@ -0,0 +1,140 @@
+#pragma region Apache License 2.0
+/*
+Nuclex Opus Transcoder
+Copyright (C) 2024 Markus Ewald / Nuclex Development Labs
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#pragma endregion // Apache License 2.0
+
+#ifndef NUCLEX_OPUSTRANSCODER_AUDIO_COMPACTSAMPLESTORE_H
+#define NUCLEX_OPUSTRANSCODER_AUDIO_COMPACTSAMPLESTORE_H
+
+#include "../Config.h"
+#include "./SampleBuffer.h"
+
+#include <vector> // for std::vector
+#include <cstdint> // for std::uint8_t, std::uint64_t
+
+namespace Nuclex::OpusTranscoder::Audio {
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Stores audio samples losslessly in the smallest exact format</summary>
+  /// <remarks>
+  ///   <para>
+  ///     Audio decoded from 16 bit or 24 bit PCM only has as many distinct values per
+  ///     sample, so storing it as 32 bit floats wastes a quarter to half the memory.
+  ///     This store checks each block of samples and, if all of them survive the round
+  ///     trip, keeps the block as 16 bit or 24 bit integers. Anything else (float input,
+  ///     samples that have been mixed or amplified) stays as floats.
+  ///   </para>
+  ///   <para>
+  ///     Expanding a block gives back the exact same float values, so this is meant
+  ///     for samples that are only read anymore, such as the original samples the
+  ///     iterative declipper keeps encoding from.
+  ///   </para>
+  /// </remarks>
+  class CompactSampleStore {
+
+    /// <summary>Number of frames that are stored in the same format</summary>
+    public: static const std::size_t FramesPerBlock;
+
+    /// <summary>Initializes a new, empty compact sample store</summary>
+    public: CompactSampleStore();
+
+    /// <summary>Replaces the contents of the store with the specified samples</summary>
+    /// <param name="channelSamples">Pointers to the first sample of each channel</param>
+    /// <param name="channelCount">Number of channels that will be stored</param>
+    /// <param name="sampleStride">Distance between two samples of the same channel</param>
+    /// <param name="frameCount">Number of frames that will be stored</param>
+    public: void Assign(
+      const float *const *channelSamples, std::size_t channelCount,
+      std::size_t sampleStride, std::uint64_t frameCount
+    );
+
+    /// <summary>Throws away all samples kept in the store</summary>
+    public: void Clear();
+
+    /// <summary>Checks whether the store is holding any samples</summary>
+    /// <returns>True if the store is holding no samples at all</returns>
+    public: bool IsEmpty() const { return this->channels.empty(); }
+
+    /// <summary>Counts the number of channels in the store</summary>
+    /// <returns>The number of channels that are being stored</returns>
+    public: std::size_t CountChannels() const { return this->channels.size(); }
+
+    /// <summary>Counts the number of frames (samples per channel) in the store</summary>
+    /// <returns>The number of frames that are being stored</returns>
+    public: std::uint64_t CountFrames() const { return this->frameCount; }
+
+    /// <summary>Determines how much memory the stored samples take up</summary>
+    /// <returns>The number of bytes used for the stored samples</returns>
+    public: std::size_t GetMemoryUsage() const;
+
+    /// <summary>Looks up a single sample</summary>
+    /// <param name="channelIndex">Index of the channel the sample is in</param>
+    /// <param name="frameIndex">Index of the frame the sample belongs to</param>
+    /// <returns>The value of the sample</returns>
+    public: float GetSample(std::size_t channelIndex, std::uint64_t frameIndex) const;
+
+    /// <summary>Expands a range of frames into interleaved float samples</summary>
+    /// <param name="startFrameIndex">Index of the first frame that will be expanded</param>
+    /// <param name="frameCount">Number of frames that will be expanded</param>
+    /// <param name="target">Buffer that will receive the interleaved samples</param>
+    public: void InterleaveFrames(
+      std::uint64_t startFrameIndex, std::size_t frameCount, float *target
+    ) const;
+
+    /// <summary>Bytes of compacted samples, with no zero-filling when grown</summary>
+    private: typedef std::vector<std::uint8_t, SampleAllocator<std::uint8_t>> ByteBuffer;
+
+    /// <summary>Compacted samples of a single channel</summary>
+    private: struct CompactChannel {
+
+      /// <summary>Offset of each block in the data, plus the end of the last block</summary>
+      /// <remarks>
+      ///   The width of a block's samples follows from its length in bytes,
+      ///   so no separate format needs to be recorded.
+      /// </remarks>
+      public: std::vector<std::uint64_t> BlockOffsets;
+      /// <summary>Stores the samples of all blocks one after another</summary>
+      public: ByteBuffer Data;
+
+    };
+
+    /// <summary>Expands a run of samples within a single block</summary>
+    /// <param name="channel">Channel holding the block that will be expanded</param>
+    /// <param name="blockIndex">Index of the block in which samples will be expanded</param>
+    /// <param name="startIndex">Index of the first sample inside the block</param>
+    /// <param name="count">Number of samples that will be expanded</param>
+    /// <param name="target">Receives the expanded samples</param>
+    /// <param name="targetStride">Distance between two samples in the target</param>
+    private: void expandSamples(
+      const CompactChannel &channel, std::size_t blockIndex,
+      std::size_t startIndex, std::size_t count,
+      float *target, std::size_t targetStride
+    ) const;
+
+    /// <summary>Number of frames in the store</summary>
+    private: std::uint64_t frameCount;
+    /// <summary>Compacted samples of each channel</summary>
+    private: std::vector<CompactChannel> channels;
+
+  };
+
+  // ------------------------------------------------------------------------------------------- //
+
+} // namespace Nuclex::OpusTranscoder::Audio
+
+#endif // NUCLEX_OPUSTRANSCODER_AUDIO_COMPACTSAMPLESTORE_H
@@ -0,0 +1,189 @@
+#pragma region Apache License 2.0
+/*
+Nuclex Opus Transcoder
+Copyright (C) 2024 Markus Ewald / Nuclex Development Labs
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#pragma endregion // Apache License 2.0
+
+// If the application is compiled as a DLL, this ensures symbols are exported
+#define NUCLEX_OPUSTRANSCODER_SOURCE 1
+
+#include "./DeclipCheckpoint.h"
+#include "./SegmentedOpusEncoder.h"
+#include "./LittleEndian.h"
+
+#include <stdexcept> // for std::runtime_error
+
+namespace {
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Bytes at the start of a saved checkpoint, the last one is the version</summary>
+  const std::uint8_t CheckpointSignature[8] = { 'N', 'X', 'D', 'C', 'L', 'I', 'P', 1 };
+
+  // ------------------------------------------------------------------------------------------- //
+
+} // anonymous namespace
+
+namespace Nuclex::OpusTranscoder::Audio {
+
+  // ------------------------------------------------------------------------------------------- //
+
+  DeclipCheckpoint::DeclipCheckpoint() :
+    round(0),
+    isTucked(false),
+    halfwaves(),
+    segments() {}
+
+  // ------------------------------------------------------------------------------------------- //
+
+  void DeclipCheckpoint::Load(const std::vector<std::byte> &contents) {
+    LittleEndianReader reader(contents, u8"Declipping checkpoint is truncated");
+    for(std::size_t index = 0; index < sizeof(CheckpointSignature); ++index) {
+      if(reader.Read<std::uint8_t>() != CheckpointSignature[index]) {
+        throw std::runtime_error(u8"Not a declipping checkpoint or unsupported version");
+      }
+    }
+
+    std::size_t loadedRound;
+    bool loadedIsTucked;
+    HalfwaveMapCache loadedHalfwaves;
+    std::vector<Segment> loadedSegments;
+    try {
+      loadedRound = static_cast<std::size_t>(reader.Read<std::uint32_t>());
+      loadedIsTucked = (reader.Read<std::uint8_t>() != 0);
+      loadedHalfwaves.Load(reader.ReadBlock());
+
+      std::uint32_t segmentCount = reader.Read<std::uint32_t>();
+      for(std::uint32_t index = 0; index < segmentCount; ++index) {
+        Segment &segment = loadedSegments.emplace_back();
+        segment.StartFrameIndex = reader.Read<std::uint64_t>();
+        segment.EndFrameIndex = reader.Read<std::uint64_t>();
+        segment.Contents = reader.ReadBlock();
+      }
+
+      if(!reader.IsAtEnd()) {
+        throw std::runtime_error(u8"Declipping checkpoint has trailing garbage");
+      }
+    }
+    catch(const std::bad_alloc &) {
+      throw std::runtime_error(u8"Declipping checkpoint is damaged");
+    }
+
+    this->round = loadedRound;
+    this->isTucked = loadedIsTucked;
+    this->halfwaves = std::move(loadedHalfwaves);
+    this->segments.swap(loadedSegments);
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  std::vector<std::byte> DeclipCheckpoint::Save() const {
+    std::vector<std::byte> contents;
+
+    for(std::size_t index = 0; index < sizeof(CheckpointSignature); ++index) {
+      contents.push_back(static_cast<std::byte>(CheckpointSignature[index]));
+    }
+
+    LittleEndian::Append(contents, static_cast<std::uint32_t>(this->round));
+    LittleEndian::Append(contents, static_cast<std::uint8_t>(this->isTucked ? 1 : 0));
+    LittleEndian::AppendBlock(contents, this->halfwaves.Save());
+
+    LittleEndian::Append(contents, static_cast<std::uint32_t>(this->segments.size()));
+    for(const Segment &segment : this->segments) {
+      LittleEndian::Append(contents, segment.StartFrameIndex);
+      LittleEndian::Append(contents, segment.EndFrameIndex);
+      LittleEndian::AppendBlock(contents, segment.Contents);
+    }
+
+    return contents;
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  void DeclipCheckpoint::Capture(
+    std::uint64_t sampleHash, std::uint64_t settingsHash, std::size_t round,
+    const Track &track, const SegmentedOpusEncoder &encoder
+  ) {
+    this->round = round;
+    this->isTucked = encoder.IsTuckingEnabled();
+
+    // The settings hash already covers the bitrate, so the half-wave map cache
+    // is only used for its storage format and ends up with this single entry
+    this->halfwaves = HalfwaveMapCache();
+    this->halfwaves.Store(sampleHash, settingsHash, 0.0f, track);
+
+    std::size_t segmentCount = encoder.CountSegments();
+    this->segments.resize(segmentCount);
+    for(std::size_t index = 0; index < segmentCount; ++index) {
+      Segment &segment = this->segments[index];
+      segment.StartFrameIndex = encoder.GetSegmentStartFrameIndex(index);
+      segment.EndFrameIndex = encoder.GetSegmentEndFrameIndex(index);
+      segment.Contents.clear();
+      encoder.GetSegmentStream(index).Write(segment.Contents);
+    }
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  bool DeclipCheckpoint::Restore(
+    std::uint64_t sampleHash, std::uint64_t settingsHash,
+    Track &track, SegmentedOpusEncoder &encoder
+  ) const {
+    if(!this->halfwaves.Restore(sampleHash, settingsHash, 0.0f, track)) {
+      return false;
+    }
+
+    encoder.EnableTucking(this->isTucked);
+
+    // The packets are only usable if the encoder cut the track at the same places
+    std::size_t segmentCount = encoder.CountSegments();
+    if(this->segments.size() != segmentCount) {
+      return true;
+    }
+    for(std::size_t index = 0; index < segmentCount; ++index) {
+      bool isSameRange = (
+        (this->segments[index].StartFrameIndex == encoder.GetSegmentStartFrameIndex(index)) &&
+        (this->segments[index].EndFrameIndex == encoder.GetSegmentEndFrameIndex(index))
+      );
+      if(!isSameRange) {
+        return true;
+      }
+    }
+
+    // Parse all segments before handing any to the encoder, if one is damaged,
+    // the encoder should stay with all of its segments dirty
+    std::vector<OggOpusStream> streams;
+    streams.reserve(segmentCount);
+    try {
+      for(std::size_t index = 0; index < segmentCount; ++index) {
+        const std::vector<std::byte> &contents = this->segments[index].Contents;
+        streams.push_back(OggOpusStream::Parse(contents.data(), contents.size()));
+      }
+    }
+    catch(const std::runtime_error &) {
+      return true;
+    }
+
+    for(std::size_t index = 0; index < segmentCount; ++index) {
+      encoder.RestoreSegment(index, std::move(streams[index]));
+    }
+
+    return true;
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+} // namespace Nuclex::OpusTranscoder::Audio
@@ -0,0 +1,132 @@
+#pragma region Apache License 2.0
+/*
+Nuclex Opus Transcoder
+Copyright (C) 2024 Markus Ewald / Nuclex Development Labs
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#pragma endregion // Apache License 2.0
+
+#ifndef NUCLEX_OPUSTRANSCODER_AUDIO_DECLIPCHECKPOINT_H
+#define NUCLEX_OPUSTRANSCODER_AUDIO_DECLIPCHECKPOINT_H
+
+#include "../Config.h"
+#include "./HalfwaveMapCache.h"
+
+#include <vector> // for std::vector
+#include <cstddef> // for std::byte
+#include <cstdint> // for std::uint64_t
+
+namespace Nuclex::OpusTranscoder::Audio {
+
+  // ------------------------------------------------------------------------------------------- //
+
+  class SegmentedOpusEncoder;
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Snapshot of an iterative declipping job between two of its rounds</summary>
+  /// <remarks>
+  ///   <para>
+  ///     Long iterative declipping jobs can run for hours. If the process gets killed
+  ///     partway through, a checkpoint lets the job pick up at the round it was in
+  ///     instead of decoding the input and starting over.
+  ///   </para>
+  ///   <para>
+  ///     A checkpoint is captured right after an encode. It holds the round that will
+  ///     verify that encode, the clipping half-waves with the volume quotients the encode
+  ///     used, and the packets of each segment of the encoder, from which the encoded
+  ///     Opus file can be stitched together again without encoding anything.
+  ///   </para>
+  ///   <para>
+  ///     Like the half-wave map cache, a checkpoint is keyed by a hash of the decoded input
+  ///     samples and a hash of the settings, so only the very same job will resume it.
+  ///   </para>
+  /// </remarks>
+  class DeclipCheckpoint {
+
+    /// <summary>Initializes a new, empty checkpoint</summary>
+    public: DeclipCheckpoint();
+
+    /// <summary>Looks up the declipping round in which the checkpoint was captured</summary>
+    /// <returns>The round that will verify the encode the checkpoint holds</returns>
+    public: std::size_t GetRound() const { return this->round; }
+
+    /// <summary>Replaces the contents of the checkpoint with previously saved ones</summary>
+    /// <param name="contents">Contents obtained from an earlier call to Save()</param>
+    /// <remarks>
+    ///   Throws a <see cref="std::runtime_error" /> if the contents are damaged or were
+    ///   written by an incompatible version.
+    /// </remarks>
+    public: void Load(const std::vector<std::byte> &contents);
+
+    /// <summary>Serializes the contents of the checkpoint so they can be stored</summary>
+    /// <returns>The serialized contents of the checkpoint</returns>
+    public: std::vector<std::byte> Save() const;
+
+    /// <summary>Records the state of a declipping job</summary>
+    /// <param name="sampleHash">Hash of the decoded input samples</param>
+    /// <param name="settingsHash">Hash of the settings the job runs with</param>
+    /// <param name="round">Round that will verify the encoder's last encode</param>
+    /// <param name="track">Track whose clipping half-waves will be recorded</param>
+    /// <param name="encoder">Encoder whose segment packets will be recorded</param>
+    public: void Capture(
+      std::uint64_t sampleHash, std::uint64_t settingsHash, std::size_t round,
+      const Track &track, const SegmentedOpusEncoder &encoder
+    );
+
+    /// <summary>Restores the state of a declipping job</summary>
+    /// <param name="sampleHash">Hash of the decoded input samples</param>
+    /// <param name="settingsHash">Hash of the settings the job runs with</param>
+    /// <param name="track">Track whose clipping half-waves will be replaced</param>
+    /// <param name="encoder">Encoder whose segment packets will be replaced</param>
+    /// <returns>True if the checkpoint belongs to the job and was restored</returns>
+    /// <remarks>
+    ///   If the encoder split the track into different segments than the one the
+    ///   checkpoint was captured from (for example because it may use a different
+    ///   number of threads now), only the half-waves are restored and all segments
+    ///   remain dirty. The encoder's tucking is enabled if it was when captured.
+    /// </remarks>
+    public: bool Restore(
+      std::uint64_t sampleHash, std::uint64_t settingsHash,
+      Track &track, SegmentedOpusEncoder &encoder
+    ) const;
+
+    /// <summary>Packets of a segment and the range of frames they stand for</summary>
+    private: struct Segment {
+
+      /// <summary>Index of the first frame whose packets are taken from the segment</summary>
+      public: std::uint64_t StartFrameIndex;
+      /// <summary>Index one past the last frame whose packets are taken from the segment</summary>
+      public: std::uint64_t EndFrameIndex;
+      /// <summary>Packets of the segment written as an Ogg Opus file</summary>
+      public: std::vector<std::byte> Contents;
+
+    };
+
+    /// <summary>Round that will verify the encode recorded in the checkpoint</summary>
+    private: std::size_t round;
+    /// <summary>Whether the encode applied the volume quotients of the half-waves</summary>
+    private: bool isTucked;
+    /// <summary>Clipping half-waves of the track, stored under the job's hashes</summary>
+    private: HalfwaveMapCache halfwaves;
+    /// <summary>Packets of each segment the encoder has split the track into</summary>
+    private: std::vector<Segment> segments;
+
+  };
+
+  // ------------------------------------------------------------------------------------------- //
+
+} // namespace Nuclex::OpusTranscoder::Audio
+
+#endif // NUCLEX_OPUSTRANSCODER_AUDIO_DECLIPCHECKPOINT_H
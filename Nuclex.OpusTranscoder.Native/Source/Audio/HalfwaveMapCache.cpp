@@ -0,0 +1,247 @@
+#pragma region Apache License 2.0
+/*
+Nuclex Opus Transcoder
+Copyright (C) 2024 Markus Ewald / Nuclex Development Labs
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#pragma endregion // Apache License 2.0
+
+// If the application is compiled as a DLL, this ensures symbols are exported
+#define NUCLEX_OPUSTRANSCODER_SOURCE 1
+
+#include "./HalfwaveMapCache.h"
+#include "./LittleEndian.h"
+
+#include <cmath> // for std::abs()
+#include <stdexcept> // for std::runtime_error
+
+namespace {
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Bytes at the start of a saved cache, the last one is the format version</summary>
+  const std::uint8_t CacheSignature[8] = { 'N', 'X', 'H', 'W', 'M', 'A', 'P', 1 };
+
+  // ------------------------------------------------------------------------------------------- //
+
+} // anonymous namespace
+
+namespace Nuclex::OpusTranscoder::Audio {
+
+  // ------------------------------------------------------------------------------------------- //
+
+  // Each entry is a handful of bitrates or layouts tried for the same input. Sixteen
+  // is plenty for that and keeps the sidecar file from growing without bounds.
+  const std::size_t HalfwaveMapCache::MaximumEntryCount = 16;
+
+  // ------------------------------------------------------------------------------------------- //
+
+  void HalfwaveMapCache::Load(const std::vector<std::byte> &contents) {
+    this->entries.clear();
+
+    LittleEndianReader reader(contents, u8"Half-wave map cache is truncated");
+    for(std::size_t index = 0; index < sizeof(CacheSignature); ++index) {
+      if(reader.Read<std::uint8_t>() != CacheSignature[index]) {
+        throw std::runtime_error(u8"Not a half-wave map cache or unsupported version");
+      }
+    }
+
+    std::vector<Entry> loadedEntries;
+    try {
+      std::uint32_t entryCount = reader.Read<std::uint32_t>();
+      for(std::uint32_t entryIndex = 0; entryIndex < entryCount; ++entryIndex) {
+        Entry entry;
+        entry.SampleHash = reader.Read<std::uint64_t>();
+        entry.SettingsHash = reader.Read<std::uint64_t>();
+        entry.BitrateInKilobits = reader.ReadFloat();
+
+        std::uint32_t channelCount = reader.Read<std::uint32_t>();
+        entry.Channels.resize(channelCount);
+        for(std::uint32_t channelIndex = 0; channelIndex < channelCount; ++channelIndex) {
+          ClippingHalfwaveTable &halfwaves = entry.Channels[channelIndex];
+
+          std::uint64_t previousEndIndex = 0;
+          std::uint64_t halfwaveCount = reader.Read<std::uint64_t>();
+          for(std::uint64_t halfwaveIndex = 0; halfwaveIndex < halfwaveCount; ++halfwaveIndex) {
+            std::uint64_t startIndex = reader.Read<std::uint64_t>();
+            std::uint64_t peakIndex = reader.Read<std::uint64_t>();
+            std::uint64_t endIndex = reader.Read<std::uint64_t>();
+
+            // The table only accepts ordered, non-intersecting half-waves, so don't
+            // let a damaged file trip its assertions or corrupt its block list
+            bool isValid = (
+              (previousEndIndex <= startIndex) &&
+              (startIndex <= peakIndex) &&
+              (peakIndex <= endIndex)
+            );
+            if(!isValid) {
+              throw std::runtime_error(u8"Half-wave map cache contains invalid half-waves");
+            }
+            previousEndIndex = endIndex;
+
+            ClippingHalfwave halfwave(startIndex, peakIndex, endIndex, 0.0f);
+            halfwave.IneffectiveIterationCount = reader.Read<std::uint8_t>();
+            halfwave.PeakAmplitude = reader.ReadFloat();
+            halfwave.VolumeQuotient = reader.ReadFloat();
+            halfwave.PreviousPeakAmplitude = reader.ReadFloat();
+            halfwave.PreviousVolumeQuotient = reader.ReadFloat();
+            halfwaves.push_back(halfwave);
+          } // for each half-wave in the channel
+        } // for each channel
+
+        loadedEntries.push_back(std::move(entry));
+      } // for each entry
+
+      if(!reader.IsAtEnd()) {
+        throw std::runtime_error(u8"Half-wave map cache has trailing garbage");
+      }
+    }
+    catch(const std::bad_alloc &) {
+      throw std::runtime_error(u8"Half-wave map cache is damaged");
+    }
+
+    this->entries.swap(loadedEntries);
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  std::vector<std::byte> HalfwaveMapCache::Save() const {
+    std::vector<std::byte> contents;
+
+    for(std::size_t index = 0; index < sizeof(CacheSignature); ++index) {
+      contents.push_back(static_cast<std::byte>(CacheSignature[index]));
+    }
+
+    LittleEndian::Append(contents, static_cast<std::uint32_t>(this->entries.size()));
+    for(const Entry &entry : this->entries) {
+      LittleEndian::Append(contents, entry.SampleHash);
+      LittleEndian::Append(contents, entry.SettingsHash);
+      LittleEndian::AppendFloat(contents, entry.BitrateInKilobits);
+
+      LittleEndian::Append(contents, static_cast<std::uint32_t>(entry.Channels.size()));
+      for(const ClippingHalfwaveTable &halfwaves : entry.Channels) {
+        std::size_t halfwaveCount = halfwaves.size();
+        LittleEndian::Append(contents, static_cast<std::uint64_t>(halfwaveCount));
+        for(std::size_t halfwaveIndex = 0; halfwaveIndex < halfwaveCount; ++halfwaveIndex) {
+          ClippingHalfwave halfwave = halfwaves[halfwaveIndex];
+          LittleEndian::Append(contents, halfwave.PriorZeroCrossingIndex);
+          LittleEndian::Append(contents, halfwave.PeakIndex);
+          LittleEndian::Append(contents, halfwave.NextZeroCrossingIndex);
+          LittleEndian::Append(
+            contents, static_cast<std::uint8_t>(halfwave.IneffectiveIterationCount)
+          );
+          LittleEndian::AppendFloat(contents, halfwave.PeakAmplitude);
+          LittleEndian::AppendFloat(contents, halfwave.VolumeQuotient);
+          LittleEndian::AppendFloat(contents, halfwave.PreviousPeakAmplitude);
+          LittleEndian::AppendFloat(contents, halfwave.PreviousVolumeQuotient);
+        } // for each half-wave in the channel
+      } // for each channel
+    } // for each entry
+
+    return contents;
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  void HalfwaveMapCache::Store(
+    std::uint64_t sampleHash, std::uint64_t settingsHash, float bitrateInKilobits,
+    const Track &track
+  ) {
+    std::size_t channelCount = track.Channels.size();
+
+    // Drop any earlier entry for the exact same case, the new one is more recent
+    for(std::size_t index = 0; index < this->entries.size(); ++index) {
+      const Entry &entry = this->entries[index];
+      bool isSameCase = (
+        (entry.SampleHash == sampleHash) &&
+        (entry.SettingsHash == settingsHash) &&
+        (entry.BitrateInKilobits == bitrateInKilobits) &&
+        (entry.Channels.size() == channelCount)
+      );
+      if(isSameCase) {
+        this->entries.erase(this->entries.begin() + index);
+        break;
+      }
+    }
+    while(MaximumEntryCount <= this->entries.size()) {
+      this->entries.erase(this->entries.begin());
+    }
+
+    Entry entry;
+    entry.SampleHash = sampleHash;
+    entry.SettingsHash = settingsHash;
+    entry.BitrateInKilobits = bitrateInKilobits;
+    entry.Channels.resize(channelCount);
+    for(std::size_t channelIndex = 0; channelIndex < channelCount; ++channelIndex) {
+      entry.Channels[channelIndex].CopyFrom(track.Channels[channelIndex].ClippingHalfwaves);
+    }
+
+    this->entries.push_back(std::move(entry));
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  bool HalfwaveMapCache::Restore(
+    std::uint64_t sampleHash, std::uint64_t settingsHash, float bitrateInKilobits,
+    Track &track
+  ) const {
+    std::size_t channelCount = track.Channels.size();
+    std::uint64_t frameCount = track.CountFrames();
+
+    const Entry *nearestEntry = nullptr;
+    for(const Entry &entry : this->entries) {
+      bool matches = (
+        (entry.SampleHash == sampleHash) &&
+        (entry.SettingsHash == settingsHash) &&
+        (entry.Channels.size() == channelCount)
+      );
+
+      // With matching hashes, this can't really happen, but a half-wave reaching past
+      // the end of the track would have the encoder read out of bounds, so be sure.
+      for(std::size_t channelIndex = 0; matches && (channelIndex < channelCount); ++channelIndex) {
+        const ClippingHalfwaveTable &halfwaves = entry.Channels[channelIndex];
+        if(!halfwaves.empty()) {
+          matches = (halfwaves.GetNextZeroCrossingIndex(halfwaves.size() - 1) <= frameCount);
+        }
+      }
+      if(matches) {
+        bool isNearer = (
+          (nearestEntry == nullptr) ||
+          (
+            std::abs(entry.BitrateInKilobits - bitrateInKilobits) <=
+            std::abs(nearestEntry->BitrateInKilobits - bitrateInKilobits)
+          )
+        );
+        if(isNearer) {
+          nearestEntry = &entry; // later entries win ties, they're more recent
+        }
+      }
+    }
+
+    if(nearestEntry == nullptr) {
+      return false;
+    }
+
+    for(std::size_t channelIndex = 0; channelIndex < channelCount; ++channelIndex) {
+      track.Channels[channelIndex].ClippingHalfwaves.CopyFrom(
+        nearestEntry->Channels[channelIndex]
+      );
+    }
+
+    return true;
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+} // namespace Nuclex::OpusTranscoder::Audio
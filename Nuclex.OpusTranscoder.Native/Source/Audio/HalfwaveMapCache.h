@@ -0,0 +1,124 @@
+#pragma region Apache License 2.0
+/*
+Nuclex Opus Transcoder
+Copyright (C) 2024 Markus Ewald / Nuclex Development Labs
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#pragma endregion // Apache License 2.0
+
+#ifndef NUCLEX_OPUSTRANSCODER_AUDIO_HALFWAVEMAPCACHE_H
+#define NUCLEX_OPUSTRANSCODER_AUDIO_HALFWAVEMAPCACHE_H
+
+#include "../Config.h"
+#include "./Track.h"
+
+#include <vector> // for std::vector
+#include <cstddef> // for std::byte
+#include <cstdint> // for std::uint64_t
+
+namespace Nuclex::OpusTranscoder::Audio {
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Remembers the clipping half-waves found by earlier declipping runs</summary>
+  /// <remarks>
+  ///   <para>
+  ///     The iterative declipper spends most of its time finding volume quotients that
+  ///     keep the half-waves below the signal ceiling after encoding. When the same input
+  ///     is transcoded again, say at another bitrate, this cache lets it start from where
+  ///     the last run ended instead of from scratch.
+  ///   </para>
+  ///   <para>
+  ///     Entries are keyed by a hash of the decoded input samples and a hash of all
+  ///     settings that change the samples before they're declipped. The bitrate is only
+  ///     recorded, so the entry with the nearest bitrate can be picked.
+  ///   </para>
+  /// </remarks>
+  class HalfwaveMapCache {
+
+    /// <summary>Maximum number of entries kept in a cache</summary>
+    public: static const std::size_t MaximumEntryCount;
+
+    /// <summary>Initializes a new, empty half-wave map cache</summary>
+    public: HalfwaveMapCache() = default;
+
+    /// <summary>Counts the number of entries stored in the cache</summary>
+    /// <returns>The number of entries in the cache</returns>
+    public: std::size_t CountEntries() const { return this->entries.size(); }
+
+    /// <summary>Replaces the contents of the cache with previously saved ones</summary>
+    /// <param name="contents">Contents obtained from an earlier call to Save()</param>
+    /// <remarks>
+    ///   Throws a <see cref="std::runtime_error" /> if the contents are damaged or were
+    ///   written by an incompatible version, leaving the cache empty.
+    /// </remarks>
+    public: void Load(const std::vector<std::byte> &contents);
+
+    /// <summary>Serializes the contents of the cache so they can be stored</summary>
+    /// <returns>The serialized contents of the cache</returns>
+    public: std::vector<std::byte> Save() const;
+
+    /// <summary>Stores the clipping half-waves of a track in the cache</summary>
+    /// <param name="sampleHash">Hash of the decoded input samples</param>
+    /// <param name="settingsHash">Hash of the settings the samples were processed with</param>
+    /// <param name="bitrateInKilobits">Bitrate the half-waves were declipped for</param>
+    /// <param name="track">Track whose clipping half-waves will be stored</param>
+    /// <remarks>
+    ///   An entry with the same hashes and bitrate is replaced. If the cache is full,
+    ///   the oldest entry is dropped.
+    /// </remarks>
+    public: void Store(
+      std::uint64_t sampleHash, std::uint64_t settingsHash, float bitrateInKilobits,
+      const Track &track
+    );
+
+    /// <summary>Restores the clipping half-waves of a track from the cache</summary>
+    /// <param name="sampleHash">Hash of the decoded input samples</param>
+    /// <param name="settingsHash">Hash of the settings the samples were processed with</param>
+    /// <param name="bitrateInKilobits">Bitrate the track will be encoded at</param>
+    /// <param name="track">Track whose clipping half-waves will be replaced</param>
+    /// <returns>True if a matching entry was found and restored</returns>
+    /// <remarks>
+    ///   Of all entries with matching hashes and channel count, the one recorded
+    ///   for the bitrate closest to the requested one is restored.
+    /// </remarks>
+    public: bool Restore(
+      std::uint64_t sampleHash, std::uint64_t settingsHash, float bitrateInKilobits,
+      Track &track
+    ) const;
+
+    /// <summary>Clipping half-waves recorded for one input and set of settings</summary>
+    private: struct Entry {
+
+      /// <summary>Hash of the decoded input samples</summary>
+      public: std::uint64_t SampleHash;
+      /// <summary>Hash of the settings the samples were processed with</summary>
+      public: std::uint64_t SettingsHash;
+      /// <summary>Bitrate the half-waves were declipped for</summary>
+      public: float BitrateInKilobits;
+      /// <summary>Clipping half-waves with their volume quotients in each channel</summary>
+      public: std::vector<ClippingHalfwaveTable> Channels;
+
+    };
+
+    /// <summary>All entries in the cache, from oldest to newest</summary>
+    private: std::vector<Entry> entries;
+
+  };
+
+  // ------------------------------------------------------------------------------------------- //
+
+} // namespace Nuclex::OpusTranscoder::Audio
+
+#endif // NUCLEX_OPUSTRANSCODER_AUDIO_HALFWAVEMAPCACHE_H
@@ -21,6 +21,15 @@ limitations under the License.
 #define NUCLEX_OPUSTRANSCODER_SOURCE 1
 
 #include "./HalfwaveTucker.h"
+#include "./WorkPartitioner.h"
+
+#include <Nuclex/Support/Threading/ThreadPool.h>
+
+#include <algorithm> // for std::min(), std::max(), std::clamp()
+#include <atomic> // for std::atomic
+#include <cmath> // for std::log(), std::exp(), std::abs()
+#include <future> // for std::future
+#include <functional> // for std::ref()
 
 namespace {
 
@@ -33,25 +42,86 @@ namespace {
 
   // ------------------------------------------------------------------------------------------- //
 
-  /// <summary>
-  ///   Checks if the volume quotient needs to be increased to fix clipping and either
-  ///   recalculates it based on the new information or returns the volume quotient
-  ///   that has proven to fix the clipping
-  /// </summary>
-  /// <param name="halfwave">
-  ///   Half-wave the will be updated or simply have its volume quotient returned
-  /// </param>
-  /// <returns>The volume quotient that should be applied to the half-wave</returns>
+  /// <summary>Weakest response of the peak to the quotient the prediction assumes</summary>
+  /// <remarks>
+  ///   On a logarithmic scale, a response of 1.0 means the peak shrinks by as many decibels
+  ///   as the quotient grows. Half-waves that barely moved between two attempts end up at
+  ///   this, letting the prediction go up to four times further than the remaining error.
+  /// </remarks>
+  const float MinimumPeakResponse = 0.25f;
+
+  /// <summary>Strongest response of the peak to the quotient the prediction assumes</summary>
+  const float MaximumPeakResponse = 4.0f;
+
+  /// <summary>Largest factor by which a prediction may increase a volume quotient</summary>
+  /// <remarks>
+  ///   The deeper a half-wave is tucked in, the more audible it becomes, so no single
+  ///   prediction may tuck in a half-wave by more than about 6 dB.
+  /// </remarks>
+  const float MaximumPredictedStep = 2.0f;
+
+  /// <summary>Smallest difference between two attempts that allows a prediction</summary>
   /// <remarks>
-  ///   We completely rely on the measured peak here that was collected by an earlier run
-  ///   of the clipping detector, rather than doing our own scan at this point. The reason
-  ///   is that, for the iterative de-clipper, the peaks will have been collected from
-  ///   the decoded Opus stream, but we need to apply them to the original channels,
-  ///   to avoid generation loss when we encode the Opus file once more.
-  /// </reamrks>
-  float updateAndReturnVolumeQuotient(
-    Nuclex::OpusTranscoder::Audio::ClippingHalfwave &halfwave
+  ///   Natural logarithm of the quotient ratio. Anything closer than this (about 0.001 dB)
+  ///   is mostly measurement noise and produces a useless secant.
+  /// </remarks>
+  const float MinimumSecantSpan = 0.0001f;
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Tucks in the clipping half-waves of a single channel</summary>
+  /// <param name="track">Track in which half-waves will be tucked</param>
+  /// <param name="channelIndex">Index of the channel whose half-waves will be tucked</param>
+  /// <param name="canceler">Token by which the operation can be signalled to cancel</param>
+  /// <param name="tuckedFrameCount">Counter that will be advanced for each half-wave</param>
+  void tuckClippingHalfwavesInChannel(
+    const std::shared_ptr<Nuclex::OpusTranscoder::Audio::Track> &track,
+    std::size_t channelIndex,
+    const std::shared_ptr<const Nuclex::Support::Threading::StopToken> &canceler,
+    std::atomic<std::uint64_t> &tuckedFrameCount
   ) {
+    using Nuclex::OpusTranscoder::Audio::ClippingHalfwave;
+    using Nuclex::OpusTranscoder::Audio::ClippingHalfwaveTable;
+    using Nuclex::OpusTranscoder::Audio::HalfwaveTucker;
+
+    std::size_t sampleStride = track->GetSampleStride();
+    ClippingHalfwaveTable &halfwaves = track->Channels[channelIndex].ClippingHalfwaves;
+    float *samples = track->GetChannelSamples(channelIndex);
+
+    std::size_t halfwaveCount = halfwaves.size();
+    for(std::size_t halfwaveIndex = 0; halfwaveIndex < halfwaveCount; ++halfwaveIndex) {
+      ClippingHalfwave halfwave = halfwaves[halfwaveIndex];
+
+      float quotient = HalfwaveTucker::UpdateVolumeQuotient(halfwave);
+      halfwaves.Update(halfwaveIndex, halfwave);
+
+      float *write = samples + (halfwave.PriorZeroCrossingIndex * sampleStride);
+      for(
+        std::uint64_t index = halfwave.PriorZeroCrossingIndex;
+        index < halfwave.NextZeroCrossingIndex;
+        ++index
+      ) {
+        write[0] /= quotient;
+        write += sampleStride;
+      }
+
+      canceler->ThrowIfCanceled();
+      tuckedFrameCount.fetch_add(
+        halfwave.NextZeroCrossingIndex - halfwave.PriorZeroCrossingIndex,
+        std::memory_order_relaxed
+      );
+    } // for each clipping halfwave identified
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+} // anonymous namespace
+
+namespace Nuclex::OpusTranscoder::Audio {
+
+  // ------------------------------------------------------------------------------------------- //
+
+  float HalfwaveTucker::UpdateVolumeQuotient(ClippingHalfwave &halfwave) {
     float quotient;
 
     if(1.0f < halfwave.PeakAmplitude) {
@@ -87,9 +157,77 @@ namespace {
 
   // ------------------------------------------------------------------------------------------- //
 
-} // anonymous namespace
+  float HalfwaveTucker::PredictVolumeQuotient(
+    ClippingHalfwave &halfwave, float safetyFactor /* = 1.0f */
+  ) {
+    if(1.0f < halfwave.PeakAmplitude) {
 
-namespace Nuclex::OpusTranscoder::Audio {
+      // Without earlier attempts, assume the peak shrinks in proportion to the quotient,
+      // which is exactly the calculation done by UpdateVolumeQuotient()
+      float step = halfwave.PeakAmplitude;
+
+      // If this half-wave was already tried with a different quotient, we know how far
+      // its peak moved in response. Draw a secant through both attempts to estimate how
+      // much further the quotient needs to go to bring the peak down to the ceiling.
+      bool hasPreviousAttempt = (
+        (halfwave.PreviousVolumeQuotient != 0.0f) && (halfwave.PreviousPeakAmplitude != 0.0f)
+      );
+      if(hasPreviousAttempt) {
+        float quotientSpan = std::log(halfwave.VolumeQuotient / halfwave.PreviousVolumeQuotient);
+        if(MinimumSecantSpan < std::abs(quotientSpan)) {
+          float response = (
+            std::log(halfwave.PreviousPeakAmplitude / halfwave.PeakAmplitude) / quotientSpan
+          );
+          response = std::clamp(response, MinimumPeakResponse, MaximumPeakResponse);
+          step = std::exp(std::log(halfwave.PeakAmplitude) / response);
+        }
+
+        // Only the extrapolated steps are limited. The proportional step is what
+        // UpdateVolumeQuotient() would do, so it stays as it is, however large.
+        step = std::min(step, MaximumPredictedStep);
+      }
+
+      step *= safetyFactor;
+
+      halfwave.PreviousPeakAmplitude = halfwave.PeakAmplitude;
+      halfwave.PreviousVolumeQuotient = halfwave.VolumeQuotient;
+      halfwave.VolumeQuotient *= step;
+
+    }
+
+    // Normalize to -0.001 dB rather than 0 dB, just like UpdateVolumeQuotient() does
+    return halfwave.VolumeQuotient / MinusOneThousandthDecibel;
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  bool HalfwaveTucker::HasClippingNeighbour(
+    const ClippingHalfwaveTable &halfwaves, std::size_t index, std::uint64_t maximumDistance
+  ) {
+    if(0 < index) {
+      if(1.0f < halfwaves.GetPeakAmplitude(index - 1)) {
+        std::uint64_t distance = (
+          halfwaves.GetPriorZeroCrossingIndex(index) - halfwaves.GetNextZeroCrossingIndex(index - 1)
+        );
+        if(distance <= maximumDistance) {
+          return true;
+        }
+      }
+    }
+
+    if(index + 1 < halfwaves.size()) {
+      if(1.0f < halfwaves.GetPeakAmplitude(index + 1)) {
+        std::uint64_t distance = (
+          halfwaves.GetPriorZeroCrossingIndex(index + 1) - halfwaves.GetNextZeroCrossingIndex(index)
+        );
+        if(distance <= maximumDistance) {
+          return true;
+        }
+      }
+    }
+
+    return false;
+  }
 
   // ------------------------------------------------------------------------------------------- //
 
@@ -98,22 +236,29 @@ namespace Nuclex::OpusTranscoder::Audio {
     const std::shared_ptr<const Nuclex::Support::Threading::StopToken> &canceler,
     Nuclex::Support::Events::Delegate<void(float)> &progressCallback
   ) {
+    track->AdviseAccessPattern(SampleAccessPattern::Random); // only touches the half-waves
+
     std::size_t channelCount = track->Channels.size();
-    std::size_t frameCount = track->Samples.size() / channelCount;
+    std::size_t frameCount = static_cast<std::size_t>(track->CountFrames());
+    std::size_t sampleStride = track->GetSampleStride();
+
+    // The samples are about to change, so the statistics won't describe them anymore
+    track->Statistics.Clear();
 
     for(std::size_t channelIndex = 0; channelIndex < channelCount; ++channelIndex) {
       Channel &channel = track->Channels[channelIndex];
-      float *samples = track->Samples.data() + channelIndex;
+      float *samples = track->GetChannelSamples(channelIndex);
 
       std::uint64_t skipStartIndex = 0;
 
       std::size_t halfwaveCount = channel.ClippingHalfwaves.size();
       for(std::size_t halfwaveIndex = 0; halfwaveIndex < halfwaveCount; ++halfwaveIndex) {
-        ClippingHalfwave &halfwave = channel.ClippingHalfwaves[halfwaveIndex];
+        ClippingHalfwave halfwave = channel.ClippingHalfwaves[halfwaveIndex];
 
-        samples += (halfwave.PriorZeroCrossingIndex - skipStartIndex) * channelCount;
+        samples += (halfwave.PriorZeroCrossingIndex - skipStartIndex) * sampleStride;
 
-        float quotient = updateAndReturnVolumeQuotient(halfwave);
+        float quotient = UpdateVolumeQuotient(halfwave);
+        channel.ClippingHalfwaves.Update(halfwaveIndex, halfwave);
 
         // Copy the data inside the clipping half-wave scaled down to the -1.0 .. +1.0 level
         for(
@@ -122,7 +267,7 @@ namespace Nuclex::OpusTranscoder::Audio {
           ++index
         ) {
           samples[0] /= quotient;
-          samples += channelCount;
+          samples += sampleStride;
 
           if((index & 0x2fff) == 0) {
             canceler->ThrowIfCanceled();
@@ -144,6 +289,131 @@ namespace Nuclex::OpusTranscoder::Audio {
   }
 
   // ------------------------------------------------------------------------------------------- //
+
+  void HalfwaveTucker::TuckClippingHalfwaves(
+    const std::shared_ptr<Track> &track,
+    Nuclex::Support::Threading::ThreadPool &threadPool,
+    const std::shared_ptr<const Nuclex::Support::Threading::StopToken> &canceler,
+    Nuclex::Support::Events::Delegate<void(float)> &progressCallback
+  ) {
+    track->AdviseAccessPattern(SampleAccessPattern::Random); // only touches the half-waves
+
+    std::size_t channelCount = track->Channels.size();
+
+    // Progress is measured in the number of frames covered by clipping half-waves,
+    // that's where the work happens. Figure out how many there are in total.
+    std::uint64_t totalFrameCount = 0;
+    for(std::size_t channelIndex = 0; channelIndex < channelCount; ++channelIndex) {
+      const ClippingHalfwaveTable &halfwaves = track->Channels[channelIndex].ClippingHalfwaves;
+      for(std::size_t index = 0; index < halfwaves.size(); ++index) {
+        totalFrameCount += (
+          halfwaves.GetNextZeroCrossingIndex(index) - halfwaves.GetPriorZeroCrossingIndex(index)
+        );
+      }
+    }
+
+    // The samples are about to change, so the statistics won't describe them anymore
+    track->Statistics.Clear();
+
+    // Each channel only touches its own half-waves and its own samples, so the channels
+    // can be processed independently of each other without any synchronization.
+    std::atomic<std::uint64_t> tuckedFrameCount(0);
+    std::vector<std::future<void>> futures;
+    futures.reserve(channelCount);
+    try {
+      for(std::size_t channelIndex = 0; channelIndex < channelCount; ++channelIndex) {
+        futures.push_back(
+          threadPool.Schedule(
+            &tuckClippingHalfwavesInChannel,
+            track, channelIndex, canceler, std::ref(tuckedFrameCount)
+          )
+        );
+      }
+    }
+    catch(const std::exception &) {
+      WorkPartitioner::WaitForAll(futures); // they reference our counter
+      throw;
+    }
+
+    WorkPartitioner::WaitForAll(futures, tuckedFrameCount, totalFrameCount, progressCallback);
+    for(std::size_t channelIndex = 0; channelIndex < channelCount; ++channelIndex) {
+      futures[channelIndex].get(); // rethrows errors from the channel's job
+    }
+
+    progressCallback(1.0f);
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  void HalfwaveTucker::ApplyVolumeQuotients(
+    const std::shared_ptr<Track> &track,
+    float *samples,
+    std::uint64_t startFrameIndex,
+    std::size_t frameCount
+  ) {
+    std::size_t channelCount = track->Channels.size();
+    std::uint64_t endFrameIndex = startFrameIndex + frameCount;
+
+    for(std::size_t channelIndex = 0; channelIndex < channelCount; ++channelIndex) {
+      const ClippingHalfwaveTable &halfwaves = track->Channels[channelIndex].ClippingHalfwaves;
+
+      // Half-waves are ordered and don't intersect, so their end indices are ordered, too.
+      // Look for the first half-wave that ends after the start of the section.
+      std::size_t halfwaveCount = halfwaves.size();
+      std::size_t halfwaveIndex = halfwaves.FindFirstEndingAfter(startFrameIndex);
+      while(halfwaveIndex < halfwaveCount) {
+        std::uint64_t halfwaveStartIndex = halfwaves.GetPriorZeroCrossingIndex(halfwaveIndex);
+        if(endFrameIndex <= halfwaveStartIndex) {
+          break;
+        }
+
+        // Same calculation as in UpdateVolumeQuotient(), so the results are identical
+        float quotient = halfwaves.GetVolumeQuotient(halfwaveIndex);
+        quotient /= MinusOneThousandthDecibel;
+
+        std::uint64_t firstIndex = std::max(halfwaveStartIndex, startFrameIndex);
+        std::uint64_t lastIndex = std::min(
+          halfwaves.GetNextZeroCrossingIndex(halfwaveIndex), endFrameIndex
+        );
+
+        float *write = samples + ((firstIndex - startFrameIndex) * channelCount) + channelIndex;
+        for(std::uint64_t index = firstIndex; index < lastIndex; ++index) {
+          write[0] /= quotient;
+          write += channelCount;
+        }
+
+        ++halfwaveIndex;
+      } // for each clipping half-wave overlapping the section
+    } // for each channel
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  bool HalfwaveTucker::OverlapsClippingHalfwaves(
+    const std::shared_ptr<Track> &track,
+    std::uint64_t startFrameIndex,
+    std::size_t frameCount
+  ) {
+    std::size_t channelCount = track->Channels.size();
+    std::uint64_t endFrameIndex = startFrameIndex + frameCount;
+
+    for(std::size_t channelIndex = 0; channelIndex < channelCount; ++channelIndex) {
+      const ClippingHalfwaveTable &halfwaves = track->Channels[channelIndex].ClippingHalfwaves;
+
+      // Same lookup as in ApplyVolumeQuotients(): the first half-wave ending after
+      // the start of the section overlaps it if it also begins before its end.
+      std::size_t halfwaveIndex = halfwaves.FindFirstEndingAfter(startFrameIndex);
+      if(halfwaveIndex < halfwaves.size()) {
+        if(halfwaves.GetPriorZeroCrossingIndex(halfwaveIndex) < endFrameIndex) {
+          return true;
+        }
+      }
+    } // for each channel
+
+    return false;
+  }
+
+  // ------------------------------------------------------------------------------------------- //
 #if 0 // DANGER! THIS METHOD CONTAINS AN AUDIO-CORRUPTING BUG!
   void HalfwaveTucker::TuckClippingHalfwaves(
     const std::shared_ptr<Track> &track,
@@ -188,7 +458,7 @@ namespace Nuclex::OpusTranscoder::Audio {
           } // if progress report interval hit
         } // for each sample up to the clipping half-wave
 
-        float quotient = updateAndReturnVolumeQuotient(halfwave);
+        float quotient = UpdateVolumeQuotient(halfwave);
 
         // Copy the data inside the clipping half-wave scaled down to the -1.0 .. +1.0 level
         for(
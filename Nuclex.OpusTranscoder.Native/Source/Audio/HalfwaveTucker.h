@@ -28,6 +28,16 @@ limitations under the License.
 
 #include <memory> // for std::shared_ptr
 
+namespace Nuclex::Support::Threading {
+
+  // ------------------------------------------------------------------------------------------- //
+
+  class ThreadPool;
+
+  // ------------------------------------------------------------------------------------------- //
+
+} // namespace Nuclex::Support::Threading
+
 namespace Nuclex::OpusTranscoder::Audio {
 
   // ------------------------------------------------------------------------------------------- //
@@ -35,6 +45,73 @@ namespace Nuclex::OpusTranscoder::Audio {
   /// <summary>Scales clipping half-waves down so they don't clip anymore</summary>
   class HalfwaveTucker {
 
+    /// <summary>
+    ///   Checks if the volume quotient needs to be increased to fix clipping and either
+    ///   recalculates it based on the new information or returns the volume quotient
+    ///   that has proven to fix the clipping
+    /// </summary>
+    /// <param name="halfwave">
+    ///   Half-wave the will be updated or simply have its volume quotient returned
+    /// </param>
+    /// <returns>The volume quotient that should be applied to the half-wave</returns>
+    /// <remarks>
+    ///   We completely rely on the measured peak here that was collected by an earlier run
+    ///   of the clipping detector, rather than doing our own scan at this point. The reason
+    ///   is that, for the iterative de-clipper, the peaks will have been collected from
+    ///   the decoded Opus stream, but we need to apply them to the original channels,
+    ///   to avoid generation loss when we encode the Opus file once more.
+    /// </remarks>
+    public: static float UpdateVolumeQuotient(ClippingHalfwave &halfwave);
+
+    /// <summary>
+    ///   Predicts the volume quotient that will bring a still clipping half-wave's peak
+    ///   below the signal ceiling from the quotients that have been tried on it so far
+    /// </summary>
+    /// <param name="halfwave">
+    ///   Half-wave that will be updated or simply have its volume quotient returned
+    /// </param>
+    /// <param name="safetyFactor">
+    ///   Additional factor by which the predicted quotient will be increased
+    /// </param>
+    /// <returns>The volume quotient that should be applied to the half-wave</returns>
+    /// <remarks>
+    ///   <para>
+    ///     <see cref="UpdateVolumeQuotient" /> assumes that the decoded peak shrinks in
+    ///     proportion to the quotient. The Opus codec doesn't respond that linearly, so
+    ///     some half-waves need many encode/decode rounds to get there that way.
+    ///   </para>
+    ///   <para>
+    ///     Once a half-wave has been tried with two different quotients, this method
+    ///     estimates how strongly its peak actually responds to the quotient (a secant
+    ///     through both attempts, on a logarithmic scale) and solves for the quotient
+    ///     that should hit the ceiling. The estimate is clamped and the step limited to
+    ///     about 6 dB, so a noisy measurement can't make the tucking overshoot wildly.
+    ///     Without two attempts, the step is not limited and the result is the same as
+    ///     that of <see cref="UpdateVolumeQuotient" />.
+    ///   </para>
+    /// </remarks>
+    public: static float PredictVolumeQuotient(
+      ClippingHalfwave &halfwave, float safetyFactor = 1.0f
+    );
+
+    /// <summary>
+    ///   Checks whether another half-wave that is still clipping lies close to a half-wave
+    /// </summary>
+    /// <param name="halfwaves">Half-waves of the channel the half-wave belongs to</param>
+    /// <param name="index">Index of the half-wave whose neighbours will be checked</param>
+    /// <param name="maximumDistance">
+    ///   Maximum number of frames between two half-waves for them to count as neighbours
+    /// </param>
+    /// <returns>True if a neighbouring half-wave is also still clipping</returns>
+    /// <remarks>
+    ///   The codec works on whole frames, so tucking in one half-wave also changes how
+    ///   the samples around it come out. Half-waves with clipping neighbours are more
+    ///   likely to be pushed back up by them and can be given a little safety margin.
+    /// </remarks>
+    public: static bool HasClippingNeighbour(
+      const ClippingHalfwaveTable &halfwaves, std::size_t index, std::uint64_t maximumDistance
+    );
+
     /// <summary>Tucks any half-waves that extend above the signal ceiling in</summary>
     /// <param name-"track">Track in which half-waves will be tucked</param>
     /// <param name="canceler">Token by which the operation can be signalled to cancel</param>
@@ -45,6 +122,56 @@ namespace Nuclex::OpusTranscoder::Audio {
       Nuclex::Support::Events::Delegate<void(float)> &progressCallback
     );
 
+    /// <summary>
+    ///   Tucks any half-waves that extend above the signal ceiling in, with each channel
+    ///   being processed by one thread of a thread pool
+    /// </summary>
+    /// <param name-"track">Track in which half-waves will be tucked</param>
+    /// <param name="threadPool">Thread pool on which the channels will be processed</param>
+    /// <param name="canceler">Token by which the operation can be signalled to cancel</param>
+    /// <param name="progressCallback">Callback to which progress reports should be sent</param>
+    public: static void TuckClippingHalfwaves(
+      const std::shared_ptr<Track> &track,
+      Nuclex::Support::Threading::ThreadPool &threadPool,
+      const std::shared_ptr<const Nuclex::Support::Threading::StopToken> &canceler,
+      Nuclex::Support::Events::Delegate<void(float)> &progressCallback
+    );
+
+    /// <summary>
+    ///   Scales the half-waves in a section of the track by their recorded volume quotients
+    /// </summary>
+    /// <param name-"track">Track whose clipping half-waves will be applied</param>
+    /// <param name="samples">Interleaved samples holding a section of the track</param>
+    /// <param name="startFrameIndex">Index of the first frame in the sample buffer</param>
+    /// <param name="frameCount">Number of frames held in the sample buffer</param>
+    /// <remarks>
+    ///   This does not update the volume quotients, it only applies them. After all quotients
+    ///   have been updated via <see cref="UpdateVolumeQuotient" />, applying them to a copy of
+    ///   the track piece by piece gives the same samples as tucking the whole track, so
+    ///   the encoder can be fed de-clipped chunks without a de-clipped copy of the track.
+    /// </remarks>
+    public: static void ApplyVolumeQuotients(
+      const std::shared_ptr<Track> &track,
+      float *samples,
+      std::uint64_t startFrameIndex,
+      std::size_t frameCount
+    );
+
+    /// <summary>Checks whether any clipping half-wave reaches into a section</summary>
+    /// <param name-"track">Track whose clipping half-waves will be checked</param>
+    /// <param name="startFrameIndex">Index of the first frame in the section</param>
+    /// <param name="frameCount">Number of frames in the section</param>
+    /// <returns>True if at least one clipping half-wave overlaps the section</returns>
+    /// <remarks>
+    ///   If this returns false, <see cref="ApplyVolumeQuotients" /> would leave
+    ///   the section as it is, so it can be used without making a copy.
+    /// </remarks>
+    public: static bool OverlapsClippingHalfwaves(
+      const std::shared_ptr<Track> &track,
+      std::uint64_t startFrameIndex,
+      std::size_t frameCount
+    );
+
 #if 0 // DANGER! THIS METHOD CONTAINS AN AUDIO-CORRUPTING BUG!
     /// <summary>Tucks any half-waves that extend above the signal ceiling in</summary>
     /// <param name-"track">Track in which half-waves will be tucked</param>
@@ -0,0 +1,103 @@
+#pragma region Apache License 2.0
+/*
+Nuclex Opus Transcoder
+Copyright (C) 2024 Markus Ewald / Nuclex Development Labs
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#pragma endregion // Apache License 2.0
+
+// If the application is compiled as a DLL, this ensures symbols are exported
+#define NUCLEX_OPUSTRANSCODER_SOURCE 1
+
+#include "./LittleEndian.h"
+
+#include <cstring> // for std::memcpy()
+#include <stdexcept> // for std::runtime_error
+
+namespace Nuclex::OpusTranscoder::Audio {
+
+  // ------------------------------------------------------------------------------------------- //
+
+  void LittleEndian::AppendFloat(std::vector<std::byte> &target, float value) {
+    std::uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    Append(target, bits);
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  void LittleEndian::AppendBlock(
+    std::vector<std::byte> &target, const std::vector<std::byte> &block
+  ) {
+    Append(target, static_cast<std::uint64_t>(block.size()));
+    target.insert(target.end(), block.begin(), block.end());
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  void LittleEndian::AppendString(std::vector<std::byte> &target, const std::string &value) {
+    Append(target, static_cast<std::uint32_t>(value.length()));
+    for(char character : value) {
+      target.push_back(static_cast<std::byte>(character));
+    }
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  float LittleEndianReader::ReadFloat() {
+    std::uint32_t bits = Read<std::uint32_t>();
+
+    float value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  std::vector<std::byte> LittleEndianReader::ReadBlock() {
+    std::uint64_t length = Read<std::uint64_t>();
+    require(length);
+
+    std::vector<std::byte>::const_iterator start = this->contents.begin() + this->offset;
+    std::vector<std::byte> block(start, start + static_cast<std::ptrdiff_t>(length));
+    this->offset += static_cast<std::size_t>(length);
+
+    return block;
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  std::string LittleEndianReader::ReadString() {
+    std::uint32_t length = Read<std::uint32_t>();
+    require(length);
+
+    std::string result(
+      reinterpret_cast<const char *>(this->contents.data() + this->offset), length
+    );
+    this->offset += length;
+
+    return result;
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  void LittleEndianReader::require(std::uint64_t byteCount) const {
+    if(this->contents.size() - this->offset < byteCount) {
+      throw std::runtime_error(this->truncationMessage);
+    }
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+} // namespace Nuclex::OpusTranscoder::Audio
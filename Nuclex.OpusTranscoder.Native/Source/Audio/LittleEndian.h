@@ -0,0 +1,148 @@
+#pragma region Apache License 2.0
+/*
+Nuclex Opus Transcoder
+Copyright (C) 2024 Markus Ewald / Nuclex Development Labs
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#pragma endregion // Apache License 2.0
+
+#ifndef NUCLEX_OPUSTRANSCODER_AUDIO_LITTLEENDIAN_H
+#define NUCLEX_OPUSTRANSCODER_AUDIO_LITTLEENDIAN_H
+
+#include "../Config.h"
+
+#include <string> // for std::string
+#include <vector> // for std::vector
+#include <cstddef> // for std::byte, std::size_t
+#include <cstdint> // for std::uint64_t
+
+namespace Nuclex::OpusTranscoder::Audio {
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Writes and reads the little endian values of the saved file formats</summary>
+  /// <remarks>
+  ///   The Ogg container, the metadata and half-wave map caches and the declipping
+  ///   checkpoints all store their integers in little endian byte order. Values are
+  ///   assembled byte by byte, so the files come out the same on any CPU.
+  /// </remarks>
+  class LittleEndian {
+
+    /// <summary>Reads a little endian integer from a memory location</summary>
+    /// <typeparam name="TInteger">Type of integer that will be read</typeparam>
+    /// <param name="data">Memory location the integer will be read from</param>
+    /// <returns>The integer read from the memory location</returns>
+    public: template<typename TInteger>
+    static TInteger Read(const std::byte *data) {
+      TInteger result = 0;
+      for(std::size_t index = 0; index < sizeof(TInteger); ++index) {
+        result |= static_cast<TInteger>(std::to_integer<std::uint8_t>(data[index])) << (index * 8);
+      }
+      return result;
+    }
+
+    /// <summary>Appends a little endian integer to a byte vector</summary>
+    /// <typeparam name="TInteger">Type of integer that will be written</typeparam>
+    /// <param name="target">Byte vector the integer will be appended to</param>
+    /// <param name="value">Value that will be appended</param>
+    public: template<typename TInteger>
+    static void Append(std::vector<std::byte> &target, TInteger value) {
+      for(std::size_t index = 0; index < sizeof(TInteger); ++index) {
+        target.push_back(static_cast<std::byte>((value >> (index * 8)) & 0xff));
+      }
+    }
+
+    /// <summary>Appends a floating point value to a byte vector</summary>
+    /// <param name="target">Byte vector the value will be appended to</param>
+    /// <param name="value">Value that will be appended</param>
+    public: static void AppendFloat(std::vector<std::byte> &target, float value);
+
+    /// <summary>Appends a length-prefixed block of bytes to a byte vector</summary>
+    /// <param name="target">Byte vector the block will be appended to</param>
+    /// <param name="block">Block of bytes that will be appended</param>
+    public: static void AppendBlock(
+      std::vector<std::byte> &target, const std::vector<std::byte> &block
+    );
+
+    /// <summary>Appends a string with a 32 bit length prefix to a byte vector</summary>
+    /// <param name="target">Byte vector the string will be appended to</param>
+    /// <param name="value">String that will be appended</param>
+    public: static void AppendString(std::vector<std::byte> &target, const std::string &value);
+
+  };
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Reads little endian values from saved contents, checking for truncation</summary>
+  class LittleEndianReader {
+
+    /// <summary>Initializes a new reader for the specified contents</summary>
+    /// <param name="contents">Saved contents that will be read</param>
+    /// <param name="truncationMessage">
+    ///   Error message that will be thrown when reading past the end of the contents
+    /// </param>
+    public: LittleEndianReader(
+      const std::vector<std::byte> &contents, const char *truncationMessage
+    ) :
+      contents(contents),
+      offset(0),
+      truncationMessage(truncationMessage) {}
+
+    /// <summary>Reads a little endian integer from the contents</summary>
+    /// <typeparam name="TInteger">Type of integer that will be read</typeparam>
+    /// <returns>The integer that was read</returns>
+    public: template<typename TInteger>
+    TInteger Read() {
+      require(sizeof(TInteger));
+
+      TInteger result = LittleEndian::Read<TInteger>(this->contents.data() + this->offset);
+      this->offset += sizeof(TInteger);
+
+      return result;
+    }
+
+    /// <summary>Reads a floating point value from the contents</summary>
+    /// <returns>The floating point value that was read</returns>
+    public: float ReadFloat();
+
+    /// <summary>Reads a length-prefixed block of bytes from the contents</summary>
+    /// <returns>The block of bytes that was read</returns>
+    public: std::vector<std::byte> ReadBlock();
+
+    /// <summary>Reads a string with a 32 bit length prefix from the contents</summary>
+    /// <returns>The string that was read</returns>
+    public: std::string ReadString();
+
+    /// <summary>Checks whether any contents remain to be read</summary>
+    /// <returns>True if the end of the contents has been reached</returns>
+    public: bool IsAtEnd() const { return (this->offset == this->contents.size()); }
+
+    /// <summary>Ensures that the specified number of bytes are left to read</summary>
+    /// <param name="byteCount">Number of bytes that should be left</param>
+    private: void require(std::uint64_t byteCount) const;
+
+    /// <summary>Contents being read</summary>
+    private: const std::vector<std::byte> &contents;
+    /// <summary>Offset of the next byte that will be read</summary>
+    private: std::size_t offset;
+    /// <summary>Error message thrown when the contents are too short</summary>
+    private: const char *truncationMessage;
+
+  };
+
+  // ------------------------------------------------------------------------------------------- //
+
+} // namespace Nuclex::OpusTranscoder::Audio
+
+#endif // NUCLEX_OPUSTRANSCODER_AUDIO_LITTLEENDIAN_H
@@ -0,0 +1,298 @@
+#pragma region Apache License 2.0
+/*
+Nuclex Opus Transcoder
+Copyright (C) 2024 Markus Ewald / Nuclex Development Labs
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#pragma endregion // Apache License 2.0
+
+// If the application is compiled as a DLL, this ensures symbols are exported
+#define NUCLEX_OPUSTRANSCODER_SOURCE 1
+
+#include "./MappedFile.h"
+
+#include <algorithm> // for std::copy_n(), std::min()
+#include <limits> // for std::numeric_limits
+#include <stdexcept> // for std::runtime_error
+
+#if defined(NUCLEX_OPUSTRANSCODER_WINDOWS)
+#include <Nuclex/Support/Text/StringConverter.h> // for StringConverter::WideFromUtf8()
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h> // for ::CreateFileW(), ::CreateFileMappingW(), ::MapViewOfFile()
+#else
+#include <fcntl.h> // for ::open()
+#include <sys/mman.h> // for ::mmap(), ::munmap(), ::madvise()
+#include <sys/stat.h> // for ::fstat()
+#include <sys/vfs.h> // for ::fstatfs()
+#include <unistd.h> // for ::close()
+#endif
+
+namespace {
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Makes sure a file is small enough to be mapped in one piece</summary>
+  /// <param name="size">Size of the file in bytes</param>
+  void requireMappableSize(std::uint64_t size) {
+    if(size > static_cast<std::uint64_t>(std::numeric_limits<std::size_t>::max())) {
+      throw std::runtime_error(u8"File is too large to be mapped into memory");
+    }
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+#if !defined(NUCLEX_OPUSTRANSCODER_WINDOWS)
+  /// <summary>Checks whether a file system's contents can change behind this host's back</summary>
+  /// <param name="fileSystemType">Magic number of the file system reported by statfs()</param>
+  /// <returns>True if the file system is served by another host or process</returns>
+  /// <remarks>
+  ///   On these, the file can be truncated without the local kernel knowing in advance,
+  ///   and a read through the mapping would then raise SIGBUS instead of failing.
+  ///   Not all of these magic numbers are in every kernel's headers, thus they're
+  ///   spelled out here.
+  /// </remarks>
+  bool isRemoteFileSystem(unsigned long fileSystemType) {
+    switch(fileSystemType) {
+      case 0x6969UL: // NFS
+      case 0x517BUL: // SMB
+      case 0xFF534D42UL: // CIFS
+      case 0xFE534D42UL: // SMB2
+      case 0x65735546UL: // FUSE (sshfs, rclone and the like)
+      case 0x01021997UL: // 9P (also WSL and virtual machine shares)
+      case 0x00C36400UL: // Ceph
+      case 0x5346414FUL: // AFS
+      case 0x6B414653UL: // kAFS
+      case 0x73757245UL: // Coda
+      case 0x564CUL: // NCP
+      case 0x47504653UL: // GPFS
+      case 0x0BD00BD0UL: // Lustre
+      case 0x19830326UL: // FhGFS / BeeGFS
+        return true;
+      default:
+        return false;
+    }
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Makes sure a file is a regular file on a local file system</summary>
+  /// <param name="fileDescriptor">Descriptor of the opened file that will be checked</param>
+  /// <param name="fileStatus">Status of the file as reported by fstat()</param>
+  void requireLocalRegularFile(int fileDescriptor, const struct ::stat &fileStatus) {
+    if(!S_ISREG(fileStatus.st_mode)) {
+      throw std::runtime_error(u8"Only regular files are memory mapped");
+    }
+
+    struct ::statfs fileSystemStatus;
+    if(::fstatfs(fileDescriptor, &fileSystemStatus) != 0) {
+      throw std::runtime_error(u8"Could not determine the file system the file is on");
+    }
+    if(isRemoteFileSystem(static_cast<unsigned long>(fileSystemStatus.f_type))) {
+      throw std::runtime_error(u8"Files on network file systems are not memory mapped");
+    }
+  }
+#endif // !defined(NUCLEX_OPUSTRANSCODER_WINDOWS)
+
+  // ------------------------------------------------------------------------------------------- //
+
+} // anonymous namespace
+
+namespace Nuclex::OpusTranscoder::Audio {
+
+  // ------------------------------------------------------------------------------------------- //
+
+  std::shared_ptr<const Nuclex::Audio::Storage::VirtualFile> MappedFile::OpenForReading(
+    const std::string &path, bool promiseSequentialAccess /* = false */
+  ) {
+#if NUCLEX_OPUSTRANSCODER_MAP_INPUT_FILES
+    try {
+      return std::make_shared<MappedFile>(path, promiseSequentialAccess);
+    }
+    catch(const std::exception &) {
+      // Open the file normally, which also reports the error if the file doesn't exist
+    }
+#endif
+    return Nuclex::Audio::Storage::VirtualFile::OpenRealFileForReading(
+      path, promiseSequentialAccess
+    );
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+#if defined(NUCLEX_OPUSTRANSCODER_WINDOWS)
+  MappedFile::MappedFile(const std::string &path, bool promiseSequentialAccess /* = false */) :
+    contents(nullptr),
+    size(0) {
+    std::wstring widePath = Nuclex::Support::Text::StringConverter::WideFromUtf8(path);
+
+    // Other processes may keep reading the file, but it must not change under the mapping
+    DWORD flags = FILE_ATTRIBUTE_NORMAL;
+    if(promiseSequentialAccess) {
+      flags |= FILE_FLAG_SEQUENTIAL_SCAN;
+    }
+    HANDLE fileHandle = ::CreateFileW(
+      widePath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, flags, nullptr
+    );
+    if(fileHandle == INVALID_HANDLE_VALUE) {
+      throw std::runtime_error(u8"Could not open file for memory mapping");
+    }
+
+    LARGE_INTEGER fileSize;
+    if(::GetFileSizeEx(fileHandle, &fileSize) == FALSE) {
+      ::CloseHandle(fileHandle);
+      throw std::runtime_error(u8"Could not determine the size of the file");
+    }
+    this->size = static_cast<std::uint64_t>(fileSize.QuadPart);
+
+    // Windows refuses to create mappings of empty files, but there's nothing to map anyway
+    if(this->size == 0) {
+      ::CloseHandle(fileHandle);
+      return;
+    }
+
+    try {
+      requireMappableSize(this->size);
+    }
+    catch(const std::exception &) {
+      ::CloseHandle(fileHandle);
+      throw;
+    }
+
+    HANDLE mappingHandle = ::CreateFileMappingW(
+      fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr
+    );
+    ::CloseHandle(fileHandle); // the mapping keeps the file open
+    if(mappingHandle == nullptr) {
+      throw std::runtime_error(u8"Could not create a memory mapping of the file");
+    }
+
+    void *memory = ::MapViewOfFile(
+      mappingHandle, FILE_MAP_READ, 0, 0, static_cast<SIZE_T>(this->size)
+    );
+    ::CloseHandle(mappingHandle); // the view keeps the mapping alive
+    if(memory == nullptr) {
+      throw std::runtime_error(u8"Could not map the file into memory");
+    }
+
+    this->contents = static_cast<const std::byte *>(memory);
+  }
+#else
+  MappedFile::MappedFile(const std::string &path, bool promiseSequentialAccess /* = false */) :
+    contents(nullptr),
+    size(0) {
+    int fileDescriptor = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if(fileDescriptor == -1) {
+      throw std::runtime_error(u8"Could not open file for memory mapping");
+    }
+
+    struct ::stat fileStatus;
+    if(::fstat(fileDescriptor, &fileStatus) != 0) {
+      ::close(fileDescriptor);
+      throw std::runtime_error(u8"Could not determine the size of the file");
+    }
+    this->size = static_cast<std::uint64_t>(fileStatus.st_size);
+
+    // Pipes and devices have no size to map, and files on network shares can shrink
+    // without notice, which would turn a read into a SIGBUS. The caller reads those
+    // through the file instead.
+    try {
+      requireLocalRegularFile(fileDescriptor, fileStatus);
+    }
+    catch(const std::exception &) {
+      ::close(fileDescriptor);
+      throw;
+    }
+
+    // mmap() refuses zero-length mappings, but there's nothing to map anyway
+    if(this->size == 0) {
+      ::close(fileDescriptor);
+      return;
+    }
+
+    try {
+      requireMappableSize(this->size);
+    }
+    catch(const std::exception &) {
+      ::close(fileDescriptor);
+      throw;
+    }
+
+    void *memory = ::mmap(
+      nullptr, static_cast<std::size_t>(this->size), PROT_READ, MAP_PRIVATE, fileDescriptor, 0
+    );
+    ::close(fileDescriptor); // the mapping keeps the file open
+    if(memory == MAP_FAILED) {
+      throw std::runtime_error(u8"Could not map the file into memory");
+    }
+
+    // This is only a hint, if the kernel doesn't take it, reading still works
+    if(promiseSequentialAccess) {
+      ::madvise(memory, static_cast<std::size_t>(this->size), MADV_SEQUENTIAL);
+    }
+
+    this->contents = static_cast<const std::byte *>(memory);
+  }
+#endif
+
+  // ------------------------------------------------------------------------------------------- //
+
+  MappedFile::~MappedFile() {
+    if(this->contents != nullptr) {
+#if defined(NUCLEX_OPUSTRANSCODER_WINDOWS)
+      ::UnmapViewOfFile(this->contents);
+#else
+      ::munmap(const_cast<std::byte *>(this->contents), static_cast<std::size_t>(this->size));
+#endif
+    }
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  void MappedFile::ReadAt(
+    std::uint64_t start, std::size_t byteCount, std::byte *buffer
+  ) const {
+    if((start > this->size) || (this->size - start < byteCount)) {
+      throw std::runtime_error(u8"Attempted to read beyond the end of the file");
+    }
+
+    std::copy_n(this->contents + start, byteCount, buffer);
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  std::size_t MappedFile::ReadSpan(
+    std::uint64_t start, std::size_t byteCount, const std::byte *&data
+  ) const {
+    if(start > this->size) {
+      throw std::runtime_error(u8"Attempted to read beyond the end of the file");
+    }
+
+    data = this->contents + start;
+    return static_cast<std::size_t>(std::min<std::uint64_t>(this->size - start, byteCount));
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  void MappedFile::WriteAt(
+    std::uint64_t start, std::size_t byteCount, const std::byte *buffer
+  ) {
+    (void)start;
+    (void)byteCount;
+    (void)buffer;
+    throw std::runtime_error(u8"Memory-mapped input files can not be written to");
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+} // namespace Nuclex::OpusTranscoder::Audio
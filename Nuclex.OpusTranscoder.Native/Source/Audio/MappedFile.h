@@ -0,0 +1,133 @@
+#pragma region Apache License 2.0
+/*
+Nuclex Opus Transcoder
+Copyright (C) 2024 Markus Ewald / Nuclex Development Labs
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#pragma endregion // Apache License 2.0
+
+#ifndef NUCLEX_OPUSTRANSCODER_AUDIO_MAPPEDFILE_H
+#define NUCLEX_OPUSTRANSCODER_AUDIO_MAPPEDFILE_H
+
+#include "../Config.h"
+#include "./SpanningFile.h"
+
+#include <Nuclex/Audio/Storage/VirtualFile.h>
+
+#include <string> // for std::string
+#include <memory> // for std::shared_ptr
+#include <cstddef> // for std::byte
+
+namespace Nuclex::OpusTranscoder::Audio {
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Serves a file on disk through a read-only memory mapping</summary>
+  /// <remarks>
+  ///   <para>
+  ///     The operating system pages the file in as it is accessed, so reading from it
+  ///     is a copy out of the page cache without a system call for each read. Readers
+  ///     that go through <see cref="SpanningFile" /> don't even need that copy. For
+  ///     uncompressed input files, this makes decoding them about as cheap as touching
+  ///     their pages.
+  ///   </para>
+  ///   <para>
+  ///     The file must not be shortened by another process while it is mapped. Reading
+  ///     a page that is no longer backed by the file raises SIGBUS on POSIX systems
+  ///     (and an in-page error on Windows), which ends the process rather than throwing.
+  ///     That's why the transcoder only maps input files, never files it writes to.
+  ///   </para>
+  ///   <para>
+  ///     To keep that risk small, only regular files are mapped. On Linux, files on
+  ///     network and FUSE file systems are refused as well, since these can change
+  ///     from another host without the local kernel knowing. A local process truncating
+  ///     an input file during the transcode can still crash it.
+  ///   </para>
+  /// </remarks>
+  class MappedFile :
+    public Nuclex::Audio::Storage::VirtualFile,
+    public SpanningFile {
+
+    /// <summary>Opens a file for reading, through a memory mapping if possible</summary>
+    /// <param name="path">Path of the file that will be opened</param>
+    /// <param name="promiseSequentialAccess">
+    ///   Whether the file will be read from start to end
+    /// </param>
+    /// <returns>The opened file</returns>
+    /// <remarks>
+    ///   If mapping input files is disabled in Config.h or the file can't or shouldn't
+    ///   be mapped (it's not a regular file or lies on a network file system), the file
+    ///   is opened through <code>VirtualFile::OpenRealFileForReading()</code> instead.
+    /// </remarks>
+    public: static std::shared_ptr<const Nuclex::Audio::Storage::VirtualFile> OpenForReading(
+      const std::string &path, bool promiseSequentialAccess = false
+    );
+
+    /// <summary>Opens a file and maps it into memory</summary>
+    /// <param name="path">Path of the file that will be mapped</param>
+    /// <param name="promiseSequentialAccess">
+    ///   Whether the file will be read from start to end, so the operating system
+    ///   can read ahead further and drop pages behind the reader sooner
+    /// </param>
+    /// <remarks>
+    ///   Throws a <see cref="std::runtime_error" /> if the file can't be opened or
+    ///   isn't considered safe to map, so the caller can fall back to reading it.
+    /// </remarks>
+    public: MappedFile(const std::string &path, bool promiseSequentialAccess = false);
+
+    /// <summary>Unmaps the file</summary>
+    public: ~MappedFile() override;
+
+    /// <summary>Determines the current size of the file in bytes</summary>
+    /// <returns>The size of the file in bytes</returns>
+    public: std::uint64_t GetSize() const override { return this->size; }
+
+    /// <summary>Reads data from the file</summary>
+    /// <param name="start">Offset in the file at which to begin reading</param>
+    /// <param name="byteCount">Number of bytes that will be read</param>
+    /// <parma name="buffer">Buffer into which the data will be read</param>
+    public: void ReadAt(
+      std::uint64_t start, std::size_t byteCount, std::byte *buffer
+    ) const override;
+
+    /// <summary>Provides direct access to the contents of the file at an offset</summary>
+    /// <param name="start">Offset in the file of the first byte that is needed</param>
+    /// <param name="byteCount">Number of bytes that are needed</param>
+    /// <param name="data">Receives the address of the byte at the offset</param>
+    /// <returns>The number of bytes that can be read from the address</returns>
+    public: std::size_t ReadSpan(
+      std::uint64_t start, std::size_t byteCount, const std::byte *&data
+    ) const override;
+
+    /// <summary>Writes data into the file</summary>
+    /// <param name="start">Offset at which writing will begin in the file</param>
+    /// <param name="byteCount">Number of bytes that should be written</param>
+    /// <param name="buffer">Buffer holding the data that should be written</param>
+    /// <remarks>Always throws, the file is mapped for reading only</remarks>
+    public: void WriteAt(
+      std::uint64_t start, std::size_t byteCount, const std::byte *buffer
+    ) override;
+
+    /// <summary>Address at which the file's contents are mapped, null if empty</summary>
+    private: const std::byte *contents;
+    /// <summary>Size of the file in bytes</summary>
+    private: std::uint64_t size;
+
+  };
+
+  // ------------------------------------------------------------------------------------------- //
+
+} // namespace Nuclex::OpusTranscoder::Audio
+
+#endif // NUCLEX_OPUSTRANSCODER_AUDIO_MAPPEDFILE_H
@@ -0,0 +1,71 @@
+#pragma region Apache License 2.0
+/*
+Nuclex Opus Transcoder
+Copyright (C) 2024 Markus Ewald / Nuclex Development Labs
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#pragma endregion // Apache License 2.0
+
+// If the application is compiled as a DLL, this ensures symbols are exported
+#define NUCLEX_OPUSTRANSCODER_SOURCE 1
+
+#include "./MemoryFile.h"
+
+#include <cassert> // for assert()
+#include <algorithm> // for std::copy_n(), std::min()
+
+namespace Nuclex::OpusTranscoder::Audio {
+
+  // ------------------------------------------------------------------------------------------- //
+
+  void MemoryFile::ReadAt(
+    std::uint64_t start, std::size_t byteCount, std::byte *buffer
+  ) const {
+    assert((start < this->contents.size()) && u8"Read starts within file boundaries");
+    assert((this->contents.size() >= start + byteCount) && u8"Read ends within file boundaries");
+    std::copy_n(this->contents.data() + start, byteCount, buffer);
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  std::size_t MemoryFile::ReadSpan(
+    std::uint64_t start, std::size_t byteCount, const std::byte *&data
+  ) const {
+    assert((start <= this->contents.size()) && u8"Span starts within file boundaries");
+
+    data = this->contents.data() + start;
+    return static_cast<std::size_t>(
+      std::min<std::uint64_t>(this->contents.size() - start, byteCount)
+    );
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  void MemoryFile::WriteAt(
+    std::uint64_t start, std::size_t byteCount, const std::byte *buffer
+  ) {
+    if(start < this->contents.size()) {
+      std::size_t byteCountToCopy = std::min(this->contents.size() - start, byteCount);
+      std::copy_n(buffer, byteCountToCopy, this->contents.data() + start);
+
+      buffer += byteCountToCopy;
+      byteCount -= byteCountToCopy;
+    }
+
+    this->contents.insert(this->contents.end(), buffer, buffer + byteCount);
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+} // namespace Nuclex::OpusTranscoder::Audio
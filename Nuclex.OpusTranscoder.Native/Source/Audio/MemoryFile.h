@@ -0,0 +1,98 @@
+#pragma region Apache License 2.0
+/*
+Nuclex Opus Transcoder
+Copyright (C) 2024 Markus Ewald / Nuclex Development Labs
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#pragma endregion // Apache License 2.0
+
+#ifndef NUCLEX_OPUSTRANSCODER_AUDIO_MEMORYFILE_H
+#define NUCLEX_OPUSTRANSCODER_AUDIO_MEMORYFILE_H
+
+#include "../Config.h"
+#include "./SpanningFile.h"
+
+#include <Nuclex/Audio/Storage/VirtualFile.h>
+
+#include <vector> // for std::vector
+#include <cstddef> // for std::byte
+
+namespace Nuclex::OpusTranscoder::Audio {
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Serves data contained in a byte buffer as a virtual file</summary>
+  class MemoryFile :
+    public Nuclex::Audio::Storage::VirtualFile,
+    public SpanningFile {
+
+    /// <summary>Initializes a new memory buffer based file</summary>
+    /// <param name="contents">Memory buffer holding the data of the virtual file</param>
+    public: MemoryFile(std::vector<std::byte> &&contents) :
+      contents(std::move(contents)) {}
+
+    /// <summary>Initializes a new memory buffer based file</summary>
+    public: MemoryFile() :
+      contents() {}
+
+    /// <summary>Frees all memory used by the instance</summary>
+    public: ~MemoryFile() override = default;
+
+    /// <summary>Determines the current size of the file in bytes</summary>
+    /// <returns>The size of the file in bytes</returns>
+    public: std::uint64_t GetSize() const override { return this->contents.size(); }
+
+    /// <summary>Reserves memory so the file can grow without reallocating</summary>
+    /// <param name="byteCount">Number of bytes the file should be able to hold</param>
+    public: void Reserve(std::size_t byteCount) { this->contents.reserve(byteCount); }
+
+    /// <summary>Provides direct access to the memory buffer holding the file's contents</summary>
+    /// <returns>The memory buffer holding the file's contents</returns>
+    public: const std::vector<std::byte> &GetContents() const { return this->contents; }
+
+    /// <summary>Reads data from the file</summary>
+    /// <param name="start">Offset in the file at which to begin reading</param>
+    /// <param name="byteCount">Number of bytes that will be read</param>
+    /// <parma name="buffer">Buffer into which the data will be read</param>
+    public: void ReadAt(
+      std::uint64_t start, std::size_t byteCount, std::byte *buffer
+    ) const override;
+
+    /// <summary>Provides direct access to the contents of the file at an offset</summary>
+    /// <param name="start">Offset in the file of the first byte that is needed</param>
+    /// <param name="byteCount">Number of bytes that are needed</param>
+    /// <param name="data">Receives the address of the byte at the offset</param>
+    /// <returns>The number of bytes that can be read from the address</returns>
+    public: std::size_t ReadSpan(
+      std::uint64_t start, std::size_t byteCount, const std::byte *&data
+    ) const override;
+
+    /// <summary>Writes data into the file</summary>
+    /// <param name="start">Offset at which writing will begin in the file</param>
+    /// <param name="byteCount">Number of bytes that should be written</param>
+    /// <param name="buffer">Buffer holding the data that should be written</param>
+    public: void WriteAt(
+      std::uint64_t start, std::size_t byteCount, const std::byte *buffer
+    ) override;
+
+    /// <summary>Memory buffer the virtual file implementation is serving data from</summary>
+    private: std::vector<std::byte> contents;
+
+  };
+
+  // ------------------------------------------------------------------------------------------- //
+
+} // namespace Nuclex::OpusTranscoder::Audio
+
+#endif // NUCLEX_OPUSTRANSCODER_AUDIO_MEMORYFILE_H
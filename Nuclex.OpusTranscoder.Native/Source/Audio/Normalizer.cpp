@@ -21,6 +21,16 @@ limitations under the License.
 #define NUCLEX_OPUSTRANSCODER_SOURCE 1
 
 #include "./Normalizer.h"
+#include "./WorkPartitioner.h"
+
+#include <Nuclex/Support/Threading/ThreadPool.h>
+
+#include <atomic> // for std::atomic
+#include <cmath> // for std::abs()
+#include <stdexcept> // for std::runtime_error
+#include <future> // for std::future
+#include <functional> // for std::ref()
+#include <vector> // for std::vector
 
 namespace {
 
@@ -33,85 +43,125 @@ namespace {
 
   // ------------------------------------------------------------------------------------------- //
 
-} // anonymous namespace
-
-namespace Nuclex::OpusTranscoder::Audio {
+  /// <summary>Number of frames after which progress is reported and cancellation checked</summary>
+  const std::size_t ProgressReportFrameCount = 0x3000;
 
   // ------------------------------------------------------------------------------------------- //
 
-  void Normalizer::Normalize(
-    const std::shared_ptr<Track> &track,
-    bool allowVolumeDecrease,
+  /// <summary>Looks for the highest amplitude in a track's bass and non-bass channels</summary>
+  /// <param name="track">Track that will be scanned for its peak amplitudes</param>
+  /// <param name="maximumAmplitude">Highest amplitude of all non-bass channels</param>
+  /// <param name="maximumBassAmplitude">Highest amplitude of all bass channels</param>
+  /// <param name="canceler">Token by which the operation can be signalled to cancel</param>
+  /// <param name="progressCallback">Callback to which progress reports should be sent</param>
+  /// <param name="progressScale">Factor by which the reported progress is scaled</param>
+  /// <param name="progressOffset">Offset that is added to the reported progress</param>
+  void scanPeakAmplitudes(
+    const std::shared_ptr<Nuclex::OpusTranscoder::Audio::Track> &track,
+    float &maximumAmplitude, float &maximumBassAmplitude,
     const std::shared_ptr<const Nuclex::Support::Threading::StopToken> &canceler,
-    Nuclex::Support::Events::Delegate<void(float)> &progressCallback
+    Nuclex::Support::Events::Delegate<void(float)> &progressCallback,
+    float progressScale, float progressOffset
   ) {
     using Nuclex::Audio::ChannelPlacement;
+    using Nuclex::OpusTranscoder::Audio::Channel;
 
     std::size_t channelCount = track->Channels.size();
-    std::size_t frameCount = track->Samples.size() / channelCount;
-
-    float maximumAmplitude = 0.0f;
-    float maximumBassAmplitude = 0.0f;
+    std::size_t frameCount = static_cast<std::size_t>(track->CountFrames());
+    std::size_t sampleStride = track->GetSampleStride();
 
-    // Stage 1: scan all channels to find their peak amplitudes. Keep bass and
-    // normal peak separate, we'll normalize the bass independently.
+    // Scan all channels to find their peak amplitudes. Keep bass and normal peak
+    // separate, we'll normalize the bass independently.
     for(std::size_t channelIndex = 0; channelIndex < channelCount; ++channelIndex) {
       Channel &channel = track->Channels[channelIndex];
-      const float *samples = track->Samples.data() + channelIndex;
+      const float *samples = track->GetChannelSamples(channelIndex);
 
       if(channel.Placement == ChannelPlacement::LowFrequencyEffects) {
         for(std::size_t frameIndex = 0; frameIndex < frameCount; ++frameIndex) {
-          float amplitude = samples[0];
+          float amplitude = std::abs(samples[0]);
           if(maximumBassAmplitude < amplitude) {
             maximumBassAmplitude = amplitude;
           }
-          samples += channelCount;
+          samples += sampleStride;
 
           if((frameIndex & 0x2fff) == 0) {
             canceler->ThrowIfCanceled();
             progressCallback(
-              static_cast<float>(frameIndex) / static_cast<float>(frameCount) / 2.0f
+              static_cast<float>(frameIndex) / static_cast<float>(frameCount) * progressScale +
+              progressOffset
             );
           } // if progress interval reached
         } // for each frame
       } else { // If channel ^^ is bass ^^ / vv is not bass vv
         for(std::size_t frameIndex = 0; frameIndex < frameCount; ++frameIndex) {
-          float amplitude = samples[0];
+          float amplitude = std::abs(samples[0]);
           if(maximumAmplitude < amplitude) {
             maximumAmplitude = amplitude;
           }
-          samples += channelCount;
+          samples += sampleStride;
 
           if((frameIndex & 0x2fff) == 0) {
             canceler->ThrowIfCanceled();
             progressCallback(
-              static_cast<float>(frameIndex) / static_cast<float>(frameCount) / 2.0f
+              static_cast<float>(frameIndex) / static_cast<float>(frameCount) * progressScale +
+              progressOffset
             );
           } // if progress interval reached
         } // for each frame
       } // if channel is bass or not bass
     } // for each channel
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Scales the volume of all channels so the peaks reach the signal ceiling</summary>
+  /// <param name="track">Track whose volume will be adjusted</param>
+  /// <param name="maximumAmplitude">Highest amplitude of all non-bass channels</param>
+  /// <param name="maximumBassAmplitude">Highest amplitude of all bass channels</param>
+  /// <param name="allowVolumeDecrease">Whether the volume may be lowered, too</param>
+  /// <param name="canceler">Token by which the operation can be signalled to cancel</param>
+  /// <param name="progressCallback">Callback to which progress reports should be sent</param>
+  /// <param name="progressScale">Factor by which the reported progress is scaled</param>
+  /// <param name="progressOffset">Offset that is added to the reported progress</param>
+  void scaleToPeakAmplitudes(
+    const std::shared_ptr<Nuclex::OpusTranscoder::Audio::Track> &track,
+    float maximumAmplitude, float maximumBassAmplitude,
+    bool allowVolumeDecrease,
+    const std::shared_ptr<const Nuclex::Support::Threading::StopToken> &canceler,
+    Nuclex::Support::Events::Delegate<void(float)> &progressCallback,
+    float progressScale, float progressOffset
+  ) {
+    using Nuclex::Audio::ChannelPlacement;
+    using Nuclex::OpusTranscoder::Audio::Channel;
+
+    std::size_t channelCount = track->Channels.size();
+    std::size_t frameCount = static_cast<std::size_t>(track->CountFrames());
+    std::size_t sampleStride = track->GetSampleStride();
+
+    // The samples are about to change, so the statistics won't describe them anymore
+    track->Statistics.Clear();
 
     // Stay 0.001 dB below the signal ceiling
     maximumAmplitude *= MinusOneThousandthDecibel;
     maximumBassAmplitude *= MinusOneThousandthDecibel;
 
-    // Stage 2: increase the volume of all tracks by the same amount to make them
+    // Increase the volume of all tracks by the same amount to make them
     // use the full available volume range
     for(std::size_t channelIndex = 0; channelIndex < channelCount; ++channelIndex) {
       Channel &channel = track->Channels[channelIndex];
-      float *samples = track->Samples.data() + channelIndex;
+      float *samples = track->GetChannelSamples(channelIndex);
 
       if(channel.Placement == ChannelPlacement::LowFrequencyEffects) {
         if(allowVolumeDecrease || (maximumBassAmplitude < 1.0f)) {
           for(std::size_t frameIndex = 0; frameIndex < frameCount; ++frameIndex) {
             samples[0] /= maximumBassAmplitude;
-            samples += channelCount;
+            samples += sampleStride;
 
             if((frameIndex & 0x2fff) == 0) {
               canceler->ThrowIfCanceled();
               progressCallback(
-                static_cast<float>(frameIndex) / static_cast<float>(frameCount) / 2.0f + 0.5f
+                static_cast<float>(frameIndex) / static_cast<float>(frameCount) * progressScale +
+                progressOffset
               );
             } // if progress interval reached
           } // for each frame
@@ -120,12 +170,13 @@ namespace Nuclex::OpusTranscoder::Audio {
         if(allowVolumeDecrease || (maximumAmplitude < 1.0f)) {
           for(std::size_t frameIndex = 0; frameIndex < frameCount; ++frameIndex) {
             samples[0] /= maximumAmplitude;
-            samples += channelCount;
+            samples += sampleStride;
 
             if((frameIndex & 0x2fff) == 0) {
               canceler->ThrowIfCanceled();
               progressCallback(
-                static_cast<float>(frameIndex) / static_cast<float>(frameCount) / 2.0f + 0.5f
+                static_cast<float>(frameIndex) / static_cast<float>(frameCount) * progressScale +
+                progressOffset
               );
             } // if progress interval reached
           } // for each frame
@@ -136,4 +187,516 @@ namespace Nuclex::OpusTranscoder::Audio {
 
   // ------------------------------------------------------------------------------------------- //
 
+  /// <summary>Highest amplitudes found in a range of frames</summary>
+  struct PeakAmplitudes {
+
+    /// <summary>Highest amplitude of all non-bass channels</summary>
+    public: float Maximum;
+    /// <summary>Highest amplitude of all bass channels</summary>
+    public: float MaximumBass;
+
+  };
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Fetches the peak amplitudes from the statistics collected for a track</summary>
+  /// <param name="track">Track whose peak amplitudes will be looked up</param>
+  /// <param name="peaks">Receives the highest amplitudes of the bass and non-bass channels</param>
+  /// <returns>
+  ///   True if the track's statistics were up to date and the peaks could be provided
+  /// </returns>
+  bool getPeakAmplitudesFromStatistics(
+    const std::shared_ptr<Nuclex::OpusTranscoder::Audio::Track> &track, PeakAmplitudes &peaks
+  ) {
+    using Nuclex::Audio::ChannelPlacement;
+
+    std::size_t channelCount = track->Channels.size();
+    if(channelCount == 0) {
+      return false;
+    }
+
+    std::uint64_t frameCount = track->CountFrames();
+    if(!track->Statistics.Covers(channelCount, frameCount)) {
+      return false;
+    }
+
+    // The statistics only know about a single bass channel. If that isn't the one
+    // the track itself considers its bass channel, their bass peak is no good to us.
+    std::size_t bassChannelIndex = track->Statistics.GetBassChannelIndex();
+
+    peaks.Maximum = 0.0f;
+    for(std::size_t channelIndex = 0; channelIndex < channelCount; ++channelIndex) {
+      bool isBass = (
+        track->Channels[channelIndex].Placement == ChannelPlacement::LowFrequencyEffects
+      );
+      if(isBass != (channelIndex == bassChannelIndex)) {
+        return false;
+      }
+      float amplitude = track->Statistics.GetPeakAmplitude(channelIndex);
+      if(!isBass && (peaks.Maximum < amplitude)) {
+        peaks.Maximum = amplitude;
+      }
+    }
+    peaks.MaximumBass = track->Statistics.GetBassPeakAmplitude();
+
+    return true;
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Looks for the highest amplitudes in a range of frames on a worker thread</summary>
+  /// <param name="track">Track that will be scanned for its peak amplitudes</param>
+  /// <param name="startIndex">Index of the first frame that will be scanned</param>
+  /// <param name="endIndex">Index one past the last frame that will be scanned</param>
+  /// <param name="canceler">Token by which the operation can be signalled to cancel</param>
+  /// <param name="processedFrameCount">Counter that will be advanced while scanning</param>
+  /// <returns>The highest amplitudes of the bass and non-bass channels in the range</returns>
+  PeakAmplitudes scanPeakAmplitudesInRange(
+    const std::shared_ptr<Nuclex::OpusTranscoder::Audio::Track> &track,
+    std::size_t startIndex, std::size_t endIndex,
+    const std::shared_ptr<const Nuclex::Support::Threading::StopToken> &canceler,
+    std::atomic<std::uint64_t> &processedFrameCount
+  ) {
+    using Nuclex::Audio::ChannelPlacement;
+
+    std::size_t channelCount = track->Channels.size();
+    PeakAmplitudes peaks = { 0.0f, 0.0f };
+
+    // Going frame by frame here so each thread reads only its own part of the samples,
+    // thus we need to look up which peak each channel contributes to beforehand.
+    std::vector<float *> channelPeaks(channelCount);
+    for(std::size_t channelIndex = 0; channelIndex < channelCount; ++channelIndex) {
+      if(track->Channels[channelIndex].Placement == ChannelPlacement::LowFrequencyEffects) {
+        channelPeaks[channelIndex] = &peaks.MaximumBass;
+      } else {
+        channelPeaks[channelIndex] = &peaks.Maximum;
+      }
+    }
+
+    // With interleaved samples, these all walk through the same memory. With planar
+    // samples, each channel is a sequential stream the prefetcher can keep up with.
+    std::size_t sampleStride = track->GetSampleStride();
+    std::vector<const float *> channelSamples(channelCount);
+    for(std::size_t channelIndex = 0; channelIndex < channelCount; ++channelIndex) {
+      channelSamples[channelIndex] = (
+        track->GetChannelSamples(channelIndex) + (startIndex * sampleStride)
+      );
+    }
+
+    std::size_t reportedFrameIndex = startIndex;
+    for(std::size_t frameIndex = startIndex; frameIndex < endIndex; ++frameIndex) {
+      for(std::size_t channelIndex = 0; channelIndex < channelCount; ++channelIndex) {
+        float amplitude = std::abs(*channelSamples[channelIndex]);
+        if(*channelPeaks[channelIndex] < amplitude) {
+          *channelPeaks[channelIndex] = amplitude;
+        }
+        channelSamples[channelIndex] += sampleStride;
+      }
+
+      if((frameIndex - reportedFrameIndex) >= ProgressReportFrameCount) {
+        processedFrameCount.fetch_add(frameIndex - reportedFrameIndex, std::memory_order_relaxed);
+        reportedFrameIndex = frameIndex;
+        canceler->ThrowIfCanceled();
+      }
+    } // for each frame
+
+    processedFrameCount.fetch_add(endIndex - reportedFrameIndex, std::memory_order_relaxed);
+
+    return peaks;
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Scales the volume of a range of frames on a worker thread</summary>
+  /// <param name="track">Track whose volume will be adjusted</param>
+  /// <param name="startIndex">Index of the first frame that will be scaled</param>
+  /// <param name="endIndex">Index one past the last frame that will be scaled</param>
+  /// <param name="divisor">Divisor for the samples of all non-bass channels</param>
+  /// <param name="bassDivisor">Divisor for the samples of all bass channels</param>
+  /// <param name="canceler">Token by which the operation can be signalled to cancel</param>
+  /// <param name="processedFrameCount">Counter that will be advanced while scaling</param>
+  void scaleRangeToPeakAmplitudes(
+    const std::shared_ptr<Nuclex::OpusTranscoder::Audio::Track> &track,
+    std::size_t startIndex, std::size_t endIndex,
+    float divisor, float bassDivisor,
+    const std::shared_ptr<const Nuclex::Support::Threading::StopToken> &canceler,
+    std::atomic<std::uint64_t> &processedFrameCount
+  ) {
+    using Nuclex::Audio::ChannelPlacement;
+
+    std::size_t channelCount = track->Channels.size();
+
+    std::vector<float> channelDivisors(channelCount);
+    for(std::size_t channelIndex = 0; channelIndex < channelCount; ++channelIndex) {
+      if(track->Channels[channelIndex].Placement == ChannelPlacement::LowFrequencyEffects) {
+        channelDivisors[channelIndex] = bassDivisor;
+      } else {
+        channelDivisors[channelIndex] = divisor;
+      }
+    }
+
+    std::size_t sampleStride = track->GetSampleStride();
+    std::vector<float *> channelSamples(channelCount);
+    for(std::size_t channelIndex = 0; channelIndex < channelCount; ++channelIndex) {
+      channelSamples[channelIndex] = (
+        track->GetChannelSamples(channelIndex) + (startIndex * sampleStride)
+      );
+    }
+
+    std::size_t reportedFrameIndex = startIndex;
+    for(std::size_t frameIndex = startIndex; frameIndex < endIndex; ++frameIndex) {
+      for(std::size_t channelIndex = 0; channelIndex < channelCount; ++channelIndex) {
+        *channelSamples[channelIndex] /= channelDivisors[channelIndex];
+        channelSamples[channelIndex] += sampleStride;
+      }
+
+      if((frameIndex - reportedFrameIndex) >= ProgressReportFrameCount) {
+        processedFrameCount.fetch_add(frameIndex - reportedFrameIndex, std::memory_order_relaxed);
+        reportedFrameIndex = frameIndex;
+        canceler->ThrowIfCanceled();
+      }
+    } // for each frame
+
+    processedFrameCount.fetch_add(endIndex - reportedFrameIndex, std::memory_order_relaxed);
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Looks for the highest amplitudes in a track using a thread pool</summary>
+  /// <param name="track">Track that will be scanned for its peak amplitudes</param>
+  /// <param name="boundaries">Frame indices at which the track is split into ranges</param>
+  /// <param name="threadPool">Thread pool on which the ranges will be scanned</param>
+  /// <param name="canceler">Token by which the operation can be signalled to cancel</param>
+  /// <param name="processedFrameCount">Counter that will be advanced while scanning</param>
+  /// <param name="totalFrameCount">Counter value at which all work is done</param>
+  /// <param name="progressCallback">Callback to which progress reports should be sent</param>
+  /// <returns>The highest amplitudes of the bass and non-bass channels in the track</returns>
+  PeakAmplitudes scanPeakAmplitudesInParallel(
+    const std::shared_ptr<Nuclex::OpusTranscoder::Audio::Track> &track,
+    const std::vector<std::size_t> &boundaries,
+    Nuclex::Support::Threading::ThreadPool &threadPool,
+    const std::shared_ptr<const Nuclex::Support::Threading::StopToken> &canceler,
+    std::atomic<std::uint64_t> &processedFrameCount, std::uint64_t totalFrameCount,
+    Nuclex::Support::Events::Delegate<void(float)> &progressCallback
+  ) {
+    using Nuclex::OpusTranscoder::Audio::WorkPartitioner;
+
+    std::size_t rangeCount = boundaries.size() - 1;
+
+    std::vector<std::future<PeakAmplitudes>> futures;
+    futures.reserve(rangeCount);
+    try {
+      for(std::size_t rangeIndex = 0; rangeIndex < rangeCount; ++rangeIndex) {
+        futures.push_back(
+          threadPool.Schedule(
+            &scanPeakAmplitudesInRange,
+            track, boundaries[rangeIndex], boundaries[rangeIndex + 1],
+            canceler, std::ref(processedFrameCount)
+          )
+        );
+      }
+    }
+    catch(const std::exception &) {
+      WorkPartitioner::WaitForAll(futures); // they reference our counter
+      throw;
+    }
+
+    WorkPartitioner::WaitForAll(
+      futures, processedFrameCount, totalFrameCount, progressCallback
+    );
+
+    PeakAmplitudes peaks = { 0.0f, 0.0f };
+    for(std::size_t rangeIndex = 0; rangeIndex < rangeCount; ++rangeIndex) {
+      PeakAmplitudes rangePeaks = futures[rangeIndex].get();
+      if(peaks.Maximum < rangePeaks.Maximum) {
+        peaks.Maximum = rangePeaks.Maximum;
+      }
+      if(peaks.MaximumBass < rangePeaks.MaximumBass) {
+        peaks.MaximumBass = rangePeaks.MaximumBass;
+      }
+    }
+
+    return peaks;
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+} // anonymous namespace
+
+namespace Nuclex::OpusTranscoder::Audio {
+
+  // ------------------------------------------------------------------------------------------- //
+
+  void Normalizer::Normalize(
+    const std::shared_ptr<Track> &track,
+    bool allowVolumeDecrease,
+    const std::shared_ptr<const Nuclex::Support::Threading::StopToken> &canceler,
+    Nuclex::Support::Events::Delegate<void(float)> &progressCallback
+  ) {
+    track->AdviseAccessPattern(SampleAccessPattern::Sequential);
+
+    // If the peaks were already collected while decoding, skip the scan
+    PeakAmplitudes peaks;
+    if(getPeakAmplitudesFromStatistics(track, peaks)) {
+      scaleToPeakAmplitudes(
+        track, peaks.Maximum, peaks.MaximumBass, allowVolumeDecrease,
+        canceler, progressCallback, 1.0f, 0.0f
+      );
+      return;
+    }
+
+    float maximumAmplitude = 0.0f;
+    float maximumBassAmplitude = 0.0f;
+
+    scanPeakAmplitudes(
+      track, maximumAmplitude, maximumBassAmplitude, canceler, progressCallback, 0.5f, 0.0f
+    );
+    scaleToPeakAmplitudes(
+      track, maximumAmplitude, maximumBassAmplitude, allowVolumeDecrease,
+      canceler, progressCallback, 0.5f, 0.5f
+    );
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  void Normalizer::Normalize(
+    const std::shared_ptr<Track> &track,
+    bool allowVolumeDecrease,
+    Nuclex::Support::Threading::ThreadPool &threadPool,
+    const std::shared_ptr<const Nuclex::Support::Threading::StopToken> &canceler,
+    Nuclex::Support::Events::Delegate<void(float)> &progressCallback
+  ) {
+    track->AdviseAccessPattern(SampleAccessPattern::Sequential);
+
+    std::size_t frameCount = static_cast<std::size_t>(track->CountFrames());
+
+    // Both passes are split by frames rather than by channels, so that each thread
+    // works on its own cache lines instead of all of them striding through all samples.
+    std::vector<std::size_t> boundaries = WorkPartitioner::SplitFrameRange(frameCount);
+    std::size_t rangeCount = boundaries.size() - 1;
+
+    // If the peaks were already collected while decoding, the scan can be skipped
+    PeakAmplitudes peaks;
+    bool scanNeeded = !getPeakAmplitudesFromStatistics(track, peaks);
+
+    // Both passes advance the same counter, each contributing half of the work
+    std::atomic<std::uint64_t> processedFrameCount(0);
+    std::uint64_t totalFrameCount = (
+      static_cast<std::uint64_t>(frameCount) * (scanNeeded ? 2 : 1)
+    );
+
+    if(scanNeeded) {
+      peaks = scanPeakAmplitudesInParallel(
+        track, boundaries, threadPool, canceler,
+        processedFrameCount, totalFrameCount, progressCallback
+      );
+    }
+    float maximumAmplitude = peaks.Maximum;
+    float maximumBassAmplitude = peaks.MaximumBass;
+
+    // Same decisions as in scaleToPeakAmplitudes(). Channels whose group is not to
+    // be scaled get a divisor of one, which leaves their samples untouched.
+    maximumAmplitude *= MinusOneThousandthDecibel;
+    maximumBassAmplitude *= MinusOneThousandthDecibel;
+
+    bool scaleBass = (allowVolumeDecrease || (maximumBassAmplitude < 1.0f));
+    bool scaleNonBass = (allowVolumeDecrease || (maximumAmplitude < 1.0f));
+    if(!scaleBass && !scaleNonBass) {
+      progressCallback(1.0f);
+      return;
+    }
+
+    // The samples are about to change, so the statistics won't describe them anymore
+    track->Statistics.Clear();
+
+    {
+      float divisor = scaleNonBass ? maximumAmplitude : 1.0f;
+      float bassDivisor = scaleBass ? maximumBassAmplitude : 1.0f;
+
+      std::vector<std::future<void>> futures;
+      futures.reserve(rangeCount);
+      try {
+        for(std::size_t rangeIndex = 0; rangeIndex < rangeCount; ++rangeIndex) {
+          futures.push_back(
+            threadPool.Schedule(
+              &scaleRangeToPeakAmplitudes,
+              track, boundaries[rangeIndex], boundaries[rangeIndex + 1],
+              divisor, bassDivisor, canceler, std::ref(processedFrameCount)
+            )
+          );
+        }
+      }
+      catch(const std::exception &) {
+        WorkPartitioner::WaitForAll(futures); // they reference our counter
+        throw;
+      }
+
+      WorkPartitioner::WaitForAll(
+        futures, processedFrameCount, totalFrameCount, progressCallback
+      );
+      for(std::size_t rangeIndex = 0; rangeIndex < rangeCount; ++rangeIndex) {
+        futures[rangeIndex].get(); // rethrows errors from the range's job
+      }
+    } // beauty scope for the volume adjustment
+
+    progressCallback(1.0f);
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  void Normalizer::UpdatePeakAmplitudes(
+    const std::shared_ptr<Track> &track,
+    float &maximumAmplitude, float &maximumBassAmplitude,
+    const std::shared_ptr<const Nuclex::Support::Threading::StopToken> &canceler,
+    Nuclex::Support::Events::Delegate<void(float)> &progressCallback
+  ) {
+    track->AdviseAccessPattern(SampleAccessPattern::Sequential);
+
+    PeakAmplitudes peaks;
+    if(getPeakAmplitudesFromStatistics(track, peaks)) {
+      if(maximumAmplitude < peaks.Maximum) {
+        maximumAmplitude = peaks.Maximum;
+      }
+      if(maximumBassAmplitude < peaks.MaximumBass) {
+        maximumBassAmplitude = peaks.MaximumBass;
+      }
+      progressCallback(1.0f);
+      return;
+    }
+
+    scanPeakAmplitudes(
+      track, maximumAmplitude, maximumBassAmplitude, canceler, progressCallback, 1.0f, 0.0f
+    );
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  void Normalizer::UpdatePeakAmplitudes(
+    const std::shared_ptr<Track> &track,
+    float &maximumAmplitude, float &maximumBassAmplitude,
+    Nuclex::Support::Threading::ThreadPool &threadPool,
+    const std::shared_ptr<const Nuclex::Support::Threading::StopToken> &canceler,
+    Nuclex::Support::Events::Delegate<void(float)> &progressCallback
+  ) {
+    track->AdviseAccessPattern(SampleAccessPattern::Sequential);
+
+    std::size_t frameCount = static_cast<std::size_t>(track->CountFrames());
+
+    // If the peaks were already collected while decoding, the scan can be skipped
+    PeakAmplitudes peaks;
+    if(!getPeakAmplitudesFromStatistics(track, peaks)) {
+      std::vector<std::size_t> boundaries = WorkPartitioner::SplitFrameRange(frameCount);
+
+      std::atomic<std::uint64_t> processedFrameCount(0);
+      std::uint64_t totalFrameCount = static_cast<std::uint64_t>(frameCount);
+
+      peaks = scanPeakAmplitudesInParallel(
+        track, boundaries, threadPool, canceler,
+        processedFrameCount, totalFrameCount, progressCallback
+      );
+    }
+    if(maximumAmplitude < peaks.Maximum) {
+      maximumAmplitude = peaks.Maximum;
+    }
+    if(maximumBassAmplitude < peaks.MaximumBass) {
+      maximumBassAmplitude = peaks.MaximumBass;
+    }
+
+    progressCallback(1.0f);
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  std::vector<float> Normalizer::CalculateChannelGains(
+    const std::shared_ptr<Track> &track,
+    float maximumAmplitude, float maximumBassAmplitude,
+    bool allowVolumeDecrease
+  ) {
+    using Nuclex::Audio::ChannelPlacement;
+
+    // Same decisions as in scaleToPeakAmplitudes(). A silent channel group is left
+    // alone, too, its gain would be infinite and turn any mix it is part of into NaNs.
+    maximumAmplitude *= MinusOneThousandthDecibel;
+    maximumBassAmplitude *= MinusOneThousandthDecibel;
+
+    bool scaleBass = (
+      (0.0f < maximumBassAmplitude) && (allowVolumeDecrease || (maximumBassAmplitude < 1.0f))
+    );
+    bool scaleNonBass = (
+      (0.0f < maximumAmplitude) && (allowVolumeDecrease || (maximumAmplitude < 1.0f))
+    );
+
+    std::size_t channelCount = track->Channels.size();
+    std::vector<float> channelGains(channelCount, 1.0f);
+    for(std::size_t channelIndex = 0; channelIndex < channelCount; ++channelIndex) {
+      if(track->Channels[channelIndex].Placement == ChannelPlacement::LowFrequencyEffects) {
+        if(scaleBass) {
+          channelGains[channelIndex] = 1.0f / maximumBassAmplitude;
+        }
+      } else if(scaleNonBass) {
+        channelGains[channelIndex] = 1.0f / maximumAmplitude;
+      }
+    }
+
+    return channelGains;
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  void Normalizer::Amplify(
+    const std::shared_ptr<Track> &track,
+    float maximumAmplitude, float maximumBassAmplitude,
+    bool allowVolumeDecrease,
+    const std::shared_ptr<const Nuclex::Support::Threading::StopToken> &canceler,
+    Nuclex::Support::Events::Delegate<void(float)> &progressCallback
+  ) {
+    track->AdviseAccessPattern(SampleAccessPattern::Sequential);
+
+    scaleToPeakAmplitudes(
+      track, maximumAmplitude, maximumBassAmplitude, allowVolumeDecrease,
+      canceler, progressCallback, 1.0f, 0.0f
+    );
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  void Normalizer::Amplify(
+    const std::shared_ptr<Track> &track,
+    const std::vector<float> &channelGains,
+    const std::shared_ptr<const Nuclex::Support::Threading::StopToken> &canceler,
+    Nuclex::Support::Events::Delegate<void(float)> &progressCallback
+  ) {
+    track->AdviseAccessPattern(SampleAccessPattern::Sequential);
+
+    std::size_t channelCount = track->Channels.size();
+    if(channelGains.size() != channelCount) {
+      throw std::runtime_error(u8"Number of channel gains must match the track's channel count");
+    }
+
+    std::size_t frameCount = static_cast<std::size_t>(track->CountFrames());
+
+    // The samples are about to change, so the statistics won't describe them anymore
+    track->Statistics.Clear();
+
+    std::size_t sampleStride = track->GetSampleStride();
+    std::vector<float *> channelSamples(channelCount);
+    for(std::size_t channelIndex = 0; channelIndex < channelCount; ++channelIndex) {
+      channelSamples[channelIndex] = track->GetChannelSamples(channelIndex);
+    }
+
+    for(std::size_t frameIndex = 0; frameIndex < frameCount; ++frameIndex) {
+      for(std::size_t channelIndex = 0; channelIndex < channelCount; ++channelIndex) {
+        *channelSamples[channelIndex] *= channelGains[channelIndex];
+        channelSamples[channelIndex] += sampleStride;
+      }
+
+      if((frameIndex & 0x2fff) == 0) {
+        canceler->ThrowIfCanceled();
+        progressCallback(static_cast<float>(frameIndex) / static_cast<float>(frameCount));
+      }
+    } // for each frame
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
 } // namespace Nuclex::OpusTranscoder::Audio
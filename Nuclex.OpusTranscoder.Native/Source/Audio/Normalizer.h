@@ -27,6 +27,17 @@ limitations under the License.
 #include <Nuclex/Support/Events/Delegate.h>
 
 #include <memory> // for std::shared_ptr
+#include <vector> // for std::vector
+
+namespace Nuclex::Support::Threading {
+
+  // ------------------------------------------------------------------------------------------- //
+
+  class ThreadPool;
+
+  // ------------------------------------------------------------------------------------------- //
+
+} // namespace Nuclex::Support::Threading
 
 namespace Nuclex::OpusTranscoder::Audio {
 
@@ -64,6 +75,114 @@ namespace Nuclex::OpusTranscoder::Audio {
       Nuclex::Support::Events::Delegate<void(float)> &progressCallback
     );
 
+    /// <summary>
+    ///   Normalizes the volume of an audio track if it is too quiet, splitting the track
+    ///   into ranges that are processed by the threads of a thread pool
+    /// </summary>
+    /// <param name="track">Audio track that will be normalized</param>
+    /// <param name="allowVolumeDecrease">Whether the volume may be lowered, too</param>
+    /// <param name="threadPool">Thread pool on which the ranges will be processed</param>
+    /// <param name="canceler">Token by which the operation can be signalled to cancel</param>
+    /// <param name="progressCallback">Callback to which progress reports should be sent</param>
+    public: static void Normalize(
+      const std::shared_ptr<Track> &track,
+      bool allowVolumeDecrease,
+      Nuclex::Support::Threading::ThreadPool &threadPool,
+      const std::shared_ptr<const Nuclex::Support::Threading::StopToken> &canceler,
+      Nuclex::Support::Events::Delegate<void(float)> &progressCallback
+    );
+
+    /// <summary>Updates the peak amplitudes with the highest amplitudes in a track</summary>
+    /// <param name="track">Audio track that will be scanned for its peak amplitudes</param>
+    /// <param name="maximumAmplitude">
+    ///   Highest amplitude seen in all non-bass channels so far, will be updated
+    /// </param>
+    /// <param name="maximumBassAmplitude">
+    ///   Highest amplitude seen in the bass (LFE) channels so far, will be updated
+    /// </param>
+    /// <param name="canceler">Token by which the operation can be signalled to cancel</param>
+    /// <param name="progressCallback">Callback to which progress reports should be sent</param>
+    /// <remarks>
+    ///   Together with <see cref="Amplify" />, this allows normalization of tracks that
+    ///   are processed in smaller pieces. Start with both amplitudes at zero and call this
+    ///   method for each piece of the track, then amplify each piece.
+    /// </remarks>
+    public: static void UpdatePeakAmplitudes(
+      const std::shared_ptr<Track> &track,
+      float &maximumAmplitude, float &maximumBassAmplitude,
+      const std::shared_ptr<const Nuclex::Support::Threading::StopToken> &canceler,
+      Nuclex::Support::Events::Delegate<void(float)> &progressCallback
+    );
+
+    /// <summary>
+    ///   Updates the peak amplitudes with the highest amplitudes in a track, splitting
+    ///   the track into ranges that are scanned by the threads of a thread pool
+    /// </summary>
+    /// <param name="track">Audio track that will be scanned for its peak amplitudes</param>
+    /// <param name="maximumAmplitude">
+    ///   Highest amplitude seen in all non-bass channels so far, will be updated
+    /// </param>
+    /// <param name="maximumBassAmplitude">
+    ///   Highest amplitude seen in the bass (LFE) channels so far, will be updated
+    /// </param>
+    /// <param name="threadPool">Thread pool on which the ranges will be scanned</param>
+    /// <param name="canceler">Token by which the operation can be signalled to cancel</param>
+    /// <param name="progressCallback">Callback to which progress reports should be sent</param>
+    public: static void UpdatePeakAmplitudes(
+      const std::shared_ptr<Track> &track,
+      float &maximumAmplitude, float &maximumBassAmplitude,
+      Nuclex::Support::Threading::ThreadPool &threadPool,
+      const std::shared_ptr<const Nuclex::Support::Threading::StopToken> &canceler,
+      Nuclex::Support::Events::Delegate<void(float)> &progressCallback
+    );
+
+    /// <summary>Calculates the factor by which each channel needs to be amplified</summary>
+    /// <param name="track">Audio track whose channels the factors will be calculated for</param>
+    /// <param name="maximumAmplitude">Highest amplitude in all non-bass channels</param>
+    /// <param name="maximumBassAmplitude">Highest amplitude in the bass (LFE) channels</param>
+    /// <param name="allowVolumeDecrease">Whether the volume may also be lowered</param>
+    /// <returns>
+    ///   A list with one factor for each of the track's channels that brings its peaks
+    ///   up to the signal ceiling or 1.0 for channels that should not be changed
+    /// </returns>
+    /// <remarks>
+    ///   The factors can be applied via <see cref="Amplify" /> or be passed to the
+    ///   <see cref="ChannelLayoutTransformer" />, which folds them into its mix so that
+    ///   remixing and normalization happen in the same pass over the samples.
+    /// </remarks>
+    public: static std::vector<float> CalculateChannelGains(
+      const std::shared_ptr<Track> &track,
+      float maximumAmplitude, float maximumBassAmplitude,
+      bool allowVolumeDecrease
+    );
+
+    /// <summary>Amplifies a track so that the specified peaks hit the signal ceiling</summary>
+    /// <param name="track">Audio track whose volume will be adjusted</param>
+    /// <param name="maximumAmplitude">Highest amplitude in all non-bass channels</param>
+    /// <param name="maximumBassAmplitude">Highest amplitude in the bass (LFE) channels</param>
+    /// <param name="allowVolumeDecrease">Whether the volume may also be lowered</param>
+    /// <param name="canceler">Token by which the operation can be signalled to cancel</param>
+    /// <param name="progressCallback">Callback to which progress reports should be sent</param>
+    public: static void Amplify(
+      const std::shared_ptr<Track> &track,
+      float maximumAmplitude, float maximumBassAmplitude,
+      bool allowVolumeDecrease,
+      const std::shared_ptr<const Nuclex::Support::Threading::StopToken> &canceler,
+      Nuclex::Support::Events::Delegate<void(float)> &progressCallback
+    );
+
+    /// <summary>Amplifies each of the track's channels by its own factor</summary>
+    /// <param name="track">Audio track whose volume will be adjusted</param>
+    /// <param name="channelGains">Factor by which each of the channels is amplified</param>
+    /// <param name="canceler">Token by which the operation can be signalled to cancel</param>
+    /// <param name="progressCallback">Callback to which progress reports should be sent</param>
+    public: static void Amplify(
+      const std::shared_ptr<Track> &track,
+      const std::vector<float> &channelGains,
+      const std::shared_ptr<const Nuclex::Support::Threading::StopToken> &canceler,
+      Nuclex::Support::Events::Delegate<void(float)> &progressCallback
+    );
+
   };
 
   // ------------------------------------------------------------------------------------------- //
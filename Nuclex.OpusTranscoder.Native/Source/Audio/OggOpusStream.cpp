@@ -0,0 +1,447 @@
+#pragma region Apache License 2.0
+/*
+Nuclex Opus Transcoder
+Copyright (C) 2024 Markus Ewald / Nuclex Development Labs
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#pragma endregion // Apache License 2.0
+
+// If the application is compiled as a DLL, this ensures symbols are exported
+#define NUCLEX_OPUSTRANSCODER_SOURCE 1
+
+#include "./OggOpusStream.h"
+#include "./LittleEndian.h"
+
+#include <stdexcept> // for std::runtime_error
+#include <cstring> // for std::memcmp()
+
+namespace {
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Size of the fixed part of an Ogg page header</summary>
+  const std::size_t OggPageHeaderSize = 27;
+
+  /// <summary>Header type flag for pages that continue a packet from the prior page</summary>
+  const std::uint8_t ContinuedPacketFlag = 0x01;
+  /// <summary>Header type flag for the first page of a logical stream</summary>
+  const std::uint8_t BeginningOfStreamFlag = 0x02;
+  /// <summary>Header type flag for the last page of a logical stream</summary>
+  const std::uint8_t EndOfStreamFlag = 0x04;
+
+  /// <summary>Granule position for pages on which no packet ends</summary>
+  const std::uint64_t NoGranulePosition = ~std::uint64_t(0);
+
+  /// <summary>Number of payload bytes after which the writer starts a new page</summary>
+  const std::size_t PreferredPageSize = 4096;
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Lookup table for the CRC-32 variant used by Ogg</summary>
+  /// <remarks>
+  ///   Ogg uses the polynomial 0x04c11db7 with no bit reflection, an initial value of
+  ///   zero and no final XOR, so the usual zlib CRC-32 routines don't fit.
+  /// </remarks>
+  struct OggCrcTable {
+
+    /// <summary>Calculates the lookup table entries</summary>
+    public: OggCrcTable() {
+      for(std::uint32_t index = 0; index < 256; ++index) {
+        std::uint32_t remainder = index << 24;
+        for(std::size_t bit = 0; bit < 8; ++bit) {
+          if((remainder & 0x80000000U) != 0) {
+            remainder = (remainder << 1) ^ 0x04c11db7U;
+          } else {
+            remainder <<= 1;
+          }
+        }
+        this->Entries[index] = remainder;
+      }
+    }
+
+    /// <summary>Remainder for each possible value of the top byte</summary>
+    public: std::uint32_t Entries[256];
+
+  };
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Calculates the Ogg CRC-32 checksum of a memory block</summary>
+  /// <param name="data">Memory block of which the checksum will be calculated</param>
+  /// <param name="length">Length of the memory block in bytes</param>
+  /// <param name="crc">CRC of the preceding data if checksumming in pieces</param>
+  /// <returns>The updated CRC-32 checksum</returns>
+  std::uint32_t updateOggCrc(const std::byte *data, std::size_t length, std::uint32_t crc = 0) {
+    static const OggCrcTable table; // initialization of statics is thread-safe
+    for(std::size_t index = 0; index < length; ++index) {
+      std::uint32_t value = std::to_integer<std::uint32_t>(data[index]);
+      crc = (crc << 8) ^ table.Entries[((crc >> 24) ^ value) & 0xff];
+    }
+    return crc;
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Packs packets into Ogg pages</summary>
+  class OggPageWriter {
+
+    /// <summary>Initializes a new Ogg page writer</summary>
+    /// <param name="target">Vector to which the Ogg pages will be appended</param>
+    /// <param name="serialNumber">Serial number of the logical stream</param>
+    public: OggPageWriter(std::vector<std::byte> &target, std::uint32_t serialNumber) :
+      target(target),
+      serialNumber(serialNumber),
+      sequenceNumber(0),
+      isFirstPage(true),
+      isContinuation(false),
+      granulePosition(NoGranulePosition),
+      segmentTable(),
+      payload() {}
+
+    /// <summary>Adds a packet to the current page, starting new pages as needed</summary>
+    /// <param name="packet">Contents of the packet that will be added</param>
+    /// <param name="packetLength">Length of the packet in bytes</param>
+    /// <param name="endGranulePosition">Granule position at the end of the packet</param>
+    public: void AddPacket(
+      const std::byte *packet, std::size_t packetLength, std::uint64_t endGranulePosition
+    ) {
+      std::size_t requiredSegmentCount = packetLength / 255 + 1;
+
+      // Start a new page if the current one is large enough or if the packet doesn't
+      // fit in anymore (we avoid splitting packets that would fit into a page of their own)
+      bool isPageFull = (
+        (PreferredPageSize <= this->payload.size()) ||
+        (255 < this->segmentTable.size() + requiredSegmentCount)
+      );
+      if(isPageFull) {
+        Flush(false);
+      }
+
+      for(;;) {
+        if(this->segmentTable.size() == 255) {
+          Flush(false);
+          this->isContinuation = true; // the next page begins with the rest of this packet
+        }
+
+        if(packetLength < 255) {
+          this->segmentTable.push_back(static_cast<std::uint8_t>(packetLength));
+          this->payload.insert(this->payload.end(), packet, packet + packetLength);
+          this->granulePosition = endGranulePosition;
+          break;
+        }
+
+        this->segmentTable.push_back(255);
+        this->payload.insert(this->payload.end(), packet, packet + 255);
+        packet += 255;
+        packetLength -= 255;
+      }
+    }
+
+    /// <summary>Writes the current page to the target vector</summary>
+    /// <param name="isLastPage">Whether this is the last page in the stream</param>
+    public: void Flush(bool isLastPage) {
+      using Nuclex::OpusTranscoder::Audio::LittleEndian;
+
+      if(this->segmentTable.empty() && !isLastPage) {
+        return;
+      }
+
+      std::uint8_t headerType = 0;
+      if(this->isContinuation) {
+        headerType |= ContinuedPacketFlag;
+      }
+      if(this->isFirstPage) {
+        headerType |= BeginningOfStreamFlag;
+      }
+      if(isLastPage) {
+        headerType |= EndOfStreamFlag;
+      }
+
+      std::size_t pageStart = this->target.size();
+      this->target.push_back(std::byte(u8'O'));
+      this->target.push_back(std::byte(u8'g'));
+      this->target.push_back(std::byte(u8'g'));
+      this->target.push_back(std::byte(u8'S'));
+      this->target.push_back(std::byte(0)); // stream structure version
+      this->target.push_back(static_cast<std::byte>(headerType));
+      LittleEndian::Append<std::uint64_t>(this->target, this->granulePosition);
+      LittleEndian::Append<std::uint32_t>(this->target, this->serialNumber);
+      LittleEndian::Append<std::uint32_t>(this->target, this->sequenceNumber);
+      LittleEndian::Append<std::uint32_t>(this->target, 0); // CRC, filled in below
+      this->target.push_back(static_cast<std::byte>(this->segmentTable.size()));
+      for(std::size_t index = 0; index < this->segmentTable.size(); ++index) {
+        this->target.push_back(static_cast<std::byte>(this->segmentTable[index]));
+      }
+      this->target.insert(this->target.end(), this->payload.begin(), this->payload.end());
+
+      std::uint32_t crc = updateOggCrc(
+        this->target.data() + pageStart, this->target.size() - pageStart
+      );
+      for(std::size_t index = 0; index < 4; ++index) {
+        this->target[pageStart + 22 + index] = static_cast<std::byte>((crc >> (index * 8)) & 0xff);
+      }
+
+      ++this->sequenceNumber;
+      this->isFirstPage = false;
+      this->isContinuation = false;
+      this->granulePosition = NoGranulePosition;
+      this->segmentTable.clear();
+      this->payload.clear();
+    }
+
+    /// <summary>Vector to which the Ogg pages are appended</summary>
+    private: std::vector<std::byte> &target;
+    /// <summary>Serial number of the logical stream</summary>
+    private: std::uint32_t serialNumber;
+    /// <summary>Sequence number of the next page</summary>
+    private: std::uint32_t sequenceNumber;
+    /// <summary>Whether the next page will be the first page in the stream</summary>
+    private: bool isFirstPage;
+    /// <summary>Whether the next page continues a packet from the prior page</summary>
+    private: bool isContinuation;
+    /// <summary>Granule position of the last packet ending in the current page</summary>
+    private: std::uint64_t granulePosition;
+    /// <summary>Lacing values of the current page</summary>
+    private: std::vector<std::uint8_t> segmentTable;
+    /// <summary>Payload of the current page</summary>
+    private: std::vector<std::byte> payload;
+
+  };
+
+  // ------------------------------------------------------------------------------------------- //
+
+} // anonymous namespace
+
+namespace Nuclex::OpusTranscoder::Audio {
+
+  // ------------------------------------------------------------------------------------------- //
+
+  OggOpusStream::OggOpusStream() :
+    SerialNumber(0),
+    HeaderPacket(),
+    CommentPacket(),
+    AudioData(),
+    Packets(),
+    FinalGranulePosition(0) {}
+
+  // ------------------------------------------------------------------------------------------- //
+
+  OggOpusStream OggOpusStream::Parse(const std::byte *fileContents, std::size_t fileLength) {
+    OggOpusStream stream;
+
+    // Packets 0 and 1 are the OpusHead and OpusTags headers, audio packets follow
+    std::size_t packetIndex = 0;
+    std::size_t packetStart = 0;
+    bool isFirstPage = true;
+
+    std::size_t offset = 0;
+    while(offset < fileLength) {
+      const std::byte *page = fileContents + offset;
+      if(
+        (fileLength - offset < OggPageHeaderSize) ||
+        (std::memcmp(page, u8"OggS", 4) != 0)
+      ) {
+        throw std::runtime_error(u8"Encoded Opus stream contains an invalid Ogg page");
+      }
+
+      std::size_t segmentCount = std::to_integer<std::size_t>(page[26]);
+      if(fileLength - offset < OggPageHeaderSize + segmentCount) {
+        throw std::runtime_error(u8"Encoded Opus stream ends in the middle of an Ogg page");
+      }
+
+      const std::byte *segmentTable = page + OggPageHeaderSize;
+      std::size_t payloadLength = 0;
+      for(std::size_t index = 0; index < segmentCount; ++index) {
+        payloadLength += std::to_integer<std::size_t>(segmentTable[index]);
+      }
+
+      std::size_t pageLength = OggPageHeaderSize + segmentCount + payloadLength;
+      if(fileLength - offset < pageLength) {
+        throw std::runtime_error(u8"Encoded Opus stream ends in the middle of an Ogg page");
+      }
+
+      // Verify the page's checksum. The checksum is calculated with the CRC field zeroed.
+      {
+        const std::byte zeroes[4] = { std::byte(0), std::byte(0), std::byte(0), std::byte(0) };
+        std::uint32_t crc = updateOggCrc(page, 22);
+        crc = updateOggCrc(zeroes, 4, crc);
+        crc = updateOggCrc(page + 26, pageLength - 26, crc);
+        if(crc != LittleEndian::Read<std::uint32_t>(page + 22)) {
+          throw std::runtime_error(u8"Encoded Opus stream contains a corrupted Ogg page");
+        }
+      }
+
+      std::uint32_t serialNumber = LittleEndian::Read<std::uint32_t>(page + 14);
+      if(isFirstPage) {
+        stream.SerialNumber = serialNumber;
+        isFirstPage = false;
+      }
+
+      // Only look at the first logical stream, the encoder only produces a single one
+      if(serialNumber == stream.SerialNumber) {
+        const std::byte *payload = segmentTable + segmentCount;
+        for(std::size_t index = 0; index < segmentCount; ++index) {
+          std::size_t segmentLength = std::to_integer<std::size_t>(segmentTable[index]);
+
+          std::vector<std::byte> *target;
+          if(packetIndex == 0) {
+            target = &stream.HeaderPacket;
+          } else if(packetIndex == 1) {
+            target = &stream.CommentPacket;
+          } else {
+            target = &stream.AudioData;
+          }
+          target->insert(target->end(), payload, payload + segmentLength);
+          payload += segmentLength;
+
+          // A lacing value below 255 ends the packet
+          if(segmentLength < 255) {
+            if(2 <= packetIndex) {
+              std::size_t packetLength = stream.AudioData.size() - packetStart;
+              std::uint32_t sampleCount = CountSamplesInPacket(
+                stream.AudioData.data() + packetStart, packetLength
+              );
+
+              std::uint64_t endPosition = sampleCount;
+              if(!stream.Packets.empty()) {
+                endPosition += stream.Packets.back().EndPosition;
+              }
+              stream.Packets.push_back(
+                OggOpusPacket { packetStart, packetLength, sampleCount, endPosition }
+              );
+              packetStart = stream.AudioData.size();
+            }
+
+            ++packetIndex;
+          } // if packet complete
+        } // for each segment
+
+        std::uint64_t granulePosition = LittleEndian::Read<std::uint64_t>(page + 6);
+        if(granulePosition != NoGranulePosition) {
+          stream.FinalGranulePosition = granulePosition;
+        }
+      } // if page belongs to first logical stream
+
+      offset += pageLength;
+    } // while pages remain
+
+    if(
+      (stream.HeaderPacket.size() < 19) ||
+      (std::memcmp(stream.HeaderPacket.data(), u8"OpusHead", 8) != 0)
+    ) {
+      throw std::runtime_error(u8"Encoded Ogg stream does not begin with an OpusHead header");
+    }
+
+    return stream;
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  std::uint32_t OggOpusStream::CountSamplesInPacket(
+    const std::byte *packet, std::size_t packetLength
+  ) {
+    if(packetLength == 0) {
+      return 0;
+    }
+
+    // The upper 5 bits of the TOC byte select the mode and frame duration.
+    // See RFC 6716, section 3.1 for the table this is derived from.
+    std::uint8_t toc = std::to_integer<std::uint8_t>(packet[0]);
+    std::uint8_t configuration = toc >> 3;
+
+    std::uint32_t samplesPerFrame;
+    if(configuration < 12) { // SILK-only: 10, 20, 40 or 60 ms
+      static const std::uint32_t silkFrameSizes[] = { 480, 960, 1920, 2880 };
+      samplesPerFrame = silkFrameSizes[configuration & 3];
+    } else if(configuration < 16) { // Hybrid: 10 or 20 ms
+      samplesPerFrame = ((configuration & 1) == 0) ? 480 : 960;
+    } else { // CELT-only: 2.5, 5, 10 or 20 ms
+      samplesPerFrame = 120U << (configuration & 3);
+    }
+
+    // The lowest 2 bits tell how many frames are stored in the packet
+    std::uint32_t frameCount;
+    switch(toc & 3) {
+      case 0: { frameCount = 1; break; }
+      case 1:
+      case 2: { frameCount = 2; break; }
+      default: {
+        if(packetLength < 2) {
+          throw std::runtime_error(u8"Encoded Opus stream contains a truncated packet");
+        }
+        frameCount = std::to_integer<std::uint32_t>(packet[1]) & 0x3f;
+        break;
+      }
+    }
+
+    return samplesPerFrame * frameCount;
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  std::uint32_t OggOpusStream::GetPreSkip() const {
+    if(this->HeaderPacket.size() < 12) {
+      throw std::runtime_error(u8"OpusHead header is too short");
+    }
+
+    return LittleEndian::Read<std::uint16_t>(this->HeaderPacket.data() + 10);
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  void OggOpusStream::AppendPacket(
+    const std::byte *packet, std::size_t packetLength, std::uint32_t sampleCount
+  ) {
+    std::uint64_t endPosition = sampleCount;
+    if(!this->Packets.empty()) {
+      endPosition += this->Packets.back().EndPosition;
+    }
+
+    this->Packets.push_back(
+      OggOpusPacket { this->AudioData.size(), packetLength, sampleCount, endPosition }
+    );
+    this->AudioData.insert(this->AudioData.end(), packet, packet + packetLength);
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  void OggOpusStream::Write(std::vector<std::byte> &fileContents) const {
+    OggPageWriter writer(fileContents, this->SerialNumber);
+
+    // The Ogg Opus specification requires both headers to be on pages of their own
+    writer.AddPacket(this->HeaderPacket.data(), this->HeaderPacket.size(), 0);
+    writer.Flush(false);
+    writer.AddPacket(this->CommentPacket.data(), this->CommentPacket.size(), 0);
+    writer.Flush(false);
+
+    std::size_t packetCount = this->Packets.size();
+    for(std::size_t index = 0; index < packetCount; ++index) {
+      const OggOpusPacket &packet = this->Packets[index];
+
+      // The last page's granule position tells the decoder how many samples
+      // to trim from the end, so it doesn't fall onto a packet boundary.
+      std::uint64_t granulePosition = packet.EndPosition;
+      if(index + 1 == packetCount) {
+        granulePosition = this->FinalGranulePosition;
+      }
+
+      writer.AddPacket(this->AudioData.data() + packet.Offset, packet.Size, granulePosition);
+    }
+
+    writer.Flush(true);
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+} // namespace Nuclex::OpusTranscoder::Audio
@@ -0,0 +1,117 @@
+#pragma region Apache License 2.0
+/*
+Nuclex Opus Transcoder
+Copyright (C) 2024 Markus Ewald / Nuclex Development Labs
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#pragma endregion // Apache License 2.0
+
+#ifndef NUCLEX_OPUSTRANSCODER_AUDIO_OGGOPUSSTREAM_H
+#define NUCLEX_OPUSTRANSCODER_AUDIO_OGGOPUSSTREAM_H
+
+#include "../Config.h"
+
+#include <vector> // for std::vector
+#include <cstdint> // for std::uint64_t, std::uint32_t
+#include <cstddef> // for std::byte
+
+namespace Nuclex::OpusTranscoder::Audio {
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Locates an Opus packet inside the audio data of an Ogg Opus stream</summary>
+  struct OggOpusPacket {
+
+    /// <summary>Offset of the packet's first byte in the stream's audio data</summary>
+    public: std::size_t Offset;
+    /// <summary>Length of the packet in bytes</summary>
+    public: std::size_t Size;
+    /// <summary>Number of samples (at 48 kHz) the packet decodes to</summary>
+    public: std::uint32_t SampleCount;
+    /// <summary>Position (at 48 kHz, counting pre-skip) at which the packet ends</summary>
+    public: std::uint64_t EndPosition;
+
+  };
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Packet-level representation of an Ogg Opus stream</summary>
+  /// <remarks>
+  ///   <para>
+  ///     This is not a decoder. It only takes apart the Ogg pages of a single-stream Ogg
+  ///     Opus file to get at the Opus packets, and can put them back together into Ogg pages.
+  ///     That allows us to stitch together several Opus streams that were encoded separately
+  ///     (with identical settings) into one continuous stream.
+  ///   </para>
+  ///   <para>
+  ///     Positions are given in samples at 48 kHz, which is what Ogg Opus granule positions
+  ///     use no matter the input sample rate. They include the pre-skip, so the first
+  ///     packet starts at position 0 and the first audible sample is at the pre-skip.
+  ///   </para>
+  /// </remarks>
+  class OggOpusStream {
+
+    /// <summary>Initializes a new, empty Ogg Opus stream</summary>
+    public: OggOpusStream();
+
+    /// <summary>Takes apart an Ogg Opus file into its Opus packets</summary>
+    /// <param name="fileContents">Contents of the Ogg Opus file</param>
+    /// <param name="fileLength">Length of the Ogg Opus file in bytes</param>
+    /// <returns>The packets of the first logical stream in the Ogg file</returns>
+    public: static OggOpusStream Parse(const std::byte *fileContents, std::size_t fileLength);
+
+    /// <summary>Determines how many samples an Opus packet will decode to</summary>
+    /// <param name="packet">Opus packet whose TOC byte will be examined</param>
+    /// <param name="packetLength">Length of the packet in bytes</param>
+    /// <returns>The number of samples at 48 kHz stored in the packet</returns>
+    public: static std::uint32_t CountSamplesInPacket(
+      const std::byte *packet, std::size_t packetLength
+    );
+
+    /// <summary>Reads the number of samples the decoder should skip at the start</summary>
+    /// <returns>The pre-skip stated in the OpusHead packet</returns>
+    public: std::uint32_t GetPreSkip() const;
+
+    /// <summary>Appends a packet to the stream's audio packets</summary>
+    /// <param name="packet">Contents of the packet that will be appended</param>
+    /// <param name="packetLength">Length of the packet in bytes</param>
+    /// <param name="sampleCount">Number of samples (at 48 kHz) stored in the packet</param>
+    public: void AppendPacket(
+      const std::byte *packet, std::size_t packetLength, std::uint32_t sampleCount
+    );
+
+    /// <summary>Packs the stream into Ogg pages, forming a complete Ogg Opus file</summary>
+    /// <param name="fileContents">Vector to which the Ogg Opus file will be appended</param>
+    public: void Write(std::vector<std::byte> &fileContents) const;
+
+    /// <summary>Serial number of the logical Ogg stream</summary>
+    public: std::uint32_t SerialNumber;
+    /// <summary>The OpusHead packet with the stream's codec setup</summary>
+    public: std::vector<std::byte> HeaderPacket;
+    /// <summary>The OpusTags packet with the vendor string and comments</summary>
+    public: std::vector<std::byte> CommentPacket;
+    /// <summary>Contents of all audio packets, stored back to back</summary>
+    public: std::vector<std::byte> AudioData;
+    /// <summary>Audio packets in the order in which they appear in the stream</summary>
+    public: std::vector<OggOpusPacket> Packets;
+    /// <summary>Granule position of the last page, may trim samples from the end</summary>
+    public: std::uint64_t FinalGranulePosition;
+
+  };
+
+  // ------------------------------------------------------------------------------------------- //
+
+} // namespace Nuclex::OpusTranscoder::Audio
+
+#endif // NUCLEX_OPUSTRANSCODER_AUDIO_OGGOPUSSTREAM_H
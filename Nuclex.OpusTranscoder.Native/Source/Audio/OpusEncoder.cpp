@@ -21,92 +21,60 @@ limitations under the License.
 #define NUCLEX_OPUSTRANSCODER_SOURCE 1
 
 #include "./OpusEncoder.h"
+#include "./SegmentedOpusEncoder.h"
+#include "./ChunkedMemoryFile.h"
 #include <Nuclex/Audio/Storage/AudioSaver.h>
 #include <Nuclex/Audio/Storage/AudioTrackEncoderBuilder.h>
 #include <Nuclex/Audio/Storage/AudioTrackEncoder.h>
 
-#include <cassert> // for assert()
-#include <algorithm> // for std::copy_n()
-
-namespace {
+namespace Nuclex::OpusTranscoder::Audio {
 
   // ------------------------------------------------------------------------------------------- //
-  // ------------------------------------------------------------------------------------------- //
-
-  /// <summary>Serves data contained in a byte buffer as a virtual file</summary>
-  class MemoryFile : public Nuclex::Audio::Storage::VirtualFile {
-
-    /// <summary>Initializes a new memory buffer based file</summary>
-    /// <param name="contents">Memory buffer holding the data of the virtual file</param>
-    public: MemoryFile(std::vector<std::byte> &&contents) :
-      contents(std::move(contents)) {}
-
-    /// <summary>Initializes a new memory buffer based file</summary>
-    public: MemoryFile() :
-      contents() {}
-
-    /// <summary>Frees all memory used by the instance</summary>
-    public: ~MemoryFile() override = default;
 
-    /// <summary>Determines the current size of the file in bytes</summary>
-    /// <returns>The size of the file in bytes</returns>
-    public: std::uint64_t GetSize() const override { return this->contents.size(); }
-
-    /// <summary>Reads data from the file</summary>
-    /// <param name="start">Offset in the file at which to begin reading</param>
-    /// <param name="byteCount">Number of bytes that will be read</param>
-    /// <parma name="buffer">Buffer into which the data will be read</param>
-    public: void ReadAt(
-      std::uint64_t start, std::size_t byteCount, std::byte *buffer
-    ) const override;
-
-    /// <summary>Writes data into the file</summary>
-    /// <param name="start">Offset at which writing will begin in the file</param>
-    /// <param name="byteCount">Number of bytes that should be written</param>
-    /// <param name="buffer">Buffer holding the data that should be written</param>
-    public: void WriteAt(
-      std::uint64_t start, std::size_t byteCount, const std::byte *buffer
-    ) override;
-
-    /// <summary>Memory buffer the virtual file implementation is serving data from</summary>
-    private: std::vector<std::byte> contents;
-
-  };
-
-  // ------------------------------------------------------------------------------------------- //
+  std::shared_ptr<Nuclex::Audio::Storage::AudioTrackEncoder> OpusEncoder::OpenEncoder(
+    const std::shared_ptr<Nuclex::Audio::Storage::VirtualFile> &target,
+    std::size_t channelCount,
+    std::size_t sampleRate,
+    float bitRateInKilobits,
+    float effort
+  ) {
+    Nuclex::Audio::Storage::AudioSaver saver;
 
-  void MemoryFile::ReadAt(
-    std::uint64_t start, std::size_t byteCount, std::byte *buffer
-  ) const {
-    assert((start < this->contents.size()) && u8"Read starts within file boundaries");
-    assert((this->contents.size() >= start + byteCount) && u8"Read ends within file boundaries");
-    std::copy_n(this->contents.data() + start, byteCount, buffer);
+    if(channelCount == 2) {
+      return saver.ProvideBuilder(u8"Opus")->
+        SetStereoChannels().
+        SetCompressionEffort(effort).
+        SetSampleRate(sampleRate).
+        SetTargetBitrate(bitRateInKilobits).
+        Build(target);
+    } else {
+      return saver.ProvideBuilder(u8"Opus")->
+        SetFiveDotOneChannelsInVorbisOrder().
+        SetCompressionEffort(effort).
+        SetSampleRate(sampleRate).
+        SetTargetBitrate(bitRateInKilobits).
+        Build(target);
+    }
   }
 
   // ------------------------------------------------------------------------------------------- //
 
-  void MemoryFile::WriteAt(
-    std::uint64_t start, std::size_t byteCount, const std::byte *buffer
+  std::uint64_t OpusEncoder::EstimateEncodedSize(
+    std::uint64_t frameCount, std::size_t sampleRate, float bitRateInKilobits
   ) {
-    if(start < this->contents.size()) {
-      std::size_t byteCountToCopy = std::min(this->contents.size() - start, byteCount);
-      std::copy_n(buffer, byteCountToCopy, this->contents.data() + start);
-
-      buffer += byteCountToCopy;
-      byteCount -= byteCountToCopy;
+    if(sampleRate == 0) {
+      return 0;
     }
 
-    this->contents.insert(this->contents.end(), buffer, buffer + byteCount);
+    // 125 bytes per kilobit, plus a quarter for bitrate overshoot and Ogg page headers.
+    // The 64 KiB cover the Opus headers and comments of the stream.
+    double seconds = static_cast<double>(frameCount) / static_cast<double>(sampleRate);
+    double audioByteCount = static_cast<double>(bitRateInKilobits) * 125.0 * seconds;
+    return static_cast<std::uint64_t>(audioByteCount * 1.25) + 65536;
   }
 
   // ------------------------------------------------------------------------------------------- //
 
-} // anonymous namespace
-
-namespace Nuclex::OpusTranscoder::Audio {
-
-  // ------------------------------------------------------------------------------------------- //
-
   std::shared_ptr<const Nuclex::Audio::Storage::VirtualFile> OpusEncoder::Encode(
     const std::shared_ptr<Track> &track,
     float bitRateInKilobits,
@@ -114,33 +82,31 @@ namespace Nuclex::OpusTranscoder::Audio {
     const std::shared_ptr<const Nuclex::Support::Threading::StopToken> &canceler,
     Nuclex::Support::Events::Delegate<void(float)> &progressCallback
   ) {
-    Nuclex::Audio::Storage::AudioSaver saver;
+    track->AdviseAccessPattern(SampleAccessPattern::Sequential);
 
-    std::shared_ptr<MemoryFile> encodedFile = std::make_shared<MemoryFile>();
+    std::uint64_t totalFrameCount = track->CountFrames();
 
-    std::shared_ptr<Nuclex::Audio::Storage::AudioTrackEncoder> encoder;
-    if(track->Channels.size() == 2) {
-      encoder = saver.ProvideBuilder(u8"Opus")->
-        SetStereoChannels().
-        SetCompressionEffort(effort).
-        SetSampleRate(track->SampleRate).
-        SetTargetBitrate(bitRateInKilobits).
-        Build(encodedFile);
-    } else {
-      encoder = saver.ProvideBuilder(u8"Opus")->
-        SetFiveDotOneChannelsInVorbisOrder().
-        SetCompressionEffort(effort).
-        SetSampleRate(track->SampleRate).
-        SetTargetBitrate(bitRateInKilobits).
-        Build(encodedFile);
-    }
+    // Reserve the memory up front so the encoder never waits for the file to grow
+    std::shared_ptr<ChunkedMemoryFile> encodedFile = std::make_shared<ChunkedMemoryFile>(
+      EstimateEncodedSize(totalFrameCount, track->SampleRate, bitRateInKilobits)
+    );
+
+    std::shared_ptr<Nuclex::Audio::Storage::AudioTrackEncoder> encoder = OpenEncoder(
+      encodedFile, track->Channels.size(), track->SampleRate, bitRateInKilobits, effort
+    );
 
     // The samples are already interleaved in Vorbis channel order, so we can
     // use them as-is and simply divide by the channel count to obtain the frame count.
-    std::uint64_t totalFrameCount = track->Samples.size() / track->Channels.size();
+    // Planar or compacted tracks are interleaved one chunk at a time while encoding.
     std::uint64_t remainingFrameCount = totalFrameCount;
     const float *samples = track->Samples.data();
 
+    SampleBuffer interleavedSamples;
+    bool interleaveChunks = track->IsPlanar || track->IsCompact();
+    if(interleaveChunks) {
+      interleavedSamples.resize(12000 * track->Channels.size());
+    }
+
     //FILE *x = fopen(u8"/srv/video/test.dat", "wb");
     //fwrite(samples, sizeof(float), track->Samples.size(), x);
     //fflush(x);
@@ -158,11 +124,18 @@ namespace Nuclex::OpusTranscoder::Audio {
       }
 
       // Feed the samples to the Opus encoder.
-      encoder->EncodeInterleaved(samples, frameCountInChunk);
+      if(interleaveChunks) {
+        track->InterleaveFrames(
+          totalFrameCount - remainingFrameCount, frameCountInChunk, interleavedSamples.data()
+        );
+        encoder->EncodeInterleaved(interleavedSamples.data(), frameCountInChunk);
+      } else {
+        encoder->EncodeInterleaved(samples, frameCountInChunk);
 
-      // The Opus encoder always processes all samples it is fed (probably keeping
-      // additional samples in an internal buffer, thus the need for ope_encoder_drain()).
-      samples += frameCountInChunk * track->Channels.size();
+        // The Opus encoder always processes all samples it is fed (probably keeping
+        // additional samples in an internal buffer, thus the need for ope_encoder_drain()).
+        samples += frameCountInChunk * track->Channels.size();
+      }
       remainingFrameCount -= frameCountInChunk;
 
       // Check if the user wants to cancel and send out a progress report
@@ -187,4 +160,18 @@ namespace Nuclex::OpusTranscoder::Audio {
 
   // ------------------------------------------------------------------------------------------- //
 
+  std::shared_ptr<const Nuclex::Audio::Storage::VirtualFile> OpusEncoder::EncodeInParallel(
+    const std::shared_ptr<Track> &track,
+    float bitRateInKilobits,
+    float effort,
+    Nuclex::Support::Threading::ThreadPool &threadPool,
+    const std::shared_ptr<const Nuclex::Support::Threading::StopToken> &canceler,
+    Nuclex::Support::Events::Delegate<void(float)> &progressCallback
+  ) {
+    SegmentedOpusEncoder encoder(track, bitRateInKilobits, effort);
+    return encoder.Encode(threadPool, canceler, progressCallback);
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
 } // namespace Nuclex::OpusTranscoder::Audio
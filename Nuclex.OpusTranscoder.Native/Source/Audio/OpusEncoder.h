@@ -26,9 +26,20 @@ limitations under the License.
 #include <Nuclex/Support/Threading/StopToken.h>
 #include <Nuclex/Support/Events/Delegate.h>
 #include <Nuclex/Audio/Storage/VirtualFile.h>
+#include <Nuclex/Audio/Storage/AudioTrackEncoder.h>
 
 #include <memory> // for std::shared_ptr
 
+namespace Nuclex::Support::Threading {
+
+  // ------------------------------------------------------------------------------------------- //
+
+  class ThreadPool;
+
+  // ------------------------------------------------------------------------------------------- //
+
+} // namespace Nuclex::Support::Threading
+
 namespace Nuclex::OpusTranscoder::Audio {
 
   // ------------------------------------------------------------------------------------------- //
@@ -36,6 +47,41 @@ namespace Nuclex::OpusTranscoder::Audio {
   /// <summary>Encodes interleaved audio samples to an in-memory Opus file</summary>
   class OpusEncoder {
 
+    /// <summary>Sets up an Opus encoder that writes into the specified file</summary>
+    /// <param name="target">File into which the encoded Opus stream will be written</param>
+    /// <param name="channelCount">
+    ///   Number of audio channels, either 2 for stereo or 6 for 5.1 in Vorbis order
+    /// </param>
+    /// <param name="sampleRate">Sample rate of the audio data that will be fed</param>
+    /// <param name="bitrate">Target bitrate for the encoded audio stream</param>
+    /// <param name="effort">Effort (cpu time) to invest for optimal compression</param>
+    /// <returns>An encoder to which interleaved samples can be fed in chunks</returns>
+    /// <remarks>
+    ///   This is for callers that want to produce the audio samples piece by piece rather
+    ///   than holding the whole track in memory. The caller is responsible for calling
+    ///   <see cref="Nuclex::Audio::Storage::AudioTrackEncoder::Flush" /> at the end.
+    /// </remarks>
+    public: static std::shared_ptr<Nuclex::Audio::Storage::AudioTrackEncoder> OpenEncoder(
+      const std::shared_ptr<Nuclex::Audio::Storage::VirtualFile> &target,
+      std::size_t channelCount,
+      std::size_t sampleRate,
+      float bitrate,
+      float effort
+    );
+
+    /// <summary>Estimates how large the Opus stream for a number of frames will be</summary>
+    /// <param name="frameCount">Number of frames that will be encoded</param>
+    /// <param name="sampleRate">Sample rate of the audio data that will be fed</param>
+    /// <param name="bitrate">Target bitrate for the encoded audio stream</param>
+    /// <returns>The expected size of the Opus file, erring on the larger side</returns>
+    /// <remarks>
+    ///   The bitrate is only a target and the encoder can exceed it for a while, so
+    ///   this adds some headroom. It's for reserving memory, not a hard limit.
+    /// </remarks>
+    public: static std::uint64_t EstimateEncodedSize(
+      std::uint64_t frameCount, std::size_t sampleRate, float bitrate
+    );
+
     /// <summary>Encodes the specified audio track into an Opus file</summary>
     /// <param name-"track">Track in which half-waves will be tucked</param>
     /// <param name-"bitrate">Target bitrate for the encoded audio stream</param>
@@ -51,6 +97,36 @@ namespace Nuclex::OpusTranscoder::Audio {
       Nuclex::Support::Events::Delegate<void(float)> &progressCallback
     );
 
+    /// <summary>Encodes the specified audio track using multiple threads</summary>
+    /// <param name-"track">Track in which half-waves will be tucked</param>
+    /// <param name-"bitrate">Target bitrate for the encoded audio stream</param>
+    /// <param name-"effort">Effort (cpu time) to invest for optimal compression</param>
+    /// <param name="threadPool">Thread pool on which the segments will be encoded</param>
+    /// <param name="canceler">Token by which the operation can be signalled to cancel</param>
+    /// <param name="progressCallback">Callback to which progress reports should be sent</param>
+    /// <returns>A virtual file containing the encoded Opus file contents</returns>
+    /// <remarks>
+    ///   <para>
+    ///     This is a one-shot use of the <see cref="SegmentedOpusEncoder" />. The track
+    ///     is split into segments that are encoded as independent Opus streams, each
+    ///     starting a second early so the encoder state can settle, then stitched together.
+    ///   </para>
+    ///   <para>
+    ///     The stitched stream is valid and continuous, but it is not bit-identical to what
+    ///     <see cref="Encode" /> produces. The codec state at the start of a segment has
+    ///     converged, but it never matches the serial encoder's exactly. Tracks that are
+    ///     short or whose sample rate is not a multiple of 50 Hz are encoded in one piece.
+    ///   </para>
+    /// </remarks>
+    public: static std::shared_ptr<const Nuclex::Audio::Storage::VirtualFile> EncodeInParallel(
+      const std::shared_ptr<Track> &track,
+      float bitrate,
+      float effort,
+      Nuclex::Support::Threading::ThreadPool &threadPool,
+      const std::shared_ptr<const Nuclex::Support::Threading::StopToken> &canceler,
+      Nuclex::Support::Events::Delegate<void(float)> &progressCallback
+    );
+
   };
 
   // ------------------------------------------------------------------------------------------- //
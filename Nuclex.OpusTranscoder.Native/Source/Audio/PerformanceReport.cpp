@@ -0,0 +1,326 @@
+#pragma region Apache License 2.0
+/*
+Nuclex Opus Transcoder
+Copyright (C) 2024 Markus Ewald / Nuclex Development Labs
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#pragma endregion // Apache License 2.0
+
+// If the application is compiled as a DLL, this ensures symbols are exported
+#define NUCLEX_OPUSTRANSCODER_SOURCE 1
+
+#include "./PerformanceReport.h"
+#include "./SampleBuffer.h"
+
+#include <Nuclex/Support/Text/LexicalAppend.h> // for lexical_append()
+
+#if defined(NUCLEX_OPUSTRANSCODER_WINDOWS)
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h> // for ::GetProcessTimes(), ::GetThreadTimes()
+#else
+#include <ctime> // for ::clock_gettime()
+#endif
+
+namespace {
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Names under which the stages appear in the JSON report</summary>
+  const char *const StageNames[] = {
+    u8"cache", u8"decode", u8"normalize", u8"transform", u8"resample", u8"detect",
+    u8"tuck", u8"compact", u8"encode", u8"integrate", u8"update", u8"write"
+  };
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Calculates the number of seconds between two points in time</summary>
+  /// <param name="startTime">Earlier point in time</param>
+  /// <param name="endTime">Later point in time</param>
+  /// <returns>The number of seconds that lie between the two points in time</returns>
+  double secondsBetween(
+    std::chrono::steady_clock::time_point startTime,
+    std::chrono::steady_clock::time_point endTime
+  ) {
+    return std::chrono::duration<double>(endTime - startTime).count();
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+#if defined(NUCLEX_OPUSTRANSCODER_WINDOWS)
+  /// <summary>Adds up the kernel and user times reported by Windows</summary>
+  /// <param name="kernelTime">Time spent in kernel mode</param>
+  /// <param name="userTime">Time spent in user mode</param>
+  /// <returns>The sum of both times in seconds</returns>
+  double secondsFromFileTimes(const FILETIME &kernelTime, const FILETIME &userTime) {
+    std::uint64_t ticks = (
+      ((static_cast<std::uint64_t>(kernelTime.dwHighDateTime) << 32) | kernelTime.dwLowDateTime) +
+      ((static_cast<std::uint64_t>(userTime.dwHighDateTime) << 32) | userTime.dwLowDateTime)
+    );
+    return static_cast<double>(ticks) / 10000000.0; // FILETIMEs count 100 ns ticks
+  }
+#else
+  /// <summary>Reads the specified CPU time clock</summary>
+  /// <param name="clock">Clock that will be read</param>
+  /// <returns>The CPU time measured by the clock in seconds, 0 if it can't be read</returns>
+  double readCpuClock(::clockid_t clock) {
+    struct ::timespec time;
+    if(::clock_gettime(clock, &time) != 0) {
+      return 0.0;
+    }
+    return static_cast<double>(time.tv_sec) + static_cast<double>(time.tv_nsec) / 1e9;
+  }
+#endif
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Appends a string to a JSON document as a quoted, escaped string</summary>
+  /// <param name="json">JSON document the string will be appended to</param>
+  /// <param name="text">UTF-8 string that will be appended</param>
+  void appendJsonString(std::string &json, const std::string &text) {
+    static const char hexDigits[] = u8"0123456789abcdef";
+
+    json.push_back('"');
+    for(char character : text) {
+      if((character == '"') || (character == '\\')) {
+        json.push_back('\\');
+        json.push_back(character);
+      } else if(static_cast<unsigned char>(character) < 0x20) {
+        json.append(u8"\\u00", 4);
+        json.push_back(hexDigits[static_cast<unsigned char>(character) >> 4]);
+        json.push_back(hexDigits[static_cast<unsigned char>(character) & 0xF]);
+      } else {
+        json.push_back(character); // UTF-8 sequences can be copied as they are
+      }
+    }
+    json.push_back('"');
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Appends a key to a JSON object</summary>
+  /// <param name="json">JSON document the key will be appended to</param>
+  /// <param name="key">Name of the key, must not need escaping</param>
+  /// <param name="isFirst">Whether this is the first key in the object</param>
+  void appendJsonKey(std::string &json, const char *key, bool isFirst = false) {
+    if(!isFirst) {
+      json.push_back(',');
+    }
+    json.push_back('"');
+    json.append(key);
+    json.append(u8"\":", 2);
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+} // anonymous namespace
+
+namespace Nuclex::OpusTranscoder::Audio {
+
+  // ------------------------------------------------------------------------------------------- //
+
+  PerformanceReport::StageTimer::StageTimer(
+    PerformanceReport &report, PerformanceStage measuredStage,
+    bool onlyCallingThread /* = false */
+  ) :
+    stage(report.GetStage(measuredStage)),
+    onlyCallingThread(onlyCallingThread),
+    startTime(std::chrono::steady_clock::now()),
+    startCpuSeconds(onlyCallingThread ? GetThreadCpuSeconds() : GetProcessCpuSeconds()) {}
+
+  // ------------------------------------------------------------------------------------------- //
+
+  PerformanceReport::StageTimer::~StageTimer() {
+    double endCpuSeconds = (
+      this->onlyCallingThread ? GetThreadCpuSeconds() : GetProcessCpuSeconds()
+    );
+
+    ++this->stage.RunCount;
+    this->stage.WallSeconds += secondsBetween(this->startTime, std::chrono::steady_clock::now());
+    this->stage.CpuSeconds += endCpuSeconds - this->startCpuSeconds;
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  PerformanceReport::PerformanceReport() :
+    inputPath(),
+    outputPath(),
+    trackIndex(0),
+    outcome(),
+    stages(),
+    remainingHalfwaveCounts(),
+    peakMeasurement(0),
+    peakSampleByteCount(0),
+    startTime(),
+    startCpuSeconds(0.0),
+    wallSeconds(0.0),
+    cpuSeconds(0.0) {}
+
+  // ------------------------------------------------------------------------------------------- //
+
+  void PerformanceReport::Begin(
+    const std::string &newInputPath, const std::string &newOutputPath, std::size_t newTrackIndex
+  ) {
+    if(this->peakMeasurement != 0) {
+      SampleMemory::EndPeakMeasurement(this->peakMeasurement); // End() wasn't called
+      this->peakMeasurement = 0;
+    }
+
+    this->inputPath = newInputPath;
+    this->outputPath = newOutputPath;
+    this->trackIndex = newTrackIndex;
+    this->outcome.clear();
+    this->stages.fill(Stage());
+    this->remainingHalfwaveCounts.clear();
+    this->peakSampleByteCount = 0;
+    this->wallSeconds = 0.0;
+    this->cpuSeconds = 0.0;
+
+    this->peakMeasurement = SampleMemory::BeginPeakMeasurement();
+    this->startTime = std::chrono::steady_clock::now();
+    this->startCpuSeconds = GetProcessCpuSeconds();
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  void PerformanceReport::End(const std::string &newOutcome) {
+    this->wallSeconds = secondsBetween(this->startTime, std::chrono::steady_clock::now());
+    this->cpuSeconds = GetProcessCpuSeconds() - this->startCpuSeconds;
+    if(this->peakMeasurement != 0) {
+      this->peakSampleByteCount = SampleMemory::EndPeakMeasurement(this->peakMeasurement);
+      this->peakMeasurement = 0;
+    }
+    this->outcome = newOutcome;
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  void PerformanceReport::AddDeclippingRound(std::size_t remainingHalfwaveCount) {
+    this->remainingHalfwaveCounts.push_back(remainingHalfwaveCount);
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  std::string PerformanceReport::ToJson() const {
+    using Nuclex::Support::Text::lexical_append;
+
+    std::string json(1, '{');
+
+    appendJsonKey(json, u8"input", true);
+    appendJsonString(json, this->inputPath);
+    appendJsonKey(json, u8"output");
+    appendJsonString(json, this->outputPath);
+    appendJsonKey(json, u8"trackIndex");
+    lexical_append(json, this->trackIndex);
+    appendJsonKey(json, u8"outcome");
+    appendJsonString(json, this->outcome);
+    appendJsonKey(json, u8"wallSeconds");
+    lexical_append(json, this->wallSeconds);
+    appendJsonKey(json, u8"cpuSeconds");
+    lexical_append(json, this->cpuSeconds);
+    appendJsonKey(json, u8"peakSampleBytes");
+    lexical_append(json, this->peakSampleByteCount);
+
+    appendJsonKey(json, u8"declippingRounds");
+    lexical_append(json, this->remainingHalfwaveCounts.size());
+    appendJsonKey(json, u8"remainingHalfwaves");
+    json.push_back('[');
+    for(std::size_t index = 0; index < this->remainingHalfwaveCounts.size(); ++index) {
+      if(index > 0) {
+        json.push_back(',');
+      }
+      lexical_append(json, this->remainingHalfwaveCounts[index]);
+    }
+    json.push_back(']');
+
+    appendJsonKey(json, u8"stages");
+    json.push_back('[');
+    bool isFirstStage = true;
+    for(std::size_t index = 0; index < StageCount; ++index) {
+      const Stage &stage = this->stages[index];
+      if(stage.RunCount == 0) {
+        continue;
+      }
+
+      if(!isFirstStage) {
+        json.push_back(',');
+      }
+      isFirstStage = false;
+
+      // Throughput is given in whole bytes per second, nobody needs the fractions
+      // and it keeps exponents out of the numbers monitoring tools have to parse
+      std::uint64_t bytesPerSecond = 0;
+      if(stage.WallSeconds > 0.0) {
+        bytesPerSecond = static_cast<std::uint64_t>(
+          static_cast<double>(stage.ByteCount) / stage.WallSeconds
+        );
+      }
+
+      json.push_back('{');
+      appendJsonKey(json, u8"name", true);
+      appendJsonString(json, std::string(StageNames[index]));
+      appendJsonKey(json, u8"runs");
+      lexical_append(json, stage.RunCount);
+      appendJsonKey(json, u8"wallSeconds");
+      lexical_append(json, stage.WallSeconds);
+      appendJsonKey(json, u8"cpuSeconds");
+      lexical_append(json, stage.CpuSeconds);
+      appendJsonKey(json, u8"bytes");
+      lexical_append(json, stage.ByteCount);
+      appendJsonKey(json, u8"bytesPerSecond");
+      lexical_append(json, bytesPerSecond);
+      json.push_back('}');
+    }
+    json.push_back(']');
+
+    json.push_back('}');
+    return json;
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  double PerformanceReport::GetProcessCpuSeconds() {
+#if defined(NUCLEX_OPUSTRANSCODER_WINDOWS)
+    FILETIME creationTime, exitTime, kernelTime, userTime;
+    BOOL result = ::GetProcessTimes(
+      ::GetCurrentProcess(), &creationTime, &exitTime, &kernelTime, &userTime
+    );
+    if(result == FALSE) {
+      return 0.0;
+    }
+    return secondsFromFileTimes(kernelTime, userTime);
+#else
+    return readCpuClock(CLOCK_PROCESS_CPUTIME_ID);
+#endif
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  double PerformanceReport::GetThreadCpuSeconds() {
+#if defined(NUCLEX_OPUSTRANSCODER_WINDOWS)
+    FILETIME creationTime, exitTime, kernelTime, userTime;
+    BOOL result = ::GetThreadTimes(
+      ::GetCurrentThread(), &creationTime, &exitTime, &kernelTime, &userTime
+    );
+    if(result == FALSE) {
+      return 0.0;
+    }
+    return secondsFromFileTimes(kernelTime, userTime);
+#else
+    return readCpuClock(CLOCK_THREAD_CPUTIME_ID);
+#endif
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+} // namespace Nuclex::OpusTranscoder::Audio
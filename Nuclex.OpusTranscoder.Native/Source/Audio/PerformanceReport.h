@@ -0,0 +1,243 @@
+#pragma region Apache License 2.0
+/*
+Nuclex Opus Transcoder
+Copyright (C) 2024 Markus Ewald / Nuclex Development Labs
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#pragma endregion // Apache License 2.0
+
+#ifndef NUCLEX_OPUSTRANSCODER_AUDIO_PERFORMANCEREPORT_H
+#define NUCLEX_OPUSTRANSCODER_AUDIO_PERFORMANCEREPORT_H
+
+#include "../Config.h"
+
+#include <array> // for std::array
+#include <chrono> // for std::chrono::steady_clock
+#include <cstddef> // for std::size_t
+#include <cstdint> // for std::uint64_t
+#include <string> // for std::string
+#include <vector> // for std::vector
+
+namespace Nuclex::OpusTranscoder::Audio {
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Stages a transcode goes through that are measured separately</summary>
+  enum class PerformanceStage {
+
+    /// <summary>Hashing the input file to look it up in the output cache</summary>
+    Cache,
+    /// <summary>Decoding the input file into audio samples</summary>
+    Decode,
+    /// <summary>Measuring the peak amplitudes to normalize the track</summary>
+    Normalize,
+    /// <summary>Downmixing and reordering the channels to the output layout</summary>
+    Transform,
+    /// <summary>Bringing the samples to the sample rate of the Opus codec</summary>
+    Resample,
+    /// <summary>Finding the half-waves that clip in the original samples</summary>
+    Detect,
+    /// <summary>Scaling down the half-waves that clip in the samples</summary>
+    Tuck,
+    /// <summary>Packing the original samples back to their integer width</summary>
+    Compact,
+    /// <summary>Encoding the samples (or the changed segments) with Opus</summary>
+    Encode,
+    /// <summary>Decoding the encoded segments and integrating new clipping</summary>
+    Integrate,
+    /// <summary>Working out new volume quotients for the still clipping half-waves</summary>
+    Update,
+    /// <summary>Writing the Opus file to disk</summary>
+    Write
+
+  };
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Records where time and memory went during a transcode</summary>
+  /// <remarks>
+  ///   <para>
+  ///     Each stage sums up the wall clock time and CPU time of all its runs and how many
+  ///     bytes it processed. Stages that fan out to the thread pool are given the CPU time
+  ///     of the whole process, so when several transcodes run in parallel, they also see
+  ///     the CPU time of the others. Compared to the wall clock time, it still tells how
+  ///     well a stage kept the cores busy.
+  ///   </para>
+  ///   <para>
+  ///     The report isn't synchronized. Different stages can be measured from different
+  ///     threads at the same time, but the same stage only from one thread at a time.
+  ///   </para>
+  /// </remarks>
+  class PerformanceReport {
+
+    /// <summary>Number of stages the report keeps measurements for</summary>
+    public: static constexpr std::size_t StageCount = (
+      static_cast<std::size_t>(PerformanceStage::Write) + 1
+    );
+
+    /// <summary>Measurements summed up over all runs of a stage</summary>
+    public: struct Stage {
+
+      /// <summary>How many times the stage ran</summary>
+      public: std::size_t RunCount;
+      /// <summary>Wall clock time spent in the stage, in seconds</summary>
+      public: double WallSeconds;
+      /// <summary>CPU time used while in the stage, in seconds</summary>
+      public: double CpuSeconds;
+      /// <summary>Number of bytes the stage processed</summary>
+      public: std::uint64_t ByteCount;
+
+    };
+
+    /// <summary>Measures one run of a stage while it is in scope</summary>
+    public: class StageTimer {
+
+      /// <summary>Begins measuring a run of the specified stage</summary>
+      /// <param name="report">Report the measurements will be added to</param>
+      /// <param name="stage">Stage whose run will be measured</param>
+      /// <param name="onlyCallingThread">
+      ///   Whether to count only the CPU time of the calling thread, for stages that
+      ///   do all their work on one thread while others run in parallel
+      /// </param>
+      public: StageTimer(
+        PerformanceReport &report, PerformanceStage stage, bool onlyCallingThread = false
+      );
+
+      /// <summary>Adds the time since construction to the stage</summary>
+      public: ~StageTimer();
+
+      /// <summary>Adds bytes to the number of bytes the stage processed</summary>
+      /// <param name="byteCount">Number of bytes that will be added</param>
+      public: void AddBytes(std::uint64_t byteCount) { this->stage.ByteCount += byteCount; }
+
+      /// <summary>Stage the measurements are added to</summary>
+      private: Stage &stage;
+      /// <summary>Whether only the CPU time of the calling thread is counted</summary>
+      private: bool onlyCallingThread;
+      /// <summary>Time at which the run began</summary>
+      private: std::chrono::steady_clock::time_point startTime;
+      /// <summary>CPU time used up to the beginning of the run, in seconds</summary>
+      private: double startCpuSeconds;
+
+    };
+
+    /// <summary>Initializes a new, empty performance report</summary>
+    public: PerformanceReport();
+
+    /// <summary>Clears the report and begins measuring a new job</summary>
+    /// <param name="inputPath">Path of the audio file that is being transcoded</param>
+    /// <param name="outputPath">Path the Opus file is going to be saved under</param>
+    /// <param name="trackIndex">Zero-based index of the track that is transcoded</param>
+    /// <remarks>
+    ///   This also begins measuring the peak sample memory. <see cref="End" /> must
+    ///   be called once the job is over, whether it succeeded or not.
+    /// </remarks>
+    public: void Begin(
+      const std::string &inputPath, const std::string &outputPath, std::size_t trackIndex
+    );
+
+    /// <summary>Ends the measurements of the job</summary>
+    /// <param name="outcome">How the job ended, i.e. "succeeded" or "failed"</param>
+    public: void End(const std::string &outcome);
+
+    /// <summary>Looks up the measurements of a stage</summary>
+    /// <param name="stage">Stage whose measurements will be returned</param>
+    /// <returns>The measurements of the specified stage</returns>
+    public: Stage &GetStage(PerformanceStage stage) {
+      return this->stages[static_cast<std::size_t>(stage)];
+    }
+
+    /// <summary>Looks up the measurements of a stage</summary>
+    /// <param name="stage">Stage whose measurements will be returned</param>
+    /// <returns>The measurements of the specified stage</returns>
+    public: const Stage &GetStage(PerformanceStage stage) const {
+      return this->stages[static_cast<std::size_t>(stage)];
+    }
+
+    /// <summary>Records that a round of iterative declipping has been verified</summary>
+    /// <param name="remainingHalfwaveCount">
+    ///   Number of half-waves that still clipped after the round
+    /// </param>
+    public: void AddDeclippingRound(std::size_t remainingHalfwaveCount);
+
+    /// <summary>Returns the number of half-waves still clipping after each round</summary>
+    /// <returns>The remaining half-wave counts of all declipping rounds in order</returns>
+    public: const std::vector<std::size_t> &GetRemainingHalfwaveCounts() const {
+      return this->remainingHalfwaveCounts;
+    }
+
+    /// <summary>Returns the highest amount of sample memory in use during the job</summary>
+    /// <returns>The peak number of bytes allocated for audio samples</returns>
+    /// <remarks>
+    ///   Sample memory is counted for the whole process, so this includes the samples
+    ///   of other jobs that ran at the same time.
+    /// </remarks>
+    public: std::size_t GetPeakSampleByteCount() const { return this->peakSampleByteCount; }
+
+    /// <summary>Returns the wall clock time the whole job took</summary>
+    /// <returns>The wall clock time between beginning and ending the job, in seconds</returns>
+    public: double GetWallSeconds() const { return this->wallSeconds; }
+
+    /// <summary>Returns the CPU time of the process while the job ran</summary>
+    /// <returns>The CPU time used between beginning and ending the job, in seconds</returns>
+    public: double GetCpuSeconds() const { return this->cpuSeconds; }
+
+    /// <summary>Formats the report as a single line of JSON</summary>
+    /// <returns>A JSON object holding all measurements of the report</returns>
+    /// <remarks>
+    ///   Stages that never ran are left out. Being a single line, reports of many jobs
+    ///   can be appended to the same file and read back one line at a time.
+    /// </remarks>
+    public: std::string ToJson() const;
+
+    /// <summary>Looks up how much CPU time the process has used so far</summary>
+    /// <returns>The CPU time used by all threads of the process, in seconds</returns>
+    public: static double GetProcessCpuSeconds();
+
+    /// <summary>Looks up how much CPU time the calling thread has used so far</summary>
+    /// <returns>The CPU time used by the calling thread, in seconds</returns>
+    public: static double GetThreadCpuSeconds();
+
+    /// <summary>Path of the audio file that was transcoded</summary>
+    private: std::string inputPath;
+    /// <summary>Path the Opus file was saved under</summary>
+    private: std::string outputPath;
+    /// <summary>Zero-based index of the track that was transcoded</summary>
+    private: std::size_t trackIndex;
+    /// <summary>How the job ended, empty while it is still running</summary>
+    private: std::string outcome;
+    /// <summary>Measurements of each stage</summary>
+    private: std::array<Stage, StageCount> stages;
+    /// <summary>Number of half-waves still clipping after each declipping round</summary>
+    private: std::vector<std::size_t> remainingHalfwaveCounts;
+    /// <summary>Identifier of the running sample memory measurement, 0 if none</summary>
+    private: std::size_t peakMeasurement;
+    /// <summary>Highest number of bytes allocated for samples during the job</summary>
+    private: std::size_t peakSampleByteCount;
+    /// <summary>Time at which the job began</summary>
+    private: std::chrono::steady_clock::time_point startTime;
+    /// <summary>CPU time the process had used when the job began, in seconds</summary>
+    private: double startCpuSeconds;
+    /// <summary>Wall clock time the whole job took, in seconds</summary>
+    private: double wallSeconds;
+    /// <summary>CPU time the process used while the job ran, in seconds</summary>
+    private: double cpuSeconds;
+
+  };
+
+  // ------------------------------------------------------------------------------------------- //
+
+} // namespace Nuclex::OpusTranscoder::Audio
+
+#endif // NUCLEX_OPUSTRANSCODER_AUDIO_PERFORMANCEREPORT_H
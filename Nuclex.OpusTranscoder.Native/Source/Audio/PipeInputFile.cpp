@@ -0,0 +1,196 @@
+#pragma region Apache License 2.0
+/*
+Nuclex Opus Transcoder
+Copyright (C) 2024 Markus Ewald / Nuclex Development Labs
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#pragma endregion // Apache License 2.0
+
+// If the application is compiled as a DLL, this ensures symbols are exported
+#define NUCLEX_OPUSTRANSCODER_SOURCE 1
+
+#include "./PipeInputFile.h"
+
+#include <stdexcept> // for std::runtime_error
+#include <limits> // for std::numeric_limits
+#include <algorithm> // for std::min()
+#include <cstring> // for std::memcpy()
+
+#if defined(NUCLEX_OPUSTRANSCODER_WINDOWS)
+#include <io.h> // for ::_setmode(), ::_fileno()
+#include <fcntl.h> // for _O_BINARY
+#endif
+
+namespace {
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Number of bytes requested from the stream in one go</summary>
+  const std::size_t ChunkSize = 65536;
+
+  // ------------------------------------------------------------------------------------------- //
+
+} // anonymous namespace
+
+namespace Nuclex::OpusTranscoder::Audio {
+
+  // ------------------------------------------------------------------------------------------- //
+
+  const std::size_t PipeInputFile::RetainedHeadSize = 1048576; // 1 MiB
+
+  // ------------------------------------------------------------------------------------------- //
+
+  const std::size_t PipeInputFile::RetainedWindowSize = 8388608; // 8 MiB
+
+  // ------------------------------------------------------------------------------------------- //
+
+  std::shared_ptr<PipeInputFile> PipeInputFile::GetStandardInput() {
+    static std::shared_ptr<PipeInputFile> standardInput = (
+      []() {
+#if defined(NUCLEX_OPUSTRANSCODER_WINDOWS)
+        ::_setmode(::_fileno(stdin), _O_BINARY);
+#endif
+        return std::make_shared<PipeInputFile>(stdin);
+      }
+    )();
+
+    return standardInput;
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  PipeInputFile::PipeInputFile(std::FILE *stream) :
+    readMutex(),
+    stream(stream),
+    head(),
+    window(),
+    windowOffset(0),
+    isAtEnd(false) {}
+
+  // ------------------------------------------------------------------------------------------- //
+
+  std::uint64_t PipeInputFile::GetSize() const {
+    std::unique_lock<std::mutex> readScope(this->readMutex);
+    if(this->isAtEnd) {
+      return this->windowOffset + this->window.size();
+    } else {
+      return std::numeric_limits<std::uint64_t>::max();
+    }
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  void PipeInputFile::ReadAt(
+    std::uint64_t start, std::size_t byteCount, std::byte *buffer
+  ) const {
+    std::unique_lock<std::mutex> readScope(this->readMutex);
+
+    if(!readUpTo(start + byteCount, start)) {
+      throw std::runtime_error(u8"Attempted to read beyond the end of the piped input");
+    }
+
+    while(byteCount > 0) {
+      std::size_t chunkLength;
+      if(start >= this->windowOffset) {
+        std::size_t windowStart = static_cast<std::size_t>(start - this->windowOffset);
+        chunkLength = byteCount;
+        std::memcpy(buffer, this->window.data() + windowStart, chunkLength);
+      } else if(start < this->head.size()) {
+        std::size_t headStart = static_cast<std::size_t>(start);
+        chunkLength = std::min(byteCount, this->head.size() - headStart);
+        std::memcpy(buffer, this->head.data() + headStart, chunkLength);
+      } else {
+        throw std::runtime_error(
+          u8"Piped input can't seek back that far, the audio format is not suited for piping"
+        );
+      }
+
+      start += chunkLength;
+      byteCount -= chunkLength;
+      buffer += chunkLength;
+    }
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  void PipeInputFile::WriteAt(
+    std::uint64_t start, std::size_t byteCount, const std::byte *buffer
+  ) {
+    (void)start;
+    (void)byteCount;
+    (void)buffer;
+    throw std::runtime_error(u8"Piped input can not be written to");
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  bool PipeInputFile::readUpTo(std::uint64_t endOffset, std::uint64_t keepOffset) const {
+    while(this->windowOffset + this->window.size() < endOffset) {
+      if(this->isAtEnd) {
+        return false;
+      }
+
+      // Read the next chunk from the stream directly into the window
+      std::size_t previousSize = this->window.size();
+      this->window.resize(previousSize + ChunkSize);
+      std::size_t readByteCount = std::fread(
+        this->window.data() + previousSize, 1, ChunkSize, this->stream
+      );
+      this->window.resize(previousSize + readByteCount);
+      if(readByteCount < ChunkSize) {
+        if(std::ferror(this->stream) != 0) {
+          throw std::runtime_error(u8"Error reading from piped input");
+        }
+        this->isAtEnd = true;
+      }
+
+      // If the start of the stream just went by, copy it into the head for later
+      if(this->head.size() < RetainedHeadSize) {
+        std::uint64_t readOffset = this->windowOffset + previousSize;
+        if(readOffset == this->head.size()) {
+          std::size_t copyLength = std::min(
+            RetainedHeadSize - this->head.size(), readByteCount
+          );
+          this->head.insert(
+            this->head.end(),
+            this->window.begin() + previousSize,
+            this->window.begin() + previousSize + copyLength
+          );
+        }
+      }
+
+      // Drop the oldest data once the window has grown to twice its size. Doing
+      // this in large steps keeps the number of bytes shifted around low.
+      if(this->window.size() >= RetainedWindowSize * 2) {
+        std::size_t dropLength = this->window.size() - RetainedWindowSize;
+        if(keepOffset < this->windowOffset + dropLength) {
+          if(keepOffset <= this->windowOffset) {
+            dropLength = 0;
+          } else {
+            dropLength = static_cast<std::size_t>(keepOffset - this->windowOffset);
+          }
+        }
+        if(dropLength > 0) {
+          this->window.erase(this->window.begin(), this->window.begin() + dropLength);
+          this->windowOffset += dropLength;
+        }
+      }
+    } // while the requested end has not been read yet
+
+    return true;
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+} // namespace Nuclex::OpusTranscoder::Audio
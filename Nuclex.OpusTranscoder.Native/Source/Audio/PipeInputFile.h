@@ -0,0 +1,122 @@
+#pragma region Apache License 2.0
+/*
+Nuclex Opus Transcoder
+Copyright (C) 2024 Markus Ewald / Nuclex Development Labs
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#pragma endregion // Apache License 2.0
+
+#ifndef NUCLEX_OPUSTRANSCODER_AUDIO_PIPEINPUTFILE_H
+#define NUCLEX_OPUSTRANSCODER_AUDIO_PIPEINPUTFILE_H
+
+#include "../Config.h"
+
+#include <Nuclex/Audio/Storage/VirtualFile.h>
+
+#include <vector> // for std::vector
+#include <mutex> // for std::mutex
+#include <cstdio> // for std::FILE
+#include <cstddef> // for std::byte
+#include <memory> // for std::shared_ptr
+
+namespace Nuclex::OpusTranscoder::Audio {
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Serves a stream that can only be read front to back as a virtual file</summary>
+  /// <remarks>
+  ///   <para>
+  ///     Decoders expect to read at arbitrary offsets, but a pipe can only be read once,
+  ///     from start to end. This file reads the stream as far as the decoder asks and keeps
+  ///     two pieces of it around: the start of the stream, where the headers are that
+  ///     get probed more than once while a decoder is chosen, and the most recently read
+  ///     stretch, so decoders can look back a little. Reading anything before that fails.
+  ///   </para>
+  ///   <para>
+  ///     The size of the stream is unknown until its end has been reached, so until then
+  ///     the file reports the largest size it can. Only formats that state the length of
+  ///     their audio data in their headers (like WAV and WavPack) can be read this way.
+  ///   </para>
+  /// </remarks>
+  class PipeInputFile : public Nuclex::Audio::Storage::VirtualFile {
+
+    /// <summary>Number of bytes at the start of the stream that are always kept</summary>
+    public: static const std::size_t RetainedHeadSize;
+
+    /// <summary>Number of recently read bytes that are kept for reading again</summary>
+    public: static const std::size_t RetainedWindowSize;
+
+    /// <summary>Provides the process' standard input as a virtual file</summary>
+    /// <returns>The virtual file reading from standard input</returns>
+    /// <remarks>
+    ///   Standard input can only be consumed once, so this always returns the same
+    ///   instance. Everyone reading the metadata or audio data of standard input in
+    ///   the process has to go through it.
+    /// </remarks>
+    public: static std::shared_ptr<PipeInputFile> GetStandardInput();
+
+    /// <summary>Initializes a new virtual file reading from a stream</summary>
+    /// <param name="stream">Stream that will be read, not closed by the file</param>
+    public: PipeInputFile(std::FILE *stream);
+
+    /// <summary>Frees all memory used by the instance</summary>
+    public: ~PipeInputFile() override = default;
+
+    /// <summary>Determines the current size of the file in bytes</summary>
+    /// <returns>The size of the file in bytes or the largest size if not known yet</returns>
+    public: std::uint64_t GetSize() const override;
+
+    /// <summary>Reads data from the file</summary>
+    /// <param name="start">Offset in the file at which to begin reading</param>
+    /// <param name="byteCount">Number of bytes that will be read</param>
+    /// <parma name="buffer">Buffer into which the data will be read</param>
+    public: void ReadAt(
+      std::uint64_t start, std::size_t byteCount, std::byte *buffer
+    ) const override;
+
+    /// <summary>Writes data into the file</summary>
+    /// <param name="start">Offset at which writing will begin in the file</param>
+    /// <param name="byteCount">Number of bytes that should be written</param>
+    /// <param name="buffer">Buffer holding the data that should be written</param>
+    /// <remarks>Always throws, the file can only be read</remarks>
+    public: void WriteAt(
+      std::uint64_t start, std::size_t byteCount, const std::byte *buffer
+    ) override;
+
+    /// <summary>Reads from the stream until it has been read up to an offset</summary>
+    /// <param name="endOffset">Offset up to which the stream should have been read</param>
+    /// <param name="keepOffset">Offset from which the read data has to be kept</param>
+    /// <returns>True if the offset was reached, false if the stream ended before</returns>
+    private: bool readUpTo(std::uint64_t endOffset, std::uint64_t keepOffset) const;
+
+    /// <summary>Must be held while reading from the stream or accessing the buffers</summary>
+    private: mutable std::mutex readMutex;
+    /// <summary>Stream the data is read from</summary>
+    private: std::FILE *stream;
+    /// <summary>The first bytes of the stream</summary>
+    private: mutable std::vector<std::byte> head;
+    /// <summary>The most recently read bytes of the stream past the head</summary>
+    private: mutable std::vector<std::byte> window;
+    /// <summary>Offset in the stream of the first byte in the window</summary>
+    private: mutable std::uint64_t windowOffset;
+    /// <summary>Whether the end of the stream has been reached</summary>
+    private: mutable bool isAtEnd;
+
+  };
+
+  // ------------------------------------------------------------------------------------------- //
+
+} // namespace Nuclex::OpusTranscoder::Audio
+
+#endif // NUCLEX_OPUSTRANSCODER_AUDIO_PIPEINPUTFILE_H
@@ -0,0 +1,88 @@
+#pragma region Apache License 2.0
+/*
+Nuclex Opus Transcoder
+Copyright (C) 2024 Markus Ewald / Nuclex Development Labs
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#pragma endregion // Apache License 2.0
+
+// If the application is compiled as a DLL, this ensures symbols are exported
+#define NUCLEX_OPUSTRANSCODER_SOURCE 1
+
+#include "./PipeOutputFile.h"
+
+#include <stdexcept> // for std::runtime_error
+
+#if defined(NUCLEX_OPUSTRANSCODER_WINDOWS)
+#include <io.h> // for ::_setmode(), ::_fileno()
+#include <fcntl.h> // for _O_BINARY
+#endif
+
+namespace Nuclex::OpusTranscoder::Audio {
+
+  // ------------------------------------------------------------------------------------------- //
+
+  std::shared_ptr<PipeOutputFile> PipeOutputFile::OpenStandardOutput() {
+#if defined(NUCLEX_OPUSTRANSCODER_WINDOWS)
+    ::_setmode(::_fileno(stdout), _O_BINARY);
+#endif
+    return std::make_shared<PipeOutputFile>(stdout);
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  PipeOutputFile::PipeOutputFile(std::FILE *stream) :
+    stream(stream),
+    size(0) {}
+
+  // ------------------------------------------------------------------------------------------- //
+
+  PipeOutputFile::~PipeOutputFile() {
+    std::fflush(this->stream);
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  void PipeOutputFile::ReadAt(
+    std::uint64_t start, std::size_t byteCount, std::byte *buffer
+  ) const {
+    (void)start;
+    (void)byteCount;
+    (void)buffer;
+    throw std::runtime_error(u8"Piped output can not be read from");
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  void PipeOutputFile::WriteAt(
+    std::uint64_t start, std::size_t byteCount, const std::byte *buffer
+  ) {
+    if(start != this->size) {
+      throw std::runtime_error(
+        u8"Piped output can only be written sequentially, attempted to seek"
+      );
+    }
+
+    std::size_t writtenByteCount = std::fwrite(buffer, 1, byteCount, this->stream);
+    if(writtenByteCount != byteCount) {
+      throw std::runtime_error(u8"Error writing to piped output, was the pipe closed?");
+    }
+
+    this->size += byteCount;
+    std::fflush(this->stream);
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+} // namespace Nuclex::OpusTranscoder::Audio
@@ -0,0 +1,86 @@
+#pragma region Apache License 2.0
+/*
+Nuclex Opus Transcoder
+Copyright (C) 2024 Markus Ewald / Nuclex Development Labs
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#pragma endregion // Apache License 2.0
+
+#ifndef NUCLEX_OPUSTRANSCODER_AUDIO_PIPEOUTPUTFILE_H
+#define NUCLEX_OPUSTRANSCODER_AUDIO_PIPEOUTPUTFILE_H
+
+#include "../Config.h"
+
+#include <Nuclex/Audio/Storage/VirtualFile.h>
+
+#include <cstdio> // for std::FILE
+#include <cstddef> // for std::byte
+#include <memory> // for std::shared_ptr
+
+namespace Nuclex::OpusTranscoder::Audio {
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Virtual file that passes everything written to it on to a stream</summary>
+  /// <remarks>
+  ///   A pipe can't seek, so the file must be written front to back without gaps.
+  ///   The Ogg Opus writer does that, so its pages reach the stream as they are produced.
+  /// </remarks>
+  class PipeOutputFile : public Nuclex::Audio::Storage::VirtualFile {
+
+    /// <summary>Provides the process' standard output as a virtual file</summary>
+    /// <returns>A new virtual file writing to standard output</returns>
+    public: static std::shared_ptr<PipeOutputFile> OpenStandardOutput();
+
+    /// <summary>Initializes a new virtual file writing to a stream</summary>
+    /// <param name="stream">Stream that will be written to, not closed by the file</param>
+    public: PipeOutputFile(std::FILE *stream);
+
+    /// <summary>Flushes any buffered data into the stream</summary>
+    public: ~PipeOutputFile() override;
+
+    /// <summary>Determines the current size of the file in bytes</summary>
+    /// <returns>The number of bytes written to the stream so far</returns>
+    public: std::uint64_t GetSize() const override { return this->size; }
+
+    /// <summary>Reads data from the file</summary>
+    /// <param name="start">Offset in the file at which to begin reading</param>
+    /// <param name="byteCount">Number of bytes that will be read</param>
+    /// <parma name="buffer">Buffer into which the data will be read</param>
+    /// <remarks>Always throws, the file can only be written</remarks>
+    public: void ReadAt(
+      std::uint64_t start, std::size_t byteCount, std::byte *buffer
+    ) const override;
+
+    /// <summary>Writes data into the file</summary>
+    /// <param name="start">Offset at which writing will begin in the file</param>
+    /// <param name="byteCount">Number of bytes that should be written</param>
+    /// <param name="buffer">Buffer holding the data that should be written</param>
+    /// <remarks>The start offset has to be the current end of the file</remarks>
+    public: void WriteAt(
+      std::uint64_t start, std::size_t byteCount, const std::byte *buffer
+    ) override;
+
+    /// <summary>Stream the data is written to</summary>
+    private: std::FILE *stream;
+    /// <summary>Number of bytes written to the stream so far</summary>
+    private: std::uint64_t size;
+
+  };
+
+  // ------------------------------------------------------------------------------------------- //
+
+} // namespace Nuclex::OpusTranscoder::Audio
+
+#endif // NUCLEX_OPUSTRANSCODER_AUDIO_PIPEOUTPUTFILE_H
@@ -0,0 +1,183 @@
+#pragma region Apache License 2.0
+/*
+Nuclex Opus Transcoder
+Copyright (C) 2024 Markus Ewald / Nuclex Development Labs
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#pragma endregion // Apache License 2.0
+
+// If the application is compiled as a DLL, this ensures symbols are exported
+#define NUCLEX_OPUSTRANSCODER_SOURCE 1
+
+#include "./ProgressTracker.h"
+
+#include <chrono> // for std::chrono::steady_clock
+#include <cstring> // for std::memcpy()
+
+namespace {
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Packs a step number and a progress value into a single word</summary>
+  /// <param name="stepNumber">Step number that will be stored in the upper bits</param>
+  /// <param name="progress">Progress value that will be stored in the lower bits</param>
+  /// <returns>The packed step number and progress value</returns>
+  std::uint64_t pack(std::uint32_t stepNumber, float progress) {
+    std::uint32_t progressBits;
+    std::memcpy(&progressBits, &progress, sizeof(progressBits));
+    return (static_cast<std::uint64_t>(stepNumber) << 32) | progressBits;
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Extracts the step number from a packed word</summary>
+  /// <param name="stepAndProgress">Packed step number and progress value</param>
+  /// <returns>The step number stored in the packed word</returns>
+  std::uint32_t unpackStepNumber(std::uint64_t stepAndProgress) {
+    return static_cast<std::uint32_t>(stepAndProgress >> 32);
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Extracts the progress value from a packed word</summary>
+  /// <param name="stepAndProgress">Packed step number and progress value</param>
+  /// <returns>The progress value stored in the packed word</returns>
+  float unpackProgress(std::uint64_t stepAndProgress) {
+    std::uint32_t progressBits = static_cast<std::uint32_t>(stepAndProgress);
+
+    float progress;
+    std::memcpy(&progress, &progressBits, sizeof(progress));
+    return progress;
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Converts an event rate into the interval between two events</summary>
+  /// <param name="eventsPerSecond">Maximum number of events per second, 0 for no limit</param>
+  /// <returns>The minimum number of steady clock ticks between two events</returns>
+  std::int64_t intervalFromRate(float eventsPerSecond) {
+    if(eventsPerSecond <= 0.0f) {
+      return 0;
+    }
+
+    std::chrono::duration<double> interval(1.0 / static_cast<double>(eventsPerSecond));
+    return std::chrono::duration_cast<std::chrono::steady_clock::duration>(interval).count();
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+} // anonymous namespace
+
+namespace Nuclex::OpusTranscoder::Audio {
+
+  // ------------------------------------------------------------------------------------------- //
+
+  ProgressTracker::ProgressTracker(
+    float maximumEventsPerSecond /* = NUCLEX_OPUSTRANSCODER_PROGRESS_EVENT_RATE */
+  ) :
+    stepAndProgress(pack(0, 0.0f)),
+    minimumEventInterval(intervalFromRate(maximumEventsPerSecond)),
+    nextEventTime(0) {}
+
+  // ------------------------------------------------------------------------------------------- //
+
+  void ProgressTracker::SetMaximumEventRate(float maximumEventsPerSecond) {
+    this->minimumEventInterval.store(
+      intervalFromRate(maximumEventsPerSecond), std::memory_order_relaxed
+    );
+    this->nextEventTime.store(0, std::memory_order_relaxed);
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  std::uint32_t ProgressTracker::BeginStep() {
+    std::uint64_t previous = this->stepAndProgress.fetch_add(
+      std::uint64_t(1) << 32, std::memory_order_release
+    );
+    return unpackStepNumber(previous) + 1;
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  std::uint32_t ProgressTracker::BeginStep(float initialProgress) {
+    std::uint64_t previous = this->stepAndProgress.load(std::memory_order_relaxed);
+    std::uint32_t stepNumber;
+    do {
+      stepNumber = unpackStepNumber(previous) + 1;
+    } while(
+      !this->stepAndProgress.compare_exchange_weak(
+        previous, pack(stepNumber, initialProgress),
+        std::memory_order_release, std::memory_order_relaxed
+      )
+    );
+
+    return stepNumber;
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  bool ProgressTracker::Report(float progress) {
+
+    // Replace only the progress bits, so a report racing with the next step beginning
+    // can't undo the step change. Workers of one step are done before the next one
+    // begins, so a report never carries over into the wrong step.
+    std::uint64_t previous = this->stepAndProgress.load(std::memory_order_relaxed);
+    while(
+      !this->stepAndProgress.compare_exchange_weak(
+        previous, pack(unpackStepNumber(previous), progress),
+        std::memory_order_release, std::memory_order_relaxed
+      )
+    ) {}
+
+    std::int64_t interval = this->minimumEventInterval.load(std::memory_order_relaxed);
+    if(interval == 0) {
+      return true;
+    }
+
+    // Whichever thread moves the deadline forward gets to send the event, all
+    // others reporting in the same interval see the new deadline and stay quiet
+    std::int64_t now = std::chrono::steady_clock::now().time_since_epoch().count();
+    std::int64_t nextEvent = this->nextEventTime.load(std::memory_order_relaxed);
+    if(now < nextEvent) {
+      return false;
+    }
+
+    return this->nextEventTime.compare_exchange_strong(
+      nextEvent, now + interval, std::memory_order_relaxed
+    );
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  std::uint32_t ProgressTracker::GetStepNumber() const {
+    return unpackStepNumber(this->stepAndProgress.load(std::memory_order_acquire));
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  float ProgressTracker::GetProgress() const {
+    return unpackProgress(this->stepAndProgress.load(std::memory_order_acquire));
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  void ProgressTracker::GetStepAndProgress(std::uint32_t &stepNumber, float &progress) const {
+    std::uint64_t current = this->stepAndProgress.load(std::memory_order_acquire);
+    stepNumber = unpackStepNumber(current);
+    progress = unpackProgress(current);
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+} // namespace Nuclex::OpusTranscoder::Audio
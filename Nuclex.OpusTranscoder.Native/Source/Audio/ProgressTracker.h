@@ -0,0 +1,108 @@
+#pragma region Apache License 2.0
+/*
+Nuclex Opus Transcoder
+Copyright (C) 2024 Markus Ewald / Nuclex Development Labs
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#pragma endregion // Apache License 2.0
+
+#ifndef NUCLEX_OPUSTRANSCODER_AUDIO_PROGRESSTRACKER_H
+#define NUCLEX_OPUSTRANSCODER_AUDIO_PROGRESSTRACKER_H
+
+#include "../Config.h"
+
+#include <atomic> // for std::atomic
+#include <cstdint> // for std::uint64_t
+
+namespace Nuclex::OpusTranscoder::Audio {
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Tracks the progress of a job's current step without taking any locks</summary>
+  /// <remarks>
+  ///   <para>
+  ///     The number of the current step and its progress are packed into a single atomic
+  ///     word, so a reader always sees a progress value together with the step it belongs
+  ///     to. Any number of threads can report progress at the same time, they only
+  ///     ever contend on that word's cache line.
+  ///   </para>
+  ///   <para>
+  ///     Progress is reported far more often than anyone could look at it. Reporting
+  ///     tells the caller whether an event should be sent out, which is the case at most
+  ///     as often as the maximum event rate allows. Exactly one of the threads reporting
+  ///     within the same interval gets to send the event.
+  ///   </para>
+  /// </remarks>
+  class ProgressTracker {
+
+    /// <summary>Initializes a new progress tracker</summary>
+    /// <param name="maximumEventsPerSecond">
+    ///   Maximum number of progress events per second, 0 for no limit
+    /// </param>
+    public: ProgressTracker(
+      float maximumEventsPerSecond = NUCLEX_OPUSTRANSCODER_PROGRESS_EVENT_RATE
+    );
+
+    /// <summary>Changes how many progress events may be sent out per second</summary>
+    /// <param name="maximumEventsPerSecond">
+    ///   Maximum number of progress events per second, 0 for no limit
+    /// </param>
+    public: void SetMaximumEventRate(float maximumEventsPerSecond);
+
+    /// <summary>Moves on to the next step, keeping the current progress</summary>
+    /// <returns>The number of the step that has begun</returns>
+    public: std::uint32_t BeginStep();
+
+    /// <summary>Moves on to the next step and sets its initial progress</summary>
+    /// <param name="initialProgress">Progress the new step starts out with</param>
+    /// <returns>The number of the step that has begun</returns>
+    public: std::uint32_t BeginStep(float initialProgress);
+
+    /// <summary>Updates the progress of the current step</summary>
+    /// <param name="progress">New progress of the current step</param>
+    /// <returns>True if the caller should send out a progress event</returns>
+    /// <remarks>
+    ///   Can be called from any number of threads at the same time. If the last report
+    ///   of a step isn't announced because of the rate limit, the next step beginning
+    ///   or the job ending will bring the reader up to date anyway.
+    /// </remarks>
+    public: bool Report(float progress);
+
+    /// <summary>Looks up the number of the current step</summary>
+    /// <returns>The current step's number, which increases with each step</returns>
+    public: std::uint32_t GetStepNumber() const;
+
+    /// <summary>Looks up the progress of the current step</summary>
+    /// <returns>The progress most recently reported for the current step</returns>
+    public: float GetProgress() const;
+
+    /// <summary>Looks up the current step's number and progress at the same time</summary>
+    /// <param name="stepNumber">Receives the number of the current step</param>
+    /// <param name="progress">Receives the progress of the current step</param>
+    public: void GetStepAndProgress(std::uint32_t &stepNumber, float &progress) const;
+
+    /// <summary>Step number in the upper and progress bits in the lower 32 bits</summary>
+    private: std::atomic<std::uint64_t> stepAndProgress;
+    /// <summary>Minimum time between two progress events in steady clock ticks</summary>
+    private: std::atomic<std::int64_t> minimumEventInterval;
+    /// <summary>Time in steady clock ticks after which the next event may be sent</summary>
+    private: std::atomic<std::int64_t> nextEventTime;
+
+  };
+
+  // ------------------------------------------------------------------------------------------- //
+
+} // namespace Nuclex::OpusTranscoder::Audio
+
+#endif // NUCLEX_OPUSTRANSCODER_AUDIO_PROGRESSTRACKER_H
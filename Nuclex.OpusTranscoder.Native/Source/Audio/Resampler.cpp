@@ -0,0 +1,513 @@
+#pragma region Apache License 2.0
+/*
+Nuclex Opus Transcoder
+Copyright (C) 2024 Markus Ewald / Nuclex Development Labs
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#pragma endregion // Apache License 2.0
+
+// If the application is compiled as a DLL, this ensures symbols are exported
+#define NUCLEX_OPUSTRANSCODER_SOURCE 1
+
+#include "./Resampler.h"
+#include "./WorkPartitioner.h"
+
+#include <Nuclex/Support/Threading/ThreadPool.h>
+
+#include <cassert> // for assert()
+#include <algorithm> // for std::min()
+#include <atomic> // for std::atomic
+#include <cmath> // for std::sin(), std::sqrt()
+#include <future> // for std::future
+#include <functional> // for std::ref(), std::cref()
+#include <numeric> // for std::gcd()
+#include <stdexcept> // for std::runtime_error
+#include <vector> // for std::vector
+
+#if defined(NUCLEX_OPUSTRANSCODER_HAVE_AVX2)
+  #include <immintrin.h> // for AVX2 intrinsics
+#elif defined(NUCLEX_OPUSTRANSCODER_HAVE_SSE2)
+  #include <emmintrin.h> // for SSE2 intrinsics
+#elif defined(NUCLEX_OPUSTRANSCODER_HAVE_NEON)
+  #include <arm_neon.h> // for NEON intrinsics
+#endif
+
+namespace {
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Number of taps in each phase of the filter when upsampling</summary>
+  /// <remarks>
+  ///   When downsampling, this is multiplied by the decimation ratio, so the filter
+  ///   keeps the same transition width relative to the output's Nyquist frequency.
+  ///   Must be a multiple of 16 so the vectorized dot product has no leftovers.
+  /// </remarks>
+  const std::size_t BaseTapCount = 96;
+
+  /// <summary>Cutoff frequency of the low-pass relative to the lower Nyquist frequency</summary>
+  /// <remarks>
+  ///   With 96 taps, the passband is flat up to about 88% of the Nyquist frequency
+  ///   (19.4 kHz for 44.1 kHz audio) and the stopband begins right at it.
+  /// </remarks>
+  const double CutoffFraction = 0.94;
+
+  /// <summary>Shape parameter of the Kaiser window</summary>
+  /// <remarks>Gives roughly 90 dB of stopband attenuation</remarks>
+  const double KaiserBeta = 8.96;
+
+  /// <summary>Most phases the filter table may have</summary>
+  /// <remarks>
+  ///   The number of phases is the upsampling factor after reducing the ratio of
+  ///   the sample rates. All common sample rates stay well below this, for example
+  ///   44.1 kHz to 48 kHz needs 160 phases.
+  /// </remarks>
+  const std::size_t MaximumPhaseCount = 4096;
+
+  /// <summary>Number of frames after which progress is reported and cancellation checked</summary>
+  const std::size_t ProgressReportFrameCount = 0x3000;
+
+  /// <summary>Value of pi in double precision</summary>
+  const double Pi = 3.14159265358979323846;
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Taps of a polyphase low-pass filter for one pair of sample rates</summary>
+  struct PolyphaseFilter {
+
+    /// <summary>Factor by which the sample rate is increased before decimating</summary>
+    public: std::size_t PhaseCount;
+    /// <summary>Factor by which the upsampled signal is decimated</summary>
+    public: std::size_t DecimationFactor;
+    /// <summary>Number of taps in each of the phases</summary>
+    public: std::size_t TapCount;
+    /// <summary>Taps of all phases, one phase after another</summary>
+    public: std::vector<float> Coefficients;
+
+  };
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Calculates the zeroth order modified Bessel function of the first kind</summary>
+  /// <param name="x">Value the function will be calculated for</param>
+  /// <returns>The value of the function at the specified point</returns>
+  double besselI0(double x) {
+    double sum = 1.0;
+    double term = 1.0;
+    double halfX = x / 2.0;
+    for(std::size_t k = 1; k < 64; ++k) {
+      term *= (halfX / static_cast<double>(k));
+      double squaredTerm = term * term;
+      sum += squaredTerm;
+      if(squaredTerm < sum * 1e-16) {
+        break;
+      }
+    }
+
+    return sum;
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Designs the polyphase filter to convert between two sample rates</summary>
+  /// <param name="sourceSampleRate">Sample rate of the input samples</param>
+  /// <param name="targetSampleRate">Sample rate the output samples should have</param>
+  /// <returns>The filter that converts between the two sample rates</returns>
+  PolyphaseFilter designFilter(std::size_t sourceSampleRate, std::size_t targetSampleRate) {
+    std::size_t divisor = std::gcd(sourceSampleRate, targetSampleRate);
+
+    PolyphaseFilter filter;
+    filter.PhaseCount = targetSampleRate / divisor;
+    filter.DecimationFactor = sourceSampleRate / divisor;
+
+    // When downsampling, the cutoff moves down to the output's Nyquist frequency,
+    // so the sinc gets wider by the same factor and needs that many more taps
+    double cutoff = CutoffFraction;
+    filter.TapCount = BaseTapCount;
+    if(filter.PhaseCount < filter.DecimationFactor) {
+      cutoff *= (
+        static_cast<double>(filter.PhaseCount) / static_cast<double>(filter.DecimationFactor)
+      );
+      filter.TapCount *= (
+        (filter.DecimationFactor + filter.PhaseCount - 1) / filter.PhaseCount
+      );
+    }
+
+    // Phase p is used for output samples that fall p / PhaseCount samples past an input
+    // sample. Tap k is multiplied with the input sample (TapCount / 2 - 1 - k) before it.
+    double halfLength = static_cast<double>(filter.TapCount / 2);
+    double windowScale = 1.0 / besselI0(KaiserBeta);
+    filter.Coefficients.resize(filter.PhaseCount * filter.TapCount);
+    for(std::size_t phase = 0; phase < filter.PhaseCount; ++phase) {
+      float *taps = filter.Coefficients.data() + (phase * filter.TapCount);
+      double fraction = static_cast<double>(phase) / static_cast<double>(filter.PhaseCount);
+
+      double sum = 0.0;
+      std::vector<double> values(filter.TapCount);
+      for(std::size_t k = 0; k < filter.TapCount; ++k) {
+        double distance = (halfLength - 1.0 - static_cast<double>(k)) + fraction;
+
+        double sinc = cutoff;
+        if(distance != 0.0) {
+          sinc = std::sin(Pi * cutoff * distance) / (Pi * distance);
+        }
+
+        double window = 0.0;
+        double relativeDistance = distance / halfLength;
+        if(relativeDistance * relativeDistance < 1.0) {
+          window = besselI0(
+            KaiserBeta * std::sqrt(1.0 - relativeDistance * relativeDistance)
+          ) * windowScale;
+        }
+
+        values[k] = sinc * window;
+        sum += values[k];
+      }
+
+      // Each phase is scaled to a gain of exactly one, otherwise the small differences
+      // between the phases would modulate the signal at the phase rate
+      for(std::size_t k = 0; k < filter.TapCount; ++k) {
+        taps[k] = static_cast<float>(values[k] / sum);
+      }
+    }
+
+    return filter;
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Calculates the dot product of filter taps and samples</summary>
+  /// <param name="taps">Filter taps the samples will be multiplied with</param>
+  /// <param name="samples">Samples that will be multiplied with the taps</param>
+  /// <param name="count">Number of taps and samples, must be a multiple of 16</param>
+  /// <returns>The sum of all taps multiplied with their samples</returns>
+  float dotProduct(const float *taps, const float *samples, std::size_t count) {
+    assert(((count % 16) == 0) && u8"Tap count is a multiple of 16");
+
+#if defined(NUCLEX_OPUSTRANSCODER_HAVE_AVX2)
+    __m256 first = _mm256_setzero_ps();
+    __m256 second = _mm256_setzero_ps();
+    for(std::size_t index = 0; index < count; index += 16) {
+      first = _mm256_add_ps(
+        first, _mm256_mul_ps(_mm256_loadu_ps(taps + index), _mm256_loadu_ps(samples + index))
+      );
+      second = _mm256_add_ps(
+        second,
+        _mm256_mul_ps(_mm256_loadu_ps(taps + index + 8), _mm256_loadu_ps(samples + index + 8))
+      );
+    }
+    __m256 sum256 = _mm256_add_ps(first, second);
+    __m128 sum = _mm_add_ps(_mm256_castps256_ps128(sum256), _mm256_extractf128_ps(sum256, 1));
+    sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+    sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 0x55));
+    return _mm_cvtss_f32(sum);
+#elif defined(NUCLEX_OPUSTRANSCODER_HAVE_SSE2)
+    __m128 first = _mm_setzero_ps();
+    __m128 second = _mm_setzero_ps();
+    for(std::size_t index = 0; index < count; index += 8) {
+      first = _mm_add_ps(
+        first, _mm_mul_ps(_mm_loadu_ps(taps + index), _mm_loadu_ps(samples + index))
+      );
+      second = _mm_add_ps(
+        second, _mm_mul_ps(_mm_loadu_ps(taps + index + 4), _mm_loadu_ps(samples + index + 4))
+      );
+    }
+    __m128 sum = _mm_add_ps(first, second);
+    sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+    sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 0x55));
+    return _mm_cvtss_f32(sum);
+#elif defined(NUCLEX_OPUSTRANSCODER_HAVE_NEON)
+    float32x4_t first = vdupq_n_f32(0.0f);
+    float32x4_t second = vdupq_n_f32(0.0f);
+    for(std::size_t index = 0; index < count; index += 8) {
+      first = vmlaq_f32(first, vld1q_f32(taps + index), vld1q_f32(samples + index));
+      second = vmlaq_f32(second, vld1q_f32(taps + index + 4), vld1q_f32(samples + index + 4));
+    }
+    float32x4_t sum = vaddq_f32(first, second);
+    float32x2_t folded = vadd_f32(vget_low_f32(sum), vget_high_f32(sum));
+    return vget_lane_f32(vpadd_f32(folded, folded), 0);
+#else
+    float sums[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+    for(std::size_t index = 0; index < count; index += 4) {
+      sums[0] += taps[index] * samples[index];
+      sums[1] += taps[index + 1] * samples[index + 1];
+      sums[2] += taps[index + 2] * samples[index + 2];
+      sums[3] += taps[index + 3] * samples[index + 3];
+    }
+    return (sums[0] + sums[1]) + (sums[2] + sums[3]);
+#endif
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Resamples a range of output samples of one channel</summary>
+  /// <param name="filter">Polyphase filter that converts between the sample rates</param>
+  /// <param name="source">Samples of the channel at the source sample rate</param>
+  /// <param name="sourceFrameCount">Number of samples in the source channel</param>
+  /// <param name="target">Receives the samples at the target sample rate</param>
+  /// <param name="startFrameIndex">Index of the first output sample to calculate</param>
+  /// <param name="endFrameIndex">Index one past the last output sample to calculate</param>
+  /// <param name="canceler">Token by which the operation can be signalled to cancel</param>
+  /// <param name="processedFrameCount">Counter that is advanced as samples are done</param>
+  void resampleRange(
+    const PolyphaseFilter &filter,
+    const float *source, std::uint64_t sourceFrameCount,
+    float *target, std::uint64_t startFrameIndex, std::uint64_t endFrameIndex,
+    const std::shared_ptr<const Nuclex::Support::Threading::StopToken> &canceler,
+    std::atomic<std::uint64_t> &processedFrameCount
+  ) {
+    std::size_t tapCount = filter.TapCount;
+    std::int64_t leadingTapCount = static_cast<std::int64_t>(tapCount / 2) - 1;
+    std::int64_t lastFullStart = (
+      static_cast<std::int64_t>(sourceFrameCount) - static_cast<std::int64_t>(tapCount)
+    );
+
+    // Position of the first output sample in input samples, as whole samples plus
+    // a phase. From there on, each output sample advances both by the same step.
+    std::uint64_t position = startFrameIndex * filter.DecimationFactor;
+    std::uint64_t sourceIndex = position / filter.PhaseCount;
+    std::size_t phase = static_cast<std::size_t>(position % filter.PhaseCount);
+    std::uint64_t sourceStep = filter.DecimationFactor / filter.PhaseCount;
+    std::size_t phaseStep = filter.DecimationFactor % filter.PhaseCount;
+
+    std::uint64_t reportedFrameIndex = startFrameIndex;
+    for(std::uint64_t frameIndex = startFrameIndex; frameIndex < endFrameIndex; ++frameIndex) {
+      const float *taps = filter.Coefficients.data() + (phase * tapCount);
+      std::int64_t firstIndex = static_cast<std::int64_t>(sourceIndex) - leadingTapCount;
+
+      // Near the start and end of the track, the filter reaches beyond the samples.
+      // The samples outside are taken as silence.
+      if((0 <= firstIndex) && (firstIndex <= lastFullStart)) {
+        target[frameIndex] = dotProduct(taps, source + firstIndex, tapCount);
+      } else {
+        float sum = 0.0f;
+        for(std::size_t k = 0; k < tapCount; ++k) {
+          std::int64_t index = firstIndex + static_cast<std::int64_t>(k);
+          if((0 <= index) && (index < static_cast<std::int64_t>(sourceFrameCount))) {
+            sum += taps[k] * source[index];
+          }
+        }
+        target[frameIndex] = sum;
+      }
+
+      sourceIndex += sourceStep;
+      phase += phaseStep;
+      if(phase >= filter.PhaseCount) {
+        phase -= filter.PhaseCount;
+        ++sourceIndex;
+      }
+
+      if((frameIndex - reportedFrameIndex) >= ProgressReportFrameCount) {
+        processedFrameCount.fetch_add(frameIndex - reportedFrameIndex, std::memory_order_relaxed);
+        reportedFrameIndex = frameIndex;
+        canceler->ThrowIfCanceled();
+      }
+    } // for each output sample
+
+    processedFrameCount.fetch_add(endFrameIndex - reportedFrameIndex, std::memory_order_relaxed);
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Makes sure a track can be resampled and brings it into planar layout</summary>
+  /// <param name="track">Track that will be resampled</param>
+  /// <param name="targetSampleRate">Sample rate the track will be converted to</param>
+  /// <returns>True if the track needs to be resampled, false if it is at that rate</returns>
+  bool prepareForResampling(
+    const std::shared_ptr<Nuclex::OpusTranscoder::Audio::Track> &track,
+    std::size_t targetSampleRate
+  ) {
+    using Nuclex::OpusTranscoder::Audio::Resampler;
+
+    if(track->SampleRate == targetSampleRate) {
+      return false;
+    }
+    if(!Resampler::CanResample(track->SampleRate, targetSampleRate)) {
+      throw std::runtime_error(u8"Resampling between these sample rates is not supported");
+    }
+    if(track->IsCompact()) {
+      throw std::runtime_error(u8"Compacted tracks can not be resampled");
+    }
+#if !defined(NDEBUG)
+    for(std::size_t index = 0; index < track->Channels.size(); ++index) {
+      assert(
+        track->Channels[index].ClippingHalfwaves.empty() &&
+        u8"Tracks are resampled before looking for clipping half-waves"
+      );
+    }
+#endif
+
+    // Each output sample reads a run of consecutive input samples, which is only
+    // contiguous in memory if the channels are planar
+    track->ConvertToPlanar();
+    track->AdviseAccessPattern(Nuclex::OpusTranscoder::Audio::SampleAccessPattern::Sequential);
+
+    return true;
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+} // anonymous namespace
+
+namespace Nuclex::OpusTranscoder::Audio {
+
+  // ------------------------------------------------------------------------------------------- //
+
+  const std::size_t Resampler::OpusSampleRate = 48000;
+
+  // ------------------------------------------------------------------------------------------- //
+
+  bool Resampler::CanResample(std::size_t sourceSampleRate, std::size_t targetSampleRate) {
+    if((sourceSampleRate == 0) || (targetSampleRate == 0)) {
+      return false;
+    }
+
+    std::size_t divisor = std::gcd(sourceSampleRate, targetSampleRate);
+    return ((targetSampleRate / divisor) <= MaximumPhaseCount);
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  std::uint64_t Resampler::CountResampledFrames(
+    std::uint64_t frameCount, std::size_t sourceSampleRate, std::size_t targetSampleRate
+  ) {
+    std::size_t divisor = std::gcd(sourceSampleRate, targetSampleRate);
+    std::uint64_t phaseCount = targetSampleRate / divisor;
+    std::uint64_t decimationFactor = sourceSampleRate / divisor;
+
+    return (frameCount * phaseCount + decimationFactor - 1) / decimationFactor;
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  void Resampler::Resample(
+    const std::shared_ptr<Track> &track,
+    std::size_t targetSampleRate,
+    const std::shared_ptr<const Nuclex::Support::Threading::StopToken> &canceler,
+    Nuclex::Support::Events::Delegate<void(float)> &progressCallback
+  ) {
+    if(!prepareForResampling(track, targetSampleRate)) {
+      return;
+    }
+
+    PolyphaseFilter filter = designFilter(track->SampleRate, targetSampleRate);
+
+    std::size_t channelCount = track->Channels.size();
+    std::uint64_t sourceFrameCount = track->CountFrames();
+    std::uint64_t targetFrameCount = CountResampledFrames(
+      sourceFrameCount, track->SampleRate, targetSampleRate
+    );
+    std::uint64_t totalFrameCount = targetFrameCount * channelCount;
+
+    std::atomic<std::uint64_t> processedFrameCount(0);
+    for(std::size_t channelIndex = 0; channelIndex < channelCount; ++channelIndex) {
+      SampleBuffer resampled;
+      resampled.resize(static_cast<std::size_t>(targetFrameCount));
+
+      const float *source = track->Channels[channelIndex].Samples.data();
+      for(std::uint64_t frameIndex = 0; frameIndex < targetFrameCount;) {
+        std::uint64_t endFrameIndex = std::min<std::uint64_t>(
+          frameIndex + ProgressReportFrameCount * 4, targetFrameCount
+        );
+        resampleRange(
+          filter, source, sourceFrameCount,
+          resampled.data(), frameIndex, endFrameIndex,
+          canceler, processedFrameCount
+        );
+        frameIndex = endFrameIndex;
+
+        progressCallback(
+          static_cast<float>(processedFrameCount.load(std::memory_order_relaxed)) /
+          static_cast<float>(totalFrameCount)
+        );
+      }
+
+      resampled.swap(track->Channels[channelIndex].Samples);
+    }
+
+    track->SampleRate = targetSampleRate;
+    track->Statistics.Clear();
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  void Resampler::Resample(
+    const std::shared_ptr<Track> &track,
+    std::size_t targetSampleRate,
+    Nuclex::Support::Threading::ThreadPool &threadPool,
+    const std::shared_ptr<const Nuclex::Support::Threading::StopToken> &canceler,
+    Nuclex::Support::Events::Delegate<void(float)> &progressCallback
+  ) {
+    if(!prepareForResampling(track, targetSampleRate)) {
+      return;
+    }
+
+    PolyphaseFilter filter = designFilter(track->SampleRate, targetSampleRate);
+
+    std::size_t channelCount = track->Channels.size();
+    std::uint64_t sourceFrameCount = track->CountFrames();
+    std::uint64_t targetFrameCount = CountResampledFrames(
+      sourceFrameCount, track->SampleRate, targetSampleRate
+    );
+    std::uint64_t totalFrameCount = targetFrameCount * channelCount;
+
+    // Every output sample only depends on the input, so the ranges need no overlap
+    // and produce exactly the same samples as resampling the channel in one go
+    std::vector<std::size_t> boundaries = WorkPartitioner::SplitFrameRange(
+      static_cast<std::size_t>(targetFrameCount)
+    );
+    std::size_t rangeCount = boundaries.size() - 1;
+
+    std::atomic<std::uint64_t> processedFrameCount(0);
+    for(std::size_t channelIndex = 0; channelIndex < channelCount; ++channelIndex) {
+      SampleBuffer resampled;
+      resampled.resize(static_cast<std::size_t>(targetFrameCount));
+
+      const float *source = track->Channels[channelIndex].Samples.data();
+
+      std::vector<std::future<void>> futures;
+      futures.reserve(rangeCount);
+      try {
+        for(std::size_t rangeIndex = 0; rangeIndex < rangeCount; ++rangeIndex) {
+          futures.push_back(
+            threadPool.Schedule(
+              &resampleRange,
+              std::cref(filter), source, sourceFrameCount,
+              resampled.data(), boundaries[rangeIndex], boundaries[rangeIndex + 1],
+              canceler, std::ref(processedFrameCount)
+            )
+          );
+        }
+      }
+      catch(const std::exception &) {
+        WorkPartitioner::WaitForAll(futures); // they reference our filter and buffers
+        throw;
+      }
+
+      WorkPartitioner::WaitForAll(
+        futures, processedFrameCount, totalFrameCount, progressCallback
+      );
+      for(std::size_t rangeIndex = 0; rangeIndex < rangeCount; ++rangeIndex) {
+        futures[rangeIndex].get(); // rethrows any exception, including cancellation
+      }
+
+      resampled.swap(track->Channels[channelIndex].Samples);
+    }
+
+    track->SampleRate = targetSampleRate;
+    track->Statistics.Clear();
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+} // namespace Nuclex::OpusTranscoder::Audio
@@ -0,0 +1,129 @@
+#pragma region Apache License 2.0
+/*
+Nuclex Opus Transcoder
+Copyright (C) 2024 Markus Ewald / Nuclex Development Labs
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#pragma endregion // Apache License 2.0
+
+#ifndef NUCLEX_OPUSTRANSCODER_AUDIO_RESAMPLER_H
+#define NUCLEX_OPUSTRANSCODER_AUDIO_RESAMPLER_H
+
+#include "../Config.h"
+#include "./Track.h"
+
+#include <Nuclex/Support/Threading/StopToken.h>
+#include <Nuclex/Support/Events/Delegate.h>
+
+#include <memory> // for std::shared_ptr
+#include <cstdint> // for std::uint64_t
+
+namespace Nuclex::Support::Threading {
+
+  // ------------------------------------------------------------------------------------------- //
+
+  class ThreadPool;
+
+  // ------------------------------------------------------------------------------------------- //
+
+} // namespace Nuclex::Support::Threading
+
+namespace Nuclex::OpusTranscoder::Audio {
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Converts audio tracks to another sample rate</summary>
+  /// <remarks>
+  ///   <para>
+  ///     Opus always works at 48 kHz internally. Tracks at any other sample rate are
+  ///     resampled by the Opus encoder each time they are encoded, one packet after another
+  ///     on the encoding thread. Resampling the track up front means this happens only once,
+  ///     in parallel, and that the clipping detection looks at the samples that are
+  ///     actually encoded rather than at the ones before resampling.
+  ///   </para>
+  ///   <para>
+  ///     The resampler is a polyphase FIR filter: a Kaiser-windowed sinc low-pass
+  ///     at the lower of both Nyquist frequencies, split into one set of taps for each
+  ///     fractional position an output sample can fall on. Each output sample is the dot
+  ///     product of one such set with the input samples around its position, which
+  ///     the vector units can work through in large strides.
+  ///   </para>
+  /// </remarks>
+  class Resampler {
+
+    /// <summary>Sample rate the Opus codec works at</summary>
+    public: static const std::size_t OpusSampleRate;
+
+    /// <summary>Checks whether the resampler can convert between two sample rates</summary>
+    /// <param name="sourceSampleRate">Sample rate the track currently has</param>
+    /// <param name="targetSampleRate">Sample rate the track should be converted to</param>
+    /// <returns>True if the resampler can convert between the two sample rates</returns>
+    /// <remarks>
+    ///   Sample rates whose ratio can only be expressed with very large numbers, such as
+    ///   47999 Hz to 48000 Hz, would need an impractically large filter table. Those are
+    ///   left to the encoder.
+    /// </remarks>
+    public: static bool CanResample(std::size_t sourceSampleRate, std::size_t targetSampleRate);
+
+    /// <summary>Calculates the length of a track after it has been resampled</summary>
+    /// <param name="frameCount">Number of frames at the source sample rate</param>
+    /// <param name="sourceSampleRate">Sample rate the track currently has</param>
+    /// <param name="targetSampleRate">Sample rate the track will be converted to</param>
+    /// <returns>The number of frames the track will have after resampling</returns>
+    public: static std::uint64_t CountResampledFrames(
+      std::uint64_t frameCount, std::size_t sourceSampleRate, std::size_t targetSampleRate
+    );
+
+    /// <summary>Converts an audio track to another sample rate</summary>
+    /// <param name="track">Audio track that will be resampled</param>
+    /// <param name="targetSampleRate">Sample rate the track will be converted to</param>
+    /// <param name="canceler">Token by which the operation can be signalled to cancel</param>
+    /// <param name="progressCallback">Callback to which progress reports should be sent</param>
+    /// <remarks>
+    ///   The track ends up planar. Its channels are resampled one after another, so only
+    ///   one resampled channel exists next to the original samples at any time. This has
+    ///   to happen before any clipping half-waves are found, their positions would not
+    ///   match the resampled track.
+    /// </remarks>
+    public: static void Resample(
+      const std::shared_ptr<Track> &track,
+      std::size_t targetSampleRate,
+      const std::shared_ptr<const Nuclex::Support::Threading::StopToken> &canceler,
+      Nuclex::Support::Events::Delegate<void(float)> &progressCallback
+    );
+
+    /// <summary>
+    ///   Converts an audio track to another sample rate, splitting each channel into
+    ///   ranges that are resampled by the threads of a thread pool
+    /// </summary>
+    /// <param name="track">Audio track that will be resampled</param>
+    /// <param name="targetSampleRate">Sample rate the track will be converted to</param>
+    /// <param name="threadPool">Thread pool on which the ranges will be resampled</param>
+    /// <param name="canceler">Token by which the operation can be signalled to cancel</param>
+    /// <param name="progressCallback">Callback to which progress reports should be sent</param>
+    public: static void Resample(
+      const std::shared_ptr<Track> &track,
+      std::size_t targetSampleRate,
+      Nuclex::Support::Threading::ThreadPool &threadPool,
+      const std::shared_ptr<const Nuclex::Support::Threading::StopToken> &canceler,
+      Nuclex::Support::Events::Delegate<void(float)> &progressCallback
+    );
+
+  };
+
+  // ------------------------------------------------------------------------------------------- //
+
+} // namespace Nuclex::OpusTranscoder::Audio
+
+#endif // NUCLEX_OPUSTRANSCODER_AUDIO_RESAMPLER_H
@@ -0,0 +1,525 @@
+#pragma region Apache License 2.0
+/*
+Nuclex Opus Transcoder
+Copyright (C) 2024 Markus Ewald / Nuclex Development Labs
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#pragma endregion // Apache License 2.0
+
+// If the application is compiled as a DLL, this ensures symbols are exported
+#define NUCLEX_OPUSTRANSCODER_SOURCE 1
+
+#include "./SampleBuffer.h"
+
+#include <atomic> // for std::atomic
+#include <new> // for std::bad_alloc
+#include <mutex> // for std::mutex
+#include <unordered_map> // for std::unordered_map
+#include <algorithm> // for std::max()
+#include <cstdint> // for std::uintptr_t
+
+#if defined(NUCLEX_OPUSTRANSCODER_WINDOWS)
+#include <Nuclex/Support/Text/StringConverter.h> // for StringConverter::WideFromUtf8()
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h> // for ::CreateFileW(), ::CreateFileMappingW(), ::MapViewOfFile()
+#include <malloc.h> // for ::_aligned_malloc(), ::_aligned_free()
+#else
+#include <cstdlib> // for ::posix_memalign(), ::free(), ::mkstemp(), ::getenv()
+#include <sys/mman.h> // for ::madvise(), ::mmap(), ::munmap()
+#include <unistd.h> // for ::ftruncate(), ::unlink(), ::close(), ::sysconf()
+#endif
+
+namespace {
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Whether large allocations should ask for huge pages</summary>
+  std::atomic<bool> hugePagesEnabled(true);
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Size from which allocations are placed in scratch files, 0 for never</summary>
+  std::atomic<std::size_t> scratchThreshold(NUCLEX_OPUSTRANSCODER_SCRATCH_THRESHOLD);
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Number of allocations currently living in scratch files</summary>
+  /// <remarks>
+  ///   Lets <see cref="SampleMemory::Free" /> skip the lookup of scratch mappings
+  ///   when there are none, which is the usual case.
+  /// </remarks>
+  std::atomic<std::size_t> scratchMappingCount(0);
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Number of bytes in all live sample allocations</summary>
+  std::atomic<std::size_t> allocatedByteCount(0);
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Number of peak measurements currently running</summary>
+  /// <remarks>
+  ///   Lets allocations skip updating the peaks when nobody is measuring them,
+  ///   which is the usual case outside of transcodes.
+  /// </remarks>
+  std::atomic<std::size_t> peakMeasurementCount(0);
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Peaks recorded by the running measurements of sample memory</summary>
+  struct PeakState {
+
+    /// <summary>Must be held while accessing the other fields</summary>
+    public: std::mutex Mutex;
+    /// <summary>Identifier the next measurement that is begun will receive</summary>
+    public: std::size_t NextMeasurement = 1;
+    /// <summary>Highest number of allocated bytes seen by each running measurement</summary>
+    public: std::unordered_map<std::size_t, std::size_t> Peaks;
+
+  };
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Provides the peak state, constructing it on first use</summary>
+  /// <returns>The peak state shared by all sample allocations</returns>
+  PeakState &getPeakState() {
+    static PeakState state;
+    return state;
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Accounts for a new sample allocation</summary>
+  /// <param name="byteCount">Number of bytes that have been allocated</param>
+  void recordAllocation(std::size_t byteCount) {
+    std::size_t totalByteCount = (
+      allocatedByteCount.fetch_add(byteCount, std::memory_order_relaxed) + byteCount
+    );
+    if(peakMeasurementCount.load(std::memory_order_acquire) == 0) {
+      return;
+    }
+
+    // Sample buffers are few and large, so taking a lock here costs next to nothing
+    // compared to the work that will be done on the samples
+    PeakState &state = getPeakState();
+    std::lock_guard<std::mutex> stateScope(state.Mutex);
+    for(std::pair<const std::size_t, std::size_t> &peak : state.Peaks) {
+      peak.second = std::max(peak.second, totalByteCount);
+    }
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Shared state for the allocations placed in scratch files</summary>
+  struct ScratchState {
+
+    /// <summary>Must be held while accessing the other fields</summary>
+    public: std::mutex Mutex;
+    /// <summary>Directory scratch files are created in, empty for the temp directory</summary>
+    public: std::string Directory = NUCLEX_OPUSTRANSCODER_SCRATCH_DIRECTORY;
+    /// <summary>Size of each scratch mapping by its address</summary>
+    public: std::unordered_map<const void *, std::size_t> Mappings;
+
+  };
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Provides the scratch state, constructing it on first use</summary>
+  /// <returns>The scratch state shared by all sample allocations</returns>
+  /// <remarks>
+  ///   Sample buffers can be allocated during static initialization, so this avoids
+  ///   depending on the initialization order of globals in different files.
+  /// </remarks>
+  ScratchState &getScratchState() {
+    static ScratchState state;
+    return state;
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+#if defined(NUCLEX_OPUSTRANSCODER_WINDOWS)
+  /// <summary>Maps a new, already deleted scratch file into memory</summary>
+  /// <param name="directory">Directory the scratch file will be created in</param>
+  /// <param name="byteCount">Size of the scratch file in bytes</param>
+  /// <returns>The address of the mapped file or a null pointer if it failed</returns>
+  void *mapScratchFile(const std::string &directory, std::size_t byteCount) {
+    std::wstring directoryPath;
+    if(directory.empty()) {
+      directoryPath.resize(MAX_PATH + 1);
+      DWORD length = ::GetTempPathW(static_cast<DWORD>(directoryPath.size()), &directoryPath[0]);
+      if((length == 0) || (length > MAX_PATH)) {
+        return nullptr;
+      }
+      directoryPath.resize(length);
+    } else {
+      directoryPath = Nuclex::Support::Text::StringConverter::WideFromUtf8(directory);
+    }
+
+    std::wstring path(MAX_PATH + 1, L'\0');
+    if(::GetTempFileNameW(directoryPath.c_str(), L"nop", 0, &path[0]) == 0) {
+      return nullptr;
+    }
+
+    // The file is marked for deletion up front. Windows keeps the data around
+    // until the view is unmapped, which also happens when the process dies.
+    HANDLE fileHandle = ::CreateFileW(
+      path.c_str(), GENERIC_READ | GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS,
+      FILE_ATTRIBUTE_TEMPORARY | FILE_FLAG_DELETE_ON_CLOSE, nullptr
+    );
+    if(fileHandle == INVALID_HANDLE_VALUE) {
+      ::DeleteFileW(path.c_str());
+      return nullptr;
+    }
+
+    std::uint64_t fileSize = byteCount;
+    HANDLE mappingHandle = ::CreateFileMappingW(
+      fileHandle, nullptr, PAGE_READWRITE,
+      static_cast<DWORD>(fileSize >> 32), static_cast<DWORD>(fileSize), nullptr
+    );
+    ::CloseHandle(fileHandle);
+    if(mappingHandle == nullptr) {
+      return nullptr;
+    }
+
+    void *memory = ::MapViewOfFile(mappingHandle, FILE_MAP_ALL_ACCESS, 0, 0, byteCount);
+    ::CloseHandle(mappingHandle); // the view keeps the mapping alive
+    return memory;
+  }
+#else
+  /// <summary>Maps a new, already deleted scratch file into memory</summary>
+  /// <param name="directory">Directory the scratch file will be created in</param>
+  /// <param name="byteCount">Size of the scratch file in bytes</param>
+  /// <returns>The address of the mapped file or a null pointer if it failed</returns>
+  void *mapScratchFile(const std::string &directory, std::size_t byteCount) {
+    std::string path = directory;
+    if(path.empty()) {
+      const char *temporaryDirectory = ::getenv(u8"TMPDIR");
+      if((temporaryDirectory != nullptr) && (temporaryDirectory[0] != 0)) {
+        path.assign(temporaryDirectory);
+      } else {
+        path.assign(u8"/tmp", 4);
+      }
+    }
+    if(path.back() != '/') {
+      path.push_back('/');
+    }
+    path.append(u8"nuclex-opustranscoder-XXXXXX");
+
+    int fileDescriptor = ::mkstemp(path.data());
+    if(fileDescriptor == -1) {
+      return nullptr;
+    }
+
+    // Remove the directory entry right away. The file lives on until the mapping
+    // is gone, and the kernel cleans it up even if we crash.
+    ::unlink(path.c_str());
+
+    int result = ::ftruncate(fileDescriptor, static_cast<::off_t>(byteCount));
+    if(result != 0) {
+      ::close(fileDescriptor);
+      return nullptr;
+    }
+
+    void *memory = ::mmap(
+      nullptr, byteCount, PROT_READ | PROT_WRITE, MAP_SHARED, fileDescriptor, 0
+    );
+    ::close(fileDescriptor); // the mapping keeps the file open
+    if(memory == MAP_FAILED) {
+      return nullptr;
+    }
+
+    return memory;
+  }
+#endif
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Tries to place an allocation in a scratch file</summary>
+  /// <param name="byteCount">Number of bytes that will be allocated</param>
+  /// <returns>The address of the allocated memory or a null pointer if it failed</returns>
+  void *allocateInScratchFile(std::size_t byteCount) {
+    ScratchState &state = getScratchState();
+    std::string directory;
+    {
+      std::lock_guard<std::mutex> stateScope(state.Mutex);
+      directory = state.Directory;
+    }
+
+    void *memory = mapScratchFile(directory, byteCount);
+    if(memory == nullptr) {
+      return nullptr;
+    }
+
+    {
+      std::lock_guard<std::mutex> stateScope(state.Mutex);
+      state.Mappings.emplace(memory, byteCount);
+    }
+    scratchMappingCount.fetch_add(1, std::memory_order_release);
+
+    return memory;
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Unmaps an allocation if it had been placed in a scratch file</summary>
+  /// <param name="memory">Address of the memory that may be in a scratch file</param>
+  /// <returns>True if the memory was in a scratch file and has been unmapped</returns>
+  bool freeFromScratchFile(void *memory) noexcept {
+    if(scratchMappingCount.load(std::memory_order_acquire) == 0) {
+      return false;
+    }
+
+    std::size_t byteCount;
+    {
+      ScratchState &state = getScratchState();
+      std::lock_guard<std::mutex> stateScope(state.Mutex);
+
+      std::unordered_map<const void *, std::size_t>::iterator iterator = (
+        state.Mappings.find(memory)
+      );
+      if(iterator == state.Mappings.end()) {
+        return false;
+      }
+
+      byteCount = iterator->second;
+      state.Mappings.erase(iterator);
+    }
+    scratchMappingCount.fetch_sub(1, std::memory_order_release);
+
+#if defined(NUCLEX_OPUSTRANSCODER_WINDOWS)
+    (void)byteCount;
+    ::UnmapViewOfFile(memory);
+#else
+    ::munmap(memory, byteCount);
+#endif
+    return true;
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+} // anonymous namespace
+
+namespace Nuclex::OpusTranscoder::Audio {
+
+  // ------------------------------------------------------------------------------------------- //
+
+  // One cache line on x86 and most ARM chips, and the width of an AVX-512 register
+  const std::size_t SampleMemory::Alignment = 64;
+
+  // ------------------------------------------------------------------------------------------- //
+
+  // That's the size of transparent huge pages on x86-64 and on ARM64 with 4 KiB pages
+  const std::size_t SampleMemory::HugePageSize = 2 * 1024 * 1024;
+
+  // ------------------------------------------------------------------------------------------- //
+
+  void *SampleMemory::Allocate(std::size_t byteCount) {
+    std::size_t requestedByteCount = byteCount; // that's also what Free() is given
+    if(byteCount == 0) {
+      byteCount = Alignment; // some allocators return null for empty allocations
+    }
+
+    // Buffers above the threshold go into a scratch file. If that doesn't work out
+    // (no space left or the directory isn't writable), they end up in memory after all.
+    std::size_t threshold = scratchThreshold.load(std::memory_order_relaxed);
+    if((threshold != 0) && (threshold <= byteCount)) {
+      void *memory = allocateInScratchFile(byteCount);
+      if(memory != nullptr) {
+        recordAllocation(requestedByteCount);
+        return memory;
+      }
+    }
+
+#if defined(NUCLEX_OPUSTRANSCODER_WINDOWS)
+    void *memory = ::_aligned_malloc(byteCount, Alignment);
+    if(memory == nullptr) {
+      throw std::bad_alloc();
+    }
+#else
+    // Transparent huge pages can only be used for memory that starts and ends on
+    // a huge page boundary, so we pad large allocations to full huge pages.
+    bool useHugePages = (
+      (HugePageSize <= byteCount) && hugePagesEnabled.load(std::memory_order_relaxed)
+    );
+    if(useHugePages) {
+      byteCount = (byteCount + HugePageSize - 1) / HugePageSize * HugePageSize;
+    }
+
+    void *memory = nullptr;
+    int result = ::posix_memalign(
+      &memory, useHugePages ? HugePageSize : Alignment, byteCount
+    );
+    if(result != 0) {
+      throw std::bad_alloc();
+    }
+
+    // This is merely a hint. If the kernel has transparent huge pages disabled
+    // or none are available, we simply continue with normal pages.
+#if defined(MADV_HUGEPAGE)
+    if(useHugePages) {
+      ::madvise(memory, byteCount, MADV_HUGEPAGE);
+    }
+#endif
+#endif
+
+    recordAllocation(requestedByteCount);
+    return memory;
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  void SampleMemory::Free(void *memory, std::size_t byteCount) noexcept {
+    allocatedByteCount.fetch_sub(byteCount, std::memory_order_relaxed);
+    if(freeFromScratchFile(memory)) {
+      return;
+    }
+
+#if defined(NUCLEX_OPUSTRANSCODER_WINDOWS)
+    ::_aligned_free(memory);
+#else
+    ::free(memory);
+#endif
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  std::size_t SampleMemory::GetAllocatedByteCount() {
+    return allocatedByteCount.load(std::memory_order_relaxed);
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  std::size_t SampleMemory::BeginPeakMeasurement() {
+    PeakState &state = getPeakState();
+    std::lock_guard<std::mutex> stateScope(state.Mutex);
+
+    std::size_t measurement = state.NextMeasurement++;
+    state.Peaks.emplace(measurement, allocatedByteCount.load(std::memory_order_relaxed));
+    peakMeasurementCount.fetch_add(1, std::memory_order_release);
+
+    return measurement;
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  std::size_t SampleMemory::EndPeakMeasurement(std::size_t measurement) {
+    PeakState &state = getPeakState();
+    std::lock_guard<std::mutex> stateScope(state.Mutex);
+
+    std::unordered_map<std::size_t, std::size_t>::iterator iterator = (
+      state.Peaks.find(measurement)
+    );
+    if(iterator == state.Peaks.end()) {
+      return 0;
+    }
+
+    std::size_t peakByteCount = iterator->second;
+    state.Peaks.erase(iterator);
+    peakMeasurementCount.fetch_sub(1, std::memory_order_release);
+
+    return peakByteCount;
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  bool SampleMemory::AreHugePagesEnabled() {
+    return hugePagesEnabled.load(std::memory_order_relaxed);
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  void SampleMemory::EnableHugePages(bool enable /* = true */) {
+    hugePagesEnabled.store(enable, std::memory_order_relaxed);
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  std::size_t SampleMemory::GetScratchThreshold() {
+    return scratchThreshold.load(std::memory_order_relaxed);
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  void SampleMemory::SetScratchThreshold(std::size_t byteCount) {
+    scratchThreshold.store(byteCount, std::memory_order_relaxed);
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  std::string SampleMemory::GetScratchDirectory() {
+    ScratchState &state = getScratchState();
+    std::lock_guard<std::mutex> stateScope(state.Mutex);
+    return state.Directory;
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  void SampleMemory::SetScratchDirectory(const std::string &path) {
+    ScratchState &state = getScratchState();
+    std::lock_guard<std::mutex> stateScope(state.Mutex);
+    state.Directory = path;
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  bool SampleMemory::IsInScratchFile(const void *memory) {
+    if(scratchMappingCount.load(std::memory_order_acquire) == 0) {
+      return false;
+    }
+
+    ScratchState &state = getScratchState();
+    std::lock_guard<std::mutex> stateScope(state.Mutex);
+    return (state.Mappings.find(memory) != state.Mappings.end());
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  void SampleMemory::Advise(
+    const void *memory, std::size_t byteCount, SampleAccessPattern pattern
+  ) noexcept {
+    if(byteCount == 0) {
+      return;
+    }
+
+#if defined(NUCLEX_OPUSTRANSCODER_WINDOWS)
+    // Windows has no read-ahead hints for memory, but it can be told to fetch
+    // a range of pages in one go. Open scans are left to the default heuristics.
+    if(pattern == SampleAccessPattern::WillNeed) {
+      WIN32_MEMORY_RANGE_ENTRY range;
+      range.VirtualAddress = const_cast<void *>(memory);
+      range.NumberOfBytes = byteCount;
+      ::PrefetchVirtualMemory(::GetCurrentProcess(), 1, &range, 0);
+    }
+#else
+    // madvise() only accepts page-aligned addresses, so round the range outwards
+    static const std::uintptr_t pageSize = static_cast<std::uintptr_t>(::sysconf(_SC_PAGESIZE));
+    std::uintptr_t startAddress = reinterpret_cast<std::uintptr_t>(memory);
+    std::uintptr_t endAddress = startAddress + byteCount;
+    startAddress -= startAddress % pageSize;
+
+    int advice;
+    switch(pattern) {
+      case SampleAccessPattern::Sequential: { advice = MADV_SEQUENTIAL; break; }
+      case SampleAccessPattern::Random: { advice = MADV_RANDOM; break; }
+      default: { advice = MADV_WILLNEED; break; }
+    }
+
+    // Only a hint, if the kernel doesn't care we simply go on
+    ::madvise(reinterpret_cast<void *>(startAddress), endAddress - startAddress, advice);
+#endif
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+} // namespace Nuclex::OpusTranscoder::Audio
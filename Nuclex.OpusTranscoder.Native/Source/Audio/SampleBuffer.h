@@ -0,0 +1,246 @@
+#pragma region Apache License 2.0
+/*
+Nuclex Opus Transcoder
+Copyright (C) 2024 Markus Ewald / Nuclex Development Labs
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#pragma endregion // Apache License 2.0
+
+#ifndef NUCLEX_OPUSTRANSCODER_AUDIO_SAMPLEBUFFER_H
+#define NUCLEX_OPUSTRANSCODER_AUDIO_SAMPLEBUFFER_H
+
+#include "../Config.h"
+
+#include <vector> // for std::vector
+#include <cstddef> // for std::size_t
+#include <string> // for std::string
+#include <new> // for placement new
+#include <type_traits> // for std::is_nothrow_default_constructible
+#include <utility> // for std::forward()
+
+namespace Nuclex::OpusTranscoder::Audio {
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>How a stage is going to access a buffer of samples</summary>
+  enum class SampleAccessPattern {
+
+    /// <summary>Samples will be read or written front to back</summary>
+    Sequential,
+
+    /// <summary>Samples will be accessed in scattered places</summary>
+    Random,
+
+    /// <summary>Samples will be accessed soon and should be loaded up front</summary>
+    WillNeed
+
+  };
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Provides the memory that audio samples are stored in</summary>
+  /// <remarks>
+  ///   <para>
+  ///     All memory handed out is aligned to a cache line, which also satisfies
+  ///     the alignment needs of any vector instruction set we might use.
+  ///   </para>
+  ///   <para>
+  ///     On Linux, large buffers are additionally aligned to a huge page so that
+  ///     the kernel can back them with transparent huge pages. A decoded movie
+  ///     soundtrack easily takes up gigabytes, and going over that in 4 KiB
+  ///     pages means lots of TLB misses and page faults. Windows can only hand
+  ///     out large pages to processes with the "lock pages in memory" privilege,
+  ///     so there, it's cache line alignment only.
+  ///   </para>
+  ///   <para>
+  ///     Allocations above the scratch threshold are placed in a memory-mapped
+  ///     scratch file instead. The file is deleted right away (or marked for deletion
+  ///     on Windows), so nothing is left behind even if the application crashes.
+  ///     The operating system then pages samples in and out as stages go over them.
+  ///   </para>
+  /// </remarks>
+  class SampleMemory {
+
+    /// <summary>Alignment of all memory provided, in bytes</summary>
+    public: static const std::size_t Alignment;
+    /// <summary>Size of a huge page and threshold from which they are used</summary>
+    public: static const std::size_t HugePageSize;
+
+    /// <summary>Allocates memory for audio samples</summary>
+    /// <param name="byteCount">Number of bytes that will be allocated</param>
+    /// <returns>The address of the allocated memory</returns>
+    public: static void *Allocate(std::size_t byteCount);
+
+    /// <summary>Frees memory previously allocated via <see cref="Allocate" /></summary>
+    /// <param name="memory">Address of the memory that will be freed</param>
+    /// <param name="byteCount">Number of bytes that were requested when allocating</param>
+    public: static void Free(void *memory, std::size_t byteCount) noexcept;
+
+    /// <summary>Counts the bytes currently allocated for audio samples</summary>
+    /// <returns>The number of bytes in all live sample allocations</returns>
+    public: static std::size_t GetAllocatedByteCount();
+
+    /// <summary>Begins recording the peak amount of memory allocated for samples</summary>
+    /// <returns>An identifier that has to be passed to <see cref="EndPeakMeasurement" /></returns>
+    /// <remarks>
+    ///   Several measurements can run at the same time (for example, one for each
+    ///   transcode in a batch). Each records the highest amount of sample memory in use
+    ///   by the whole process while it was running.
+    /// </remarks>
+    public: static std::size_t BeginPeakMeasurement();
+
+    /// <summary>Ends a measurement begun via <see cref="BeginPeakMeasurement" /></summary>
+    /// <param name="measurement">Identifier of the measurement that will be ended</param>
+    /// <returns>The highest number of bytes allocated while the measurement ran</returns>
+    public: static std::size_t EndPeakMeasurement(std::size_t measurement);
+
+    /// <summary>Checks whether large allocations will ask for huge pages</summary>
+    /// <returns>True if huge pages will be requested for large allocations</returns>
+    public: static bool AreHugePagesEnabled();
+
+    /// <summary>Sets whether large allocations will ask for huge pages</summary>
+    /// <param name="enable">True to request huge pages for large allocations</param>
+    /// <remarks>
+    ///   Only affects allocations made after the call. This is on by default.
+    /// </remarks>
+    public: static void EnableHugePages(bool enable = true);
+
+    /// <summary>Looks up the size from which allocations go into scratch files</summary>
+    /// <returns>The minimum size of allocations stored in scratch files, 0 if never</returns>
+    public: static std::size_t GetScratchThreshold();
+
+    /// <summary>Sets the size from which allocations go into scratch files</summary>
+    /// <param name="byteCount">
+    ///   Minimum size of allocations that will be stored in scratch files. If 0,
+    ///   all memory will be allocated normally.
+    /// </param>
+    /// <remarks>
+    ///   Only affects allocations made after the call. The default is taken from
+    ///   the <code>NUCLEX_OPUSTRANSCODER_SCRATCH_THRESHOLD</code> setting.
+    /// </remarks>
+    public: static void SetScratchThreshold(std::size_t byteCount);
+
+    /// <summary>Looks up the directory scratch files are created in</summary>
+    /// <returns>The scratch directory, empty if the temporary directory is used</returns>
+    public: static std::string GetScratchDirectory();
+
+    /// <summary>Sets the directory scratch files will be created in</summary>
+    /// <param name="path">Scratch directory, empty to use the temporary directory</param>
+    public: static void SetScratchDirectory(const std::string &path);
+
+    /// <summary>Checks whether memory has been placed in a scratch file</summary>
+    /// <param name="memory">Address of memory returned by <see cref="Allocate" /></param>
+    /// <returns>True if the memory is backed by a scratch file</returns>
+    public: static bool IsInScratchFile(const void *memory);
+
+    /// <summary>Tells the operating system how samples are going to be accessed</summary>
+    /// <param name="memory">Address of the first sample that will be accessed</param>
+    /// <param name="byteCount">Number of bytes that will be accessed</param>
+    /// <param name="pattern">Way in which the samples are going to be accessed</param>
+    /// <remarks>
+    ///   This is only a hint that matters mostly for samples in scratch files, where
+    ///   it decides how much is read ahead and which pages are dropped first.
+    /// </remarks>
+    public: static void Advise(
+      const void *memory, std::size_t byteCount, SampleAccessPattern pattern
+    ) noexcept;
+
+  };
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Allocator for audio samples that skips initialization</summary>
+  /// <typeparam name="TValue">Type of values the allocator will provide memory for</typeparam>
+  /// <remarks>
+  ///   A standard vector value-initializes (zero-fills) any elements added through
+  ///   <code>resize()</code>. For a track that's about to be decoded into, that means
+  ///   touching gigabytes of memory just to have the decoder overwrite it right away.
+  ///   This allocator default-initializes instead, which for floats does nothing.
+  /// </remarks>
+  template<typename TValue>
+  class SampleAllocator {
+
+    /// <summary>Type of values the allocator provides memory for</summary>
+    public: typedef TValue value_type;
+
+    /// <summary>Initializes a new sample allocator</summary>
+    public: SampleAllocator() noexcept = default;
+
+    /// <summary>Initializes a sample allocator as a copy of another one</summary>
+    /// <typeparam name="TOther">Type of values the other allocator provides memory for</typeparam>
+    public: template<typename TOther>
+    SampleAllocator(const SampleAllocator<TOther> &) noexcept {}
+
+    /// <summary>Allocates memory for the specified number of values</summary>
+    /// <param name="count">Number of values to allocate memory for</param>
+    /// <returns>The address of the allocated memory</returns>
+    public: TValue *allocate(std::size_t count) {
+      return static_cast<TValue *>(SampleMemory::Allocate(count * sizeof(TValue)));
+    }
+
+    /// <summary>Frees memory previously allocated via <see cref="allocate" /></summary>
+    /// <param name="values">Address of the memory that will be freed</param>
+    /// <param name="count">Number of values memory was allocated for</param>
+    public: void deallocate(TValue *values, std::size_t count) noexcept {
+      SampleMemory::Free(values, count * sizeof(TValue));
+    }
+
+    /// <summary>Constructs a value without value-initializing it</summary>
+    /// <typeparam name="TOther">Type of value that will be constructed</typeparam>
+    /// <param name="value">Address at which the value will be constructed</param>
+    public: template<typename TOther>
+    void construct(TOther *value) noexcept(std::is_nothrow_default_constructible<TOther>::value) {
+      ::new(static_cast<void *>(value)) TOther;
+    }
+
+    /// <summary>Constructs a value from the specified arguments</summary>
+    /// <typeparam name="TOther">Type of value that will be constructed</typeparam>
+    /// <typeparam name="TArguments">Types of the arguments passed to the constructor</typeparam>
+    /// <param name="value">Address at which the value will be constructed</param>
+    /// <param name="arguments">Arguments that will be passed to the constructor</param>
+    public: template<typename TOther, typename... TArguments>
+    void construct(TOther *value, TArguments &&...arguments) {
+      ::new(static_cast<void *>(value)) TOther(std::forward<TArguments>(arguments)...);
+    }
+
+  };
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Checks whether two sample allocators can free each other's memory</summary>
+  /// <returns>Always true since sample allocators have no state</returns>
+  template<typename TValue, typename TOther>
+  bool operator ==(const SampleAllocator<TValue> &, const SampleAllocator<TOther> &) noexcept {
+    return true;
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Checks whether two sample allocators can not free each other's memory</summary>
+  /// <returns>Always false since sample allocators have no state</returns>
+  template<typename TValue, typename TOther>
+  bool operator !=(const SampleAllocator<TValue> &, const SampleAllocator<TOther> &) noexcept {
+    return false;
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Aligned buffer of audio samples that doesn't zero-fill when grown</summary>
+  typedef std::vector<float, SampleAllocator<float>> SampleBuffer;
+
+  // ------------------------------------------------------------------------------------------- //
+
+} // namespace Nuclex::OpusTranscoder::Audio
+
+#endif // NUCLEX_OPUSTRANSCODER_AUDIO_SAMPLEBUFFER_H
@@ -0,0 +1,467 @@
+#pragma region Apache License 2.0
+/*
+Nuclex Opus Transcoder
+Copyright (C) 2024 Markus Ewald / Nuclex Development Labs
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#pragma endregion // Apache License 2.0
+
+// If the application is compiled as a DLL, this ensures symbols are exported
+#define NUCLEX_OPUSTRANSCODER_SOURCE 1
+
+#include "./SegmentedOpusEncoder.h"
+#include "./OpusEncoder.h"
+#include "./HalfwaveTucker.h"
+#include "./MemoryFile.h"
+#include "./WorkPartitioner.h"
+
+#include <Nuclex/Audio/Storage/AudioTrackEncoder.h>
+
+#include <Nuclex/Support/Threading/ThreadPool.h>
+
+#include <algorithm> // for std::min()
+#include <atomic> // for std::atomic
+#include <future> // for std::future
+#include <chrono> // for std::chrono::milliseconds
+#include <functional> // for std::ref()
+#include <stdexcept> // for std::runtime_error
+
+namespace {
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Shortest segment length, in 20 ms packets, for parallel encoding</summary>
+  const std::size_t MinimumPacketsPerSegment = 500; // 10 seconds
+
+  /// <summary>Number of 20 ms packets encoded ahead of each segment</summary>
+  /// <remarks>
+  ///   The encoder state (band energies, rate control, transient detection) starts out
+  ///   neutral. One second of audio is plenty for it to converge to what it would have
+  ///   been had the encoder been running from the start of the track.
+  /// </remarks>
+  const std::size_t PreRollPacketCount = 50;
+
+  /// <summary>Number of 20 ms packets encoded after the end of each segment</summary>
+  /// <remarks>
+  ///   This keeps the end-of-stream padding and the encoder's look-ahead away from
+  ///   the packets we take from the segment.
+  /// </remarks>
+  const std::size_t PostRollPacketCount = 10;
+
+  /// <summary>Number of frames fed to the encoder in one call</summary>
+  const std::size_t FramesPerChunk = 12000;
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Encodes a range of frames from a track into a separate Opus stream</summary>
+  /// <param name="track">Track from which the frames will be encoded</param>
+  /// <param name="startFrameIndex">Index of the first frame that will be encoded</param>
+  /// <param name="endFrameIndex">Index one past the last frame that will be encoded</param>
+  /// <param name="bitRateInKilobits">Target bitrate for the encoded audio stream</param>
+  /// <param name="effort">Effort (cpu time) to invest for optimal compression</param>
+  /// <param name="tuck">Whether to apply the clipping half-waves' volume quotients</param>
+  /// <param name="canceler">Token by which the operation can be signalled to cancel</param>
+  /// <param name="encodedFrameCount">Counter that will be increased as frames are encoded</param>
+  /// <returns>The packets of the encoded Opus stream</returns>
+  Nuclex::OpusTranscoder::Audio::OggOpusStream encodeSegment(
+    const std::shared_ptr<Nuclex::OpusTranscoder::Audio::Track> &track,
+    std::uint64_t startFrameIndex,
+    std::uint64_t endFrameIndex,
+    float bitRateInKilobits,
+    float effort,
+    bool tuck,
+    const std::shared_ptr<const Nuclex::Support::Threading::StopToken> &canceler,
+    std::atomic<std::uint64_t> &encodedFrameCount
+  ) {
+    using Nuclex::OpusTranscoder::Audio::MemoryFile;
+
+    std::shared_ptr<MemoryFile> encodedFile = std::make_shared<MemoryFile>();
+    encodedFile->Reserve(
+      static_cast<std::size_t>(
+        Nuclex::OpusTranscoder::Audio::OpusEncoder::EstimateEncodedSize(
+          endFrameIndex - startFrameIndex, track->SampleRate, bitRateInKilobits
+        )
+      )
+    );
+    {
+      std::shared_ptr<Nuclex::Audio::Storage::AudioTrackEncoder> encoder = (
+        Nuclex::OpusTranscoder::Audio::OpusEncoder::OpenEncoder(
+          encodedFile, track->Channels.size(), track->SampleRate, bitRateInKilobits, effort
+        )
+      );
+
+      std::size_t channelCount = track->Channels.size();
+      const float *samples = nullptr;
+      if(!track->IsPlanar && !track->IsCompact()) {
+        samples = track->Samples.data();
+      }
+
+      // Chunks that need to be tucked in, interleaved or expanded are copied into this
+      // buffer, so the track's samples remain untouched. The tucked half-waves act as
+      // a sparse overlay: chunks of an interleaved track that don't overlap any of them
+      // are fed to the encoder straight from the track without copying anything.
+      Nuclex::OpusTranscoder::Audio::SampleBuffer tuckedSamples;
+      if(tuck || (samples == nullptr)) {
+        tuckedSamples.resize(FramesPerChunk * channelCount);
+      }
+
+      std::uint64_t frameIndex = startFrameIndex;
+      while(frameIndex < endFrameIndex) {
+        std::size_t frameCountInChunk;
+        if(FramesPerChunk < endFrameIndex - frameIndex) {
+          frameCountInChunk = FramesPerChunk;
+        } else {
+          frameCountInChunk = static_cast<std::size_t>(endFrameIndex - frameIndex);
+        }
+
+        bool tuckChunk = tuck && (
+          Nuclex::OpusTranscoder::Audio::HalfwaveTucker::OverlapsClippingHalfwaves(
+            track, frameIndex, frameCountInChunk
+          )
+        );
+        if(tuckChunk || (samples == nullptr)) {
+          track->InterleaveFrames(frameIndex, frameCountInChunk, tuckedSamples.data());
+          if(tuckChunk) {
+            Nuclex::OpusTranscoder::Audio::HalfwaveTucker::ApplyVolumeQuotients(
+              track, tuckedSamples.data(), frameIndex, frameCountInChunk
+            );
+          }
+          encoder->EncodeInterleaved(tuckedSamples.data(), frameCountInChunk);
+        } else {
+          encoder->EncodeInterleaved(samples + (frameIndex * channelCount), frameCountInChunk);
+        }
+
+        frameIndex += frameCountInChunk;
+
+        canceler->ThrowIfCanceled();
+        encodedFrameCount.fetch_add(frameCountInChunk, std::memory_order_relaxed);
+      }
+
+      encoder->Flush();
+    }
+
+    return Nuclex::OpusTranscoder::Audio::OggOpusStream::Parse(
+      encodedFile->GetContents().data(), encodedFile->GetContents().size()
+    );
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+} // anonymous namespace
+
+namespace Nuclex::OpusTranscoder::Audio {
+
+  // ------------------------------------------------------------------------------------------- //
+
+  SegmentedOpusEncoder::SegmentedOpusEncoder(
+    const std::shared_ptr<Track> &track, float bitrate, float effort
+  ) :
+    track(track),
+    bitrate(bitrate),
+    effort(effort),
+    tuck(false),
+    segments() {
+    splitIntoSegments(true);
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  SegmentedOpusEncoder::~SegmentedOpusEncoder() = default;
+
+  // ------------------------------------------------------------------------------------------- //
+
+  void SegmentedOpusEncoder::MarkDirty(std::uint64_t startFrameIndex, std::uint64_t endFrameIndex) {
+    std::size_t segmentCount = this->segments.size();
+    for(std::size_t index = 0; index < segmentCount; ++index) {
+      Segment &segment = this->segments[index];
+      bool intersects = (
+        (startFrameIndex < segment.EncodeEndFrameIndex) &&
+        (segment.EncodeStartFrameIndex < endFrameIndex)
+      );
+      if(intersects) {
+        segment.IsDirty = true;
+      }
+    }
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  std::size_t SegmentedOpusEncoder::CountDirtySegments() const {
+    std::size_t dirtySegmentCount = 0;
+
+    std::size_t segmentCount = this->segments.size();
+    for(std::size_t index = 0; index < segmentCount; ++index) {
+      if(this->segments[index].IsDirty) {
+        ++dirtySegmentCount;
+      }
+    }
+
+    return dirtySegmentCount;
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  std::shared_ptr<const Nuclex::Audio::Storage::VirtualFile> SegmentedOpusEncoder::Encode(
+    Nuclex::Support::Threading::ThreadPool &threadPool,
+    const std::shared_ptr<const Nuclex::Support::Threading::StopToken> &canceler,
+    Nuclex::Support::Events::Delegate<void(float)> &progressCallback
+  ) {
+    this->track->AdviseAccessPattern(SampleAccessPattern::Sequential);
+
+    std::size_t segmentCount = this->segments.size();
+
+    // Hand all dirty segments to the thread pool. The others still have their packets
+    // from the last time around, which are just as valid since their samples didn't change.
+    std::vector<std::size_t> dirtySegmentIndices;
+    std::vector<std::future<OggOpusStream>> futures;
+
+    std::atomic<std::uint64_t> encodedFrameCount(0);
+    std::uint64_t framesToEncodeCount = 0;
+    {
+      for(std::size_t index = 0; index < segmentCount; ++index) {
+        Segment &segment = this->segments[index];
+        segment.WasEncoded = false;
+        if(segment.IsDirty) {
+          dirtySegmentIndices.push_back(index);
+          framesToEncodeCount += segment.EncodeEndFrameIndex - segment.EncodeStartFrameIndex;
+        }
+      }
+
+      futures.reserve(dirtySegmentIndices.size());
+      try {
+        for(std::size_t index = 0; index < dirtySegmentIndices.size(); ++index) {
+          const Segment &segment = this->segments[dirtySegmentIndices[index]];
+          futures.push_back(
+            threadPool.Schedule(
+              &encodeSegment,
+              this->track, segment.EncodeStartFrameIndex, segment.EncodeEndFrameIndex,
+              this->bitrate, this->effort, this->tuck, canceler, std::ref(encodedFrameCount)
+            )
+          );
+        }
+      }
+      catch(const std::exception &) {
+        for(std::size_t index = 0; index < futures.size(); ++index) {
+          futures[index].wait(); // they reference our counter, so we can't leave yet
+        }
+        throw;
+      }
+    }
+
+    // Wait for all segments to finish. Even if one fails, we have to wait for all
+    // of them because they're reporting progress into a local variable of ours.
+    for(std::size_t index = 0; index < futures.size(); ++index) {
+      while(futures[index].wait_for(std::chrono::milliseconds(50)) != std::future_status::ready) {
+        progressCallback(
+          static_cast<float>(encodedFrameCount.load(std::memory_order_relaxed)) /
+          static_cast<float>(framesToEncodeCount)
+        );
+      }
+    }
+
+    // Collect the new packets. If a segment failed, those after it remain dirty,
+    // so the cache stays consistent and a later encode can pick up from there.
+    for(std::size_t index = 0; index < futures.size(); ++index) {
+      Segment &segment = this->segments[dirtySegmentIndices[index]];
+      segment.Stream = futures[index].get(); // rethrows errors from the segment
+      segment.IsDirty = false;
+      segment.WasEncoded = true;
+    }
+
+    canceler->ThrowIfCanceled();
+
+    std::shared_ptr<const Nuclex::Audio::Storage::VirtualFile> stitchedFile = Stitch();
+    if(!stitchedFile) {
+      if(segmentCount == 1) {
+        throw std::runtime_error(u8"Opus encoder produced an unexpected packet sequence");
+      }
+
+      // Should the encoder ever use a different pre-skip or packet duration than we
+      // expect, we can't stitch the segments. Keep the output correct in that case.
+      splitIntoSegments(false);
+      return Encode(threadPool, canceler, progressCallback);
+    }
+
+    progressCallback(1.0f);
+    return stitchedFile;
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  std::shared_ptr<const Nuclex::Audio::Storage::VirtualFile> SegmentedOpusEncoder::Stitch() const {
+    OggOpusStream stitched;
+    if(!stitchSegments(stitched)) {
+      return std::shared_ptr<const Nuclex::Audio::Storage::VirtualFile>();
+    }
+
+    std::size_t segmentCount = this->segments.size();
+
+    std::vector<std::byte> contents;
+    {
+      std::size_t expectedSize = 65536;
+      for(std::size_t index = 0; index < segmentCount; ++index) {
+        expectedSize += this->segments[index].Stream.AudioData.size();
+      }
+      contents.reserve(expectedSize);
+    }
+    stitched.Write(contents);
+
+    return std::make_shared<MemoryFile>(std::move(contents));
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  void SegmentedOpusEncoder::RestoreSegment(std::size_t segmentIndex, OggOpusStream &&stream) {
+    Segment &segment = this->segments[segmentIndex];
+    segment.Stream = std::move(stream);
+    segment.IsDirty = false;
+    segment.WasEncoded = true; // it was never checked by whoever restores it
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  void SegmentedOpusEncoder::splitIntoSegments(bool allowMultipleSegments) {
+    std::uint64_t totalFrameCount = this->track->CountFrames();
+
+    this->segments.clear();
+
+    // Segments have to begin on a 20 ms packet boundary at 48 kHz (the Opus sample rate),
+    // otherwise the packets of the segments would not line up on the same grid.
+    std::uint64_t framesPerPacket = this->track->SampleRate / 50;
+    bool canSegment = (
+      allowMultipleSegments &&
+      ((this->track->SampleRate % 50) == 0) &&
+      ((framesPerPacket * MinimumPacketsPerSegment * 2) <= totalFrameCount)
+    );
+    if(!canSegment) {
+      Segment &segment = this->segments.emplace_back();
+      segment.EncodeStartFrameIndex = 0;
+      segment.EncodeEndFrameIndex = totalFrameCount;
+      segment.StartFrameIndex = 0;
+      segment.EndFrameIndex = totalFrameCount;
+      segment.IsDirty = true;
+      segment.WasEncoded = false;
+      return;
+    }
+
+    // Aim for a few segments per thread the job may use so they stay busy towards the end,
+    // but don't make the segments so short that the pre-roll becomes a notable cost.
+    // Shorter segments also mean less to re-encode when only a few samples changed.
+    std::uint64_t framesPerSegment;
+    {
+      std::uint64_t packetCount = (totalFrameCount + framesPerPacket - 1) / framesPerPacket;
+      std::uint64_t desiredSegmentCount = WorkPartitioner::GetParallelism() * 4;
+
+      std::uint64_t packetsPerSegment = packetCount / desiredSegmentCount;
+      if(packetsPerSegment < MinimumPacketsPerSegment) {
+        packetsPerSegment = MinimumPacketsPerSegment;
+      }
+
+      framesPerSegment = packetsPerSegment * framesPerPacket;
+    }
+
+    std::size_t segmentCount = static_cast<std::size_t>(
+      (totalFrameCount + framesPerSegment - 1) / framesPerSegment
+    );
+    std::uint64_t preRollFrameCount = PreRollPacketCount * framesPerPacket;
+    std::uint64_t postRollFrameCount = PostRollPacketCount * framesPerPacket;
+
+    // Work out which range of frames each segment will encode, including its pre-roll
+    // and post-roll, and which range of frames it provides the packets for.
+    this->segments.resize(segmentCount);
+    for(std::size_t index = 0; index < segmentCount; ++index) {
+      Segment &segment = this->segments[index];
+
+      segment.StartFrameIndex = index * framesPerSegment;
+      segment.EndFrameIndex = std::min(
+        segment.StartFrameIndex + framesPerSegment, totalFrameCount
+      );
+
+      if(preRollFrameCount < segment.StartFrameIndex) {
+        segment.EncodeStartFrameIndex = segment.StartFrameIndex - preRollFrameCount;
+      } else {
+        segment.EncodeStartFrameIndex = 0;
+      }
+      segment.EncodeEndFrameIndex = std::min(
+        segment.EndFrameIndex + postRollFrameCount, totalFrameCount
+      );
+
+      segment.IsDirty = true;
+      segment.WasEncoded = false;
+    }
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  bool SegmentedOpusEncoder::stitchSegments(OggOpusStream &stitched) const {
+    std::size_t segmentCount = this->segments.size();
+    std::size_t sampleRate = this->track->SampleRate;
+
+    // From each segment, we take the packets that begin inside the segment's range
+    // (skipping the packets from the pre-roll and post-roll), which means the next
+    // segment continues exactly where the previous one ended.
+    const OggOpusStream &firstStream = this->segments.front().Stream;
+    stitched.SerialNumber = firstStream.SerialNumber;
+    stitched.HeaderPacket = firstStream.HeaderPacket;
+    stitched.CommentPacket = firstStream.CommentPacket;
+
+    std::uint32_t preSkip = firstStream.GetPreSkip();
+    std::uint64_t nextPosition = 0;
+
+    for(std::size_t index = 0; index < segmentCount; ++index) {
+      const Segment &segment = this->segments[index];
+      if(segment.Stream.GetPreSkip() != preSkip) {
+        return false;
+      }
+
+      // All positions in 48 kHz. This is exact because segments start on 20 ms boundaries.
+      std::uint64_t encodeStartPosition = segment.EncodeStartFrameIndex * 48000 / sampleRate;
+      std::uint64_t keepEndPosition = segment.EndFrameIndex * 48000 / sampleRate;
+
+      std::size_t packetCount = segment.Stream.Packets.size();
+      for(std::size_t packetIndex = 0; packetIndex < packetCount; ++packetIndex) {
+        const OggOpusPacket &packet = segment.Stream.Packets[packetIndex];
+
+        std::uint64_t startPosition = (
+          encodeStartPosition + packet.EndPosition - packet.SampleCount
+        );
+        if(startPosition < nextPosition) {
+          continue; // packet is in the pre-roll
+        }
+        if((index + 1 < segmentCount) && (keepEndPosition <= startPosition)) {
+          break; // packet is in the post-roll
+        }
+        if(startPosition != nextPosition) {
+          return false; // packets are not on the same grid
+        }
+
+        stitched.AppendPacket(
+          segment.Stream.AudioData.data() + packet.Offset, packet.Size, packet.SampleCount
+        );
+        nextPosition += packet.SampleCount;
+      }
+    } // for each segment
+
+    const Segment &lastSegment = this->segments.back();
+    stitched.FinalGranulePosition = (
+      lastSegment.Stream.FinalGranulePosition +
+      (lastSegment.EncodeStartFrameIndex * 48000 / sampleRate)
+    );
+
+    return true;
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+} // namespace Nuclex::OpusTranscoder::Audio
@@ -0,0 +1,217 @@
+#pragma region Apache License 2.0
+/*
+Nuclex Opus Transcoder
+Copyright (C) 2024 Markus Ewald / Nuclex Development Labs
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#pragma endregion // Apache License 2.0
+
+#ifndef NUCLEX_OPUSTRANSCODER_AUDIO_SEGMENTEDOPUSENCODER_H
+#define NUCLEX_OPUSTRANSCODER_AUDIO_SEGMENTEDOPUSENCODER_H
+
+#include "../Config.h"
+#include "./Track.h"
+#include "./OggOpusStream.h"
+
+#include <Nuclex/Support/Threading/StopToken.h>
+#include <Nuclex/Support/Events/Delegate.h>
+#include <Nuclex/Audio/Storage/VirtualFile.h>
+
+#include <memory> // for std::shared_ptr
+#include <vector> // for std::vector
+
+namespace Nuclex::Support::Threading {
+
+  // ------------------------------------------------------------------------------------------- //
+
+  class ThreadPool;
+
+  // ------------------------------------------------------------------------------------------- //
+
+} // namespace Nuclex::Support::Threading
+
+namespace Nuclex::OpusTranscoder::Audio {
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Encodes a track in segments and remembers the packets of each segment</summary>
+  /// <remarks>
+  ///   <para>
+  ///     The track is split into segments that are encoded as independent Opus streams,
+  ///     each starting a second early so the encoder state can settle. The packets from
+  ///     each segment's own range are then stitched into a single Ogg Opus stream.
+  ///   </para>
+  ///   <para>
+  ///     The packets of each segment are kept around, so when the track is encoded again
+  ///     after only some of its samples changed, only the segments that were marked as
+  ///     dirty need to be encoded again. Everything else is taken from the previous run.
+  ///   </para>
+  ///   <para>
+  ///     Tracks that are short or whose sample rate is not a multiple of 50 Hz are
+  ///     encoded as a single segment covering the whole track.
+  ///   </para>
+  /// </remarks>
+  class SegmentedOpusEncoder {
+
+    /// <summary>Initializes a new segmented encoder for the specified track</summary>
+    /// <param name="track">Track that will be encoded</param>
+    /// <param name="bitrate">Target bitrate for the encoded audio stream</param>
+    /// <param name="effort">Effort (cpu time) to invest for optimal compression</param>
+    /// <remarks>
+    ///   The track's samples must not be resized while the encoder is in use.
+    ///   All segments start out dirty, so the first encode covers the whole track.
+    /// </remarks>
+    public: SegmentedOpusEncoder(
+      const std::shared_ptr<Track> &track, float bitrate, float effort
+    );
+
+    /// <summary>Frees all memory used by the instance</summary>
+    public: ~SegmentedOpusEncoder();
+
+    /// <summary>Counts the number of segments the track has been split into</summary>
+    /// <returns>The number of segments the track is encoded in</returns>
+    public: std::size_t CountSegments() const { return this->segments.size(); }
+
+    /// <summary>Looks up the first frame whose packets are taken from a segment</summary>
+    /// <param name="segmentIndex">Index of the segment whose start will be looked up</param>
+    /// <returns>The index of the first frame in the segment's own range</returns>
+    public: std::uint64_t GetSegmentStartFrameIndex(std::size_t segmentIndex) const {
+      return this->segments[segmentIndex].StartFrameIndex;
+    }
+
+    /// <summary>Looks up the end of the frames whose packets are taken from a segment</summary>
+    /// <param name="segmentIndex">Index of the segment whose end will be looked up</param>
+    /// <returns>The index one past the last frame in the segment's own range</returns>
+    public: std::uint64_t GetSegmentEndFrameIndex(std::size_t segmentIndex) const {
+      return this->segments[segmentIndex].EndFrameIndex;
+    }
+
+    /// <summary>Checks whether a segment was encoded during the last encode</summary>
+    /// <param name="segmentIndex">Index of the segment that will be checked</param>
+    /// <returns>True if the segment was encoded again rather than taken from the cache</returns>
+    public: bool WasSegmentEncoded(std::size_t segmentIndex) const {
+      return this->segments[segmentIndex].WasEncoded;
+    }
+
+    /// <summary>Marks all segments that read from a range of frames as dirty</summary>
+    /// <param name="startFrameIndex">Index of the first frame that has changed</param>
+    /// <param name="endFrameIndex">Index one past the last frame that has changed</param>
+    /// <remarks>
+    ///   This includes the segments that only read the frames in their pre-roll or
+    ///   post-roll, since the frames affect the encoder state in those, too.
+    /// </remarks>
+    public: void MarkDirty(std::uint64_t startFrameIndex, std::uint64_t endFrameIndex);
+
+    /// <summary>Counts the number of segments that need to be encoded again</summary>
+    /// <returns>The number of dirty segments</returns>
+    public: std::size_t CountDirtySegments() const;
+
+    /// <summary>Whether to de-clip the samples while they are fed to the encoder</summary>
+    /// <param name="enable">True to apply the clipping half-waves' volume quotients</param>
+    /// <remarks>
+    ///   When enabled, the track's samples are left untouched and each chunk of samples
+    ///   is tucked in via <see cref="HalfwaveTucker::ApplyVolumeQuotients" /> just before
+    ///   it goes into the encoder. That way, the iterative de-clipper can keep the original
+    ///   samples and doesn't need a second, de-clipped copy of the whole track.
+    /// </remarks>
+    public: void EnableTucking(bool enable = true) { this->tuck = enable; }
+
+    /// <summary>Checks whether the samples are de-clipped while they are encoded</summary>
+    /// <returns>True if the clipping half-waves' volume quotients are applied</returns>
+    public: bool IsTuckingEnabled() const { return this->tuck; }
+
+    /// <summary>Provides the packets produced when a segment was last encoded</summary>
+    /// <param name="segmentIndex">Index of the segment whose packets will be returned</param>
+    /// <returns>The packets of the segment, including its pre-roll and post-roll</returns>
+    public: const OggOpusStream &GetSegmentStream(std::size_t segmentIndex) const {
+      return this->segments[segmentIndex].Stream;
+    }
+
+    /// <summary>Hands a segment the packets it produced in an earlier run</summary>
+    /// <param name="segmentIndex">Index of the segment whose packets will be replaced</param>
+    /// <param name="stream">Packets obtained from the segment in an earlier run</param>
+    /// <remarks>
+    ///   The packets must have been encoded from the same samples, volume quotients and
+    ///   segment range. The segment stops being dirty and counts as freshly encoded,
+    ///   so the next verification covers it.
+    /// </remarks>
+    public: void RestoreSegment(std::size_t segmentIndex, OggOpusStream &&stream);
+
+    /// <summary>Encodes the dirty segments and stitches all segments together</summary>
+    /// <param name="threadPool">Thread pool on which the segments will be encoded</param>
+    /// <param name="canceler">Token by which the operation can be signalled to cancel</param>
+    /// <param name="progressCallback">Callback to which progress reports should be sent</param>
+    /// <returns>A virtual file containing the encoded Opus file contents</returns>
+    public: std::shared_ptr<const Nuclex::Audio::Storage::VirtualFile> Encode(
+      Nuclex::Support::Threading::ThreadPool &threadPool,
+      const std::shared_ptr<const Nuclex::Support::Threading::StopToken> &canceler,
+      Nuclex::Support::Events::Delegate<void(float)> &progressCallback
+    );
+
+    /// <summary>Stitches the packets all segments have now without encoding anything</summary>
+    /// <returns>
+    ///   A virtual file containing the encoded Opus file contents or nothing if
+    ///   the packets of the segments don't line up
+    /// </returns>
+    public: std::shared_ptr<const Nuclex::Audio::Storage::VirtualFile> Stitch() const;
+
+    /// <summary>Range of the track encoded as its own stream and the packets from it</summary>
+    private: struct Segment {
+
+      /// <summary>Index of the first frame fed to the encoder, including pre-roll</summary>
+      public: std::uint64_t EncodeStartFrameIndex;
+      /// <summary>Index one past the last frame fed to the encoder, including post-roll</summary>
+      public: std::uint64_t EncodeEndFrameIndex;
+      /// <summary>Index of the first frame whose packets are taken from this segment</summary>
+      public: std::uint64_t StartFrameIndex;
+      /// <summary>Index one past the last frame whose packets are taken from this segment</summary>
+      public: std::uint64_t EndFrameIndex;
+      /// <summary>Packets produced when the segment was last encoded</summary>
+      public: OggOpusStream Stream;
+      /// <summary>Whether the samples of the segment changed since it was last encoded</summary>
+      public: bool IsDirty;
+      /// <summary>Whether the segment was encoded again in the last encode</summary>
+      public: bool WasEncoded;
+
+    };
+
+    /// <summary>Splits the track into segments that can be encoded in parallel</summary>
+    /// <param name="allowMultipleSegments">
+    ///   Whether the track may be split into several segments at all
+    /// </param>
+    private: void splitIntoSegments(bool allowMultipleSegments);
+
+    /// <summary>Stitches the cached packets of all segments into a single stream</summary>
+    /// <param name="stitched">Stream that will receive the stitched packets</param>
+    /// <returns>True if the segments could be stitched, false if they don't line up</returns>
+    private: bool stitchSegments(OggOpusStream &stitched) const;
+
+    /// <summary>Track that is being encoded</summary>
+    private: std::shared_ptr<Track> track;
+    /// <summary>Target bitrate for the encoded audio stream</summary>
+    private: float bitrate;
+    /// <summary>Effort (cpu time) to invest for optimal compression</summary>
+    private: float effort;
+    /// <summary>Whether the volume quotients of clipping half-waves are applied</summary>
+    private: bool tuck;
+    /// <summary>Segments the track has been divided into</summary>
+    private: std::vector<Segment> segments;
+
+  };
+
+  // ------------------------------------------------------------------------------------------- //
+
+} // namespace Nuclex::OpusTranscoder::Audio
+
+#endif // NUCLEX_OPUSTRANSCODER_AUDIO_SEGMENTEDOPUSENCODER_H
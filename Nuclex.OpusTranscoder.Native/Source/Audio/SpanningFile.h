@@ -0,0 +1,74 @@
+#pragma region Apache License 2.0
+/*
+Nuclex Opus Transcoder
+Copyright (C) 2024 Markus Ewald / Nuclex Development Labs
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#pragma endregion // Apache License 2.0
+
+#ifndef NUCLEX_OPUSTRANSCODER_AUDIO_SPANNINGFILE_H
+#define NUCLEX_OPUSTRANSCODER_AUDIO_SPANNINGFILE_H
+
+#include "../Config.h"
+
+#include <cstddef> // for std::byte, std::size_t
+#include <cstdint> // for std::uint64_t
+
+namespace Nuclex::OpusTranscoder::Audio {
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>File whose contents sit in memory and can be read where they are</summary>
+  /// <remarks>
+  ///   <para>
+  ///     Reading through <code>VirtualFile::ReadAt()</code> always copies the requested
+  ///     bytes into the caller's buffer. Files that hold their contents in memory anyway,
+  ///     either in a buffer or through a memory-mapped file, also implement this interface
+  ///     so that readers which know about it can use the bytes in place.
+  ///   </para>
+  ///   <para>
+  ///     A reader finds out whether a virtual file supports this through a dynamic_cast
+  ///     and falls back to <code>ReadAt()</code> otherwise. The contents may be split into
+  ///     several pieces, so a span can be shorter than requested and readers should keep
+  ///     asking for the next span until they have all the bytes they need.
+  ///   </para>
+  /// </remarks>
+  class SpanningFile {
+
+    /// <summary>Frees all resources owned by the instance</summary>
+    public: virtual ~SpanningFile() = default;
+
+    /// <summary>Provides direct access to the contents of the file at an offset</summary>
+    /// <param name="start">Offset in the file of the first byte that is needed</param>
+    /// <param name="byteCount">Number of bytes that are needed</param>
+    /// <param name="data">Receives the address of the byte at the offset</param>
+    /// <returns>
+    ///   The number of bytes that can be read from the address. This is only less than
+    ///   the requested number if the bytes aren't stored in one piece. Zero is returned
+    ///   at the end of the file.
+    /// </returns>
+    /// <remarks>
+    ///   The bytes remain valid until the file is written to or destroyed.
+    /// </remarks>
+    public: virtual std::size_t ReadSpan(
+      std::uint64_t start, std::size_t byteCount, const std::byte *&data
+    ) const = 0;
+
+  };
+
+  // ------------------------------------------------------------------------------------------- //
+
+} // namespace Nuclex::OpusTranscoder::Audio
+
+#endif // NUCLEX_OPUSTRANSCODER_AUDIO_SPANNINGFILE_H
@@ -0,0 +1,489 @@
+#pragma region Apache License 2.0
+/*
+Nuclex Opus Transcoder
+Copyright (C) 2024 Markus Ewald / Nuclex Development Labs
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#pragma endregion // Apache License 2.0
+
+// If the application is compiled as a DLL, this ensures symbols are exported
+#define NUCLEX_OPUSTRANSCODER_SOURCE 1
+
+#include "./StreamingClippingVerifier.h"
+#include "./ClippingDetector.h"
+
+#include <algorithm> // for std::copy_n(), std::min(), std::sort(), std::lower_bound()
+#include <cassert> // for assert()
+#include <cmath> // for std::abs()
+
+namespace Nuclex::OpusTranscoder::Audio {
+
+  // ------------------------------------------------------------------------------------------- //
+
+  // About 2.7 seconds at 48 kHz, or 4 MiB for a 7.1 track. Only half-waves longer than
+  // this (DC offsets or silence) need to be decoded a second time to be measured.
+  const std::size_t StreamingClippingVerifier::HistoryFrameCount = 131072;
+
+  // ------------------------------------------------------------------------------------------- //
+
+  StreamingClippingVerifier::StreamingClippingVerifier(const std::shared_ptr<Track> &track) :
+    track(track),
+    decodedTrack(std::make_shared<Track>()),
+    history(),
+    rangeStartFrameIndex(0),
+    endFrameIndex(0),
+    isAtRangeStart(false),
+    ranges(),
+    channelStates(track->Channels.size()) {
+
+    // Left uninitialized, Feed() overwrites each slot before a measurement can read it
+    this->history.resize(HistoryFrameCount * track->Channels.size());
+
+    this->decodedTrack->Channels.resize(track->Channels.size());
+    this->decodedTrack->SampleRate = track->SampleRate;
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  StreamingClippingVerifier::~StreamingClippingVerifier() = default;
+
+  // ------------------------------------------------------------------------------------------- //
+
+  void StreamingClippingVerifier::BeginRange(std::uint64_t startFrameIndex) {
+    assert(
+      (this->ranges.empty() || (this->ranges.back().second <= startFrameIndex)) &&
+      u8"Ranges are fed in order and don't overlap"
+    );
+
+    this->rangeStartFrameIndex = startFrameIndex;
+    this->endFrameIndex = startFrameIndex;
+    this->isAtRangeStart = true;
+
+    // Skip the source track's half-waves that start before the range. Those that reach
+    // into the range can't be measured from it and will be reported as unmeasured.
+    std::size_t channelCount = this->channelStates.size();
+    for(std::size_t channelIndex = 0; channelIndex < channelCount; ++channelIndex) {
+      const ClippingHalfwaveTable &halfwaves = (
+        this->track->Channels[channelIndex].ClippingHalfwaves
+      );
+
+      ChannelState &state = this->channelStates[channelIndex];
+      state.NextHalfwaveIndex = halfwaves.FindFirstStartingFrom(startFrameIndex);
+      state.PendingMeasurements.clear();
+    }
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  void StreamingClippingVerifier::Feed(const float *samples, std::size_t frameCount) {
+    std::size_t channelCount = this->channelStates.size();
+
+    // Feed the samples in chunks of a quarter of the history buffer. This way, any range
+    // that ends inside a chunk can be measured unless it's close to the history's length.
+    while(0 < frameCount) {
+      std::size_t framesInChunk = std::min(frameCount, HistoryFrameCount / 4);
+      feedChunk(samples, framesInChunk);
+
+      samples += framesInChunk * channelCount;
+      frameCount -= framesInChunk;
+    }
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  void StreamingClippingVerifier::EndRange() {
+    std::size_t channelCount = this->channelStates.size();
+    for(std::size_t channelIndex = 0; channelIndex < channelCount; ++channelIndex) {
+      ChannelState &state = this->channelStates[channelIndex];
+
+      // If the clipping flag is still set at the end of the range, record the ongoing
+      // half-wave up to the final frame as a clipping half-wave.
+      if(!this->isAtRangeStart && state.WasClipping) {
+        recordClippingHalfwave(channelIndex, this->endFrameIndex);
+        state.WasClipping = false;
+      }
+
+      // Whatever is still pending reaches beyond the end of the range
+      measureCompletedRanges(channelIndex);
+      state.PendingMeasurements.clear();
+    }
+
+    if(this->rangeStartFrameIndex < this->endFrameIndex) {
+      this->ranges.emplace_back(this->rangeStartFrameIndex, this->endFrameIndex);
+    }
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  void StreamingClippingVerifier::Integrate() {
+    ClippingDetector::Integrate(this->track, this->decodedTrack);
+    sortMeasurements();
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  std::vector<std::pair<std::uint64_t, std::uint64_t>>
+  StreamingClippingVerifier::GetUnmeasuredRanges() const {
+    std::vector<std::pair<std::uint64_t, std::uint64_t>> unmeasuredRanges;
+
+    // Any half-wave that intersects a range that has been fed should have been measured.
+    // Those that haven't were too long for the history or reach outside of the range.
+    std::size_t channelCount = this->channelStates.size();
+    for(std::size_t channelIndex = 0; channelIndex < channelCount; ++channelIndex) {
+      const ClippingHalfwaveTable &halfwaves = (
+        this->track->Channels[channelIndex].ClippingHalfwaves
+      );
+
+      std::size_t rangeIndex = 0;
+      std::size_t halfwaveCount = halfwaves.size();
+      for(std::size_t halfwaveIndex = 0; halfwaveIndex < halfwaveCount; ++halfwaveIndex) {
+        ClippingHalfwave halfwave = halfwaves[halfwaveIndex];
+        while(rangeIndex < this->ranges.size()) {
+          if(halfwave.PriorZeroCrossingIndex < this->ranges[rangeIndex].second) {
+            break;
+          }
+          ++rangeIndex;
+        }
+        if(rangeIndex >= this->ranges.size()) {
+          break;
+        }
+
+        bool intersectsRange = (
+          this->ranges[rangeIndex].first < halfwave.NextZeroCrossingIndex
+        );
+        if(intersectsRange && (findMeasurement(channelIndex, halfwave) == nullptr)) {
+          unmeasuredRanges.emplace_back(
+            halfwave.PriorZeroCrossingIndex, halfwave.NextZeroCrossingIndex
+          );
+        }
+      } // for each clipping half-wave
+    } // for each channel
+
+    // Sort the ranges of all channels and merge those that overlap
+    std::sort(unmeasuredRanges.begin(), unmeasuredRanges.end());
+    std::size_t mergedCount = 0;
+    for(std::size_t index = 0; index < unmeasuredRanges.size(); ++index) {
+      bool overlapsPrevious = (
+        (0 < mergedCount) &&
+        (unmeasuredRanges[index].first <= unmeasuredRanges[mergedCount - 1].second)
+      );
+      if(overlapsPrevious) {
+        unmeasuredRanges[mergedCount - 1].second = std::max(
+          unmeasuredRanges[mergedCount - 1].second, unmeasuredRanges[index].second
+        );
+      } else {
+        unmeasuredRanges[mergedCount] = unmeasuredRanges[index];
+        ++mergedCount;
+      }
+    }
+    unmeasuredRanges.resize(mergedCount);
+
+    return unmeasuredRanges;
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  void StreamingClippingVerifier::MeasureRange(
+    std::uint64_t startFrameIndex, const float *samples, std::size_t frameCount
+  ) {
+    std::size_t channelCount = this->channelStates.size();
+    std::uint64_t endIndex = startFrameIndex + frameCount;
+
+    std::vector<Measurement> newMeasurements;
+    for(std::size_t channelIndex = 0; channelIndex < channelCount; ++channelIndex) {
+      const ClippingHalfwaveTable &halfwaves = (
+        this->track->Channels[channelIndex].ClippingHalfwaves
+      );
+
+      std::size_t halfwaveCount = halfwaves.size();
+      std::size_t halfwaveIndex = halfwaves.FindFirstStartingFrom(startFrameIndex);
+      while(halfwaveIndex < halfwaveCount) {
+        ClippingHalfwave halfwave = halfwaves[halfwaveIndex];
+        if(endIndex < halfwave.NextZeroCrossingIndex) {
+          break;
+        }
+
+        if(findMeasurement(channelIndex, halfwave) == nullptr) {
+          float peak = 0.0f;
+          const float *read = (
+            samples +
+            ((halfwave.PriorZeroCrossingIndex - startFrameIndex) * channelCount) +
+            channelIndex
+          );
+          for(
+            std::uint64_t index = halfwave.PriorZeroCrossingIndex;
+            index < halfwave.NextZeroCrossingIndex;
+            ++index
+          ) {
+            if(peak < std::abs(read[0])) {
+              peak = std::abs(read[0]);
+            }
+            read += channelCount;
+          }
+
+          newMeasurements.push_back(
+            Measurement {
+              halfwave.PriorZeroCrossingIndex, halfwave.NextZeroCrossingIndex, peak
+            }
+          );
+        }
+
+        ++halfwaveIndex;
+      } // for each half-wave inside the range
+
+      // Only add them now, the lookups above need the measurements to remain sorted
+      std::vector<Measurement> &measurements = this->channelStates[channelIndex].Measurements;
+      measurements.insert(measurements.end(), newMeasurements.begin(), newMeasurements.end());
+      std::sort(measurements.begin(), measurements.end());
+      newMeasurements.clear();
+    } // for each channel
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  std::size_t StreamingClippingVerifier::Update() {
+    std::size_t clippingPeakCount = 0;
+
+    std::size_t channelCount = this->channelStates.size();
+    for(std::size_t channelIndex = 0; channelIndex < channelCount; ++channelIndex) {
+      ClippingHalfwaveTable &halfwaves = this->track->Channels[channelIndex].ClippingHalfwaves;
+
+      std::size_t halfwaveCount = halfwaves.size();
+      for(std::size_t halfwaveIndex = 0; halfwaveIndex < halfwaveCount; ++halfwaveIndex) {
+
+        // Half-waves outside of the decoded ranges keep their state. Their samples were
+        // not encoded again, so the decoded stream is the same as it was last time.
+        const Measurement *measurement = findMeasurement(channelIndex, halfwaves[halfwaveIndex]);
+        if(measurement != nullptr) {
+          if(measurement->PeakAmplitude != halfwaves.GetPeakAmplitude(halfwaveIndex)) {
+            halfwaves.ResetIneffectiveIterationCount(halfwaveIndex);
+            halfwaves.SetPeakAmplitude(halfwaveIndex, measurement->PeakAmplitude);
+          } else {
+            halfwaves.IncrementIneffectiveIterationCount(halfwaveIndex);
+          }
+        }
+
+        // Same as in ClippingDetector::Update(), half-waves that did not improve after
+        // 10 attempts are considered a lost cause and are not counted anymore.
+        if(1.0f < halfwaves.GetPeakAmplitude(halfwaveIndex)) {
+          if(halfwaves.GetIneffectiveIterationCount(halfwaveIndex) < 10) {
+            ++clippingPeakCount;
+          }
+        }
+      } // for each clipping halfwave
+    } // for each channel
+
+    return clippingPeakCount;
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  void StreamingClippingVerifier::feedChunk(const float *samples, std::size_t frameCount) {
+    std::size_t channelCount = this->channelStates.size();
+
+    // Put the frames into the history ring buffer so half-waves can be measured
+    // once the decoded stream has moved past their end
+    {
+      std::size_t ringIndex = static_cast<std::size_t>(this->endFrameIndex % HistoryFrameCount);
+      std::size_t framesUntilWrap = std::min(frameCount, HistoryFrameCount - ringIndex);
+      std::copy_n(
+        samples, framesUntilWrap * channelCount, this->history.data() + ringIndex * channelCount
+      );
+      std::copy_n(
+        samples + framesUntilWrap * channelCount,
+        (frameCount - framesUntilWrap) * channelCount,
+        this->history.data()
+      );
+    }
+
+    // Look for clipping in the decoded frames. This is the same state machine as in
+    // ClippingDetector::FindClippingHalfwaves(), only resumable between chunks.
+    std::uint64_t chunkEndIndex = this->endFrameIndex + frameCount;
+    for(std::size_t channelIndex = 0; channelIndex < channelCount; ++channelIndex) {
+      ChannelState &state = this->channelStates[channelIndex];
+      const float *read = samples + channelIndex;
+      std::uint64_t index = this->endFrameIndex;
+
+      if(this->isAtRangeStart) {
+        state.ClippingPeak = *read;
+        state.ClippingPeakIndex = index;
+        state.WasClipping = (1.0f < std::abs(state.ClippingPeak));
+        state.WasBelowZero = (state.ClippingPeak < 0.0f);
+        state.ZeroCrossingIndex = index;
+
+        read += channelCount;
+        ++index;
+      }
+
+      for(; index < chunkEndIndex; ++index) {
+        float sample = *read;
+
+        bool isBelowZero = (sample < 0.0f);
+        if(state.WasBelowZero != isBelowZero) {
+          if(state.WasClipping) {
+            recordClippingHalfwave(channelIndex, index);
+
+            state.WasClipping = false;
+            state.ClippingPeak = 0.0f;
+          }
+
+          state.ZeroCrossingIndex = index;
+          state.WasBelowZero = isBelowZero;
+        } // is current sample cross zero line
+
+        bool isClipping = (1.0f < std::abs(sample));
+        if(isClipping) {
+          state.WasClipping = true;
+          if(state.ClippingPeak < std::abs(sample)) {
+            state.ClippingPeak = std::abs(sample);
+            state.ClippingPeakIndex = index;
+          }
+        } // if current sample is clipping
+
+        read += channelCount;
+      } // for each sample in the chunk
+    } // for each channel
+
+    this->isAtRangeStart = false;
+    this->endFrameIndex = chunkEndIndex;
+
+    // Queue the source track's half-waves the decoded stream has reached for measurement
+    // and measure all ranges the decoded stream has fully passed
+    for(std::size_t channelIndex = 0; channelIndex < channelCount; ++channelIndex) {
+      const ClippingHalfwaveTable &halfwaves = (
+        this->track->Channels[channelIndex].ClippingHalfwaves
+      );
+
+      ChannelState &state = this->channelStates[channelIndex];
+      while(state.NextHalfwaveIndex < halfwaves.size()) {
+        ClippingHalfwave halfwave = halfwaves[state.NextHalfwaveIndex];
+        if(this->endFrameIndex <= halfwave.PriorZeroCrossingIndex) {
+          break;
+        }
+
+        state.PendingMeasurements.push_back(
+          Measurement {
+            halfwave.PriorZeroCrossingIndex, halfwave.NextZeroCrossingIndex, 0.0f
+          }
+        );
+        ++state.NextHalfwaveIndex;
+      }
+
+      measureCompletedRanges(channelIndex);
+    }
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  void StreamingClippingVerifier::recordClippingHalfwave(
+    std::size_t channelIndex, std::uint64_t endIndex
+  ) {
+    ChannelState &state = this->channelStates[channelIndex];
+
+    this->decodedTrack->Channels[channelIndex].ClippingHalfwaves.emplace_back(
+      state.ZeroCrossingIndex, state.ClippingPeakIndex, endIndex, state.ClippingPeak
+    );
+
+    // If integrating this half-wave adds a new one to the source track, it will cover
+    // the source half-wave around the peak. Measure that range, too, so we still have it.
+    ClippingHalfwave sourceHalfwave = ClippingDetector::GetHalfwaveAroundSample(
+      this->track, channelIndex, state.ClippingPeakIndex
+    );
+    state.PendingMeasurements.push_back(
+      Measurement {
+        sourceHalfwave.PriorZeroCrossingIndex, sourceHalfwave.NextZeroCrossingIndex, 0.0f
+      }
+    );
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  void StreamingClippingVerifier::measureCompletedRanges(std::size_t channelIndex) {
+    std::size_t channelCount = this->channelStates.size();
+    ChannelState &state = this->channelStates[channelIndex];
+
+    std::size_t pendingIndex = 0;
+    while(pendingIndex < state.PendingMeasurements.size()) {
+      Measurement &pending = state.PendingMeasurements[pendingIndex];
+      if(this->endFrameIndex < pending.NextZeroCrossingIndex) {
+        ++pendingIndex;
+        continue;
+      }
+
+      // The range can only be measured if all of its frames are still in the history.
+      // Otherwise it's left unmeasured, to be picked up by MeasureRange() later.
+      bool isInHistory = (
+        (this->rangeStartFrameIndex <= pending.PriorZeroCrossingIndex) &&
+        (this->endFrameIndex - pending.PriorZeroCrossingIndex <= HistoryFrameCount)
+      );
+      if(isInHistory) {
+        float peak = 0.0f;
+        for(
+          std::uint64_t index = pending.PriorZeroCrossingIndex;
+          index < pending.NextZeroCrossingIndex;
+          ++index
+        ) {
+          std::size_t ringIndex = static_cast<std::size_t>(index % HistoryFrameCount);
+          float sample = this->history[ringIndex * channelCount + channelIndex];
+          if(peak < std::abs(sample)) {
+            peak = std::abs(sample);
+          }
+        }
+
+        pending.PeakAmplitude = peak;
+        state.Measurements.push_back(pending);
+      }
+
+      state.PendingMeasurements[pendingIndex] = state.PendingMeasurements.back();
+      state.PendingMeasurements.pop_back();
+    }
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  const StreamingClippingVerifier::Measurement *StreamingClippingVerifier::findMeasurement(
+    std::size_t channelIndex, const ClippingHalfwave &halfwave
+  ) const {
+    const std::vector<Measurement> &measurements = this->channelStates[channelIndex].Measurements;
+
+    Measurement probe = { halfwave.PriorZeroCrossingIndex, 0, 0.0f };
+    std::vector<Measurement>::const_iterator measurementIt = std::lower_bound(
+      measurements.begin(), measurements.end(), probe
+    );
+    while(measurementIt != measurements.end()) {
+      if(measurementIt->PriorZeroCrossingIndex != halfwave.PriorZeroCrossingIndex) {
+        break;
+      }
+      if(measurementIt->NextZeroCrossingIndex == halfwave.NextZeroCrossingIndex) {
+        return &(*measurementIt);
+      }
+      ++measurementIt;
+    }
+
+    return nullptr;
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  void StreamingClippingVerifier::sortMeasurements() {
+    std::size_t channelCount = this->channelStates.size();
+    for(std::size_t channelIndex = 0; channelIndex < channelCount; ++channelIndex) {
+      std::vector<Measurement> &measurements = this->channelStates[channelIndex].Measurements;
+      std::sort(measurements.begin(), measurements.end());
+    }
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+} // namespace Nuclex::OpusTranscoder::Audio
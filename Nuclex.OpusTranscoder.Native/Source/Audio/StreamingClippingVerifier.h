@@ -0,0 +1,201 @@
+#pragma region Apache License 2.0
+/*
+Nuclex Opus Transcoder
+Copyright (C) 2024 Markus Ewald / Nuclex Development Labs
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#pragma endregion // Apache License 2.0
+
+#ifndef NUCLEX_OPUSTRANSCODER_AUDIO_STREAMINGCLIPPINGVERIFIER_H
+#define NUCLEX_OPUSTRANSCODER_AUDIO_STREAMINGCLIPPINGVERIFIER_H
+
+#include "../Config.h"
+#include "./Track.h"
+#include "./SampleBuffer.h"
+
+#include <memory> // for std::shared_ptr
+#include <vector> // for std::vector
+#include <utility> // for std::pair
+
+namespace Nuclex::OpusTranscoder::Audio {
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Checks a decoded audio stream for clipping without holding all of it</summary>
+  /// <remarks>
+  ///   <para>
+  ///     This does the job of <see cref="ClippingDetector::FindClippingHalfwaves" />,
+  ///     <see cref="ClippingDetector::Integrate" /> and <see cref="ClippingDetector::Update" />
+  ///     on a decoded stream that is fed in chunks. Only a short history of the decoded
+  ///     samples is kept, so the decoded stream never has to be held in memory in full.
+  ///   </para>
+  ///   <para>
+  ///     The decoded stream can consist of several ranges of the track (i.e. only those
+  ///     parts that have been encoded again). Half-waves outside of these ranges are left
+  ///     untouched. Half-waves that reach outside of a range, or that are too long for
+  ///     the history buffer, are reported by <see cref="GetUnmeasuredRanges" /> so that
+  ///     the caller can decode them separately and hand them to <see cref="MeasureRange" />.
+  ///   </para>
+  ///   <para>
+  ///     Usage: for each range, call <see cref="BeginRange" />, <see cref="Feed" /> and
+  ///     <see cref="EndRange" />. Then call <see cref="Integrate" />, measure the ranges
+  ///     still unmeasured and finally <see cref="Update" />. If the whole track is fed,
+  ///     the outcome is identical to the non-streaming methods on a fully decoded track.
+  ///   </para>
+  /// </remarks>
+  class StreamingClippingVerifier {
+
+    /// <summary>Number of decoded frames kept to measure half-waves after they end</summary>
+    public: static const std::size_t HistoryFrameCount;
+
+    /// <summary>Initializes a new streaming clipping verifier</summary>
+    /// <param name="track">
+    ///   Source track whose clipping half-waves will be checked in the decoded stream
+    /// </param>
+    public: StreamingClippingVerifier(const std::shared_ptr<Track> &track);
+
+    /// <summary>Frees all memory used by the instance</summary>
+    public: ~StreamingClippingVerifier();
+
+    /// <summary>Begins a contiguous range of decoded frames</summary>
+    /// <param name="startFrameIndex">Index of the first frame that will be fed</param>
+    /// <remarks>
+    ///   Ranges have to be fed in order and must not overlap each other.
+    /// </remarks>
+    public: void BeginRange(std::uint64_t startFrameIndex);
+
+    /// <summary>Feeds decoded frames into the verifier</summary>
+    /// <param name="samples">Interleaved samples holding the decoded frames</param>
+    /// <param name="frameCount">Number of frames that will be fed</param>
+    public: void Feed(const float *samples, std::size_t frameCount);
+
+    /// <summary>Ends the current range of decoded frames</summary>
+    public: void EndRange();
+
+    /// <summary>
+    ///   Integrates the clipping half-waves found in the decoded stream into the track
+    /// </summary>
+    public: void Integrate();
+
+    /// <summary>Collects the ranges of half-waves that still need to be measured</summary>
+    /// <returns>The ordered, non-overlapping frame ranges that need to be decoded</returns>
+    public: std::vector<std::pair<std::uint64_t, std::uint64_t>> GetUnmeasuredRanges() const;
+
+    /// <summary>Measures the half-waves that lie fully inside a range of decoded frames</summary>
+    /// <param name="startFrameIndex">Index of the first frame in the sample buffer</param>
+    /// <param name="samples">Interleaved samples holding the decoded frames</param>
+    /// <param name="frameCount">Number of frames held in the sample buffer</param>
+    public: void MeasureRange(
+      std::uint64_t startFrameIndex, const float *samples, std::size_t frameCount
+    );
+
+    /// <summary>Updates the peak amplitudes of the track's clipping half-waves</summary>
+    /// <returns>The number of half-waves that are still suffering from clipping</returns>
+    public: std::size_t Update();
+
+    /// <summary>Peak amplitude the decoded stream has in a half-wave's range</summary>
+    private: struct Measurement {
+
+      /// <summary>Index of the sample at which the half-wave begins</summary>
+      public: std::uint64_t PriorZeroCrossingIndex;
+      /// <summary>Index of the sample at which the half-wave ends</summary>
+      public: std::uint64_t NextZeroCrossingIndex;
+      /// <summary>Highest absolute sample value in the decoded stream</summary>
+      public: float PeakAmplitude;
+
+      /// <summary>Checks whether this measurement should be ordered before another</summary>
+      /// <param name="other">Other measurement this one will be compared to</param>
+      /// <returns>True if this measurement's range starts (or ends) earlier</returns>
+      public: bool operator <(const Measurement &other) const {
+        return (
+          (this->PriorZeroCrossingIndex < other.PriorZeroCrossingIndex) || (
+            (this->PriorZeroCrossingIndex == other.PriorZeroCrossingIndex) &&
+            (this->NextZeroCrossingIndex < other.NextZeroCrossingIndex)
+          )
+        );
+      }
+
+    };
+
+    /// <summary>Tracks the clipping scan and pending measurements of a channel</summary>
+    private: struct ChannelState {
+
+      /// <summary>Index of the frame at which the ongoing half-wave began</summary>
+      public: std::uint64_t ZeroCrossingIndex;
+      /// <summary>Index of the frame with the highest clipping sample so far</summary>
+      public: std::uint64_t ClippingPeakIndex;
+      /// <summary>Highest clipping sample value in the ongoing half-wave</summary>
+      public: float ClippingPeak;
+      /// <summary>Whether the ongoing half-wave is below the zero line</summary>
+      public: bool WasBelowZero;
+      /// <summary>Whether the ongoing half-wave contains clipping samples</summary>
+      public: bool WasClipping;
+      /// <summary>Index of the next half-wave of the source track to be measured</summary>
+      public: std::size_t NextHalfwaveIndex;
+      /// <summary>Ranges that will be measured once the decoded stream has passed them</summary>
+      public: std::vector<Measurement> PendingMeasurements;
+      /// <summary>Ranges that have been measured, ordered by their start index</summary>
+      public: std::vector<Measurement> Measurements;
+
+    };
+
+    /// <summary>Processes a chunk of frames that fits into the history buffer</summary>
+    /// <param name="samples">Interleaved samples holding the decoded frames</param>
+    /// <param name="frameCount">Number of frames in the chunk</param>
+    private: void feedChunk(const float *samples, std::size_t frameCount);
+
+    /// <summary>Records a clipping half-wave found in the decoded stream</summary>
+    /// <param name="channelIndex">Index of the channel the half-wave was found in</param>
+    /// <param name="endIndex">Index of the frame at which the half-wave ended</param>
+    private: void recordClippingHalfwave(std::size_t channelIndex, std::uint64_t endIndex);
+
+    /// <summary>Measures all pending ranges the decoded stream has fully passed</summary>
+    /// <param name="channelIndex">Index of the channel whose ranges will be measured</param>
+    private: void measureCompletedRanges(std::size_t channelIndex);
+
+    /// <summary>Looks up the measurement for a half-wave</summary>
+    /// <param name="channelIndex">Index of the channel the half-wave is in</param>
+    /// <param name="halfwave">Half-wave whose measurement will be looked up</param>
+    /// <returns>The measurement of the half-wave or a null pointer if it has none</returns>
+    private: const Measurement *findMeasurement(
+      std::size_t channelIndex, const ClippingHalfwave &halfwave
+    ) const;
+
+    /// <summary>Sorts the measurements of all channels by their start index</summary>
+    private: void sortMeasurements();
+
+    /// <summary>Source track whose half-waves are being checked</summary>
+    private: std::shared_ptr<Track> track;
+    /// <summary>Holds the clipping half-waves found in the decoded stream</summary>
+    private: std::shared_ptr<Track> decodedTrack;
+    /// <summary>Ring buffer holding the most recently fed frames</summary>
+    private: SampleBuffer history;
+    /// <summary>Index of the first frame in the current range</summary>
+    private: std::uint64_t rangeStartFrameIndex;
+    /// <summary>Index one past the last frame that has been fed</summary>
+    private: std::uint64_t endFrameIndex;
+    /// <summary>Whether the next frame fed is the first in its range</summary>
+    private: bool isAtRangeStart;
+    /// <summary>Ranges of frames that have been fed so far</summary>
+    private: std::vector<std::pair<std::uint64_t, std::uint64_t>> ranges;
+    /// <summary>Clipping scan and measurement state of each channel</summary>
+    private: std::vector<ChannelState> channelStates;
+
+  };
+
+  // ------------------------------------------------------------------------------------------- //
+
+} // namespace Nuclex::OpusTranscoder::Audio
+
+#endif // NUCLEX_OPUSTRANSCODER_AUDIO_STREAMINGCLIPPINGVERIFIER_H
@@ -0,0 +1,210 @@
+#pragma region Apache License 2.0
+/*
+Nuclex Opus Transcoder
+Copyright (C) 2024 Markus Ewald / Nuclex Development Labs
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#pragma endregion // Apache License 2.0
+
+// If the application is compiled as a DLL, this ensures symbols are exported
+#define NUCLEX_OPUSTRANSCODER_SOURCE 1
+
+#include "./StreamingDeclipper.h"
+#include "./ClippingHalfwave.h"
+#include "./HalfwaveTucker.h"
+
+#include <algorithm> // for std::copy_n(), std::min(), std::max()
+#include <cassert> // for assert()
+#include <cmath> // for std::abs()
+
+namespace Nuclex::OpusTranscoder::Audio {
+
+  // ------------------------------------------------------------------------------------------- //
+
+  // About 2.7 seconds at 48 kHz, or 4 MiB for a 7.1 track. Real half-waves are far shorter
+  // (a 20 Hz tone has half-waves of 25 ms), only DC offsets or silence would exceed this.
+  const std::size_t StreamingDeclipper::MaximumHeldFrameCount = 131072;
+
+  // ------------------------------------------------------------------------------------------- //
+
+  StreamingDeclipper::StreamingDeclipper(std::size_t channelCount) :
+    channelCount(channelCount),
+    samples(),
+    firstFrameIndex(0),
+    bufferedFrameCount(0),
+    completedFrameCount(0),
+    channelStates(channelCount),
+    isFinished(false) {}
+
+  // ------------------------------------------------------------------------------------------- //
+
+  void StreamingDeclipper::Feed(const float *samples, std::size_t frameCount) {
+    assert((!this->isFinished) && u8"No more samples are fed after the stream has ended");
+    if(frameCount == 0) {
+      return;
+    }
+
+    // Append the new samples to the buffer. Any frames not yet completed stay in the buffer
+    // because we may still have to tuck them in when their half-wave ends.
+    std::size_t heldSampleCount = this->bufferedFrameCount * this->channelCount;
+    this->samples.resize(heldSampleCount + frameCount * this->channelCount);
+    std::copy_n(samples, frameCount * this->channelCount, this->samples.data() + heldSampleCount);
+
+    std::uint64_t startIndex = this->firstFrameIndex + this->bufferedFrameCount;
+    std::uint64_t endIndex = startIndex + frameCount;
+    this->bufferedFrameCount += frameCount;
+
+    // This works exactly like the ClippingDetector's scan, except that the state of
+    // each channel is carried over from one chunk to the next.
+    for(std::size_t channelIndex = 0; channelIndex < this->channelCount; ++channelIndex) {
+      ChannelState &state = this->channelStates[channelIndex];
+      const float *read = this->samples.data() + heldSampleCount + channelIndex;
+
+      std::uint64_t index = startIndex;
+      if(index == 0) {
+        float sample = *read;
+        state.ZeroCrossingIndex = 0;
+        state.ClippingPeakIndex = 0;
+        state.ClippingPeak = sample;
+        state.WasBelowZero = (sample < 0.0f);
+        state.WasClipping = (1.0f < std::abs(sample));
+
+        read += this->channelCount;
+        ++index;
+      }
+
+      for(; index < endIndex; ++index) {
+        float sample = *read;
+
+        // Did we cross the zero line? Then the prior half-wave is complete and
+        // can be tucked in if it was clipping.
+        bool isBelowZero = (sample < 0.0f);
+        if(isBelowZero != state.WasBelowZero) {
+          if(state.WasClipping) {
+            tuckHalfwave(channelIndex, state, index);
+            state.WasClipping = false;
+            state.ClippingPeak = 0.0f;
+          }
+
+          state.ZeroCrossingIndex = index;
+          state.WasBelowZero = isBelowZero;
+        }
+
+        // Record the peak amplitude of clipping half-waves
+        float amplitude = std::abs(sample);
+        if(1.0f < amplitude) {
+          state.WasClipping = true;
+          if(state.ClippingPeak < amplitude) {
+            state.ClippingPeak = amplitude;
+            state.ClippingPeakIndex = index;
+          }
+        }
+
+        read += this->channelCount;
+      } // for each new frame
+    } // for each channel
+
+    updateCompletedFrameCount();
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  void StreamingDeclipper::Finish() {
+    if(this->isFinished) {
+      return;
+    }
+
+    // Half-waves still open at the end of the stream end with the last frame
+    std::uint64_t endIndex = this->firstFrameIndex + this->bufferedFrameCount;
+    for(std::size_t channelIndex = 0; channelIndex < this->channelCount; ++channelIndex) {
+      ChannelState &state = this->channelStates[channelIndex];
+      if(state.WasClipping) {
+        tuckHalfwave(channelIndex, state, endIndex);
+        state.WasClipping = false;
+      }
+    }
+
+    this->isFinished = true;
+    this->completedFrameCount = this->bufferedFrameCount;
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  void StreamingDeclipper::DiscardCompletedFrames() {
+    std::size_t remainingFrameCount = this->bufferedFrameCount - this->completedFrameCount;
+
+    // Move the held frames to the front. This is usually only a few milliseconds worth
+    // of samples and the buffer keeps its capacity, so this is cheap.
+    std::copy_n(
+      this->samples.data() + (this->completedFrameCount * this->channelCount),
+      remainingFrameCount * this->channelCount,
+      this->samples.data()
+    );
+    this->samples.resize(remainingFrameCount * this->channelCount);
+
+    this->firstFrameIndex += this->completedFrameCount;
+    this->bufferedFrameCount = remainingFrameCount;
+    this->completedFrameCount = 0;
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  void StreamingDeclipper::tuckHalfwave(
+    std::size_t channelIndex, const ChannelState &state, std::uint64_t endIndex
+  ) {
+    ClippingHalfwave halfwave(
+      state.ZeroCrossingIndex, state.ClippingPeakIndex, endIndex, state.ClippingPeak
+    );
+    float quotient = HalfwaveTucker::UpdateVolumeQuotient(halfwave);
+
+    // If the half-wave was too long to be held completely, its beginning has already
+    // been handed out. We can only tuck in what is still in the buffer.
+    std::uint64_t startIndex = std::max(halfwave.PriorZeroCrossingIndex, this->firstFrameIndex);
+
+    float *samples = (
+      this->samples.data() +
+      ((startIndex - this->firstFrameIndex) * this->channelCount) +
+      channelIndex
+    );
+    for(std::uint64_t index = startIndex; index < endIndex; ++index) {
+      samples[0] /= quotient;
+      samples += this->channelCount;
+    }
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  void StreamingDeclipper::updateCompletedFrameCount() {
+    std::uint64_t endIndex = this->firstFrameIndex + this->bufferedFrameCount;
+
+    // Frames are complete up to the earliest zero crossing that began any channel's
+    // ongoing half-wave. Half-waves that do not clip can't be altered anymore, but we
+    // don't know yet whether they will clip before they end.
+    std::uint64_t safeIndex = endIndex;
+    for(std::size_t channelIndex = 0; channelIndex < this->channelCount; ++channelIndex) {
+      safeIndex = std::min(safeIndex, this->channelStates[channelIndex].ZeroCrossingIndex);
+    }
+    safeIndex = std::max(safeIndex, this->firstFrameIndex);
+
+    // Never hold more frames than our limit
+    if(MaximumHeldFrameCount < endIndex - safeIndex) {
+      safeIndex = endIndex - MaximumHeldFrameCount;
+    }
+
+    this->completedFrameCount = static_cast<std::size_t>(safeIndex - this->firstFrameIndex);
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+} // namespace Nuclex::OpusTranscoder::Audio
@@ -0,0 +1,128 @@
+#pragma region Apache License 2.0
+/*
+Nuclex Opus Transcoder
+Copyright (C) 2024 Markus Ewald / Nuclex Development Labs
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#pragma endregion // Apache License 2.0
+
+#ifndef NUCLEX_OPUSTRANSCODER_AUDIO_STREAMINGDECLIPPER_H
+#define NUCLEX_OPUSTRANSCODER_AUDIO_STREAMINGDECLIPPER_H
+
+#include "../Config.h"
+#include "./SampleBuffer.h"
+
+#include <vector> // for std::vector
+#include <cstdint> // for std::uint64_t
+
+namespace Nuclex::OpusTranscoder::Audio {
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Tucks in clipping half-waves of audio data that arrives in chunks</summary>
+  /// <remarks>
+  ///   <para>
+  ///     This produces the same results as running the <see cref="ClippingDetector" />
+  ///     followed by the <see cref="HalfwaveTucker" /> on the whole track, but only needs
+  ///     to hold on to the samples that make up each channel's ongoing half-wave.
+  ///   </para>
+  ///   <para>
+  ///     A half-wave can only be tucked in once its next zero crossing has been seen,
+  ///     so frames are only handed out as completed when all channels are past the zero
+  ///     crossing that began their ongoing half-wave. To keep memory bounded, a half-wave
+  ///     that grows longer than <see cref="MaximumHeldFrameCount" /> (which only happens
+  ///     with DC offsets or long runs of silence) has its beginning released untouched.
+  ///   </para>
+  /// </remarks>
+  class StreamingDeclipper {
+
+    /// <summary>Maximum number of frames that will be held back by the declipper</summary>
+    public: static const std::size_t MaximumHeldFrameCount;
+
+    /// <summary>Initializes a new streaming de-clipper</summary>
+    /// <param name="channelCount">Number of interleaved channels in the audio data</param>
+    public: StreamingDeclipper(std::size_t channelCount);
+
+    /// <summary>Feeds the next chunk of interleaved samples to the de-clipper</summary>
+    /// <param name="samples">Interleaved samples that will be processed</param>
+    /// <param name="frameCount">Number of frames (samples per channel) provided</param>
+    /// <remarks>
+    ///   Completed frames from earlier calls must have been discarded via
+    ///   <see cref="DiscardCompletedFrames" /> or they will be handed out again.
+    /// </remarks>
+    public: void Feed(const float *samples, std::size_t frameCount);
+
+    /// <summary>Signals the end of the audio stream, completing all held frames</summary>
+    public: void Finish();
+
+    /// <summary>Counts the number of frames that are completely processed</summary>
+    /// <returns>The number of frames that can be taken from the de-clipper</returns>
+    public: std::size_t CountCompletedFrames() const { return this->completedFrameCount; }
+
+    /// <summary>Provides the interleaved samples of all completed frames</summary>
+    /// <returns>A pointer to the first completed frame</returns>
+    public: const float *GetCompletedFrames() const { return this->samples.data(); }
+
+    /// <summary>Drops the completed frames from the de-clipper's buffer</summary>
+    public: void DiscardCompletedFrames();
+
+    /// <summary>Tracks the ongoing half-wave in one of the channels</summary>
+    private: struct ChannelState {
+
+      /// <summary>Index of the first frame belonging to the ongoing half-wave</summary>
+      public: std::uint64_t ZeroCrossingIndex;
+      /// <summary>Index of the frame with the highest amplitude seen so far</summary>
+      public: std::uint64_t ClippingPeakIndex;
+      /// <summary>Highest amplitude seen in the ongoing half-wave so far</summary>
+      public: float ClippingPeak;
+      /// <summary>Whether the ongoing half-wave is below the zero line</summary>
+      public: bool WasBelowZero;
+      /// <summary>Whether the ongoing half-wave extends beyond the signal ceiling</summary>
+      public: bool WasClipping;
+
+    };
+
+    /// <summary>Tucks in the samples of a clipping half-wave in the buffer</summary>
+    /// <param name="channelIndex">Index of the channel the half-wave is in</param>
+    /// <param name="state">State holding the informations about the half-wave</param>
+    /// <param name="endIndex">Index one past the last frame in the half-wave</param>
+    private: void tuckHalfwave(
+      std::size_t channelIndex, const ChannelState &state, std::uint64_t endIndex
+    );
+
+    /// <summary>Recalculates the number of frames that can be handed out</summary>
+    private: void updateCompletedFrameCount();
+
+    /// <summary>Number of interleaved channels in the audio data</summary>
+    private: std::size_t channelCount;
+    /// <summary>Interleaved samples of the frames currently held by the de-clipper</summary>
+    private: SampleBuffer samples;
+    /// <summary>Absolute index of the first frame in the sample buffer</summary>
+    private: std::uint64_t firstFrameIndex;
+    /// <summary>Number of frames currently stored in the sample buffer</summary>
+    private: std::size_t bufferedFrameCount;
+    /// <summary>Number of frames at the beginning of the buffer that are completed</summary>
+    private: std::size_t completedFrameCount;
+    /// <summary>Ongoing half-wave in each of the channels</summary>
+    private: std::vector<ChannelState> channelStates;
+    /// <summary>Whether the end of the audio stream has been reached</summary>
+    private: bool isFinished;
+
+  };
+
+  // ------------------------------------------------------------------------------------------- //
+
+} // namespace Nuclex::OpusTranscoder::Audio
+
+#endif // NUCLEX_OPUSTRANSCODER_AUDIO_STREAMINGDECLIPPER_H
@@ -22,11 +22,29 @@ limitations under the License.
 
 #include "./Track.h"
 
+#include <algorithm> // for std::min(), std::copy_n()
+#include <cassert> // for assert()
+
 #if !defined(NDEBUG)
 #include <Nuclex/Audio/Processing/DecibelConverter.h>
 #include <iostream>
 #endif
 
+namespace {
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Number of frames that are interleaved or deinterleaved in one go</summary>
+  /// <remarks>
+  ///   With 8 channels, a block is 32 KiB of interleaved samples plus 4 KiB for
+  ///   the channel, which comfortably stays in the level 1 or level 2 cache.
+  /// </remarks>
+  const std::size_t FramesPerBlock = 1024;
+
+  // ------------------------------------------------------------------------------------------- //
+
+} // anonymous namespace
+
 namespace Nuclex::OpusTranscoder::Audio {
 
   // ------------------------------------------------------------------------------------------- //
@@ -41,7 +59,149 @@ namespace Nuclex::OpusTranscoder::Audio {
     }
 
     for(std::size_t index = 0; index < this->Channels.size(); ++index) {
-      otherTrack->Channels[index].ClippingHalfwaves = this->Channels[index].ClippingHalfwaves;
+      otherTrack->Channels[index].ClippingHalfwaves.CopyFrom(
+        this->Channels[index].ClippingHalfwaves
+      );
+    }
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  void Track::ConvertToPlanar() {
+    if(this->IsPlanar) {
+      return;
+    }
+
+    std::size_t channelCount = this->Channels.size();
+    std::uint64_t frameCount = CountFrames();
+    for(std::size_t channelIndex = 0; channelIndex < channelCount; ++channelIndex) {
+      this->Channels[channelIndex].Samples.resize(static_cast<std::size_t>(frameCount));
+    }
+
+    this->IsPlanar = true;
+    DeinterleaveFrames(this->Samples.data(), 0, static_cast<std::size_t>(frameCount));
+
+    SampleBuffer().swap(this->Samples); // clear() would keep the memory allocated
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  void Track::ConvertToInterleaved() {
+    if(!this->IsPlanar) {
+      return;
+    }
+
+    std::size_t channelCount = this->Channels.size();
+    std::uint64_t frameCount = CountFrames();
+
+    this->Samples.resize(static_cast<std::size_t>(frameCount * channelCount));
+    InterleaveFrames(0, static_cast<std::size_t>(frameCount), this->Samples.data());
+
+    this->IsPlanar = false;
+    for(std::size_t channelIndex = 0; channelIndex < channelCount; ++channelIndex) {
+      SampleBuffer().swap(this->Channels[channelIndex].Samples);
+    }
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  void Track::Compact() {
+    if(IsCompact()) {
+      return;
+    }
+
+    std::size_t channelCount = this->Channels.size();
+    std::vector<const float *> channelSamples(channelCount);
+    for(std::size_t channelIndex = 0; channelIndex < channelCount; ++channelIndex) {
+      channelSamples[channelIndex] = GetChannelSamples(channelIndex);
+    }
+
+    // Build the compact store first, the samples can be freed only once it's complete
+    this->CompactSamples.Assign(
+      channelSamples.data(), channelCount, GetSampleStride(), CountFrames()
+    );
+
+    SampleBuffer().swap(this->Samples);
+    for(std::size_t channelIndex = 0; channelIndex < channelCount; ++channelIndex) {
+      SampleBuffer().swap(this->Channels[channelIndex].Samples);
+    }
+    this->IsPlanar = false;
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  void Track::DeinterleaveFrames(
+    const float *source, std::uint64_t startFrameIndex, std::size_t frameCount
+  ) {
+    assert(this->IsPlanar && u8"Frames are deinterleaved into a planar track");
+
+    std::size_t channelCount = this->Channels.size();
+
+    // Going over all interleaved samples once per channel would read the source buffer
+    // from memory channelCount times. In blocks, it stays in the cache for all channels.
+    for(std::size_t blockStart = 0; blockStart < frameCount; blockStart += FramesPerBlock) {
+      std::size_t blockFrameCount = std::min(FramesPerBlock, frameCount - blockStart);
+      for(std::size_t channelIndex = 0; channelIndex < channelCount; ++channelIndex) {
+        const float *read = source + (blockStart * channelCount) + channelIndex;
+        float *write = (
+          this->Channels[channelIndex].Samples.data() + startFrameIndex + blockStart
+        );
+        for(std::size_t index = 0; index < blockFrameCount; ++index) {
+          write[index] = *read;
+          read += channelCount;
+        }
+      } // for each channel
+    } // for each block
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  void Track::InterleaveFrames(
+    std::uint64_t startFrameIndex, std::size_t frameCount, float *target
+  ) const {
+    if(IsCompact()) {
+      this->CompactSamples.InterleaveFrames(startFrameIndex, frameCount, target);
+      return;
+    }
+
+    std::size_t channelCount = this->Channels.size();
+    if(!this->IsPlanar) {
+      std::copy_n(
+        this->Samples.data() + (startFrameIndex * channelCount),
+        frameCount * channelCount,
+        target
+      );
+      return;
+    }
+
+    for(std::size_t blockStart = 0; blockStart < frameCount; blockStart += FramesPerBlock) {
+      std::size_t blockFrameCount = std::min(FramesPerBlock, frameCount - blockStart);
+      for(std::size_t channelIndex = 0; channelIndex < channelCount; ++channelIndex) {
+        const float *read = (
+          this->Channels[channelIndex].Samples.data() + startFrameIndex + blockStart
+        );
+        float *write = target + (blockStart * channelCount) + channelIndex;
+        for(std::size_t index = 0; index < blockFrameCount; ++index) {
+          *write = read[index];
+          write += channelCount;
+        }
+      } // for each channel
+    } // for each block
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  void Track::AdviseAccessPattern(SampleAccessPattern pattern) const {
+    if(this->IsPlanar) {
+      std::size_t channelCount = this->Channels.size();
+      for(std::size_t channelIndex = 0; channelIndex < channelCount; ++channelIndex) {
+        const SampleBuffer &samples = this->Channels[channelIndex].Samples;
+        SampleMemory::Advise(samples.data(), samples.size() * sizeof(float), pattern);
+      }
+    } else {
+      SampleMemory::Advise(
+        this->Samples.data(), this->Samples.size() * sizeof(float), pattern
+      );
     }
   }
 
@@ -60,7 +220,7 @@ namespace Nuclex::OpusTranscoder::Audio {
 
       std::size_t clipCount = this->Channels[channelIndex].ClippingHalfwaves.size();
       for(std::size_t clipIndex = 0; clipIndex < clipCount; ++clipIndex) {
-        ClippingHalfwave &halfwave = this->Channels[channelIndex].ClippingHalfwaves[clipIndex];
+        ClippingHalfwave halfwave = this->Channels[channelIndex].ClippingHalfwaves[clipIndex];
 
         float decibels = DecibelConverter::FromLinearAmplitude(halfwave.PeakAmplitude);
 
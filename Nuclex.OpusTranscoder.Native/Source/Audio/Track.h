@@ -23,9 +23,13 @@ limitations under the License.
 #include "../Config.h"
 
 #include "./Channel.h"
+#include "./TrackStatistics.h"
+#include "./SampleBuffer.h"
+#include "./CompactSampleStore.h"
 
 #include <vector>
 #include <memory> // for std::shared_ptr
+#include <cassert> // for assert()
 
 namespace Nuclex::OpusTranscoder::Audio {
 
@@ -37,9 +41,93 @@ namespace Nuclex::OpusTranscoder::Audio {
     ///<summary>Initializes a new audio track</summary>
     public: Track() :
       Samples(),
+      IsPlanar(false),
+      CompactSamples(),
       Channels(),
+      Statistics(),
       Iteration(0) {}
 
+    /// <summary>Counts the number of frames (samples per channel) in the track</summary>
+    /// <returns>The number of frames stored in the track</returns>
+    public: inline std::uint64_t CountFrames() const;
+
+    /// <summary>Provides a pointer to the first sample of a channel</summary>
+    /// <param name="channelIndex">Index of the channel whose samples will be accessed</param>
+    /// <returns>A pointer to the first sample of the channel</returns>
+    /// <remarks>
+    ///   Samples of the same channel are <see cref="GetSampleStride" /> floats apart.
+    ///   Per-channel algorithms can use these two methods to work on either layout.
+    /// </remarks>
+    public: inline float *GetChannelSamples(std::size_t channelIndex);
+
+    /// <summary>Provides a pointer to the first sample of a channel</summary>
+    /// <param name="channelIndex">Index of the channel whose samples will be accessed</param>
+    /// <returns>A pointer to the first sample of the channel</returns>
+    public: inline const float *GetChannelSamples(std::size_t channelIndex) const;
+
+    /// <summary>Checks whether the samples have been moved into compact storage</summary>
+    /// <returns>True if the samples are held in the compact sample store</returns>
+    /// <remarks>
+    ///   Compacted samples can only be read through <see cref="GetSample" /> and
+    ///   <see cref="InterleaveFrames" />, there is no pointer to them.
+    /// </remarks>
+    public: bool IsCompact() const { return !this->CompactSamples.IsEmpty(); }
+
+    /// <summary>Looks up a single sample in any of the track's layouts</summary>
+    /// <param name="channelIndex">Index of the channel the sample is in</param>
+    /// <param name="frameIndex">Index of the frame the sample belongs to</param>
+    /// <returns>The value of the sample</returns>
+    public: inline float GetSample(std::size_t channelIndex, std::uint64_t frameIndex) const;
+
+    /// <summary>Determines the distance between two samples of the same channel</summary>
+    /// <returns>The number of floats from one sample of a channel to the next</returns>
+    public: inline std::size_t GetSampleStride() const;
+
+    /// <summary>Moves the samples from the interleaved buffer into the channels</summary>
+    /// <remarks>
+    ///   While converting, both layouts exist side by side for a moment, so this
+    ///   temporarily needs twice the memory of the samples.
+    /// </remarks>
+    public: void ConvertToPlanar();
+
+    /// <summary>Moves the samples from the channels into the interleaved buffer</summary>
+    public: void ConvertToInterleaved();
+
+    /// <summary>Moves the samples into lossless, compact read-only storage</summary>
+    /// <remarks>
+    ///   Samples that came from 16 bit or 24 bit PCM and weren't changed since then
+    ///   are kept as integers of that width, everything else is kept as floats.
+    ///   Afterwards, the samples can no longer be modified.
+    /// </remarks>
+    public: void Compact();
+
+    /// <summary>Stores interleaved frames in the channels of a planar track</summary>
+    /// <param name="source">Interleaved samples that will be stored</param>
+    /// <param name="startFrameIndex">Index of the first frame that will be written</param>
+    /// <param name="frameCount">Number of frames that will be written</param>
+    public: void DeinterleaveFrames(
+      const float *source, std::uint64_t startFrameIndex, std::size_t frameCount
+    );
+
+    /// <summary>Copies a range of frames into an interleaved buffer</summary>
+    /// <param name="startFrameIndex">Index of the first frame that will be copied</param>
+    /// <param name="frameCount">Number of frames that will be copied</param>
+    /// <param name="target">Buffer that will receive the interleaved samples</param>
+    /// <remarks>
+    ///   Works for both layouts, so encoders can always consume interleaved chunks.
+    /// </remarks>
+    public: void InterleaveFrames(
+      std::uint64_t startFrameIndex, std::size_t frameCount, float *target
+    ) const;
+
+    /// <summary>Tells the operating system how the samples are going to be accessed</summary>
+    /// <param name="pattern">Way in which the next stage will access the samples</param>
+    /// <remarks>
+    ///   Stages call this before going to work so that samples living in a scratch
+    ///   file are read ahead (or not) in a way that fits their scan pattern.
+    /// </remarks>
+    public: void AdviseAccessPattern(SampleAccessPattern pattern) const;
+
     /// <summary>Copies the clipping data into another track</summary>
     /// <param name="otherTrack">Track the clipping data will be copied into</param>
     public: void CopyClippingHalfwavesInto(
@@ -65,12 +153,21 @@ namespace Nuclex::OpusTranscoder::Audio {
     /// <summary>Prints a summary of all clipping half-waves to stdout</summary>
     public: void DebugOutputAllClippingHalfwaves();
 
-    /// <summary>Stores the decoded samples of all channels</summary>
-    public: std::vector<float> Samples;
+    /// <summary>Stores the decoded samples of all channels, interleaved</summary>
+    /// <remarks>
+    ///   Empty if the track is planar, in which case each channel has its own buffer.
+    /// </remarks>
+    public: SampleBuffer Samples;
+    /// <summary>Whether the samples are stored in the channels instead</summary>
+    public: bool IsPlanar;
+    /// <summary>Holds the samples instead if the track has been compacted</summary>
+    public: CompactSampleStore CompactSamples;
     /// <summary>Samples per second the track plays at</summary>
     public: std::size_t SampleRate;
     /// <summary>Data about the channels and clipping found in each of them</summary>
     public: std::vector<Channel> Channels;
+    /// <summary>Peaks, RMS and clipping blocks, if collected for the current samples</summary>
+    public: TrackStatistics Statistics;
 
     /// <summary>Current iteration the iterative declipper is processing</summary>
     public: std::size_t Iteration;
@@ -79,11 +176,62 @@ namespace Nuclex::OpusTranscoder::Audio {
 
   // ------------------------------------------------------------------------------------------- //
 
+  inline std::uint64_t Track::CountFrames() const {
+    if(this->Channels.empty()) {
+      return 0;
+    } else if(this->IsCompact()) {
+      return this->CompactSamples.CountFrames();
+    } else if(this->IsPlanar) {
+      return this->Channels[0].Samples.size();
+    } else {
+      return this->Samples.size() / this->Channels.size();
+    }
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  inline float *Track::GetChannelSamples(std::size_t channelIndex) {
+    assert(!IsCompact() && u8"Compacted samples can't be accessed through a pointer");
+    if(this->IsPlanar) {
+      return this->Channels[channelIndex].Samples.data();
+    } else {
+      return this->Samples.data() + channelIndex;
+    }
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  inline const float *Track::GetChannelSamples(std::size_t channelIndex) const {
+    assert(!IsCompact() && u8"Compacted samples can't be accessed through a pointer");
+    if(this->IsPlanar) {
+      return this->Channels[channelIndex].Samples.data();
+    } else {
+      return this->Samples.data() + channelIndex;
+    }
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  inline float Track::GetSample(std::size_t channelIndex, std::uint64_t frameIndex) const {
+    if(this->IsCompact()) {
+      return this->CompactSamples.GetSample(channelIndex, frameIndex);
+    } else {
+      return GetChannelSamples(channelIndex)[frameIndex * GetSampleStride()];
+    }
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  inline std::size_t Track::GetSampleStride() const {
+    return this->IsPlanar ? 1 : this->Channels.size();
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
   inline float *Track::SampleAt(std::size_t channelIndex, std::uint64_t sampleIndex) {
     return (
-      this->Samples.data() + // Pointer to start of interleaved sample array
-      channelIndex + // Start at first sample of selected channel
-      (sampleIndex * this->Channels.size()) // Go forward in interleaved samples
+      GetChannelSamples(channelIndex) + // Start at first sample of selected channel
+      (sampleIndex * GetSampleStride()) // Go forward in the channel's samples
     );
   }
 
@@ -91,9 +239,8 @@ namespace Nuclex::OpusTranscoder::Audio {
 
   inline const float *Track::SampleAt(std::size_t channelIndex, std::uint64_t sampleIndex) const {
     return (
-      this->Samples.data() + // Pointer to start of interleaved sample array
-      channelIndex + // Start at first sample of selected channel
-      (sampleIndex * this->Channels.size()) // Go forward in interleaved samples
+      GetChannelSamples(channelIndex) + // Start at first sample of selected channel
+      (sampleIndex * GetSampleStride()) // Go forward in the channel's samples
     );
   }
 
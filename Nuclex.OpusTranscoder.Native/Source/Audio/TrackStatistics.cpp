@@ -0,0 +1,236 @@
+#pragma region Apache License 2.0
+/*
+Nuclex Opus Transcoder
+Copyright (C) 2024 Markus Ewald / Nuclex Development Labs
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#pragma endregion // Apache License 2.0
+
+// If the application is compiled as a DLL, this ensures symbols are exported
+#define NUCLEX_OPUSTRANSCODER_SOURCE 1
+
+#include "./TrackStatistics.h"
+
+#include <cassert> // for assert()
+#include <algorithm> // for std::min(), std::max()
+#include <cmath> // for std::abs(), std::sqrt()
+
+namespace Nuclex::OpusTranscoder::Audio {
+
+  // ------------------------------------------------------------------------------------------- //
+
+  // Same block size the clipping detector checks in one go. Ten milliseconds at 48 kHz,
+  // so a 2 hour movie needs a bitmap of about 85 KiB.
+  const std::size_t TrackStatistics::FramesPerBlock = 512;
+
+  // ------------------------------------------------------------------------------------------- //
+
+  const std::size_t TrackStatistics::NoBassChannel = std::size_t(-1);
+
+  // ------------------------------------------------------------------------------------------- //
+
+  TrackStatistics::TrackStatistics() :
+    channelCount(0),
+    frameCount(0),
+    accumulatedFrameCount(0),
+    bassChannelIndex(NoBassChannel),
+    peakAmplitudes(),
+    squareSums(),
+    clippingBlocks() {}
+
+  // ------------------------------------------------------------------------------------------- //
+
+  void TrackStatistics::Reset(std::size_t channelCount, std::uint64_t frameCount) {
+    this->channelCount = channelCount;
+    this->frameCount = frameCount;
+    this->accumulatedFrameCount = 0;
+    this->bassChannelIndex = NoBassChannel;
+
+    this->peakAmplitudes.assign(channelCount, 0.0f);
+    this->squareSums.assign(channelCount, 0.0);
+
+    std::uint64_t blockCount = (frameCount + FramesPerBlock - 1) / FramesPerBlock;
+    this->clippingBlocks.assign(static_cast<std::size_t>((blockCount + 63) / 64), 0);
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  void TrackStatistics::Clear() {
+    Reset(0, 0);
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  void TrackStatistics::SetBassChannel(std::size_t channelIndex) {
+    assert(
+      ((channelIndex == NoBassChannel) || (channelIndex < this->channelCount)) &&
+      u8"Bass channel is one of the channels the statistics were reset for"
+    );
+
+    this->bassChannelIndex = channelIndex;
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  void TrackStatistics::Accumulate(
+    const float *samples, std::uint64_t startFrameIndex, std::size_t frameCount
+  ) {
+    assert(
+      (startFrameIndex + frameCount <= this->frameCount) &&
+      u8"Accumulated frames lie within the frames the statistics were reset for"
+    );
+
+    std::size_t channelCount = this->channelCount;
+    float *peakAmplitudes = this->peakAmplitudes.data();
+    double *squareSums = this->squareSums.data();
+
+    // Go block by block so that the clipping bit only needs to be set once per block.
+    // Ranges don't have to start or end on a block boundary, a block that is split
+    // between two calls just gets its bit OR'ed twice.
+    std::uint64_t frameIndex = startFrameIndex;
+    std::uint64_t endFrameIndex = startFrameIndex + frameCount;
+    while(frameIndex < endFrameIndex) {
+      std::uint64_t blockIndex = frameIndex / FramesPerBlock;
+      std::uint64_t blockEndIndex = std::min<std::uint64_t>(
+        (blockIndex + 1) * FramesPerBlock, endFrameIndex
+      );
+
+      bool blockClips = false;
+      for(; frameIndex < blockEndIndex; ++frameIndex) {
+        for(std::size_t channelIndex = 0; channelIndex < channelCount; ++channelIndex) {
+          float sample = samples[channelIndex];
+          float amplitude = std::abs(sample);
+          if(peakAmplitudes[channelIndex] < amplitude) {
+            peakAmplitudes[channelIndex] = amplitude;
+          }
+          squareSums[channelIndex] += static_cast<double>(sample) * sample;
+          blockClips |= (1.0f < amplitude);
+        }
+        samples += channelCount;
+      } // for each frame in the block
+
+      if(blockClips) {
+        this->clippingBlocks[static_cast<std::size_t>(blockIndex / 64)] |= (
+          std::uint64_t(1) << (blockIndex % 64)
+        );
+      }
+    } // while frames remain
+
+    this->accumulatedFrameCount += frameCount;
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  void TrackStatistics::AccumulatePlanar(
+    const float *const *channelSamples, std::uint64_t startFrameIndex, std::size_t frameCount
+  ) {
+    assert(
+      (startFrameIndex + frameCount <= this->frameCount) &&
+      u8"Accumulated frames lie within the frames the statistics were reset for"
+    );
+
+    std::size_t channelCount = this->channelCount;
+    float *peakAmplitudes = this->peakAmplitudes.data();
+    double *squareSums = this->squareSums.data();
+
+    // Same as above, but each channel's samples in a block are walked in one run
+    std::uint64_t frameIndex = startFrameIndex;
+    std::uint64_t endFrameIndex = startFrameIndex + frameCount;
+    while(frameIndex < endFrameIndex) {
+      std::uint64_t blockIndex = frameIndex / FramesPerBlock;
+      std::size_t blockFrameCount = static_cast<std::size_t>(
+        std::min<std::uint64_t>((blockIndex + 1) * FramesPerBlock, endFrameIndex) - frameIndex
+      );
+      std::size_t offset = static_cast<std::size_t>(frameIndex - startFrameIndex);
+
+      bool blockClips = false;
+      for(std::size_t channelIndex = 0; channelIndex < channelCount; ++channelIndex) {
+        const float *samples = channelSamples[channelIndex] + offset;
+        float blockPeakAmplitude = 0.0f;
+        double squareSum = 0.0;
+        for(std::size_t index = 0; index < blockFrameCount; ++index) {
+          blockPeakAmplitude = std::max(blockPeakAmplitude, std::abs(samples[index]));
+          squareSum += static_cast<double>(samples[index]) * samples[index];
+        }
+        blockClips |= (1.0f < blockPeakAmplitude);
+        if(peakAmplitudes[channelIndex] < blockPeakAmplitude) {
+          peakAmplitudes[channelIndex] = blockPeakAmplitude;
+        }
+        squareSums[channelIndex] += squareSum;
+      } // for each channel
+
+      if(blockClips) {
+        this->clippingBlocks[static_cast<std::size_t>(blockIndex / 64)] |= (
+          std::uint64_t(1) << (blockIndex % 64)
+        );
+      }
+
+      frameIndex += blockFrameCount;
+    } // while frames remain
+
+    this->accumulatedFrameCount += frameCount;
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  bool TrackStatistics::Covers(std::size_t channelCount, std::uint64_t frameCount) const {
+    return (
+      (this->channelCount != 0) &&
+      (this->channelCount == channelCount) &&
+      (this->frameCount == frameCount) &&
+      (this->accumulatedFrameCount == frameCount)
+    );
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  float TrackStatistics::GetRootMeanSquare(std::size_t channelIndex) const {
+    if(this->accumulatedFrameCount == 0) {
+      return 0.0f;
+    }
+
+    return static_cast<float>(
+      std::sqrt(
+        this->squareSums[channelIndex] / static_cast<double>(this->accumulatedFrameCount)
+      )
+    );
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  bool TrackStatistics::MayContainClipping(
+    std::uint64_t startFrameIndex, std::uint64_t endFrameIndex
+  ) const {
+    if(endFrameIndex <= startFrameIndex) {
+      return false;
+    }
+
+    std::uint64_t lastBlockIndex = (endFrameIndex - 1) / FramesPerBlock;
+    for(
+      std::uint64_t blockIndex = startFrameIndex / FramesPerBlock;
+      blockIndex <= lastBlockIndex;
+      ++blockIndex
+    ) {
+      std::uint64_t bits = this->clippingBlocks[static_cast<std::size_t>(blockIndex / 64)];
+      if((bits & (std::uint64_t(1) << (blockIndex % 64))) != 0) {
+        return true;
+      }
+    }
+
+    return false;
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+} // namespace Nuclex::OpusTranscoder::Audio
@@ -0,0 +1,164 @@
+#pragma region Apache License 2.0
+/*
+Nuclex Opus Transcoder
+Copyright (C) 2024 Markus Ewald / Nuclex Development Labs
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#pragma endregion // Apache License 2.0
+
+#ifndef NUCLEX_OPUSTRANSCODER_AUDIO_TRACKSTATISTICS_H
+#define NUCLEX_OPUSTRANSCODER_AUDIO_TRACKSTATISTICS_H
+
+#include "../Config.h"
+
+#include <vector> // for std::vector
+#include <cstdint> // for std::uint64_t
+
+namespace Nuclex::OpusTranscoder::Audio {
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Statistics about the samples of a track, gathered while writing them</summary>
+  /// <remarks>
+  ///   <para>
+  ///     Going over a track that doesn't fit in the cache is mostly waiting for memory.
+  ///     When the samples are collected right after they have been decoded or mixed,
+  ///     they still are in the cache and the statistics come almost for free. Later
+  ///     stages can then use them instead of doing their own scan of the track.
+  ///   </para>
+  ///   <para>
+  ///     Statistics describe the samples as they were when they were collected. Any
+  ///     code changing the samples of a track has to clear or re-collect them.
+  ///   </para>
+  /// </remarks>
+  class TrackStatistics {
+
+    /// <summary>Number of frames covered by each bit in the clipping bitmap</summary>
+    public: static const std::size_t FramesPerBlock;
+    /// <summary>Channel index reported when no channel carries the bass</summary>
+    public: static const std::size_t NoBassChannel;
+
+    /// <summary>Initializes new, empty statistics that don't cover any samples</summary>
+    public: TrackStatistics();
+
+    /// <summary>Prepares for collecting the statistics of a track anew</summary>
+    /// <param name="channelCount">Number of interleaved channels in the track</param>
+    /// <param name="frameCount">Number of frames the statistics will be collected for</param>
+    public: void Reset(std::size_t channelCount, std::uint64_t frameCount);
+
+    /// <summary>Throws away the statistics, so that they don't cover any samples</summary>
+    public: void Clear();
+
+    /// <summary>Marks the channel that carries the low frequency effects</summary>
+    /// <param name="channelIndex">
+    ///   Index of the bass channel or <see cref="NoBassChannel" /> if there is none
+    /// </param>
+    /// <remarks>
+    ///   Resetting the statistics forgets the bass channel, because whoever changes the
+    ///   samples usually also changes the channel layout. It can be marked at any time
+    ///   until then, the peak of each channel is collected either way.
+    /// </remarks>
+    public: void SetBassChannel(std::size_t channelIndex);
+
+    /// <summary>Adds a range of interleaved samples to the statistics</summary>
+    /// <param name="samples">Interleaved samples of the first frame in the range</param>
+    /// <param name="startFrameIndex">Index of the first frame in the range</param>
+    /// <param name="frameCount">Number of frames in the range</param>
+    /// <remarks>
+    ///   Ranges can be added in any order, but each frame must be added only once.
+    /// </remarks>
+    public: void Accumulate(
+      const float *samples, std::uint64_t startFrameIndex, std::size_t frameCount
+    );
+
+    /// <summary>Adds a range of planar samples to the statistics</summary>
+    /// <param name="channelSamples">
+    ///   One pointer for each channel to the sample of the first frame in the range
+    /// </param>
+    /// <param name="startFrameIndex">Index of the first frame in the range</param>
+    /// <param name="frameCount">Number of frames in the range</param>
+    /// <remarks>
+    ///   Ranges can be added in any order, but each frame must be added only once.
+    /// </remarks>
+    public: void AccumulatePlanar(
+      const float *const *channelSamples, std::uint64_t startFrameIndex, std::size_t frameCount
+    );
+
+    /// <summary>Checks whether the statistics cover all samples of a track</summary>
+    /// <param name="channelCount">Number of interleaved channels in the track</param>
+    /// <param name="frameCount">Number of frames in the track</param>
+    /// <returns>True if the statistics were collected for the entire track</returns>
+    public: bool Covers(std::size_t channelCount, std::uint64_t frameCount) const;
+
+    /// <summary>Looks up the highest absolute amplitude seen in a channel</summary>
+    /// <param name="channelIndex">Index of the channel whose peak will be returned</param>
+    /// <returns>The highest absolute amplitude in the channel</returns>
+    public: float GetPeakAmplitude(std::size_t channelIndex) const {
+      return this->peakAmplitudes[channelIndex];
+    }
+
+    /// <summary>Looks up the index of the channel that carries the bass</summary>
+    /// <returns>
+    ///   The index of the bass channel or <see cref="NoBassChannel" /> if there is none
+    /// </returns>
+    public: std::size_t GetBassChannelIndex() const { return this->bassChannelIndex; }
+
+    /// <summary>Looks up the highest absolute amplitude seen in the bass channel</summary>
+    /// <returns>The highest absolute amplitude in the bass channel or 0 without one</returns>
+    public: float GetBassPeakAmplitude() const {
+      if(this->bassChannelIndex == NoBassChannel) {
+        return 0.0f;
+      } else {
+        return this->peakAmplitudes[this->bassChannelIndex];
+      }
+    }
+
+    /// <summary>Calculates the root mean square (average power) of a channel</summary>
+    /// <param name="channelIndex">Index of the channel whose RMS will be returned</param>
+    /// <returns>The root mean square of all samples in the channel</returns>
+    public: float GetRootMeanSquare(std::size_t channelIndex) const;
+
+    /// <summary>Checks if any sample in a range of frames goes above 1.0</summary>
+    /// <param name="startFrameIndex">Index of the first frame in the range</param>
+    /// <param name="endFrameIndex">Index one past the last frame in the range</param>
+    /// <returns>
+    ///   True if a block overlapping the range contains samples above 1.0 or below -1.0.
+    ///   Blocks are coarse, so this can be true even if the range itself doesn't clip.
+    /// </returns>
+    public: bool MayContainClipping(
+      std::uint64_t startFrameIndex, std::uint64_t endFrameIndex
+    ) const;
+
+    /// <summary>Number of interleaved channels the statistics were collected for</summary>
+    private: std::size_t channelCount;
+    /// <summary>Number of frames the statistics are being collected for</summary>
+    private: std::uint64_t frameCount;
+    /// <summary>Number of frames that have been added to the statistics so far</summary>
+    private: std::uint64_t accumulatedFrameCount;
+    /// <summary>Index of the channel carrying the bass, if any</summary>
+    private: std::size_t bassChannelIndex;
+    /// <summary>Highest absolute amplitude seen in each channel</summary>
+    private: std::vector<float> peakAmplitudes;
+    /// <summary>Sum of the squared samples of each channel</summary>
+    private: std::vector<double> squareSums;
+    /// <summary>One bit for each block of frames, set if any sample in it clips</summary>
+    private: std::vector<std::uint64_t> clippingBlocks;
+
+  };
+
+  // ------------------------------------------------------------------------------------------- //
+
+} // namespace Nuclex::OpusTranscoder::Audio
+
+#endif // NUCLEX_OPUSTRANSCODER_AUDIO_TRACKSTATISTICS_H
@@ -0,0 +1,436 @@
+#pragma region Apache License 2.0
+/*
+Nuclex Opus Transcoder
+Copyright (C) 2024 Markus Ewald / Nuclex Development Labs
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#pragma endregion // Apache License 2.0
+
+// If the application is compiled as a DLL, this ensures symbols are exported
+#define NUCLEX_OPUSTRANSCODER_SOURCE 1
+
+#include "./TruePeakDetector.h"
+#include "./WorkPartitioner.h"
+
+#include <Nuclex/Support/Threading/ThreadPool.h>
+
+#include <cassert> // for assert()
+#include <algorithm> // for std::max()
+#include <atomic> // for std::atomic
+#include <cmath> // for std::sin(), std::cos(), std::log2(), std::pow(), std::abs()
+#include <future> // for std::future
+#include <functional> // for std::ref()
+
+namespace {
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Number of points per sample interval the true peak is checked at</summary>
+  /// <remarks>
+  ///   Four times oversampling is what ITU-R BS.1770 uses for true peak metering. It can
+  ///   underestimate a peak by up to about 0.7 dB, which is well within the headroom.
+  /// </remarks>
+  const std::size_t PhaseCount = 4;
+
+  /// <summary>Number of samples on each side the interpolation filter looks at</summary>
+  const std::size_t TapsPerSide = 8;
+
+  /// <summary>Total number of samples the interpolation filter looks at</summary>
+  const std::size_t TapCount = TapsPerSide * 2;
+
+  /// <summary>Number of frames after which progress is reported to the caller</summary>
+  const std::size_t ProgressReportFrameCount = 16384;
+
+  /// <summary>How far a true peak is assumed to lie above the samples around it</summary>
+  /// <remarks>
+  ///   Only sample intervals whose samples reach the ceiling when scaled by this factor
+  ///   (+6 dB) and the headroom are interpolated. Real inter-sample peaks rarely exceed
+  ///   +3 dB, so this skips the expensive part for nearly all samples of a track.
+  /// </remarks>
+  const float ScreeningFactor = 2.0f;
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Overshoot observed from Opus at a certain bitrate per channel</summary>
+  struct OvershootPoint {
+
+    /// <summary>Bitrate available to each channel in kilobits per second</summary>
+    public: float KilobitsPerChannel;
+    /// <summary>Typical amount by which the decoded peaks exceed the input</summary>
+    public: float Decibels;
+
+  };
+
+  /// <summary>Typical Opus overshoot at different bitrates, ordered by bitrate</summary>
+  const OvershootPoint OpusOvershootModel[] = {
+    {   8.0f, 3.0f },
+    {  16.0f, 2.0f },
+    {  32.0f, 1.2f },
+    {  48.0f, 0.8f },
+    {  64.0f, 0.6f },
+    {  96.0f, 0.4f },
+    { 128.0f, 0.3f },
+    { 256.0f, 0.15f }
+  };
+
+  /// <summary>Number of points in the Opus overshoot model</summary>
+  const std::size_t OpusOvershootPointCount = (
+    sizeof(OpusOvershootModel) / sizeof(OpusOvershootModel[0])
+  );
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Coefficients of the filters calculating the points between samples</summary>
+  struct InterpolationFilter {
+
+    /// <summary>Initializes the coefficients as a Blackman-windowed sinc filter</summary>
+    public: InterpolationFilter() {
+      const double pi = 3.14159265358979323846;
+
+      for(std::size_t phaseIndex = 1; phaseIndex < PhaseCount; ++phaseIndex) {
+        double fraction = static_cast<double>(phaseIndex) / static_cast<double>(PhaseCount);
+        float *coefficients = this->Coefficients[phaseIndex - 1];
+
+        double sum = 0.0;
+        for(std::size_t tapIndex = 0; tapIndex < TapCount; ++tapIndex) {
+          double distance = fraction - (
+            static_cast<double>(tapIndex) - static_cast<double>(TapsPerSide - 1)
+          );
+
+          double sinc = std::sin(pi * distance) / (pi * distance);
+          double window = (
+            0.42 +
+            0.5 * std::cos(pi * distance / static_cast<double>(TapsPerSide)) +
+            0.08 * std::cos(2.0 * pi * distance / static_cast<double>(TapsPerSide))
+          );
+
+          coefficients[tapIndex] = static_cast<float>(sinc * window);
+          sum += sinc * window;
+        } // for each tap
+
+        // Normalize the filter so a constant signal stays at the same level
+        for(std::size_t tapIndex = 0; tapIndex < TapCount; ++tapIndex) {
+          coefficients[tapIndex] = static_cast<float>(coefficients[tapIndex] / sum);
+        }
+      } // for each phase between two samples
+    }
+
+    /// <summary>Filter coefficients for each point between two samples</summary>
+    public: float Coefficients[PhaseCount - 1][TapCount];
+
+  };
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Provides the interpolation filter shared by all scans</summary>
+  /// <returns>The interpolation filter</returns>
+  const InterpolationFilter &getInterpolationFilter() {
+    static const InterpolationFilter filter; // thread-safe since C++11
+    return filter;
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Calculates the signal level at a point between two samples</summary>
+  /// <param name="channelSamples">Samples of the channel that will be interpolated</param>
+  /// <param name="sampleStride">Distance from one sample of the channel to the next</param>
+  /// <param name="frameCount">Number of frames in the channel</param>
+  /// <param name="sampleIndex">Index of the sample after which the point lies</param>
+  /// <param name="coefficients">Filter coefficients for the point's position</param>
+  /// <returns>The interpolated signal level at the point</returns>
+  float interpolate(
+    const float *channelSamples, std::size_t sampleStride, std::uint64_t frameCount,
+    std::uint64_t sampleIndex, const float *coefficients
+  ) {
+    float result = 0.0f;
+
+    // Near the beginning and end of the channel, the filter reaches beyond the samples.
+    // Those are treated as silence, which is what the encoder will see, too.
+    bool isInside = (
+      (sampleIndex >= TapsPerSide - 1) && (sampleIndex + TapsPerSide < frameCount)
+    );
+    if(likely(isInside)) {
+      const float *read = channelSamples + ((sampleIndex - (TapsPerSide - 1)) * sampleStride);
+      for(std::size_t tapIndex = 0; tapIndex < TapCount; ++tapIndex) {
+        result += coefficients[tapIndex] * read[0];
+        read += sampleStride;
+      }
+    } else {
+      for(std::size_t tapIndex = 0; tapIndex < TapCount; ++tapIndex) {
+        if(sampleIndex + tapIndex < TapsPerSide - 1) {
+          continue; // before the start of the channel
+        }
+
+        std::uint64_t tapSampleIndex = sampleIndex + tapIndex - (TapsPerSide - 1);
+        if(tapSampleIndex < frameCount) {
+          result += coefficients[tapIndex] * channelSamples[tapSampleIndex * sampleStride];
+        }
+      }
+    }
+
+    return result;
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Records the half-waves of one channel whose predicted peak clips</summary>
+  /// <param name="track">Track that will be scanned for clipping half-waves</param>
+  /// <param name="channelIndex">Index of the channel that will be scanned</param>
+  /// <param name="headroomFactor">Factor by which true peaks will be scaled</param>
+  /// <param name="canceler">Token by which the operation can be signalled to cancel</param>
+  /// <param name="scannedFrameCount">Counter that will be advanced while scanning</param>
+  void findPredictedHalfwavesInChannel(
+    const std::shared_ptr<Nuclex::OpusTranscoder::Audio::Track> &track,
+    std::size_t channelIndex,
+    float headroomFactor,
+    const std::shared_ptr<const Nuclex::Support::Threading::StopToken> &canceler,
+    std::atomic<std::uint64_t> &scannedFrameCount
+  ) {
+    using Nuclex::OpusTranscoder::Audio::ClippingHalfwave;
+    using Nuclex::OpusTranscoder::Audio::ClippingHalfwaveTable;
+
+    const InterpolationFilter &filter = getInterpolationFilter();
+
+    std::uint64_t frameCount = track->CountFrames();
+    std::size_t sampleStride = track->GetSampleStride();
+    const float *channelSamples = track->GetChannelSamples(channelIndex);
+
+    ClippingHalfwaveTable halfwaves;
+    if(frameCount == 0) {
+      track->Channels[channelIndex].ClippingHalfwaves.Swap(halfwaves);
+      return;
+    }
+
+    float screeningThreshold = 1.0f / (headroomFactor * ScreeningFactor);
+
+    std::uint64_t halfwaveStartIndex = 0;
+    bool isBelowZero = (channelSamples[0] < 0.0f);
+    float halfwavePeak = 0.0f;
+    std::uint64_t halfwavePeakIndex = 0;
+
+    // An inter-sample peak between the last sample of one half-wave and the first of
+    // the next can be on the side of the next half-wave. It's held here until then.
+    float carriedPeak = 0.0f;
+
+    for(std::uint64_t index = 0; index < frameCount; ++index) {
+      float sample = channelSamples[index * sampleStride];
+
+      // When the signal crosses the zero line, the current half-wave is complete
+      bool sampleIsBelowZero = (sample < 0.0f);
+      if(sampleIsBelowZero != isBelowZero) {
+        if(1.0f < halfwavePeak * headroomFactor) {
+          halfwaves.push_back(
+            ClippingHalfwave(
+              halfwaveStartIndex, halfwavePeakIndex, index, halfwavePeak * headroomFactor
+            )
+          );
+        }
+
+        halfwaveStartIndex = index;
+        isBelowZero = sampleIsBelowZero;
+        halfwavePeak = carriedPeak;
+        halfwavePeakIndex = index;
+        carriedPeak = 0.0f;
+      }
+
+      float magnitude = std::abs(sample);
+      if(halfwavePeak < magnitude) {
+        halfwavePeak = magnitude;
+        halfwavePeakIndex = index;
+      }
+
+      // Only look between this sample and the next if either is loud enough that
+      // an inter-sample peak could possibly reach the ceiling
+      float nextSample = 0.0f;
+      if(index + 1 < frameCount) {
+        nextSample = channelSamples[(index + 1) * sampleStride];
+      }
+      if(screeningThreshold < std::max(magnitude, std::abs(nextSample))) {
+        for(std::size_t phaseIndex = 1; phaseIndex < PhaseCount; ++phaseIndex) {
+          float point = interpolate(
+            channelSamples, sampleStride, frameCount, index,
+            filter.Coefficients[phaseIndex - 1]
+          );
+          if((point < 0.0f) == isBelowZero) {
+            if(halfwavePeak < std::abs(point)) {
+              halfwavePeak = std::abs(point);
+              halfwavePeakIndex = index;
+            }
+          } else if((nextSample < 0.0f) != isBelowZero) {
+            carriedPeak = std::max(carriedPeak, std::abs(point));
+          }
+        } // for each point between this sample and the next
+      }
+
+      if(((index + 1) % ProgressReportFrameCount) == 0) {
+        canceler->ThrowIfCanceled();
+        scannedFrameCount.fetch_add(ProgressReportFrameCount, std::memory_order_relaxed);
+      }
+    } // for each sample in the channel
+
+    if(1.0f < halfwavePeak * headroomFactor) {
+      halfwaves.push_back(
+        ClippingHalfwave(
+          halfwaveStartIndex, halfwavePeakIndex, frameCount, halfwavePeak * headroomFactor
+        )
+      );
+    }
+
+    scannedFrameCount.fetch_add(frameCount % ProgressReportFrameCount, std::memory_order_relaxed);
+
+    // This replaces any clipping instances from previous runs of the scan
+    track->Channels[channelIndex].ClippingHalfwaves.Swap(halfwaves);
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+} // anonymous namespace
+
+namespace Nuclex::OpusTranscoder::Audio {
+
+  // ------------------------------------------------------------------------------------------- //
+
+  // Four points per sample interval. This is what ITU-R BS.1770 recommends for measuring
+  // true peaks at 48 kHz. Opus files are always decoded at 48 kHz.
+  const std::size_t TruePeakDetector::OversamplingFactor = PhaseCount;
+
+  // ------------------------------------------------------------------------------------------- //
+
+  float TruePeakDetector::EstimateOpusOvershoot(
+    float bitrateInKilobits, std::size_t channelCount
+  ) {
+    float kilobitsPerChannel = bitrateInKilobits / static_cast<float>(std::max<std::size_t>(
+      channelCount, 1
+    ));
+
+    // Interpolate between the points of the model on a logarithmic bitrate scale,
+    // keeping the overshoots at either end for bitrates outside of the model's range
+    float decibels;
+    if(kilobitsPerChannel <= OpusOvershootModel[0].KilobitsPerChannel) {
+      decibels = OpusOvershootModel[0].Decibels;
+    } else if(
+      kilobitsPerChannel >= OpusOvershootModel[OpusOvershootPointCount - 1].KilobitsPerChannel
+    ) {
+      decibels = OpusOvershootModel[OpusOvershootPointCount - 1].Decibels;
+    } else {
+      std::size_t index = 1;
+      while(OpusOvershootModel[index].KilobitsPerChannel < kilobitsPerChannel) {
+        ++index;
+      }
+
+      const OvershootPoint &lower = OpusOvershootModel[index - 1];
+      const OvershootPoint &upper = OpusOvershootModel[index];
+      float position = (
+        (std::log2(kilobitsPerChannel) - std::log2(lower.KilobitsPerChannel)) /
+        (std::log2(upper.KilobitsPerChannel) - std::log2(lower.KilobitsPerChannel))
+      );
+      decibels = lower.Decibels + (upper.Decibels - lower.Decibels) * position;
+    }
+
+    return std::pow(10.0f, decibels / 20.0f);
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  float TruePeakDetector::MeasureTruePeak(
+    const Track &track, std::size_t channelIndex, std::uint64_t sampleIndex
+  ) {
+    assert((sampleIndex < track.CountFrames()) && u8"Sample index lies within the track");
+
+    const InterpolationFilter &filter = getInterpolationFilter();
+
+    std::uint64_t frameCount = track.CountFrames();
+    std::size_t sampleStride = track.GetSampleStride();
+    const float *channelSamples = track.GetChannelSamples(channelIndex);
+
+    float peak = std::abs(channelSamples[sampleIndex * sampleStride]);
+    for(std::size_t phaseIndex = 1; phaseIndex < PhaseCount; ++phaseIndex) {
+      float point = interpolate(
+        channelSamples, sampleStride, frameCount, sampleIndex,
+        filter.Coefficients[phaseIndex - 1]
+      );
+      peak = std::max(peak, std::abs(point));
+    }
+
+    return peak;
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  void TruePeakDetector::FindPredictedClippingHalfwaves(
+    const std::shared_ptr<Track> &track,
+    float headroomFactor,
+    const std::shared_ptr<const Nuclex::Support::Threading::StopToken> &canceler,
+    Nuclex::Support::Events::Delegate<void(float)> &progressCallback
+  ) {
+    track->AdviseAccessPattern(SampleAccessPattern::Sequential); // one pass front to back
+
+    std::size_t channelCount = track->Channels.size();
+
+    std::atomic<std::uint64_t> scannedFrameCount(0);
+    for(std::size_t channelIndex = 0; channelIndex < channelCount; ++channelIndex) {
+      findPredictedHalfwavesInChannel(
+        track, channelIndex, headroomFactor, canceler, scannedFrameCount
+      );
+      progressCallback(
+        static_cast<float>(channelIndex + 1) / static_cast<float>(channelCount)
+      );
+    }
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  void TruePeakDetector::FindPredictedClippingHalfwaves(
+    const std::shared_ptr<Track> &track,
+    float headroomFactor,
+    Nuclex::Support::Threading::ThreadPool &threadPool,
+    const std::shared_ptr<const Nuclex::Support::Threading::StopToken> &canceler,
+    Nuclex::Support::Events::Delegate<void(float)> &progressCallback
+  ) {
+    track->AdviseAccessPattern(SampleAccessPattern::Sequential); // each job scans forward
+
+    std::size_t channelCount = track->Channels.size();
+    std::uint64_t totalFrameCount = track->CountFrames() * channelCount;
+
+    // Each channel only writes to its own list of half-waves, so the channels
+    // can be scanned independently of each other without any synchronization.
+    std::atomic<std::uint64_t> scannedFrameCount(0);
+    std::vector<std::future<void>> futures;
+    futures.reserve(channelCount);
+    try {
+      for(std::size_t channelIndex = 0; channelIndex < channelCount; ++channelIndex) {
+        futures.push_back(
+          threadPool.Schedule(
+            &findPredictedHalfwavesInChannel,
+            track, channelIndex, headroomFactor, canceler, std::ref(scannedFrameCount)
+          )
+        );
+      }
+    }
+    catch(const std::exception &) {
+      WorkPartitioner::WaitForAll(futures); // they reference our counter
+      throw;
+    }
+
+    WorkPartitioner::WaitForAll(futures, scannedFrameCount, totalFrameCount, progressCallback);
+    for(std::size_t channelIndex = 0; channelIndex < channelCount; ++channelIndex) {
+      futures[channelIndex].get(); // rethrows errors from the channel's job
+    }
+
+    progressCallback(1.0f);
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+} // namespace Nuclex::OpusTranscoder::Audio
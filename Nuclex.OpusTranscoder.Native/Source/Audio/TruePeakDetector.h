@@ -0,0 +1,129 @@
+#pragma region Apache License 2.0
+/*
+Nuclex Opus Transcoder
+Copyright (C) 2024 Markus Ewald / Nuclex Development Labs
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#pragma endregion // Apache License 2.0
+
+#ifndef NUCLEX_OPUSTRANSCODER_AUDIO_TRUEPEAKDETECTOR_H
+#define NUCLEX_OPUSTRANSCODER_AUDIO_TRUEPEAKDETECTOR_H
+
+#include "../Config.h"
+#include "./Track.h"
+
+#include <Nuclex/Support/Threading/StopToken.h>
+#include <Nuclex/Support/Events/Delegate.h>
+
+#include <memory> // for std::shared_ptr
+
+namespace Nuclex::Support::Threading {
+
+  // ------------------------------------------------------------------------------------------- //
+
+  class ThreadPool;
+
+  // ------------------------------------------------------------------------------------------- //
+
+} // namespace Nuclex::Support::Threading
+
+namespace Nuclex::OpusTranscoder::Audio {
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Predicts which half-waves will clip after encoding from their true peaks</summary>
+  /// <remarks>
+  ///   <para>
+  ///     The peak a decoder reconstructs between two samples can lie above both of them
+  ///     (an inter-sample or "true" peak), and lossy codecs add some overshoot on top.
+  ///     This detector measures the true peak of each half-wave by oversampling the track
+  ///     and multiplies it with a headroom factor modelling the codec's overshoot.
+  ///   </para>
+  ///   <para>
+  ///     Each half-wave whose predicted peak exceeds the signal ceiling is recorded with
+  ///     the predicted peak as its peak amplitude, so tucking the half-waves in once makes
+  ///     room for the expected overshoot before the track has even been encoded.
+  ///   </para>
+  /// </remarks>
+  class TruePeakDetector {
+
+    /// <summary>Factor by which the samples are oversampled to find true peaks</summary>
+    public: static const std::size_t OversamplingFactor;
+
+    /// <summary>Estimates by how much Opus will typically overshoot the input signal</summary>
+    /// <param name="bitrateInKilobits">Bitrate the track will be encoded at</param>
+    /// <param name="channelCount">Number of channels sharing the bitrate</param>
+    /// <returns>The estimated overshoot as a linear amplitude factor</returns>
+    /// <remarks>
+    ///   These are rough typical values. Lower bitrates per channel leave the codec
+    ///   less room to reproduce the waveform accurately, so the overshoot grows.
+    /// </remarks>
+    public: static float EstimateOpusOvershoot(float bitrateInKilobits, std::size_t channelCount);
+
+    /// <summary>Measures the true peak around a sample in a channel</summary>
+    /// <param name="track">Track containing the channel that will be measured</param>
+    /// <param name="channelIndex">Index of the channel that will be measured</param>
+    /// <param name="sampleIndex">Index of the sample after which the interval begins</param>
+    /// <returns>
+    ///   The highest absolute amplitude at the sample or at any of the oversampled
+    ///   points between it and the next sample
+    /// </returns>
+    public: static float MeasureTruePeak(
+      const Track &track, std::size_t channelIndex, std::uint64_t sampleIndex
+    );
+
+    /// <summary>Records all half-waves whose predicted peak exceeds the signal ceiling</summary>
+    /// <param name-"track">Track that will be scanned for clipping half-waves</param>
+    /// <param name="headroomFactor">
+    ///   Factor by which the true peaks will be scaled to predict the decoded peaks
+    /// </param>
+    /// <param name="canceler">Token by which the operation can be signalled to cancel</param>
+    /// <param name="progressCallback">Callback to which progress reports should be sent</param>
+    /// <remarks>
+    ///   Like <see cref="ClippingDetector::FindClippingHalfwaves" />, this replaces any
+    ///   clipping half-waves that were recorded in the track before.
+    /// </remarks>
+    public: static void FindPredictedClippingHalfwaves(
+      const std::shared_ptr<Track> &track,
+      float headroomFactor,
+      const std::shared_ptr<const Nuclex::Support::Threading::StopToken> &canceler,
+      Nuclex::Support::Events::Delegate<void(float)> &progressCallback
+    );
+
+    /// <summary>
+    ///   Records all half-waves whose predicted peak exceeds the signal ceiling, with
+    ///   each channel being processed by one thread of a thread pool
+    /// </summary>
+    /// <param name-"track">Track that will be scanned for clipping half-waves</param>
+    /// <param name="headroomFactor">
+    ///   Factor by which the true peaks will be scaled to predict the decoded peaks
+    /// </param>
+    /// <param name="threadPool">Thread pool on which the channels will be processed</param>
+    /// <param name="canceler">Token by which the operation can be signalled to cancel</param>
+    /// <param name="progressCallback">Callback to which progress reports should be sent</param>
+    public: static void FindPredictedClippingHalfwaves(
+      const std::shared_ptr<Track> &track,
+      float headroomFactor,
+      Nuclex::Support::Threading::ThreadPool &threadPool,
+      const std::shared_ptr<const Nuclex::Support::Threading::StopToken> &canceler,
+      Nuclex::Support::Events::Delegate<void(float)> &progressCallback
+    );
+
+  };
+
+  // ------------------------------------------------------------------------------------------- //
+
+} // namespace Nuclex::OpusTranscoder::Audio
+
+#endif // NUCLEX_OPUSTRANSCODER_AUDIO_TRUEPEAKDETECTOR_H
@@ -0,0 +1,106 @@
+#pragma region Apache License 2.0
+/*
+Nuclex Opus Transcoder
+Copyright (C) 2024 Markus Ewald / Nuclex Development Labs
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#pragma endregion // Apache License 2.0
+
+// If the application is compiled as a DLL, this ensures symbols are exported
+#define NUCLEX_OPUSTRANSCODER_SOURCE 1
+
+#include "./WordHash.h"
+
+#include <cstring> // for std::memcpy()
+
+namespace {
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>The 64 bit FNV prime each added word is multiplied with</summary>
+  const std::uint64_t FnvPrime = 0x100000001b3ULL;
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Adds one word to a hash and folds the upper half back in</summary>
+  /// <param name="hash">Hash of all words before this one</param>
+  /// <param name="word">Word that will be added to the hash</param>
+  /// <returns>The hash including the specified word</returns>
+  inline std::uint64_t hashWord(std::uint64_t hash, std::uint64_t word) {
+    hash = (hash ^ word) * FnvPrime;
+    return hash ^ (hash >> 32);
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+} // anonymous namespace
+
+namespace Nuclex::OpusTranscoder::Audio {
+
+  // ------------------------------------------------------------------------------------------- //
+
+  // This is the 64 bit FNV offset basis
+  const std::uint64_t WordHash::InitialHash = 0xcbf29ce484222325ULL;
+
+  // ------------------------------------------------------------------------------------------- //
+
+  std::uint64_t WordHash::HashValue(std::uint64_t hash, std::uint64_t value) {
+    return (hash ^ value) * FnvPrime;
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  std::uint64_t WordHash::HashBytes(
+    std::uint64_t hash, const std::byte *bytes, std::size_t byteCount
+  ) {
+
+    // Input files can be gigabytes in size, so they're hashed eight bytes at a time
+    while(byteCount >= sizeof(std::uint64_t)) {
+      std::uint64_t word;
+      std::memcpy(&word, bytes, sizeof(word));
+      hash = hashWord(hash, word);
+
+      bytes += sizeof(word);
+      byteCount -= sizeof(word);
+    }
+
+    // Hash any trailing bytes that don't form a whole word one by one
+    while(byteCount > 0) {
+      hash = HashValue(hash, std::to_integer<std::uint64_t>(*bytes));
+      ++bytes;
+      --byteCount;
+    }
+
+    return hash;
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  std::uint64_t WordHash::HashSamples(
+    std::uint64_t hash, const float *samples, std::size_t sampleCount
+  ) {
+    for(std::size_t index = 0; index < sampleCount; ++index) {
+      std::uint32_t bits;
+      std::memcpy(&bits, samples + index, sizeof(bits));
+
+      // Hashing whole samples instead of bytes needs a quarter of the multiplications
+      hash = hashWord(hash, bits);
+    }
+
+    return hash;
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+} // namespace Nuclex::OpusTranscoder::Audio
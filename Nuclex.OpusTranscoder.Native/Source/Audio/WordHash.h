@@ -0,0 +1,85 @@
+#pragma region Apache License 2.0
+/*
+Nuclex Opus Transcoder
+Copyright (C) 2024 Markus Ewald / Nuclex Development Labs
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#pragma endregion // Apache License 2.0
+
+#ifndef NUCLEX_OPUSTRANSCODER_AUDIO_WORDHASH_H
+#define NUCLEX_OPUSTRANSCODER_AUDIO_WORDHASH_H
+
+#include "../Config.h"
+
+#include <cstddef> // for std::byte, std::size_t
+#include <cstdint> // for std::uint64_t
+
+namespace Nuclex::OpusTranscoder::Audio {
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Fast non-cryptographic hash used to recognize inputs seen before</summary>
+  /// <remarks>
+  ///   <para>
+  ///     This is a variant of FNV-1a that consumes whole words instead of single bytes,
+  ///     folding the upper half of the hash back in after each word so the low bits
+  ///     don't just depend on the last few words. Both the output cache and the half-wave
+  ///     map cache key their entries by it, so its results must not change between
+  ///     versions without also changing the format versions of those caches.
+  ///   </para>
+  ///   <para>
+  ///     Hashes can be continued, so hashing data in pieces gives the same result as
+  ///     hashing it all at once, as long as the pieces split it between whole words.
+  ///   </para>
+  /// </remarks>
+  class WordHash {
+
+    /// <summary>Value a hash should start out with</summary>
+    public: static const std::uint64_t InitialHash;
+
+    /// <summary>Adds a single value to a hash</summary>
+    /// <param name="hash">Hash of everything before the value</param>
+    /// <param name="value">Value that will be added to the hash</param>
+    /// <returns>The hash including the specified value</returns>
+    public: static std::uint64_t HashValue(std::uint64_t hash, std::uint64_t value);
+
+    /// <summary>Continues a hash over a number of bytes</summary>
+    /// <param name="hash">Hash of all bytes before these</param>
+    /// <param name="bytes">Bytes that will be added to the hash</param>
+    /// <param name="byteCount">Number of bytes that will be added to the hash</param>
+    /// <returns>The hash including the specified bytes</returns>
+    public: static std::uint64_t HashBytes(
+      std::uint64_t hash, const std::byte *bytes, std::size_t byteCount
+    );
+
+    /// <summary>Continues a hash over a number of samples</summary>
+    /// <param name="hash">Hash of all samples before these</param>
+    /// <param name="samples">Samples that will be added to the hash</param>
+    /// <param name="sampleCount">Number of samples that will be added to the hash</param>
+    /// <returns>The hash including the specified samples</returns>
+    /// <remarks>
+    ///   The samples are hashed by their exact bit patterns, so any change to them,
+    ///   however small, produces a different hash.
+    /// </remarks>
+    public: static std::uint64_t HashSamples(
+      std::uint64_t hash, const float *samples, std::size_t sampleCount
+    );
+
+  };
+
+  // ------------------------------------------------------------------------------------------- //
+
+} // namespace Nuclex::OpusTranscoder::Audio
+
+#endif // NUCLEX_OPUSTRANSCODER_AUDIO_WORDHASH_H
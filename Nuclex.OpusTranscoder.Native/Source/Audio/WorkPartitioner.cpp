@@ -0,0 +1,93 @@
+#pragma region Apache License 2.0
+/*
+Nuclex Opus Transcoder
+Copyright (C) 2024 Markus Ewald / Nuclex Development Labs
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#pragma endregion // Apache License 2.0
+
+// If the application is compiled as a DLL, this ensures symbols are exported
+#define NUCLEX_OPUSTRANSCODER_SOURCE 1
+
+#include "./WorkPartitioner.h"
+
+#include <algorithm> // for std::min(), std::max()
+#include <thread> // for std::thread::hardware_concurrency()
+#include <atomic> // for std::atomic
+
+namespace {
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Maximum number of ranges a job is split into, 0 for one per CPU core</summary>
+  std::atomic<std::size_t> parallelism(0);
+
+  // ------------------------------------------------------------------------------------------- //
+
+} // anonymous namespace
+
+namespace Nuclex::OpusTranscoder::Audio {
+
+  // ------------------------------------------------------------------------------------------- //
+
+  // Below a second or so of audio, the scheduling overhead starts to become noticeable
+  // compared to the work done by the analysis passes on the range.
+  const std::size_t WorkPartitioner::MinimumFramesPerRange = 65536;
+
+  // ------------------------------------------------------------------------------------------- //
+
+  std::size_t WorkPartitioner::GetParallelism() {
+    std::size_t threadCount = parallelism.load(std::memory_order_relaxed);
+    if(threadCount == 0) {
+      threadCount = std::max<std::size_t>(std::thread::hardware_concurrency(), 1);
+    }
+
+    return threadCount;
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  void WorkPartitioner::SetParallelism(std::size_t threadCount) {
+    parallelism.store(threadCount, std::memory_order_relaxed);
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  std::vector<std::size_t> WorkPartitioner::SplitFrameRange(
+    std::size_t frameCount, std::size_t granularity /* = 1 */
+  ) {
+    std::size_t rangeCount = GetParallelism();
+    rangeCount = std::min(rangeCount, frameCount / MinimumFramesPerRange);
+
+    std::vector<std::size_t> boundaries;
+    boundaries.reserve(rangeCount + 2);
+    boundaries.push_back(0);
+
+    // Place the boundaries on multiples of the granularity. Rounding may leave
+    // a few of the ranges a bit longer than others, which doesn't matter much.
+    for(std::size_t index = 1; index < rangeCount; ++index) {
+      std::size_t boundary = frameCount / rangeCount * index;
+      boundary -= boundary % granularity;
+      if(boundaries.back() < boundary) {
+        boundaries.push_back(boundary);
+      }
+    }
+
+    boundaries.push_back(frameCount);
+    return boundaries;
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+} // namespace Nuclex::OpusTranscoder::Audio
@@ -0,0 +1,124 @@
+#pragma region Apache License 2.0
+/*
+Nuclex Opus Transcoder
+Copyright (C) 2024 Markus Ewald / Nuclex Development Labs
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#pragma endregion // Apache License 2.0
+
+#ifndef NUCLEX_OPUSTRANSCODER_AUDIO_WORKPARTITIONER_H
+#define NUCLEX_OPUSTRANSCODER_AUDIO_WORKPARTITIONER_H
+
+#include "../Config.h"
+
+#include <Nuclex/Support/Events/Delegate.h>
+
+#include <vector> // for std::vector
+#include <future> // for std::future
+#include <atomic> // for std::atomic
+#include <chrono> // for std::chrono::milliseconds
+#include <cstdint> // for std::uint64_t
+
+namespace Nuclex::OpusTranscoder::Audio {
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Helps with splitting work on a track across the threads of a thread pool</summary>
+  class WorkPartitioner {
+
+    /// <summary>Shortest range of frames that is worth handing to another thread</summary>
+    public: static const std::size_t MinimumFramesPerRange;
+
+    /// <summary>Looks up how many threads a single job should keep busy</summary>
+    /// <returns>The number of ranges the work of one job is split into at most</returns>
+    public: static std::size_t GetParallelism();
+
+    /// <summary>Sets how many threads a single job should keep busy</summary>
+    /// <param name="threadCount">
+    ///   Number of ranges the work of one job will be split into at most. If 0,
+    ///   the number of CPU cores is used.
+    /// </param>
+    /// <remarks>
+    ///   When several jobs share one thread pool, this keeps each of them from
+    ///   flooding the pool with more work items than its share of the threads.
+    ///   Only affects work split up after the call.
+    /// </remarks>
+    public: static void SetParallelism(std::size_t threadCount);
+
+    /// <summary>Splits a number of frames into roughly equal ranges for the thread pool</summary>
+    /// <param name="frameCount">Number of frames that should be split into ranges</param>
+    /// <param name="granularity">Multiple onto which all range boundaries are placed</param>
+    /// <returns>
+    ///   The boundaries of all ranges, starting with zero and ending with the frame count,
+    ///   so there is always one more entry than there are ranges
+    /// </returns>
+    public: static std::vector<std::size_t> SplitFrameRange(
+      std::size_t frameCount, std::size_t granularity = 1
+    );
+
+    /// <summary>Waits for all futures to become ready</summary>
+    /// <param name="futures">Futures that will be waited on</param>
+    /// <remarks>
+    ///   Used to clean up if scheduling fails half-way. Jobs reference variables on
+    ///   the scheduling thread's stack, so we can't let the exception leave before
+    ///   all jobs that were already scheduled have finished.
+    /// </remarks>
+    public: template<typename TResult>
+    static void WaitForAll(std::vector<std::future<TResult>> &futures) {
+      for(std::size_t index = 0; index < futures.size(); ++index) {
+        futures[index].wait();
+      }
+    }
+
+    /// <summary>Waits for all futures to become ready while reporting progress</summary>
+    /// <param name="futures">Futures that will be waited on</param>
+    /// <param name="completedWork">Amount of work the jobs have completed so far</param>
+    /// <param name="totalWork">Amount of work all the jobs will complete together</param>
+    /// <param name="progressCallback">Callback to which progress reports should be sent</param>
+    /// <remarks>
+    ///   This does not collect the results (or exceptions) of the jobs. It just ensures
+    ///   that all of them have ended, so the caller can safely call get() on each.
+    ///   One last progress report is sent after all jobs have ended, so the work they did
+    ///   is reported at least once even if they finished before the first poll.
+    /// </remarks>
+    public: template<typename TResult>
+    static void WaitForAll(
+      std::vector<std::future<TResult>> &futures,
+      const std::atomic<std::uint64_t> &completedWork, std::uint64_t totalWork,
+      Nuclex::Support::Events::Delegate<void(float)> &progressCallback
+    ) {
+      for(std::size_t index = 0; index < futures.size(); ++index) {
+        while(futures[index].wait_for(std::chrono::milliseconds(50)) != std::future_status::ready) {
+          progressCallback(
+            static_cast<float>(completedWork.load(std::memory_order_relaxed)) /
+            static_cast<float>(totalWork)
+          );
+        }
+      }
+
+      if(totalWork != 0) {
+        progressCallback(
+          static_cast<float>(completedWork.load(std::memory_order_relaxed)) /
+          static_cast<float>(totalWork)
+        );
+      }
+    }
+
+  };
+
+  // ------------------------------------------------------------------------------------------- //
+
+} // namespace Nuclex::OpusTranscoder::Audio
+
+#endif // NUCLEX_OPUSTRANSCODER_AUDIO_WORKPARTITIONER_H
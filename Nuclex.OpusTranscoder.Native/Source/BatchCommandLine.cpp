@@ -0,0 +1,635 @@
+#pragma region Apache License 2.0
+/*
+Nuclex Opus Transcoder
+Copyright (C) 2024 Markus Ewald / Nuclex Development Labs
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#pragma endregion // Apache License 2.0
+
+// If the application is compiled as a DLL, this ensures symbols are exported
+#define NUCLEX_OPUSTRANSCODER_SOURCE 1
+
+#include "./BatchCommandLine.h"
+#include "./Services/BatchTranscoder.h"
+#include "./Services/MetadataCache.h"
+#include "./Services/SchedulingPolicy.h"
+#include "./Services/Transcoder.h"
+
+#include <Nuclex/Audio/Storage/AudioLoader.h>
+#include <Nuclex/Audio/KnownChannelLayouts.h>
+
+#include <iostream> // for std::cout, std::cerr
+#include <fstream> // for std::ofstream
+#include <stdexcept> // for std::runtime_error
+#include <set> // for std::set
+#include <vector> // for std::vector
+#include <optional> // for std::optional
+#include <cstring> // for std::strcmp()
+
+#include <QCommandLineParser>
+#include <QDir>
+#include <QDirIterator>
+#include <QFileInfo>
+
+namespace {
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>File name patterns of the audio files picked up from directories</summary>
+  /// <remarks>
+  ///   Same as the file types offered by the main window's file dialog.
+  ///   Files given directly on the command line are tried regardless of their extension.
+  /// </remarks>
+  const char *const AudioFilePatterns[] = { u8"*.wv", u8"*.wav", u8"*.flac" };
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Settings and progress report of a batch run from the command line</summary>
+  class BatchSession {
+
+    /// <summary>Initializes a new batch session reporting on the specified batch</summary>
+    /// <param name="batch">Batch transcoder whose jobs will be reported</param>
+    public: BatchSession(const Nuclex::OpusTranscoder::Services::BatchTranscoder &batch) :
+      DeclipMode(),
+      PredictiveDeclip(false),
+      Normalize(false),
+      Surround(false),
+      UseOutputCache(false),
+      UseCheckpoints(false),
+      ReportToStandardError(false),
+      StereoBitrate(192.0f),
+      SurroundBitrate(576.0f),
+      NightmodeLevel(0.5f),
+      Effort(1.0f),
+      PerformanceReportFile(),
+      batch(batch),
+      endedJobCount(0) {}
+
+    /// <summary>Applies the settings to the transcoder that will run a job</summary>
+    /// <param name="transcoder">Transcoder that will be configured</param>
+    /// <param name="trackInfo">Metadata of the input file the job will transcode</param>
+    public: void Configure(
+      Nuclex::OpusTranscoder::Services::Transcoder &transcoder,
+      const Nuclex::Audio::TrackInfo &trackInfo
+    ) {
+      using Nuclex::Audio::KnownChannelLayouts;
+
+      transcoder.EnableClippingPrevention(this->DeclipMode != u8"none");
+      transcoder.EnableIterativeDeclipping(this->DeclipMode == u8"iterative");
+      transcoder.EnablePredictiveDeclipping(this->PredictiveDeclip);
+      transcoder.EnableNormalization(this->Normalize);
+      transcoder.EnableOutputCache(this->UseOutputCache);
+      transcoder.EnableCheckpoints(this->UseCheckpoints);
+      transcoder.SetNightmodeLevel(this->NightmodeLevel);
+      transcoder.SetEffort(this->Effort);
+
+      // Like in the main window, only inputs with 4 or more channels can become 5.1
+      bool isSurround = this->Surround && (trackInfo.ChannelCount >= 4);
+      if(isSurround) {
+        transcoder.SetOutputChannels(KnownChannelLayouts::FiveDotOneSurround);
+        transcoder.SetTargetBitrate(this->SurroundBitrate);
+      } else {
+        transcoder.SetOutputChannels(KnownChannelLayouts::Stereo);
+        transcoder.SetTargetBitrate(this->StereoBitrate);
+      }
+    }
+
+    /// <summary>Prints the outcome of a job that has ended</summary>
+    /// <param name="jobIndex">Index of the job that has ended</param>
+    public: void ReportJobEnded(std::size_t jobIndex) {
+      const Nuclex::OpusTranscoder::Services::BatchJob &job = this->batch.GetJobs()[jobIndex];
+      ++this->endedJobCount;
+
+      bool isSuccess = job.Outcome.value_or(false);
+      std::ostream &stream = (isSuccess && !this->ReportToStandardError) ? std::cout : std::cerr;
+      stream <<
+        u8"[" << this->endedJobCount << u8"/" << this->batch.GetJobs().size() << u8"] " <<
+        job.InputPath << u8": " << job.Message << std::endl;
+
+      // One line per job, so monitoring tools can follow the file as it grows
+      if(this->PerformanceReportFile.is_open() && !job.PerformanceReport.empty()) {
+        this->PerformanceReportFile << job.PerformanceReport << std::endl;
+      }
+    }
+
+    /// <summary>How to prevent clipping: "none", "tuck" or "iterative"</summary>
+    public: QString DeclipMode;
+    /// <summary>Whether to predict the clipping the Opus codec will introduce</summary>
+    public: bool PredictiveDeclip;
+    /// <summary>Whether to normalize the signal level before encoding</summary>
+    public: bool Normalize;
+    /// <summary>Whether to encode inputs with 4 or more channels as 5.1 surround</summary>
+    public: bool Surround;
+    /// <summary>Whether to reuse the results of identical earlier transcodes</summary>
+    public: bool UseOutputCache;
+    /// <summary>Whether iterative declipping saves checkpoints to resume from</summary>
+    public: bool UseCheckpoints;
+    /// <summary>Whether all reports go to stderr because stdout carries the Opus file</summary>
+    public: bool ReportToStandardError;
+    /// <summary>Target bitrate for stereo outputs in kilobits per second</summary>
+    public: float StereoBitrate;
+    /// <summary>Target bitrate for 5.1 surround outputs in kilobits per second</summary>
+    public: float SurroundBitrate;
+    /// <summary>Level to which to apply the nightmode downmix formula</summary>
+    public: float NightmodeLevel;
+    /// <summary>Amount of compression effort on a scale from 0.0 to 1.0</summary>
+    public: float Effort;
+    /// <summary>File the performance reports of all jobs are appended to, if open</summary>
+    public: std::ofstream PerformanceReportFile;
+
+    /// <summary>Batch transcoder whose jobs are being reported</summary>
+    private: const Nuclex::OpusTranscoder::Services::BatchTranscoder &batch;
+    /// <summary>Number of jobs that have ended so far</summary>
+    private: std::size_t endedJobCount;
+
+  };
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Parses a number from a command line option, checking its range</summary>
+  /// <param name="parser">Parser that has processed the command line</param>
+  /// <param name="option">Option whose value will be parsed</param>
+  /// <param name="minimum">Smallest value that is accepted</param>
+  /// <param name="maximum">Largest value that is accepted</param>
+  /// <param name="value">Receives the value, keeps its default if the option is absent</param>
+  /// <returns>True if the option was absent or valid, false if it was invalid</returns>
+  bool parseNumber(
+    const QCommandLineParser &parser, const QCommandLineOption &option,
+    double minimum, double maximum, double &value
+  ) {
+    if(!parser.isSet(option)) {
+      return true;
+    }
+
+    bool isNumber = false;
+    double parsedValue = parser.value(option).toDouble(&isNumber);
+    if(!isNumber || (parsedValue < minimum) || (parsedValue > maximum)) {
+      std::cerr <<
+        u8"Invalid value for --" << option.names().back().toStdString() <<
+        u8", must be between " << minimum << u8" and " << maximum << std::endl;
+      return false;
+    }
+
+    value = parsedValue;
+    return true;
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Parses the list of tracks selected on the command line</summary>
+  /// <param name="value">Comma-separated, one-based track numbers</param>
+  /// <param name="trackIndices">Receives the zero-based indices of the selected tracks</param>
+  /// <returns>True if the list was valid, false if it was invalid</returns>
+  bool parseTrackList(const QString &value, std::vector<std::size_t> &trackIndices) {
+    trackIndices.clear();
+
+    for(const QString &trackNumberText : value.split(u8',')) {
+      bool isNumber = false;
+      unsigned int trackNumber = trackNumberText.toUInt(&isNumber);
+      if(!isNumber || (trackNumber < 1)) {
+        std::cerr << u8"Invalid value for --tracks, must be all or track numbers like 1,3" <<
+          std::endl;
+        return false;
+      }
+
+      trackIndices.push_back(static_cast<std::size_t>(trackNumber) - 1);
+    }
+
+    return true;
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Collects the input files from files and directories on the command line</summary>
+  /// <param name="paths">Files and directories given on the command line</param>
+  /// <param name="recursive">Whether to look into subdirectories, too</param>
+  /// <returns>The absolute paths of all input files, sorted within each directory</returns>
+  QStringList collectInputFiles(const QStringList &paths, bool recursive) {
+    QStringList nameFilters;
+    for(const char *pattern : AudioFilePatterns) {
+      nameFilters.append(QString(pattern));
+    }
+
+    QStringList inputFiles;
+    for(const QString &path : paths) {
+      QFileInfo pathInfo(path);
+      if(!pathInfo.isDir()) {
+        inputFiles.append(pathInfo.absoluteFilePath());
+        continue;
+      }
+
+      QStringList directoryFiles;
+      QDirIterator iterator(
+        pathInfo.absoluteFilePath(), nameFilters, QDir::Files,
+        recursive ? QDirIterator::Subdirectories : QDirIterator::NoIteratorFlags
+      );
+      while(iterator.hasNext()) {
+        directoryFiles.append(iterator.next());
+      }
+
+      directoryFiles.sort();
+      inputFiles.append(directoryFiles);
+    }
+
+    return inputFiles;
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Picks the output path for an input file that no other job uses yet</summary>
+  /// <param name="inputFile">Absolute path of the input file</param>
+  /// <param name="suffix">Appended to the base name, to tell apart tracks of one input</param>
+  /// <param name="outputDirectory">Directory for the output file, empty for the input's</param>
+  /// <param name="usedOutputPaths">Output paths already taken by other jobs</param>
+  /// <returns>The path the Opus file for the input file should be saved under</returns>
+  /// <remarks>
+  ///   Unlike the main window, existing files are overwritten, so running the same batch
+  ///   again replaces its earlier results. Only inputs that share a base name, such as
+  ///   'track.wav' and 'track.flac', or an input that is an Opus file itself get
+  ///   a '_2', '_3' and so on appended.
+  /// </remarks>
+  QString chooseOutputPath(
+    const QString &inputFile, const QString &suffix, const QString &outputDirectory,
+    std::set<QString> &usedOutputPaths
+  ) {
+    QFileInfo inputFileInfo(inputFile);
+    QString baseName = inputFileInfo.completeBaseName() + suffix;
+
+    QDir directory(outputDirectory.isEmpty() ? inputFileInfo.absolutePath() : outputDirectory);
+    QString outputPath = directory.absoluteFilePath(baseName + u8".opus");
+    for(int index = 2; ; ++index) {
+      bool isTaken = (
+        (usedOutputPaths.find(outputPath) != usedOutputPaths.end()) ||
+        (outputPath == inputFileInfo.absoluteFilePath())
+      );
+      if(!isTaken) {
+        break;
+      }
+
+      outputPath = directory.absoluteFilePath(
+        baseName + u8"_" + QString::number(index) + u8".opus"
+      );
+    }
+
+    usedOutputPaths.insert(outputPath);
+    return outputPath;
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+} // anonymous namespace
+
+namespace Nuclex::OpusTranscoder {
+
+  // ------------------------------------------------------------------------------------------- //
+
+  bool BatchCommandLine::IsRequested(int argc, char *argv[]) {
+    return (argc >= 2) && (std::strcmp(argv[1], u8"--batch") == 0);
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  int BatchCommandLine::Run(const QStringList &arguments) {
+    QCommandLineParser parser;
+    parser.setApplicationDescription(
+      u8"Transcodes audio files to Opus without showing the user interface"
+    );
+    parser.addHelpOption();
+
+    QCommandLineOption batchOption(
+      QStringList(u8"batch"), u8"Runs in batch mode, must be the first argument"
+    );
+    QCommandLineOption outputDirectoryOption(
+      QStringList({ u8"o", u8"output-directory" }),
+      u8"Directory the Opus files are saved in. Default: next to each input.",
+      u8"directory"
+    );
+    QCommandLineOption outputFileOption(
+      QStringList(u8"output-file"),
+      u8"Opus file to save a single input as, - for stdout. Default: stdout if input is -.",
+      u8"file"
+    );
+    QCommandLineOption recursiveOption(
+      QStringList({ u8"r", u8"recursive" }), u8"Looks for audio files in subdirectories, too"
+    );
+    QCommandLineOption tracksOption(
+      QStringList(u8"tracks"),
+      u8"Tracks to transcode from each input, all or numbers like 1,3. Default: 1.",
+      u8"tracks"
+    );
+    QCommandLineOption bitrateOption(
+      QStringList({ u8"b", u8"bitrate" }),
+      u8"Bitrate of stereo outputs in kilobits per second (64-352). Default: 192.",
+      u8"kbps"
+    );
+    QCommandLineOption surroundOption(
+      QStringList(u8"surround"), u8"Encodes inputs with 4 or more channels as 5.1 surround"
+    );
+    QCommandLineOption surroundBitrateOption(
+      QStringList(u8"surround-bitrate"),
+      u8"Bitrate of 5.1 surround outputs in kilobits per second (256-992). Default: 576.",
+      u8"kbps"
+    );
+    QCommandLineOption nightmodeOption(
+      QStringList(u8"nightmode"),
+      u8"Level of the nightmode formula when downmixing to stereo (0-1). Default: 0.5.",
+      u8"level"
+    );
+    QCommandLineOption declipOption(
+      QStringList(u8"declip"),
+      u8"Clipping prevention: none, tuck or iterative. Default: iterative.",
+      u8"mode"
+    );
+    QCommandLineOption predictiveOption(
+      QStringList(u8"predictive"), u8"Predicts the clipping the Opus codec will introduce"
+    );
+    QCommandLineOption normalizeOption(
+      QStringList(u8"normalize"), u8"Normalizes the signal level before encoding"
+    );
+    QCommandLineOption effortOption(
+      QStringList(u8"effort"), u8"Compression effort (0-1). Default: 1.", u8"effort"
+    );
+    QCommandLineOption outputCacheOption(
+      QStringList(u8"output-cache"), u8"Reuses the results of identical earlier transcodes"
+    );
+    QCommandLineOption checkpointsOption(
+      QStringList(u8"checkpoints"),
+      u8"Saves iterative declipping progress, so killed jobs resume where they were"
+    );
+    QCommandLineOption jobsOption(
+      QStringList({ u8"j", u8"jobs" }),
+      u8"Maximum number of parallel transcodes. Default: number of worker threads.",
+      u8"count"
+    );
+    QCommandLineOption threadsOption(
+      QStringList(u8"threads"),
+      u8"Number of worker threads all transcodes share. Default: number of usable cores.",
+      u8"count"
+    );
+    QCommandLineOption threadsPerJobOption(
+      QStringList(u8"threads-per-job"),
+      u8"Worker threads a single transcode may keep busy. Default: an even share.",
+      u8"count"
+    );
+    QCommandLineOption numaNodeOption(
+      QStringList(u8"numa-node"), u8"Runs only on the CPU cores of this NUMA node", u8"node"
+    );
+    QCommandLineOption pinOption(
+      QStringList(u8"pin"), u8"Pins the process to as many cores as it has worker threads"
+    );
+    QCommandLineOption backgroundOption(
+      QStringList(u8"background"), u8"Runs at background CPU and disk priority"
+    );
+    QCommandLineOption performanceReportOption(
+      QStringList(u8"performance-report"),
+      u8"Appends a line of JSON with the timings and memory use of each job to this file",
+      u8"file"
+    );
+    QCommandLineOption memoryOption(
+      QStringList(u8"memory"),
+      u8"Memory all parallel transcodes may use together, in MiB. Default: half of RAM.",
+      u8"mebibytes"
+    );
+    parser.addOptions(
+      {
+        batchOption, outputDirectoryOption, outputFileOption, recursiveOption, tracksOption,
+        bitrateOption, surroundOption, surroundBitrateOption, nightmodeOption, declipOption,
+        predictiveOption, normalizeOption, effortOption, outputCacheOption, checkpointsOption,
+        jobsOption, memoryOption, performanceReportOption,
+        threadsOption, threadsPerJobOption, numaNodeOption, pinOption, backgroundOption
+      }
+    );
+    parser.addPositionalArgument(
+      u8"inputs", u8"Audio files or directories containing audio files, - for stdin",
+      u8"inputs..."
+    );
+
+    parser.process(arguments); // Exits the application on --help or unknown options
+
+    std::shared_ptr<Nuclex::Audio::Storage::AudioLoader> loader = (
+      std::make_shared<Nuclex::Audio::Storage::AudioLoader>()
+    );
+    Services::BatchTranscoder batch(loader);
+    BatchSession session(batch);
+
+    // Collect the settings from the command line, validating them all before
+    // any of potentially thousands of files are looked at
+    {
+      double stereoBitrate = session.StereoBitrate;
+      double surroundBitrate = session.SurroundBitrate;
+      double nightmodeLevel = session.NightmodeLevel;
+      double effort = session.Effort;
+      double jobCount = 0.0;
+      double memoryMebibytes = 0.0;
+      double threadCount = 0.0;
+      double threadsPerJob = 0.0;
+      double numaNode = 0.0;
+      bool isValid = (
+        parseNumber(parser, bitrateOption, 64.0, 352.0, stereoBitrate) &&
+        parseNumber(parser, surroundBitrateOption, 256.0, 992.0, surroundBitrate) &&
+        parseNumber(parser, nightmodeOption, 0.0, 1.0, nightmodeLevel) &&
+        parseNumber(parser, effortOption, 0.0, 1.0, effort) &&
+        parseNumber(parser, jobsOption, 1.0, 1024.0, jobCount) &&
+        parseNumber(parser, memoryOption, 1.0, 1073741824.0, memoryMebibytes) &&
+        parseNumber(parser, threadsOption, 1.0, 1024.0, threadCount) &&
+        parseNumber(parser, threadsPerJobOption, 1.0, 1024.0, threadsPerJob) &&
+        parseNumber(parser, numaNodeOption, 0.0, 255.0, numaNode)
+      );
+      if(!isValid) {
+        return 2;
+      }
+
+      session.DeclipMode = parser.isSet(declipOption) ?
+        parser.value(declipOption) : QString(u8"iterative");
+      if(
+        (session.DeclipMode != u8"none") &&
+        (session.DeclipMode != u8"tuck") &&
+        (session.DeclipMode != u8"iterative")
+      ) {
+        std::cerr << u8"Invalid value for --declip, must be none, tuck or iterative" << std::endl;
+        return 2;
+      }
+
+      session.StereoBitrate = static_cast<float>(stereoBitrate);
+      session.SurroundBitrate = static_cast<float>(surroundBitrate);
+      session.NightmodeLevel = static_cast<float>(nightmodeLevel);
+      session.Effort = static_cast<float>(effort);
+      session.PredictiveDeclip = parser.isSet(predictiveOption);
+      session.Normalize = parser.isSet(normalizeOption);
+      session.Surround = parser.isSet(surroundOption);
+      session.UseOutputCache = parser.isSet(outputCacheOption);
+      session.UseCheckpoints = parser.isSet(checkpointsOption);
+
+      if(parser.isSet(jobsOption)) {
+        Services::SchedulingPolicy::SetParallelJobCount(static_cast<std::size_t>(jobCount));
+      }
+      if(parser.isSet(memoryOption)) {
+        batch.SetMemoryBudget(static_cast<std::uint64_t>(memoryMebibytes * 1048576.0));
+      }
+      if(parser.isSet(threadsOption)) {
+        Services::SchedulingPolicy::SetWorkerThreadCount(static_cast<std::size_t>(threadCount));
+      }
+      if(parser.isSet(threadsPerJobOption)) {
+        Services::SchedulingPolicy::SetThreadsPerJob(static_cast<std::size_t>(threadsPerJob));
+      }
+      if(parser.isSet(numaNodeOption)) {
+        Services::SchedulingPolicy::SetNumaNode(static_cast<std::size_t>(numaNode));
+      }
+      if(parser.isSet(pinOption)) {
+        Services::SchedulingPolicy::EnablePinning();
+      }
+      if(parser.isSet(backgroundOption)) {
+        Services::SchedulingPolicy::EnableBackgroundPriority();
+      }
+
+      if(parser.isSet(performanceReportOption)) {
+        std::string path = parser.value(performanceReportOption).toStdString();
+        session.PerformanceReportFile.open(path, std::ios::out | std::ios::app);
+        if(!session.PerformanceReportFile.is_open()) {
+          std::cerr << u8"Could not open performance report file " << path << std::endl;
+          return 2;
+        }
+      }
+    }
+
+    // The worker threads inherit the affinity and priority when they're created,
+    // so this has to happen before the first transcoder is set up
+    try {
+      Services::SchedulingPolicy::ApplyToProcess();
+    }
+    catch(const std::runtime_error &error) {
+      std::cerr << error.what() << std::endl;
+      return 2;
+    }
+
+    // Without a list of tracks, only the first track of each input is transcoded.
+    // For all tracks, the inputs' metadata tells how many there are later on.
+    bool allTracks = false;
+    std::vector<std::size_t> trackIndices(1, 0);
+    if(parser.isSet(tracksOption)) {
+      allTracks = (parser.value(tracksOption) == QString(u8"all"));
+      if(!allTracks && !parseTrackList(parser.value(tracksOption), trackIndices)) {
+        return 2;
+      }
+    }
+
+    // A single input can be streamed through standard input and output, which
+    // needs an explicit output path as there's no input file to put it next to
+    QStringList inputs = parser.positionalArguments();
+    if(parser.isSet(outputFileOption) || inputs.contains(QString(u8"-"))) {
+      if((inputs.size() != 1) || parser.isSet(outputDirectoryOption)) {
+        std::cerr <<
+          u8"Standard input and --output-file only work with a single input and no " <<
+          u8"--output-directory" << std::endl;
+        return 2;
+      }
+      if(allTracks || (trackIndices.size() != 1)) {
+        std::cerr <<
+          u8"Standard input and --output-file only work with a single track" << std::endl;
+        return 2;
+      }
+
+      QString inputFile = inputs.front();
+      if(inputFile != QString(u8"-")) {
+        inputFile = QFileInfo(inputFile).absoluteFilePath();
+      }
+      QString outputFile = parser.isSet(outputFileOption) ?
+        parser.value(outputFileOption) : QString(u8"-");
+      if(outputFile != QString(u8"-")) {
+        outputFile = QFileInfo(outputFile).absoluteFilePath();
+      }
+
+      session.ReportToStandardError = (outputFile == QString(u8"-"));
+      batch.AddJob(inputFile.toStdString(), outputFile.toStdString(), trackIndices.front());
+    }
+
+    // Turn the files and directories on the command line into jobs
+    if(batch.GetJobs().empty()) {
+      QString outputDirectory;
+      if(parser.isSet(outputDirectoryOption)) {
+        outputDirectory = QDir(parser.value(outputDirectoryOption)).absolutePath();
+        if(!QDir().mkpath(outputDirectory)) {
+          std::cerr <<
+            u8"Could not create output directory " << outputDirectory.toStdString() <<
+            std::endl;
+          return 2;
+        }
+      }
+
+      QStringList inputFiles = collectInputFiles(inputs, parser.isSet(recursiveOption));
+      if(inputFiles.isEmpty()) {
+        std::cerr << u8"No audio files to transcode" << std::endl;
+        return 2;
+      }
+
+      // Each selected track becomes a job of its own. The batch transcoder notices
+      // jobs sharing an input file and reads it only once for all of them.
+      std::set<QString> usedOutputPaths;
+      for(const QString &inputFile : inputFiles) {
+        std::vector<std::size_t> inputTrackIndices = trackIndices;
+        if(allTracks) {
+          std::size_t trackCount = 1;
+          try {
+            std::optional<Nuclex::Audio::ContainerInfo> metadata = (
+              batch.GetMetadataCache()->ReadInfo(*loader, inputFile.toStdString())
+            );
+            if(metadata.has_value() && !metadata.value().Tracks.empty()) {
+              trackCount = metadata.value().Tracks.size();
+            }
+          }
+          catch(const std::exception &) {
+            // The job for the first track will fail and report the error
+          }
+
+          inputTrackIndices.clear();
+          for(std::size_t trackIndex = 0; trackIndex < trackCount; ++trackIndex) {
+            inputTrackIndices.push_back(trackIndex);
+          }
+        }
+
+        // Outputs only name the track if it isn't just the first one
+        bool namesTrack = (inputTrackIndices.size() >= 2) || (inputTrackIndices.front() > 0);
+        for(std::size_t trackIndex : inputTrackIndices) {
+          QString suffix;
+          if(namesTrack) {
+            suffix = u8"_track" + QString::number(static_cast<int>(trackIndex + 1));
+          }
+
+          QString outputPath = chooseOutputPath(
+            inputFile, suffix, outputDirectory, usedOutputPaths
+          );
+          batch.AddJob(inputFile.toStdString(), outputPath.toStdString(), trackIndex);
+        }
+      }
+    }
+
+    batch.JobEnded.Subscribe<BatchSession, &BatchSession::ReportJobEnded>(&session);
+    std::size_t failedJobCount = batch.Run(
+      Services::BatchTranscoder::ConfigureDelegate::Create<
+        BatchSession, &BatchSession::Configure
+      >(&session)
+    );
+    batch.JobEnded.Unsubscribe<BatchSession, &BatchSession::ReportJobEnded>(&session);
+
+    std::ostream &summaryStream = session.ReportToStandardError ? std::cerr : std::cout;
+    summaryStream <<
+      (batch.GetJobs().size() - failedJobCount) << u8" of " << batch.GetJobs().size() <<
+      u8" files transcoded" << std::endl;
+
+    return (failedJobCount == 0) ? 0 : 1;
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+} // namespace Nuclex::OpusTranscoder
@@ -0,0 +1,70 @@
+#pragma region Apache License 2.0
+/*
+Nuclex Opus Transcoder
+Copyright (C) 2024 Markus Ewald / Nuclex Development Labs
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#pragma endregion // Apache License 2.0
+
+#ifndef NUCLEX_OPUSTRANSCODER_BATCHCOMMANDLINE_H
+#define NUCLEX_OPUSTRANSCODER_BATCHCOMMANDLINE_H
+
+#include "./Config.h"
+
+#include <QStringList>
+
+namespace Nuclex::OpusTranscoder {
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Runs the transcoder without its user interface for batches of files</summary>
+  /// <remarks>
+  ///   <para>
+  ///     Started with <code>--batch</code> as its first argument, the application
+  ///     transcodes all audio files and directories of audio files given on the command
+  ///     line, printing one line per file, and exits with a non-zero code if any of them
+  ///     failed. The transcodes run in parallel within a memory budget, see
+  ///     <see cref="Services::BatchTranscoder" />. <code>--batch --help</code> lists
+  ///     the options. On Windows, the output only shows up when it is redirected,
+  ///     since the application isn't a console application.
+  ///   </para>
+  ///   <para>
+  ///     Each file gets the settings a user would pick in the main window. Inputs with
+  ///     four or more channels are downmixed to stereo unless <code>--surround</code>
+  ///     is given, in which case they are encoded as 5.1.
+  ///   </para>
+  /// </remarks>
+  class BatchCommandLine {
+
+    /// <summary>Checks whether the application was launched in batch mode</summary>
+    /// <param name="argc">The number of command line arguments provided</param>
+    /// <param name="argv">The values of all command line arguments</param>
+    /// <returns>True if batch mode was requested on the command line</returns>
+    public: static bool IsRequested(int argc, char *argv[]);
+
+    /// <summary>Transcodes all files specified on the command line</summary>
+    /// <param name="arguments">Command line arguments the application was launched with</param>
+    /// <returns>The exit code the application should terminate with</returns>
+    /// <remarks>
+    ///   A QCoreApplication has to exist while this runs.
+    /// </remarks>
+    public: static int Run(const QStringList &arguments);
+
+  };
+
+  // ------------------------------------------------------------------------------------------- //
+
+} // namespace Nuclex::OpusTranscoder
+
+#endif // NUCLEX_OPUSTRANSCODER_BATCHCOMMANDLINE_H
@@ -85,6 +85,133 @@ limitations under the License.
 
 // --------------------------------------------------------------------------------------------- //
 
+// Vector instruction set detection. These only reflect what the compiler has been told
+// it may target, so they're safe to use in plain #if blocks without runtime dispatch.
+#if defined(__AVX2__)
+  #define NUCLEX_OPUSTRANSCODER_HAVE_AVX2 1
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+  #define NUCLEX_OPUSTRANSCODER_HAVE_SSE2 1
+#endif
+#if defined(__ARM_NEON) || defined(__ARM_NEON__) || defined(_M_ARM64)
+  #define NUCLEX_OPUSTRANSCODER_HAVE_NEON 1
+#endif
+
+// --------------------------------------------------------------------------------------------- //
+
+// Scratch file spilling. Sample buffers of at least this many bytes are stored in
+// a memory-mapped scratch file instead of plain memory, so very long or wide tracks
+// slow down to disk speed rather than exhausting memory. Zero disables spilling.
+#if !defined(NUCLEX_OPUSTRANSCODER_SCRATCH_THRESHOLD)
+  #define NUCLEX_OPUSTRANSCODER_SCRATCH_THRESHOLD 0
+#endif
+
+// Directory scratch files will be created in. If empty, the temporary directory
+// of the current user is used. Both can also be changed at runtime.
+#if !defined(NUCLEX_OPUSTRANSCODER_SCRATCH_DIRECTORY)
+  #define NUCLEX_OPUSTRANSCODER_SCRATCH_DIRECTORY u8""
+#endif
+
+// Whether input files are memory-mapped instead of being read through the file API.
+// Decoders then copy straight out of the page cache and readers that can use the mapped
+// bytes in place don't copy at all. Files that can't be mapped are read as before.
+#if !defined(NUCLEX_OPUSTRANSCODER_MAP_INPUT_FILES)
+  #define NUCLEX_OPUSTRANSCODER_MAP_INPUT_FILES 1
+#endif
+
+// --------------------------------------------------------------------------------------------- //
+
+// Output cache. If enabled in the transcoder, finished Opus files are kept in this
+// directory, keyed by a hash of the input file and the settings it was encoded with.
+// If empty, a directory in the user's cache location is used.
+#if !defined(NUCLEX_OPUSTRANSCODER_OUTPUT_CACHE_DIRECTORY)
+  #define NUCLEX_OPUSTRANSCODER_OUTPUT_CACHE_DIRECTORY u8""
+#endif
+
+// Number of bytes the output cache may occupy before entries are evicted
+#if !defined(NUCLEX_OPUSTRANSCODER_OUTPUT_CACHE_LIMIT)
+  #define NUCLEX_OPUSTRANSCODER_OUTPUT_CACHE_LIMIT (4096ULL * 1024 * 1024)
+#endif
+
+// Which entries are evicted first when the output cache is full. If 1, the least
+// recently used ones go first. If 0, the oldest ones go first, no matter how often
+// they were reused.
+#if !defined(NUCLEX_OPUSTRANSCODER_OUTPUT_CACHE_EVICT_LEAST_RECENTLY_USED)
+  #define NUCLEX_OPUSTRANSCODER_OUTPUT_CACHE_EVICT_LEAST_RECENTLY_USED 1
+#endif
+
+// Whether cached Opus files are hard-linked to the output path rather than copied.
+// A hard-linked output file shares its data with the cache entry, so editing the output
+// file in place (for example, retagging it) also changes the cached entry and every
+// other output that was linked to it. Falls back to copying if the output path is on
+// another volume. If 0, the entry is copied, or cloned where the file system supports it.
+#if !defined(NUCLEX_OPUSTRANSCODER_OUTPUT_CACHE_HARD_LINKS)
+  #define NUCLEX_OPUSTRANSCODER_OUTPUT_CACHE_HARD_LINKS 0
+#endif
+
+// --------------------------------------------------------------------------------------------- //
+
+// Metadata cache. Whether the main window reads the metadata of all audio files in
+// the selected file's directory in the background, so the next file's metadata is
+// ready by the time it is selected.
+#if !defined(NUCLEX_OPUSTRANSCODER_PREFETCH_METADATA)
+  #define NUCLEX_OPUSTRANSCODER_PREFETCH_METADATA 1
+#endif
+
+// Whether the metadata cache of the main window is saved in the user's cache location
+// when the application exits and loaded again when it starts
+#if !defined(NUCLEX_OPUSTRANSCODER_PERSIST_METADATA)
+  #define NUCLEX_OPUSTRANSCODER_PERSIST_METADATA 1
+#endif
+
+// --------------------------------------------------------------------------------------------- //
+
+// Scheduling. The number of worker threads in the thread pool shared by all transcodes
+// of the process, 0 for one per CPU core (or per core in the NUMA node, see below).
+#if !defined(NUCLEX_OPUSTRANSCODER_WORKER_THREADS)
+  #define NUCLEX_OPUSTRANSCODER_WORKER_THREADS 0
+#endif
+
+// Number of transcodes running at the same time in batch mode, 0 to run as many
+// as there are worker threads.
+#if !defined(NUCLEX_OPUSTRANSCODER_PARALLEL_JOBS)
+  #define NUCLEX_OPUSTRANSCODER_PARALLEL_JOBS 0
+#endif
+
+// Number of worker threads a single transcode may keep busy in batch mode, 0 to
+// divide the worker threads evenly between the parallel transcodes.
+#if !defined(NUCLEX_OPUSTRANSCODER_THREADS_PER_JOB)
+  #define NUCLEX_OPUSTRANSCODER_THREADS_PER_JOB 0
+#endif
+
+// NUMA node the process is confined to, -1 to run on all of them
+#if !defined(NUCLEX_OPUSTRANSCODER_NUMA_NODE)
+  #define NUCLEX_OPUSTRANSCODER_NUMA_NODE -1
+#endif
+
+// Whether the process is pinned to as many CPU cores as it has worker threads instead
+// of being allowed to use any core (within its NUMA node, if one is selected)
+#if !defined(NUCLEX_OPUSTRANSCODER_PIN_THREADS)
+  #define NUCLEX_OPUSTRANSCODER_PIN_THREADS 0
+#endif
+
+// Whether the process runs at background priority, yielding the CPU and the disk
+// to everything else running on the system
+#if !defined(NUCLEX_OPUSTRANSCODER_BACKGROUND_PRIORITY)
+  #define NUCLEX_OPUSTRANSCODER_BACKGROUND_PRIORITY 0
+#endif
+
+// --------------------------------------------------------------------------------------------- //
+
+// Progress reporting. The maximum number of progress events a transcoder sends out
+// per second, 0 to send one for every progress report. The progress itself is always
+// kept up to date, this only limits how often listeners are told to look at it.
+#if !defined(NUCLEX_OPUSTRANSCODER_PROGRESS_EVENT_RATE)
+  #define NUCLEX_OPUSTRANSCODER_PROGRESS_EVENT_RATE 30
+#endif
+
+// --------------------------------------------------------------------------------------------- //
+
 // Decides whether symbols are imported from a dll (client app) or exported to
 // a dll (Nuclex.OpusTranscoder.Native application). The NUCLEX_OPUSTRANSCODER_SOURCE symbol
 // is defined by all source files of the application, so you don't have to worry about a thing.
@@ -23,20 +23,32 @@ limitations under the License.
 #include "./Config.h"
 
 #include "./MainWindow.h"
+#include "./BatchCommandLine.h" // for BatchCommandLine
 #include "./Services/ServicesRoot.h" // for ServicesRoot
+#include "./Services/SchedulingPolicy.h" // for SchedulingPolicy
 
 #include <QApplication>
+#include <QCoreApplication>
 #include <QMessageBox>
 
 // --------------------------------------------------------------------------------------------- //
 
-#if !defined(NUCLEX_OPUSTRANSCODER_UNIT_TEST_EXECUTABLE)
+#if !defined(NUCLEX_OPUSTRANSCODER_UNIT_TEST_EXECUTABLE) && \
+    !defined(NUCLEX_OPUSTRANSCODER_BENCHMARK_EXECUTABLE)
 
 /// <summary>Entry point for the application</summary>
 /// <param name="argc">The number of command line arguments provided</param>
 /// <param name="argv">The values of all command line arguments</param>
 /// <returns>The exit code the application has terminated with</returns>
 int main(int argc, char *argv[]) {
+
+  // In batch mode, no windows are shown, so there's no need for the GUI bits of Qt
+  // (which would also fail to start on headless machines without a display)
+  if(Nuclex::OpusTranscoder::BatchCommandLine::IsRequested(argc, argv)) {
+    QCoreApplication application(argc, argv);
+    return Nuclex::OpusTranscoder::BatchCommandLine::Run(application.arguments());
+  }
+
   int exitCode;
   {
     //::qputenv("QT_QPA_PLATFORM", "windows:darkmode=2");
@@ -48,6 +60,7 @@ int main(int argc, char *argv[]) {
     // together instead of a full-blown IoC container to keep things simple).
     std::shared_ptr<Nuclex::OpusTranscoder::Services::ServicesRoot> servicesRoot;
     try {
+      Nuclex::OpusTranscoder::Services::SchedulingPolicy::ApplyToProcess();
       servicesRoot = std::make_shared<Nuclex::OpusTranscoder::Services::ServicesRoot>();
     }
     catch(const std::exception &error) {
@@ -76,6 +89,6 @@ int main(int argc, char *argv[]) {
   return exitCode;
 }
 
-#endif // !defined(NUCLEX_OPUSTRANSCODER_UNIT_TEST_EXECUTABLE)
+#endif // if neither the unit test nor the benchmark executable
 
 // --------------------------------------------------------------------------------------------- //
@@ -138,7 +138,8 @@ namespace Nuclex::OpusTranscoder {
     visualizationScene(),
     opusTranscoder(),
     metadata(),
-    isTranscoding(false) {
+    isTranscoding(false),
+    isProgressReportQueued(false) {
 
     this->ui->setupUi(this);
     this->ui->channelGraphics->setRenderHints(
@@ -348,6 +349,13 @@ namespace Nuclex::OpusTranscoder {
   // ------------------------------------------------------------------------------------------- //
 
   void MainWindow::transcodingProgressedInBackgroundThread() {
+
+    // If the UI thread hasn't gotten around to the last progress update yet, it will
+    // pick up the newest progress when it does, so there's no point in queueing another
+    if(this->isProgressReportQueued.exchange(true, std::memory_order_acq_rel)) {
+      return;
+    }
+
     QMetaObject::invokeMethod(
       this,
       &MainWindow::reportTranscodingProgress,
@@ -358,6 +366,7 @@ namespace Nuclex::OpusTranscoder {
   // ------------------------------------------------------------------------------------------- //
 
   void MainWindow::reportTranscodingProgress() {
+    this->isProgressReportQueued.store(false, std::memory_order_release);
     float progress = this->opusTranscoder->GetCurrentStepProgress();
 
     if(progress == 0.0f) {
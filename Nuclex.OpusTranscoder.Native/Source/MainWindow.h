@@ -29,6 +29,7 @@ limitations under the License.
 #include <QMutex> // for QMutex
 #include <QGraphicsScene> // for QGraphicsScene
 
+#include <atomic> // for std::atomic
 #include <memory> // for std::unique_ptr
 #include <optional> // for std::optional
 #include <map> // for std::pair
@@ -168,6 +169,8 @@ namespace Nuclex::OpusTranscoder {
     private: std::optional<Nuclex::Audio::TrackInfo> metadata;
     /// <summary>Whether the main window thinks a transcode is currentl ongoign</summary>
     private: bool isTranscoding;
+    /// <summary>Whether a progress update is already waiting for the UI thread</summary>
+    private: std::atomic<bool> isProgressReportQueued;
 
   };
 
@@ -0,0 +1,485 @@
+#pragma region Apache License 2.0
+/*
+Nuclex Opus Transcoder
+Copyright (C) 2024 Markus Ewald / Nuclex Development Labs
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#pragma endregion // Apache License 2.0
+
+// If the application is compiled as a DLL, this ensures symbols are exported
+#define NUCLEX_CRIUGUI_SOURCE 1
+
+#include "./BatchTranscoder.h"
+#include "./Transcoder.h"
+#include "./MetadataCache.h"
+#include "./SchedulingPolicy.h"
+
+#include "../Audio/WorkPartitioner.h"
+#include "../Audio/PipeInputFile.h"
+#include "../Audio/MemoryFile.h"
+#include "../Audio/MappedFile.h"
+
+#include <Nuclex/Support/Threading/StopSource.h>
+#include <Nuclex/Support/Threading/ThreadPool.h>
+
+#include <Nuclex/Audio/Storage/AudioLoader.h>
+#include <Nuclex/Audio/Storage/VirtualFile.h>
+
+#include <algorithm> // for std::min(), std::stable_sort()
+#include <stdexcept> // for std::exception
+
+#if defined(NUCLEX_OPUSTRANSCODER_WINDOWS)
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h> // for ::GlobalMemoryStatusEx()
+#else
+#include <unistd.h> // for ::sysconf()
+#endif
+
+namespace {
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Memory budget assumed if the amount of physical memory is unknown</summary>
+  const std::uint64_t FallbackMemoryBudget = 4ULL * 1024 * 1024 * 1024;
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Determines the amount of physical memory installed in the system</summary>
+  /// <returns>The amount of physical memory in bytes or 0 if it couldn't be determined</returns>
+  std::uint64_t getPhysicalMemorySize() {
+#if defined(NUCLEX_OPUSTRANSCODER_WINDOWS)
+    MEMORYSTATUSEX memoryStatus;
+    memoryStatus.dwLength = sizeof(memoryStatus);
+    if(::GlobalMemoryStatusEx(&memoryStatus) == FALSE) {
+      return 0;
+    }
+    return static_cast<std::uint64_t>(memoryStatus.ullTotalPhys);
+#else
+    long pageCount = ::sysconf(_SC_PHYS_PAGES);
+    long pageSize = ::sysconf(_SC_PAGESIZE);
+    if((pageCount <= 0) || (pageSize <= 0)) {
+      return 0;
+    }
+    return static_cast<std::uint64_t>(pageCount) * static_cast<std::uint64_t>(pageSize);
+#endif
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Opens an input file so several transcoders can share it</summary>
+  /// <param name="path">Path of the input file that will be opened</param>
+  /// <returns>The shared file or nothing if it couldn't be read</returns>
+  /// <remarks>
+  ///   <para>
+  ///     If possible, the file is memory-mapped. All transcoders then read the same pages
+  ///     from the page cache and the file isn't copied at all. Otherwise, it is read into
+  ///     memory in one go so it only has to be read from disk once.
+  ///   </para>
+  ///   <para>
+  ///     If the file can't be read, each transcoder opens it on its own instead and
+  ///     reports the error as part of its job.
+  ///   </para>
+  /// </remarks>
+  std::shared_ptr<const Nuclex::Audio::Storage::VirtualFile> openSharedInput(
+    const std::string &path
+  ) {
+    using Nuclex::Audio::Storage::VirtualFile;
+
+#if NUCLEX_OPUSTRANSCODER_MAP_INPUT_FILES
+    // The transcoders decode different tracks at their own pace, so the reads are
+    // spread over the file and the kernel shouldn't drop pages behind any one of them
+    try {
+      return std::make_shared<Nuclex::OpusTranscoder::Audio::MappedFile>(path);
+    }
+    catch(const std::exception &) {
+      // Read the file into memory instead
+    }
+#endif
+
+    try {
+      std::shared_ptr<const VirtualFile> file = VirtualFile::OpenRealFileForReading(path, true);
+
+      std::vector<std::byte> contents(static_cast<std::size_t>(file->GetSize()));
+      if(!contents.empty()) {
+        file->ReadAt(0, contents.size(), contents.data());
+      }
+
+      return std::make_shared<Nuclex::OpusTranscoder::Audio::MemoryFile>(std::move(contents));
+    }
+    catch(const std::exception &) {
+      return std::shared_ptr<const VirtualFile>();
+    }
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+} // anonymous namespace
+
+namespace Nuclex::OpusTranscoder::Services {
+
+  // ------------------------------------------------------------------------------------------- //
+
+  BatchTranscoder::BatchTranscoder(
+    const std::shared_ptr<Nuclex::Audio::Storage::AudioLoader> &loader
+  ) :
+    loader(loader),
+    metadataCache(std::make_shared<MetadataCache>()),
+    maximumParallelJobCount(0),
+    memoryBudget(getPhysicalMemorySize() / 2),
+    jobs(),
+    endedTranscoderMutex(),
+    endedTranscoderCondition(),
+    endedTranscoderCount(0) {
+
+    // The amount of physical memory isn't guaranteed to be known. Half of it leaves
+    // room for the rest of the system, the page cache and the estimates being off.
+    if(this->memoryBudget == 0) {
+      this->memoryBudget = FallbackMemoryBudget;
+    }
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  BatchTranscoder::~BatchTranscoder() {}
+
+  // ------------------------------------------------------------------------------------------- //
+
+  void BatchTranscoder::SetMaximumParallelJobCount(std::size_t jobCount) {
+    this->maximumParallelJobCount = jobCount;
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  void BatchTranscoder::SetMemoryBudget(std::uint64_t byteCount) {
+    this->memoryBudget = byteCount;
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  void BatchTranscoder::AddJob(
+    const std::string &inputPath, const std::string &outputPath, std::size_t trackIndex /* = 0 */
+  ) {
+    BatchJob job;
+    job.InputPath = inputPath;
+    job.OutputPath = outputPath;
+    job.TrackIndex = trackIndex;
+    job.MemoryFootprint = 0;
+
+    this->jobs.push_back(std::move(job));
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  std::size_t BatchTranscoder::Run(const ConfigureDelegate &configure) {
+    std::size_t parallelJobCount = this->maximumParallelJobCount;
+    if(parallelJobCount == 0) {
+      parallelJobCount = SchedulingPolicy::GetParallelJobCount();
+    }
+
+    std::size_t transcoderCount = std::min(parallelJobCount, this->jobs.size());
+    if(transcoderCount == 0) {
+      return 0;
+    }
+
+    // All transcoders share the same worker threads. Limiting how many of them each
+    // transcode keeps busy stops one long job from starving the others.
+    Audio::WorkPartitioner::SetParallelism(
+      SchedulingPolicy::GetThreadsPerJob(transcoderCount)
+    );
+
+    // Transcoders are reused for one job after another. Each brings its own thread
+    // that runs the job, so the loop below merely decides what to start next.
+    std::vector<std::unique_ptr<Transcoder>> transcoders;
+    transcoders.reserve(transcoderCount);
+    for(std::size_t index = 0; index < transcoderCount; ++index) {
+      transcoders.push_back(std::make_unique<Transcoder>(this->loader));
+      transcoders.back()->SetMetadataCache(this->metadataCache);
+      transcoders.back()->Ended.Subscribe<
+        BatchTranscoder, &BatchTranscoder::transcoderEnded
+      >(this);
+    }
+
+    std::vector<Nuclex::Audio::TrackInfo> trackInfos;
+    std::map<std::string, std::size_t> sharedInputJobCounts;
+    planJobs(configure, *transcoders.front(), trackInfos, sharedInputJobCounts);
+
+    // In-memory copies of the input files that jobs for several tracks are reading.
+    // Each is dropped when its last job has started, the transcoders keep it alive.
+    std::map<
+      std::string, std::shared_ptr<const Nuclex::Audio::Storage::VirtualFile>
+    > sharedInputs;
+
+    // Largest jobs first, so they get going while memory is still free
+    // and the small ones are left over to fill the gaps around them
+    std::vector<std::size_t> pendingJobs;
+    pendingJobs.reserve(this->jobs.size());
+    for(std::size_t index = 0; index < this->jobs.size(); ++index) {
+      if(!this->jobs[index].Outcome.has_value()) {
+        pendingJobs.push_back(index);
+      }
+    }
+    std::stable_sort(
+      pendingJobs.begin(), pendingJobs.end(),
+      [this](std::size_t left, std::size_t right) {
+        return this->jobs[right].MemoryFootprint < this->jobs[left].MemoryFootprint;
+      }
+    );
+
+    std::vector<std::optional<std::size_t>> runningJobs(transcoderCount);
+    std::size_t runningJobCount = 0;
+    std::uint64_t committedMemory = 0;
+    for(;;) {
+
+      // Hand the largest pending job that still fits to each idle transcoder. If nothing
+      // is running, the largest job starts even if it exceeds the whole budget alone,
+      // otherwise it would never run at all.
+      for(std::size_t transcoderIndex = 0; transcoderIndex < transcoderCount; ++transcoderIndex) {
+        if(runningJobs[transcoderIndex].has_value()) {
+          continue;
+        }
+
+        std::vector<std::size_t>::iterator chosenJob = pendingJobs.begin();
+        if(runningJobCount > 0) {
+          while(chosenJob != pendingJobs.end()) {
+            std::uint64_t footprint = this->jobs[*chosenJob].MemoryFootprint;
+            if(footprint <= this->memoryBudget - std::min(committedMemory, this->memoryBudget)) {
+              break;
+            }
+            ++chosenJob;
+          }
+        }
+        if(chosenJob == pendingJobs.end()) {
+          break;
+        }
+
+        std::size_t jobIndex = *chosenJob;
+        pendingJobs.erase(chosenJob);
+
+        const BatchJob &job = this->jobs[jobIndex];
+        std::shared_ptr<const Nuclex::Audio::Storage::VirtualFile> inputFile;
+        {
+          std::map<std::string, std::size_t>::iterator sharedInput = (
+            sharedInputJobCounts.find(job.InputPath)
+          );
+          if(sharedInput != sharedInputJobCounts.end()) {
+            std::shared_ptr<const Nuclex::Audio::Storage::VirtualFile> &sharedFile = (
+              sharedInputs[job.InputPath]
+            );
+            if(!static_cast<bool>(sharedFile)) {
+              sharedFile = openSharedInput(job.InputPath);
+            }
+            inputFile = sharedFile;
+
+            --sharedInput->second;
+            if(sharedInput->second == 0) {
+              sharedInputs.erase(job.InputPath);
+              sharedInputJobCounts.erase(sharedInput);
+            }
+          }
+        }
+
+        Transcoder &transcoder = *transcoders[transcoderIndex];
+        configure(transcoder, trackInfos[jobIndex]);
+        transcoder.SelectTrack(job.TrackIndex);
+        transcoder.TranscodeAudioFile(inputFile, job.InputPath, job.OutputPath);
+
+        runningJobs[transcoderIndex] = jobIndex;
+        committedMemory += this->jobs[jobIndex].MemoryFootprint;
+        ++runningJobCount;
+      } // for each transcoder
+
+      if(runningJobCount == 0) {
+        break; // Nothing could be started, so no jobs are pending anymore
+      }
+
+      // Wait for any of the transcoders to finish its job. The count is only a wake-up
+      // signal, the transcoders are checked for their outcomes to see which ones are done.
+      {
+        std::unique_lock<std::mutex> endedTranscoderScope(this->endedTranscoderMutex);
+        this->endedTranscoderCondition.wait(
+          endedTranscoderScope, [this]() { return (this->endedTranscoderCount > 0); }
+        );
+        this->endedTranscoderCount = 0;
+      }
+
+      for(std::size_t transcoderIndex = 0; transcoderIndex < transcoderCount; ++transcoderIndex) {
+        if(!runningJobs[transcoderIndex].has_value()) {
+          continue;
+        }
+
+        Transcoder &transcoder = *transcoders[transcoderIndex];
+        std::optional<bool> outcome = transcoder.GetOutcome();
+        if(!outcome.has_value()) {
+          continue;
+        }
+
+        // The outcome is set right before the transcoder's thread exits. Joining it
+        // makes sure it has before the transcoder is given another job.
+        transcoder.Join();
+
+        std::size_t jobIndex = runningJobs[transcoderIndex].value();
+        this->jobs[jobIndex].Outcome = outcome;
+        this->jobs[jobIndex].Message = transcoder.GetCurrentStepMessage();
+        this->jobs[jobIndex].PerformanceReport = transcoder.GetPerformanceReport().ToJson();
+
+        runningJobs[transcoderIndex].reset();
+        committedMemory -= this->jobs[jobIndex].MemoryFootprint;
+        --runningJobCount;
+
+        this->JobEnded.Emit(jobIndex);
+      } // for each transcoder
+    } // while jobs are running
+
+    for(std::unique_ptr<Transcoder> &transcoder : transcoders) {
+      transcoder->Ended.Unsubscribe<BatchTranscoder, &BatchTranscoder::transcoderEnded>(this);
+    }
+
+    std::size_t failedJobCount = 0;
+    for(const BatchJob &job : this->jobs) {
+      if(!job.Outcome.value_or(false)) {
+        ++failedJobCount;
+      }
+    }
+
+    return failedJobCount;
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  void BatchTranscoder::planJobs(
+    const ConfigureDelegate &configure, Transcoder &probe,
+    std::vector<Nuclex::Audio::TrackInfo> &trackInfos,
+    std::map<std::string, std::size_t> &sharedInputJobCounts
+  ) {
+    trackInfos.resize(this->jobs.size());
+
+    // Count the jobs reading each input file. Standard input can't be shared that way,
+    // it can only be consumed by a single job anyway.
+    std::map<std::string, std::size_t> inputJobCounts;
+    for(const BatchJob &job : this->jobs) {
+      if(job.InputPath != Transcoder::StandardStreamPath) {
+        ++inputJobCounts[job.InputPath];
+      }
+    }
+    std::map<std::string, std::uint64_t> sharedInputSizes;
+
+    // Read the headers of all input files at once. Most of the time is spent waiting
+    // for the disk or network, which overlaps nicely. The loop below and the transcoders
+    // then take the metadata from the cache. A batch can't be canceled, so the stop
+    // token here is never triggered.
+    {
+      std::vector<std::string> inputPaths;
+      inputPaths.reserve(inputJobCounts.size());
+      for(const std::pair<const std::string, std::size_t> &inputJobCount : inputJobCounts) {
+        inputPaths.push_back(inputJobCount.first);
+      }
+
+      std::shared_ptr<Nuclex::Support::Threading::StopSource> stopSource = (
+        Nuclex::Support::Threading::StopSource::Create()
+      );
+      this->metadataCache->Prefetch(
+        *this->loader, inputPaths, *SchedulingPolicy::GetSharedThreadPool(),
+        stopSource->GetToken()
+      );
+    }
+
+    for(std::size_t index = 0; index < this->jobs.size(); ++index) {
+      BatchJob &job = this->jobs[index];
+
+      // Only the headers are read here, which is cheap compared to the transcode,
+      // and files that can't be transcoded at all are weeded out early
+      std::optional<Nuclex::Audio::ContainerInfo> metadata;
+      try {
+        if(job.InputPath == Transcoder::StandardStreamPath) {
+          metadata = this->loader->TryReadInfo(Audio::PipeInputFile::GetStandardInput());
+        } else {
+          metadata = this->metadataCache->ReadInfo(*this->loader, job.InputPath);
+        }
+      }
+      catch(const std::exception &error) {
+        job.Outcome = false;
+        job.Message = std::string(u8"Transcoding failed: ", 20) + error.what();
+        this->JobEnded.Emit(index);
+        continue;
+      }
+      if(!metadata.has_value() || metadata.value().Tracks.empty()) {
+        job.Outcome = false;
+        job.Message = std::string(u8"Transcoding failed: Unsupported file type", 41);
+        this->JobEnded.Emit(index);
+        continue;
+      }
+      if(metadata.value().Tracks.size() <= job.TrackIndex) {
+        job.Outcome = false;
+        job.Message = std::string(
+          u8"Transcoding failed: File does not contain the selected audio track", 66
+        );
+        this->JobEnded.Emit(index);
+        continue;
+      }
+
+      trackInfos[index] = metadata.value().Tracks[job.TrackIndex];
+      configure(probe, trackInfos[index]);
+      job.MemoryFootprint = probe.EstimateMemoryFootprint(trackInfos[index]);
+
+      // Jobs sharing an input file each count the in-memory copy of it. That's
+      // more than will actually be used (and when the file is mapped, its pages can
+      // be dropped again), but it keeps the estimates on the safe side.
+      if(inputJobCounts[job.InputPath] >= 2) {
+        std::map<std::string, std::uint64_t>::iterator size = (
+          sharedInputSizes.find(job.InputPath)
+        );
+        if(size == sharedInputSizes.end()) {
+          std::uint64_t fileSize = 0;
+          try {
+            fileSize = Nuclex::Audio::Storage::VirtualFile::OpenRealFileForReading(
+              job.InputPath
+            )->GetSize();
+          }
+          catch(const std::exception &) {
+            // The transcoder will report the error when it tries to open the file
+          }
+          size = sharedInputSizes.emplace(job.InputPath, fileSize).first;
+        }
+        job.MemoryFootprint += size->second;
+        ++sharedInputJobCounts[job.InputPath];
+      }
+    } // for each job
+
+    // An input file that only has one job left after the others failed planning
+    // doesn't need to be shared and is simply opened by the transcoder
+    for(
+      std::map<std::string, std::size_t>::iterator iterator = sharedInputJobCounts.begin();
+      iterator != sharedInputJobCounts.end();
+    ) {
+      if(iterator->second < 2) {
+        iterator = sharedInputJobCounts.erase(iterator);
+      } else {
+        ++iterator;
+      }
+    }
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  void BatchTranscoder::transcoderEnded() {
+    {
+      std::lock_guard<std::mutex> endedTranscoderScope(this->endedTranscoderMutex);
+      ++this->endedTranscoderCount;
+    }
+    this->endedTranscoderCondition.notify_one();
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+} // namespace Nuclex::OpusTranscoder::Services
@@ -0,0 +1,205 @@
+#pragma region Apache License 2.0
+/*
+Nuclex Opus Transcoder
+Copyright (C) 2024 Markus Ewald / Nuclex Development Labs
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#pragma endregion // Apache License 2.0
+
+#ifndef NUCLEX_OPUSTRANSCODER_SERVICES_BATCHTRANSCODER_H
+#define NUCLEX_OPUSTRANSCODER_SERVICES_BATCHTRANSCODER_H
+
+#include "../Config.h"
+
+#include <Nuclex/Support/Events/ConcurrentEvent.h> // for ConcurrentEvent
+#include <Nuclex/Support/Events/Delegate.h> // for Delegate
+#include <Nuclex/Audio/TrackInfo.h> // for TrackInfo
+
+#include <memory> // for std::shared_ptr
+#include <mutex> // for std::mutex
+#include <condition_variable> // for std::condition_variable
+#include <optional> // for std::optional
+#include <map> // for std::map
+#include <string> // for std::string
+#include <vector> // for std::vector
+#include <cstdint> // for std::uint64_t
+
+namespace Nuclex::Audio::Storage {
+
+  // ------------------------------------------------------------------------------------------- //
+
+  class AudioLoader;
+  class VirtualFile;
+
+  // ------------------------------------------------------------------------------------------- //
+
+} // namespace Nuclex::Audio::Storage
+
+namespace Nuclex::OpusTranscoder::Services {
+
+  // ------------------------------------------------------------------------------------------- //
+
+  class MetadataCache;
+  class Transcoder;
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Input and output file of a transcode in a batch and how it went</summary>
+  struct BatchJob {
+
+    /// <summary>Path to the audio file that will be transcoded</summary>
+    public: std::string InputPath;
+    /// <summary>Path where the produced Opus file will be saved</summary>
+    public: std::string OutputPath;
+    /// <summary>Zero-based index of the input file's track that will be transcoded</summary>
+    public: std::size_t TrackIndex;
+    /// <summary>Memory the transcode is expected to need at its peak, in bytes</summary>
+    public: std::uint64_t MemoryFootprint;
+    /// <summary>Whether the transcode succeeded, nothing if it didn't run yet</summary>
+    public: std::optional<bool> Outcome;
+    /// <summary>Final status message of the transcoder or why the job failed</summary>
+    public: std::string Message;
+    /// <summary>Timings and memory use of the job as JSON, empty if it never ran</summary>
+    public: std::string PerformanceReport;
+
+  };
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Transcodes many audio files in parallel within a memory budget</summary>
+  /// <remarks>
+  ///   <para>
+  ///     Each job runs in its own <see cref="Transcoder" />. Before anything starts,
+  ///     the metadata of all input files is read and each job's peak memory use is
+  ///     estimated from its length, channel count and the settings it will use.
+  ///   </para>
+  ///   <para>
+  ///     Jobs are then started largest first, as long as a transcoder is free and the job
+  ///     fits into what's left of the memory budget. When a large job doesn't fit, smaller
+  ///     ones that do fill the remaining transcoders, so a few long iterative declipping
+  ///     jobs can't exhaust memory while short stereo tracks keep the other cores busy.
+  ///     A job that is too large for the budget on its own runs when nothing else does.
+  ///   </para>
+  ///   <para>
+  ///     Several jobs can extract different tracks from the same input file. Such an input
+  ///     is read into memory once, when the first of its jobs starts, and shared by all
+  ///     transcoders working on its tracks, which run in parallel like any other jobs.
+  ///   </para>
+  ///   <para>
+  ///     How many jobs run in parallel and how many threads each may keep busy comes
+  ///     from the <see cref="SchedulingPolicy" /> unless set explicitly.
+  ///   </para>
+  /// </remarks>
+  class BatchTranscoder {
+
+    /// <summary>Applies the settings a job should be transcoded with</summary>
+    /// <remarks>
+    ///   Receives the transcoder that will run the job and the metadata of the job's
+    ///   input file, so settings such as the output layout can depend on the input.
+    /// </remarks>
+    public: typedef Nuclex::Support::Events::Delegate<
+      void(Transcoder &, const Nuclex::Audio::TrackInfo &)
+    > ConfigureDelegate;
+
+    /// <summary>Fired when a job has ended, with the index of the job</summary>
+    /// <remarks>
+    ///   This is fired on the thread that called <see cref="Run" />, so it's safe
+    ///   to look the job up in the list returned by <see cref="GetJobs" />.
+    /// </remarks>
+    public: Nuclex::Support::Events::ConcurrentEvent<void(std::size_t)> JobEnded;
+
+    /// <summary>Initializes a new batch transcoder</summary>
+    /// <param name="loader">Audio loader used to read the input files</param>
+    public: BatchTranscoder(const std::shared_ptr<Nuclex::Audio::Storage::AudioLoader> &loader);
+    /// <summary>Frees all resources owned by the batch transcoder</summary>
+    public: ~BatchTranscoder();
+
+    /// <summary>Sets the maximum number of transcodes that run at the same time</summary>
+    /// <param name="jobCount">
+    ///   Number of transcodes that may run in parallel, 0 to use the scheduling policy's
+    /// </param>
+    public: void SetMaximumParallelJobCount(std::size_t jobCount);
+
+    /// <summary>Sets the amount of memory all running transcodes may use together</summary>
+    /// <param name="byteCount">Memory budget for all running transcodes, in bytes</param>
+    public: void SetMemoryBudget(std::uint64_t byteCount);
+
+    /// <summary>Adds a file that should be transcoded to the batch</summary>
+    /// <param name="inputPath">Path to the audio file that will be transcoded</param>
+    /// <param name="outputPath">Path where the produced Opus file will be saved</param>
+    /// <param name="trackIndex">Zero-based index of the track that will be transcoded</param>
+    public: void AddJob(
+      const std::string &inputPath, const std::string &outputPath, std::size_t trackIndex = 0
+    );
+
+    /// <summary>Provides the jobs in the batch along with their outcomes</summary>
+    /// <returns>All jobs in the order they were added</returns>
+    public: const std::vector<BatchJob> &GetJobs() const { return this->jobs; }
+
+    /// <summary>Accesses the cache holding the metadata of the input files</summary>
+    /// <returns>The metadata cache shared by all jobs in the batch</returns>
+    /// <remarks>
+    ///   Input files whose metadata is read through this cache before the batch runs,
+    ///   for example to count their tracks, don't have their headers read again.
+    /// </remarks>
+    public: const std::shared_ptr<MetadataCache> &GetMetadataCache() const {
+      return this->metadataCache;
+    }
+
+    /// <summary>Transcodes all files in the batch, returning when all have ended</summary>
+    /// <param name="configure">Applies the settings to the transcoder of each job</param>
+    /// <returns>The number of jobs that failed</returns>
+    public: std::size_t Run(const ConfigureDelegate &configure);
+
+    /// <summary>Reads the input files' metadata and estimates their memory use</summary>
+    /// <param name="configure">Applies the settings to the transcoder of each job</param>
+    /// <param name="probe">Transcoder that will be configured to estimate memory use</param>
+    /// <param name="trackInfos">Receives the metadata of each job's input file</param>
+    /// <param name="sharedInputJobCounts">
+    ///   Receives the number of jobs for each input file that more than one job uses
+    /// </param>
+    private: void planJobs(
+      const ConfigureDelegate &configure, Transcoder &probe,
+      std::vector<Nuclex::Audio::TrackInfo> &trackInfos,
+      std::map<std::string, std::size_t> &sharedInputJobCounts
+    );
+
+    /// <summary>Called by the transcoders when they've finished a job</summary>
+    private: void transcoderEnded();
+
+    /// <summary>Handles loading and decoding of audio files</summary>
+    private: std::shared_ptr<Nuclex::Audio::Storage::AudioLoader> loader;
+    /// <summary>Remembers the metadata of the input files once it has been read</summary>
+    private: std::shared_ptr<MetadataCache> metadataCache;
+    /// <summary>Maximum number of transcodes running at the same time, 0 for default</summary>
+    private: std::size_t maximumParallelJobCount;
+    /// <summary>Memory all running transcodes may use together, in bytes</summary>
+    private: std::uint64_t memoryBudget;
+    /// <summary>Jobs in the batch in the order they were added</summary>
+    private: std::vector<BatchJob> jobs;
+
+    /// <summary>Must be held while accessing the ended transcoder count</summary>
+    private: std::mutex endedTranscoderMutex;
+    /// <summary>Signalled when a transcoder has ended a job</summary>
+    private: std::condition_variable endedTranscoderCondition;
+    /// <summary>Number of transcoders that ended a job not collected yet</summary>
+    private: std::size_t endedTranscoderCount;
+
+  };
+
+  // ------------------------------------------------------------------------------------------- //
+
+} // namespace Nuclex::OpusTranscoder::Services
+
+#endif // NUCLEX_OPUSTRANSCODER_SERVICES_BATCHTRANSCODER_H
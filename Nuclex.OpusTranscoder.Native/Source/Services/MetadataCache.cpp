@@ -0,0 +1,377 @@
+#pragma region Apache License 2.0
+/*
+Nuclex Opus Transcoder
+Copyright (C) 2024 Markus Ewald / Nuclex Development Labs
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#pragma endregion // Apache License 2.0
+
+// If the application is compiled as a DLL, this ensures symbols are exported
+#define NUCLEX_CRIUGUI_SOURCE 1
+
+#include "./MetadataCache.h"
+
+#include "../Audio/WorkPartitioner.h"
+#include "../Audio/LittleEndian.h"
+
+#include <Nuclex/Support/Threading/StopToken.h>
+#include <Nuclex/Support/Threading/ThreadPool.h>
+
+#include <Nuclex/Audio/Storage/AudioLoader.h>
+
+#include <algorithm> // for std::sort(), std::min()
+#include <atomic> // for std::atomic
+#include <functional> // for std::ref(), std::cref()
+#include <future> // for std::future
+#include <stdexcept> // for std::runtime_error
+
+#include <QDateTime>
+#include <QDir>
+#include <QFileInfo>
+
+namespace {
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Bytes at the start of a saved cache, the last one is the format version</summary>
+  const std::uint8_t CacheSignature[8] = { 'N', 'X', 'M', 'E', 'T', 'A', 'C', 1 };
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Number of files that are read at the same time while prefetching</summary>
+  /// <remarks>
+  ///   Reading the headers is mostly waiting for the disk or network, so a few requests
+  ///   in flight hide the latency. Many more would just queue up on a network share
+  ///   and keep the worker threads from more useful work.
+  /// </remarks>
+  const std::size_t PrefetchConcurrency = 4;
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Reads the metadata of files until all are read or the job is canceled</summary>
+  /// <param name="cache">Cache the metadata will be stored in</param>
+  /// <param name="loader">Audio loader that will read the files</param>
+  /// <param name="paths">Paths of all files that are being prefetched</param>
+  /// <param name="nextPathIndex">Index of the next path no worker has taken yet</param>
+  /// <param name="canceler">Token by which the operation can be signalled to cancel</param>
+  void prefetchFiles(
+    Nuclex::OpusTranscoder::Services::MetadataCache &cache,
+    const Nuclex::Audio::Storage::AudioLoader &loader,
+    const std::vector<std::string> &paths,
+    std::atomic<std::size_t> &nextPathIndex,
+    const std::shared_ptr<const Nuclex::Support::Threading::StopToken> &canceler
+  ) {
+    while(!canceler->IsCanceled()) {
+      std::size_t pathIndex = nextPathIndex.fetch_add(1, std::memory_order_relaxed);
+      if(paths.size() <= pathIndex) {
+        break;
+      }
+
+      // A file that can't be read now will be tried again when it's selected,
+      // which also gets the error in front of the user at the right moment
+      try {
+        cache.ReadInfo(loader, paths[pathIndex]);
+      }
+      catch(const std::exception &) {}
+    }
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+} // anonymous namespace
+
+namespace Nuclex::OpusTranscoder::Services {
+
+  // ------------------------------------------------------------------------------------------- //
+
+  // Each entry is a few dozen bytes, so this keeps the saved cache well below a MiB
+  // while still covering the last couple of albums or directories browsed
+  const std::size_t MetadataCache::MaximumSavedEntryCount = 16384;
+
+  // ------------------------------------------------------------------------------------------- //
+
+  MetadataCache::MetadataCache() :
+    entryAccessMutex(),
+    entries(),
+    nextSequenceNumber(0) {}
+
+  // ------------------------------------------------------------------------------------------- //
+
+  MetadataCache::~MetadataCache() {}
+
+  // ------------------------------------------------------------------------------------------- //
+
+  std::optional<Nuclex::Audio::ContainerInfo> MetadataCache::ReadInfo(
+    const Nuclex::Audio::Storage::AudioLoader &loader, const std::string &path
+  ) {
+    std::string key;
+    Entry entry;
+    if(!tryStatFile(path, key, entry)) {
+      return loader.TryReadInfo(path); // Let the loader report what's wrong
+    }
+
+    {
+      std::lock_guard<std::mutex> entryAccessScope(this->entryAccessMutex);
+
+      std::unordered_map<std::string, Entry>::const_iterator iterator = this->entries.find(key);
+      bool isCurrent = (
+        (iterator != this->entries.end()) &&
+        (iterator->second.FileSize == entry.FileSize) &&
+        (iterator->second.ModificationTime == entry.ModificationTime)
+      );
+      if(isCurrent) {
+        return iterator->second.Metadata;
+      }
+    }
+
+    // The size and modification time were taken before reading, so if the file
+    // is changed while it's being read, the entry will already be outdated
+    entry.Metadata = loader.TryReadInfo(path);
+    {
+      std::lock_guard<std::mutex> entryAccessScope(this->entryAccessMutex);
+
+      entry.SequenceNumber = this->nextSequenceNumber++;
+      this->entries.insert_or_assign(key, entry);
+    }
+
+    return entry.Metadata;
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  bool MetadataCache::TryLookup(
+    const std::string &path, std::optional<Nuclex::Audio::ContainerInfo> &metadata
+  ) const {
+    std::string key;
+    Entry entry;
+    if(!tryStatFile(path, key, entry)) {
+      return false;
+    }
+
+    std::lock_guard<std::mutex> entryAccessScope(this->entryAccessMutex);
+
+    std::unordered_map<std::string, Entry>::const_iterator iterator = this->entries.find(key);
+    bool isCurrent = (
+      (iterator != this->entries.end()) &&
+      (iterator->second.FileSize == entry.FileSize) &&
+      (iterator->second.ModificationTime == entry.ModificationTime)
+    );
+    if(isCurrent) {
+      metadata = iterator->second.Metadata;
+    }
+
+    return isCurrent;
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  void MetadataCache::Store(
+    const std::string &path, const std::optional<Nuclex::Audio::ContainerInfo> &metadata
+  ) {
+    std::string key;
+    Entry entry;
+    if(!tryStatFile(path, key, entry)) {
+      return;
+    }
+
+    entry.Metadata = metadata;
+    {
+      std::lock_guard<std::mutex> entryAccessScope(this->entryAccessMutex);
+
+      entry.SequenceNumber = this->nextSequenceNumber++;
+      this->entries.insert_or_assign(key, std::move(entry));
+    }
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  void MetadataCache::Prefetch(
+    const Nuclex::Audio::Storage::AudioLoader &loader,
+    const std::vector<std::string> &paths,
+    Nuclex::Support::Threading::ThreadPool &threadPool,
+    const std::shared_ptr<const Nuclex::Support::Threading::StopToken> &canceler
+  ) {
+    std::size_t workerCount = std::min(PrefetchConcurrency, paths.size());
+    std::atomic<std::size_t> nextPathIndex(0);
+
+    std::vector<std::future<void>> futures;
+    futures.reserve(workerCount);
+    try {
+      for(std::size_t workerIndex = 0; workerIndex < workerCount; ++workerIndex) {
+        futures.push_back(
+          threadPool.Schedule(
+            &prefetchFiles,
+            std::ref(*this), std::cref(loader), std::cref(paths),
+            std::ref(nextPathIndex), canceler
+          )
+        );
+      }
+    }
+    catch(const std::exception &) {
+      Audio::WorkPartitioner::WaitForAll(futures); // they reference our path list
+      throw;
+    }
+
+    Audio::WorkPartitioner::WaitForAll(futures);
+    for(std::size_t workerIndex = 0; workerIndex < workerCount; ++workerIndex) {
+      futures[workerIndex].get();
+    }
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  void MetadataCache::Load(const std::vector<std::byte> &contents) {
+    {
+      std::lock_guard<std::mutex> entryAccessScope(this->entryAccessMutex);
+      this->entries.clear();
+    }
+
+    Audio::LittleEndianReader reader(contents, u8"Metadata cache is truncated");
+    for(std::size_t index = 0; index < sizeof(CacheSignature); ++index) {
+      if(reader.Read<std::uint8_t>() != CacheSignature[index]) {
+        throw std::runtime_error(u8"Not a metadata cache or unsupported version");
+      }
+    }
+
+    std::unordered_map<std::string, Entry> loadedEntries;
+    std::uint64_t sequenceNumber = 0;
+    try {
+      std::uint32_t entryCount = reader.Read<std::uint32_t>();
+      for(std::uint32_t entryIndex = 0; entryIndex < entryCount; ++entryIndex) {
+        std::string key = reader.ReadString();
+
+        Entry entry;
+        entry.FileSize = reader.Read<std::uint64_t>();
+        entry.ModificationTime = static_cast<std::int64_t>(
+          reader.Read<std::uint64_t>()
+        );
+        entry.SequenceNumber = sequenceNumber++;
+
+        if(reader.Read<std::uint8_t>() != 0) {
+          Nuclex::Audio::ContainerInfo metadata = Nuclex::Audio::ContainerInfo();
+
+          std::uint32_t trackCount = reader.Read<std::uint32_t>();
+          for(std::uint32_t trackIndex = 0; trackIndex < trackCount; ++trackIndex) {
+            Nuclex::Audio::TrackInfo track = Nuclex::Audio::TrackInfo();
+            track.ChannelCount = reader.Read<std::uint32_t>();
+            track.ChannelPlacements = static_cast<Nuclex::Audio::ChannelPlacement>(
+              reader.Read<std::uint64_t>()
+            );
+            track.SampleRate = reader.Read<std::uint32_t>();
+            track.Duration = std::chrono::microseconds(
+              static_cast<std::int64_t>(reader.Read<std::uint64_t>())
+            );
+            metadata.Tracks.push_back(std::move(track));
+          }
+
+          entry.Metadata = std::move(metadata);
+        }
+
+        loadedEntries.insert_or_assign(std::move(key), std::move(entry));
+      } // for each entry
+
+      if(!reader.IsAtEnd()) {
+        throw std::runtime_error(u8"Metadata cache has trailing garbage");
+      }
+    }
+    catch(const std::bad_alloc &) {
+      throw std::runtime_error(u8"Metadata cache is damaged");
+    }
+
+    {
+      std::lock_guard<std::mutex> entryAccessScope(this->entryAccessMutex);
+      this->entries.swap(loadedEntries);
+      this->nextSequenceNumber = sequenceNumber;
+    }
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  std::vector<std::byte> MetadataCache::Save() const {
+    using Audio::LittleEndian;
+
+    std::vector<std::byte> contents;
+
+    for(std::size_t index = 0; index < sizeof(CacheSignature); ++index) {
+      contents.push_back(static_cast<std::byte>(CacheSignature[index]));
+    }
+
+    std::lock_guard<std::mutex> entryAccessScope(this->entryAccessMutex);
+
+    // Saved oldest first, so the sequence numbers come back in the same order on load
+    typedef std::unordered_map<std::string, Entry>::const_iterator EntryIterator;
+    std::vector<EntryIterator> savedEntries;
+    savedEntries.reserve(this->entries.size());
+    for(
+      EntryIterator iterator = this->entries.begin();
+      iterator != this->entries.end();
+      ++iterator
+    ) {
+      savedEntries.push_back(iterator);
+    }
+    std::sort(
+      savedEntries.begin(), savedEntries.end(),
+      [](const EntryIterator &left, const EntryIterator &right) {
+        return left->second.SequenceNumber < right->second.SequenceNumber;
+      }
+    );
+    if(MaximumSavedEntryCount < savedEntries.size()) {
+      savedEntries.erase(
+        savedEntries.begin(), savedEntries.end() - MaximumSavedEntryCount
+      );
+    }
+
+    LittleEndian::Append(contents, static_cast<std::uint32_t>(savedEntries.size()));
+    for(const EntryIterator &iterator : savedEntries) {
+      const Entry &entry = iterator->second;
+      LittleEndian::AppendString(contents, iterator->first);
+      LittleEndian::Append(contents, entry.FileSize);
+      LittleEndian::Append(contents, static_cast<std::uint64_t>(entry.ModificationTime));
+
+      LittleEndian::Append(contents, static_cast<std::uint8_t>(entry.Metadata.has_value()));
+      if(entry.Metadata.has_value()) {
+        const std::vector<Nuclex::Audio::TrackInfo> &tracks = entry.Metadata.value().Tracks;
+        LittleEndian::Append(contents, static_cast<std::uint32_t>(tracks.size()));
+        for(const Nuclex::Audio::TrackInfo &track : tracks) {
+          LittleEndian::Append(contents, static_cast<std::uint32_t>(track.ChannelCount));
+          LittleEndian::Append(contents, static_cast<std::uint64_t>(track.ChannelPlacements));
+          LittleEndian::Append(contents, static_cast<std::uint32_t>(track.SampleRate));
+          LittleEndian::Append(contents, static_cast<std::uint64_t>(track.Duration.count()));
+        }
+      }
+    } // for each entry
+
+    return contents;
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  bool MetadataCache::tryStatFile(const std::string &path, std::string &key, Entry &entry) {
+    QFileInfo fileInfo(QString::fromStdString(path));
+    if(!fileInfo.isFile()) {
+      return false;
+    }
+
+    // The main window passes paths with native separators while directory listings
+    // use forward slashes, so the key is formed from the cleaned, absolute path
+    key = QDir::cleanPath(fileInfo.absoluteFilePath()).toStdString();
+    entry.FileSize = static_cast<std::uint64_t>(fileInfo.size());
+    entry.ModificationTime = fileInfo.lastModified().toMSecsSinceEpoch();
+
+    return true;
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+} // namespace Nuclex::OpusTranscoder::Services
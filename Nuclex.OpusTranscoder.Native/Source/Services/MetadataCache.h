@@ -0,0 +1,187 @@
+#pragma region Apache License 2.0
+/*
+Nuclex Opus Transcoder
+Copyright (C) 2024 Markus Ewald / Nuclex Development Labs
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#pragma endregion // Apache License 2.0
+
+#ifndef NUCLEX_OPUSTRANSCODER_SERVICES_METADATACACHE_H
+#define NUCLEX_OPUSTRANSCODER_SERVICES_METADATACACHE_H
+
+#include "../Config.h"
+
+#include <Nuclex/Audio/TrackInfo.h> // for ContainerInfo
+
+#include <memory> // for std::shared_ptr
+#include <mutex> // for std::mutex
+#include <optional> // for std::optional
+#include <string> // for std::string
+#include <unordered_map> // for std::unordered_map
+#include <vector> // for std::vector
+#include <cstddef> // for std::byte
+#include <cstdint> // for std::uint64_t
+
+namespace Nuclex::Support::Threading {
+
+  // ------------------------------------------------------------------------------------------- //
+
+  class StopToken;
+  class ThreadPool;
+
+  // ------------------------------------------------------------------------------------------- //
+
+} // namespace Nuclex::Support::Threading
+
+namespace Nuclex::Audio::Storage {
+
+  // ------------------------------------------------------------------------------------------- //
+
+  class AudioLoader;
+
+  // ------------------------------------------------------------------------------------------- //
+
+} // namespace Nuclex::Audio::Storage
+
+namespace Nuclex::OpusTranscoder::Services {
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Remembers the metadata of audio files so their headers are read only once</summary>
+  /// <remarks>
+  ///   <para>
+  ///     Entries are keyed by the absolute path of the audio file and remember the file's
+  ///     size and modification time. When either has changed, the entry is ignored and
+  ///     the file is read again. Files that turned out not to be audio files are cached
+  ///     as well, so browsing a directory doesn't keep probing them.
+  ///   </para>
+  ///   <para>
+  ///     All methods can be called from any thread. Reading a file's metadata happens
+  ///     outside of the lock, so several threads can fill the cache at the same time.
+  ///   </para>
+  /// </remarks>
+  class MetadataCache {
+
+    /// <summary>Maximum number of entries that are saved when the cache is persisted</summary>
+    public: static const std::size_t MaximumSavedEntryCount;
+
+    /// <summary>Initializes a new, empty metadata cache</summary>
+    public: MetadataCache();
+    /// <summary>Frees all resources owned by the metadata cache</summary>
+    public: ~MetadataCache();
+
+    /// <summary>Looks up the metadata of an audio file or reads and caches it</summary>
+    /// <param name="loader">Audio loader that will read the file if it isn't cached</param>
+    /// <param name="path">Path of the audio file whose metadata will be provided</param>
+    /// <returns>The metadata of the audio file or nothing if it isn't an audio file</returns>
+    /// <remarks>
+    ///   Errors from the audio loader are passed on and don't go into the cache,
+    ///   so a file that couldn't be accessed is tried again next time.
+    /// </remarks>
+    public: std::optional<Nuclex::Audio::ContainerInfo> ReadInfo(
+      const Nuclex::Audio::Storage::AudioLoader &loader, const std::string &path
+    );
+
+    /// <summary>Looks up the metadata of an audio file without reading it</summary>
+    /// <param name="path">Path of the audio file whose metadata will be looked up</param>
+    /// <param name="metadata">
+    ///   Receives the cached metadata, nothing if the file isn't an audio file
+    /// </param>
+    /// <returns>True if the file was in the cache and hasn't changed since</returns>
+    public: bool TryLookup(
+      const std::string &path, std::optional<Nuclex::Audio::ContainerInfo> &metadata
+    ) const;
+
+    /// <summary>Records the metadata of an audio file that was read elsewhere</summary>
+    /// <param name="path">Path of the audio file the metadata belongs to</param>
+    /// <param name="metadata">Metadata of the file, nothing if it isn't an audio file</param>
+    /// <remarks>
+    ///   The file's size and modification time are taken now, so this should be called
+    ///   right after reading the metadata. Does nothing if the file doesn't exist.
+    /// </remarks>
+    public: void Store(
+      const std::string &path, const std::optional<Nuclex::Audio::ContainerInfo> &metadata
+    );
+
+    /// <summary>Reads the metadata of several audio files in parallel</summary>
+    /// <param name="loader">Audio loader that will read the files</param>
+    /// <param name="paths">Paths of the audio files whose metadata will be cached</param>
+    /// <param name="threadPool">Thread pool the files will be read on</param>
+    /// <param name="canceler">Token by which the operation can be signalled to cancel</param>
+    /// <remarks>
+    ///   Files that are already cached are skipped. Only a few files are read at the same
+    ///   time, so a network share isn't flooded with requests. Files that can't be read
+    ///   are left out of the cache without failing the others. Returns when all files
+    ///   have been read or, at the latest, when the current ones are done after canceling.
+    /// </remarks>
+    public: void Prefetch(
+      const Nuclex::Audio::Storage::AudioLoader &loader,
+      const std::vector<std::string> &paths,
+      Nuclex::Support::Threading::ThreadPool &threadPool,
+      const std::shared_ptr<const Nuclex::Support::Threading::StopToken> &canceler
+    );
+
+    /// <summary>Replaces the cached entries with ones saved earlier</summary>
+    /// <param name="contents">Saved cache contents that will be read</param>
+    /// <remarks>
+    ///   Throws a <see cref="std::runtime_error" /> if the contents are damaged or
+    ///   in an unsupported format, in which case the cache is left empty. The saved
+    ///   entries only keep the properties of the tracks that the transcoder uses,
+    ///   any others come back default-initialized.
+    /// </remarks>
+    public: void Load(const std::vector<std::byte> &contents);
+
+    /// <summary>Saves the cached entries so they can be loaded again later</summary>
+    /// <returns>The saved cache contents</returns>
+    /// <remarks>
+    ///   If there are more than <see cref="MaximumSavedEntryCount" /> entries,
+    ///   only the most recently stored ones are saved.
+    /// </remarks>
+    public: std::vector<std::byte> Save() const;
+
+    /// <summary>What the cache knows about an audio file</summary>
+    private: struct Entry {
+
+      /// <summary>Size of the file in bytes when its metadata was read</summary>
+      public: std::uint64_t FileSize;
+      /// <summary>Modification time of the file in milliseconds since the epoch</summary>
+      public: std::int64_t ModificationTime;
+      /// <summary>Order in which the entries were stored, to keep the newest ones</summary>
+      public: std::uint64_t SequenceNumber;
+      /// <summary>Metadata of the file, nothing if it isn't an audio file</summary>
+      public: std::optional<Nuclex::Audio::ContainerInfo> Metadata;
+
+    };
+
+    /// <summary>Forms the key and checks the size and modification time of a file</summary>
+    /// <param name="path">Path of the file that will be checked</param>
+    /// <param name="key">Receives the key under which the file is cached</param>
+    /// <param name="entry">Receives the size and modification time of the file</param>
+    /// <returns>True if the file exists, false otherwise</returns>
+    private: static bool tryStatFile(const std::string &path, std::string &key, Entry &entry);
+
+    /// <summary>Must be held when accessing the entries</summary>
+    private: mutable std::mutex entryAccessMutex;
+    /// <summary>Cached metadata by the absolute path of the audio file</summary>
+    private: std::unordered_map<std::string, Entry> entries;
+    /// <summary>Sequence number that will be given to the next stored entry</summary>
+    private: std::uint64_t nextSequenceNumber;
+
+  };
+
+  // ------------------------------------------------------------------------------------------- //
+
+} // namespace Nuclex::OpusTranscoder::Services
+
+#endif // NUCLEX_OPUSTRANSCODER_SERVICES_METADATACACHE_H
@@ -21,17 +21,30 @@ limitations under the License.
 #define NUCLEX_CRIUGUI_SOURCE 1
 
 #include "./MetadataReader.h"
+#include "./MetadataCache.h"
+#include "./SchedulingPolicy.h"
 
 #include <Nuclex/Support/Threading/StopToken.h>
 #include <Nuclex/Support/Threading/Thread.h>
 
 #include <Nuclex/Audio/Storage/AudioLoader.h>
 
+#include <vector> // for std::vector
+
 #include <QDir>
+#include <QFileInfo>
 
 namespace {
 
   // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>File name patterns of the audio files that will be prefetched</summary>
+  /// <remarks>
+  ///   These match the supported audio files in the main window's file dialog.
+  ///   Other files aren't probed, a directory can hold large images or videos, too.
+  /// </remarks>
+  const char *const AudioFilePatterns[] = { u8"*.wv", u8"*.wav", u8"*.flac" };
+
   // ------------------------------------------------------------------------------------------- //
 
 } // anonymous namespace
@@ -41,9 +54,14 @@ namespace Nuclex::OpusTranscoder::Services {
   // ------------------------------------------------------------------------------------------- //
 
   MetadataReader::MetadataReader(
-    const std::shared_ptr<Nuclex::Audio::Storage::AudioLoader> &loader
+    const std::shared_ptr<Nuclex::Audio::Storage::AudioLoader> &loader,
+    const std::shared_ptr<MetadataCache> &cache
   ) :
     loader(loader),
+    cache(cache),
+    threadPool(SchedulingPolicy::GetSharedThreadPool()),
+    prefetch(NUCLEX_OPUSTRANSCODER_PREFETCH_METADATA != 0),
+    prefetchedDirectory(),
     metadataAccessMutex(),
     path(),
     metadata() {}
@@ -79,6 +97,12 @@ namespace Nuclex::OpusTranscoder::Services {
 
   // ------------------------------------------------------------------------------------------- //
 
+  void MetadataReader::EnableDirectoryPrefetch(bool enable /* = true */) {
+    this->prefetch = enable;
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
   void MetadataReader::DoWork(
     const std::shared_ptr<const Nuclex::Support::Threading::StopToken> &canceler
   ) {
@@ -88,7 +112,7 @@ namespace Nuclex::OpusTranscoder::Services {
       path.swap(this->path);
     }
 
-    std::optional<Audio::ContainerInfo> metadata = this->loader->TryReadInfo(path);
+    std::optional<Audio::ContainerInfo> metadata = this->cache->ReadInfo(*this->loader, path);
     {
       std::unique_lock<std::mutex> metadataAccessScope(this->metadataAccessMutex);
 
@@ -104,6 +128,48 @@ namespace Nuclex::OpusTranscoder::Services {
     }
 
     this->Updated.Emit();
+
+    // The metadata of the selected file is out, so use the remaining time to read
+    // the files the user is likely to pick next. Selecting another file cancels this,
+    // the files that were read by then stay in the cache.
+    if(this->prefetch && !path.empty()) {
+      prefetchDirectory(path, canceler);
+    }
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  void MetadataReader::prefetchDirectory(
+    const std::string &path,
+    const std::shared_ptr<const Nuclex::Support::Threading::StopToken> &canceler
+  ) {
+    QString directory = QFileInfo(QString::fromStdString(path)).absolutePath();
+    if(directory.toStdString() == this->prefetchedDirectory) {
+      return;
+    }
+
+    QStringList nameFilters;
+    for(const char *pattern : AudioFilePatterns) {
+      nameFilters.append(QString(pattern));
+    }
+
+    QFileInfoList directoryFiles = QDir(directory).entryInfoList(
+      nameFilters, QDir::Files | QDir::Readable, QDir::Name
+    );
+
+    std::vector<std::string> paths;
+    paths.reserve(static_cast<std::size_t>(directoryFiles.size()));
+    for(const QFileInfo &fileInfo : directoryFiles) {
+      paths.push_back(fileInfo.absoluteFilePath().toStdString());
+    }
+
+    this->cache->Prefetch(*this->loader, paths, *this->threadPool, canceler);
+
+    // Only remember the directory if all of it was read, otherwise the next file
+    // selected in it picks up where this left off
+    if(!canceler->IsCanceled()) {
+      this->prefetchedDirectory = directory.toStdString();
+    }
   }
 
   // ------------------------------------------------------------------------------------------- //
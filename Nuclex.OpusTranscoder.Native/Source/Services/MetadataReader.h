@@ -28,6 +28,17 @@ limitations under the License.
 
 #include <memory> // for std::shared_ptr
 #include <mutex> // for std::mutex
+#include <string> // for std::string
+
+namespace Nuclex::Support::Threading {
+
+  // ------------------------------------------------------------------------------------------- //
+
+  class ThreadPool;
+
+  // ------------------------------------------------------------------------------------------- //
+
+} // namespace Nuclex::Support::Threading
 
 namespace Nuclex::Audio::Storage {
 
@@ -43,6 +54,10 @@ namespace Nuclex::OpusTranscoder::Services {
 
   // ------------------------------------------------------------------------------------------- //
 
+  class MetadataCache;
+
+  // ------------------------------------------------------------------------------------------- //
+
   /// <summary>Reads the metadata of audio files in the background</summary>
   class MetadataReader : public Nuclex::Support::Threading::ConcurrentJob {
 
@@ -52,7 +67,12 @@ namespace Nuclex::OpusTranscoder::Services {
     // ----------------------------------------------------------------------------------------- //
 
     /// <summary>Initializes a new audio metadata reader</summary>
-    public: MetadataReader(const std::shared_ptr<Nuclex::Audio::Storage::AudioLoader> &loader);
+    /// <param name="loader">Audio loader used to read the audio files</param>
+    /// <param name="cache">Cache in which the metadata of read files is kept</param>
+    public: MetadataReader(
+      const std::shared_ptr<Nuclex::Audio::Storage::AudioLoader> &loader,
+      const std::shared_ptr<MetadataCache> &cache
+    );
     /// <summary>Stops the checking thread and frees all resources</summary>
     public: ~MetadataReader() override;
 
@@ -70,6 +90,16 @@ namespace Nuclex::OpusTranscoder::Services {
     /// <returns>The most recently analyzed file's metadata</returns>
     public: std::optional<Nuclex::Audio::TrackInfo> GetMetadata() const;
 
+    /// <summary>Enables reading the metadata of all audio files in the same directory</summary>
+    /// <param name="enable">True to prefetch the metadata of neighbouring files</param>
+    /// <remarks>
+    ///   After an audio file has been analyzed, the other audio files in its directory
+    ///   are read into the metadata cache in the background, so picking the next file
+    ///   of an album shows its metadata right away, even on a slow network share.
+    ///   This is set up in Config.h and on by default.
+    /// </remarks>
+    public: void EnableDirectoryPrefetch(bool enable = true);
+
     // ----------------------------------------------------------------------------------------- //
 
     /// <summary>Called in the background thread to perform the actual work</summary>
@@ -80,15 +110,33 @@ namespace Nuclex::OpusTranscoder::Services {
 
     // ----------------------------------------------------------------------------------------- //
 
+    /// <summary>Reads the metadata of the audio files in the analyzed file's directory</summary>
+    /// <param name="path">Path of the audio file that was analyzed</param>
+    /// <param name="canceler">Token by which the operation can be signalled to cancel</param>
+    private: void prefetchDirectory(
+      const std::string &path,
+      const std::shared_ptr<const Nuclex::Support::Threading::StopToken> &canceler
+    );
+
+    // ----------------------------------------------------------------------------------------- //
+
     /// <summary>Handles loading and decoding of audio files</summary>
     private: std::shared_ptr<Nuclex::Audio::Storage::AudioLoader> loader;
+    /// <summary>Remembers the metadata of audio files that have been read before</summary>
+    private: std::shared_ptr<MetadataCache> cache;
+    /// <summary>Process-wide thread pool the neighbouring files are read on</summary>
+    private: std::shared_ptr<Nuclex::Support::Threading::ThreadPool> threadPool;
+    /// <summary>Whether the other audio files in the same directory are read, too</summary>
+    private: bool prefetch;
+    /// <summary>Directory whose audio files have all been read into the cache</summary>
+    private: std::string prefetchedDirectory;
     /// <summary>Must be held when copying or updating the metadata</summary>
     private: mutable std::mutex metadataAccessMutex;
     /// <summary>Path of the file being examined, empty when started/done</summary>
     private: std::string path;
     /// <summary>Metadata for the current audio file, if any</summary>
     private: std::optional<Nuclex::Audio::TrackInfo> metadata;
-  
+
   };
 
   // ------------------------------------------------------------------------------------------- //
@@ -0,0 +1,409 @@
+#pragma region Apache License 2.0
+/*
+Nuclex Opus Transcoder
+Copyright (C) 2024 Markus Ewald / Nuclex Development Labs
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#pragma endregion // Apache License 2.0
+
+// If the application is compiled as a DLL, this ensures symbols are exported
+#define NUCLEX_CRIUGUI_SOURCE 1
+
+#include "./OutputCache.h"
+#include "../Audio/SpanningFile.h"
+#include "../Audio/WordHash.h"
+
+#include <Nuclex/Audio/Storage/VirtualFile.h>
+
+#include <algorithm> // for std::sort()
+#include <utility> // for std::pair
+#include <vector> // for std::vector
+#include <stdexcept> // for std::runtime_error
+
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QStandardPaths>
+
+#if defined(NUCLEX_OPUSTRANSCODER_WINDOWS)
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h> // for ::CreateHardLinkW()
+#else
+#include <unistd.h> // for ::link(), ::close(), ::unlink()
+#include <fcntl.h> // for ::open()
+#include <sys/ioctl.h> // for ::ioctl()
+#include <linux/fs.h> // for FICLONE
+#endif
+
+namespace {
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Number of bytes read from the input file at once while hashing it</summary>
+  const std::size_t HashingChunkSize = 1048576;
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Seconds after which an unfinished entry is assumed to be abandoned</summary>
+  /// <remarks>
+  ///   Entries are copied in under a temporary name first. If a transcoder crashes
+  ///   during that copy, the file is left behind, so old ones get cleaned up.
+  /// </remarks>
+  const int AbandonedEntrySeconds = 3600;
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Suffix appended to an entry's path to form the path of its usage marker</summary>
+  /// <remarks>
+  ///   The marker is an empty file whose modification time records when the entry was
+  ///   last reused. Keeping this out of the entry itself means an output file that is
+  ///   hard-linked to the entry doesn't have its time stamps changed behind the user's back.
+  /// </remarks>
+  const char UsageMarkerSuffix[] = u8".used";
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Creates a hard link to an existing file</summary>
+  /// <param name="existingPath">Path of the file the link will point to</param>
+  /// <param name="linkPath">Path at which the hard link will be created</param>
+  /// <returns>True if the hard link was created, false otherwise</returns>
+  bool createHardLink(const QString &existingPath, const QString &linkPath) {
+#if defined(NUCLEX_OPUSTRANSCODER_WINDOWS)
+    QString nativeExistingPath = QDir::toNativeSeparators(existingPath);
+    QString nativeLinkPath = QDir::toNativeSeparators(linkPath);
+    BOOL result = ::CreateHardLinkW(
+      reinterpret_cast<LPCWSTR>(nativeLinkPath.utf16()),
+      reinterpret_cast<LPCWSTR>(nativeExistingPath.utf16()),
+      nullptr
+    );
+    return (result != FALSE);
+#else
+    int result = ::link(
+      QFile::encodeName(existingPath).constData(), QFile::encodeName(linkPath).constData()
+    );
+    return (result == 0);
+#endif
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Creates a copy-on-write clone of an existing file</summary>
+  /// <param name="existingPath">Path of the file that will be cloned</param>
+  /// <param name="clonePath">Path at which the clone will be created</param>
+  /// <returns>True if the clone was created, false otherwise</returns>
+  /// <remarks>
+  ///   On file systems that support it (Btrfs, XFS), the clone shares the data blocks
+  ///   of the original until either is modified, so it costs no time and no space
+  ///   while still being a separate file. Everywhere else, this fails and the caller
+  ///   has to copy the file.
+  /// </remarks>
+  bool createClone(const QString &existingPath, const QString &clonePath) {
+#if defined(NUCLEX_OPUSTRANSCODER_WINDOWS)
+    (void)existingPath;
+    (void)clonePath;
+    return false;
+#else
+    int sourceDescriptor = ::open(QFile::encodeName(existingPath).constData(), O_RDONLY);
+    if(sourceDescriptor == -1) {
+      return false;
+    }
+
+    QByteArray nativeClonePath = QFile::encodeName(clonePath);
+    int cloneDescriptor = ::open(
+      nativeClonePath.constData(), O_WRONLY | O_CREAT | O_EXCL, 0666
+    );
+    if(cloneDescriptor == -1) {
+      ::close(sourceDescriptor);
+      return false;
+    }
+
+    int result = ::ioctl(cloneDescriptor, FICLONE, sourceDescriptor);
+    ::close(cloneDescriptor);
+    ::close(sourceDescriptor);
+    if(result == -1) {
+      ::unlink(nativeClonePath.constData());
+      return false;
+    }
+
+    return true;
+#endif
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Records that an entry of the output cache has just been reused</summary>
+  /// <param name="entryPath">Path of the entry that has been reused</param>
+  void markAsUsed(const QString &entryPath) {
+    QFile markerFile(entryPath + QString(UsageMarkerSuffix));
+    if(markerFile.open(QIODevice::WriteOnly)) {
+      markerFile.setFileTime(
+        QDateTime::currentDateTime(), QFileDevice::FileTime::FileModificationTime
+      );
+    }
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Appends a 64 bit integer to a string as zero-padded hexadecimal digits</summary>
+  /// <param name="target">String the hexadecimal digits will be appended to</param>
+  /// <param name="value">Value that will be appended</param>
+  void appendHexadecimal(std::string &target, std::uint64_t value) {
+    static const char digits[] = u8"0123456789abcdef";
+    for(int shift = 60; shift >= 0; shift -= 4) {
+      target.push_back(digits[(value >> shift) & 0xf]);
+    }
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+} // anonymous namespace
+
+namespace Nuclex::OpusTranscoder::Services {
+
+  // ------------------------------------------------------------------------------------------- //
+
+  std::uint64_t OutputCache::HashFile(
+    const Nuclex::Audio::Storage::VirtualFile &file,
+    const std::shared_ptr<const Nuclex::Support::Threading::StopToken> &canceler,
+    Nuclex::Support::Events::Delegate<void(float)> &progressCallback
+  ) {
+    std::uint64_t length = file.GetSize();
+
+    // The length goes in first, so a file and the same file with some zero bytes
+    // appended hash differently even though the words they share are identical
+    std::uint64_t hash = Audio::WordHash::HashValue(Audio::WordHash::InitialHash, length);
+
+    // Files that are in memory or memory-mapped are hashed where they are,
+    // others are read into a buffer one chunk at a time
+    const Audio::SpanningFile *spanningFile = dynamic_cast<const Audio::SpanningFile *>(&file);
+
+    std::vector<std::byte> buffer;
+    std::uint64_t offset = 0;
+    while(offset < length) {
+      canceler->ThrowIfCanceled();
+
+      std::size_t chunkSize;
+      if(length - offset < HashingChunkSize) {
+        chunkSize = static_cast<std::size_t>(length - offset);
+      } else {
+        chunkSize = HashingChunkSize;
+      }
+
+      // Since all chunks except the last are whole words, hashing in chunks gives
+      // the same result as hashing the whole file in one call would
+      const std::byte *chunk = nullptr;
+      bool isSpanned = (
+        (spanningFile != nullptr) &&
+        (spanningFile->ReadSpan(offset, chunkSize, chunk) == chunkSize)
+      );
+      if(!isSpanned) {
+        buffer.resize(HashingChunkSize);
+        file.ReadAt(offset, chunkSize, buffer.data());
+        chunk = buffer.data();
+      }
+      hash = Audio::WordHash::HashBytes(hash, chunk, chunkSize);
+
+      offset += chunkSize;
+      progressCallback(static_cast<float>(offset) / static_cast<float>(length));
+    }
+
+    return hash;
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  OutputCache::OutputCache(
+    const std::string &directory /* = NUCLEX_OPUSTRANSCODER_OUTPUT_CACHE_DIRECTORY */
+  ) :
+    directory(directory),
+    sizeLimit(NUCLEX_OPUSTRANSCODER_OUTPUT_CACHE_LIMIT),
+    evictLeastRecentlyUsed(NUCLEX_OPUSTRANSCODER_OUTPUT_CACHE_EVICT_LEAST_RECENTLY_USED != 0),
+    useHardLinks(NUCLEX_OPUSTRANSCODER_OUTPUT_CACHE_HARD_LINKS != 0) {
+
+    if(this->directory.empty()) {
+      QString cacheLocation = QStandardPaths::writableLocation(
+        QStandardPaths::GenericCacheLocation
+      );
+      this->directory = QDir(cacheLocation).filePath(
+        QString(u8"Nuclex.OpusTranscoder/Output")
+      ).toStdString();
+    }
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  bool OutputCache::TryFetch(
+    std::uint64_t inputHash, std::uint64_t settingsHash, const std::string &outputPath
+  ) const {
+    QString entryPath = QDir(QString::fromStdString(this->directory)).filePath(
+      QString::fromStdString(getEntryFilename(inputHash, settingsHash))
+    );
+    if(!QFile::exists(entryPath)) {
+      return false;
+    }
+
+    QString targetPath = QString::fromStdString(outputPath);
+    QFile::remove(targetPath);
+
+    // Hard links and clones only work within the same volume, so if the output path is
+    // elsewhere, the cached file is copied instead. Another transcoder could evict
+    // the entry between the check above and these calls, in which case all simply fail.
+    bool isProvided;
+    if(this->useHardLinks) {
+      isProvided = createHardLink(entryPath, targetPath);
+    } else {
+      isProvided = createClone(entryPath, targetPath);
+    }
+    if(!isProvided) {
+      isProvided = QFile::copy(entryPath, targetPath);
+      if(!isProvided) {
+        QFile::remove(targetPath);
+        return false;
+      }
+    }
+
+    // The entry itself is left alone, it may well be the very file at the output path
+    if(this->evictLeastRecentlyUsed) {
+      markAsUsed(entryPath);
+    }
+
+    return true;
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  void OutputCache::Store(
+    std::uint64_t inputHash, std::uint64_t settingsHash, const std::string &outputPath
+  ) const {
+    QDir cacheDirectory(QString::fromStdString(this->directory));
+    if(!cacheDirectory.mkpath(QString(u8"."))) {
+      throw std::runtime_error(u8"Could not create the output cache directory");
+    }
+
+    QString entryPath = cacheDirectory.filePath(
+      QString::fromStdString(getEntryFilename(inputHash, settingsHash))
+    );
+
+    // The entry is copied under a name unique to this process and renamed when done,
+    // so other transcoders sharing the cache never pick up a partially copied file
+    QString temporaryPath = entryPath + QString(u8".partial-") + QString::number(
+      QCoreApplication::applicationPid()
+    );
+    QFile::remove(temporaryPath);
+    if(!QFile::copy(QString::fromStdString(outputPath), temporaryPath)) {
+      QFile::remove(temporaryPath);
+      throw std::runtime_error(u8"Could not copy the output file into the output cache");
+    }
+
+    QFile::remove(entryPath);
+    if(!QFile::rename(temporaryPath, entryPath)) {
+      QFile::remove(temporaryPath);
+      throw std::runtime_error(u8"Could not add the output file to the output cache");
+    }
+
+    evict();
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  std::string OutputCache::getEntryFilename(std::uint64_t inputHash, std::uint64_t settingsHash) {
+    std::string filename;
+    filename.reserve(38);
+
+    appendHexadecimal(filename, inputHash);
+    filename.push_back(u8'-');
+    appendHexadecimal(filename, settingsHash);
+    filename.append(u8".opus", 5);
+
+    return filename;
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  void OutputCache::evict() const {
+    QDir cacheDirectory(QString::fromStdString(this->directory));
+
+    // Leftovers from transcoders that crashed while adding an entry
+    {
+      QDateTime abandonedTime = QDateTime::currentDateTime().addSecs(-AbandonedEntrySeconds);
+      QFileInfoList partialEntries = cacheDirectory.entryInfoList(
+        QStringList(QString(u8"*.opus.partial-*")), QDir::Files
+      );
+      for(const QFileInfo &partialEntry : partialEntries) {
+        if(partialEntry.lastModified() < abandonedTime) {
+          QFile::remove(partialEntry.filePath());
+        }
+      }
+    }
+
+    // Each entry is dated by the time it was added or, in least recently used mode,
+    // by the time it was last reused if its usage marker is more recent than that
+    QFileInfoList entries = cacheDirectory.entryInfoList(
+      QStringList(QString(u8"*.opus")), QDir::Files
+    );
+
+    typedef std::pair<QDateTime, QFileInfo> DatedEntry;
+    std::vector<DatedEntry> datedEntries;
+    datedEntries.reserve(static_cast<std::size_t>(entries.size()));
+
+    std::uint64_t totalSize = 0;
+    for(const QFileInfo &entry : entries) {
+      totalSize += static_cast<std::uint64_t>(entry.size());
+
+      QDateTime lastUseTime = entry.lastModified();
+      if(this->evictLeastRecentlyUsed) {
+        QFileInfo marker(entry.filePath() + QString(UsageMarkerSuffix));
+        if(marker.exists() && (lastUseTime < marker.lastModified())) {
+          lastUseTime = marker.lastModified();
+        }
+      }
+
+      datedEntries.emplace_back(lastUseTime, entry);
+    }
+
+    std::sort(
+      datedEntries.begin(), datedEntries.end(),
+      [](const DatedEntry &left, const DatedEntry &right) { return (left.first < right.first); }
+    );
+
+    for(const DatedEntry &datedEntry : datedEntries) {
+      if(totalSize <= this->sizeLimit) {
+        break;
+      }
+      if(QFile::remove(datedEntry.second.filePath())) {
+        QFile::remove(datedEntry.second.filePath() + QString(UsageMarkerSuffix));
+        totalSize -= static_cast<std::uint64_t>(datedEntry.second.size());
+      }
+    }
+
+    // Usage markers whose entries were deleted by other means
+    {
+      QFileInfoList markers = cacheDirectory.entryInfoList(
+        QStringList(QString(u8"*.opus") + QString(UsageMarkerSuffix)), QDir::Files
+      );
+      for(const QFileInfo &marker : markers) {
+        QString markerPath = marker.filePath();
+        markerPath.chop(static_cast<int>(sizeof(UsageMarkerSuffix) - 1));
+        if(!QFile::exists(markerPath)) {
+          QFile::remove(marker.filePath());
+        }
+      }
+    }
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+} // namespace Nuclex::OpusTranscoder::Services
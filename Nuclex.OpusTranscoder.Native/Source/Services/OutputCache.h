@@ -0,0 +1,162 @@
+#pragma region Apache License 2.0
+/*
+Nuclex Opus Transcoder
+Copyright (C) 2024 Markus Ewald / Nuclex Development Labs
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#pragma endregion // Apache License 2.0
+
+#ifndef NUCLEX_OPUSTRANSCODER_SERVICES_OUTPUTCACHE_H
+#define NUCLEX_OPUSTRANSCODER_SERVICES_OUTPUTCACHE_H
+
+#include "../Config.h"
+
+#include <Nuclex/Support/Threading/StopToken.h>
+#include <Nuclex/Support/Events/Delegate.h>
+
+#include <memory> // for std::shared_ptr
+#include <string> // for std::string
+#include <cstddef> // for std::byte
+#include <cstdint> // for std::uint64_t
+
+namespace Nuclex::Audio::Storage {
+
+  // ------------------------------------------------------------------------------------------- //
+
+  class VirtualFile;
+
+  // ------------------------------------------------------------------------------------------- //
+
+} // namespace Nuclex::Audio::Storage
+
+namespace Nuclex::OpusTranscoder::Services {
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Keeps finished Opus files around so identical jobs can reuse them</summary>
+  /// <remarks>
+  ///   <para>
+  ///     Each cached Opus file is named after a hash of the input file's bytes and
+  ///     a hash of all settings that influence the encoded output. When the same input
+  ///     file is transcoded with the same settings again, the cached Opus file is
+  ///     copied to the output path instead of redoing the whole job.
+  ///   </para>
+  ///   <para>
+  ///     The cache keeps no index, it's just a directory of files, so several
+  ///     transcoder processes can share it. Entries are written under a temporary name
+  ///     and renamed when complete, so an entry that exists is always whole. When
+  ///     the cache outgrows its size limit, entries are deleted by the time they were
+  ///     added or, in least recently used mode, last reused. Reuse is recorded in
+  ///     an empty marker file next to the entry, so the entry itself is never touched.
+  ///   </para>
+  /// </remarks>
+  class OutputCache {
+
+    /// <summary>Hashes the entire contents of a file</summary>
+    /// <param name="file">File whose contents will be hashed</param>
+    /// <param name="canceler">Token by which the operation can be signalled to cancel</param>
+    /// <param name="progressCallback">Callback that will be invoked with the progress</param>
+    /// <returns>A hash over all of the file's bytes</returns>
+    public: static std::uint64_t HashFile(
+      const Nuclex::Audio::Storage::VirtualFile &file,
+      const std::shared_ptr<const Nuclex::Support::Threading::StopToken> &canceler,
+      Nuclex::Support::Events::Delegate<void(float)> &progressCallback
+    );
+
+    /// <summary>Initializes a new output cache using the specified directory</summary>
+    /// <param name="directory">
+    ///   Directory the cached files are stored in, empty to use a directory in
+    ///   the user's cache location
+    /// </param>
+    public: OutputCache(
+      const std::string &directory = NUCLEX_OPUSTRANSCODER_OUTPUT_CACHE_DIRECTORY
+    );
+
+    /// <summary>Sets the number of bytes the cache may occupy</summary>
+    /// <param name="byteCount">Number of bytes after which entries will be evicted</param>
+    public: void SetSizeLimit(std::uint64_t byteCount) { this->sizeLimit = byteCount; }
+
+    /// <summary>Chooses whether reusing an entry protects it from eviction</summary>
+    /// <param name="enable">
+    ///   True to evict the least recently used entries first, false to evict
+    ///   the oldest entries first
+    /// </param>
+    public: void EnableLeastRecentlyUsedEviction(bool enable = true) {
+      this->evictLeastRecentlyUsed = enable;
+    }
+
+    /// <summary>Chooses whether cached files are hard-linked rather than copied</summary>
+    /// <param name="enable">True to hard-link cached files where possible</param>
+    /// <remarks>
+    ///   A hard-linked output file is the same file as the cache entry, so modifying
+    ///   the output file in place modifies the cache entry, too, and with it all other
+    ///   outputs later provided from that entry. Only enable this if output files
+    ///   are replaced rather than edited.
+    /// </remarks>
+    public: void EnableHardLinks(bool enable = true) { this->useHardLinks = enable; }
+
+    /// <summary>Tries to provide the output file from the cache</summary>
+    /// <param name="inputHash">Hash of the input file's contents</param>
+    /// <param name="settingsHash">Hash of the settings the input is encoded with</param>
+    /// <param name="outputPath">Path at which the output file should appear</param>
+    /// <returns>True if the output file was provided from the cache</returns>
+    /// <remarks>
+    ///   Unless hard links are enabled, the output file is a copy (or a clone on file
+    ///   systems that support it) and can be modified without affecting the cache.
+    ///   If this returns false, the output path is left untouched.
+    /// </remarks>
+    public: bool TryFetch(
+      std::uint64_t inputHash, std::uint64_t settingsHash, const std::string &outputPath
+    ) const;
+
+    /// <summary>Adds a finished output file to the cache</summary>
+    /// <param name="inputHash">Hash of the input file's contents</param>
+    /// <param name="settingsHash">Hash of the settings the input was encoded with</param>
+    /// <param name="outputPath">Path of the output file that will be cached</param>
+    /// <remarks>
+    ///   The output file is always copied, so it can be modified without affecting
+    ///   the cache. Afterwards, entries are evicted until the cache fits its size limit.
+    ///   Throws if the file could not be added.
+    /// </remarks>
+    public: void Store(
+      std::uint64_t inputHash, std::uint64_t settingsHash, const std::string &outputPath
+    ) const;
+
+    /// <summary>Forms the name of the file an entry is stored under</summary>
+    /// <param name="inputHash">Hash of the input file's contents</param>
+    /// <param name="settingsHash">Hash of the settings the input was encoded with</param>
+    /// <returns>The file name of the entry in the cache directory</returns>
+    private: static std::string getEntryFilename(
+      std::uint64_t inputHash, std::uint64_t settingsHash
+    );
+
+    /// <summary>Deletes entries until the cache fits its size limit</summary>
+    private: void evict() const;
+
+    /// <summary>Directory the cached files are stored in</summary>
+    private: std::string directory;
+    /// <summary>Number of bytes the cache may occupy</summary>
+    private: std::uint64_t sizeLimit;
+    /// <summary>Whether entries are evicted by the time they were last reused</summary>
+    private: bool evictLeastRecentlyUsed;
+    /// <summary>Whether cached files are hard-linked rather than copied</summary>
+    private: bool useHardLinks;
+
+  };
+
+  // ------------------------------------------------------------------------------------------- //
+
+} // namespace Nuclex::OpusTranscoder::Services
+
+#endif // NUCLEX_OPUSTRANSCODER_SERVICES_OUTPUTCACHE_H
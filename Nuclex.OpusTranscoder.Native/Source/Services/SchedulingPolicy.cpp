@@ -0,0 +1,377 @@
+#pragma region Apache License 2.0
+/*
+Nuclex Opus Transcoder
+Copyright (C) 2024 Markus Ewald / Nuclex Development Labs
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#pragma endregion // Apache License 2.0
+
+// If the application is compiled as a DLL, this ensures symbols are exported
+#define NUCLEX_CRIUGUI_SOURCE 1
+
+#include "./SchedulingPolicy.h"
+
+#include <Nuclex/Support/Threading/ThreadPool.h>
+
+#include "../Audio/WorkPartitioner.h"
+
+#include <algorithm> // for std::max(), std::min()
+#include <mutex> // for std::mutex
+#include <thread> // for std::thread::hardware_concurrency()
+#include <stdexcept> // for std::runtime_error
+
+#if defined(NUCLEX_OPUSTRANSCODER_WINDOWS)
+#include <Nuclex/Support/BitTricks.h> // for BitTricks::CountBits()
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h> // for ::SetProcessAffinityMask(), ::GetNumaNodeProcessorMask()
+#else
+#include <fstream> // for std::ifstream
+#include <string> // for std::string, std::stoul()
+#include <sched.h> // for ::sched_getaffinity(), ::sched_setaffinity()
+#include <sys/resource.h> // for ::setpriority()
+#include <sys/syscall.h> // for SYS_ioprio_set
+#include <unistd.h> // for ::syscall()
+#endif
+
+namespace {
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Shared state for the process-wide scheduling settings</summary>
+  struct SchedulingState {
+
+    /// <summary>Must be held while accessing the other fields</summary>
+    public: std::mutex Mutex;
+    /// <summary>Number of worker threads in the shared pool, 0 for one per usable core</summary>
+    public: std::size_t WorkerThreadCount = NUCLEX_OPUSTRANSCODER_WORKER_THREADS;
+    /// <summary>Number of transcodes running in parallel, 0 for one per worker thread</summary>
+    public: std::size_t ParallelJobCount = NUCLEX_OPUSTRANSCODER_PARALLEL_JOBS;
+    /// <summary>Number of threads a single transcode may use, 0 for an even share</summary>
+    public: std::size_t ThreadsPerJob = NUCLEX_OPUSTRANSCODER_THREADS_PER_JOB;
+#if NUCLEX_OPUSTRANSCODER_NUMA_NODE >= 0
+    /// <summary>NUMA node the process will be confined to, if any</summary>
+    public: std::optional<std::size_t> NumaNode = NUCLEX_OPUSTRANSCODER_NUMA_NODE;
+#else
+    /// <summary>NUMA node the process will be confined to, if any</summary>
+    public: std::optional<std::size_t> NumaNode;
+#endif
+    /// <summary>Whether the process will be pinned to as many cores as it has threads</summary>
+    public: bool Pin = (NUCLEX_OPUSTRANSCODER_PIN_THREADS != 0);
+    /// <summary>Whether the process will run at background priority</summary>
+    public: bool BackgroundPriority = (NUCLEX_OPUSTRANSCODER_BACKGROUND_PRIORITY != 0);
+    /// <summary>Number of cores the process may run on, 0 if not determined yet</summary>
+    public: std::size_t UsableProcessorCount = 0;
+    /// <summary>Thread pool shared by all transcodes, created on first use</summary>
+    public: std::shared_ptr<Nuclex::Support::Threading::ThreadPool> ThreadPool;
+    /// <summary>Number of worker threads the shared thread pool was created with</summary>
+    public: std::size_t ThreadPoolThreadCount = 0;
+
+  };
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Provides the scheduling state, constructing it on first use</summary>
+  /// <returns>The scheduling state of the process</returns>
+  SchedulingState &getSchedulingState() {
+    static SchedulingState state;
+    return state;
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Works out the number of worker threads for the shared thread pool</summary>
+  /// <param name="state">Scheduling state, its mutex must be held by the caller</param>
+  /// <returns>The number of worker threads the shared thread pool should have</returns>
+  std::size_t resolveWorkerThreadCount(const SchedulingState &state) {
+    if(state.ThreadPool) {
+      return state.ThreadPoolThreadCount;
+    } else if(state.WorkerThreadCount != 0) {
+      return state.WorkerThreadCount;
+    } else if(state.UsableProcessorCount != 0) {
+      return state.UsableProcessorCount;
+    } else {
+      return std::max<std::size_t>(std::thread::hardware_concurrency(), 1);
+    }
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+#if !defined(NUCLEX_OPUSTRANSCODER_WINDOWS)
+  /// <summary>Reads the set of cores belonging to a NUMA node</summary>
+  /// <param name="node">Index of the NUMA node whose cores will be read</param>
+  /// <param name="processors">Receives the cores belonging to the NUMA node</param>
+  /// <returns>True if the NUMA node exists and its cores could be read</returns>
+  bool readNumaNodeProcessors(std::size_t node, ::cpu_set_t &processors) {
+    std::string path(u8"/sys/devices/system/node/node", 29);
+    path.append(std::to_string(node));
+    path.append(u8"/cpulist", 8);
+
+    std::ifstream file(path);
+    if(!file) {
+      return false;
+    }
+
+    // The list looks like "0-7,16-23", ranges or single cores separated by commas
+    CPU_ZERO(&processors);
+    try {
+      std::string range;
+      while(std::getline(file, range, ',')) {
+        std::size_t first = std::stoul(range);
+        std::size_t last = first;
+
+        std::string::size_type dashIndex = range.find(u8'-');
+        if(dashIndex != std::string::npos) {
+          last = std::stoul(range.substr(dashIndex + 1));
+        }
+
+        for(std::size_t index = first; (index <= last) && (index < CPU_SETSIZE); ++index) {
+          CPU_SET(index, &processors);
+        }
+      }
+    }
+    catch(const std::exception &) {
+      return false; // Empty or unexpected contents, treat it like a missing node
+    }
+
+    return (CPU_COUNT(&processors) > 0);
+  }
+#endif
+
+  // ------------------------------------------------------------------------------------------- //
+
+} // anonymous namespace
+
+namespace Nuclex::OpusTranscoder::Services {
+
+  // ------------------------------------------------------------------------------------------- //
+
+  std::size_t SchedulingPolicy::GetWorkerThreadCount() {
+    SchedulingState &state = getSchedulingState();
+    std::lock_guard<std::mutex> stateScope(state.Mutex);
+    return resolveWorkerThreadCount(state);
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  void SchedulingPolicy::SetWorkerThreadCount(std::size_t threadCount) {
+    SchedulingState &state = getSchedulingState();
+    std::lock_guard<std::mutex> stateScope(state.Mutex);
+    state.WorkerThreadCount = threadCount;
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  std::size_t SchedulingPolicy::GetParallelJobCount() {
+    SchedulingState &state = getSchedulingState();
+    std::lock_guard<std::mutex> stateScope(state.Mutex);
+    if(state.ParallelJobCount == 0) {
+      return resolveWorkerThreadCount(state);
+    } else {
+      return state.ParallelJobCount;
+    }
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  void SchedulingPolicy::SetParallelJobCount(std::size_t jobCount) {
+    SchedulingState &state = getSchedulingState();
+    std::lock_guard<std::mutex> stateScope(state.Mutex);
+    state.ParallelJobCount = jobCount;
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  std::size_t SchedulingPolicy::GetThreadsPerJob(std::size_t parallelJobCount) {
+    SchedulingState &state = getSchedulingState();
+    std::lock_guard<std::mutex> stateScope(state.Mutex);
+    if(state.ThreadsPerJob != 0) {
+      return state.ThreadsPerJob;
+    }
+
+    // Rounded up, so all worker threads stay in use when the division isn't even.
+    // The pool still never runs more than its worker threads at once.
+    std::size_t workerThreadCount = resolveWorkerThreadCount(state);
+    parallelJobCount = std::max<std::size_t>(parallelJobCount, 1);
+    return (workerThreadCount + parallelJobCount - 1) / parallelJobCount;
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  void SchedulingPolicy::SetThreadsPerJob(std::size_t threadCount) {
+    SchedulingState &state = getSchedulingState();
+    std::lock_guard<std::mutex> stateScope(state.Mutex);
+    state.ThreadsPerJob = threadCount;
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  void SchedulingPolicy::SetNumaNode(std::optional<std::size_t> node) {
+    SchedulingState &state = getSchedulingState();
+    std::lock_guard<std::mutex> stateScope(state.Mutex);
+    state.NumaNode = node;
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  void SchedulingPolicy::EnablePinning(bool enable /* = true */) {
+    SchedulingState &state = getSchedulingState();
+    std::lock_guard<std::mutex> stateScope(state.Mutex);
+    state.Pin = enable;
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  void SchedulingPolicy::EnableBackgroundPriority(bool enable /* = true */) {
+    SchedulingState &state = getSchedulingState();
+    std::lock_guard<std::mutex> stateScope(state.Mutex);
+    state.BackgroundPriority = enable;
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  void SchedulingPolicy::ApplyToProcess() {
+    SchedulingState &state = getSchedulingState();
+    std::lock_guard<std::mutex> stateScope(state.Mutex);
+
+    bool changeAffinity = (state.NumaNode.has_value() || state.Pin);
+
+#if defined(NUCLEX_OPUSTRANSCODER_WINDOWS)
+    // Only the processor group the process started in is considered. Systems
+    // with more than 64 cores per group are rare enough not to bother.
+    DWORD_PTR processMask, systemMask;
+    if(::GetProcessAffinityMask(::GetCurrentProcess(), &processMask, &systemMask) == FALSE) {
+      throw std::runtime_error(u8"Could not query the CPU affinity of the process");
+    }
+
+    if(state.NumaNode.has_value()) {
+      ULONGLONG nodeMask = 0;
+      BOOL result = ::GetNumaNodeProcessorMask(
+        static_cast<UCHAR>(state.NumaNode.value()), &nodeMask
+      );
+      if((result == FALSE) || (nodeMask == 0)) {
+        throw std::runtime_error(u8"The selected NUMA node does not exist");
+      }
+
+      processMask &= static_cast<DWORD_PTR>(nodeMask);
+      if(processMask == 0) {
+        throw std::runtime_error(u8"None of the NUMA node's cores are available to the process");
+      }
+    }
+
+    // Keep the lowest cores, one for each worker thread
+    if(state.Pin && (state.WorkerThreadCount != 0)) {
+      DWORD_PTR pinnedMask = 0;
+      std::size_t pinnedCount = 0;
+      for(std::size_t bit = 0; bit < sizeof(DWORD_PTR) * 8; ++bit) {
+        DWORD_PTR processorBit = (static_cast<DWORD_PTR>(1) << bit);
+        if((processMask & processorBit) != 0) {
+          if(pinnedCount < state.WorkerThreadCount) {
+            pinnedMask |= processorBit;
+            ++pinnedCount;
+          }
+        }
+      }
+      processMask = pinnedMask;
+    }
+
+    if(changeAffinity) {
+      if(::SetProcessAffinityMask(::GetCurrentProcess(), processMask) == FALSE) {
+        throw std::runtime_error(u8"Could not change the CPU affinity of the process");
+      }
+    }
+    state.UsableProcessorCount = Nuclex::Support::BitTricks::CountBits(processMask);
+
+    // Background mode lowers the process' CPU, disk and memory priority in one go
+    if(state.BackgroundPriority) {
+      ::SetPriorityClass(::GetCurrentProcess(), PROCESS_MODE_BACKGROUND_BEGIN);
+    }
+#else
+    ::cpu_set_t processors;
+    CPU_ZERO(&processors);
+    if(::sched_getaffinity(0, sizeof(processors), &processors) != 0) {
+      throw std::runtime_error(u8"Could not query the CPU affinity of the process");
+    }
+
+    if(state.NumaNode.has_value()) {
+      ::cpu_set_t nodeProcessors;
+      if(!readNumaNodeProcessors(state.NumaNode.value(), nodeProcessors)) {
+        throw std::runtime_error(u8"The selected NUMA node does not exist");
+      }
+
+      CPU_AND(&processors, &processors, &nodeProcessors);
+      if(CPU_COUNT(&processors) == 0) {
+        throw std::runtime_error(u8"None of the NUMA node's cores are available to the process");
+      }
+    }
+
+    // Keep the lowest cores, one for each worker thread
+    if(state.Pin && (state.WorkerThreadCount != 0)) {
+      std::size_t pinnedCount = 0;
+      for(std::size_t index = 0; index < CPU_SETSIZE; ++index) {
+        if(CPU_ISSET(index, &processors)) {
+          if(pinnedCount < state.WorkerThreadCount) {
+            ++pinnedCount;
+          } else {
+            CPU_CLR(index, &processors);
+          }
+        }
+      }
+    }
+
+    // This only affects the calling thread, but all threads created afterwards
+    // inherit it, which is why this should be called before any are created
+    if(changeAffinity) {
+      if(::sched_setaffinity(0, sizeof(processors), &processors) != 0) {
+        throw std::runtime_error(u8"Could not change the CPU affinity of the process");
+      }
+    }
+    state.UsableProcessorCount = static_cast<std::size_t>(CPU_COUNT(&processors));
+
+    // Same as the affinity, priorities are per thread and inherited. The idle I/O class
+    // lets the process only access the disk when nobody else does.
+    if(state.BackgroundPriority) {
+      ::setpriority(PRIO_PROCESS, 0, 19);
+#if defined(SYS_ioprio_set)
+      const int ioPriorityWhoProcess = 1; // IOPRIO_WHO_PROCESS
+      const int ioPriorityIdleClass = (3 << 13); // IOPRIO_PRIO_VALUE(IOPRIO_CLASS_IDLE, 0)
+      ::syscall(SYS_ioprio_set, ioPriorityWhoProcess, 0, ioPriorityIdleClass);
+#endif
+    }
+#endif
+
+    // A process running a single transcode at a time (the user interface) lets it use
+    // all of the worker threads. The batch transcoder narrows this down when it starts.
+    Audio::WorkPartitioner::SetParallelism(resolveWorkerThreadCount(state));
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  std::shared_ptr<Nuclex::Support::Threading::ThreadPool> SchedulingPolicy::GetSharedThreadPool() {
+    SchedulingState &state = getSchedulingState();
+    std::lock_guard<std::mutex> stateScope(state.Mutex);
+
+    if(!state.ThreadPool) {
+      std::size_t threadCount = resolveWorkerThreadCount(state);
+      state.ThreadPool = std::make_shared<Nuclex::Support::Threading::ThreadPool>(
+        std::min<std::size_t>(threadCount, 2), threadCount
+      );
+      state.ThreadPoolThreadCount = threadCount;
+    }
+
+    return state.ThreadPool;
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+} // namespace Nuclex::OpusTranscoder::Services
@@ -0,0 +1,123 @@
+#pragma region Apache License 2.0
+/*
+Nuclex Opus Transcoder
+Copyright (C) 2024 Markus Ewald / Nuclex Development Labs
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#pragma endregion // Apache License 2.0
+
+#ifndef NUCLEX_OPUSTRANSCODER_SERVICES_SCHEDULINGPOLICY_H
+#define NUCLEX_OPUSTRANSCODER_SERVICES_SCHEDULINGPOLICY_H
+
+#include "../Config.h"
+
+#include <memory> // for std::shared_ptr
+#include <optional> // for std::optional
+#include <cstddef> // for std::size_t
+
+namespace Nuclex::Support::Threading {
+
+  // ------------------------------------------------------------------------------------------- //
+
+  class ThreadPool;
+
+  // ------------------------------------------------------------------------------------------- //
+
+} // namespace Nuclex::Support::Threading
+
+namespace Nuclex::OpusTranscoder::Services {
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Decides how many CPU cores the process uses and which ones</summary>
+  /// <remarks>
+  ///   <para>
+  ///     All transcoders in the process draw their worker threads from one shared thread
+  ///     pool, so the worker thread count is a hard budget no matter how many transcodes
+  ///     run at once. In batch mode, that budget is split between the transcodes running
+  ///     in parallel and the threads each of them may keep busy.
+  ///   </para>
+  ///   <para>
+  ///     The process can additionally be confined to a NUMA node, pinned to exactly
+  ///     as many cores as it has worker threads, and run at background priority. These
+  ///     are applied by <see cref="ApplyToProcess" />, which should be called before
+  ///     any worker threads are created, since the threads inherit them when they start.
+  ///     The defaults for all settings come from Config.h.
+  ///   </para>
+  /// </remarks>
+  class SchedulingPolicy {
+
+    /// <summary>Looks up the number of worker threads in the shared thread pool</summary>
+    /// <returns>The number of worker threads all transcodes share</returns>
+    public: static std::size_t GetWorkerThreadCount();
+
+    /// <summary>Sets the number of worker threads in the shared thread pool</summary>
+    /// <param name="threadCount">
+    ///   Number of worker threads, 0 for one per CPU core the process may run on
+    /// </param>
+    /// <remarks>
+    ///   Has no effect once the shared thread pool has been created.
+    /// </remarks>
+    public: static void SetWorkerThreadCount(std::size_t threadCount);
+
+    /// <summary>Looks up the number of transcodes that run in parallel in batch mode</summary>
+    /// <returns>The number of transcodes that run at the same time</returns>
+    public: static std::size_t GetParallelJobCount();
+
+    /// <summary>Sets the number of transcodes that run in parallel in batch mode</summary>
+    /// <param name="jobCount">Number of parallel transcodes, 0 for one per worker thread</param>
+    public: static void SetParallelJobCount(std::size_t jobCount);
+
+    /// <summary>Looks up the number of threads each transcode may keep busy</summary>
+    /// <param name="parallelJobCount">Number of transcodes that run at the same time</param>
+    /// <returns>The number of worker threads a single transcode should use at most</returns>
+    public: static std::size_t GetThreadsPerJob(std::size_t parallelJobCount);
+
+    /// <summary>Sets the number of threads each transcode may keep busy</summary>
+    /// <param name="threadCount">
+    ///   Number of threads per transcode, 0 to divide the worker threads evenly
+    /// </param>
+    public: static void SetThreadsPerJob(std::size_t threadCount);
+
+    /// <summary>Confines the process to the CPU cores of a NUMA node</summary>
+    /// <param name="node">Index of the NUMA node or nothing to use all of them</param>
+    public: static void SetNumaNode(std::optional<std::size_t> node);
+
+    /// <summary>Chooses whether the process is pinned to as many cores as it has threads</summary>
+    /// <param name="enable">True to pin the process to the first usable cores</param>
+    public: static void EnablePinning(bool enable = true);
+
+    /// <summary>Chooses whether the process runs at background priority</summary>
+    /// <param name="enable">True to run at background priority</param>
+    public: static void EnableBackgroundPriority(bool enable = true);
+
+    /// <summary>Applies the affinity and priority settings to the process</summary>
+    /// <remarks>
+    ///   Threads that already exist may keep running anywhere at their old priority,
+    ///   so this should be called early on. Throws a <see cref="std::runtime_error" />
+    ///   if the NUMA node doesn't exist or the affinity couldn't be changed.
+    /// </remarks>
+    public: static void ApplyToProcess();
+
+    /// <summary>Provides the thread pool shared by all transcodes in the process</summary>
+    /// <returns>The shared thread pool, created on first use</returns>
+    public: static std::shared_ptr<Nuclex::Support::Threading::ThreadPool> GetSharedThreadPool();
+
+  };
+
+  // ------------------------------------------------------------------------------------------- //
+
+} // namespace Nuclex::OpusTranscoder::Services
+
+#endif // NUCLEX_OPUSTRANSCODER_SERVICES_SCHEDULINGPOLICY_H
@@ -22,16 +22,90 @@ limitations under the License.
 
 #include "./ServicesRoot.h"
 
+#include "./MetadataCache.h"
 #include "./MetadataReader.h"
 #include "./Transcoder.h"
 
 #include <Nuclex/Audio/Storage/AudioLoader.h>
+#include <Nuclex/Audio/Storage/VirtualFile.h>
 
-//#include <QDir>
+#include <vector> // for std::vector
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QStandardPaths>
 
 namespace {
 
   // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Determines where the metadata cache is saved between runs</summary>
+  /// <returns>The path of the file the metadata cache is saved in</returns>
+  QString getMetadataCachePath() {
+    QString cacheLocation = QStandardPaths::writableLocation(
+      QStandardPaths::GenericCacheLocation
+    );
+    return QDir(cacheLocation).filePath(QString(u8"Nuclex.OpusTranscoder/Metadata.cache"));
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Loads the metadata cache saved by an earlier run, if any</summary>
+  /// <param name="cache">Metadata cache the saved entries will be loaded into</param>
+  void loadMetadataCache(Nuclex::OpusTranscoder::Services::MetadataCache &cache) {
+    QString path = getMetadataCachePath();
+    if(!QFile::exists(path)) {
+      return;
+    }
+
+    // The cache only saves time, if it can't be read, the files will be read again
+    try {
+      std::shared_ptr<const Nuclex::Audio::Storage::VirtualFile> file = (
+        Nuclex::Audio::Storage::VirtualFile::OpenRealFileForReading(path.toStdString())
+      );
+
+      std::vector<std::byte> contents(static_cast<std::size_t>(file->GetSize()));
+      if(!contents.empty()) {
+        file->ReadAt(0, contents.size(), contents.data());
+      }
+      cache.Load(contents);
+    }
+    catch(const std::exception &) {}
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Saves the metadata cache so the next run can load it</summary>
+  /// <param name="cache">Metadata cache whose entries will be saved</param>
+  void saveMetadataCache(const Nuclex::OpusTranscoder::Services::MetadataCache &cache) {
+    QString path = getMetadataCachePath();
+
+    // Written under another name first and then renamed, so two instances exiting
+    // at the same time or a crash while writing don't leave a truncated cache behind
+    try {
+      std::vector<std::byte> contents = cache.Save();
+
+      QDir().mkpath(QFileInfo(path).absolutePath());
+      QString partialPath = path + u8".partial";
+      QFile::remove(partialPath);
+      {
+        std::shared_ptr<Nuclex::Audio::Storage::VirtualFile> file = (
+          Nuclex::Audio::Storage::VirtualFile::OpenRealFileForWriting(
+            partialPath.toStdString()
+          )
+        );
+        file->WriteAt(0, contents.size(), contents.data());
+      }
+
+      QFile::remove(path);
+      QFile::rename(partialPath, path);
+    }
+    catch(const std::exception &) {
+      // The cache is optional, the next run will just read the files again
+    }
+  }
+
   // ------------------------------------------------------------------------------------------- //
 
 } // anonymous namespace
@@ -42,16 +116,30 @@ namespace Nuclex::OpusTranscoder::Services {
 
   ServicesRoot::ServicesRoot() :
     audioLoader(std::make_shared<Nuclex::Audio::Storage::AudioLoader>()),
+    metadataCache(std::make_shared<MetadataCache>()),
     metadataReader(),
     opusTranscoder() {
 
-    this->metadataReader = std::make_shared<MetadataReader>(this->audioLoader);
+    if(NUCLEX_OPUSTRANSCODER_PERSIST_METADATA != 0) {
+      loadMetadataCache(*this->metadataCache);
+    }
+
+    // The transcoder takes the input file's metadata from the cache the metadata reader
+    // filled when the file was selected instead of reading its headers once more
+    this->metadataReader = std::make_shared<MetadataReader>(
+      this->audioLoader, this->metadataCache
+    );
     this->opusTranscoder = std::make_shared<Transcoder>(this->audioLoader);
+    this->opusTranscoder->SetMetadataCache(this->metadataCache);
   }
 
   // ------------------------------------------------------------------------------------------- //
 
-  ServicesRoot::~ServicesRoot() {}
+  ServicesRoot::~ServicesRoot() {
+    if(NUCLEX_OPUSTRANSCODER_PERSIST_METADATA != 0) {
+      saveMetadataCache(*this->metadataCache);
+    }
+  }
 
   // ------------------------------------------------------------------------------------------- //
 
@@ -40,6 +40,7 @@ namespace Nuclex::OpusTranscoder::Services {
 
   // ------------------------------------------------------------------------------------------- //
 
+  class MetadataCache;
   class MetadataReader;
   class Transcoder;
 
@@ -79,6 +80,8 @@ namespace Nuclex::OpusTranscoder::Services {
 
     /// <summary>Detects audio file formats and decodes audio from them</summary>
     private: std::shared_ptr<Audio::Storage::AudioLoader> audioLoader;
+    /// <summary>Remembers the metadata of audio files that have been read before</summary>
+    private: std::shared_ptr<MetadataCache> metadataCache;
     /// <summary>Handles loading metadata in the background</summary>
     private: std::shared_ptr<MetadataReader> metadataReader;
     /// <summary>Runs the transcoding process in the background</summary>
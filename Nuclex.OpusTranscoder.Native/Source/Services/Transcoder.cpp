@@ -21,14 +21,17 @@ limitations under the License.
 #define NUCLEX_CRIUGUI_SOURCE 1
 
 #include "./Transcoder.h"
+#include "./SchedulingPolicy.h"
 
 #include <Nuclex/Support/Threading/StopToken.h>
 #include <Nuclex/Support/Threading/Thread.h>
+#include <Nuclex/Support/Threading/ThreadPool.h>
 #include <Nuclex/Support/BitTricks.h>
 #include <Nuclex/Support/Text/LexicalAppend.h>
 
 #include <Nuclex/Audio/Storage/AudioLoader.h>
 #include <Nuclex/Audio/Storage/AudioTrackDecoder.h>
+#include <Nuclex/Audio/Storage/AudioTrackEncoder.h>
 #include <Nuclex/Audio/KnownChannelLayouts.h>
 
 #include "../Audio/Track.h"
@@ -36,17 +39,163 @@ limitations under the License.
 #include "../Audio/ClippingDetector.h"
 #include "../Audio/HalfwaveTucker.h"
 #include "../Audio/Normalizer.h"
+#include "../Audio/Resampler.h"
 #include "../Audio/OpusEncoder.h"
+#include "../Audio/SegmentedOpusEncoder.h"
+#include "../Audio/StreamingClippingVerifier.h"
+#include "../Audio/StreamingDeclipper.h"
+#include "../Audio/TruePeakDetector.h"
+#include "../Audio/HalfwaveMapCache.h"
+#include "../Audio/WordHash.h"
+#include "../Audio/DeclipCheckpoint.h"
+#include "../Audio/ChunkRingBuffer.h"
+#include "../Audio/MemoryFile.h"
+#include "../Audio/MappedFile.h"
+#include "../Audio/ChunkedMemoryFile.h"
+#include "../Audio/PipeInputFile.h"
+#include "../Audio/PipeOutputFile.h"
+#include "../Audio/PerformanceReport.h"
+
+#include "./OutputCache.h"
+#include "./MetadataCache.h"
+
+#include <algorithm> // for std::min(), std::max()
+#include <cassert> // for assert()
+#include <cmath> // for std::pow()
+#include <cstring> // for std::memcpy()
+#include <atomic> // for std::atomic
+#include <thread> // for std::thread
+#include <chrono> // for std::chrono::microseconds
+#include <exception> // for std::exception_ptr
+#include <utility> // for std::pair
+#include <stdexcept> // for std::runtime_error
 
 #if !defined(NDEBUG)
 #include <set> // for std::set
 #endif
 
 #include <QDir>
+#include <QFile>
 
 namespace {
 
   // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Number of frames decoded and processed at once in streaming mode</summary>
+  /// <remarks>
+  ///   About a third of a second at 48 kHz. For a 7.1 track, a window takes up 512 KiB,
+  ///   so with the frames held back by the streaming de-clipper, memory use stays within
+  ///   a few MiB no matter how long the track is.
+  /// </remarks>
+  const std::size_t FramesPerWindow = 16384;
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Approximate memory used by a streamed transcode, in bytes</summary>
+  /// <remarks>
+  ///   The windows in the ring buffers between the decoder, mixer and encoder threads
+  ///   plus the decoder's and encoder's own state. Generously rounded up.
+  /// </remarks>
+  const std::uint64_t StreamingFootprint = 32 * 1024 * 1024;
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Length of a 20 ms Opus frame, the default the encoder uses, in samples</summary>
+  /// <remarks>
+  ///   Clipping half-waves this close to each other get encoded in the same Opus frame
+  ///   or adjacent ones, so tucking one of them in changes how the others come out.
+  /// </remarks>
+  const std::uint64_t OpusFrameLength = 960;
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Amplitude factor of +0.1 dB, margin for half-waves with clipping neighbours</summary>
+  const float OneTenthDecibel = 1.0115794542598985f;
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>How much audio to decode again after each re-encoded segment</summary>
+  const std::size_t RedecodedTrailingMilliseconds = 200;
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Progress callback target for steps that report their progress otherwise</summary>
+  void ignoreProgress(float) {}
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Number of chunks each stage of the streaming pipeline can work ahead</summary>
+  const std::size_t ChunksInFlight = 4;
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Waits a little while for another pipeline stage to make progress</summary>
+  /// <param name="waitCount">Number of times the caller has waited so far</param>
+  /// <remarks>
+  ///   Chunks take several milliseconds to process, so after a short burst of spinning
+  ///   (for when the other stage is just about done), we sleep to not burn a CPU core.
+  /// </remarks>
+  void backOff(std::size_t &waitCount) {
+    if(waitCount < 64) {
+      NUCLEX_OPUSTRANSCODER_CPU_YIELD;
+    } else {
+      std::this_thread::sleep_for(std::chrono::microseconds(250));
+    }
+    ++waitCount;
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Takes an item from a ring buffer, waiting until one becomes available</summary>
+  /// <typeparam name="TItem">Type of items stored in the ring buffer</typeparam>
+  /// <param name="ringBuffer">Ring buffer from which an item will be taken</param>
+  /// <param name="item">Receives the item taken from the ring buffer</param>
+  /// <param name="aborted">Flag that is set when another stage has failed</param>
+  /// <param name="canceler">Token by which the operation can be signalled to cancel</param>
+  /// <returns>True if an item was taken, false if the pipeline was aborted</returns>
+  template<typename TItem>
+  bool waitAndPop(
+    Nuclex::OpusTranscoder::Audio::ChunkRingBuffer<TItem> &ringBuffer, TItem &item,
+    const std::atomic<bool> &aborted,
+    const std::shared_ptr<const Nuclex::Support::Threading::StopToken> &canceler
+  ) {
+    std::size_t waitCount = 0;
+    while(!ringBuffer.TryPop(item)) {
+      if(aborted.load(std::memory_order_acquire) || canceler->IsCanceled()) {
+        return false;
+      }
+      backOff(waitCount);
+    }
+
+    return true;
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Appends an item to a ring buffer, waiting until there is space</summary>
+  /// <typeparam name="TItem">Type of items stored in the ring buffer</typeparam>
+  /// <param name="ringBuffer">Ring buffer to which the item will be appended</param>
+  /// <param name="item">Item that will be appended to the ring buffer</param>
+  /// <param name="aborted">Flag that is set when another stage has failed</param>
+  /// <param name="canceler">Token by which the operation can be signalled to cancel</param>
+  /// <returns>True if the item was appended, false if the pipeline was aborted</returns>
+  template<typename TItem>
+  bool waitAndPush(
+    Nuclex::OpusTranscoder::Audio::ChunkRingBuffer<TItem> &ringBuffer, const TItem &item,
+    const std::atomic<bool> &aborted,
+    const std::shared_ptr<const Nuclex::Support::Threading::StopToken> &canceler
+  ) {
+    std::size_t waitCount = 0;
+    while(!ringBuffer.TryPush(item)) {
+      if(aborted.load(std::memory_order_acquire) || canceler->IsCanceled()) {
+        return false;
+      }
+      backOff(waitCount);
+    }
+
+    return true;
+  }
+
   // ------------------------------------------------------------------------------------------- //
 
   // TODO: Lifted from the ChannelOrderFactory in Nuclex.Audio.Native
@@ -116,32 +265,65 @@ namespace {
 
   // ------------------------------------------------------------------------------------------- //
 
+  /// <summary>Counts the bytes the samples of a track take up as floats</summary>
+  /// <param name="track">Track whose samples will be counted</param>
+  /// <returns>The number of bytes in the track's samples</returns>
+  std::uint64_t countSampleBytes(const Nuclex::OpusTranscoder::Audio::Track &track) {
+    return track.CountFrames() * track.Channels.size() * sizeof(float);
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
 } // anonymous namespace
 
 namespace Nuclex::OpusTranscoder::Services {
 
   // ------------------------------------------------------------------------------------------- //
 
+  const std::string Transcoder::StandardStreamPath(u8"-", 1);
+
+  // ------------------------------------------------------------------------------------------- //
+
   Transcoder::Transcoder(
     const std::shared_ptr<Nuclex::Audio::Storage::AudioLoader> &loader
   ) :
     loader(loader),
+    metadataCache(),
+    threadPool(SchedulingPolicy::GetSharedThreadPool()),
     trackAccessMutex(),
     declip(false),
     iterativeDeclip(false),
+    predictiveDeclip(false),
+    predictiveHeadroom(),
+    compactOriginalSamples(true),
+    useHalfwaveCache(false),
+    useOutputCache(false),
+    useCheckpoints(false),
+    predictQuotients(true),
+    neighbourSafetyMargin(false),
     nightmodeLevel(0.5f),
     outputChannels(Nuclex::Audio::ChannelPlacement::Unknown),
     targetBitrate(192),
     normalize(false),
     effort(1.0f),
+    trackIndex(0),
     inputPath(),
+    isInputPiped(false),
+    metadataPath(),
+    inputFile(),
     inputChannelOrder(),
+    inputSampleHash(0),
+    halfwaveCachePath(),
+    checkpointPath(),
     outputPath(),
+    isOutputPiped(false),
     outputChannelOrder(),
     stepPrefix(),
     currentStepDescription(u8"Idle"),
-    currentStepProgress(0.0f),
-    outcome(true) {} // for consistency
+    progressTracker(),
+    outcome(true), // for consistency
+    declippingRoundCount(0),
+    performanceReport() {}
 
   // ------------------------------------------------------------------------------------------- //
 
@@ -164,6 +346,56 @@ namespace Nuclex::OpusTranscoder::Services {
 
   // ------------------------------------------------------------------------------------------- //
 
+  void Transcoder::EnablePredictiveDeclipping(bool enable /* = true */) {
+    this->predictiveDeclip = enable;
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  void Transcoder::SetPredictiveHeadroom(
+    std::optional<float> decibels /* = std::optional<float>() */
+  ) {
+    this->predictiveHeadroom = decibels;
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  void Transcoder::EnableCompactOriginalSamples(bool enable /* = true */) {
+    this->compactOriginalSamples = enable;
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  void Transcoder::EnableQuotientPrediction(bool enable /* = true */) {
+    this->predictQuotients = enable;
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  void Transcoder::EnableNeighbourSafetyMargin(bool enable /* = true */) {
+    this->neighbourSafetyMargin = enable;
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  void Transcoder::EnableHalfwaveCache(bool enable /* = true */) {
+    this->useHalfwaveCache = enable;
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  void Transcoder::EnableOutputCache(bool enable /* = true */) {
+    this->useOutputCache = enable;
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  void Transcoder::EnableCheckpoints(bool enable /* = true */) {
+    this->useCheckpoints = enable;
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
   void Transcoder::SetNightmodeLevel(float newNightmodeLevel /* = 0.5f */) {
     this->nightmodeLevel = newNightmodeLevel;
   }
@@ -194,20 +426,47 @@ namespace Nuclex::OpusTranscoder::Services {
 
   // ------------------------------------------------------------------------------------------- //
 
+  void Transcoder::SelectTrack(std::size_t newTrackIndex) {
+    this->trackIndex = newTrackIndex;
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  void Transcoder::SetMetadataCache(const std::shared_ptr<MetadataCache> &cache) {
+    this->metadataCache = cache;
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  void Transcoder::TranscodeAudioFile(
+    const std::string &activeInputPath,
+    const std::string &activeOutputPath
+  ) {
+    TranscodeAudioFile(
+      std::shared_ptr<const Nuclex::Audio::Storage::VirtualFile>(),
+      activeInputPath, activeOutputPath
+    );
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
   void Transcoder::TranscodeAudioFile(
+    const std::shared_ptr<const Nuclex::Audio::Storage::VirtualFile> &activeInputFile,
     const std::string &activeInputPath,
     const std::string &activeOutputPath
   ) {
     {
       std::lock_guard<std::mutex> trackAccessScope(this->trackAccessMutex);
 
+      this->inputFile = activeInputFile;
       this->inputPath = activeInputPath;
       this->outputPath = activeOutputPath;
 
       this->outcome.reset();
       this->stepPrefix.clear();
       this->currentStepDescription.assign(u8"Starting...", 11);
-      this->currentStepProgress = -1.0f;
+      this->progressTracker.BeginStep(-1.0f);
+      this->declippingRoundCount = 0;
     }
 
     StartOrRestart();
@@ -227,8 +486,13 @@ namespace Nuclex::OpusTranscoder::Services {
   // ------------------------------------------------------------------------------------------- //
   
   float Transcoder::GetCurrentStepProgress() const {
-    std::lock_guard<std::mutex> trackAccessScope(this->trackAccessMutex);
-    return this->currentStepProgress;
+    return this->progressTracker.GetProgress();
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  void Transcoder::SetMaximumProgressEventRate(float eventsPerSecond) {
+    this->progressTracker.SetMaximumEventRate(eventsPerSecond);
   }
 
   // ------------------------------------------------------------------------------------------- //
@@ -240,6 +504,67 @@ namespace Nuclex::OpusTranscoder::Services {
 
   // ------------------------------------------------------------------------------------------- //
 
+  std::size_t Transcoder::GetDeclippingRoundCount() const {
+    std::lock_guard<std::mutex> trackAccessScope(this->trackAccessMutex);
+    return this->declippingRoundCount;
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  std::uint64_t Transcoder::EstimateMemoryFootprint(
+    const Nuclex::Audio::TrackInfo &trackInfo
+  ) const {
+    if(!(this->declip && (this->iterativeDeclip || this->predictiveDeclip))) {
+      return StreamingFootprint;
+    }
+
+    std::uint64_t frameCount = (
+      static_cast<std::uint64_t>(trackInfo.Duration.count()) * trackInfo.SampleRate / 1000000
+    );
+
+    // Same rules as the layout transform: anything with fewer channels than the selected
+    // layout is upmixed to stereo. If no layout was selected, assume the input's is kept.
+    std::uint64_t outputChannelCount = Nuclex::Support::BitTricks::CountBits(
+      static_cast<std::size_t>(this->outputChannels)
+    );
+    if(outputChannelCount == 0) {
+      outputChannelCount = trackInfo.ChannelCount;
+    } else if(trackInfo.ChannelCount < outputChannelCount) {
+      outputChannelCount = 2;
+    }
+
+    // The layout transform builds the output planes while the decoded ones still exist
+    std::uint64_t byteCount = (
+      frameCount * (trackInfo.ChannelCount + outputChannelCount) * sizeof(float)
+    );
+
+    // Resampling to 48 kHz builds one channel at a time next to the transformed ones
+    if(trackInfo.SampleRate != Audio::Resampler::OpusSampleRate) {
+      std::uint64_t resampledFrameCount = Audio::Resampler::CountResampledFrames(
+        frameCount, trackInfo.SampleRate, Audio::Resampler::OpusSampleRate
+      );
+      byteCount = std::max<std::uint64_t>(
+        byteCount, (frameCount * outputChannelCount + resampledFrameCount) * sizeof(float)
+      );
+    }
+
+    // The iterative declipper keeps the encoded packets of all segments, the stitched
+    // Opus file and whatever it is decoding for verification around at the same time
+    std::uint64_t encodedByteCount = static_cast<std::uint64_t>(
+      static_cast<double>(this->targetBitrate) * 125.0 *
+      (static_cast<double>(trackInfo.Duration.count()) / 1000000.0)
+    );
+    if(this->iterativeDeclip) {
+      byteCount += encodedByteCount * 3;
+    } else {
+      byteCount += encodedByteCount;
+    }
+
+    return byteCount + StreamingFootprint;
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
   void Transcoder::DoWork(
     const std::shared_ptr<const Nuclex::Support::Threading::StopToken> &canceler
   ) {
@@ -250,176 +575,144 @@ namespace Nuclex::OpusTranscoder::Services {
         {
           std::lock_guard<std::mutex> metadataAccessScope(this->trackAccessMutex);
           localInputPath.swap(this->inputPath);
+          file.swap(this->inputFile);
+        }
+        this->performanceReport.Begin(localInputPath, this->outputPath, this->trackIndex);
+
+        // Other tracks of the same input file may be transcoded at the same time,
+        // so each track gets its own half-wave cache. The first track keeps the name
+        // it had before tracks could be selected.
+        this->isInputPiped = (localInputPath == StandardStreamPath);
+        this->isOutputPiped = (this->outputPath == StandardStreamPath);
+        if(this->isInputPiped) {
+          this->metadataPath.clear();
+        } else {
+          this->metadataPath = localInputPath;
+        }
+        this->halfwaveCachePath = localInputPath;
+        if(this->trackIndex > 0) {
+          this->halfwaveCachePath.append(u8".track", 6);
+          Nuclex::Support::Text::lexical_append(this->halfwaveCachePath, this->trackIndex + 1);
+        }
+        this->halfwaveCachePath.append(u8".halfwaves", 10);
+        this->checkpointPath = this->outputPath + u8".checkpoint";
+
+        // Unless the caller already opened the input file (possibly sharing it
+        // between transcoders for different tracks), open it here
+        if(!static_cast<bool>(file)) {
+          if(this->isInputPiped) {
+            file = Audio::PipeInputFile::GetStandardInput();
+          } else {
+            file = Audio::MappedFile::OpenForReading(localInputPath);
+          }
         }
-
-        file = Nuclex::Audio::Storage::VirtualFile::OpenRealFileForReading(localInputPath);
       }
 
-      // Read the entire input file with all audio samples into memory
-      std::shared_ptr<Nuclex::OpusTranscoder::Audio::Track> track = (
-        decodeAudioFile(file, canceler)
+      // Piped input would have been consumed by hashing it and standard output
+      // can't be hard-linked into the cache, so the output cache is only used
+      // when both sides are real files.
+      bool useOutputCache = (
+        this->useOutputCache && !this->isInputPiped && !this->isOutputPiped
       );
 
-      // If normalization is enabled (to bring up the volume for too quiet tracks),
-      // do it before downmixing. This way around there should be less precision loss.
-      if(this->normalize) {
-        normalizeTrack(track, canceler);
-      }
-
-      // Downmix and/or reorder the audio channels to the Vorbis channel order
-      transformToOutputLayout(track, canceler);
-
-      // DISABLED: There are lots of quirky surround mixes. Sometimes the combined
-      // volume goes over 1.0 (a conforming surround mix should keep the overall volume
-      // at the same level as stereo, not use the additional speaker for yield),
-      // sometimes it is too quiet. Our 'Nightmode' option also makes this unpredictable.
-      // 
-      // If the layout transform is a downmix, normalize again because the channels
-      // might not add up to the full stereo range.
-      //bool isDownMix = (this->outputChannelOrder.size() < this->inputChannelOrder.size());
-      //if(this->normalize && isDownMix) {
-      //  normalizeTrack()
-      //}
-
-      // TODO: Check overall signal level and warn user if downmix is too loud.
-
-      // If de-clipping is active, scan the original audio samples for clipping
-      if(this->declip) {
-        findClippingHalfwaves(track, canceler);
-#if !defined(NDEBUG)
-        track->DebugOutputAllClippingHalfwaves();
-#endif
-
-        // For single-pass declipping, all we do is de-clip the original audio track.
-        // In case iterative declipping is chosen, we encode and verify first.
-        if(!this->iterativeDeclip) {
-          declipTrack(track, canceler);
-        }
-      }
+      // If the same input file was transcoded with the same settings before,
+      // the output cache can provide the Opus file without decoding anything
+      std::unique_ptr<OutputCache> outputCache;
+      std::uint64_t inputFileHash = 0;
+      bool isCachedOutput = false;
+      if(useOutputCache) {
+        outputCache = std::make_unique<OutputCache>();
 
-      // Now encode the file. Unless iterative declipping is used, this will be
-      // saved to disk right after. Otherwise, we begin the long-winded declipping loop
-      std::shared_ptr<const Nuclex::Audio::Storage::VirtualFile> encodedOpusFile = (
-        encodeTrack(track, canceler)
-      );
-      if(this->declip && this->iterativeDeclip) {
-        setStepPrefixMessge(std::string(u8"Step 1: ", 8));
-        for(std::size_t step = 2;; ++step) {
+        onStepBegun(std::string(u8"Checking output cache...", 24), true);
+        {
+          Audio::PerformanceReport::StageTimer timer(
+            this->performanceReport, Audio::PerformanceStage::Cache
+          );
+          timer.AddBytes(file->GetSize());
 
-          // Decode the Opus file again to see where the codec introduced clipping.
-          // This will now add a second, full and uncompressed copy of the raw audio
-          // data into memory, possibly amounting to 10+ GiB of data overall.
-          std::shared_ptr<Nuclex::OpusTranscoder::Audio::Track> decodedOpusFile = (
-            decodeAudioFile(encodedOpusFile, canceler)
+          using Nuclex::Support::Events::Delegate;
+          Delegate<void(float)> progressCallback = (
+            Delegate<void(float)>::Create<Transcoder, &Transcoder::onStepProgressed>(this)
           );
-          assert(decodedOpusFile->Samples.size() == track->Samples.size());
+          inputFileHash = OutputCache::HashFile(*file, canceler, progressCallback);
+        }
 
-#if !defined(NDEBUG)
-          std::set<std::uint64_t> existingPeaks[8];
-          int counts[8];
-          for(std::size_t index = 0; index < track->Channels.size(); ++index) {
-            counts[index] = track->Channels[index].ClippingHalfwaves.size();
-            for(std::size_t index2 = 0; index2 < track->Channels[index].ClippingHalfwaves.size(); ++index2) {
-              existingPeaks[index].insert(track->Channels[index].ClippingHalfwaves[index2].PeakIndex);
-            }
-          }
-#endif
+        isCachedOutput = outputCache->TryFetch(
+          inputFileHash, hashEncoderSettings(), this->outputPath
+        );
+      }
 
-          // Locate instances of clipping in the decoded file. These are then integrated
-          // into the existing collection of clipping half-waves by finding a half-wave
-          // covering the clipping samples in the source channels.
-          findClippingHalfwaves(decodedOpusFile, canceler);
-          Audio::ClippingDetector::Integrate(track, decodedOpusFile);
-#if !defined(NDEBUG)
-          Audio::ClippingDetector::DebugVerifyConsistency(track);
+      if(!isCachedOutput) {
 
-          for(std::size_t index = 0; index < track->Channels.size(); ++index) {
-            for(std::size_t index2 = 0; index2 < track->Channels[index].ClippingHalfwaves.size(); ++index2) {
-              if(existingPeaks[index].erase(track->Channels[index].ClippingHalfwaves[index2].PeakIndex)) {
-                --counts[index];
-              }
-            }
-          }
-          for(std::size_t index = 0; index < track->Channels.size(); ++index) {
-            assert(counts[index] == 0);
-          }
-#endif
+        // The output file may be a hard link into the output cache from an earlier run.
+        // Writing into it would change the cached file, so it is replaced instead.
+        if(useOutputCache) {
+          QFile::remove(QString::fromStdString(this->outputPath));
+        }
 
-          std::size_t remaining = updateClippingHalfwaves(
-            track, decodedOpusFile->Samples, canceler
-          );
-#if !defined(NDEBUG)
-          track->DebugOutputAllClippingHalfwaves();
-#endif
-          if(remaining == 0) {
-            break;
-          }
+        // The iterative de-clipper needs the whole track in memory because it repeatedly
+        // re-encodes it, the predictive one because it looks at the true peaks of the
+        // whole track at once. Everything else can be done in small windows, keeping
+        // memory use bounded no matter how long the input file is.
+        if(this->declip && (this->iterativeDeclip || this->predictiveDeclip)) {
+          transcodeInMemory(file, canceler);
+        } else {
+          transcodeInWindows(file, canceler);
+        }
 
-          {
-            std::string prefix(u8"Step ", 5);
-            Nuclex::Support::Text::lexical_append(prefix, step);
-            prefix.append(u8" (", 2);
-            Nuclex::Support::Text::lexical_append(prefix, remaining);
-            //prefix.append(u8" / ", 3);
-            //Nuclex::Support::Text::lexical_append(prefix, remaining);
-            prefix.append(u8" issues): ", 10);
-            setStepPrefixMessge(prefix);
+        // The transcode succeeded at this point, failing to cache its output would
+        // only mean that the next identical job has to do the whole work again
+        if(useOutputCache) {
+          onStepBegun(std::string(u8"Storing output in cache...", 26));
+          try {
+            outputCache->Store(inputFileHash, hashEncoderSettings(), this->outputPath);
           }
-
-          // We'll sneakily reuse the decoded Opus file's sample array to take a copy
-          // of the untouched original and declip it. This saves us one full reallocation
-          std::shared_ptr<Nuclex::OpusTranscoder::Audio::Track> declippedTrack;
-          {
-            declippedTrack = decodedOpusFile;
-            std::copy_n(
-              track->Samples.data(), track->Samples.size(), declippedTrack->Samples.data()
-            );
-            track->CopyClippingHalfwavesInto(declippedTrack);
-            declipTrack(declippedTrack, canceler);
-            declippedTrack->CopyClippingHalfwavesInto(track);
+          catch(const std::exception &) {
+            // Leave the cache as it is
           }
+        }
 
-          // Now encode the de-clipped track so we can check if that took care of all
-          // the instances of clipping in the output
-          encodedOpusFile = encodeTrack(declippedTrack, canceler);
-
-          // Free the memory of the raw samples used for encoding
-          std::vector<float>().swap(declippedTrack->Samples); // free all memory
-          declippedTrack.reset(),
-          decodedOpusFile.reset();
-
-        } // for each iteration attempting to de-clip the output
-      } // if iterative clipping enabled
-
-      // If this point is reached, either declipping was off, or only a single pass was
-      // requested, or the iterative declipper has done its work.
-      writeVirtualFileToDisk(encodedOpusFile, this->outputPath);
+      }
 
       {
         std::lock_guard<std::mutex> trackAccessScope(this->trackAccessMutex);
 
         this->stepPrefix.clear();
         this->currentStepDescription.assign(u8"Transcoding complete!", 21);
-        this->currentStepProgress = 0.0f;
+        if(isCachedOutput) {
+          this->currentStepDescription.append(u8" (reused cached output)", 23);
+        } else if(this->declippingRoundCount > 0) {
+          this->currentStepDescription.append(u8" (", 2);
+          Nuclex::Support::Text::lexical_append(
+            this->currentStepDescription, this->declippingRoundCount
+          );
+          this->currentStepDescription.append(u8" declipping rounds)", 19);
+        }
+        this->progressTracker.BeginStep(0.0f);
         this->outcome = true;
       }
+      this->performanceReport.End(std::string(u8"succeeded", 9));
     }
     catch(const Nuclex::Support::Errors::CanceledError &error) {
+      this->performanceReport.End(std::string(u8"canceled", 8));
+
       std::lock_guard<std::mutex> trackAccessScope(this->trackAccessMutex);
 
       this->stepPrefix.clear();
       this->currentStepDescription.assign(u8"Transcoding aborted on user request", 35);
-      this->currentStepProgress = -1.0f;
+      this->progressTracker.BeginStep(-1.0f);
       this->outcome = false;
     }
     catch(const std::exception &error) {
+      this->performanceReport.End(std::string(u8"failed", 6));
+
       std::lock_guard<std::mutex> trackAccessScope(this->trackAccessMutex);
 
       this->stepPrefix.clear();
       this->currentStepDescription.assign(
         std::string(u8"Transcoding failed: ", 20) + error.what()
       );
-      this->currentStepProgress = -1.0f;
+      this->progressTracker.BeginStep(-1.0f);
       this->outcome = false;
     }
 
@@ -428,107 +721,858 @@ namespace Nuclex::OpusTranscoder::Services {
 
   // ------------------------------------------------------------------------------------------- //
 
-  std::shared_ptr<Nuclex::OpusTranscoder::Audio::Track> Transcoder::decodeAudioFile(
+  void Transcoder::transcodeInMemory(
     const std::shared_ptr<const Nuclex::Audio::Storage::VirtualFile> &file,
     const std::shared_ptr<const Nuclex::Support::Threading::StopToken> &canceler
   ) {
-    this->currentStepProgress = 0.0f;
-    onStepBegun(std::string(u8"Opening audio file...", 21));
+    // The half-wave cache is stored next to the input file and the checkpoint
+    // next to the output file, neither of which exists for a pipe
+    bool useHalfwaveCache = this->useHalfwaveCache && !this->isInputPiped;
+    bool useCheckpoints = this->useCheckpoints && !this->isOutputPiped;
 
-    Nuclex::Audio::TrackInfo trackInfo;
+    using Audio::PerformanceStage;
+    typedef Audio::PerformanceReport::StageTimer StageTimer;
 
-    // Open a decoder for the input file
-    std::shared_ptr<Nuclex::Audio::Storage::AudioTrackDecoder> decoder;
+    // Read the entire input file with all audio samples into memory
+    std::shared_ptr<Nuclex::OpusTranscoder::Audio::Track> track;
     {
-      // TODO: This information should be available from the decoder, too
-      std::optional<Nuclex::Audio::ContainerInfo> metadata = this->loader->TryReadInfo(file);
-      if(!metadata.has_value()) {
-        throw std::runtime_error(u8"Unsupported file type");
-      }
-      if(metadata.value().Tracks.size() == 0) {
-        throw std::runtime_error(u8"File contains no audio streams");
-      }
-      trackInfo = metadata.value().Tracks[0];
-
-      decoder = this->loader->OpenDecoder(file);
+      StageTimer timer(this->performanceReport, PerformanceStage::Decode);
+      track = decodeAudioFile(file, canceler);
+      timer.AddBytes(countSampleBytes(*track));
     }
 
-    canceler->ThrowIfCanceled();
-    onStepBegun(std::string(u8"Allocating memory...", 20));
+    // If normalization is enabled (to bring up the volume for too quiet tracks),
+    // measure the peaks first. The gains are applied by the layout transform below,
+    // saving a full pass over the samples, and before downmixing, so there should
+    // be less precision loss.
+    std::vector<float> channelGains;
+    if(this->normalize) {
+      StageTimer timer(this->performanceReport, PerformanceStage::Normalize);
+      timer.AddBytes(countSampleBytes(*track));
+      channelGains = measureNormalizationGains(track, canceler);
+    }
 
-    // Create a track with the appropriate number of channels
-    std::shared_ptr<Nuclex::OpusTranscoder::Audio::Track> newTrack;
+    // Downmix and/or reorder the audio channels to the Vorbis channel order
     {
-      newTrack = std::make_shared<Nuclex::OpusTranscoder::Audio::Track>();
+      StageTimer timer(this->performanceReport, PerformanceStage::Transform);
+      timer.AddBytes(countSampleBytes(*track));
+      transformToOutputLayout(track, canceler, true, channelGains);
+    }
 
-      newTrack->Channels.resize(decoder->CountChannels());
-      newTrack->Samples.resize(decoder->CountFrames() * decoder->CountChannels());
-      newTrack->SampleRate = trackInfo.SampleRate;
+    // Bring the track to 48 kHz once, after the downmix so fewer channels need to
+    // be resampled and before the clipping detection, so it sees the encoded samples
+    bool isResampled = (
+      (track->SampleRate != Audio::Resampler::OpusSampleRate) &&
+      Audio::Resampler::CanResample(track->SampleRate, Audio::Resampler::OpusSampleRate)
+    );
+    if(isResampled) {
+      StageTimer timer(this->performanceReport, PerformanceStage::Resample);
+      timer.AddBytes(countSampleBytes(*track));
+      resampleToOpusRate(track, canceler);
     }
 
-    canceler->ThrowIfCanceled();
-    onStepBegun(std::string(u8"Decoding audio file...", 22));
+    // DISABLED: There are lots of quirky surround mixes. Sometimes the combined
+    // volume goes over 1.0 (a conforming surround mix should keep the overall volume
+    // at the same level as stereo, not use the additional speaker for yield),
+    // sometimes it is too quiet. Our 'Nightmode' option also makes this unpredictable.
+    // 
+    // If the layout transform is a downmix, normalize again because the channels
+    // might not add up to the full stereo range.
+    //bool isDownMix = (this->outputChannelOrder.size() < this->inputChannelOrder.size());
+    //if(this->normalize && isDownMix) {
+    //  measureNormalizationGains()
+    //}
+
+    // TODO: Check overall signal level and warn user if downmix is too loud.
+
+    // If de-clipping is active, scan the original audio samples for clipping
+    if(this->declip) {
+      {
+        StageTimer timer(this->performanceReport, PerformanceStage::Detect);
+        timer.AddBytes(countSampleBytes(*track));
+        if(this->predictiveDeclip) {
+          findPredictedClippingHalfwaves(track, canceler);
+        } else {
+          findClippingHalfwaves(track, canceler);
+        }
+      }
+#if !defined(NDEBUG)
+      track->DebugOutputAllClippingHalfwaves();
+#endif
 
-    // Remember the channel order in the input audio file (that's the one we'll read)
-    {
-      this->inputChannelOrder = decoder->GetChannelOrder();
-      for(std::size_t index = 0; index < decoder->CountChannels(); ++index) {
-        newTrack->Channels[index].InputOrder = index;
-        newTrack->Channels[index].Placement = this->inputChannelOrder[index];
+      // For single-pass declipping, all we do is de-clip the original audio track.
+      // In case iterative declipping is chosen, we encode and verify first.
+      if(!this->iterativeDeclip) {
+        StageTimer timer(this->performanceReport, PerformanceStage::Tuck);
+        timer.AddBytes(countSampleBytes(*track));
+        declipTrack(track, canceler);
       }
     }
 
-    canceler->ThrowIfCanceled();
+    // Now encode the file. Unless iterative declipping is used, this will be
+    // saved to disk right after. Otherwise, we begin the long-winded declipping loop
+    std::shared_ptr<const Nuclex::Audio::Storage::VirtualFile> encodedOpusFile;
+    if(!(this->declip && this->iterativeDeclip)) {
+      StageTimer timer(this->performanceReport, PerformanceStage::Encode);
+      encodedOpusFile = encodeTrack(track, canceler);
+      timer.AddBytes(encodedOpusFile->GetSize());
+    } else {
 
-    // Figure out a chunk size that is not more than 1 second (for the sole reason
-    // that the user should be able to cancel the transcode without much delay)
-    std::size_t framesPerChunk;
-    {
-      std::uint64_t totalFrameCount = decoder->CountFrames();
-      while(48000 < totalFrameCount) {
-        totalFrameCount >>= 1;
+      // From here on, the original samples are only read. If they came from integer
+      // PCM, they can be kept at their original width without losing anything.
+      if(this->compactOriginalSamples) {
+        onStepBegun(std::string(u8"Compacting original samples...", 30));
+        StageTimer timer(this->performanceReport, PerformanceStage::Compact);
+        timer.AddBytes(countSampleBytes(*track));
+        track->Compact();
+        canceler->ThrowIfCanceled();
       }
 
-      framesPerChunk = static_cast<std::size_t>(totalFrameCount);
-    }
-
-    canceler->ThrowIfCanceled();
-
-    // Decode all of the audio data (yes, potentially Gigabytes of it) into our
-    // samples array. It will be interleaved using the source channel order.
-    {
-      std::uint64_t remainingFrameCount = decoder->CountFrames();
+      // The segmented encoder remembers the packets of each segment, so after the first
+      // pass, only the segments around half-waves that are tucked in differently need
+      // to be encoded (and then decoded) again. The original samples stay untouched,
+      // the encoder applies the volume quotients to each chunk it encodes.
+      Audio::SegmentedOpusEncoder encoder(track, this->targetBitrate, this->effort);
 
-      float *writeOffset = newTrack->Samples.data();
-      std::uint64_t writeFrameIndex = 0;
+      // If this very job was interrupted earlier, continue with the round it was in
+      std::size_t firstStep = 2;
+      if(useCheckpoints) {
+        encodedOpusFile = resumeFromCheckpoint(track, encoder, firstStep, canceler);
+      }
 
-      while(0 < remainingFrameCount) {
-        if(remainingFrameCount < framesPerChunk) {
-          framesPerChunk = static_cast<std::size_t>(remainingFrameCount);
+      // If this input was declipped before, start from the volume quotients the last
+      // run ended up with. Otherwise, if the clipping was predicted, the half-waves are
+      // tucked in right away. Either way, unless the quotients fall short somewhere,
+      // the verification will have nothing to do.
+      if(!encodedOpusFile) {
+        bool isWarmStart = useHalfwaveCache && restoreClippingHalfwaves(track);
+        if(isWarmStart) {
+          encoder.EnableTucking();
+        } else if(this->predictiveDeclip) {
+          StageTimer timer(this->performanceReport, PerformanceStage::Update);
+          updateVolumeQuotients(track, encoder, true, canceler);
+          encoder.EnableTucking();
+        }
+        {
+          StageTimer timer(this->performanceReport, PerformanceStage::Encode);
+          encodedOpusFile = encodeSegments(encoder, canceler);
+          timer.AddBytes(encodedOpusFile->GetSize());
+        }
+        if(useCheckpoints) {
+          saveCheckpoint(track, encoder, firstStep);
         }
 
-        decoder->DecodeInterleaved<float>(writeOffset, writeFrameIndex, framesPerChunk);
-        canceler->ThrowIfCanceled();
-
-        writeOffset += framesPerChunk * decoder->CountChannels();
-        writeFrameIndex += framesPerChunk;
-        remainingFrameCount -= framesPerChunk;
-
-        onStepProgressed(
-          static_cast<float>(writeFrameIndex) / static_cast<float>(
-            writeFrameIndex + remainingFrameCount
-          )
-        );
+        setStepPrefixMessge(std::string(u8"Step 1: ", 8));
       }
-    }
 
-    // The track is all set up, hand it out
-    return newTrack;
-  }
+      for(std::size_t step = firstStep;; ++step) {
+
+#if !defined(NDEBUG)
+        std::set<std::uint64_t> existingPeaks[8];
+        int counts[8];
+        for(std::size_t index = 0; index < track->Channels.size(); ++index) {
+          counts[index] = track->Channels[index].ClippingHalfwaves.size();
+          for(std::size_t index2 = 0; index2 < track->Channels[index].ClippingHalfwaves.size(); ++index2) {
+            existingPeaks[index].insert(track->Channels[index].ClippingHalfwaves[index2].PeakIndex);
+          }
+        }
+#endif
+
+        // Decode the segments of the Opus file that were just encoded to see where
+        // the codec introduced clipping. The decoded samples are checked on the fly,
+        // new instances of clipping are integrated into the existing collection of
+        // clipping half-waves by finding a half-wave covering the clipping samples
+        // in the source channels.
+        std::size_t remaining;
+        {
+          StageTimer timer(this->performanceReport, PerformanceStage::Integrate);
+          timer.AddBytes(encodedOpusFile->GetSize());
+          remaining = verifyEncodedSegments(encodedOpusFile, encoder, track, canceler);
+        }
+        this->performanceReport.AddDeclippingRound(remaining);
+        {
+          std::lock_guard<std::mutex> trackAccessScope(this->trackAccessMutex);
+          this->declippingRoundCount = step - 1; // each round encoded and verified once
+        }
+#if !defined(NDEBUG)
+        Audio::ClippingDetector::DebugVerifyConsistency(track);
+
+        for(std::size_t index = 0; index < track->Channels.size(); ++index) {
+          for(std::size_t index2 = 0; index2 < track->Channels[index].ClippingHalfwaves.size(); ++index2) {
+            if(existingPeaks[index].erase(track->Channels[index].ClippingHalfwaves[index2].PeakIndex)) {
+              --counts[index];
+            }
+          }
+        }
+        for(std::size_t index = 0; index < track->Channels.size(); ++index) {
+          assert(counts[index] == 0);
+        }
+
+        track->DebugOutputAllClippingHalfwaves();
+#endif
+        if(remaining == 0) {
+          if(useHalfwaveCache) {
+            storeClippingHalfwaves(track);
+          }
+          break;
+        }
+
+        {
+          std::string prefix(u8"Step ", 5);
+          Nuclex::Support::Text::lexical_append(prefix, step);
+          prefix.append(u8" (", 2);
+          Nuclex::Support::Text::lexical_append(prefix, remaining);
+          //prefix.append(u8" / ", 3);
+          //Nuclex::Support::Text::lexical_append(prefix, remaining);
+          prefix.append(u8" issues): ", 10);
+          setStepPrefixMessge(prefix);
+        }
+
+        // Work out new volume quotients for the half-waves that are still clipping.
+        // Until something was tucked in (unless the clipping was predicted or restored
+        // from the cache, that's only the first iteration), everything is new.
+        bool isFirstTuck = !encoder.IsTuckingEnabled();
+        {
+          StageTimer timer(this->performanceReport, PerformanceStage::Update);
+          updateVolumeQuotients(track, encoder, isFirstTuck, canceler);
+        }
+        encoder.EnableTucking();
+
+        // Now encode the de-clipped track so we can check if that took care of all
+        // the instances of clipping in the output
+        {
+          StageTimer timer(this->performanceReport, PerformanceStage::Encode);
+          encodedOpusFile = encodeSegments(encoder, canceler);
+          timer.AddBytes(encodedOpusFile->GetSize());
+        }
+        if(useCheckpoints) {
+          saveCheckpoint(track, encoder, step + 1);
+        }
+
+      } // for each iteration attempting to de-clip the output
+    } // if iterative clipping enabled
+
+    // If this point is reached, either declipping was off, or only a single pass was
+    // requested, or the iterative declipper has done its work.
+    {
+      StageTimer timer(this->performanceReport, PerformanceStage::Write);
+      timer.AddBytes(encodedOpusFile->GetSize());
+      writeVirtualFileToDisk(encodedOpusFile, this->outputPath);
+    }
+
+    // The checkpoint is kept until here, so that a job killed while writing
+    // the output file doesn't have to repeat any of the declipping rounds
+    if(useCheckpoints && this->declip && this->iterativeDeclip) {
+      QFile::remove(QString::fromStdString(this->checkpointPath));
+    }
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  void Transcoder::transcodeInWindows(
+    const std::shared_ptr<const Nuclex::Audio::Storage::VirtualFile> &file,
+    const std::shared_ptr<const Nuclex::Support::Threading::StopToken> &canceler
+  ) {
+    using Nuclex::Support::Events::Delegate;
+    using Audio::PerformanceStage;
+    typedef Audio::PerformanceReport::StageTimer StageTimer;
+
+    // The individual steps run on each window would report their progress within
+    // the window. We report the overall progress through the track instead.
+    Delegate<void(float)> ignoreProgressCallback = (
+      Delegate<void(float)>::Create<&ignoreProgress>()
+    );
+
+    Nuclex::Audio::TrackInfo trackInfo;
+    std::shared_ptr<Nuclex::Audio::Storage::AudioTrackDecoder> decoder = (
+      openAudioDecoder(file, trackInfo)
+    );
+
+    std::size_t inputChannelCount = decoder->CountChannels();
+    std::uint64_t totalFrameCount = decoder->CountFrames();
+
+    // Remember the channel order in the input audio file and set up the channel list
+    // that each freshly decoded window will be given
+    std::vector<Nuclex::OpusTranscoder::Audio::Channel> inputChannels(inputChannelCount);
+    {
+      this->inputChannelOrder = decoder->GetChannelOrder();
+      for(std::size_t index = 0; index < inputChannelCount; ++index) {
+        inputChannels[index].InputOrder = index;
+        inputChannels[index].Placement = this->inputChannelOrder[index];
+      }
+    }
+
+    std::shared_ptr<Nuclex::OpusTranscoder::Audio::Track> window = (
+      std::make_shared<Nuclex::OpusTranscoder::Audio::Track>()
+    );
+    window->SampleRate = trackInfo.SampleRate;
+    window->Samples.reserve(FramesPerWindow * std::max<std::size_t>(inputChannelCount, 2));
+
+    // Normalization needs to know the peak amplitudes of the whole track before it can
+    // scale the first window, so we need to do one extra decoding pass over the track.
+    // Piped input can't be rewound for the second pass.
+    if(this->normalize && this->isInputPiped) {
+      throw std::runtime_error(
+        u8"Normalization needs to read the input twice, which is impossible for piped input. "
+        u8"Disable normalization or use iterative de-clipping, which reads it into memory."
+      );
+    }
+    float maximumAmplitude = 0.0f;
+    float maximumBassAmplitude = 0.0f;
+    if(this->normalize) {
+      onStepBegun(std::string(u8"Measuring track volume...", 25), true);
+      StageTimer timer(this->performanceReport, PerformanceStage::Normalize);
+
+      for(std::uint64_t frameIndex = 0; frameIndex < totalFrameCount;) {
+        std::size_t frameCount = static_cast<std::size_t>(
+          std::min<std::uint64_t>(FramesPerWindow, totalFrameCount - frameIndex)
+        );
+
+        window->Channels = inputChannels;
+        window->Samples.resize(frameCount * inputChannelCount);
+        decoder->DecodeInterleaved<float>(window->Samples.data(), frameIndex, frameCount);
+
+        Audio::Normalizer::UpdatePeakAmplitudes(
+          window, maximumAmplitude, maximumBassAmplitude, canceler, ignoreProgressCallback
+        );
+        timer.AddBytes(window->Samples.size() * sizeof(float));
+
+        frameIndex += frameCount;
+
+        canceler->ThrowIfCanceled();
+        onStepProgressed(
+          static_cast<float>(frameIndex) / static_cast<float>(totalFrameCount)
+        );
+      } // for each window
+    } // if normalization enabled
+
+    // The gains get folded into the layout transform of each window, like in the in-memory path
+    std::vector<float> channelGains;
+    if(this->normalize) {
+      constexpr bool allowVolumeDecrease = false; // see measureNormalizationGains()
+      window->Channels = inputChannels;
+      channelGains = Audio::Normalizer::CalculateChannelGains(
+        window, maximumAmplitude, maximumBassAmplitude, allowVolumeDecrease
+      );
+    }
+
+    // Figure out how many channels the encoded stream will have. The channel layout
+    // transformer can only upmix to stereo, everything else ends up in the chosen layout.
+    std::size_t encodedChannelCount = Nuclex::Support::BitTricks::CountBits(
+      static_cast<std::size_t>(this->outputChannels)
+    );
+    if(inputChannelCount < encodedChannelCount) {
+      encodedChannelCount = 2;
+    }
+
+    // Encode straight into the output file. If anything goes wrong, we need to remove
+    // the incomplete file again (the in-memory path never writes a partial file).
+    std::shared_ptr<Nuclex::Audio::Storage::VirtualFile> outputFile = (
+      openOutputFile(this->outputPath)
+    );
+    try {
+      std::shared_ptr<Nuclex::Audio::Storage::AudioTrackEncoder> encoder = (
+        Audio::OpusEncoder::OpenEncoder(
+          outputFile, encodedChannelCount, trackInfo.SampleRate,
+          this->targetBitrate, this->effort
+        )
+      );
+
+      std::unique_ptr<Audio::StreamingDeclipper> declipper;
+      if(this->declip) {
+        declipper = std::make_unique<Audio::StreamingDeclipper>(encodedChannelCount);
+      }
+
+      onStepBegun(std::string(u8"Transcoding audio stream...", 27), true);
+
+      // Decoding, remixing and encoding each run in their own thread, so the total time
+      // taken is roughly that of the slowest stage (usually the Opus encoder). Chunks are
+      // allocated up front and handed back and forth, so no memory is allocated per chunk.
+      // A null chunk marks the end of the stream.
+      typedef std::shared_ptr<Nuclex::OpusTranscoder::Audio::Track> WindowPointer;
+      typedef Audio::SampleBuffer *BufferPointer;
+
+      std::vector<WindowPointer> windows(ChunksInFlight);
+      std::vector<Audio::SampleBuffer> buffers(ChunksInFlight);
+      Audio::ChunkRingBuffer<WindowPointer> freeWindows(ChunksInFlight);
+      Audio::ChunkRingBuffer<WindowPointer> decodedWindows(ChunksInFlight + 1);
+      Audio::ChunkRingBuffer<BufferPointer> freeBuffers(ChunksInFlight);
+      Audio::ChunkRingBuffer<BufferPointer> mixedBuffers(ChunksInFlight + 1);
+      for(std::size_t index = 0; index < ChunksInFlight; ++index) {
+        if(index == 0) {
+          windows[index] = window; // reuse the window from the normalization pass
+        } else {
+          windows[index] = std::make_shared<Nuclex::OpusTranscoder::Audio::Track>();
+          windows[index]->SampleRate = trackInfo.SampleRate;
+          windows[index]->Samples.reserve(window->Samples.capacity());
+        }
+        buffers[index].reserve(window->Samples.capacity());
+
+        freeWindows.TryPush(windows[index]);
+        freeBuffers.TryPush(&buffers[index]);
+      }
+
+      // If any stage fails, it records its exception and raises this flag so that
+      // the other stages stop waiting for chunks and end, too.
+      std::atomic<bool> pipelineAborted(false);
+      std::exception_ptr decoderError, mixerError, encoderError;
+
+      // Stage 1: decode the input file into windows
+      std::thread decoderThread(
+        [&]() {
+          try {
+            for(std::uint64_t frameIndex = 0; frameIndex < totalFrameCount;) {
+              std::size_t frameCount = static_cast<std::size_t>(
+                std::min<std::uint64_t>(FramesPerWindow, totalFrameCount - frameIndex)
+              );
+
+              WindowPointer decodedWindow;
+              if(!waitAndPop(freeWindows, decodedWindow, pipelineAborted, canceler)) {
+                return;
+              }
+
+              decodedWindow->Channels = inputChannels;
+              decodedWindow->Statistics.Clear(); // would be left over from the last mix
+              {
+                StageTimer timer(this->performanceReport, PerformanceStage::Decode, true);
+                decodedWindow->Samples.resize(frameCount * inputChannelCount);
+                decoder->DecodeInterleaved<float>(
+                  decodedWindow->Samples.data(), frameIndex, frameCount
+                );
+                timer.AddBytes(decodedWindow->Samples.size() * sizeof(float));
+              }
+              frameIndex += frameCount;
+
+              if(!waitAndPush(decodedWindows, decodedWindow, pipelineAborted, canceler)) {
+                return;
+              }
+            } // for each window
+
+            waitAndPush(decodedWindows, WindowPointer(), pipelineAborted, canceler);
+          }
+          catch(...) {
+            decoderError = std::current_exception();
+            pipelineAborted.store(true, std::memory_order_release);
+          }
+        }
+      );
+
+      // Stage 2: normalize, remix and de-clip the windows into encoder input buffers
+      std::thread mixerThread;
+      try {
+        mixerThread = std::thread(
+          [&]() {
+            try {
+              for(;;) {
+                WindowPointer mixedWindow;
+                if(!waitAndPop(decodedWindows, mixedWindow, pipelineAborted, canceler)) {
+                  return;
+                }
+
+                BufferPointer buffer = nullptr;
+                if(static_cast<bool>(mixedWindow)) {
+                  {
+                    StageTimer timer(
+                      this->performanceReport, PerformanceStage::Transform, true
+                    );
+                    timer.AddBytes(mixedWindow->Samples.size() * sizeof(float));
+                    transformToOutputLayout(mixedWindow, canceler, false, channelGains);
+                  }
+                  assert(
+                    (mixedWindow->Channels.size() == encodedChannelCount) &&
+                    u8"Channel count matches"
+                  );
+
+                  if(!waitAndPop(freeBuffers, buffer, pipelineAborted, canceler)) {
+                    return;
+                  }
+
+                  // With de-clipping enabled, frames belonging to a half-wave that hasn't
+                  // ended yet are held back by the de-clipper until the half-wave is complete.
+                  // Otherwise, we can just swap the window's samples into the buffer.
+                  if(static_cast<bool>(declipper)) {
+                    StageTimer timer(this->performanceReport, PerformanceStage::Tuck, true);
+                    timer.AddBytes(mixedWindow->Samples.size() * sizeof(float));
+                    declipper->Feed(
+                      mixedWindow->Samples.data(),
+                      mixedWindow->Samples.size() / encodedChannelCount
+                    );
+                    buffer->assign(
+                      declipper->GetCompletedFrames(),
+                      declipper->GetCompletedFrames() + (
+                        declipper->CountCompletedFrames() * encodedChannelCount
+                      )
+                    );
+                    declipper->DiscardCompletedFrames();
+                  } else {
+                    buffer->swap(mixedWindow->Samples);
+                  }
+
+                  if(!waitAndPush(freeWindows, mixedWindow, pipelineAborted, canceler)) {
+                    return;
+                  }
+                  if(!waitAndPush(mixedBuffers, buffer, pipelineAborted, canceler)) {
+                    return;
+                  }
+                } else { // if window ^^ / vv end of stream vv
+
+                  // Any half-waves still open at the end of the track are complete now
+                  if(static_cast<bool>(declipper)) {
+                    if(!waitAndPop(freeBuffers, buffer, pipelineAborted, canceler)) {
+                      return;
+                    }
+                    declipper->Finish();
+                    buffer->assign(
+                      declipper->GetCompletedFrames(),
+                      declipper->GetCompletedFrames() + (
+                        declipper->CountCompletedFrames() * encodedChannelCount
+                      )
+                    );
+                    declipper->DiscardCompletedFrames();
+                    if(!waitAndPush(mixedBuffers, buffer, pipelineAborted, canceler)) {
+                      return;
+                    }
+                  }
+
+                  waitAndPush(mixedBuffers, BufferPointer(), pipelineAborted, canceler);
+                  return;
+
+                } // if window or end of stream
+              } // for ever
+            }
+            catch(...) {
+              mixerError = std::current_exception();
+              pipelineAborted.store(true, std::memory_order_release);
+            }
+          }
+        );
+      }
+      catch(...) {
+        pipelineAborted.store(true, std::memory_order_release);
+        decoderThread.join();
+        throw;
+      }
+
+      // Stage 3: feed the buffers to the Opus encoder. This runs on our own thread.
+      try {
+        std::uint64_t encodedFrameCount = 0;
+        for(;;) {
+          BufferPointer buffer;
+          if(!waitAndPop(mixedBuffers, buffer, pipelineAborted, canceler)) {
+            break;
+          }
+          if(buffer == nullptr) {
+            encoder->Flush();
+            break;
+          }
+
+          std::size_t frameCount = buffer->size() / encodedChannelCount;
+          if(0 < frameCount) {
+            StageTimer timer(this->performanceReport, PerformanceStage::Encode, true);
+            timer.AddBytes(buffer->size() * sizeof(float));
+            encoder->EncodeInterleaved(buffer->data(), frameCount);
+          }
+          encodedFrameCount += frameCount;
+
+          if(!waitAndPush(freeBuffers, buffer, pipelineAborted, canceler)) {
+            break;
+          }
+
+          canceler->ThrowIfCanceled();
+          onStepProgressed(
+            static_cast<float>(encodedFrameCount) / static_cast<float>(totalFrameCount)
+          );
+        } // for ever
+      }
+      catch(...) {
+        encoderError = std::current_exception();
+        pipelineAborted.store(true, std::memory_order_release);
+      }
+
+      mixerThread.join();
+      decoderThread.join();
+
+      // Report the first error that occurred. Stages that merely stopped because
+      // another stage failed or because the user canceled have no error recorded.
+      if(static_cast<bool>(decoderError)) {
+        std::rethrow_exception(decoderError);
+      } else if(static_cast<bool>(mixerError)) {
+        std::rethrow_exception(mixerError);
+      } else if(static_cast<bool>(encoderError)) {
+        std::rethrow_exception(encoderError);
+      }
+      canceler->ThrowIfCanceled();
+    }
+    catch(const std::exception &) {
+      outputFile.reset();
+      if(!this->isOutputPiped) {
+        QFile::remove(QString::fromStdString(this->outputPath));
+      }
+      throw;
+    }
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  std::shared_ptr<Nuclex::Audio::Storage::AudioTrackDecoder> Transcoder::openAudioDecoder(
+    const std::shared_ptr<const Nuclex::Audio::Storage::VirtualFile> &file,
+    Nuclex::Audio::TrackInfo &trackInfo,
+    bool isInputFile /* = true */
+  ) {
+    onStepBegun(std::string(u8"Opening audio file...", 21), true);
+
+    // The input file's headers were usually read moments ago, to display its metadata
+    // or to plan a batch, so take them from the cache if it's still current
+    bool useMetadataCache = (
+      isInputFile && static_cast<bool>(this->metadataCache) && !this->metadataPath.empty()
+    );
+    std::optional<Nuclex::Audio::ContainerInfo> metadata;
+    if(!useMetadataCache || !this->metadataCache->TryLookup(this->metadataPath, metadata)) {
+      metadata = this->loader->TryReadInfo(file);
+      if(useMetadataCache) {
+        this->metadataCache->Store(this->metadataPath, metadata);
+      }
+    }
+    if(!metadata.has_value()) {
+      throw std::runtime_error(u8"Unsupported file type");
+    }
+    if(metadata.value().Tracks.size() == 0) {
+      throw std::runtime_error(u8"File contains no audio streams");
+    }
+
+    // Encoded Opus streams only ever have the one track
+    std::size_t fileTrackIndex = isInputFile ? this->trackIndex : 0;
+    if(metadata.value().Tracks.size() <= fileTrackIndex) {
+      throw std::runtime_error(u8"File does not contain the selected audio track");
+    }
+    trackInfo = metadata.value().Tracks[fileTrackIndex];
+
+    return this->loader->OpenDecoder(file, std::string(), fileTrackIndex);
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  std::shared_ptr<Nuclex::OpusTranscoder::Audio::Track> Transcoder::decodeAudioFile(
+    const std::shared_ptr<const Nuclex::Audio::Storage::VirtualFile> &file,
+    const std::shared_ptr<const Nuclex::Support::Threading::StopToken> &canceler
+  ) {
+    // Open a decoder for the input file
+    Nuclex::Audio::TrackInfo trackInfo;
+    std::shared_ptr<Nuclex::Audio::Storage::AudioTrackDecoder> decoder = (
+      openAudioDecoder(file, trackInfo)
+    );
+
+    canceler->ThrowIfCanceled();
+    onStepBegun(std::string(u8"Allocating memory...", 20));
+
+    // Create a track with the appropriate number of channels
+    std::shared_ptr<Nuclex::OpusTranscoder::Audio::Track> newTrack;
+    {
+      newTrack = std::make_shared<Nuclex::OpusTranscoder::Audio::Track>();
+
+      // The track is planar, so the passes looking at one channel at a time can walk
+      // through contiguous memory. The planes aren't zero-filled, the decoder will
+      // overwrite all of them anyway.
+      newTrack->Channels.resize(decoder->CountChannels());
+      for(std::size_t index = 0; index < decoder->CountChannels(); ++index) {
+        newTrack->Channels[index].Samples.resize(
+          static_cast<std::size_t>(decoder->CountFrames())
+        );
+      }
+      newTrack->IsPlanar = true;
+      newTrack->SampleRate = trackInfo.SampleRate;
+
+      // If the planes ended up in scratch files, they're written front to back
+      newTrack->AdviseAccessPattern(Nuclex::OpusTranscoder::Audio::SampleAccessPattern::Sequential);
+    }
+
+    canceler->ThrowIfCanceled();
+    onStepBegun(std::string(u8"Decoding audio file...", 22));
+
+    // Remember the channel order in the input audio file (that's the one we'll read)
+    {
+      this->inputChannelOrder = decoder->GetChannelOrder();
+      for(std::size_t index = 0; index < decoder->CountChannels(); ++index) {
+        newTrack->Channels[index].InputOrder = index;
+        newTrack->Channels[index].Placement = this->inputChannelOrder[index];
+      }
+    }
+
+    canceler->ThrowIfCanceled();
+
+    // Figure out a chunk size that is not more than 1 second (for the sole reason
+    // that the user should be able to cancel the transcode without much delay)
+    std::size_t framesPerChunk;
+    {
+      std::uint64_t totalFrameCount = decoder->CountFrames();
+      while(48000 < totalFrameCount) {
+        totalFrameCount >>= 1;
+      }
+
+      framesPerChunk = static_cast<std::size_t>(totalFrameCount);
+    }
+
+    canceler->ThrowIfCanceled();
+
+    // Decode all of the audio data (yes, potentially Gigabytes of it) into our
+    // channel planes. The decoder hands out interleaved chunks in the source channel
+    // order, these are split into the planes while they're still in the cache.
+    {
+      std::uint64_t remainingFrameCount = decoder->CountFrames();
+
+      Nuclex::OpusTranscoder::Audio::SampleBuffer chunk;
+      chunk.resize(framesPerChunk * decoder->CountChannels());
+      std::uint64_t writeFrameIndex = 0;
+
+      // Each chunk is still in the cache right after it was decoded, so the statistics
+      // later stages would otherwise need another pass over the whole track for are
+      // collected right here.
+      newTrack->Statistics.Reset(decoder->CountChannels(), remainingFrameCount);
+      for(std::size_t index = 0; index < decoder->CountChannels(); ++index) {
+        if(this->inputChannelOrder[index] == Nuclex::Audio::ChannelPlacement::LowFrequencyEffects) {
+          newTrack->Statistics.SetBassChannel(index);
+        }
+      }
+      this->inputSampleHash = Audio::WordHash::InitialHash;
+
+      while(0 < remainingFrameCount) {
+        if(remainingFrameCount < framesPerChunk) {
+          framesPerChunk = static_cast<std::size_t>(remainingFrameCount);
+        }
+
+        decoder->DecodeInterleaved<float>(chunk.data(), writeFrameIndex, framesPerChunk);
+        newTrack->Statistics.Accumulate(chunk.data(), writeFrameIndex, framesPerChunk);
+        this->inputSampleHash = Audio::WordHash::HashSamples(
+          this->inputSampleHash, chunk.data(), framesPerChunk * decoder->CountChannels()
+        );
+        newTrack->DeinterleaveFrames(chunk.data(), writeFrameIndex, framesPerChunk);
+        canceler->ThrowIfCanceled();
+
+        writeFrameIndex += framesPerChunk;
+        remainingFrameCount -= framesPerChunk;
+
+        onStepProgressed(
+          static_cast<float>(writeFrameIndex) / static_cast<float>(
+            writeFrameIndex + remainingFrameCount
+          )
+        );
+      }
+    }
+
+    // The track is all set up, hand it out
+    return newTrack;
+  }
 
   // ------------------------------------------------------------------------------------------- //
 
-  void Transcoder::normalizeTrack(
+  std::size_t Transcoder::verifyEncodedSegments(
+    const std::shared_ptr<const Nuclex::Audio::Storage::VirtualFile> &file,
+    const Nuclex::OpusTranscoder::Audio::SegmentedOpusEncoder &encoder,
+    const std::shared_ptr<Nuclex::OpusTranscoder::Audio::Track> &track,
+    const std::shared_ptr<const Nuclex::Support::Threading::StopToken> &canceler
+  ) {
+    Nuclex::Audio::TrackInfo trackInfo;
+    std::shared_ptr<Nuclex::Audio::Storage::AudioTrackDecoder> decoder = (
+      openAudioDecoder(file, trackInfo, false)
+    );
+
+    std::size_t channelCount = track->Channels.size();
+    std::uint64_t totalFrameCount = track->CountFrames();
+    if(decoder->CountFrames() != totalFrameCount) {
+      throw std::runtime_error(u8"Re-encoded Opus stream changed in length");
+    }
+
+    // Packets carry decoder state into the following packets, so the first few packets
+    // after a re-encoded segment can decode differently even though they're unchanged.
+    std::uint64_t trailingFrameCount = (
+      track->SampleRate * RedecodedTrailingMilliseconds / 1000
+    );
+
+    // Collect the ranges that need to be decoded again, merging adjacent segments.
+    // After the first encode, all segments were encoded, so this covers the whole track.
+    std::vector<std::pair<std::uint64_t, std::uint64_t>> frameRanges;
+    std::uint64_t framesToDecodeCount = 0;
+    {
+      std::size_t segmentCount = encoder.CountSegments();
+      for(std::size_t index = 0; index < segmentCount; ++index) {
+        if(encoder.WasSegmentEncoded(index)) {
+          std::uint64_t startFrameIndex = encoder.GetSegmentStartFrameIndex(index);
+          std::uint64_t endFrameIndex = std::min(
+            encoder.GetSegmentEndFrameIndex(index) + trailingFrameCount, totalFrameCount
+          );
+          if(!frameRanges.empty() && (startFrameIndex <= frameRanges.back().second)) {
+            framesToDecodeCount -= frameRanges.back().second - frameRanges.back().first;
+            frameRanges.back().second = std::max(frameRanges.back().second, endFrameIndex);
+          } else {
+            frameRanges.emplace_back(startFrameIndex, endFrameIndex);
+          }
+          framesToDecodeCount += frameRanges.back().second - frameRanges.back().first;
+        }
+      }
+    }
+
+    canceler->ThrowIfCanceled();
+    onStepBegun(std::string(u8"Checking encoded audio for clipping...", 38));
+
+    // Decode the ranges window by window and let the verifier look at the samples.
+    // Unlike a full decode, this never needs more than a window of decoded samples.
+    Audio::StreamingClippingVerifier verifier(track);
+    Audio::SampleBuffer window;
+    window.resize(FramesPerWindow * channelCount); // decoder overwrites, no zero fill
+    std::uint64_t decodedFrameCount = 0;
+    for(std::size_t rangeIndex = 0; rangeIndex < frameRanges.size(); ++rangeIndex) {
+      std::uint64_t frameIndex = frameRanges[rangeIndex].first;
+      std::uint64_t endFrameIndex = frameRanges[rangeIndex].second;
+
+      verifier.BeginRange(frameIndex);
+      while(frameIndex < endFrameIndex) {
+        std::size_t framesInWindow;
+        if(FramesPerWindow < endFrameIndex - frameIndex) {
+          framesInWindow = FramesPerWindow;
+        } else {
+          framesInWindow = static_cast<std::size_t>(endFrameIndex - frameIndex);
+        }
+
+        decoder->DecodeInterleaved<float>(window.data(), frameIndex, framesInWindow);
+        verifier.Feed(window.data(), framesInWindow);
+        canceler->ThrowIfCanceled();
+
+        frameIndex += framesInWindow;
+        decodedFrameCount += framesInWindow;
+
+        onStepProgressed(
+          static_cast<float>(decodedFrameCount) / static_cast<float>(framesToDecodeCount)
+        );
+      }
+      verifier.EndRange();
+    } // for each range of frames that needs to be decoded again
+
+    verifier.Integrate();
+
+    // Half-waves that were too long to keep in the verifier's history or that reach
+    // outside of the re-encoded segments are decoded once more and measured separately
+    std::vector<std::pair<std::uint64_t, std::uint64_t>> unmeasuredRanges = (
+      verifier.GetUnmeasuredRanges()
+    );
+    Audio::SampleBuffer samples; // reused, so only the longest range allocates
+    for(std::size_t rangeIndex = 0; rangeIndex < unmeasuredRanges.size(); ++rangeIndex) {
+      std::uint64_t frameIndex = unmeasuredRanges[rangeIndex].first;
+      std::size_t frameCount = static_cast<std::size_t>(
+        unmeasuredRanges[rangeIndex].second - frameIndex
+      );
+
+      samples.resize(frameCount * channelCount);
+      decoder->DecodeInterleaved<float>(samples.data(), frameIndex, frameCount);
+      verifier.MeasureRange(frameIndex, samples.data(), frameCount);
+      canceler->ThrowIfCanceled();
+    }
+
+    return verifier.Update();
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  std::vector<float> Transcoder::measureNormalizationGains(
     const std::shared_ptr<Nuclex::OpusTranscoder::Audio::Track> &track,
     const std::shared_ptr<const Nuclex::Support::Threading::StopToken> &canceler
   ) {
@@ -543,9 +1587,17 @@ namespace Nuclex::OpusTranscoder::Services {
     // only to bring too audio tracks that are too quiet back in line.
     constexpr bool allowVolumeDecrease = false;
 
-    onStepBegun(std::string(u8"Normalizing track volume...", 27));
-    Audio::Normalizer::Normalize(
-      track, allowVolumeDecrease, canceler, progressCallback
+    float maximumAmplitude = 0.0f;
+    float maximumBassAmplitude = 0.0f;
+
+    onStepBegun(std::string(u8"Measuring track volume...", 25));
+    Audio::Normalizer::UpdatePeakAmplitudes(
+      track, maximumAmplitude, maximumBassAmplitude,
+      *this->threadPool, canceler, progressCallback
+    );
+
+    return Audio::Normalizer::CalculateChannelGains(
+      track, maximumAmplitude, maximumBassAmplitude, allowVolumeDecrease
     );
   }
 
@@ -553,7 +1605,9 @@ namespace Nuclex::OpusTranscoder::Services {
 
   void Transcoder::transformToOutputLayout(
     const std::shared_ptr<Nuclex::OpusTranscoder::Audio::Track> &track,
-    const std::shared_ptr<const Nuclex::Support::Threading::StopToken> &canceler
+    const std::shared_ptr<const Nuclex::Support::Threading::StopToken> &canceler,
+    bool reportProgress /* = true */,
+    const std::vector<float> &channelGains /* = std::vector<float>() */
   ) {
     using Nuclex::OpusTranscoder::Audio::ChannelLayoutTransformer;
     using Nuclex::Support::Events::Delegate;
@@ -564,41 +1618,92 @@ namespace Nuclex::OpusTranscoder::Services {
     );
     this->outputChannelOrder = ChannelOrderFromVorbisFamilyAndCount(1, outputChannelCount);
 
-    Delegate<void(float)> progressCallback = (
-      Delegate<void(float)>::Create<Transcoder, &Transcoder::onStepProgressed>(this)
-    );
+    Delegate<void(float)> progressCallback = Delegate<void(float)>::Create<&ignoreProgress>();
+    if(reportProgress) {
+      progressCallback = (
+        Delegate<void(float)>::Create<Transcoder, &Transcoder::onStepProgressed>(this)
+      );
+    }
 
     // Now transform the input audio samples, downmixing, upmixing or re-weaving
     // the interleaved channels into the correct order.
     if(track->Channels.size() < outputChannelCount) {
-      onStepBegun(std::string(u8"Upmixing to stereo...", 21));
+      if(reportProgress) {
+        onStepBegun(std::string(u8"Upmixing to stereo...", 21));
+      }
       ChannelLayoutTransformer::UpmixToStereo(
-        track, canceler, progressCallback
+        track, canceler, progressCallback, channelGains
       );
     } else if(outputChannelCount < track->Channels.size()) {
       if(this->outputChannels == Nuclex::Audio::KnownChannelLayouts::Stereo) {
-        onStepBegun(std::string(u8"Downmixing to stereo...", 23));
+        if(reportProgress) {
+          onStepBegun(std::string(u8"Downmixing to stereo...", 23));
+        }
         ChannelLayoutTransformer::DownmixToStereo(
-          track, this->nightmodeLevel, canceler, progressCallback
+          track, this->nightmodeLevel, canceler, progressCallback, channelGains
         );
       } else if(this->outputChannels == Nuclex::Audio::KnownChannelLayouts::FiveDotOneSurround) {
-        onStepBegun(std::string(u8"Upmixing 7.1 to 5.1...", 22));
+        if(reportProgress) {
+          onStepBegun(std::string(u8"Upmixing 7.1 to 5.1...", 22));
+        }
         ChannelLayoutTransformer::DownmixToFiveDotOne(
-          track, canceler, progressCallback
+          track, canceler, progressCallback, channelGains
         );
       } else {
         throw std::runtime_error(u8"Non-standard output channel layouts are not supported");
       }
     } else if(this->inputChannelOrder != this->outputChannelOrder) {
-      onStepBegun(std::string(u8"Reordering audio channels...", 28));
+      if(reportProgress) {
+        onStepBegun(std::string(u8"Reordering audio channels...", 28));
+      }
       ChannelLayoutTransformer::ReweaveToVorbisLayout(
-        track, canceler, progressCallback
+        track, canceler, progressCallback, channelGains
       );
+    } else if(!channelGains.empty()) {
+      if(reportProgress) {
+        onStepBegun(std::string(u8"Normalizing track volume...", 27));
+      }
+      Audio::Normalizer::Amplify(track, channelGains, canceler, progressCallback);
     }
   }
 
   // ------------------------------------------------------------------------------------------- //
 
+  void Transcoder::resampleToOpusRate(
+    const std::shared_ptr<Nuclex::OpusTranscoder::Audio::Track> &track,
+    const std::shared_ptr<const Nuclex::Support::Threading::StopToken> &canceler
+  ) {
+    using Nuclex::OpusTranscoder::Audio::Resampler;
+    using Nuclex::Support::Events::Delegate;
+
+    // Odd sample rates the resampler can't handle are still resampled by the encoder
+    std::size_t sampleRate = track->SampleRate;
+    if(sampleRate == Resampler::OpusSampleRate) {
+      return;
+    }
+    if(!Resampler::CanResample(sampleRate, Resampler::OpusSampleRate)) {
+      return;
+    }
+
+    Delegate<void(float)> progressCallback = (
+      Delegate<void(float)>::Create<Transcoder, &Transcoder::onStepProgressed>(this)
+    );
+
+    onStepBegun(std::string(u8"Resampling to 48 kHz...", 23), true);
+    Resampler::Resample(
+      track, Resampler::OpusSampleRate, *this->threadPool, canceler, progressCallback
+    );
+
+    // The half-wave cache and checkpoints describe positions in the resampled track,
+    // so they must not be confused with ones taken from the track at its own rate
+    float sampleRateSetting = static_cast<float>(sampleRate);
+    this->inputSampleHash = Audio::WordHash::HashSamples(
+      this->inputSampleHash, &sampleRateSetting, 1
+    );
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
   void Transcoder::findClippingHalfwaves(
     const std::shared_ptr<Nuclex::OpusTranscoder::Audio::Track> &track,
     const std::shared_ptr<const Nuclex::Support::Threading::StopToken> &canceler
@@ -611,15 +1716,14 @@ namespace Nuclex::OpusTranscoder::Services {
 
     onStepBegun(std::string(u8"Checking audio track for clipping...", 36));
     Audio::ClippingDetector::FindClippingHalfwaves(
-      track, canceler, progressCallback
+      track, *this->threadPool, canceler, progressCallback
     );
   }
 
   // ------------------------------------------------------------------------------------------- //
 
-  std::size_t Transcoder::updateClippingHalfwaves(
+  void Transcoder::findPredictedClippingHalfwaves(
     const std::shared_ptr<Nuclex::OpusTranscoder::Audio::Track> &track,
-    const std::vector<float> &samples,
     const std::shared_ptr<const Nuclex::Support::Threading::StopToken> &canceler
   ) {
     using Nuclex::Support::Events::Delegate;
@@ -628,9 +1732,20 @@ namespace Nuclex::OpusTranscoder::Services {
       Delegate<void(float)>::Create<Transcoder, &Transcoder::onStepProgressed>(this)
     );
 
-    onStepBegun(std::string(u8"Checking audio track for clipping...", 36));
-    return Audio::ClippingDetector::Update(
-      track, samples, canceler, progressCallback
+    // Unless a fixed headroom was chosen, estimate how much Opus will overshoot
+    // at the bitrate each channel ends up with
+    float headroomFactor;
+    if(this->predictiveHeadroom.has_value()) {
+      headroomFactor = std::pow(10.0f, this->predictiveHeadroom.value() / 20.0f);
+    } else {
+      headroomFactor = Audio::TruePeakDetector::EstimateOpusOvershoot(
+        this->targetBitrate, track->Channels.size()
+      );
+    }
+
+    onStepBegun(std::string(u8"Predicting clipping from true peaks...", 38));
+    Audio::TruePeakDetector::FindPredictedClippingHalfwaves(
+      track, std::max(headroomFactor, 1.0f), *this->threadPool, canceler, progressCallback
     );
   }
 
@@ -648,12 +1763,59 @@ namespace Nuclex::OpusTranscoder::Services {
 
     onStepBegun(std::string(u8"Tucking in clipping segments...", 31));
     Audio::HalfwaveTucker::TuckClippingHalfwaves(
-      track, canceler, progressCallback
+      track, *this->threadPool, canceler, progressCallback
     );
   }
 
   // ------------------------------------------------------------------------------------------- //
 
+  void Transcoder::updateVolumeQuotients(
+    const std::shared_ptr<Nuclex::OpusTranscoder::Audio::Track> &track,
+    Nuclex::OpusTranscoder::Audio::SegmentedOpusEncoder &encoder,
+    bool isFirstTuck,
+    const std::shared_ptr<const Nuclex::Support::Threading::StopToken> &canceler
+  ) {
+    onStepBegun(std::string(u8"Tucking in clipping segments...", 31));
+
+    std::size_t channelCount = track->Channels.size();
+    for(std::size_t channelIndex = 0; channelIndex < channelCount; ++channelIndex) {
+      Audio::ClippingHalfwaveTable &halfwaves = track->Channels[channelIndex].ClippingHalfwaves;
+
+      std::size_t halfwaveCount = halfwaves.size();
+      for(std::size_t halfwaveIndex = 0; halfwaveIndex < halfwaveCount; ++halfwaveIndex) {
+        Audio::ClippingHalfwave halfwave = halfwaves[halfwaveIndex];
+
+        // Only half-waves still clipping get a new volume quotient. All others will be
+        // tucked in exactly as before, so their segments' packets remain valid.
+        if(isFirstTuck || (1.0f < halfwave.PeakAmplitude)) {
+          encoder.MarkDirty(halfwave.PriorZeroCrossingIndex, halfwave.NextZeroCrossingIndex);
+        }
+        if(this->predictQuotients) {
+          float safetyFactor = 1.0f;
+          if(this->neighbourSafetyMargin) {
+            bool hasClippingNeighbour = Audio::HalfwaveTucker::HasClippingNeighbour(
+              halfwaves, halfwaveIndex, OpusFrameLength
+            );
+            if(hasClippingNeighbour) {
+              safetyFactor = OneTenthDecibel;
+            }
+          }
+          Audio::HalfwaveTucker::PredictVolumeQuotient(halfwave, safetyFactor);
+        } else {
+          Audio::HalfwaveTucker::UpdateVolumeQuotient(halfwave);
+        }
+        halfwaves.Update(halfwaveIndex, halfwave);
+      }
+
+      canceler->ThrowIfCanceled();
+      onStepProgressed(
+        static_cast<float>(channelIndex + 1) / static_cast<float>(channelCount)
+      );
+    } // for each channel
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
   std::shared_ptr<const Nuclex::Audio::Storage::VirtualFile> Transcoder::encodeTrack(
     const std::shared_ptr<Nuclex::OpusTranscoder::Audio::Track> &track,
     const std::shared_ptr<const Nuclex::Support::Threading::StopToken> &canceler
@@ -666,10 +1828,11 @@ namespace Nuclex::OpusTranscoder::Services {
 
     onStepBegun(std::string(u8"Encoding Opus audio stream...", 29));
 
-    return Audio::OpusEncoder::Encode(
+    return Audio::OpusEncoder::EncodeInParallel(
       track,
       this->targetBitrate,
       this->effort,
+      *this->threadPool,
       canceler,
       progressCallback
     );
@@ -677,16 +1840,296 @@ namespace Nuclex::OpusTranscoder::Services {
 
   // ------------------------------------------------------------------------------------------- //
 
+  std::shared_ptr<const Nuclex::Audio::Storage::VirtualFile> Transcoder::encodeSegments(
+    Nuclex::OpusTranscoder::Audio::SegmentedOpusEncoder &encoder,
+    const std::shared_ptr<const Nuclex::Support::Threading::StopToken> &canceler
+  ) {
+    using Nuclex::Support::Events::Delegate;
+
+    Delegate<void(float)> progressCallback = (
+      Delegate<void(float)>::Create<Transcoder, &Transcoder::onStepProgressed>(this)
+    );
+
+    std::string message(u8"Encoding Opus audio stream (", 28);
+    Nuclex::Support::Text::lexical_append(message, encoder.CountDirtySegments());
+    message.append(u8" of ", 4);
+    Nuclex::Support::Text::lexical_append(message, encoder.CountSegments());
+    message.append(u8" segments)...", 13);
+    onStepBegun(message);
+
+    return encoder.Encode(*this->threadPool, canceler, progressCallback);
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  std::uint64_t Transcoder::hashTransformSettings() const {
+
+    // Hashed just like samples, by their bit patterns. The channel placement flags
+    // are smuggled in as bits, too, converting them to a float could lose some.
+    float settings[3];
+    {
+      std::uint32_t outputChannelBits = static_cast<std::uint32_t>(this->outputChannels);
+      std::memcpy(&settings[0], &outputChannelBits, sizeof(settings[0]));
+    }
+    settings[1] = this->nightmodeLevel;
+    settings[2] = (this->normalize ? 1.0f : 0.0f);
+
+    std::uint64_t hash = Audio::WordHash::HashSamples(
+      Audio::WordHash::InitialHash, settings, 3
+    );
+
+    // Only mixed in for the other tracks, so hashes from before tracks could
+    // be selected stay valid for the first track
+    if(this->trackIndex > 0) {
+      float trackSetting = static_cast<float>(this->trackIndex);
+      hash = Audio::WordHash::HashSamples(hash, &trackSetting, 1);
+    }
+
+    return hash;
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  std::uint64_t Transcoder::hashEncoderSettings() const {
+
+    // Everything that changes the samples before encoding plus everything that
+    // changes how they get encoded. Flags can't lose precision as floats, so
+    // they're simply stored as zero or one.
+    float settings[10];
+    settings[0] = this->targetBitrate;
+    settings[1] = this->effort;
+    settings[2] = (this->declip ? 1.0f : 0.0f);
+    settings[3] = (this->iterativeDeclip ? 1.0f : 0.0f);
+    settings[4] = (this->predictiveDeclip ? 1.0f : 0.0f);
+    settings[5] = (this->predictiveHeadroom.has_value() ? 1.0f : 0.0f);
+    settings[6] = this->predictiveHeadroom.value_or(0.0f);
+    settings[7] = (this->predictQuotients ? 1.0f : 0.0f);
+    settings[8] = (this->neighbourSafetyMargin ? 1.0f : 0.0f);
+    settings[9] = (this->useHalfwaveCache ? 1.0f : 0.0f);
+
+    return Audio::WordHash::HashSamples(hashTransformSettings(), settings, 10);
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  bool Transcoder::restoreClippingHalfwaves(
+    const std::shared_ptr<Nuclex::OpusTranscoder::Audio::Track> &track
+  ) {
+    if(!QFile::exists(QString::fromStdString(this->halfwaveCachePath))) {
+      return false;
+    }
+
+    onStepBegun(std::string(u8"Loading half-wave cache...", 26));
+
+    // The cache only saves time, so if it can't be read for whatever reason,
+    // the declipper simply starts from scratch like it would without one
+    Audio::HalfwaveMapCache cache;
+    try {
+      std::shared_ptr<const Nuclex::Audio::Storage::VirtualFile> file = (
+        Nuclex::Audio::Storage::VirtualFile::OpenRealFileForReading(this->halfwaveCachePath)
+      );
+
+      std::vector<std::byte> contents(static_cast<std::size_t>(file->GetSize()));
+      if(!contents.empty()) {
+        file->ReadAt(0, contents.size(), contents.data());
+      }
+      cache.Load(contents);
+    }
+    catch(const std::exception &) {
+      return false;
+    }
+
+    return cache.Restore(
+      this->inputSampleHash, hashTransformSettings(), this->targetBitrate, *track
+    );
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  std::shared_ptr<const Nuclex::Audio::Storage::VirtualFile> Transcoder::resumeFromCheckpoint(
+    const std::shared_ptr<Nuclex::OpusTranscoder::Audio::Track> &track,
+    Nuclex::OpusTranscoder::Audio::SegmentedOpusEncoder &encoder,
+    std::size_t &round,
+    const std::shared_ptr<const Nuclex::Support::Threading::StopToken> &canceler
+  ) {
+    if(!QFile::exists(QString::fromStdString(this->checkpointPath))) {
+      return std::shared_ptr<const Nuclex::Audio::Storage::VirtualFile>();
+    }
+
+    onStepBegun(std::string(u8"Loading declipping checkpoint...", 32));
+
+    // A checkpoint that can't be read or belongs to another input or other settings
+    // is ignored, it'll be overwritten by the first checkpoint of this job
+    Audio::DeclipCheckpoint checkpoint;
+    try {
+      std::shared_ptr<const Nuclex::Audio::Storage::VirtualFile> file = (
+        Nuclex::Audio::Storage::VirtualFile::OpenRealFileForReading(this->checkpointPath)
+      );
+
+      std::vector<std::byte> contents(static_cast<std::size_t>(file->GetSize()));
+      if(!contents.empty()) {
+        file->ReadAt(0, contents.size(), contents.data());
+      }
+      checkpoint.Load(contents);
+    }
+    catch(const std::exception &) {
+      return std::shared_ptr<const Nuclex::Audio::Storage::VirtualFile>();
+    }
+
+    bool isRestored = (
+      (2 <= checkpoint.GetRound()) &&
+      checkpoint.Restore(this->inputSampleHash, hashEncoderSettings(), *track, encoder)
+    );
+    if(!isRestored) {
+      return std::shared_ptr<const Nuclex::Audio::Storage::VirtualFile>();
+    }
+
+    round = checkpoint.GetRound();
+    {
+      std::string prefix(u8"Step ", 5);
+      Nuclex::Support::Text::lexical_append(prefix, round - 1);
+      prefix.append(u8" (resumed): ", 12);
+      setStepPrefixMessge(prefix);
+    }
+
+    // If the encoder splits the track differently now, the segments from the checkpoint
+    // are of no use, but the volume quotients still save all the rounds before
+    std::shared_ptr<const Nuclex::Audio::Storage::VirtualFile> encodedOpusFile;
+    if(encoder.CountDirtySegments() == 0) {
+      encodedOpusFile = encoder.Stitch();
+    }
+    if(!encodedOpusFile) {
+      encoder.MarkDirty(0, track->CountFrames());
+      encodedOpusFile = encodeSegments(encoder, canceler);
+    }
+
+    return encodedOpusFile;
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  void Transcoder::saveCheckpoint(
+    const std::shared_ptr<Nuclex::OpusTranscoder::Audio::Track> &track,
+    const Nuclex::OpusTranscoder::Audio::SegmentedOpusEncoder &encoder,
+    std::size_t round
+  ) {
+    onStepBegun(std::string(u8"Saving declipping checkpoint...", 31));
+
+    // Written under another name first and then renamed, so a job killed while
+    // writing the checkpoint doesn't leave a truncated one behind
+    try {
+      Audio::DeclipCheckpoint checkpoint;
+      checkpoint.Capture(this->inputSampleHash, hashEncoderSettings(), round, *track, encoder);
+
+      std::vector<std::byte> contents = checkpoint.Save();
+      std::string partialPath = this->checkpointPath + u8".partial";
+      QFile::remove(QString::fromStdString(partialPath));
+      {
+        std::shared_ptr<Nuclex::Audio::Storage::VirtualFile> file = (
+          Nuclex::Audio::Storage::VirtualFile::OpenRealFileForWriting(partialPath)
+        );
+        file->WriteAt(0, contents.size(), contents.data());
+      }
+
+      QFile::remove(QString::fromStdString(this->checkpointPath));
+      QFile::rename(
+        QString::fromStdString(partialPath), QString::fromStdString(this->checkpointPath)
+      );
+    }
+    catch(const std::exception &) {
+      // Checkpoints are optional, an interrupted job will just start over
+    }
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  void Transcoder::storeClippingHalfwaves(
+    const std::shared_ptr<Nuclex::OpusTranscoder::Audio::Track> &track
+  ) {
+    onStepBegun(std::string(u8"Saving half-wave cache...", 25));
+
+    // Entries for other bitrates or settings are kept, so the cache is read first.
+    // Failing to update it is no reason to fail the transcode, which did succeed.
+    try {
+      Audio::HalfwaveMapCache cache;
+      if(QFile::exists(QString::fromStdString(this->halfwaveCachePath))) {
+        try {
+          std::shared_ptr<const Nuclex::Audio::Storage::VirtualFile> file = (
+            Nuclex::Audio::Storage::VirtualFile::OpenRealFileForReading(this->halfwaveCachePath)
+          );
+
+          std::vector<std::byte> contents(static_cast<std::size_t>(file->GetSize()));
+          if(!contents.empty()) {
+            file->ReadAt(0, contents.size(), contents.data());
+          }
+          cache.Load(contents);
+        }
+        catch(const std::exception &) {
+          // Damaged cache, it'll be replaced with a fresh one
+        }
+      }
+
+      cache.Store(this->inputSampleHash, hashTransformSettings(), this->targetBitrate, *track);
+
+      std::vector<std::byte> contents = cache.Save();
+      QFile::remove(QString::fromStdString(this->halfwaveCachePath));
+      std::shared_ptr<Nuclex::Audio::Storage::VirtualFile> file = (
+        Nuclex::Audio::Storage::VirtualFile::OpenRealFileForWriting(this->halfwaveCachePath)
+      );
+      file->WriteAt(0, contents.size(), contents.data());
+    }
+    catch(const std::exception &) {
+      // The cache is optional, the next run will just take longer
+    }
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  std::shared_ptr<Nuclex::Audio::Storage::VirtualFile> Transcoder::openOutputFile(
+    const std::string &fileOutputPath
+  ) {
+    if(fileOutputPath == StandardStreamPath) {
+      return Audio::PipeOutputFile::OpenStandardOutput();
+    } else {
+      return Nuclex::Audio::Storage::VirtualFile::OpenRealFileForWriting(fileOutputPath);
+    }
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
   void Transcoder::writeVirtualFileToDisk(
     const std::shared_ptr<const Nuclex::Audio::Storage::VirtualFile> &file,
     const std::string &fileOutputPath
   ) {
-    std::vector<std::byte> buffer(65536);
-
     std::shared_ptr<Nuclex::Audio::Storage::VirtualFile> outFile = (
-      Nuclex::Audio::Storage::VirtualFile::OpenRealFileForWriting(fileOutputPath)
+      openOutputFile(fileOutputPath)
     );
 
+    // Files produced by the encoders already sit in memory, so their buffers can be
+    // handed to the output file as they are, without copying them through another one
+    {
+      const Audio::MemoryFile *memoryFile = dynamic_cast<const Audio::MemoryFile *>(
+        file.get()
+      );
+      if(memoryFile != nullptr) {
+        const std::vector<std::byte> &contents = memoryFile->GetContents();
+        if(!contents.empty()) {
+          outFile->WriteAt(0, contents.size(), contents.data());
+        }
+        return;
+      }
+
+      const Audio::ChunkedMemoryFile *chunkedFile = (
+        dynamic_cast<const Audio::ChunkedMemoryFile *>(file.get())
+      );
+      if(chunkedFile != nullptr) {
+        chunkedFile->WriteTo(*outFile);
+        return;
+      }
+    }
+
+    std::vector<std::byte> buffer(65536);
+
     std::uint64_t length = file->GetSize();
     std::uint64_t offset = 0;
     while(0 < length) {
@@ -715,7 +2158,9 @@ namespace Nuclex::OpusTranscoder::Services {
       this->currentStepDescription = stepDescription;
 
       if(resetProgress) {
-        this->currentStepProgress = 0.0f;
+        this->progressTracker.BeginStep(0.0f);
+      } else {
+        this->progressTracker.BeginStep();
       }
     }
 
@@ -725,12 +2170,13 @@ namespace Nuclex::OpusTranscoder::Services {
   // ------------------------------------------------------------------------------------------- //
 
   void Transcoder::onStepProgressed(float progress) {
-    {
-      std::lock_guard<std::mutex> trackAccessScope(this->trackAccessMutex);
-      this->currentStepProgress = progress;
-    }
 
-    this->Progressed.Emit();
+    // This is called from the worker threads of the parallel stages, so it must not
+    // take any locks. Most reports only update the progress, the tracker picks one
+    // in each interval allowed by the maximum event rate to be announced.
+    if(this->progressTracker.Report(progress)) {
+      this->Progressed.Emit();
+    }
   }
 
   // ------------------------------------------------------------------------------------------- //
@@ -21,6 +21,8 @@ limitations under the License.
 #define NUCLEX_OPUSTRANSCODER_SERVICES_TRANSCODER_H
 
 #include "../Config.h"
+#include "../Audio/ProgressTracker.h"
+#include "../Audio/PerformanceReport.h"
 
 #include <Nuclex/Support/Threading/ConcurrentJob.h> // for ConcurrentJob
 #include <Nuclex/Support/Events/ConcurrentEvent.h> // for ConcurrentEvent
@@ -28,23 +30,37 @@ limitations under the License.
 
 #include <memory> // for std::shared_ptr
 #include <mutex> // for std::mutex
+#include <vector> // for std::vector
+#include <optional> // for std::optional
 
 namespace Nuclex::Audio::Storage {
 
   // ------------------------------------------------------------------------------------------- //
 
   class AudioLoader;
+  class AudioTrackDecoder;
   class VirtualFile;
 
   // ------------------------------------------------------------------------------------------- //
 
 } // namespace Nuclex::Audio::Storage
 
+namespace Nuclex::Support::Threading {
+
+  // ------------------------------------------------------------------------------------------- //
+
+  class ThreadPool;
+
+  // ------------------------------------------------------------------------------------------- //
+
+} // namespace Nuclex::Support::Threading
+
 namespace Nuclex::OpusTranscoder::Audio {
 
   // ------------------------------------------------------------------------------------------- //
 
   class Track;
+  class SegmentedOpusEncoder;
 
   // ------------------------------------------------------------------------------------------- //
 
@@ -54,6 +70,10 @@ namespace Nuclex::OpusTranscoder::Services {
 
   // ------------------------------------------------------------------------------------------- //
 
+  class MetadataCache;
+
+  // ------------------------------------------------------------------------------------------- //
+
   /// <summary>Transcodes an input audio file into the Opus format</summary>
   class Transcoder : public Nuclex::Support::Threading::ConcurrentJob {
 
@@ -66,6 +86,16 @@ namespace Nuclex::OpusTranscoder::Services {
 
     // ----------------------------------------------------------------------------------------- //
 
+    /// <summary>Input or output path that stands for the standard input or output</summary>
+    /// <remarks>
+    ///   Piped input can only be read front to back, so it works only with audio formats
+    ///   that state their length up front and with single-pass transcodes. The half-wave
+    ///   cache, the output cache and checkpoints are skipped for piped files.
+    /// </remarks>
+    public: static const std::string StandardStreamPath;
+
+    // ----------------------------------------------------------------------------------------- //
+
     /// <summary>Initializes a new audio metadata reader</summary>
     public: Transcoder(const std::shared_ptr<Nuclex::Audio::Storage::AudioLoader> &loader);
     /// <summary>Stops the checking thread and frees all resources</summary>
@@ -95,6 +125,91 @@ namespace Nuclex::OpusTranscoder::Services {
     /// </remarks>
     public: void EnableIterativeDeclipping(bool enable = true);
 
+    /// <summary>Enables prediction of the clipping introduced by the Opus codec</summary>
+    /// <param name="enable">True to enable predictive declipping, false to disable</param>
+    /// <remarks>
+    ///   <para>
+    ///     With this option, the input audio signal is scanned for true peaks (the peaks
+    ///     a decoder reconstructs between samples) and any half-wave whose true peak,
+    ///     plus the overshoot typical for Opus at the target bitrate, would exceed
+    ///     the maximum signal level is tucked in once, before the only encode.
+    ///   </para>
+    ///   <para>
+    ///     If iterative declipping is enabled as well, the encoded Opus audio stream is
+    ///     decoded and checked once, and only the half-waves that still clip go through
+    ///     the iterative loop. For most tracks, that means a single encode instead of many.
+    ///   </para>
+    /// </remarks>
+    public: void EnablePredictiveDeclipping(bool enable = true);
+
+    /// <summary>Sets the headroom the predictive declipper leaves for codec overshoot</summary>
+    /// <param name="decibels">
+    ///   Headroom in decibels or nothing to estimate it from the target bitrate
+    /// </param>
+    public: void SetPredictiveHeadroom(std::optional<float> decibels = std::optional<float>());
+
+    /// <summary>Enables compact storage of the original samples while declipping</summary>
+    /// <param name="enable">True to store the original samples compactly</param>
+    /// <remarks>
+    ///   The iterative declipper keeps the original samples around until it is done.
+    ///   With this option, samples that came from 16 bit or 24 bit PCM are stored at
+    ///   that width instead of as floats, which is lossless and cuts the memory they
+    ///   use by a quarter to a half. This is on by default.
+    /// </remarks>
+    public: void EnableCompactOriginalSamples(bool enable = true);
+
+    /// <summary>Enables a sidecar cache of the half-waves found by iterative declipping</summary>
+    /// <param name="enable">True to load and save the half-wave cache</param>
+    /// <remarks>
+    ///   After iterative declipping finishes, the clipping half-waves and the volume
+    ///   quotients that fixed them are saved next to the input file. When the same input
+    ///   is transcoded again with the same output layout, nightmode level and normalization,
+    ///   even at another bitrate, the iterative declipper starts from those quotients and
+    ///   usually finishes in one or two rounds. The cache file ends in ".halfwaves".
+    /// </remarks>
+    public: void EnableHalfwaveCache(bool enable = true);
+
+    /// <summary>Enables a cache of finished Opus files for repeated jobs</summary>
+    /// <param name="enable">True to look up and store output files in the cache</param>
+    /// <remarks>
+    ///   With this option, the input file is hashed before it is decoded. If the same
+    ///   input file was transcoded with the same settings before, the Opus file produced
+    ///   back then is hard-linked or copied to the output path, skipping the whole job.
+    ///   Where the cache lives, how large it may grow and which entries are evicted
+    ///   first is set up in Config.h.
+    /// </remarks>
+    public: void EnableOutputCache(bool enable = true);
+
+    /// <summary>Enables checkpoints between the rounds of iterative declipping</summary>
+    /// <param name="enable">True to save checkpoints and resume from them</param>
+    /// <remarks>
+    ///   After each encode, the iterative declipper saves the clipping half-waves, their
+    ///   volume quotients and the encoded segments next to the output file. If the job is
+    ///   killed and later started again with the same input and settings, it continues
+    ///   with the round it was in. The checkpoint ends in ".checkpoint" and is deleted
+    ///   once the output file has been written.
+    /// </remarks>
+    public: void EnableCheckpoints(bool enable = true);
+
+    /// <summary>Enables prediction of volume quotients for iterative declipping</summary>
+    /// <param name="enable">True to predict volume quotients, false to scale them</param>
+    /// <remarks>
+    ///   Without this option, the volume quotient of a half-wave still clipping after
+    ///   an encode/decode round is scaled by how far it overshot. With it, the quotients
+    ///   tried so far are used to estimate how strongly the codec responds to them,
+    ///   which gets half-waves below the ceiling in fewer rounds. This is on by default.
+    /// </remarks>
+    public: void EnableQuotientPrediction(bool enable = true);
+
+    /// <summary>Enables a safety margin for half-waves with clipping neighbours</summary>
+    /// <param name="enable">True to tuck in half-waves near others a little more</param>
+    /// <remarks>
+    ///   Half-waves that are still clipping and lie within an Opus frame of one another
+    ///   influence each other when encoded. With this option, such half-waves are tucked
+    ///   in slightly further than predicted, trading a tiny bit of volume for fewer rounds.
+    /// </remarks>
+    public: void EnableNeighbourSafetyMargin(bool enable = true);
+
     /// <summary>
     ///   Sets the level to which the alternative nightmode downmix formula will be applied
     /// </summary>
@@ -117,10 +232,47 @@ namespace Nuclex::OpusTranscoder::Services {
     /// <param name="effort">The amount of effort to invest on a scale from 0.0 to 1.0</param>
     public: void SetEffort(float effort);
 
+    /// <summary>Selects which of the input file's audio tracks will be transcoded</summary>
+    /// <param name="trackIndex">Zero-based index of the track that will be transcoded</param>
+    /// <remarks>
+    ///   Each transcoder produces one Opus file from one track. To extract several tracks,
+    ///   run one transcoder per track and hand them all the same input file through
+    ///   the <see cref="TranscodeAudioFile" /> overload that accepts an opened file.
+    /// </remarks>
+    public: void SelectTrack(std::size_t trackIndex);
+
+    /// <summary>Shares a cache of audio file metadata with the transcoder</summary>
+    /// <param name="cache">Metadata cache that will be used, null for none</param>
+    /// <remarks>
+    ///   The input file's headers have usually been read just before the transcode,
+    ///   to show its metadata or to plan a batch. With a cache, the transcoder takes
+    ///   the metadata from there instead of reading the headers a second time.
+    /// </remarks>
+    public: void SetMetadataCache(const std::shared_ptr<MetadataCache> &cache);
+
     /// <summary>Transcodes the specified audio file to an Opus audio file</summary>
     /// <param name="inputPath">Path to the audio file that will be transcoded</param>
     /// <param name="outputPath">Path where the produced Opus file will be saved</param>
+    /// <remarks>
+    ///   Either path can be <see cref="StandardStreamPath" /> to read from standard input
+    ///   or write to standard output.
+    /// </remarks>
+    public: void TranscodeAudioFile(
+      const std::string &inputPath,
+      const std::string &outputPath
+    );
+
+    /// <summary>Transcodes an already opened audio file to an Opus audio file</summary>
+    /// <param name="inputFile">Input file, which may be shared with other transcoders</param>
+    /// <param name="inputPath">Path the input file was opened from</param>
+    /// <param name="outputPath">Path where the produced Opus file will be saved</param>
+    /// <remarks>
+    ///   Transcoders extracting different tracks from the same input can share a single
+    ///   in-memory copy of it this way, so the input is only read from disk once. The path
+    ///   is still needed to locate the half-wave cache.
+    /// </remarks>
     public: void TranscodeAudioFile(
+      const std::shared_ptr<const Nuclex::Audio::Storage::VirtualFile> &inputFile,
       const std::string &inputPath,
       const std::string &outputPath
     );
@@ -133,14 +285,60 @@ namespace Nuclex::OpusTranscoder::Services {
 
     /// <summary>Queries the progress of the currently running step</summary>
     /// <returns>The progress of the currently running step</returns>
+    /// <remarks>
+    ///   This doesn't take any locks, so it's fine to call it whenever the
+    ///   <see cref="Progressed" /> event fires.
+    /// </remarks>
     public: float GetCurrentStepProgress() const;
 
+    /// <summary>Limits how often the <see cref="Progressed" /> event is fired</summary>
+    /// <param name="eventsPerSecond">
+    ///   Maximum number of progress events per second, 0 to fire one for each report
+    /// </param>
+    /// <remarks>
+    ///   Parallel stages report progress from all worker threads, far more often than
+    ///   a progress bar can be redrawn. The default is set up in Config.h.
+    /// </remarks>
+    public: void SetMaximumProgressEventRate(float eventsPerSecond);
+
     /// <summary>Returns whether the transcode was successful or failed</summary>
     /// <returns>
     ///   True if the transcoded succeeded, false if it failed, nothing if it is still ongoing
     /// </returns>
     public: std::optional<bool> GetOutcome() const;
 
+    /// <summary>Returns the number of encode rounds the iterative declipper needed</summary>
+    /// <returns>
+    ///   The number of times the track was encoded and verified during the last transcode,
+    ///   zero if iterative declipping was not used
+    /// </returns>
+    public: std::size_t GetDeclippingRoundCount() const;
+
+    /// <summary>Returns the timings and memory use recorded during the last transcode</summary>
+    /// <returns>The performance report of the last transcode</returns>
+    /// <remarks>
+    ///   The report is written to while a transcode runs, so it must only be looked at
+    ///   once the <see cref="Ended" /> event has fired and before the next transcode is
+    ///   started. <see cref="Audio::PerformanceReport::ToJson" /> turns it into a line
+    ///   of JSON for monitoring tools.
+    /// </remarks>
+    public: const Audio::PerformanceReport &GetPerformanceReport() const {
+      return this->performanceReport;
+    }
+
+    /// <summary>Estimates how much memory transcoding a track will need</summary>
+    /// <param name="trackInfo">Metadata of the track that would be transcoded</param>
+    /// <returns>The approximate peak memory use in bytes with the current settings</returns>
+    /// <remarks>
+    ///   Streamed transcodes need a few MiB, no matter how long the track is. Transcodes
+    ///   that hold the whole track in memory need the decoded samples plus the samples
+    ///   in the output layout while it is being transformed, and for iterative
+    ///   declipping, a few copies of the encoded Opus stream.
+    /// </remarks>
+    public: std::uint64_t EstimateMemoryFootprint(
+      const Nuclex::Audio::TrackInfo &trackInfo
+    ) const;
+
     // ----------------------------------------------------------------------------------------- //
 
     /// <summary>Called in the background thread to perform the actual work</summary>
@@ -151,6 +349,47 @@ namespace Nuclex::OpusTranscoder::Services {
 
     // ----------------------------------------------------------------------------------------- //
 
+    /// <summary>Transcodes the input file with the whole track held in memory</summary>
+    /// <param name="file">File that will be transcoded</param>
+    /// <param name="canceler">Token by which the operation can be signalled to cancel</param>
+    /// <remarks>
+    ///   This is required for iterative de-clipping, which re-encodes the track over and
+    ///   over. Memory use is proportional to the length of the track.
+    /// </remarks>
+    private: void transcodeInMemory(
+      const std::shared_ptr<const Nuclex::Audio::Storage::VirtualFile> &file,
+      const std::shared_ptr<const Nuclex::Support::Threading::StopToken> &canceler
+    );
+
+    /// <summary>Transcodes the input file in small windows that are streamed through</summary>
+    /// <param name="file">File that will be transcoded</param>
+    /// <param name="canceler">Token by which the operation can be signalled to cancel</param>
+    /// <remarks>
+    ///   Each window is decoded, normalized, transformed to the output layout and
+    ///   de-clipped before being fed to the Opus encoder, which writes straight into
+    ///   the output file. Memory use stays at a few MiB regardless of track length.
+    ///   Decoding, remixing and encoding run overlapped in three threads that pass
+    ///   windows to each other through lock-free ring buffers.
+    /// </remarks>
+    private: void transcodeInWindows(
+      const std::shared_ptr<const Nuclex::Audio::Storage::VirtualFile> &file,
+      const std::shared_ptr<const Nuclex::Support::Threading::StopToken> &canceler
+    );
+
+    /// <summary>Opens a decoder for an audio track in the specified file</summary>
+    /// <param name="file">File for which a decoder will be opened</param>
+    /// <param name="trackInfo">Receives the metadata of the audio track</param>
+    /// <param name="isInputFile">
+    ///   True if the file is the input file, whose selected track is opened and whose
+    ///   metadata can come from the metadata cache, false for an encoded Opus stream
+    /// </param>
+    /// <returns>A decoder that decodes the audio track's samples</returns>
+    private: std::shared_ptr<Nuclex::Audio::Storage::AudioTrackDecoder> openAudioDecoder(
+      const std::shared_ptr<const Nuclex::Audio::Storage::VirtualFile> &file,
+      Nuclex::Audio::TrackInfo &trackInfo,
+      bool isInputFile = true
+    );
+
     /// <summary>Decodes all audio samples from the input file into memory</summary>
     /// <param name="file">File from which the Opus audio data will be decoded</param>
     /// <param name="canceler">Token by which the operation can be signalled to cancel</param>
@@ -163,19 +402,39 @@ namespace Nuclex::OpusTranscoder::Services {
     /// <summary>Transforms the input channels ot the selected output layout</summary>
     /// <param name="track">Track that will be transformed to the output channel layout</param>
     /// <param name="canceler">Token by which the operation can be signalled to cancel</param>
+    /// <param name="reportProgress">Whether to report the step and its progress</param>
+    /// <param name="channelGains">
+    ///   Optional factor by which each input channel is amplified, applied in the same
+    ///   pass as the layout transform (or on its own if no transform is needed)
+    /// </param>
     /// <remarks>
     ///   This will upmix, downmix or reorder the audio samples to either of the two
     ///   support channel layouts - stereo or 5.1 surround.
     /// </remarks>
     private: void transformToOutputLayout(
+      const std::shared_ptr<Nuclex::OpusTranscoder::Audio::Track> &track,
+      const std::shared_ptr<const Nuclex::Support::Threading::StopToken> &canceler,
+      bool reportProgress = true,
+      const std::vector<float> &channelGains = std::vector<float>()
+    );
+
+    /// <summary>Resamples the track to the sample rate Opus works at</summary>
+    /// <param name="track">Track that will be resampled if it isn't at 48 kHz already</param>
+    /// <param name="canceler">Token by which the operation can be signalled to cancel</param>
+    /// <remarks>
+    ///   Otherwise the encoder would resample the track again in each declipping round,
+    ///   and the clipping would be looked for in samples that never get encoded.
+    /// </remarks>
+    private: void resampleToOpusRate(
       const std::shared_ptr<Nuclex::OpusTranscoder::Audio::Track> &track,
       const std::shared_ptr<const Nuclex::Support::Threading::StopToken> &canceler
     );
 
-    /// <summary>Normalizes the volume of the track</summary>
-    /// <param name="track">Track that will be normalized</param>
+    /// <summary>Measures the gains by which the track's channels need to be normalized</summary>
+    /// <param name="track">Track whose volume will be measured</param>
     /// <param name="canceler">Token by which the operation can be signalled to cancel</param>
-    private: void normalizeTrack(
+    /// <returns>The factor by which each of the track's channels should be amplified</returns>
+    private: std::vector<float> measureNormalizationGains(
       const std::shared_ptr<Nuclex::OpusTranscoder::Audio::Track> &track,
       const std::shared_ptr<const Nuclex::Support::Threading::StopToken> &canceler
     );
@@ -189,14 +448,11 @@ namespace Nuclex::OpusTranscoder::Services {
       const std::shared_ptr<const Nuclex::Support::Threading::StopToken> &canceler
     );
 
-    /// <summary>Re-examines the clipping hakf-waves in the new audio sample array</summary>
+    /// <summary>Looks for half-waves that will likely clip after encoding</summary>
     /// <param name="track">Track in which clipping half-waves will be looked for</param>
-    /// <param name="samples">Samples in which the clipping half-waves will be checked</param>
     /// <param name="canceler">Token by which the operation can be signalled to cancel</param>
-    /// <returns>The number of clipping half-waves still present</returns>
-    private: std::size_t updateClippingHalfwaves(
+    private: void findPredictedClippingHalfwaves(
       const std::shared_ptr<Nuclex::OpusTranscoder::Audio::Track> &track,
-      const std::vector<float> &samples,
       const std::shared_ptr<const Nuclex::Support::Threading::StopToken> &canceler
     );
 
@@ -216,6 +472,94 @@ namespace Nuclex::OpusTranscoder::Services {
       const std::shared_ptr<const Nuclex::Support::Threading::StopToken> &canceler
     );
 
+    /// <summary>Encodes the dirty segments of a track and stitches them together</summary>
+    /// <param name="encoder">Segmented encoder that will encode the track</param>
+    /// <param name="canceler">Token by which the operation can be signalled to cancel</param>
+    /// <returns>A virtual file containing the encoded Opus file contents</returns>
+    private: std::shared_ptr<const Nuclex::Audio::Storage::VirtualFile> encodeSegments(
+      Nuclex::OpusTranscoder::Audio::SegmentedOpusEncoder &encoder,
+      const std::shared_ptr<const Nuclex::Support::Threading::StopToken> &canceler
+    );
+
+    /// <summary>Decodes the re-encoded segments and checks them for clipping</summary>
+    /// <param name="file">Opus file that was stitched from the encoded segments</param>
+    /// <param name="encoder">Segmented encoder that produced the Opus file</param>
+    /// <param name="track">Track whose clipping half-waves will be updated</param>
+    /// <param name="canceler">Token by which the operation can be signalled to cancel</param>
+    /// <returns>The number of half-waves that are still suffering from clipping</returns>
+    private: std::size_t verifyEncodedSegments(
+      const std::shared_ptr<const Nuclex::Audio::Storage::VirtualFile> &file,
+      const Nuclex::OpusTranscoder::Audio::SegmentedOpusEncoder &encoder,
+      const std::shared_ptr<Nuclex::OpusTranscoder::Audio::Track> &track,
+      const std::shared_ptr<const Nuclex::Support::Threading::StopToken> &canceler
+    );
+
+    /// <summary>Updates the volume quotients of the track's clipping half-waves</summary>
+    /// <param name="track">Track whose clipping half-waves will be updated</param>
+    /// <param name="encoder">Encoder in which the changed segments will be marked</param>
+    /// <param name="isFirstTuck">
+    ///   Whether the half-waves are being tucked in for the first time, in which case
+    ///   all of them change, not just those that are still clipping
+    /// </param>
+    /// <param name="canceler">Token by which the operation can be signalled to cancel</param>
+    private: void updateVolumeQuotients(
+      const std::shared_ptr<Nuclex::OpusTranscoder::Audio::Track> &track,
+      Nuclex::OpusTranscoder::Audio::SegmentedOpusEncoder &encoder,
+      bool isFirstTuck,
+      const std::shared_ptr<const Nuclex::Support::Threading::StopToken> &canceler
+    );
+
+    /// <summary>Hashes all settings that change the samples before declipping</summary>
+    /// <returns>A hash of the output layout, nightmode level and normalization settings</returns>
+    private: std::uint64_t hashTransformSettings() const;
+
+    /// <summary>Hashes all settings that influence the encoded Opus file</summary>
+    /// <returns>A hash of all transcoding settings</returns>
+    private: std::uint64_t hashEncoderSettings() const;
+
+    /// <summary>Tries to restore the track's clipping half-waves from the sidecar cache</summary>
+    /// <param name="track">Track whose clipping half-waves will be restored</param>
+    /// <returns>True if the clipping half-waves were restored from the cache</returns>
+    private: bool restoreClippingHalfwaves(
+      const std::shared_ptr<Nuclex::OpusTranscoder::Audio::Track> &track
+    );
+
+    /// <summary>Tries to continue an iterative declipping job from its checkpoint</summary>
+    /// <param name="track">Track whose clipping half-waves will be restored</param>
+    /// <param name="encoder">Encoder whose segments will be restored</param>
+    /// <param name="round">Receives the round that will verify the restored encode</param>
+    /// <param name="canceler">Token by which the operation can be signalled to cancel</param>
+    /// <returns>The encoded Opus file at the checkpoint or nothing if there is none</returns>
+    private: std::shared_ptr<const Nuclex::Audio::Storage::VirtualFile> resumeFromCheckpoint(
+      const std::shared_ptr<Nuclex::OpusTranscoder::Audio::Track> &track,
+      Nuclex::OpusTranscoder::Audio::SegmentedOpusEncoder &encoder,
+      std::size_t &round,
+      const std::shared_ptr<const Nuclex::Support::Threading::StopToken> &canceler
+    );
+
+    /// <summary>Saves a checkpoint of the iterative declipping job</summary>
+    /// <param name="track">Track whose clipping half-waves will be saved</param>
+    /// <param name="encoder">Encoder whose segments will be saved</param>
+    /// <param name="round">Round that will verify the encoder's last encode</param>
+    private: void saveCheckpoint(
+      const std::shared_ptr<Nuclex::OpusTranscoder::Audio::Track> &track,
+      const Nuclex::OpusTranscoder::Audio::SegmentedOpusEncoder &encoder,
+      std::size_t round
+    );
+
+    /// <summary>Stores the track's clipping half-waves in the sidecar cache</summary>
+    /// <param name="track">Track whose clipping half-waves will be stored</param>
+    private: void storeClippingHalfwaves(
+      const std::shared_ptr<Nuclex::OpusTranscoder::Audio::Track> &track
+    );
+
+    /// <summary>Opens the output file, which can be the standard output</summary>
+    /// <param name="fileOutputPath">Path of the output file that will be opened</param>
+    /// <returns>The opened output file</returns>
+    private: static std::shared_ptr<Nuclex::Audio::Storage::VirtualFile> openOutputFile(
+      const std::string &fileOutputPath
+    );
+
     /// <summary>Writes the contents of the specified virtual file to real file</summary>
     /// <param name="file">File that will be written to disk</param>
     /// <param name="outputPath">Path in which the real file will be stored</param>
@@ -240,12 +584,32 @@ namespace Nuclex::OpusTranscoder::Services {
 
     /// <summary>Handles loading and decoding of audio files</summary>
     private: std::shared_ptr<Nuclex::Audio::Storage::AudioLoader> loader;
+    /// <summary>Remembers the metadata of audio files that have been read before</summary>
+    private: std::shared_ptr<MetadataCache> metadataCache;
+    /// <summary>Process-wide thread pool used to process the track in parallel</summary>
+    private: std::shared_ptr<Nuclex::Support::Threading::ThreadPool> threadPool;
     /// <summary>Must be held when accessing the paths or audio data</summary>
     private: mutable std::mutex trackAccessMutex;
     /// <summary>Whether to de-clip the input file before encoding</summary>
     private: bool declip;
     /// <summary>Whether to check the encoded Opus file for clipping, too</summary>
     private: bool iterativeDeclip;
+    /// <summary>Whether to tuck in half-waves by their predicted decoded peaks</summary>
+    private: bool predictiveDeclip;
+    /// <summary>Headroom in decibels left by the predictive declipper, if fixed</summary>
+    private: std::optional<float> predictiveHeadroom;
+    /// <summary>Whether the original samples are compacted for iterative declipping</summary>
+    private: bool compactOriginalSamples;
+    /// <summary>Whether iterative declipping loads and saves the half-wave cache</summary>
+    private: bool useHalfwaveCache;
+    /// <summary>Whether finished Opus files are looked up and stored in the output cache</summary>
+    private: bool useOutputCache;
+    /// <summary>Whether iterative declipping saves checkpoints and resumes from them</summary>
+    private: bool useCheckpoints;
+    /// <summary>Whether volume quotients are predicted from earlier attempts</summary>
+    private: bool predictQuotients;
+    /// <summary>Whether half-waves with clipping neighbours get a safety margin</summary>
+    private: bool neighbourSafetyMargin;
     /// <summary>Level to which to apply the alternative Nightmode downmix formula</summary>
     private: float nightmodeLevel;
     /// <summary>Channels that should be present in the encoded output file</summary>
@@ -256,14 +620,30 @@ namespace Nuclex::OpusTranscoder::Services {
     private: bool normalize;
     /// <summary>Amount of compression effort on a scale from 0.0 to 1.0</summary>
     private: float effort;
+    /// <summary>Index of the input file's track that will be transcoded</summary>
+    private: std::size_t trackIndex;
 
     /// <summary>Path of the file being transcoded</summary>
     private: std::string inputPath;
+    /// <summary>Whether the file being transcoded is read from standard input</summary>
+    private: bool isInputPiped;
+    /// <summary>Path for which the input file's metadata is cached, empty if not</summary>
+    private: std::string metadataPath;
+    /// <summary>Already opened input file, if provided instead of just the path</summary>
+    private: std::shared_ptr<const Nuclex::Audio::Storage::VirtualFile> inputFile;
     /// <summary>Order in which the input channels appear</summary>
     private: std::vector<Nuclex::Audio::ChannelPlacement> inputChannelOrder;
+    /// <summary>Hash of the decoded input samples, for the half-wave cache</summary>
+    private: std::uint64_t inputSampleHash;
+    /// <summary>Path of the half-wave cache belonging to the file being transcoded</summary>
+    private: std::string halfwaveCachePath;
+    /// <summary>Path of the declipping checkpoint belonging to the output file</summary>
+    private: std::string checkpointPath;
 
     /// <summary>Path under which the encoded Opus file will be saved</summary>
     private: std::string outputPath;
+    /// <summary>Whether the encoded Opus file is written to standard output</summary>
+    private: bool isOutputPiped;
     /// <summary>Order in which the output channels appear</summary>
     private: std::vector<Nuclex::Audio::ChannelPlacement> outputChannelOrder;
 
@@ -271,10 +651,14 @@ namespace Nuclex::OpusTranscoder::Services {
     private: std::string stepPrefix;
     /// <summary>Description of the currently running transcode step</summary>
     private: std::string currentStepDescription;
-    /// <summary>Progress of the currently running transcode step</summary>
-    private: float currentStepProgress;
+    /// <summary>Number and progress of the currently running transcode step</summary>
+    private: Audio::ProgressTracker progressTracker;
     /// <summary>Success/failure state of the transcode after it finished</summary>
     private: std::optional<bool> outcome;
+    /// <summary>Number of encode rounds the iterative declipper went through</summary>
+    private: std::size_t declippingRoundCount;
+    /// <summary>Timings and memory use recorded during the transcode</summary>
+    private: Audio::PerformanceReport performanceReport;
 
   };
 
@@ -108,7 +108,7 @@ namespace Nuclex::OpusTranscoder::Audio {
     using Nuclex::Support::Threading::StopToken;
 
     std::shared_ptr<Track> track = makeFiveDotOneTrack();
-    track->Samples.resize(18);
+    track->Samples.resize(18, 0.0f);
     track->Samples[0] = 1.0f; // left
     track->Samples[1] = 1.0f; // right
     track->Samples[2] = 1.0f; // center
@@ -156,7 +156,7 @@ namespace Nuclex::OpusTranscoder::Audio {
     using Nuclex::Support::Threading::StopToken;
 
     std::shared_ptr<Track> track = makeSevenDotOneTrack();
-    track->Samples.resize(24);
+    track->Samples.resize(24, 0.0f);
     track->Samples[0] = 1.0f; // left
     track->Samples[1] = 1.0f; // right
     track->Samples[2] = 1.0f; // center
@@ -210,7 +210,7 @@ namespace Nuclex::OpusTranscoder::Audio {
     using Nuclex::Support::Threading::StopToken;
 
     std::shared_ptr<Track> track = makeSevenDotOneTrack();
-    track->Samples.resize(24);
+    track->Samples.resize(24, 0.0f);
     track->Samples[0] = 1.0f; // left
     track->Samples[1] = 1.0f; // right
     track->Samples[2] = 1.0f; // center
@@ -270,6 +270,10 @@ namespace Nuclex::OpusTranscoder::Audio {
     EXPECT_EQ(track->Samples[15], 0.125f + 0.375f); // back left
     EXPECT_EQ(track->Samples[16], 0.25f + 0.5f); // back right
     EXPECT_EQ(track->Samples[17], 0.0f); // lfe
+
+    ASSERT_TRUE(track->Statistics.Covers(6, 3));
+    EXPECT_EQ(track->Statistics.GetBassChannelIndex(), 5U);
+    EXPECT_EQ(track->Statistics.GetBassPeakAmplitude(), 2.0f);
   }
 
   // ------------------------------------------------------------------------------------------- //
@@ -316,7 +320,7 @@ namespace Nuclex::OpusTranscoder::Audio {
     using Nuclex::Support::Threading::StopToken;
 
     std::shared_ptr<Track> track = makeFiveDotOneTrack();
-    track->Samples.resize(18);
+    track->Samples.resize(18, 0.0f);
     track->Samples[0] = 1.0f; // left
     track->Samples[1] = 1.0f; // right
     track->Samples[2] = 1.0f; // center
@@ -374,4 +378,205 @@ namespace Nuclex::OpusTranscoder::Audio {
 
   // ------------------------------------------------------------------------------------------- //
 
+  TEST(ChannelLayoutTransformerTests, DownmixHandlesPartialBatchesAndChunks) {
+    using Nuclex::Support::Events::Delegate;
+    using Nuclex::Support::Threading::StopSource;
+    using Nuclex::Support::Threading::StopToken;
+
+    // Enough frames to span several progress chunks, ending in a partial batch
+    const std::size_t frameCount = 0x3000 * 2 + 7;
+
+    std::shared_ptr<Track> track = makeSevenDotOneTrack();
+    track->Samples.resize(frameCount * 8);
+    for(std::size_t index = 0; index < track->Samples.size(); ++index) {
+      track->Samples[index] = static_cast<float>(index % 1009) / 1024.0f;
+    }
+    SampleBuffer original = track->Samples;
+
+    Delegate<void(float)> progressCallback = (
+      Delegate<void(float)>::Create<&doNothing>()
+    );
+    ChannelLayoutTransformer::DownmixToFiveDotOne(
+      track, StopSource::Create()->GetToken(), progressCallback
+    );
+
+    ASSERT_EQ(track->Samples.size(), frameCount * 6);
+    for(std::size_t index = 0; index < frameCount; ++index) {
+      const float *input = original.data() + index * 8;
+      const float *output = track->Samples.data() + index * 6;
+      EXPECT_EQ(output[0], input[0]); // front left
+      EXPECT_EQ(output[1], input[2]); // front center
+      EXPECT_EQ(output[2], input[1]); // front right
+      EXPECT_EQ(output[3], input[6] + input[4]); // back left
+      EXPECT_EQ(output[4], input[7] + input[5]); // back right
+      EXPECT_EQ(output[5], input[3]); // lfe
+    }
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  TEST(ChannelLayoutTransformerTests, UpmixHandlesPartialBatchesAndChunks) {
+    using Nuclex::Support::Events::Delegate;
+    using Nuclex::Support::Threading::StopSource;
+    using Nuclex::Support::Threading::StopToken;
+
+    // Enough frames to span several progress chunks, ending in a partial batch
+    const std::size_t frameCount = 0x3000 * 2 + 5;
+
+    std::shared_ptr<Track> track = std::make_shared<Track>();
+    track->Channels.resize(1);
+    track->Channels[0].Placement = Nuclex::Audio::ChannelPlacement::FrontCenter;
+    track->Samples.resize(frameCount);
+    for(std::size_t index = 0; index < frameCount; ++index) {
+      track->Samples[index] = static_cast<float>(index) / static_cast<float>(frameCount);
+    }
+
+    Delegate<void(float)> progressCallback = (
+      Delegate<void(float)>::Create<&doNothing>()
+    );
+    ChannelLayoutTransformer::UpmixToStereo(
+      track, StopSource::Create()->GetToken(), progressCallback
+    );
+
+    ASSERT_EQ(track->Samples.size(), frameCount * 2);
+    for(std::size_t index = 0; index < frameCount; ++index) {
+      float expected = static_cast<float>(index) / static_cast<float>(frameCount);
+      EXPECT_EQ(track->Samples[index * 2], expected);
+      EXPECT_EQ(track->Samples[index * 2 + 1], expected);
+    }
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  TEST(ChannelLayoutTransformerTests, AppliesChannelGainsWhileMixing) {
+    using Nuclex::Support::Events::Delegate;
+    using Nuclex::Support::Threading::StopSource;
+    using Nuclex::Support::Threading::StopToken;
+
+    std::shared_ptr<Track> track = makeFiveDotOneTrack();
+    track->Samples.resize(60);
+    for(std::size_t index = 0; index < track->Samples.size(); ++index) {
+      track->Samples[index] = static_cast<float>(index % 7) / 8.0f - 0.25f;
+    }
+    std::shared_ptr<Track> reweavedTrack = std::make_shared<Track>(*track);
+
+    // LFE (channel 3) gets its own gain, like the normalizer would do it
+    std::vector<float> channelGains = { 1.5f, 1.5f, 1.5f, 3.0f, 1.5f, 1.5f };
+
+    Delegate<void(float)> progressCallback = (
+      Delegate<void(float)>::Create<&doNothing>()
+    );
+    ChannelLayoutTransformer::ReweaveToVorbisLayout(
+      reweavedTrack, StopSource::Create()->GetToken(), progressCallback, channelGains
+    );
+
+    // Expected: front left, front center, front right, back left, back right, lfe
+    const std::size_t sourceChannels[6] = { 0, 2, 1, 4, 5, 3 };
+    ASSERT_EQ(reweavedTrack->Samples.size(), 60U);
+    for(std::size_t frameIndex = 0; frameIndex < 10; ++frameIndex) {
+      for(std::size_t channelIndex = 0; channelIndex < 6; ++channelIndex) {
+        std::size_t sourceChannel = sourceChannels[channelIndex];
+        EXPECT_EQ(
+          reweavedTrack->Samples[frameIndex * 6 + channelIndex],
+          track->Samples[frameIndex * 6 + sourceChannel] * channelGains[sourceChannel]
+        );
+      }
+    }
+
+    // Downmixing with gains should give the same result as amplifying beforehand
+    std::shared_ptr<Track> amplifiedTrack = std::make_shared<Track>(*track);
+    for(std::size_t index = 0; index < amplifiedTrack->Samples.size(); ++index) {
+      amplifiedTrack->Samples[index] *= channelGains[index % 6];
+    }
+    ChannelLayoutTransformer::DownmixToStereo(
+      amplifiedTrack, 0.0f, StopSource::Create()->GetToken(), progressCallback
+    );
+    ChannelLayoutTransformer::DownmixToStereo(
+      track, 0.0f, StopSource::Create()->GetToken(), progressCallback, channelGains
+    );
+
+    ASSERT_EQ(track->Samples.size(), 20U);
+    for(std::size_t index = 0; index < 20; ++index) {
+      EXPECT_FLOAT_EQ(track->Samples[index], amplifiedTrack->Samples[index]);
+    }
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  TEST(ChannelLayoutTransformerTests, PlanarDownmixMatchesInterleavedDownmix) {
+    using Nuclex::Support::Events::Delegate;
+    using Nuclex::Support::Threading::StopSource;
+    using Nuclex::Support::Threading::StopToken;
+
+    const std::size_t frameCount = 0x3000 * 2 + 7;
+
+    std::shared_ptr<Track> interleavedTrack = makeSevenDotOneTrack();
+    interleavedTrack->Samples.resize(frameCount * 8);
+    for(std::size_t index = 0; index < interleavedTrack->Samples.size(); ++index) {
+      interleavedTrack->Samples[index] = static_cast<float>(index % 1009) / 1024.0f;
+    }
+
+    std::shared_ptr<Track> planarTrack = makeSevenDotOneTrack();
+    planarTrack->Samples = interleavedTrack->Samples;
+    planarTrack->ConvertToPlanar();
+
+    Delegate<void(float)> progressCallback = (
+      Delegate<void(float)>::Create<&doNothing>()
+    );
+    ChannelLayoutTransformer::DownmixToStereo(
+      interleavedTrack, 0.5f, StopSource::Create()->GetToken(), progressCallback
+    );
+    ChannelLayoutTransformer::DownmixToStereo(
+      planarTrack, 0.5f, StopSource::Create()->GetToken(), progressCallback
+    );
+
+    ASSERT_TRUE(planarTrack->IsPlanar);
+    ASSERT_EQ(planarTrack->Channels.size(), 2U);
+    ASSERT_EQ(planarTrack->CountFrames(), frameCount);
+    EXPECT_TRUE(planarTrack->Statistics.Covers(2, frameCount));
+    for(std::size_t index = 0; index < frameCount; ++index) {
+      for(std::size_t channelIndex = 0; channelIndex < 2; ++channelIndex) {
+        EXPECT_FLOAT_EQ(
+          planarTrack->Channels[channelIndex].Samples[index],
+          interleavedTrack->Samples[index * 2 + channelIndex]
+        );
+      }
+    }
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  TEST(ChannelLayoutTransformerTests, PlanarReweaveHandsOverChannelPlanes) {
+    using Nuclex::Support::Events::Delegate;
+    using Nuclex::Support::Threading::StopSource;
+    using Nuclex::Support::Threading::StopToken;
+
+    std::shared_ptr<Track> track = makeFiveDotOneTrack();
+    track->IsPlanar = true;
+    const float *planes[6];
+    for(std::size_t channelIndex = 0; channelIndex < 6; ++channelIndex) {
+      track->Channels[channelIndex].Samples.resize(100, static_cast<float>(channelIndex));
+      planes[channelIndex] = track->Channels[channelIndex].Samples.data();
+    }
+
+    Delegate<void(float)> progressCallback = (
+      Delegate<void(float)>::Create<&doNothing>()
+    );
+    ChannelLayoutTransformer::ReweaveToVorbisLayout(
+      track, StopSource::Create()->GetToken(), progressCallback
+    );
+
+    // Input order is L, R, C, LFE, BL, BR, Vorbis order is L, C, R, BL, BR, LFE
+    const std::size_t expectedSources[6] = { 0, 2, 1, 4, 5, 3 };
+    ASSERT_EQ(track->Channels.size(), 6U);
+    for(std::size_t channelIndex = 0; channelIndex < 6; ++channelIndex) {
+      std::size_t sourceIndex = expectedSources[channelIndex];
+      ASSERT_EQ(track->Channels[channelIndex].Samples.size(), 100U);
+      EXPECT_EQ(track->Channels[channelIndex].Samples.data(), planes[sourceIndex]);
+      EXPECT_EQ(track->Channels[channelIndex].Samples[99], static_cast<float>(sourceIndex));
+    }
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
 } // namespace Nuclex::OpusTranscoder::Audio
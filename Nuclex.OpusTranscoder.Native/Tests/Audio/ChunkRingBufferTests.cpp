@@ -0,0 +1,102 @@
+#pragma region Apache License 2.0
+/*
+Nuclex Opus Transcoder
+Copyright (C) 2024 Markus Ewald / Nuclex Development Labs
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#pragma endregion // Apache License 2.0
+
+// If the library is compiled as a DLL, this ensures symbols are exported
+#define NUCLEX_OPUSTRANSCODER_SOURCE 1
+
+#include "../../Source/Config.h"
+#include "../../Source/Audio/ChunkRingBuffer.h"
+
+#include <gtest/gtest.h>
+
+#include <thread> // for std::thread
+
+namespace Nuclex::OpusTranscoder::Audio {
+
+  // ------------------------------------------------------------------------------------------- //
+
+  TEST(ChunkRingBufferTests, ItemsComeOutInOrder) {
+    ChunkRingBuffer<int> ringBuffer(3);
+
+    EXPECT_TRUE(ringBuffer.TryPush(1));
+    EXPECT_TRUE(ringBuffer.TryPush(2));
+    EXPECT_TRUE(ringBuffer.TryPush(3));
+
+    int item = 0;
+    EXPECT_TRUE(ringBuffer.TryPop(item));
+    EXPECT_EQ(item, 1);
+    EXPECT_TRUE(ringBuffer.TryPush(4));
+    EXPECT_TRUE(ringBuffer.TryPop(item));
+    EXPECT_EQ(item, 2);
+    EXPECT_TRUE(ringBuffer.TryPop(item));
+    EXPECT_EQ(item, 3);
+    EXPECT_TRUE(ringBuffer.TryPop(item));
+    EXPECT_EQ(item, 4);
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  TEST(ChunkRingBufferTests, ReportsFullAndEmptyStates) {
+    ChunkRingBuffer<int> ringBuffer(2);
+
+    int item = 0;
+    EXPECT_FALSE(ringBuffer.TryPop(item));
+
+    EXPECT_TRUE(ringBuffer.TryPush(1));
+    EXPECT_TRUE(ringBuffer.TryPush(2));
+    EXPECT_FALSE(ringBuffer.TryPush(3));
+
+    EXPECT_TRUE(ringBuffer.TryPop(item));
+    EXPECT_TRUE(ringBuffer.TryPop(item));
+    EXPECT_FALSE(ringBuffer.TryPop(item));
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  TEST(ChunkRingBufferTests, TransfersItemsBetweenThreads) {
+    ChunkRingBuffer<std::size_t> ringBuffer(4);
+    const std::size_t itemCount = 100000;
+
+    std::thread producer(
+      [&]() {
+        for(std::size_t index = 1; index <= itemCount; ++index) {
+          while(!ringBuffer.TryPush(index)) {
+            std::this_thread::yield();
+          }
+        }
+      }
+    );
+
+    std::size_t expected = 1;
+    while(expected <= itemCount) {
+      std::size_t item;
+      if(ringBuffer.TryPop(item)) {
+        EXPECT_EQ(item, expected);
+        ++expected;
+      } else {
+        std::this_thread::yield();
+      }
+    }
+
+    producer.join();
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+} // namespace Nuclex::OpusTranscoder::Audio
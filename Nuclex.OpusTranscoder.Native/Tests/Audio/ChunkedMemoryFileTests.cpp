@@ -0,0 +1,138 @@
+#pragma region Apache License 2.0
+/*
+Nuclex Opus Transcoder
+Copyright (C) 2024 Markus Ewald / Nuclex Development Labs
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#pragma endregion // Apache License 2.0
+
+// If the library is compiled as a DLL, this ensures symbols are exported
+#define NUCLEX_OPUSTRANSCODER_SOURCE 1
+
+#include "../../Source/Config.h"
+#include "../../Source/Audio/ChunkedMemoryFile.h"
+#include "../../Source/Audio/MemoryFile.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm> // for std::min()
+#include <vector> // for std::vector
+
+namespace {
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Creates a buffer filled with a repeating byte pattern</summary>
+  /// <param name="byteCount">Number of bytes the buffer should hold</param>
+  /// <returns>The new buffer</returns>
+  std::vector<std::byte> makePattern(std::size_t byteCount) {
+    std::vector<std::byte> pattern(byteCount);
+    for(std::size_t index = 0; index < byteCount; ++index) {
+      pattern[index] = static_cast<std::byte>((index * 7 + index / 251) & 0xff);
+    }
+    return pattern;
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+} // anonymous namespace
+
+namespace Nuclex::OpusTranscoder::Audio {
+
+  // ------------------------------------------------------------------------------------------- //
+
+  TEST(ChunkedMemoryFileTests, StartsOutEmpty) {
+    ChunkedMemoryFile file(12345678);
+    EXPECT_EQ(file.GetSize(), 0U);
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  TEST(ChunkedMemoryFileTests, AppendedDataCanBeReadBackAcrossChunks) {
+    std::size_t byteCount = ChunkedMemoryFile::ChunkSize * 2 + 1000;
+    std::vector<std::byte> pattern = makePattern(byteCount);
+
+    // Append in odd-sized pieces so some of them straddle the chunk boundaries
+    ChunkedMemoryFile file;
+    for(std::size_t offset = 0; offset < byteCount; offset += 100003) {
+      std::size_t pieceLength = std::min<std::size_t>(100003, byteCount - offset);
+      file.WriteAt(offset, pieceLength, pattern.data() + offset);
+    }
+    ASSERT_EQ(file.GetSize(), byteCount);
+
+    std::size_t readStart = ChunkedMemoryFile::ChunkSize - 10;
+    std::vector<std::byte> readBack(ChunkedMemoryFile::ChunkSize + 20);
+    file.ReadAt(readStart, readBack.size(), readBack.data());
+    for(std::size_t index = 0; index < readBack.size(); ++index) {
+      ASSERT_EQ(readBack[index], pattern[readStart + index]);
+    }
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  TEST(ChunkedMemoryFileTests, OverwritesCanExtendTheFile) {
+    std::vector<std::byte> pattern = makePattern(300);
+
+    ChunkedMemoryFile file;
+    file.WriteAt(0, 200, pattern.data());
+    file.WriteAt(100, 200, pattern.data() + 100);
+    ASSERT_EQ(file.GetSize(), 300U);
+
+    std::vector<std::byte> header(4, std::byte(0xff));
+    file.WriteAt(10, header.size(), header.data());
+    pattern[10] = pattern[11] = pattern[12] = pattern[13] = std::byte(0xff);
+
+    std::vector<std::byte> readBack(300);
+    file.ReadAt(0, readBack.size(), readBack.data());
+    EXPECT_EQ(readBack, pattern);
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  TEST(ChunkedMemoryFileTests, SpansEndAtChunkBoundaries) {
+    std::size_t byteCount = ChunkedMemoryFile::ChunkSize + 1000;
+    std::vector<std::byte> pattern = makePattern(byteCount);
+
+    ChunkedMemoryFile file(byteCount);
+    file.WriteAt(0, byteCount, pattern.data());
+
+    const std::byte *data = nullptr;
+    std::size_t spanLength = file.ReadSpan(ChunkedMemoryFile::ChunkSize - 10, 100, data);
+    ASSERT_EQ(spanLength, 10U);
+    EXPECT_EQ(data[0], pattern[ChunkedMemoryFile::ChunkSize - 10]);
+
+    spanLength = file.ReadSpan(ChunkedMemoryFile::ChunkSize, 2000, data);
+    ASSERT_EQ(spanLength, 1000U);
+    EXPECT_EQ(data[999], pattern[byteCount - 1]);
+
+    EXPECT_EQ(file.ReadSpan(byteCount, 100, data), 0U);
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  TEST(ChunkedMemoryFileTests, WritesItsContentsIntoAnotherFile) {
+    std::size_t byteCount = ChunkedMemoryFile::ChunkSize + 4321;
+    std::vector<std::byte> pattern = makePattern(byteCount);
+
+    ChunkedMemoryFile file(byteCount);
+    file.WriteAt(0, byteCount, pattern.data());
+
+    MemoryFile target;
+    file.WriteTo(target);
+    EXPECT_EQ(target.GetContents(), pattern);
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+} // namespace Nuclex::OpusTranscoder::Audio
@@ -25,9 +25,13 @@ limitations under the License.
 #include "../../Source/Audio/ClippingDetector.h"
 
 #include <Nuclex/Support/Threading/StopSource.h>
+#include <Nuclex/Support/Threading/ThreadPool.h>
 
 #include <gtest/gtest.h>
 
+#include <algorithm> // for std::min()
+#include <cmath> // for std::sin()
+
 namespace {
 
   // ------------------------------------------------------------------------------------------- //
@@ -54,6 +58,183 @@ namespace {
 
   // ------------------------------------------------------------------------------------------- //
 
+  /// <summary>Creates a six-channel track with partially clipping audio</summary>
+  /// <param name="frameCount">Number of frames the track should have</param>
+  /// <returns>The new six-channel track</returns>
+  std::shared_ptr<Nuclex::OpusTranscoder::Audio::Track> makeClippingSurroundTrack(
+    std::size_t frameCount
+  ) {
+    using Nuclex::OpusTranscoder::Audio::Track;
+    std::shared_ptr<Track> track = std::make_shared<Track>();
+
+    track->Channels.resize(6);
+    for(std::size_t channelIndex = 0; channelIndex < 6; ++channelIndex) {
+      track->Channels[channelIndex].InputOrder = channelIndex;
+    }
+
+    // Sine waves of different frequencies with an amplitude that swells above the ceiling
+    // every now and then. The slowest one produces half-waves spanning many scan blocks.
+    track->Samples.resize(frameCount * 6);
+    for(std::size_t index = 0; index < frameCount; ++index) {
+      float swell = 0.8f + 0.4f * std::sin(static_cast<float>(index) * 0.0007f);
+      for(std::size_t channelIndex = 0; channelIndex < 6; ++channelIndex) {
+        float frequency = 0.0003f + static_cast<float>(channelIndex * channelIndex) * 0.011f;
+        float ripple = 0.1f * std::sin(static_cast<float>(index) * 0.9f);
+        track->Samples[index * 6 + channelIndex] = (
+          swell * std::sin(static_cast<float>(index) * frequency) + ripple
+        );
+      } // for each channel
+    } // for each frame
+
+    return track;
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Looks for clipping half-waves by checking each sample in sequence</summary>
+  /// <param name="track">Track that will be scanned for clipping half-waves</param>
+  /// <param name="channelIndex">Index of the channel that will be scanned</param>
+  /// <returns>A list of all clipping half-waves in the channel</returns>
+  std::vector<Nuclex::OpusTranscoder::Audio::ClippingHalfwave> findClippingHalfwavesSlowly(
+    const std::shared_ptr<Nuclex::OpusTranscoder::Audio::Track> &track,
+    std::size_t channelIndex
+  ) {
+    using Nuclex::OpusTranscoder::Audio::ClippingHalfwave;
+    std::vector<ClippingHalfwave> halfwaves;
+
+    std::size_t channelCount = track->Channels.size();
+    std::size_t frameCount = track->Samples.size() / channelCount;
+    const float *read = track->Samples.data() + channelIndex;
+
+    float clippingPeak = *read;
+    std::size_t clippingPeakIndex = 0;
+    bool wasClipping = (1.0f < std::abs(clippingPeak));
+    bool wasBelowZero = (clippingPeak < 0.0f);
+    std::size_t zeroCrossingIndex = 0;
+
+    for(std::size_t index = 1; index < frameCount; ++index) {
+      read += channelCount;
+
+      bool isBelowZero = (*read < 0.0f);
+      if(wasBelowZero != isBelowZero) {
+        if(wasClipping) {
+          halfwaves.emplace_back(zeroCrossingIndex, clippingPeakIndex, index, clippingPeak);
+          wasClipping = false;
+          clippingPeak = 0.0f;
+        }
+        zeroCrossingIndex = index;
+        wasBelowZero = isBelowZero;
+      }
+
+      if(1.0f < std::abs(*read)) {
+        wasClipping = true;
+        if(clippingPeak < std::abs(*read)) {
+          clippingPeak = std::abs(*read);
+          clippingPeakIndex = index;
+        }
+      }
+    } // for each sample in the channel
+
+    if(wasClipping) {
+      halfwaves.emplace_back(zeroCrossingIndex, clippingPeakIndex, frameCount, clippingPeak);
+    }
+
+    return halfwaves;
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Checks that the detector's half-waves match a sequential sample scan</summary>
+  /// <param name="track">Track whose detected clipping half-waves will be checked</param>
+  void expectHalfwavesMatchSlowScan(
+    const std::shared_ptr<Nuclex::OpusTranscoder::Audio::Track> &track
+  ) {
+    using Nuclex::OpusTranscoder::Audio::ClippingHalfwave;
+    using Nuclex::OpusTranscoder::Audio::ClippingHalfwaveTable;
+
+    std::size_t channelCount = track->Channels.size();
+    for(std::size_t channelIndex = 0; channelIndex < channelCount; ++channelIndex) {
+      std::vector<ClippingHalfwave> expected = findClippingHalfwavesSlowly(track, channelIndex);
+      const ClippingHalfwaveTable &actual = (
+        track->Channels[channelIndex].ClippingHalfwaves
+      );
+
+      ASSERT_EQ(actual.size(), expected.size());
+      for(std::size_t index = 0; index < expected.size(); ++index) {
+        EXPECT_EQ(actual[index].PriorZeroCrossingIndex, expected[index].PriorZeroCrossingIndex);
+        EXPECT_EQ(actual[index].PeakIndex, expected[index].PeakIndex);
+        EXPECT_EQ(actual[index].NextZeroCrossingIndex, expected[index].NextZeroCrossingIndex);
+        EXPECT_EQ(actual[index].PeakAmplitude, expected[index].PeakAmplitude);
+      }
+    } // for each channel
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Integrates decoded half-waves by searching and inserting one at a time</summary>
+  /// <param name="sourceTrack">Source audio track to integrate into</param>
+  /// <param name="decodedTrack">Decoded audio track whose half-waves will be integrated</param>
+  void integrateSlowly(
+    const std::shared_ptr<Nuclex::OpusTranscoder::Audio::Track> &sourceTrack,
+    const std::shared_ptr<Nuclex::OpusTranscoder::Audio::Track> &decodedTrack
+  ) {
+    using Nuclex::OpusTranscoder::Audio::ClippingDetector;
+    using Nuclex::OpusTranscoder::Audio::ClippingHalfwave;
+    using Nuclex::OpusTranscoder::Audio::ClippingHalfwaveTable;
+
+    std::size_t channelCount = sourceTrack->Channels.size();
+    for(std::size_t channelIndex = 0; channelIndex < channelCount; ++channelIndex) {
+      ClippingHalfwaveTable &table = sourceTrack->Channels[channelIndex].ClippingHalfwaves;
+
+      // The table only allows appending, so do the insertions on a plain vector
+      std::vector<ClippingHalfwave> existing;
+      for(std::size_t index = 0; index < table.size(); ++index) {
+        existing.push_back(table[index]);
+      }
+
+      const ClippingHalfwaveTable &decodedHalfwaves = (
+        decodedTrack->Channels[channelIndex].ClippingHalfwaves
+      );
+      for(std::size_t decodedIndex = 0; decodedIndex < decodedHalfwaves.size(); ++decodedIndex) {
+        ClippingHalfwave decoded = decodedHalfwaves[decodedIndex];
+        std::size_t index = 0;
+        while(index < existing.size()) {
+          bool intersects = (
+            (decoded.PriorZeroCrossingIndex < existing[index].NextZeroCrossingIndex) &&
+            (existing[index].PriorZeroCrossingIndex < decoded.NextZeroCrossingIndex)
+          );
+          if(intersects) {
+            break;
+          }
+          ++index;
+        }
+
+        if(index < existing.size()) {
+          existing[index].PeakAmplitude = decoded.PeakAmplitude;
+        } else {
+          ClippingHalfwave halfwave = ClippingDetector::GetHalfwaveAroundSample(
+            sourceTrack, channelIndex, decoded.PeakIndex
+          );
+          index = 0;
+          while(index < existing.size()) {
+            if(halfwave.PriorZeroCrossingIndex <= existing[index].PriorZeroCrossingIndex) {
+              break;
+            }
+            ++index;
+          }
+          existing.insert(existing.begin() + index, halfwave);
+        }
+      } // for each decoded half-wave
+
+      table.clear();
+      for(const ClippingHalfwave &halfwave : existing) {
+        table.push_back(halfwave);
+      }
+    } // for each channel
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
 } // anonymous namespace
 
 namespace Nuclex::OpusTranscoder::Audio {
@@ -66,7 +247,7 @@ namespace Nuclex::OpusTranscoder::Audio {
     using Nuclex::Support::Threading::StopToken;
 
     std::shared_ptr<Track> track = makeStereoTrack();
-    track->Samples.resize(18);
+    track->Samples.resize(18, 0.0f);
 
     track->Samples[0] = -0.1f;  // 0
     track->Samples[2] = 0.1f;   // 1
@@ -107,7 +288,7 @@ namespace Nuclex::OpusTranscoder::Audio {
     using Nuclex::Support::Threading::StopToken;
 
     std::shared_ptr<Track> track = makeStereoTrack();
-    track->Samples.resize(18);
+    track->Samples.resize(18, 0.0f);
 
     track->Samples[0] = 1.1f;   // 0
     track->Samples[2] = 0.9f;   // 1
@@ -152,7 +333,7 @@ namespace Nuclex::OpusTranscoder::Audio {
     using Nuclex::Support::Threading::StopToken;
 
     std::shared_ptr<Track> track = makeStereoTrack();
-    track->Samples.resize(18);
+    track->Samples.resize(18, 0.0f);
 
     track->Samples[0] = 0.1f;  // 0
     track->Samples[2] = 0.3f;  // 1
@@ -191,4 +372,231 @@ namespace Nuclex::OpusTranscoder::Audio {
 
   // ------------------------------------------------------------------------------------------- //
 
+  TEST(ClippingDetectorTests, BlockScanMatchesSequentialScan) {
+    using Nuclex::Support::Events::Delegate;
+    using Nuclex::Support::Threading::StopSource;
+
+    // Odd frame count so the final block is a partial one
+    std::shared_ptr<Track> track = makeClippingSurroundTrack(48013);
+
+    Delegate<void(float)> progressCallback = (
+      Delegate<void(float)>::Create<&doNothing>()
+    );
+    ClippingDetector::FindClippingHalfwaves(
+      track, StopSource::Create()->GetToken(), progressCallback
+    );
+
+    std::size_t clippingHalfwaveCount = 0;
+    for(std::size_t channelIndex = 0; channelIndex < 6; ++channelIndex) {
+      clippingHalfwaveCount += track->Channels[channelIndex].ClippingHalfwaves.size();
+    }
+    EXPECT_GT(clippingHalfwaveCount, 0U);
+
+    expectHalfwavesMatchSlowScan(track);
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  TEST(ClippingDetectorTests, BlockScanKeepsSignedPeakOfFirstSample) {
+    using Nuclex::Support::Events::Delegate;
+    using Nuclex::Support::Threading::StopSource;
+
+    std::shared_ptr<Track> track = makeClippingSurroundTrack(4096);
+
+    // A clipping negative half-wave right at the start, once with only the first
+    // sample clipping and once with a weaker clipping sample later on
+    track->Samples[0] = -1.5f;
+    track->Samples[6] = -0.5f;
+    track->Samples[12] = 0.5f;
+    track->Samples[1] = -1.5f;
+    track->Samples[7] = -1.2f;
+    track->Samples[13] = 0.5f;
+
+    Delegate<void(float)> progressCallback = (
+      Delegate<void(float)>::Create<&doNothing>()
+    );
+    ClippingDetector::FindClippingHalfwaves(
+      track, StopSource::Create()->GetToken(), progressCallback
+    );
+
+    ASSERT_GE(track->Channels[0].ClippingHalfwaves.size(), 1U);
+    EXPECT_EQ(track->Channels[0].ClippingHalfwaves[0].PeakAmplitude, -1.5f);
+    ASSERT_GE(track->Channels[1].ClippingHalfwaves.size(), 1U);
+    EXPECT_EQ(track->Channels[1].ClippingHalfwaves[0].PeakIndex, 1U);
+
+    expectHalfwavesMatchSlowScan(track);
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  TEST(ClippingDetectorTests, ParallelScanMatchesSequentialScan) {
+    using Nuclex::Support::Events::Delegate;
+    using Nuclex::Support::Threading::StopSource;
+    using Nuclex::Support::Threading::ThreadPool;
+
+    // Long enough to be split into several ranges with half-waves crossing their borders
+    std::shared_ptr<Track> track = makeClippingSurroundTrack(400009);
+
+    Delegate<void(float)> progressCallback = (
+      Delegate<void(float)>::Create<&doNothing>()
+    );
+    {
+      ThreadPool threadPool;
+      ClippingDetector::FindClippingHalfwaves(
+        track, threadPool, StopSource::Create()->GetToken(), progressCallback
+      );
+    }
+
+    expectHalfwavesMatchSlowScan(track);
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  TEST(ClippingDetectorTests, StatisticsScanMatchesSequentialScan) {
+    using Nuclex::Support::Events::Delegate;
+    using Nuclex::Support::Threading::StopSource;
+    using Nuclex::Support::Threading::ThreadPool;
+
+    std::shared_ptr<Track> track = makeClippingSurroundTrack(400009);
+
+    // Collect the statistics like the decoder does, in chunks that don't line up
+    std::size_t frameCount = track->Samples.size() / 6;
+    track->Statistics.Reset(6, frameCount);
+    for(std::size_t frameIndex = 0; frameIndex < frameCount; frameIndex += 10000) {
+      std::size_t chunkFrameCount = std::min<std::size_t>(10000, frameCount - frameIndex);
+      track->Statistics.Accumulate(
+        track->Samples.data() + frameIndex * 6, frameIndex, chunkFrameCount
+      );
+    }
+    ASSERT_TRUE(track->Statistics.Covers(6, frameCount));
+
+    Delegate<void(float)> progressCallback = (
+      Delegate<void(float)>::Create<&doNothing>()
+    );
+    ClippingDetector::FindClippingHalfwaves(
+      track, StopSource::Create()->GetToken(), progressCallback
+    );
+    expectHalfwavesMatchSlowScan(track);
+
+    {
+      ThreadPool threadPool;
+      ClippingDetector::FindClippingHalfwaves(
+        track, threadPool, StopSource::Create()->GetToken(), progressCallback
+      );
+    }
+    expectHalfwavesMatchSlowScan(track);
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  TEST(ClippingDetectorTests, IntegrateMatchesOneByOneInsertion) {
+    using Nuclex::Support::Events::Delegate;
+    using Nuclex::Support::Threading::StopSource;
+
+    std::shared_ptr<Track> sourceTrack = makeClippingSurroundTrack(48013);
+
+    // The "decoded" track is a bit louder and slightly shifted, so some of its half-waves
+    // match existing ones, some span two of them and some are entirely new.
+    std::shared_ptr<Track> decodedTrack = std::make_shared<Track>(*sourceTrack);
+    for(std::size_t index = 0; index < decodedTrack->Samples.size(); ++index) {
+      float ripple = 0.03f * std::sin(static_cast<float>(index) * 0.37f);
+      decodedTrack->Samples[index] = sourceTrack->Samples[index] * 1.08f + ripple;
+    }
+
+    Delegate<void(float)> progressCallback = (
+      Delegate<void(float)>::Create<&doNothing>()
+    );
+    ClippingDetector::FindClippingHalfwaves(
+      sourceTrack, StopSource::Create()->GetToken(), progressCallback
+    );
+    ClippingDetector::FindClippingHalfwaves(
+      decodedTrack, StopSource::Create()->GetToken(), progressCallback
+    );
+
+    std::shared_ptr<Track> expectedTrack = std::make_shared<Track>(*sourceTrack);
+    integrateSlowly(expectedTrack, decodedTrack);
+    ClippingDetector::Integrate(sourceTrack, decodedTrack);
+
+    for(std::size_t channelIndex = 0; channelIndex < 6; ++channelIndex) {
+      const ClippingHalfwaveTable &expected = (
+        expectedTrack->Channels[channelIndex].ClippingHalfwaves
+      );
+      const ClippingHalfwaveTable &actual = (
+        sourceTrack->Channels[channelIndex].ClippingHalfwaves
+      );
+
+      ASSERT_EQ(actual.size(), expected.size());
+      for(std::size_t index = 0; index < expected.size(); ++index) {
+        EXPECT_EQ(actual[index].PriorZeroCrossingIndex, expected[index].PriorZeroCrossingIndex);
+        EXPECT_EQ(actual[index].PeakIndex, expected[index].PeakIndex);
+        EXPECT_EQ(actual[index].NextZeroCrossingIndex, expected[index].NextZeroCrossingIndex);
+        EXPECT_EQ(actual[index].PeakAmplitude, expected[index].PeakAmplitude);
+      }
+    } // for each channel
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  TEST(ClippingDetectorTests, PlanarScanMatchesInterleavedScan) {
+    using Nuclex::Support::Events::Delegate;
+    using Nuclex::Support::Threading::StopSource;
+    using Nuclex::Support::Threading::ThreadPool;
+
+    std::shared_ptr<Track> interleavedTrack = makeClippingSurroundTrack(400009);
+    std::shared_ptr<Track> planarTrack = makeClippingSurroundTrack(400009);
+    planarTrack->ConvertToPlanar();
+
+    Delegate<void(float)> progressCallback = (
+      Delegate<void(float)>::Create<&doNothing>()
+    );
+    ClippingDetector::FindClippingHalfwaves(
+      interleavedTrack, StopSource::Create()->GetToken(), progressCallback
+    );
+    {
+      ThreadPool threadPool;
+      ClippingDetector::FindClippingHalfwaves(
+        planarTrack, threadPool, StopSource::Create()->GetToken(), progressCallback
+      );
+    }
+
+    for(std::size_t channelIndex = 0; channelIndex < 6; ++channelIndex) {
+      const ClippingHalfwaveTable &expected = (
+        interleavedTrack->Channels[channelIndex].ClippingHalfwaves
+      );
+      const ClippingHalfwaveTable &actual = planarTrack->Channels[channelIndex].ClippingHalfwaves;
+
+      ASSERT_EQ(actual.size(), expected.size());
+      for(std::size_t index = 0; index < expected.size(); ++index) {
+        EXPECT_EQ(actual[index].PriorZeroCrossingIndex, expected[index].PriorZeroCrossingIndex);
+        EXPECT_EQ(actual[index].PeakIndex, expected[index].PeakIndex);
+        EXPECT_EQ(actual[index].NextZeroCrossingIndex, expected[index].NextZeroCrossingIndex);
+        EXPECT_EQ(actual[index].PeakAmplitude, expected[index].PeakAmplitude);
+      }
+    } // for each channel
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  TEST(ClippingDetectorTests, FindsHalfwaveAroundSampleInCompactedTrack) {
+    std::shared_ptr<Track> track = makeClippingSurroundTrack(48013);
+    std::shared_ptr<Track> compactTrack = makeClippingSurroundTrack(48013);
+    compactTrack->Compact();
+    ASSERT_TRUE(compactTrack->IsCompact());
+
+    for(std::uint64_t sampleIndex = 0; sampleIndex < 48013; sampleIndex += 997) {
+      for(std::size_t channelIndex = 0; channelIndex < 6; ++channelIndex) {
+        ClippingHalfwave expected = ClippingDetector::GetHalfwaveAroundSample(
+          track, channelIndex, sampleIndex
+        );
+        ClippingHalfwave actual = ClippingDetector::GetHalfwaveAroundSample(
+          compactTrack, channelIndex, sampleIndex
+        );
+        EXPECT_EQ(actual.PriorZeroCrossingIndex, expected.PriorZeroCrossingIndex);
+        EXPECT_EQ(actual.NextZeroCrossingIndex, expected.NextZeroCrossingIndex);
+      }
+    }
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
 } // namespace Nuclex::OpusTranscoder::Audio
@@ -0,0 +1,140 @@
+#pragma region Apache License 2.0
+/*
+Nuclex Opus Transcoder
+Copyright (C) 2024 Markus Ewald / Nuclex Development Labs
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#pragma endregion // Apache License 2.0
+
+// If the library is compiled as a DLL, this ensures symbols are exported
+#define NUCLEX_OPUSTRANSCODER_SOURCE 1
+
+#include "../../Source/Config.h"
+#include "../../Source/Audio/ClippingHalfwaveTable.h"
+
+#include <gtest/gtest.h>
+
+namespace Nuclex::OpusTranscoder::Audio {
+
+  // ------------------------------------------------------------------------------------------- //
+
+  TEST(ClippingHalfwaveTableTests, StoresAppendedHalfwaves) {
+    ClippingHalfwaveTable table;
+    EXPECT_TRUE(table.empty());
+
+    table.emplace_back(10, 12, 20, 1.5f);
+    table.push_back(ClippingHalfwave(30, 39, 40, -1.25f));
+
+    ASSERT_EQ(table.size(), 2U);
+    EXPECT_EQ(table[0].PriorZeroCrossingIndex, 10U);
+    EXPECT_EQ(table[0].PeakIndex, 12U);
+    EXPECT_EQ(table[0].NextZeroCrossingIndex, 20U);
+    EXPECT_EQ(table[0].PeakAmplitude, 1.5f);
+    EXPECT_EQ(table.back().PriorZeroCrossingIndex, 30U);
+    EXPECT_EQ(table.back().PeakIndex, 39U);
+    EXPECT_EQ(table.back().NextZeroCrossingIndex, 40U);
+    EXPECT_EQ(table.back().PeakAmplitude, -1.25f);
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  TEST(ClippingHalfwaveTableTests, HandlesFrameIndicesBeyond32Bits) {
+    const std::uint64_t fourGigaFrames = 0x100000000ULL;
+
+    ClippingHalfwaveTable table;
+    table.emplace_back(100, 150, 200, 1.1f);
+    table.emplace_back(fourGigaFrames - 10, fourGigaFrames + 5, fourGigaFrames + 10, 1.2f);
+    table.emplace_back(
+      fourGigaFrames * 3 + 7, fourGigaFrames * 3 + 8, fourGigaFrames * 3 + 9, 1.3f
+    );
+
+    ASSERT_EQ(table.size(), 3U);
+    EXPECT_EQ(table.GetPriorZeroCrossingIndex(0), 100U);
+    EXPECT_EQ(table.GetNextZeroCrossingIndex(0), 200U);
+    EXPECT_EQ(table.GetPriorZeroCrossingIndex(1), fourGigaFrames - 10);
+    EXPECT_EQ(table.GetPeakIndex(1), fourGigaFrames + 5);
+    EXPECT_EQ(table.GetNextZeroCrossingIndex(1), fourGigaFrames + 10);
+    EXPECT_EQ(table.GetPriorZeroCrossingIndex(2), fourGigaFrames * 3 + 7);
+    EXPECT_EQ(table.GetPeakIndex(2), fourGigaFrames * 3 + 8);
+    EXPECT_EQ(table.GetNextZeroCrossingIndex(2), fourGigaFrames * 3 + 9);
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  TEST(ClippingHalfwaveTableTests, FindsHalfwavesByFrameIndex) {
+    ClippingHalfwaveTable table;
+    table.emplace_back(10, 15, 20, 1.1f);
+    table.emplace_back(20, 25, 30, 1.1f);
+    table.emplace_back(50, 55, 60, 1.1f);
+
+    EXPECT_EQ(table.FindFirstEndingAfter(0), 0U);
+    EXPECT_EQ(table.FindFirstEndingAfter(19), 0U);
+    EXPECT_EQ(table.FindFirstEndingAfter(20), 1U);
+    EXPECT_EQ(table.FindFirstEndingAfter(45), 2U);
+    EXPECT_EQ(table.FindFirstEndingAfter(60), 3U);
+
+    EXPECT_EQ(table.FindFirstStartingFrom(10), 0U);
+    EXPECT_EQ(table.FindFirstStartingFrom(11), 1U);
+    EXPECT_EQ(table.FindFirstStartingFrom(20), 1U);
+    EXPECT_EQ(table.FindFirstStartingFrom(21), 2U);
+    EXPECT_EQ(table.FindFirstStartingFrom(51), 3U);
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  TEST(ClippingHalfwaveTableTests, IneffectiveIterationCountSaturates) {
+    ClippingHalfwaveTable table;
+    table.emplace_back(10, 15, 20, 1.1f);
+
+    for(std::size_t index = 0; index < 1000; ++index) {
+      table.IncrementIneffectiveIterationCount(0);
+    }
+    EXPECT_EQ(table.GetIneffectiveIterationCount(0), 255U);
+
+    table.ResetIneffectiveIterationCount(0);
+    EXPECT_EQ(table.GetIneffectiveIterationCount(0), 0U);
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  TEST(ClippingHalfwaveTableTests, UpdatesAndCopiesHalfwaves) {
+    ClippingHalfwaveTable table;
+    table.emplace_back(10, 15, 20, 1.1f);
+    table.emplace_back(30, 35, 40, 1.2f);
+
+    ClippingHalfwave halfwave = table[1];
+    halfwave.PeakAmplitude = 1.05f;
+    halfwave.VolumeQuotient = 0.5f;
+    halfwave.IneffectiveIterationCount = 3;
+    table.Update(1, halfwave);
+
+    ClippingHalfwaveTable copy;
+    copy.emplace_back(1, 2, 3, 1.0f);
+    copy.CopyFrom(table);
+
+    ASSERT_EQ(copy.size(), 2U);
+    EXPECT_EQ(copy.GetPeakAmplitude(1), 1.05f);
+    EXPECT_EQ(copy.GetVolumeQuotient(1), 0.5f);
+    EXPECT_EQ(copy.GetIneffectiveIterationCount(1), 3U);
+
+    ClippingHalfwaveTable other;
+    other.Swap(copy);
+    EXPECT_TRUE(copy.empty());
+    ASSERT_EQ(other.size(), 2U);
+    EXPECT_EQ(other.GetPriorZeroCrossingIndex(0), 10U);
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+} // namespace Nuclex::OpusTranscoder::Audio
@@ -0,0 +1,134 @@
+#pragma region Apache License 2.0
+/*
+Nuclex Opus Transcoder
+Copyright (C) 2024 Markus Ewald / Nuclex Development Labs
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#pragma endregion // Apache License 2.0
+
+// If the library is compiled as a DLL, this ensures symbols are exported
+#define NUCLEX_OPUSTRANSCODER_SOURCE 1
+
+#include "../../Source/Config.h"
+#include "../../Source/Audio/CompactSampleStore.h"
+#include "../../Source/Audio/Track.h"
+
+#include <gtest/gtest.h>
+
+#include <vector> // for std::vector
+
+namespace Nuclex::OpusTranscoder::Audio {
+
+  // ------------------------------------------------------------------------------------------- //
+
+  TEST(CompactSampleStoreTests, NewStoreIsEmpty) {
+    CompactSampleStore store;
+    EXPECT_TRUE(store.IsEmpty());
+    EXPECT_EQ(store.CountFrames(), 0U);
+    EXPECT_EQ(store.GetMemoryUsage(), 0U);
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  TEST(CompactSampleStoreTests, SixteenBitSamplesTakeHalfTheMemory) {
+    std::size_t frameCount = CompactSampleStore::FramesPerBlock * 4;
+    std::vector<float> samples(frameCount * 2);
+    for(std::size_t index = 0; index < samples.size(); ++index) {
+      int value = static_cast<int>(index * 7919 % 65536) - 32768;
+      samples[index] = static_cast<float>(value) / 32768.0f;
+    }
+
+    const float *channels[2] = { samples.data(), samples.data() + 1 };
+    CompactSampleStore store;
+    store.Assign(channels, 2, 2, frameCount);
+
+    EXPECT_LT(store.GetMemoryUsage(), samples.size() * sizeof(float) * 6 / 10);
+
+    std::vector<float> expanded(samples.size());
+    store.InterleaveFrames(0, frameCount, expanded.data());
+    for(std::size_t index = 0; index < samples.size(); ++index) {
+      ASSERT_EQ(expanded[index], samples[index]);
+    }
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  TEST(CompactSampleStoreTests, TwentyFourBitSamplesRoundTripExactly) {
+    std::size_t frameCount = CompactSampleStore::FramesPerBlock + 123;
+    std::vector<float> samples(frameCount);
+    for(std::size_t index = 0; index < frameCount; ++index) {
+      int value = static_cast<int>(index * 1000003 % 16777216) - 8388608;
+      samples[index] = static_cast<float>(value) / 8388608.0f;
+    }
+
+    const float *channels[1] = { samples.data() };
+    CompactSampleStore store;
+    store.Assign(channels, 1, 1, frameCount);
+
+    EXPECT_LT(store.GetMemoryUsage(), frameCount * sizeof(float) * 8 / 10);
+    for(std::size_t index = 0; index < frameCount; ++index) {
+      ASSERT_EQ(store.GetSample(0, index), samples[index]);
+    }
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  TEST(CompactSampleStoreTests, FloatSamplesAreKeptAsTheyAre) {
+    std::size_t frameCount = 10000;
+    std::vector<float> samples(frameCount);
+    for(std::size_t index = 0; index < frameCount; ++index) {
+      samples[index] = static_cast<float>(index % 1000) / 999.0f - 0.5f;
+    }
+    samples[5000] = 1.75f; // clipping float sample
+
+    const float *channels[1] = { samples.data() };
+    CompactSampleStore store;
+    store.Assign(channels, 1, 1, frameCount);
+
+    // A partial range that crosses block boundaries
+    std::vector<float> expanded(6000);
+    store.InterleaveFrames(3000, 6000, expanded.data());
+    for(std::size_t index = 0; index < expanded.size(); ++index) {
+      ASSERT_EQ(expanded[index], samples[index + 3000]);
+    }
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  TEST(CompactSampleStoreTests, CompactedTrackKeepsItsSamples) {
+    std::shared_ptr<Track> track = std::make_shared<Track>();
+    track->Channels.resize(3);
+    track->Samples.resize(3 * 5000);
+    for(std::size_t index = 0; index < track->Samples.size(); ++index) {
+      track->Samples[index] = static_cast<float>(static_cast<int>(index % 200) - 100) / 128.0f;
+    }
+    SampleBuffer original = track->Samples;
+
+    track->Compact();
+
+    ASSERT_TRUE(track->IsCompact());
+    EXPECT_TRUE(track->Samples.empty());
+    ASSERT_EQ(track->CountFrames(), 5000U);
+    EXPECT_EQ(track->GetSample(2, 4321), original[4321 * 3 + 2]);
+
+    std::vector<float> interleaved(original.size());
+    track->InterleaveFrames(0, 5000, interleaved.data());
+    for(std::size_t index = 0; index < original.size(); ++index) {
+      ASSERT_EQ(interleaved[index], original[index]);
+    }
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+} // namespace Nuclex::OpusTranscoder::Audio
@@ -0,0 +1,173 @@
+#pragma region Apache License 2.0
+/*
+Nuclex Opus Transcoder
+Copyright (C) 2024 Markus Ewald / Nuclex Development Labs
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#pragma endregion // Apache License 2.0
+
+// If the library is compiled as a DLL, this ensures symbols are exported
+#define NUCLEX_OPUSTRANSCODER_SOURCE 1
+
+#include "../../Source/Config.h"
+#include "../../Source/Audio/DeclipCheckpoint.h"
+#include "../../Source/Audio/SegmentedOpusEncoder.h"
+
+#include <gtest/gtest.h>
+
+#include <stdexcept> // for std::runtime_error
+
+namespace {
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Creates a short mono track with a single clipping half-wave</summary>
+  /// <param name="volumeQuotient">Volume quotient the half-wave will be given</param>
+  /// <returns>The new mono track</returns>
+  std::shared_ptr<Nuclex::OpusTranscoder::Audio::Track> makeCheckpointedTrack(
+    float volumeQuotient
+  ) {
+    using Nuclex::OpusTranscoder::Audio::ClippingHalfwave;
+    using Nuclex::OpusTranscoder::Audio::Track;
+    std::shared_ptr<Track> track = std::make_shared<Track>();
+
+    // A tenth of a second is enough for the encoder to split the track into segments
+    track->Channels.resize(1);
+    track->Channels[0].InputOrder = 0;
+    track->Channels[0].Placement = Nuclex::Audio::ChannelPlacement::FrontCenter;
+    track->SampleRate = 48000;
+    track->Samples.resize(4800, 0.0f);
+
+    ClippingHalfwave halfwave(100, 105, 110, 1.1f);
+    halfwave.VolumeQuotient = volumeQuotient;
+    track->Channels[0].ClippingHalfwaves.push_back(halfwave);
+
+    return track;
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Creates an Ogg Opus stream with valid headers and a few audio packets</summary>
+  /// <returns>The new Ogg Opus stream</returns>
+  Nuclex::OpusTranscoder::Audio::OggOpusStream makeStream() {
+    using Nuclex::OpusTranscoder::Audio::OggOpusStream;
+
+    OggOpusStream stream;
+    stream.SerialNumber = 0x12345678;
+
+    const std::uint8_t head[19] = {
+      'O', 'p', 'u', 's', 'H', 'e', 'a', 'd', 1, 2, 0x38, 0x01, 0x80, 0xbb, 0, 0, 0, 0, 0
+    };
+    for(std::size_t index = 0; index < sizeof(head); ++index) {
+      stream.HeaderPacket.push_back(static_cast<std::byte>(head[index]));
+    }
+
+    const std::uint8_t tags[16] = { 'O', 'p', 'u', 's', 'T', 'a', 'g', 's' };
+    for(std::size_t index = 0; index < sizeof(tags); ++index) {
+      stream.CommentPacket.push_back(static_cast<std::byte>(tags[index]));
+    }
+
+    std::byte packet[3] = { std::byte(31 << 3), std::byte(42), std::byte(7) };
+    for(std::size_t index = 0; index < 6; ++index) {
+      stream.AppendPacket(packet, sizeof(packet), 960);
+    }
+    stream.FinalGranulePosition = stream.Packets.back().EndPosition;
+
+    return stream;
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+} // anonymous namespace
+
+namespace Nuclex::OpusTranscoder::Audio {
+
+  // ------------------------------------------------------------------------------------------- //
+
+  TEST(DeclipCheckpointTests, SavedCheckpointRestoresJob) {
+    std::shared_ptr<Track> track = makeCheckpointedTrack(0.9f);
+    SegmentedOpusEncoder encoder(track, 160.0f, 1.0f);
+    encoder.EnableTucking();
+    for(std::size_t index = 0; index < encoder.CountSegments(); ++index) {
+      encoder.RestoreSegment(index, makeStream());
+    }
+
+    DeclipCheckpoint checkpoint;
+    checkpoint.Capture(123, 456, 5, *track, encoder);
+
+    DeclipCheckpoint loadedCheckpoint;
+    loadedCheckpoint.Load(checkpoint.Save());
+    EXPECT_EQ(loadedCheckpoint.GetRound(), 5U);
+
+    std::shared_ptr<Track> restoredTrack = makeCheckpointedTrack(1.0f);
+    SegmentedOpusEncoder restoredEncoder(restoredTrack, 160.0f, 1.0f);
+    ASSERT_EQ(restoredEncoder.CountDirtySegments(), restoredEncoder.CountSegments());
+    ASSERT_TRUE(loadedCheckpoint.Restore(123, 456, *restoredTrack, restoredEncoder));
+
+    EXPECT_TRUE(restoredEncoder.IsTuckingEnabled());
+    EXPECT_EQ(restoredEncoder.CountDirtySegments(), 0U);
+    for(std::size_t index = 0; index < restoredEncoder.CountSegments(); ++index) {
+      EXPECT_TRUE(restoredEncoder.WasSegmentEncoded(index));
+      EXPECT_EQ(
+        restoredEncoder.GetSegmentStream(index).AudioData,
+        encoder.GetSegmentStream(index).AudioData
+      );
+    }
+
+    const ClippingHalfwaveTable &halfwaves = restoredTrack->Channels[0].ClippingHalfwaves;
+    ASSERT_EQ(halfwaves.size(), 1U);
+    EXPECT_EQ(halfwaves[0].VolumeQuotient, 0.9f);
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  TEST(DeclipCheckpointTests, CheckpointOfOtherJobIsNotRestored) {
+    std::shared_ptr<Track> track = makeCheckpointedTrack(0.9f);
+    SegmentedOpusEncoder encoder(track, 160.0f, 1.0f);
+
+    DeclipCheckpoint checkpoint;
+    checkpoint.Capture(123, 456, 3, *track, encoder);
+
+    std::shared_ptr<Track> otherTrack = makeCheckpointedTrack(1.0f);
+    SegmentedOpusEncoder otherEncoder(otherTrack, 160.0f, 1.0f);
+    EXPECT_FALSE(checkpoint.Restore(123, 789, *otherTrack, otherEncoder));
+    EXPECT_FALSE(checkpoint.Restore(321, 456, *otherTrack, otherEncoder));
+
+    EXPECT_EQ(otherTrack->Channels[0].ClippingHalfwaves[0].VolumeQuotient, 1.0f);
+    EXPECT_EQ(otherEncoder.CountDirtySegments(), otherEncoder.CountSegments());
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  TEST(DeclipCheckpointTests, DamagedCheckpointIsRejected) {
+    std::shared_ptr<Track> track = makeCheckpointedTrack(0.9f);
+    SegmentedOpusEncoder encoder(track, 160.0f, 1.0f);
+
+    DeclipCheckpoint checkpoint;
+    checkpoint.Capture(123, 456, 3, *track, encoder);
+    std::vector<std::byte> contents = checkpoint.Save();
+
+    DeclipCheckpoint loadedCheckpoint;
+
+    std::vector<std::byte> truncated(contents.begin(), contents.end() - 1);
+    EXPECT_THROW(loadedCheckpoint.Load(truncated), std::runtime_error);
+
+    std::vector<std::byte> foreign(contents);
+    foreign[0] = std::byte('X');
+    EXPECT_THROW(loadedCheckpoint.Load(foreign), std::runtime_error);
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+} // namespace Nuclex::OpusTranscoder::Audio
@@ -0,0 +1,191 @@
+#pragma region Apache License 2.0
+/*
+Nuclex Opus Transcoder
+Copyright (C) 2024 Markus Ewald / Nuclex Development Labs
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#pragma endregion // Apache License 2.0
+
+// If the library is compiled as a DLL, this ensures symbols are exported
+#define NUCLEX_OPUSTRANSCODER_SOURCE 1
+
+#include "../../Source/Config.h"
+#include "../../Source/Audio/HalfwaveMapCache.h"
+
+#include <gtest/gtest.h>
+
+#include <stdexcept> // for std::runtime_error
+
+namespace {
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Creates a new stereo track with a few clipping half-waves</summary>
+  /// <param name="volumeQuotient">Volume quotient the half-waves will be given</param>
+  /// <returns>The new stereo track</returns>
+  std::shared_ptr<Nuclex::OpusTranscoder::Audio::Track> makeStereoTrackWithHalfwaves(
+    float volumeQuotient
+  ) {
+    using Nuclex::OpusTranscoder::Audio::ClippingHalfwave;
+    using Nuclex::OpusTranscoder::Audio::Track;
+    std::shared_ptr<Track> track = std::make_shared<Track>();
+
+    track->Channels.resize(2);
+    track->Channels[0].InputOrder = 0;
+    track->Channels[0].Placement = Nuclex::Audio::ChannelPlacement::FrontLeft;
+    track->Channels[1].InputOrder = 1;
+    track->Channels[1].Placement = Nuclex::Audio::ChannelPlacement::FrontRight;
+    track->Samples.resize(2000, 0.0f);
+
+    ClippingHalfwave halfwave(100, 105, 110, 0.99f);
+    halfwave.VolumeQuotient = volumeQuotient;
+    halfwave.IneffectiveIterationCount = 3;
+    halfwave.PreviousPeakAmplitude = 1.05f;
+    halfwave.PreviousVolumeQuotient = 1.1f;
+    track->Channels[0].ClippingHalfwaves.push_back(halfwave);
+    track->Channels[0].ClippingHalfwaves.emplace_back(500, 520, 530, 1.5f);
+    track->Channels[1].ClippingHalfwaves.emplace_back(700, 701, 702, 1.25f);
+
+    return track;
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+} // anonymous namespace
+
+namespace Nuclex::OpusTranscoder::Audio {
+
+  // ------------------------------------------------------------------------------------------- //
+
+  TEST(HalfwaveMapCacheTests, SavedCacheLoadsIdentically) {
+    std::shared_ptr<Track> track = makeStereoTrackWithHalfwaves(1.2f);
+
+    HalfwaveMapCache cache;
+    cache.Store(123, 456, 160.0f, *track);
+
+    HalfwaveMapCache loadedCache;
+    loadedCache.Load(cache.Save());
+    ASSERT_EQ(loadedCache.CountEntries(), 1U);
+
+    std::shared_ptr<Track> restoredTrack = makeStereoTrackWithHalfwaves(1.0f);
+    restoredTrack->Channels[0].ClippingHalfwaves.clear();
+    ASSERT_TRUE(loadedCache.Restore(123, 456, 160.0f, *restoredTrack));
+
+    for(std::size_t channelIndex = 0; channelIndex < 2; ++channelIndex) {
+      const ClippingHalfwaveTable &expected = track->Channels[channelIndex].ClippingHalfwaves;
+      const ClippingHalfwaveTable &actual = (
+        restoredTrack->Channels[channelIndex].ClippingHalfwaves
+      );
+      ASSERT_EQ(actual.size(), expected.size());
+      for(std::size_t index = 0; index < expected.size(); ++index) {
+        ClippingHalfwave expectedHalfwave = expected[index];
+        ClippingHalfwave actualHalfwave = actual[index];
+        EXPECT_EQ(actualHalfwave.PriorZeroCrossingIndex, expectedHalfwave.PriorZeroCrossingIndex);
+        EXPECT_EQ(actualHalfwave.PeakIndex, expectedHalfwave.PeakIndex);
+        EXPECT_EQ(actualHalfwave.NextZeroCrossingIndex, expectedHalfwave.NextZeroCrossingIndex);
+        EXPECT_EQ(
+          actualHalfwave.IneffectiveIterationCount, expectedHalfwave.IneffectiveIterationCount
+        );
+        EXPECT_EQ(actualHalfwave.PeakAmplitude, expectedHalfwave.PeakAmplitude);
+        EXPECT_EQ(actualHalfwave.VolumeQuotient, expectedHalfwave.VolumeQuotient);
+        EXPECT_EQ(actualHalfwave.PreviousPeakAmplitude, expectedHalfwave.PreviousPeakAmplitude);
+        EXPECT_EQ(actualHalfwave.PreviousVolumeQuotient, expectedHalfwave.PreviousVolumeQuotient);
+      }
+    }
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  TEST(HalfwaveMapCacheTests, RestoresEntryWithNearestBitrate) {
+    HalfwaveMapCache cache;
+    cache.Store(1, 2, 96.0f, *makeStereoTrackWithHalfwaves(1.1f));
+    cache.Store(1, 2, 192.0f, *makeStereoTrackWithHalfwaves(1.2f));
+    cache.Store(1, 2, 320.0f, *makeStereoTrackWithHalfwaves(1.3f));
+
+    std::shared_ptr<Track> track = makeStereoTrackWithHalfwaves(1.0f);
+    ASSERT_TRUE(cache.Restore(1, 2, 160.0f, *track));
+    EXPECT_EQ(track->Channels[0].ClippingHalfwaves.GetVolumeQuotient(0), 1.2f);
+
+    ASSERT_TRUE(cache.Restore(1, 2, 64.0f, *track));
+    EXPECT_EQ(track->Channels[0].ClippingHalfwaves.GetVolumeQuotient(0), 1.1f);
+
+    ASSERT_TRUE(cache.Restore(1, 2, 500.0f, *track));
+    EXPECT_EQ(track->Channels[0].ClippingHalfwaves.GetVolumeQuotient(0), 1.3f);
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  TEST(HalfwaveMapCacheTests, IgnoresEntriesForOtherInputsOrSettings) {
+    HalfwaveMapCache cache;
+    cache.Store(1, 2, 192.0f, *makeStereoTrackWithHalfwaves(1.2f));
+
+    std::shared_ptr<Track> track = makeStereoTrackWithHalfwaves(1.0f);
+    EXPECT_FALSE(cache.Restore(9, 2, 192.0f, *track));
+    EXPECT_FALSE(cache.Restore(1, 9, 192.0f, *track));
+
+    track->Channels.resize(3);
+    EXPECT_FALSE(cache.Restore(1, 2, 192.0f, *track));
+
+    // A track that is too short to hold the cached half-waves can't be the same input
+    std::shared_ptr<Track> shortTrack = makeStereoTrackWithHalfwaves(1.0f);
+    shortTrack->Samples.resize(1000);
+    EXPECT_FALSE(cache.Restore(1, 2, 192.0f, *shortTrack));
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  TEST(HalfwaveMapCacheTests, ReplacesSameCaseAndDropsOldestEntries) {
+    HalfwaveMapCache cache;
+    cache.Store(1, 2, 192.0f, *makeStereoTrackWithHalfwaves(1.2f));
+    cache.Store(1, 2, 192.0f, *makeStereoTrackWithHalfwaves(1.4f));
+    EXPECT_EQ(cache.CountEntries(), 1U);
+
+    for(std::size_t index = 0; index < HalfwaveMapCache::MaximumEntryCount; ++index) {
+      cache.Store(100 + index, 2, 192.0f, *makeStereoTrackWithHalfwaves(1.0f));
+    }
+    EXPECT_EQ(cache.CountEntries(), HalfwaveMapCache::MaximumEntryCount);
+
+    std::shared_ptr<Track> track = makeStereoTrackWithHalfwaves(1.0f);
+    EXPECT_FALSE(cache.Restore(1, 2, 192.0f, *track));
+    EXPECT_TRUE(cache.Restore(100, 2, 192.0f, *track));
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  TEST(HalfwaveMapCacheTests, RejectsDamagedContents) {
+    HalfwaveMapCache cache;
+    cache.Store(1, 2, 192.0f, *makeStereoTrackWithHalfwaves(1.2f));
+    std::vector<std::byte> contents = cache.Save();
+
+    HalfwaveMapCache loadedCache;
+
+    std::vector<std::byte> truncated(contents.begin(), contents.end() - 3);
+    EXPECT_THROW(loadedCache.Load(truncated), std::runtime_error);
+    EXPECT_EQ(loadedCache.CountEntries(), 0U);
+
+    std::vector<std::byte> wrongSignature(contents);
+    wrongSignature[0] = std::byte(0);
+    EXPECT_THROW(loadedCache.Load(wrongSignature), std::runtime_error);
+
+    std::vector<std::byte> trailingGarbage(contents);
+    trailingGarbage.push_back(std::byte(42));
+    EXPECT_THROW(loadedCache.Load(trailingGarbage), std::runtime_error);
+
+    loadedCache.Load(contents);
+    EXPECT_EQ(loadedCache.CountEntries(), 1U);
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+} // namespace Nuclex::OpusTranscoder::Audio
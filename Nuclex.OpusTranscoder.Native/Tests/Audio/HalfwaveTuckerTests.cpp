@@ -25,6 +25,10 @@ limitations under the License.
 #include "../../Source/Audio/HalfwaveTucker.h"
 
 #include <Nuclex/Support/Threading/StopSource.h>
+#include <Nuclex/Support/Threading/ThreadPool.h>
+
+#include <algorithm> // for std::copy_n(), std::min()
+#include <cmath> // for std::pow()
 
 #include <gtest/gtest.h>
 
@@ -73,7 +77,7 @@ namespace Nuclex::OpusTranscoder::Audio {
     using Nuclex::Support::Threading::StopToken;
 
     std::shared_ptr<Track> track = makeStereoTrack();
-    track->Samples.resize(18);
+    track->Samples.resize(18, 0.0f);
 
     track->Samples[0] = 1.1f;   // 0
     track->Samples[2] = 0.9f;   // 1
@@ -131,6 +135,208 @@ namespace Nuclex::OpusTranscoder::Audio {
   }
 
   // ------------------------------------------------------------------------------------------- //
+
+  TEST(HalfwaveTuckerTests, AppliedQuotientsMatchTuckedTrack) {
+    using Nuclex::Support::Events::Delegate;
+    using Nuclex::Support::Threading::StopSource;
+
+    std::shared_ptr<Track> track = makeStereoTrack();
+    track->Samples.resize(200);
+    for(std::size_t index = 0; index < 200; ++index) {
+      track->Samples[index] = static_cast<float>((index * 37) % 23) / 10.0f - 1.1f;
+    }
+
+    track->Channels[0].ClippingHalfwaves.emplace_back(3, 4, 11, 1.2f);
+    track->Channels[0].ClippingHalfwaves.emplace_back(40, 45, 71, 1.5f);
+    track->Channels[1].ClippingHalfwaves.emplace_back(0, 2, 9, 1.1f);
+    track->Channels[1].ClippingHalfwaves.emplace_back(17, 20, 33, 2.0f);
+    track->Channels[1].ClippingHalfwaves.emplace_back(90, 95, 100, 1.3f);
+
+    // Tuck in a copy of the track the usual way, updating its volume quotients
+    std::shared_ptr<Track> tuckedTrack = std::make_shared<Track>(*track);
+    Delegate<void(float)> progressCallback = (
+      Delegate<void(float)>::Create<&doNothing>()
+    );
+    HalfwaveTucker::TuckClippingHalfwaves(
+      tuckedTrack, StopSource::Create()->GetToken(), progressCallback
+    );
+
+    // Now apply the same volume quotients to the original samples in odd-sized chunks
+    tuckedTrack->CopyClippingHalfwavesInto(track);
+    std::vector<float> chunk(14);
+    for(std::uint64_t frameIndex = 0; frameIndex < 100; frameIndex += 7) {
+      std::size_t frameCount = std::min<std::size_t>(7, 100 - frameIndex);
+      std::copy_n(track->Samples.data() + frameIndex * 2, frameCount * 2, chunk.data());
+      HalfwaveTucker::ApplyVolumeQuotients(track, chunk.data(), frameIndex, frameCount);
+
+      for(std::size_t index = 0; index < frameCount * 2; ++index) {
+        EXPECT_EQ(chunk[index], tuckedTrack->Samples[frameIndex * 2 + index]);
+      }
+    }
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  TEST(HalfwaveTuckerTests, DetectsSectionsOverlappingHalfwaves) {
+    std::shared_ptr<Track> track = makeStereoTrack();
+    track->Samples.resize(200, 0.0f);
+
+    track->Channels[0].ClippingHalfwaves.emplace_back(40, 45, 71, 1.5f);
+    track->Channels[1].ClippingHalfwaves.emplace_back(17, 20, 33, 2.0f);
+
+    EXPECT_FALSE(HalfwaveTucker::OverlapsClippingHalfwaves(track, 0, 17));
+    EXPECT_TRUE(HalfwaveTucker::OverlapsClippingHalfwaves(track, 0, 18));
+    EXPECT_TRUE(HalfwaveTucker::OverlapsClippingHalfwaves(track, 32, 1));
+    EXPECT_FALSE(HalfwaveTucker::OverlapsClippingHalfwaves(track, 33, 7));
+    EXPECT_TRUE(HalfwaveTucker::OverlapsClippingHalfwaves(track, 33, 8));
+    EXPECT_TRUE(HalfwaveTucker::OverlapsClippingHalfwaves(track, 50, 5));
+    EXPECT_FALSE(HalfwaveTucker::OverlapsClippingHalfwaves(track, 71, 29));
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  TEST(HalfwaveTuckerTests, PredictionWithoutHistoryMatchesUpdate) {
+    ClippingHalfwave updated(10, 15, 20, 1.25f);
+    ClippingHalfwave predicted(10, 15, 20, 1.25f);
+
+    float updatedQuotient = HalfwaveTucker::UpdateVolumeQuotient(updated);
+    float predictedQuotient = HalfwaveTucker::PredictVolumeQuotient(predicted);
+
+    EXPECT_FLOAT_EQ(predictedQuotient, updatedQuotient);
+    EXPECT_FLOAT_EQ(predicted.VolumeQuotient, updated.VolumeQuotient);
+    EXPECT_EQ(predicted.PreviousVolumeQuotient, 1.0f);
+    EXPECT_EQ(predicted.PreviousPeakAmplitude, 1.25f);
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  TEST(HalfwaveTuckerTests, PredictionConvergesInFewerRounds) {
+
+    // Pretend the codec only passes on part of each change in volume to the decoded
+    // peak, so the decoded peak shrinks much slower than the quotient grows
+    const float originalPeak = 1.5f;
+    const float codecResponse = 0.4f;
+
+    std::size_t updatedRoundCount = 0;
+    {
+      ClippingHalfwave halfwave(10, 15, 20, originalPeak);
+      while((1.0f < halfwave.PeakAmplitude) && (updatedRoundCount < 100)) {
+        float quotient = HalfwaveTucker::UpdateVolumeQuotient(halfwave);
+        halfwave.PeakAmplitude = originalPeak * std::pow(quotient, -codecResponse);
+        ++updatedRoundCount;
+      }
+      EXPECT_LE(halfwave.PeakAmplitude, 1.0f);
+    }
+
+    std::size_t predictedRoundCount = 0;
+    {
+      ClippingHalfwave halfwave(10, 15, 20, originalPeak);
+      while((1.0f < halfwave.PeakAmplitude) && (predictedRoundCount < 100)) {
+        float quotient = HalfwaveTucker::PredictVolumeQuotient(halfwave);
+        halfwave.PeakAmplitude = originalPeak * std::pow(quotient, -codecResponse);
+        ++predictedRoundCount;
+      }
+      EXPECT_LE(halfwave.PeakAmplitude, 1.0f);
+    }
+
+    EXPECT_LT(predictedRoundCount, updatedRoundCount);
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  TEST(HalfwaveTuckerTests, PredictionLimitsStepSize) {
+    ClippingHalfwave halfwave(10, 15, 20, 1.2f);
+    halfwave.VolumeQuotient = 1.25f;
+    halfwave.PreviousVolumeQuotient = 1.2f;
+    halfwave.PreviousPeakAmplitude = 1.2f; // Peak didn't move at all
+
+    HalfwaveTucker::PredictVolumeQuotient(halfwave);
+    EXPECT_GT(halfwave.VolumeQuotient, 1.25f * 1.2f);
+    EXPECT_LE(halfwave.VolumeQuotient, 1.25f * 2.0f);
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  TEST(HalfwaveTuckerTests, PredictionDoesNotLimitFirstStep) {
+    ClippingHalfwave updated(10, 15, 20, 3.0f);
+    ClippingHalfwave predicted(10, 15, 20, 3.0f);
+
+    float updatedQuotient = HalfwaveTucker::UpdateVolumeQuotient(updated);
+    float predictedQuotient = HalfwaveTucker::PredictVolumeQuotient(predicted);
+
+    EXPECT_FLOAT_EQ(predictedQuotient, updatedQuotient);
+    EXPECT_FLOAT_EQ(predicted.VolumeQuotient, 3.0f);
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  TEST(HalfwaveTuckerTests, DetectsClippingNeighbours) {
+    ClippingHalfwaveTable halfwaves;
+    halfwaves.emplace_back(100, 105, 110, 1.5f);
+    halfwaves.emplace_back(200, 205, 210, 0.9f);
+    halfwaves.emplace_back(300, 305, 310, 1.5f);
+    halfwaves.emplace_back(2000, 2005, 2010, 1.5f);
+
+    EXPECT_FALSE(HalfwaveTucker::HasClippingNeighbour(halfwaves, 0, 960));
+    EXPECT_TRUE(HalfwaveTucker::HasClippingNeighbour(halfwaves, 1, 960));
+    EXPECT_FALSE(HalfwaveTucker::HasClippingNeighbour(halfwaves, 1, 50));
+    EXPECT_FALSE(HalfwaveTucker::HasClippingNeighbour(halfwaves, 2, 960));
+    EXPECT_TRUE(HalfwaveTucker::HasClippingNeighbour(halfwaves, 2, 2000));
+    EXPECT_FALSE(HalfwaveTucker::HasClippingNeighbour(halfwaves, 3, 960));
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  TEST(HalfwaveTuckerTests, ParallelTuckMatchesSerialTuck) {
+    using Nuclex::Support::Events::Delegate;
+    using Nuclex::Support::Threading::StopSource;
+    using Nuclex::Support::Threading::ThreadPool;
+
+    std::shared_ptr<Track> track = makeStereoTrack();
+    track->Samples.resize(200);
+    for(std::size_t index = 0; index < 200; ++index) {
+      track->Samples[index] = static_cast<float>((index * 37) % 23) / 10.0f - 1.1f;
+    }
+
+    track->Channels[0].ClippingHalfwaves.emplace_back(3, 4, 11, 1.2f);
+    track->Channels[0].ClippingHalfwaves.emplace_back(40, 45, 71, 1.5f);
+    track->Channels[1].ClippingHalfwaves.emplace_back(0, 2, 9, 1.1f);
+    track->Channels[1].ClippingHalfwaves.emplace_back(17, 20, 33, 2.0f);
+    track->Channels[1].ClippingHalfwaves.emplace_back(90, 95, 100, 1.3f);
+
+    std::shared_ptr<Track> parallelTrack = std::make_shared<Track>(*track);
+
+    Delegate<void(float)> progressCallback = (
+      Delegate<void(float)>::Create<&doNothing>()
+    );
+    HalfwaveTucker::TuckClippingHalfwaves(
+      track, StopSource::Create()->GetToken(), progressCallback
+    );
+    {
+      ThreadPool threadPool;
+      HalfwaveTucker::TuckClippingHalfwaves(
+        parallelTrack, threadPool, StopSource::Create()->GetToken(), progressCallback
+      );
+    }
+
+    for(std::size_t index = 0; index < 200; ++index) {
+      EXPECT_EQ(parallelTrack->Samples[index], track->Samples[index]);
+    }
+    for(std::size_t channelIndex = 0; channelIndex < 2; ++channelIndex) {
+      const ClippingHalfwaveTable &expected = (
+        track->Channels[channelIndex].ClippingHalfwaves
+      );
+      const ClippingHalfwaveTable &actual = (
+        parallelTrack->Channels[channelIndex].ClippingHalfwaves
+      );
+      ASSERT_EQ(actual.size(), expected.size());
+      for(std::size_t index = 0; index < expected.size(); ++index) {
+        EXPECT_EQ(actual[index].VolumeQuotient, expected[index].VolumeQuotient);
+      }
+    }
+  }
+
+  // ------------------------------------------------------------------------------------------- //
 #if 0 // UNIT TEST WORKS, BUT METHOD CORRUPTS AUDIO TRACK IN REAL WORLD DATA
   TEST(HalfwaveTuckerTests, TucksClippingHalfwavesIntoClonedChannel) {
     using Nuclex::Support::Events::Delegate;
@@ -138,7 +344,7 @@ namespace Nuclex::OpusTranscoder::Audio {
     using Nuclex::Support::Threading::StopToken;
 
     std::shared_ptr<Track> track = makeStereoTrack();
-    track->Samples.resize(18);
+    track->Samples.resize(18, 0.0f);
 
     track->Samples[0] = 1.1f;   // 0
     track->Samples[2] = 0.9f;   // 1
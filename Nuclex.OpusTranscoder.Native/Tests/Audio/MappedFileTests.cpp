@@ -0,0 +1,158 @@
+#pragma region Apache License 2.0
+/*
+Nuclex Opus Transcoder
+Copyright (C) 2024 Markus Ewald / Nuclex Development Labs
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#pragma endregion // Apache License 2.0
+
+// If the library is compiled as a DLL, this ensures symbols are exported
+#define NUCLEX_OPUSTRANSCODER_SOURCE 1
+
+#include "../../Source/Config.h"
+#include "../../Source/Audio/MappedFile.h"
+
+#include <gtest/gtest.h>
+
+#include <filesystem> // for std::filesystem::temp_directory_path()
+#include <fstream> // for std::ofstream
+#include <stdexcept> // for std::runtime_error
+#include <vector> // for std::vector
+
+namespace {
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Creates a buffer filled with a repeating byte pattern</summary>
+  /// <param name="byteCount">Number of bytes the buffer should hold</param>
+  /// <returns>The new buffer</returns>
+  std::vector<std::byte> makePattern(std::size_t byteCount) {
+    std::vector<std::byte> pattern(byteCount);
+    for(std::size_t index = 0; index < byteCount; ++index) {
+      pattern[index] = static_cast<std::byte>((index * 7 + index / 251) & 0xff);
+    }
+    return pattern;
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Writes a file into the temporary directory and deletes it again</summary>
+  class TemporaryFile {
+
+    /// <summary>Writes a new temporary file with the specified contents</summary>
+    /// <param name="contents">Contents the file will have</param>
+    public: TemporaryFile(const std::vector<std::byte> &contents) :
+      path(
+        std::filesystem::temp_directory_path() / u8"nuclex-opustranscoder-mappedfile-test"
+      ) {
+      std::ofstream stream(this->path, std::ios::out | std::ios::binary | std::ios::trunc);
+      stream.write(
+        reinterpret_cast<const char *>(contents.data()),
+        static_cast<std::streamsize>(contents.size())
+      );
+    }
+
+    /// <summary>Deletes the temporary file</summary>
+    public: ~TemporaryFile() {
+      std::error_code errorCode;
+      std::filesystem::remove(this->path, errorCode);
+    }
+
+    /// <summary>Returns the path of the temporary file</summary>
+    /// <returns>The path under which the temporary file has been written</returns>
+    public: std::string GetPath() const { return this->path.u8string(); }
+
+    /// <summary>Path of the temporary file</summary>
+    private: std::filesystem::path path;
+
+  };
+
+  // ------------------------------------------------------------------------------------------- //
+
+} // anonymous namespace
+
+namespace Nuclex::OpusTranscoder::Audio {
+
+  // ------------------------------------------------------------------------------------------- //
+
+  TEST(MappedFileTests, ServesTheContentsOfTheFile) {
+    std::vector<std::byte> pattern = makePattern(100000);
+    TemporaryFile temporaryFile(pattern);
+
+    MappedFile file(temporaryFile.GetPath());
+    ASSERT_EQ(file.GetSize(), pattern.size());
+
+    std::vector<std::byte> readBack(5000);
+    file.ReadAt(12345, readBack.size(), readBack.data());
+    for(std::size_t index = 0; index < readBack.size(); ++index) {
+      ASSERT_EQ(readBack[index], pattern[12345 + index]);
+    }
+
+    const std::byte *data = nullptr;
+    ASSERT_EQ(file.ReadSpan(0, pattern.size(), data), pattern.size());
+    EXPECT_EQ(std::vector<std::byte>(data, data + pattern.size()), pattern);
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  TEST(MappedFileTests, SpansAreCutOffAtTheEndOfTheFile) {
+    std::vector<std::byte> pattern = makePattern(1000);
+    TemporaryFile temporaryFile(pattern);
+
+    MappedFile file(temporaryFile.GetPath(), true);
+
+    const std::byte *data = nullptr;
+    EXPECT_EQ(file.ReadSpan(900, 500, data), 100U);
+    EXPECT_EQ(data[99], pattern[999]);
+    EXPECT_EQ(file.ReadSpan(1000, 500, data), 0U);
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  TEST(MappedFileTests, ReadingPastTheEndThrows) {
+    TemporaryFile temporaryFile(makePattern(1000));
+    MappedFile file(temporaryFile.GetPath());
+
+    std::vector<std::byte> readBack(100);
+    EXPECT_THROW(file.ReadAt(950, readBack.size(), readBack.data()), std::runtime_error);
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  TEST(MappedFileTests, EmptyFilesCanBeMapped) {
+    std::vector<std::byte> nothing;
+    TemporaryFile temporaryFile(nothing);
+    MappedFile file(temporaryFile.GetPath());
+    EXPECT_EQ(file.GetSize(), 0U);
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  TEST(MappedFileTests, ThrowsIfFileDoesNotExist) {
+    std::string path = (
+      std::filesystem::temp_directory_path() / u8"nuclex-opustranscoder-does-not-exist"
+    ).u8string();
+    EXPECT_THROW(MappedFile file(path), std::runtime_error);
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  TEST(MappedFileTests, RefusesToMapAnythingButRegularFiles) {
+    std::string path = std::filesystem::temp_directory_path().u8string();
+    EXPECT_THROW(MappedFile directory(path), std::runtime_error);
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+} // namespace Nuclex::OpusTranscoder::Audio
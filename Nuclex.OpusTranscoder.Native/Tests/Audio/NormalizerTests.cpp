@@ -0,0 +1,140 @@
+#pragma region Apache License 2.0
+/*
+Nuclex Opus Transcoder
+Copyright (C) 2024 Markus Ewald / Nuclex Development Labs
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#pragma endregion // Apache License 2.0
+
+// If the library is compiled as a DLL, this ensures symbols are exported
+#define NUCLEX_OPUSTRANSCODER_SOURCE 1
+
+#include "../../Source/Config.h"
+#include "../../Source/Audio/Track.h"
+#include "../../Source/Audio/Normalizer.h"
+
+#include <Nuclex/Support/Threading/StopSource.h>
+#include <Nuclex/Support/Threading/ThreadPool.h>
+
+#include <gtest/gtest.h>
+
+#include <cmath> // for std::sin()
+
+namespace {
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Highest progress that has been reported to <see cref="recordProgress" /></summary>
+  float highestReportedProgress = 0.0f;
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Remembers the highest progress that has been reported</summary>
+  /// <param name="progress">Progress that is being reported</param>
+  void recordProgress(float progress) {
+    if(highestReportedProgress < progress) {
+      highestReportedProgress = progress;
+    }
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Creates a stereo track holding a quiet sine wave in both channels</summary>
+  /// <param name="frameCount">Number of frames the track should have</param>
+  /// <returns>The new stereo track</returns>
+  std::shared_ptr<Nuclex::OpusTranscoder::Audio::Track> makeQuietStereoTrack(
+    std::size_t frameCount
+  ) {
+    using Nuclex::OpusTranscoder::Audio::Track;
+    std::shared_ptr<Track> track = std::make_shared<Track>();
+
+    track->Channels.resize(2);
+    track->Channels[0].InputOrder = 0;
+    track->Channels[0].Placement = Nuclex::Audio::ChannelPlacement::FrontLeft;
+    track->Channels[1].InputOrder = 1;
+    track->Channels[1].Placement = Nuclex::Audio::ChannelPlacement::FrontRight;
+
+    track->Samples.resize(frameCount * 2);
+    for(std::size_t index = 0; index < frameCount; ++index) {
+      float sample = 0.5f * std::sin(static_cast<float>(index) * 0.01f);
+      track->Samples[index * 2] = sample;
+      track->Samples[index * 2 + 1] = sample;
+    }
+
+    return track;
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+} // anonymous namespace
+
+namespace Nuclex::OpusTranscoder::Audio {
+
+  // ------------------------------------------------------------------------------------------- //
+
+  TEST(NormalizerTests, ParallelNormalizationProgressNeverExceedsOne) {
+    using Nuclex::Support::Events::Delegate;
+    using Nuclex::Support::Threading::StopSource;
+    using Nuclex::Support::Threading::ThreadPool;
+
+    // Frame counts that don't line up with the progress reporting interval
+    std::size_t frameCounts[] = { 1, 12287, 16385, 100001, 1000003 };
+    for(std::size_t frameCount : frameCounts) {
+      std::shared_ptr<Track> track = makeQuietStereoTrack(frameCount);
+
+      highestReportedProgress = 0.0f;
+      Delegate<void(float)> progressCallback = Delegate<void(float)>::Create<&recordProgress>();
+      {
+        ThreadPool threadPool;
+        Normalizer::Normalize(
+          track, false, threadPool, StopSource::Create()->GetToken(), progressCallback
+        );
+      }
+
+      EXPECT_LE(highestReportedProgress, 1.0f);
+      EXPECT_GE(highestReportedProgress, 0.999f);
+    }
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  TEST(NormalizerTests, ParallelPeakScanProgressNeverExceedsOne) {
+    using Nuclex::Support::Events::Delegate;
+    using Nuclex::Support::Threading::StopSource;
+    using Nuclex::Support::Threading::ThreadPool;
+
+    std::shared_ptr<Track> track = makeQuietStereoTrack(100001);
+
+    highestReportedProgress = 0.0f;
+    Delegate<void(float)> progressCallback = Delegate<void(float)>::Create<&recordProgress>();
+
+    float maximumAmplitude = 0.0f;
+    float maximumBassAmplitude = 0.0f;
+    {
+      ThreadPool threadPool;
+      Normalizer::UpdatePeakAmplitudes(
+        track, maximumAmplitude, maximumBassAmplitude,
+        threadPool, StopSource::Create()->GetToken(), progressCallback
+      );
+    }
+
+    EXPECT_LE(highestReportedProgress, 1.0f);
+    EXPECT_GT(maximumAmplitude, 0.49f);
+    EXPECT_LE(maximumAmplitude, 0.5f);
+    EXPECT_EQ(maximumBassAmplitude, 0.0f);
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+} // namespace Nuclex::OpusTranscoder::Audio
@@ -0,0 +1,147 @@
+#pragma region Apache License 2.0
+/*
+Nuclex Opus Transcoder
+Copyright (C) 2024 Markus Ewald / Nuclex Development Labs
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#pragma endregion // Apache License 2.0
+
+// If the library is compiled as a DLL, this ensures symbols are exported
+#define NUCLEX_OPUSTRANSCODER_SOURCE 1
+
+#include "../../Source/Config.h"
+#include "../../Source/Audio/OggOpusStream.h"
+
+#include <gtest/gtest.h>
+
+namespace {
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Creates an Ogg Opus stream with valid headers but no audio packets</summary>
+  /// <param name="preSkip">Pre-skip that will be stored in the OpusHead header</param>
+  /// <returns>The new Ogg Opus stream</returns>
+  Nuclex::OpusTranscoder::Audio::OggOpusStream makeEmptyStream(std::uint16_t preSkip) {
+    using Nuclex::OpusTranscoder::Audio::OggOpusStream;
+
+    OggOpusStream stream;
+    stream.SerialNumber = 0x12345678;
+
+    const char head[] = u8"OpusHead";
+    for(std::size_t index = 0; index < 8; ++index) {
+      stream.HeaderPacket.push_back(static_cast<std::byte>(head[index]));
+    }
+    stream.HeaderPacket.push_back(std::byte(1)); // version
+    stream.HeaderPacket.push_back(std::byte(2)); // channel count
+    stream.HeaderPacket.push_back(static_cast<std::byte>(preSkip & 0xff));
+    stream.HeaderPacket.push_back(static_cast<std::byte>(preSkip >> 8));
+    stream.HeaderPacket.push_back(std::byte(0x80)); // 48000 Hz
+    stream.HeaderPacket.push_back(std::byte(0xbb));
+    stream.HeaderPacket.push_back(std::byte(0));
+    stream.HeaderPacket.push_back(std::byte(0));
+    stream.HeaderPacket.push_back(std::byte(0)); // output gain
+    stream.HeaderPacket.push_back(std::byte(0));
+    stream.HeaderPacket.push_back(std::byte(0)); // mapping family
+
+    const char tags[] = u8"OpusTags";
+    for(std::size_t index = 0; index < 8; ++index) {
+      stream.CommentPacket.push_back(static_cast<std::byte>(tags[index]));
+    }
+    for(std::size_t index = 0; index < 8; ++index) {
+      stream.CommentPacket.push_back(std::byte(0)); // no vendor, no comments
+    }
+
+    return stream;
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+} // anonymous namespace
+
+namespace Nuclex::OpusTranscoder::Audio {
+
+  // ------------------------------------------------------------------------------------------- //
+
+  TEST(OggOpusStreamTests, CountsSamplesInPackets) {
+    std::byte celtTwentyMilliseconds[] = { std::byte(31 << 3) };
+    EXPECT_EQ(OggOpusStream::CountSamplesInPacket(celtTwentyMilliseconds, 1), 960U);
+
+    std::byte silkSixtyMilliseconds[] = { std::byte(3 << 3) };
+    EXPECT_EQ(OggOpusStream::CountSamplesInPacket(silkSixtyMilliseconds, 1), 2880U);
+
+    std::byte hybridTenMillisecondsTwice[] = { std::byte((12 << 3) | 1) };
+    EXPECT_EQ(OggOpusStream::CountSamplesInPacket(hybridTenMillisecondsTwice, 1), 960U);
+
+    std::byte celtFiveMillisecondsFourTimes[] = { std::byte((17 << 3) | 3), std::byte(4) };
+    EXPECT_EQ(OggOpusStream::CountSamplesInPacket(celtFiveMillisecondsFourTimes, 2), 960U);
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  TEST(OggOpusStreamTests, WrittenStreamCanBeParsedAgain) {
+    OggOpusStream stream = makeEmptyStream(312);
+
+    // A mix of small packets and one huge packet that needs to span several pages
+    std::vector<std::byte> packet(100000);
+    for(std::size_t index = 0; index < packet.size(); ++index) {
+      packet[index] = static_cast<std::byte>(index * 7);
+    }
+    packet[0] = std::byte(31 << 3);
+    for(std::size_t index = 0; index < 300; ++index) {
+      std::size_t length = (index == 150) ? packet.size() : (index % 400 + 1);
+      stream.AppendPacket(packet.data(), length, 960);
+    }
+    stream.FinalGranulePosition = stream.Packets.back().EndPosition - 100;
+
+    std::vector<std::byte> contents;
+    stream.Write(contents);
+
+    OggOpusStream parsed = OggOpusStream::Parse(contents.data(), contents.size());
+    EXPECT_EQ(parsed.SerialNumber, stream.SerialNumber);
+    EXPECT_EQ(parsed.GetPreSkip(), 312U);
+    EXPECT_EQ(parsed.HeaderPacket, stream.HeaderPacket);
+    EXPECT_EQ(parsed.CommentPacket, stream.CommentPacket);
+    EXPECT_EQ(parsed.AudioData, stream.AudioData);
+    EXPECT_EQ(parsed.FinalGranulePosition, stream.FinalGranulePosition);
+
+    ASSERT_EQ(parsed.Packets.size(), stream.Packets.size());
+    for(std::size_t index = 0; index < parsed.Packets.size(); ++index) {
+      EXPECT_EQ(parsed.Packets[index].Offset, stream.Packets[index].Offset);
+      EXPECT_EQ(parsed.Packets[index].Size, stream.Packets[index].Size);
+      EXPECT_EQ(parsed.Packets[index].SampleCount, 960U);
+      EXPECT_EQ(parsed.Packets[index].EndPosition, (index + 1) * 960U);
+    }
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  TEST(OggOpusStreamTests, CorruptedPagesAreDetected) {
+    OggOpusStream stream = makeEmptyStream(312);
+    std::byte packet[] = { std::byte(31 << 3), std::byte(1), std::byte(2) };
+    stream.AppendPacket(packet, 3, 960);
+    stream.FinalGranulePosition = 960;
+
+    std::vector<std::byte> contents;
+    stream.Write(contents);
+    contents.back() ^= std::byte(0x10);
+
+    EXPECT_THROW(
+      OggOpusStream::Parse(contents.data(), contents.size()),
+      std::runtime_error
+    );
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+} // namespace Nuclex::OpusTranscoder::Audio
@@ -0,0 +1,98 @@
+#pragma region Apache License 2.0
+/*
+Nuclex Opus Transcoder
+Copyright (C) 2024 Markus Ewald / Nuclex Development Labs
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#pragma endregion // Apache License 2.0
+
+// If the library is compiled as a DLL, this ensures symbols are exported
+#define NUCLEX_OPUSTRANSCODER_SOURCE 1
+
+#include "../../Source/Config.h"
+#include "../../Source/Audio/PerformanceReport.h"
+#include "../../Source/Audio/SampleBuffer.h"
+
+#include <gtest/gtest.h>
+
+namespace Nuclex::OpusTranscoder::Audio {
+
+  // ------------------------------------------------------------------------------------------- //
+
+  TEST(PerformanceReportTest, StageTimersAddUpRuns) {
+    PerformanceReport report;
+    report.Begin(u8"input.flac", u8"output.opus", 0);
+    {
+      PerformanceReport::StageTimer timer(report, PerformanceStage::Decode);
+      timer.AddBytes(1000);
+    }
+    {
+      PerformanceReport::StageTimer timer(report, PerformanceStage::Decode, true);
+      timer.AddBytes(234);
+    }
+    report.End(u8"succeeded");
+
+    const PerformanceReport::Stage &decode = report.GetStage(PerformanceStage::Decode);
+    EXPECT_EQ(decode.RunCount, 2U);
+    EXPECT_EQ(decode.ByteCount, 1234U);
+    EXPECT_GE(decode.WallSeconds, 0.0);
+    EXPECT_LE(decode.WallSeconds, report.GetWallSeconds());
+
+    EXPECT_EQ(report.GetStage(PerformanceStage::Encode).RunCount, 0U);
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  TEST(PerformanceReportTest, PeakSampleMemoryIsMeasured) {
+    PerformanceReport report;
+    report.Begin(u8"input.flac", u8"output.opus", 0);
+    {
+      SampleBuffer samples(10000);
+    }
+    report.End(u8"succeeded");
+
+    EXPECT_GE(report.GetPeakSampleByteCount(), 10000 * sizeof(float));
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  TEST(PerformanceReportTest, JsonListsStagesThatRanAndDeclippingRounds) {
+    PerformanceReport report;
+    report.Begin(u8"C:\\Music\\\"Live\".flac", u8"output.opus", 2);
+    {
+      PerformanceReport::StageTimer timer(report, PerformanceStage::Encode);
+      timer.AddBytes(4096);
+    }
+    report.AddDeclippingRound(12);
+    report.AddDeclippingRound(0);
+    report.End(u8"failed");
+
+    std::string json = report.ToJson();
+    EXPECT_EQ(json.front(), '{');
+    EXPECT_EQ(json.back(), '}');
+    EXPECT_EQ(json.find('\n'), std::string::npos);
+
+    EXPECT_NE(json.find(u8"\"input\":\"C:\\\\Music\\\\\\\"Live\\\".flac\""), std::string::npos);
+    EXPECT_NE(json.find(u8"\"trackIndex\":2"), std::string::npos);
+    EXPECT_NE(json.find(u8"\"outcome\":\"failed\""), std::string::npos);
+    EXPECT_NE(json.find(u8"\"declippingRounds\":2"), std::string::npos);
+    EXPECT_NE(json.find(u8"\"remainingHalfwaves\":[12,0]"), std::string::npos);
+    EXPECT_NE(json.find(u8"\"name\":\"encode\""), std::string::npos);
+    EXPECT_NE(json.find(u8"\"bytes\":4096"), std::string::npos);
+    EXPECT_EQ(json.find(u8"\"name\":\"decode\""), std::string::npos);
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+} // namespace Nuclex::OpusTranscoder::Audio
@@ -0,0 +1,185 @@
+#pragma region Apache License 2.0
+/*
+Nuclex Opus Transcoder
+Copyright (C) 2024 Markus Ewald / Nuclex Development Labs
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#pragma endregion // Apache License 2.0
+
+// If the library is compiled as a DLL, this ensures symbols are exported
+#define NUCLEX_OPUSTRANSCODER_SOURCE 1
+
+#include "../../Source/Config.h"
+#include "../../Source/Audio/PipeInputFile.h"
+#include "../../Source/Audio/PipeOutputFile.h"
+
+#include <gtest/gtest.h>
+
+#include <stdexcept> // for std::runtime_error
+#include <limits> // for std::numeric_limits
+#include <vector> // for std::vector
+
+namespace {
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Returns the byte that the test stream contains at an offset</summary>
+  /// <param name="offset">Offset of the byte in the test stream</param>
+  /// <returns>The byte at the specified offset</returns>
+  std::byte byteAt(std::uint64_t offset) {
+    return static_cast<std::byte>((offset * 7 + (offset >> 16)) & 0xff);
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Creates a temporary file holding the test stream, rewound to its start</summary>
+  /// <param name="length">Length of the test stream in bytes</param>
+  /// <returns>The temporary file, which is deleted when it is closed</returns>
+  std::FILE *makeTestStream(std::size_t length) {
+    std::FILE *stream = std::tmpfile();
+    if(stream == nullptr) {
+      throw std::runtime_error(u8"Could not create temporary file");
+    }
+
+    std::vector<std::byte> contents(length);
+    for(std::size_t index = 0; index < length; ++index) {
+      contents[index] = byteAt(index);
+    }
+    std::fwrite(contents.data(), 1, length, stream);
+    std::rewind(stream);
+
+    return stream;
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Checks whether a buffer holds the test stream contents from an offset</summary>
+  /// <param name="buffer">Buffer that will be checked</param>
+  /// <param name="offset">Offset in the test stream the buffer was read from</param>
+  /// <returns>True if the buffer holds the expected contents</returns>
+  bool matchesTestStream(const std::vector<std::byte> &buffer, std::uint64_t offset) {
+    for(std::size_t index = 0; index < buffer.size(); ++index) {
+      if(buffer[index] != byteAt(offset + index)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+} // anonymous namespace
+
+namespace Nuclex::OpusTranscoder::Audio {
+
+  // ------------------------------------------------------------------------------------------- //
+
+  TEST(PipeInputFileTest, StreamCanBeReadSequentially) {
+    std::FILE *stream = makeTestStream(200000);
+    {
+      PipeInputFile file(stream);
+      EXPECT_EQ(file.GetSize(), std::numeric_limits<std::uint64_t>::max());
+
+      std::vector<std::byte> buffer(50000);
+      for(std::uint64_t offset = 0; offset < 200000; offset += 50000) {
+        file.ReadAt(offset, buffer.size(), buffer.data());
+        EXPECT_TRUE(matchesTestStream(buffer, offset));
+      }
+
+      EXPECT_THROW(file.ReadAt(199999, 2, buffer.data()), std::runtime_error);
+      EXPECT_EQ(file.GetSize(), 200000U);
+    }
+    std::fclose(stream);
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  TEST(PipeInputFileTest, HeadCanBeReadAgainAfterReadingOn) {
+    std::size_t length = PipeInputFile::RetainedWindowSize * 3;
+    std::FILE *stream = makeTestStream(length);
+    {
+      PipeInputFile file(stream);
+
+      std::vector<std::byte> buffer(4096);
+      file.ReadAt(length - buffer.size(), buffer.size(), buffer.data());
+      EXPECT_TRUE(matchesTestStream(buffer, length - buffer.size()));
+
+      file.ReadAt(0, buffer.size(), buffer.data());
+      EXPECT_TRUE(matchesTestStream(buffer, 0));
+
+      std::uint64_t headEnd = PipeInputFile::RetainedHeadSize - buffer.size();
+      file.ReadAt(headEnd, buffer.size(), buffer.data());
+      EXPECT_TRUE(matchesTestStream(buffer, headEnd));
+    }
+    std::fclose(stream);
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  TEST(PipeInputFileTest, SeekingBackBeyondWindowFails) {
+    std::size_t length = PipeInputFile::RetainedWindowSize * 3;
+    std::FILE *stream = makeTestStream(length);
+    {
+      PipeInputFile file(stream);
+
+      std::vector<std::byte> buffer(4096);
+      file.ReadAt(length - buffer.size(), buffer.size(), buffer.data());
+
+      // Data shortly before the last read is still there
+      std::uint64_t recentOffset = length - PipeInputFile::RetainedWindowSize;
+      file.ReadAt(recentOffset, buffer.size(), buffer.data());
+      EXPECT_TRUE(matchesTestStream(buffer, recentOffset));
+
+      // But data between the head and the window has been dropped
+      std::uint64_t droppedOffset = PipeInputFile::RetainedHeadSize * 2;
+      EXPECT_THROW(
+        file.ReadAt(droppedOffset, buffer.size(), buffer.data()), std::runtime_error
+      );
+    }
+    std::fclose(stream);
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  TEST(PipeOutputFileTest, WritesMustBeSequential) {
+    std::FILE *stream = std::tmpfile();
+    ASSERT_NE(stream, nullptr);
+    {
+      PipeOutputFile file(stream);
+
+      std::vector<std::byte> buffer(1000);
+      for(std::size_t index = 0; index < buffer.size(); ++index) {
+        buffer[index] = byteAt(index);
+      }
+
+      file.WriteAt(0, 600, buffer.data());
+      file.WriteAt(600, 400, buffer.data() + 600);
+      EXPECT_EQ(file.GetSize(), 1000U);
+
+      EXPECT_THROW(file.WriteAt(0, 10, buffer.data()), std::runtime_error);
+      EXPECT_THROW(file.WriteAt(1010, 10, buffer.data()), std::runtime_error);
+    }
+
+    std::rewind(stream);
+    std::vector<std::byte> written(1001);
+    EXPECT_EQ(std::fread(written.data(), 1, written.size(), stream), 1000U);
+    written.resize(1000);
+    EXPECT_TRUE(matchesTestStream(written, 0));
+
+    std::fclose(stream);
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+} // namespace Nuclex::OpusTranscoder::Audio
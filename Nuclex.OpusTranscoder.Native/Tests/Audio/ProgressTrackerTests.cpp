@@ -0,0 +1,126 @@
+#pragma region Apache License 2.0
+/*
+Nuclex Opus Transcoder
+Copyright (C) 2024 Markus Ewald / Nuclex Development Labs
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#pragma endregion // Apache License 2.0
+
+// If the library is compiled as a DLL, this ensures symbols are exported
+#define NUCLEX_OPUSTRANSCODER_SOURCE 1
+
+#include "../../Source/Config.h"
+#include "../../Source/Audio/ProgressTracker.h"
+
+#include <gtest/gtest.h>
+
+#include <thread> // for std::thread
+#include <vector> // for std::vector
+
+namespace Nuclex::OpusTranscoder::Audio {
+
+  // ------------------------------------------------------------------------------------------- //
+
+  TEST(ProgressTrackerTest, StepsAreNumberedInOrder) {
+    ProgressTracker tracker(0.0f);
+    EXPECT_EQ(tracker.GetStepNumber(), 0U);
+
+    EXPECT_EQ(tracker.BeginStep(), 1U);
+    EXPECT_EQ(tracker.BeginStep(0.5f), 2U);
+    EXPECT_EQ(tracker.GetStepNumber(), 2U);
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  TEST(ProgressTrackerTest, BeginningStepCanKeepOrResetProgress) {
+    ProgressTracker tracker(0.0f);
+
+    tracker.Report(0.75f);
+    tracker.BeginStep();
+    EXPECT_EQ(tracker.GetProgress(), 0.75f);
+
+    tracker.BeginStep(-1.0f);
+    EXPECT_EQ(tracker.GetProgress(), -1.0f);
+
+    std::uint32_t stepNumber = 0;
+    float progress = 0.0f;
+    tracker.Report(0.25f);
+    tracker.GetStepAndProgress(stepNumber, progress);
+    EXPECT_EQ(stepNumber, 2U);
+    EXPECT_EQ(progress, 0.25f);
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  TEST(ProgressTrackerTest, EventsAreLimitedToMaximumRate) {
+    ProgressTracker tracker(0.0f);
+    EXPECT_TRUE(tracker.Report(0.1f));
+    EXPECT_TRUE(tracker.Report(0.2f));
+
+    // One event per thousand seconds, only the first report will be announced
+    tracker.SetMaximumEventRate(0.001f);
+    EXPECT_TRUE(tracker.Report(0.3f));
+    EXPECT_FALSE(tracker.Report(0.4f));
+    EXPECT_FALSE(tracker.Report(0.5f));
+
+    // Suppressed reports still update the progress
+    EXPECT_EQ(tracker.GetProgress(), 0.5f);
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  TEST(ProgressTrackerTest, ConcurrentReportsKeepStepNumber) {
+    ProgressTracker tracker(0.001f);
+
+    const std::size_t threadCount = 4;
+    const std::size_t reportCount = 20000;
+
+    std::vector<int> announcedCounts(threadCount, 0);
+    std::vector<std::thread> threads;
+    for(std::size_t threadIndex = 0; threadIndex < threadCount; ++threadIndex) {
+      threads.emplace_back(
+        [&tracker, &announcedCounts, threadIndex, reportCount]() {
+          for(std::size_t index = 0; index < reportCount; ++index) {
+            float progress = static_cast<float>(index) / static_cast<float>(reportCount);
+            if(tracker.Report(progress)) {
+              ++announcedCounts[threadIndex];
+            }
+          }
+        }
+      );
+    }
+
+    // Steps begin while the reports are coming in, none of them may get lost
+    for(std::size_t stepIndex = 0; stepIndex < 1000; ++stepIndex) {
+      tracker.BeginStep();
+    }
+    for(std::thread &thread : threads) {
+      thread.join();
+    }
+
+    EXPECT_EQ(tracker.GetStepNumber(), 1000U);
+    EXPECT_GE(tracker.GetProgress(), 0.0f);
+    EXPECT_LT(tracker.GetProgress(), 1.0f);
+
+    // Exactly one of all the reports fell into the only interval that passed
+    int totalAnnouncedCount = 0;
+    for(int announcedCount : announcedCounts) {
+      totalAnnouncedCount += announcedCount;
+    }
+    EXPECT_EQ(totalAnnouncedCount, 1);
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+} // namespace Nuclex::OpusTranscoder::Audio
@@ -0,0 +1,179 @@
+#pragma region Apache License 2.0
+/*
+Nuclex Opus Transcoder
+Copyright (C) 2024 Markus Ewald / Nuclex Development Labs
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#pragma endregion // Apache License 2.0
+
+// If the library is compiled as a DLL, this ensures symbols are exported
+#define NUCLEX_OPUSTRANSCODER_SOURCE 1
+
+#include "../../Source/Config.h"
+#include "../../Source/Audio/Track.h"
+#include "../../Source/Audio/Resampler.h"
+
+#include <Nuclex/Support/Threading/StopSource.h>
+#include <Nuclex/Support/Threading/ThreadPool.h>
+
+#include <gtest/gtest.h>
+
+#include <cmath> // for std::sin(), std::abs()
+
+namespace {
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Does absolutely nothing</summary>
+  void doNothing(float) {}
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Value of pi in double precision</summary>
+  const double Pi = 3.14159265358979323846;
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Creates a stereo track holding a sine wave in both channels</summary>
+  /// <param name="sampleRate">Sample rate the track will have</param>
+  /// <param name="frameCount">Number of frames the track should have</param>
+  /// <param name="frequency">Frequency of the sine wave in Hz</param>
+  /// <returns>The new stereo track</returns>
+  std::shared_ptr<Nuclex::OpusTranscoder::Audio::Track> makeSineTrack(
+    std::size_t sampleRate, std::size_t frameCount, double frequency
+  ) {
+    using Nuclex::OpusTranscoder::Audio::Track;
+    std::shared_ptr<Track> track = std::make_shared<Track>();
+
+    track->Channels.resize(2);
+    track->Channels[0].InputOrder = 0;
+    track->Channels[0].Placement = Nuclex::Audio::ChannelPlacement::FrontLeft;
+    track->Channels[1].InputOrder = 1;
+    track->Channels[1].Placement = Nuclex::Audio::ChannelPlacement::FrontRight;
+    track->SampleRate = sampleRate;
+
+    track->Samples.resize(frameCount * 2);
+    for(std::size_t index = 0; index < frameCount; ++index) {
+      double time = static_cast<double>(index) / static_cast<double>(sampleRate);
+      float sample = static_cast<float>(0.5 * std::sin(2.0 * Pi * frequency * time));
+      track->Samples[index * 2] = sample;
+      track->Samples[index * 2 + 1] = -sample;
+    }
+
+    return track;
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+} // anonymous namespace
+
+namespace Nuclex::OpusTranscoder::Audio {
+
+  // ------------------------------------------------------------------------------------------- //
+
+  TEST(ResamplerTests, CountsResampledFrames) {
+    EXPECT_EQ(Resampler::CountResampledFrames(44100, 44100, 48000), 48000U);
+    EXPECT_EQ(Resampler::CountResampledFrames(96000, 96000, 48000), 48000U);
+    EXPECT_EQ(Resampler::CountResampledFrames(1, 44100, 48000), 2U);
+    EXPECT_EQ(Resampler::CountResampledFrames(3, 96000, 48000), 2U);
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  TEST(ResamplerTests, RejectsImpracticalRatios) {
+    EXPECT_TRUE(Resampler::CanResample(44100, 48000));
+    EXPECT_TRUE(Resampler::CanResample(192000, 48000));
+    EXPECT_TRUE(Resampler::CanResample(8000, 48000));
+    EXPECT_FALSE(Resampler::CanResample(47999, 48000));
+    EXPECT_FALSE(Resampler::CanResample(0, 48000));
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  TEST(ResamplerTests, UpsampledSineMatchesSineAtTargetRate) {
+    using Nuclex::Support::Events::Delegate;
+    using Nuclex::Support::Threading::StopSource;
+
+    std::shared_ptr<Track> track = makeSineTrack(44100, 44100, 1000.0);
+    Delegate<void(float)> progressCallback = Delegate<void(float)>::Create<&doNothing>();
+    Resampler::Resample(track, 48000, StopSource::Create()->GetToken(), progressCallback);
+
+    ASSERT_TRUE(track->IsPlanar);
+    ASSERT_EQ(track->SampleRate, 48000U);
+    ASSERT_EQ(track->CountFrames(), 48000U);
+
+    // Away from both ends, where the filter reaches into the implied silence,
+    // the samples should be those of the same sine wave sampled at 48 kHz
+    float maximumError = 0.0f;
+    for(std::size_t index = 1000; index < 47000; ++index) {
+      double time = static_cast<double>(index) / 48000.0;
+      float expected = static_cast<float>(0.5 * std::sin(2.0 * Pi * 1000.0 * time));
+      maximumError = std::max(maximumError, std::abs(track->GetSample(0, index) - expected));
+      maximumError = std::max(maximumError, std::abs(track->GetSample(1, index) + expected));
+    }
+    EXPECT_LT(maximumError, 0.001f);
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  TEST(ResamplerTests, DownsamplingRemovesFrequenciesAboveNyquist) {
+    using Nuclex::Support::Events::Delegate;
+    using Nuclex::Support::Threading::StopSource;
+
+    // 30 kHz is fine at 96 kHz but would alias to 18 kHz at 48 kHz
+    std::shared_ptr<Track> track = makeSineTrack(96000, 96000, 30000.0);
+    Delegate<void(float)> progressCallback = Delegate<void(float)>::Create<&doNothing>();
+    Resampler::Resample(track, 48000, StopSource::Create()->GetToken(), progressCallback);
+
+    ASSERT_EQ(track->CountFrames(), 48000U);
+
+    float maximumAmplitude = 0.0f;
+    for(std::size_t index = 1000; index < 47000; ++index) {
+      maximumAmplitude = std::max(maximumAmplitude, std::abs(track->GetSample(0, index)));
+    }
+    EXPECT_LT(maximumAmplitude, 0.0005f);
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  TEST(ResamplerTests, ParallelResamplingMatchesSequentialResampling) {
+    using Nuclex::Support::Events::Delegate;
+    using Nuclex::Support::Threading::StopSource;
+    using Nuclex::Support::Threading::ThreadPool;
+
+    std::shared_ptr<Track> sequential = makeSineTrack(88200, 300007, 4321.0);
+    std::shared_ptr<Track> parallel = makeSineTrack(88200, 300007, 4321.0);
+
+    Delegate<void(float)> progressCallback = Delegate<void(float)>::Create<&doNothing>();
+    Resampler::Resample(sequential, 48000, StopSource::Create()->GetToken(), progressCallback);
+    {
+      ThreadPool threadPool;
+      Resampler::Resample(
+        parallel, 48000, threadPool, StopSource::Create()->GetToken(), progressCallback
+      );
+    }
+
+    ASSERT_EQ(parallel->CountFrames(), sequential->CountFrames());
+    for(std::size_t channelIndex = 0; channelIndex < 2; ++channelIndex) {
+      for(std::size_t index = 0; index < sequential->CountFrames(); ++index) {
+        ASSERT_EQ(
+          parallel->GetSample(channelIndex, index), sequential->GetSample(channelIndex, index)
+        );
+      }
+    }
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+} // namespace Nuclex::OpusTranscoder::Audio
@@ -0,0 +1,131 @@
+#pragma region Apache License 2.0
+/*
+Nuclex Opus Transcoder
+Copyright (C) 2024 Markus Ewald / Nuclex Development Labs
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#pragma endregion // Apache License 2.0
+
+// If the library is compiled as a DLL, this ensures symbols are exported
+#define NUCLEX_OPUSTRANSCODER_SOURCE 1
+
+#include "../../Source/Config.h"
+#include "../../Source/Audio/SampleBuffer.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdint> // for std::uintptr_t
+
+namespace Nuclex::OpusTranscoder::Audio {
+
+  // ------------------------------------------------------------------------------------------- //
+
+  TEST(SampleBufferTests, SmallBuffersAreCacheLineAligned) {
+    for(std::size_t sampleCount = 1; sampleCount < 100; sampleCount += 7) {
+      SampleBuffer samples(sampleCount);
+      std::uintptr_t address = reinterpret_cast<std::uintptr_t>(samples.data());
+      EXPECT_EQ(address % SampleMemory::Alignment, 0U);
+    }
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  TEST(SampleBufferTests, LargeBuffersAreCacheLineAligned) {
+    bool wereHugePagesEnabled = SampleMemory::AreHugePagesEnabled();
+
+    SampleMemory::EnableHugePages(false);
+    {
+      SampleBuffer samples(SampleMemory::HugePageSize + 3);
+      std::uintptr_t address = reinterpret_cast<std::uintptr_t>(samples.data());
+      EXPECT_EQ(address % SampleMemory::Alignment, 0U);
+    }
+
+    SampleMemory::EnableHugePages(true);
+    {
+      SampleBuffer samples(SampleMemory::HugePageSize + 3);
+      std::uintptr_t address = reinterpret_cast<std::uintptr_t>(samples.data());
+      EXPECT_EQ(address % SampleMemory::Alignment, 0U);
+    }
+
+    SampleMemory::EnableHugePages(wereHugePagesEnabled);
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  TEST(SampleBufferTests, GrowingKeepsExistingSamples) {
+    SampleBuffer samples = { 0.25f, -0.5f, 0.75f };
+    samples.resize(1000);
+    samples.resize(2000, 1.5f);
+
+    EXPECT_EQ(samples[0], 0.25f);
+    EXPECT_EQ(samples[1], -0.5f);
+    EXPECT_EQ(samples[2], 0.75f);
+    EXPECT_EQ(samples[1000], 1.5f);
+    EXPECT_EQ(samples[1999], 1.5f);
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  TEST(SampleBufferTests, LargeBuffersCanBePlacedInScratchFiles) {
+    std::size_t previousThreshold = SampleMemory::GetScratchThreshold();
+
+    SampleMemory::SetScratchThreshold(1024 * 1024);
+    {
+      SampleBuffer smallSamples(1000);
+      EXPECT_FALSE(SampleMemory::IsInScratchFile(smallSamples.data()));
+
+      SampleBuffer largeSamples(1024 * 1024, 0.5f);
+      EXPECT_TRUE(SampleMemory::IsInScratchFile(largeSamples.data()));
+
+      std::uintptr_t address = reinterpret_cast<std::uintptr_t>(largeSamples.data());
+      EXPECT_EQ(address % SampleMemory::Alignment, 0U);
+
+      largeSamples[12345] = -0.25f;
+      SampleMemory::Advise(
+        largeSamples.data(), largeSamples.size() * sizeof(float),
+        SampleAccessPattern::Sequential
+      );
+      EXPECT_EQ(largeSamples[0], 0.5f);
+      EXPECT_EQ(largeSamples[12345], -0.25f);
+      EXPECT_EQ(largeSamples[1024 * 1024 - 1], 0.5f);
+    }
+
+    SampleMemory::SetScratchThreshold(previousThreshold);
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  TEST(SampleBufferTests, PeakMeasurementsSeeLargestAllocation) {
+    std::size_t baseByteCount = SampleMemory::GetAllocatedByteCount();
+    std::size_t outerMeasurement = SampleMemory::BeginPeakMeasurement();
+    {
+      SampleBuffer samples(1000);
+      EXPECT_EQ(SampleMemory::GetAllocatedByteCount(), baseByteCount + 1000 * sizeof(float));
+    }
+
+    std::size_t innerMeasurement = SampleMemory::BeginPeakMeasurement();
+    {
+      SampleBuffer samples(100);
+    }
+    EXPECT_EQ(SampleMemory::GetAllocatedByteCount(), baseByteCount);
+
+    std::size_t innerPeak = SampleMemory::EndPeakMeasurement(innerMeasurement);
+    std::size_t outerPeak = SampleMemory::EndPeakMeasurement(outerMeasurement);
+    EXPECT_EQ(innerPeak, baseByteCount + 100 * sizeof(float));
+    EXPECT_EQ(outerPeak, baseByteCount + 1000 * sizeof(float));
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+} // namespace Nuclex::OpusTranscoder::Audio
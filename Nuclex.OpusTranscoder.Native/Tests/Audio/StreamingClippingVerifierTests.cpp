@@ -0,0 +1,269 @@
+#pragma region Apache License 2.0
+/*
+Nuclex Opus Transcoder
+Copyright (C) 2024 Markus Ewald / Nuclex Development Labs
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#pragma endregion // Apache License 2.0
+
+// If the library is compiled as a DLL, this ensures symbols are exported
+#define NUCLEX_OPUSTRANSCODER_SOURCE 1
+
+#include "../../Source/Config.h"
+#include "../../Source/Audio/StreamingClippingVerifier.h"
+#include "../../Source/Audio/Track.h"
+#include "../../Source/Audio/ClippingDetector.h"
+
+#include <Nuclex/Support/Threading/StopSource.h>
+
+#include <gtest/gtest.h>
+
+#include <cmath> // for std::sin()
+#include <algorithm> // for std::min()
+
+namespace {
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Does absolutely nothing</summary>
+  void doNothing(float) {}
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Creates a stereo track with a few seconds of partially clipping audio</summary>
+  /// <param name="frameCount">Number of frames the track should have</param>
+  /// <returns>The new stereo track</returns>
+  std::shared_ptr<Nuclex::OpusTranscoder::Audio::Track> makeClippingStereoTrack(
+    std::size_t frameCount
+  ) {
+    using Nuclex::OpusTranscoder::Audio::Track;
+    std::shared_ptr<Track> track = std::make_shared<Track>();
+
+    track->Channels.resize(2);
+    track->Channels[0].InputOrder = 0;
+    track->Channels[0].Placement = Nuclex::Audio::ChannelPlacement::FrontLeft;
+    track->Channels[1].InputOrder = 1;
+    track->Channels[1].Placement = Nuclex::Audio::ChannelPlacement::FrontRight;
+
+    // Two sine waves of different frequency whose amplitude swells above
+    // the signal ceiling every now and then
+    track->Samples.resize(frameCount * 2);
+    for(std::size_t index = 0; index < frameCount; ++index) {
+      float swell = 0.8f + 0.5f * std::sin(static_cast<float>(index) * 0.001f);
+      track->Samples[index * 2] = swell * std::sin(static_cast<float>(index) * 0.05f);
+      track->Samples[index * 2 + 1] = swell * std::sin(static_cast<float>(index) * 0.013f);
+    }
+
+    return track;
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Simulates the changes a lossy codec might make to a track</summary>
+  /// <param name="track">Track whose samples will be altered</param>
+  /// <returns>A track with the altered samples</returns>
+  std::shared_ptr<Nuclex::OpusTranscoder::Audio::Track> makeDecodedTrack(
+    const std::shared_ptr<Nuclex::OpusTranscoder::Audio::Track> &track
+  ) {
+    using Nuclex::OpusTranscoder::Audio::Track;
+    std::shared_ptr<Track> decodedTrack = std::make_shared<Track>();
+
+    decodedTrack->Channels.resize(track->Channels.size());
+    decodedTrack->SampleRate = track->SampleRate;
+    decodedTrack->Samples.resize(track->Samples.size());
+    for(std::size_t index = 0; index < track->Samples.size(); ++index) {
+      float ripple = 0.05f * std::sin(static_cast<float>(index) * 0.7f);
+      decodedTrack->Samples[index] = track->Samples[index] * 0.9f + ripple;
+    }
+
+    return decodedTrack;
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Feeds a decoded track through a streaming clipping verifier</summary>
+  /// <param name="track">Track in which the verifier will update the half-waves</param>
+  /// <param name="decodedTrack">Decoded track that will be fed to the verifier</param>
+  /// <param name="unmeasuredRangeCount">Receives the number of unmeasured ranges</param>
+  /// <returns>The number of half-waves that are still clipping</returns>
+  std::size_t verifyInChunks(
+    const std::shared_ptr<Nuclex::OpusTranscoder::Audio::Track> &track,
+    const std::shared_ptr<Nuclex::OpusTranscoder::Audio::Track> &decodedTrack,
+    std::size_t &unmeasuredRangeCount
+  ) {
+    using Nuclex::OpusTranscoder::Audio::StreamingClippingVerifier;
+
+    std::size_t channelCount = track->Channels.size();
+    std::size_t frameCount = decodedTrack->Samples.size() / channelCount;
+
+    StreamingClippingVerifier verifier(track);
+    verifier.BeginRange(0);
+    std::size_t frameIndex = 0;
+    while(frameIndex < frameCount) {
+      std::size_t chunkSize = std::min<std::size_t>(333, frameCount - frameIndex);
+      verifier.Feed(decodedTrack->Samples.data() + frameIndex * channelCount, chunkSize);
+      frameIndex += chunkSize;
+    }
+    verifier.EndRange();
+
+    verifier.Integrate();
+
+    std::vector<std::pair<std::uint64_t, std::uint64_t>> unmeasuredRanges = (
+      verifier.GetUnmeasuredRanges()
+    );
+    unmeasuredRangeCount = unmeasuredRanges.size();
+    for(std::size_t index = 0; index < unmeasuredRanges.size(); ++index) {
+      verifier.MeasureRange(
+        unmeasuredRanges[index].first,
+        decodedTrack->Samples.data() + unmeasuredRanges[index].first * channelCount,
+        unmeasuredRanges[index].second - unmeasuredRanges[index].first
+      );
+    }
+
+    return verifier.Update();
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Checks that two tracks have identical clipping half-waves</summary>
+  /// <param name="expected">Track with the expected clipping half-waves</param>
+  /// <param name="actual">Track with the actual clipping half-waves</param>
+  void expectIdenticalHalfwaves(
+    const std::shared_ptr<Nuclex::OpusTranscoder::Audio::Track> &expected,
+    const std::shared_ptr<Nuclex::OpusTranscoder::Audio::Track> &actual
+  ) {
+    using Nuclex::OpusTranscoder::Audio::ClippingHalfwaveTable;
+
+    for(std::size_t channelIndex = 0; channelIndex < expected->Channels.size(); ++channelIndex) {
+      const ClippingHalfwaveTable &expectedHalfwaves = (
+        expected->Channels[channelIndex].ClippingHalfwaves
+      );
+      const ClippingHalfwaveTable &actualHalfwaves = (
+        actual->Channels[channelIndex].ClippingHalfwaves
+      );
+
+      ASSERT_EQ(expectedHalfwaves.size(), actualHalfwaves.size());
+      for(std::size_t index = 0; index < expectedHalfwaves.size(); ++index) {
+        EXPECT_EQ(
+          expectedHalfwaves[index].PriorZeroCrossingIndex,
+          actualHalfwaves[index].PriorZeroCrossingIndex
+        );
+        EXPECT_EQ(
+          expectedHalfwaves[index].NextZeroCrossingIndex,
+          actualHalfwaves[index].NextZeroCrossingIndex
+        );
+        EXPECT_EQ(expectedHalfwaves[index].PeakIndex, actualHalfwaves[index].PeakIndex);
+        EXPECT_EQ(expectedHalfwaves[index].PeakAmplitude, actualHalfwaves[index].PeakAmplitude);
+        EXPECT_EQ(
+          expectedHalfwaves[index].IneffectiveIterationCount,
+          actualHalfwaves[index].IneffectiveIterationCount
+        );
+      }
+    }
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+} // anonymous namespace
+
+namespace Nuclex::OpusTranscoder::Audio {
+
+  // ------------------------------------------------------------------------------------------- //
+
+  TEST(StreamingClippingVerifierTests, MatchesWholeTrackVerification) {
+    using Nuclex::Support::Events::Delegate;
+    using Nuclex::Support::Threading::StopSource;
+
+    std::shared_ptr<Track> track = makeClippingStereoTrack(20000);
+    Delegate<void(float)> progressCallback = (
+      Delegate<void(float)>::Create<&doNothing>()
+    );
+    ClippingDetector::FindClippingHalfwaves(
+      track, StopSource::Create()->GetToken(), progressCallback
+    );
+
+    std::shared_ptr<Track> decodedTrack = makeDecodedTrack(track);
+
+    // Do it the old way, with the fully decoded track
+    std::shared_ptr<Track> expectedTrack = std::make_shared<Track>(*track);
+    std::size_t expectedCount;
+    {
+      std::shared_ptr<Track> scannedTrack = std::make_shared<Track>(*decodedTrack);
+      ClippingDetector::FindClippingHalfwaves(
+        scannedTrack, StopSource::Create()->GetToken(), progressCallback
+      );
+      ClippingDetector::Integrate(expectedTrack, scannedTrack);
+      expectedCount = ClippingDetector::Update(
+        expectedTrack, scannedTrack->Samples, StopSource::Create()->GetToken(), progressCallback
+      );
+    }
+    ASSERT_LT(0U, expectedCount);
+
+    std::size_t unmeasuredRangeCount;
+    std::size_t actualCount = verifyInChunks(track, decodedTrack, unmeasuredRangeCount);
+
+    EXPECT_EQ(unmeasuredRangeCount, 0U);
+    EXPECT_EQ(actualCount, expectedCount);
+    expectIdenticalHalfwaves(expectedTrack, track);
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  TEST(StreamingClippingVerifierTests, ReportsHalfwavesLongerThanHistory) {
+    using Nuclex::Support::Events::Delegate;
+    using Nuclex::Support::Threading::StopSource;
+
+    const std::size_t frameCount = StreamingClippingVerifier::HistoryFrameCount * 2;
+    std::shared_ptr<Track> track = makeClippingStereoTrack(frameCount);
+
+    // Put a long stretch of DC offset into the right channel that the decoded track
+    // will overshoot somewhere in the middle
+    for(std::size_t index = 1000; index < frameCount - 1000; ++index) {
+      track->Samples[index * 2 + 1] = 0.5f;
+    }
+
+    Delegate<void(float)> progressCallback = (
+      Delegate<void(float)>::Create<&doNothing>()
+    );
+    ClippingDetector::FindClippingHalfwaves(
+      track, StopSource::Create()->GetToken(), progressCallback
+    );
+
+    std::shared_ptr<Track> decodedTrack = makeDecodedTrack(track);
+    decodedTrack->Samples[(frameCount / 2) * 2 + 1] = 1.5f;
+
+    std::shared_ptr<Track> expectedTrack = std::make_shared<Track>(*track);
+    std::size_t expectedCount;
+    {
+      std::shared_ptr<Track> scannedTrack = std::make_shared<Track>(*decodedTrack);
+      ClippingDetector::FindClippingHalfwaves(
+        scannedTrack, StopSource::Create()->GetToken(), progressCallback
+      );
+      ClippingDetector::Integrate(expectedTrack, scannedTrack);
+      expectedCount = ClippingDetector::Update(
+        expectedTrack, scannedTrack->Samples, StopSource::Create()->GetToken(), progressCallback
+      );
+    }
+
+    std::size_t unmeasuredRangeCount;
+    std::size_t actualCount = verifyInChunks(track, decodedTrack, unmeasuredRangeCount);
+
+    EXPECT_EQ(unmeasuredRangeCount, 1U);
+    EXPECT_EQ(actualCount, expectedCount);
+    expectIdenticalHalfwaves(expectedTrack, track);
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+} // namespace Nuclex::OpusTranscoder::Audio
@@ -0,0 +1,159 @@
+#pragma region Apache License 2.0
+/*
+Nuclex Opus Transcoder
+Copyright (C) 2024 Markus Ewald / Nuclex Development Labs
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#pragma endregion // Apache License 2.0
+
+// If the library is compiled as a DLL, this ensures symbols are exported
+#define NUCLEX_OPUSTRANSCODER_SOURCE 1
+
+#include "../../Source/Config.h"
+#include "../../Source/Audio/StreamingDeclipper.h"
+#include "../../Source/Audio/Track.h"
+#include "../../Source/Audio/ClippingDetector.h"
+#include "../../Source/Audio/HalfwaveTucker.h"
+
+#include <Nuclex/Support/Threading/StopSource.h>
+
+#include <gtest/gtest.h>
+
+#include <cmath> // for std::sin()
+#include <algorithm> // for std::min()
+
+namespace {
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Does absolutely nothing</summary>
+  void doNothing(float) {}
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Creates a stereo track with a few seconds of partially clipping audio</summary>
+  /// <param name="frameCount">Number of frames the track should have</param>
+  /// <returns>The new stereo track</returns>
+  std::shared_ptr<Nuclex::OpusTranscoder::Audio::Track> makeClippingStereoTrack(
+    std::size_t frameCount
+  ) {
+    using Nuclex::OpusTranscoder::Audio::Track;
+    std::shared_ptr<Track> track = std::make_shared<Track>();
+
+    track->Channels.resize(2);
+    track->Channels[0].InputOrder = 0;
+    track->Channels[0].Placement = Nuclex::Audio::ChannelPlacement::FrontLeft;
+    track->Channels[1].InputOrder = 1;
+    track->Channels[1].Placement = Nuclex::Audio::ChannelPlacement::FrontRight;
+
+    // Two sine waves of different frequency whose amplitude swells above
+    // the signal ceiling every now and then
+    track->Samples.resize(frameCount * 2);
+    for(std::size_t index = 0; index < frameCount; ++index) {
+      float swell = 0.8f + 0.5f * std::sin(static_cast<float>(index) * 0.001f);
+      track->Samples[index * 2] = swell * std::sin(static_cast<float>(index) * 0.05f);
+      track->Samples[index * 2 + 1] = swell * std::sin(static_cast<float>(index) * 0.013f);
+    }
+
+    return track;
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+} // anonymous namespace
+
+namespace Nuclex::OpusTranscoder::Audio {
+
+  // ------------------------------------------------------------------------------------------- //
+
+  TEST(StreamingDeclipperTests, HoldsBackFramesOfOngoingHalfwave) {
+    StreamingDeclipper declipper(1);
+
+    float samples[] = { 0.5f, -0.5f, -1.5f, -0.5f };
+    declipper.Feed(samples, 4);
+
+    // The half-wave starting at index 1 is still ongoing and clipping,
+    // so only the first frame can be handed out
+    ASSERT_EQ(declipper.CountCompletedFrames(), 1U);
+    EXPECT_EQ(declipper.GetCompletedFrames()[0], 0.5f);
+    declipper.DiscardCompletedFrames();
+
+    float moreSamples[] = { 0.5f };
+    declipper.Feed(moreSamples, 1);
+
+    // With the zero crossing, the half-wave is complete and got tucked in
+    ASSERT_EQ(declipper.CountCompletedFrames(), 3U);
+    EXPECT_LT(declipper.GetCompletedFrames()[1], 0.0f);
+    EXPECT_GE(declipper.GetCompletedFrames()[1], -1.0f);
+
+    declipper.Finish();
+    EXPECT_EQ(declipper.CountCompletedFrames(), 4U);
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  TEST(StreamingDeclipperTests, MatchesWholeTrackDeclipping) {
+    using Nuclex::Support::Events::Delegate;
+    using Nuclex::Support::Threading::StopSource;
+
+    const std::size_t frameCount = 20000;
+    std::shared_ptr<Track> track = makeClippingStereoTrack(frameCount);
+    SampleBuffer originalSamples = track->Samples;
+
+    Delegate<void(float)> progressCallback = (
+      Delegate<void(float)>::Create<&doNothing>()
+    );
+    ClippingDetector::FindClippingHalfwaves(
+      track, StopSource::Create()->GetToken(), progressCallback
+    );
+    ASSERT_LT(0U, track->Channels[0].ClippingHalfwaves.size());
+    HalfwaveTucker::TuckClippingHalfwaves(
+      track, StopSource::Create()->GetToken(), progressCallback
+    );
+
+    // Feed the same samples in awkwardly sized chunks and collect the results
+    std::vector<float> streamedSamples;
+    {
+      StreamingDeclipper declipper(2);
+
+      std::size_t frameIndex = 0;
+      while(frameIndex < frameCount) {
+        std::size_t chunkSize = std::min<std::size_t>(333, frameCount - frameIndex);
+        declipper.Feed(originalSamples.data() + frameIndex * 2, chunkSize);
+        streamedSamples.insert(
+          streamedSamples.end(),
+          declipper.GetCompletedFrames(),
+          declipper.GetCompletedFrames() + declipper.CountCompletedFrames() * 2
+        );
+        declipper.DiscardCompletedFrames();
+        frameIndex += chunkSize;
+      }
+
+      declipper.Finish();
+      streamedSamples.insert(
+        streamedSamples.end(),
+        declipper.GetCompletedFrames(),
+        declipper.GetCompletedFrames() + declipper.CountCompletedFrames() * 2
+      );
+    }
+
+    ASSERT_EQ(streamedSamples.size(), track->Samples.size());
+    for(std::size_t index = 0; index < streamedSamples.size(); ++index) {
+      EXPECT_EQ(streamedSamples[index], track->Samples[index]);
+    }
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+} // namespace Nuclex::OpusTranscoder::Audio
@@ -0,0 +1,189 @@
+#pragma region Apache License 2.0
+/*
+Nuclex Opus Transcoder
+Copyright (C) 2024 Markus Ewald / Nuclex Development Labs
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#pragma endregion // Apache License 2.0
+
+// If the library is compiled as a DLL, this ensures symbols are exported
+#define NUCLEX_OPUSTRANSCODER_SOURCE 1
+
+#include "../../Source/Config.h"
+#include "../../Source/Audio/TrackStatistics.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm> // for std::min()
+#include <vector> // for std::vector
+
+namespace Nuclex::OpusTranscoder::Audio {
+
+  // ------------------------------------------------------------------------------------------- //
+
+  TEST(TrackStatisticsTests, NewStatisticsCoverNothing) {
+    TrackStatistics statistics;
+    EXPECT_FALSE(statistics.Covers(2, 0));
+    EXPECT_FALSE(statistics.Covers(2, 1000));
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  TEST(TrackStatisticsTests, TracksAbsolutePeakOfEachChannel) {
+    std::vector<float> samples = {
+      0.25f, -0.5f,
+      -0.75f, 0.125f,
+      0.5f, 0.25f
+    };
+
+    TrackStatistics statistics;
+    statistics.Reset(2, 3);
+    statistics.Accumulate(samples.data(), 0, 3);
+
+    EXPECT_TRUE(statistics.Covers(2, 3));
+    EXPECT_EQ(statistics.GetPeakAmplitude(0), 0.75f);
+    EXPECT_EQ(statistics.GetPeakAmplitude(1), 0.5f);
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  TEST(TrackStatisticsTests, ReportsPeakOfBassChannel) {
+    std::vector<float> samples = {
+      0.25f, -0.5f,
+      -0.75f, 0.125f
+    };
+
+    TrackStatistics statistics;
+    statistics.Reset(2, 2);
+    EXPECT_EQ(statistics.GetBassChannelIndex(), TrackStatistics::NoBassChannel);
+
+    statistics.SetBassChannel(1);
+    statistics.Accumulate(samples.data(), 0, 2);
+    EXPECT_EQ(statistics.GetBassChannelIndex(), 1U);
+    EXPECT_EQ(statistics.GetBassPeakAmplitude(), 0.5f);
+
+    statistics.Reset(2, 2);
+    EXPECT_EQ(statistics.GetBassChannelIndex(), TrackStatistics::NoBassChannel);
+    EXPECT_EQ(statistics.GetBassPeakAmplitude(), 0.0f);
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  TEST(TrackStatisticsTests, CalculatesRootMeanSquare) {
+    std::vector<float> samples = { 0.5f, -0.5f, 0.5f, -0.5f };
+
+    TrackStatistics statistics;
+    statistics.Reset(1, 4);
+    statistics.Accumulate(samples.data(), 0, 4);
+
+    EXPECT_FLOAT_EQ(statistics.GetRootMeanSquare(0), 0.5f);
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  TEST(TrackStatisticsTests, CoversTrackOnlyWhenAllFramesWereAdded) {
+    std::size_t frameCount = TrackStatistics::FramesPerBlock * 3;
+    std::vector<float> samples(frameCount, 0.0f);
+
+    TrackStatistics statistics;
+    statistics.Reset(1, frameCount);
+    statistics.Accumulate(samples.data(), 0, 100);
+    EXPECT_FALSE(statistics.Covers(1, frameCount));
+
+    statistics.Accumulate(samples.data() + 100, 100, frameCount - 100);
+    EXPECT_TRUE(statistics.Covers(1, frameCount));
+    EXPECT_FALSE(statistics.Covers(2, frameCount));
+    EXPECT_FALSE(statistics.Covers(1, frameCount + 1));
+
+    statistics.Clear();
+    EXPECT_FALSE(statistics.Covers(1, frameCount));
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  TEST(TrackStatisticsTests, MarksClippingBlocksAcrossSplitRanges) {
+    const std::size_t blockSize = TrackStatistics::FramesPerBlock;
+    std::size_t frameCount = blockSize * 70; // more than one 64 bit word in the bitmap
+    std::vector<float> samples(frameCount * 2, 0.5f);
+
+    samples[(blockSize + 10) * 2 + 1] = -1.5f; // second block, right channel
+    samples[(blockSize * 66 + 3) * 2] = 1.01f; // in the second bitmap word
+
+    // Add the samples in odd-sized ranges that don't line up with the blocks
+    TrackStatistics statistics;
+    statistics.Reset(2, frameCount);
+    for(std::size_t frameIndex = 0; frameIndex < frameCount; frameIndex += 777) {
+      std::size_t rangeFrameCount = std::min<std::size_t>(777, frameCount - frameIndex);
+      statistics.Accumulate(samples.data() + frameIndex * 2, frameIndex, rangeFrameCount);
+    }
+
+    ASSERT_TRUE(statistics.Covers(2, frameCount));
+    EXPECT_EQ(statistics.GetPeakAmplitude(0), 1.01f);
+    EXPECT_EQ(statistics.GetPeakAmplitude(1), 1.5f);
+
+    EXPECT_FALSE(statistics.MayContainClipping(0, blockSize));
+    EXPECT_TRUE(statistics.MayContainClipping(blockSize, blockSize * 2));
+    EXPECT_TRUE(statistics.MayContainClipping(0, blockSize + 1));
+    EXPECT_FALSE(statistics.MayContainClipping(blockSize * 2, blockSize * 66));
+    EXPECT_TRUE(statistics.MayContainClipping(blockSize * 66, blockSize * 67));
+    EXPECT_FALSE(statistics.MayContainClipping(blockSize * 67, frameCount));
+    EXPECT_FALSE(statistics.MayContainClipping(blockSize, blockSize));
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  TEST(TrackStatisticsTests, PlanarAccumulationMatchesInterleaved) {
+    std::size_t frameCount = TrackStatistics::FramesPerBlock * 5 + 3;
+    std::vector<float> left(frameCount), right(frameCount), interleaved(frameCount * 2);
+    for(std::size_t index = 0; index < frameCount; ++index) {
+      left[index] = static_cast<float>(index % 97) / 100.0f;
+      right[index] = -static_cast<float>(index % 89) / 80.0f; // clips in places
+      interleaved[index * 2] = left[index];
+      interleaved[index * 2 + 1] = right[index];
+    }
+
+    TrackStatistics expected;
+    expected.Reset(2, frameCount);
+    expected.Accumulate(interleaved.data(), 0, frameCount);
+
+    TrackStatistics actual;
+    actual.Reset(2, frameCount);
+    for(std::size_t frameIndex = 0; frameIndex < frameCount; frameIndex += 700) {
+      std::size_t rangeFrameCount = std::min<std::size_t>(700, frameCount - frameIndex);
+      const float *planes[2] = { left.data() + frameIndex, right.data() + frameIndex };
+      actual.AccumulatePlanar(planes, frameIndex, rangeFrameCount);
+    }
+
+    ASSERT_TRUE(actual.Covers(2, frameCount));
+    for(std::size_t channelIndex = 0; channelIndex < 2; ++channelIndex) {
+      EXPECT_EQ(actual.GetPeakAmplitude(channelIndex), expected.GetPeakAmplitude(channelIndex));
+      EXPECT_FLOAT_EQ(
+        actual.GetRootMeanSquare(channelIndex), expected.GetRootMeanSquare(channelIndex)
+      );
+    }
+    for(std::size_t blockIndex = 0; blockIndex < 6; ++blockIndex) {
+      std::uint64_t startIndex = blockIndex * TrackStatistics::FramesPerBlock;
+      std::uint64_t endIndex = std::min<std::uint64_t>(
+        startIndex + TrackStatistics::FramesPerBlock, frameCount
+      );
+      EXPECT_EQ(
+        actual.MayContainClipping(startIndex, endIndex),
+        expected.MayContainClipping(startIndex, endIndex)
+      );
+    }
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+} // namespace Nuclex::OpusTranscoder::Audio
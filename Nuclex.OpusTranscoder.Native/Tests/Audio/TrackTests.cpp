@@ -0,0 +1,130 @@
+#pragma region Apache License 2.0
+/*
+Nuclex Opus Transcoder
+Copyright (C) 2024 Markus Ewald / Nuclex Development Labs
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#pragma endregion // Apache License 2.0
+
+// If the library is compiled as a DLL, this ensures symbols are exported
+#define NUCLEX_OPUSTRANSCODER_SOURCE 1
+
+#include "../../Source/Config.h"
+#include "../../Source/Audio/Track.h"
+
+#include <gtest/gtest.h>
+
+namespace {
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Creates an interleaved track with a recognizable value in each sample</summary>
+  /// <param name="channelCount">Number of channels the track will have</param>
+  /// <param name="frameCount">Number of frames that will be stored in the track</param>
+  /// <returns>The new interleaved track</returns>
+  std::shared_ptr<Nuclex::OpusTranscoder::Audio::Track> makeNumberedTrack(
+    std::size_t channelCount, std::size_t frameCount
+  ) {
+    using Nuclex::OpusTranscoder::Audio::Track;
+    std::shared_ptr<Track> track = std::make_shared<Track>();
+
+    track->Channels.resize(channelCount);
+    track->Samples.resize(channelCount * frameCount);
+    for(std::size_t index = 0; index < track->Samples.size(); ++index) {
+      track->Samples[index] = static_cast<float>(index);
+    }
+
+    return track;
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+} // anonymous namespace
+
+namespace Nuclex::OpusTranscoder::Audio {
+
+  // ------------------------------------------------------------------------------------------- //
+
+  TEST(TrackTests, NewTrackIsEmptyAndInterleaved) {
+    Track track;
+    EXPECT_FALSE(track.IsPlanar);
+    EXPECT_EQ(track.CountFrames(), 0U);
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  TEST(TrackTests, CanConvertToPlanarLayout) {
+    std::shared_ptr<Track> track = makeNumberedTrack(3, 2500);
+    track->ConvertToPlanar();
+
+    ASSERT_TRUE(track->IsPlanar);
+    EXPECT_TRUE(track->Samples.empty());
+    ASSERT_EQ(track->CountFrames(), 2500U);
+    EXPECT_EQ(track->GetSampleStride(), 1U);
+
+    for(std::size_t channelIndex = 0; channelIndex < 3; ++channelIndex) {
+      const float *samples = track->GetChannelSamples(channelIndex);
+      for(std::size_t index = 0; index < 2500; ++index) {
+        EXPECT_EQ(samples[index], static_cast<float>(index * 3 + channelIndex));
+      }
+    }
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  TEST(TrackTests, ConversionRoundTripRestoresSamples) {
+    std::shared_ptr<Track> track = makeNumberedTrack(6, 3001);
+    SampleBuffer original = track->Samples;
+
+    track->ConvertToPlanar();
+    track->ConvertToInterleaved();
+
+    EXPECT_FALSE(track->IsPlanar);
+    EXPECT_TRUE(track->Channels[0].Samples.empty());
+    ASSERT_EQ(track->Samples.size(), original.size());
+    for(std::size_t index = 0; index < original.size(); ++index) {
+      EXPECT_EQ(track->Samples[index], original[index]);
+    }
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  TEST(TrackTests, CanInterleaveRangeOfFrames) {
+    std::shared_ptr<Track> track = makeNumberedTrack(2, 5000);
+    track->ConvertToPlanar();
+
+    std::vector<float> interleaved(2 * 1500);
+    track->InterleaveFrames(1234, 1500, interleaved.data());
+
+    for(std::size_t index = 0; index < interleaved.size(); ++index) {
+      EXPECT_EQ(interleaved[index], static_cast<float>(1234 * 2 + index));
+    }
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  TEST(TrackTests, SampleAccessWorksInBothLayouts) {
+    std::shared_ptr<Track> track = makeNumberedTrack(4, 100);
+    float interleavedSample = track->GetChannelSamples(2)[37 * track->GetSampleStride()];
+
+    track->ConvertToPlanar();
+    float planarSample = track->GetChannelSamples(2)[37 * track->GetSampleStride()];
+
+    EXPECT_EQ(interleavedSample, planarSample);
+    EXPECT_EQ(planarSample, static_cast<float>(37 * 4 + 2));
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+} // namespace Nuclex::OpusTranscoder::Audio
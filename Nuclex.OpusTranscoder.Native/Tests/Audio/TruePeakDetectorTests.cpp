@@ -0,0 +1,233 @@
+#pragma region Apache License 2.0
+/*
+Nuclex Opus Transcoder
+Copyright (C) 2024 Markus Ewald / Nuclex Development Labs
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#pragma endregion // Apache License 2.0
+
+// If the library is compiled as a DLL, this ensures symbols are exported
+#define NUCLEX_OPUSTRANSCODER_SOURCE 1
+
+#include "../../Source/Config.h"
+#include "../../Source/Audio/Track.h"
+#include "../../Source/Audio/TruePeakDetector.h"
+
+#include <Nuclex/Support/Threading/StopSource.h>
+#include <Nuclex/Support/Threading/ThreadPool.h>
+
+#include <gtest/gtest.h>
+
+#include <algorithm> // for std::copy_n()
+#include <cmath> // for std::sin()
+
+namespace {
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Does absolutely nothing</summary>
+  void doNothing(float) {}
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Creates a new stereo track without audio samples</summary>
+  /// <returns>The new stereo track</returns>
+  std::shared_ptr<Nuclex::OpusTranscoder::Audio::Track> makeStereoTrack() {
+    using Nuclex::OpusTranscoder::Audio::Track;
+    std::shared_ptr<Track> track = std::make_shared<Track>();
+
+    track->Channels.resize(2);
+    track->Channels[0].InputOrder = 0;
+    track->Channels[0].Placement = Nuclex::Audio::ChannelPlacement::FrontLeft;
+    track->Channels[1].InputOrder = 1;
+    track->Channels[1].Placement = Nuclex::Audio::ChannelPlacement::FrontRight;
+
+    return track;
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  /// <summary>Fills a stereo track with a sine wave at a quarter of the sample rate</summary>
+  /// <param name="track">Track that will be filled with the sine wave</param>
+  /// <param name="frameCount">Number of frames that will be generated</param>
+  /// <param name="amplitude">Amplitude of the sine wave on the left channel</param>
+  /// <remarks>
+  ///   The sine wave is shifted by 45 degrees, so every sample lands at 0.707 times
+  ///   the amplitude and the true peaks all lie halfway between two samples. The right
+  ///   channel stays silent.
+  /// </remarks>
+  void fillWithShiftedQuarterRateSine(
+    Nuclex::OpusTranscoder::Audio::Track &track, std::size_t frameCount, float amplitude
+  ) {
+    const double pi = 3.14159265358979323846;
+
+    track.Samples.resize(frameCount * 2, 0.0f);
+    for(std::size_t index = 0; index < frameCount; ++index) {
+      double angle = (pi / 2.0) * static_cast<double>(index) + (pi / 4.0);
+      track.Samples[index * 2] = static_cast<float>(std::sin(angle) * amplitude);
+    }
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+} // anonymous namespace
+
+namespace Nuclex::OpusTranscoder::Audio {
+
+  // ------------------------------------------------------------------------------------------- //
+
+  TEST(TruePeakDetectorTests, MeasuresInterSamplePeaks) {
+    std::shared_ptr<Track> track = makeStereoTrack();
+    fillWithShiftedQuarterRateSine(*track, 256, 1.0f);
+
+    // Samples lie at 0.707, but the peaks between them reach the full amplitude
+    float truePeak = TruePeakDetector::MeasureTruePeak(*track, 0, 128);
+    EXPECT_GT(truePeak, 0.97f);
+    EXPECT_LT(truePeak, 1.03f);
+
+    EXPECT_EQ(TruePeakDetector::MeasureTruePeak(*track, 1, 128), 0.0f);
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  TEST(TruePeakDetectorTests, FindsHalfwavesWithInterSamplePeaks) {
+    using Nuclex::Support::Events::Delegate;
+    using Nuclex::Support::Threading::StopSource;
+
+    std::shared_ptr<Track> track = makeStereoTrack();
+    fillWithShiftedQuarterRateSine(*track, 256, 1.25f);
+
+    Delegate<void(float)> progressCallback = (
+      Delegate<void(float)>::Create<&doNothing>()
+    );
+    TruePeakDetector::FindPredictedClippingHalfwaves(
+      track, 1.0f, StopSource::Create()->GetToken(), progressCallback
+    );
+
+    // None of the samples clip, but each half-wave, two samples long, does between them.
+    // The filter fades out near the ends, so only the inner half-waves are checked.
+    const ClippingHalfwaveTable &halfwaves = track->Channels[0].ClippingHalfwaves;
+    ASSERT_GT(halfwaves.size(), 100U);
+    for(std::size_t index = 0; index < halfwaves.size(); ++index) {
+      std::uint64_t startIndex = halfwaves.GetPriorZeroCrossingIndex(index);
+      EXPECT_EQ(startIndex % 2, 0U);
+      EXPECT_EQ(halfwaves.GetNextZeroCrossingIndex(index), startIndex + 2);
+      if((startIndex > 16) && (startIndex < 240)) {
+        EXPECT_GT(halfwaves.GetPeakAmplitude(index), 1.2f);
+      }
+    }
+
+    EXPECT_TRUE(track->Channels[1].ClippingHalfwaves.empty());
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  TEST(TruePeakDetectorTests, HeadroomPredictsClippingOfQuieterHalfwaves) {
+    using Nuclex::Support::Events::Delegate;
+    using Nuclex::Support::Threading::StopSource;
+
+    std::shared_ptr<Track> track = makeStereoTrack();
+    fillWithShiftedQuarterRateSine(*track, 256, 0.9f);
+
+    Delegate<void(float)> progressCallback = (
+      Delegate<void(float)>::Create<&doNothing>()
+    );
+    TruePeakDetector::FindPredictedClippingHalfwaves(
+      track, 1.0f, StopSource::Create()->GetToken(), progressCallback
+    );
+    EXPECT_TRUE(track->Channels[0].ClippingHalfwaves.empty());
+
+    // With the headroom, the expected overshoot of the codec pushes these over the edge
+    TruePeakDetector::FindPredictedClippingHalfwaves(
+      track, 1.25f, StopSource::Create()->GetToken(), progressCallback
+    );
+    EXPECT_GT(track->Channels[0].ClippingHalfwaves.size(), 100U);
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  TEST(TruePeakDetectorTests, OvershootShrinksWithBitrate) {
+    float lowBitrateOvershoot = TruePeakDetector::EstimateOpusOvershoot(48.0f, 2);
+    float mediumBitrateOvershoot = TruePeakDetector::EstimateOpusOvershoot(160.0f, 2);
+    float highBitrateOvershoot = TruePeakDetector::EstimateOpusOvershoot(512.0f, 2);
+
+    EXPECT_GT(lowBitrateOvershoot, mediumBitrateOvershoot);
+    EXPECT_GT(mediumBitrateOvershoot, highBitrateOvershoot);
+    EXPECT_GT(highBitrateOvershoot, 1.0f);
+
+    // The same bitrate spread over more channels leaves less for each channel
+    EXPECT_GT(
+      TruePeakDetector::EstimateOpusOvershoot(160.0f, 6),
+      TruePeakDetector::EstimateOpusOvershoot(160.0f, 2)
+    );
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  TEST(TruePeakDetectorTests, ParallelScanMatchesSerialScan) {
+    using Nuclex::Support::Events::Delegate;
+    using Nuclex::Support::Threading::StopSource;
+    using Nuclex::Support::Threading::ThreadPool;
+
+    std::shared_ptr<Track> serialTrack = makeStereoTrack();
+    std::shared_ptr<Track> parallelTrack = makeStereoTrack();
+    {
+      const std::size_t frameCount = 40000;
+      serialTrack->Samples.resize(frameCount * 2);
+      for(std::size_t index = 0; index < frameCount * 2; ++index) {
+        serialTrack->Samples[index] = static_cast<float>(
+          std::sin(static_cast<double>(index) * 0.0123) * 1.1 *
+          std::sin(static_cast<double>(index) * 0.00031)
+        );
+      }
+      parallelTrack->Samples.resize(frameCount * 2);
+      std::copy_n(serialTrack->Samples.data(), frameCount * 2, parallelTrack->Samples.data());
+    }
+
+    Delegate<void(float)> progressCallback = (
+      Delegate<void(float)>::Create<&doNothing>()
+    );
+    TruePeakDetector::FindPredictedClippingHalfwaves(
+      serialTrack, 1.05f, StopSource::Create()->GetToken(), progressCallback
+    );
+    {
+      ThreadPool threadPool;
+      TruePeakDetector::FindPredictedClippingHalfwaves(
+        parallelTrack, 1.05f, threadPool, StopSource::Create()->GetToken(), progressCallback
+      );
+    }
+
+    for(std::size_t channelIndex = 0; channelIndex < 2; ++channelIndex) {
+      const ClippingHalfwaveTable &serial = serialTrack->Channels[channelIndex].ClippingHalfwaves;
+      const ClippingHalfwaveTable &parallel = (
+        parallelTrack->Channels[channelIndex].ClippingHalfwaves
+      );
+
+      EXPECT_FALSE(serial.empty());
+      ASSERT_EQ(serial.size(), parallel.size());
+      for(std::size_t index = 0; index < serial.size(); ++index) {
+        EXPECT_EQ(
+          serial.GetPriorZeroCrossingIndex(index), parallel.GetPriorZeroCrossingIndex(index)
+        );
+        EXPECT_EQ(
+          serial.GetNextZeroCrossingIndex(index), parallel.GetNextZeroCrossingIndex(index)
+        );
+        EXPECT_EQ(serial.GetPeakAmplitude(index), parallel.GetPeakAmplitude(index));
+      }
+    }
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+} // namespace Nuclex::OpusTranscoder::Audio
@@ -0,0 +1,68 @@
+#pragma region Apache License 2.0
+/*
+Nuclex Opus Transcoder
+Copyright (C) 2024 Markus Ewald / Nuclex Development Labs
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#pragma endregion // Apache License 2.0
+
+// If the library is compiled as a DLL, this ensures symbols are exported
+#define NUCLEX_OPUSTRANSCODER_SOURCE 1
+
+#include "../../Source/Config.h"
+#include "../../Source/Audio/WordHash.h"
+
+#include <gtest/gtest.h>
+
+namespace Nuclex::OpusTranscoder::Audio {
+
+  // ------------------------------------------------------------------------------------------- //
+
+  TEST(WordHashTests, SampleHashDependsOnEverySample) {
+    float samples[] = { 0.1f, -0.5f, 0.25f, 1.5f };
+
+    std::uint64_t hash = WordHash::HashSamples(WordHash::InitialHash, samples, 4);
+
+    // Hashing in pieces gives the same hash as hashing everything at once
+    std::uint64_t pieceHash = WordHash::HashSamples(WordHash::InitialHash, samples, 1);
+    pieceHash = WordHash::HashSamples(pieceHash, samples + 1, 3);
+    EXPECT_EQ(pieceHash, hash);
+
+    samples[2] = 0.25000003f;
+    EXPECT_NE(WordHash::HashSamples(WordHash::InitialHash, samples, 4), hash);
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  TEST(WordHashTests, ByteHashCanBeSplitBetweenWords) {
+    std::byte bytes[19];
+    for(std::size_t index = 0; index < sizeof(bytes); ++index) {
+      bytes[index] = static_cast<std::byte>(index * 37);
+    }
+
+    std::uint64_t hash = WordHash::HashBytes(WordHash::InitialHash, bytes, sizeof(bytes));
+
+    // The trailing bytes that don't fill a whole word are hashed as well
+    std::uint64_t pieceHash = WordHash::HashBytes(WordHash::InitialHash, bytes, 16);
+    EXPECT_NE(pieceHash, hash);
+    pieceHash = WordHash::HashBytes(pieceHash, bytes + 16, 3);
+    EXPECT_EQ(pieceHash, hash);
+
+    bytes[17] = std::byte(0);
+    EXPECT_NE(WordHash::HashBytes(WordHash::InitialHash, bytes, sizeof(bytes)), hash);
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+} // namespace Nuclex::OpusTranscoder::Audio
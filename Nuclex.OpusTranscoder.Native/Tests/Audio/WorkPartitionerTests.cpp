@@ -0,0 +1,95 @@
+#pragma region Apache License 2.0
+/*
+Nuclex Opus Transcoder
+Copyright (C) 2024 Markus Ewald / Nuclex Development Labs
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#pragma endregion // Apache License 2.0
+
+// If the application is compiled as a DLL, this ensures symbols are exported
+#define NUCLEX_OPUSTRANSCODER_SOURCE 1
+
+#include "../../Source/Config.h"
+#include "../../Source/Audio/WorkPartitioner.h"
+
+#include <gtest/gtest.h>
+
+#include <thread> // for std::thread::hardware_concurrency()
+
+namespace Nuclex::OpusTranscoder::Audio {
+
+  // ------------------------------------------------------------------------------------------- //
+
+  TEST(WorkPartitionerTests, ParallelismDefaultsToCoreCount) {
+    WorkPartitioner::SetParallelism(0);
+
+    std::size_t coreCount = std::thread::hardware_concurrency();
+    if(coreCount == 0) {
+      coreCount = 1;
+    }
+
+    EXPECT_EQ(WorkPartitioner::GetParallelism(), coreCount);
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  TEST(WorkPartitionerTests, RangeCountFollowsParallelism) {
+    WorkPartitioner::SetParallelism(3);
+
+    std::size_t frameCount = WorkPartitioner::MinimumFramesPerRange * 10;
+    std::vector<std::size_t> boundaries = WorkPartitioner::SplitFrameRange(frameCount);
+
+    WorkPartitioner::SetParallelism(0);
+
+    ASSERT_EQ(boundaries.size(), 4U);
+    EXPECT_EQ(boundaries.front(), 0U);
+    EXPECT_EQ(boundaries.back(), frameCount);
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  TEST(WorkPartitionerTests, ShortTracksAreNotSplit) {
+    WorkPartitioner::SetParallelism(8);
+
+    std::size_t frameCount = WorkPartitioner::MinimumFramesPerRange - 1;
+    std::vector<std::size_t> boundaries = WorkPartitioner::SplitFrameRange(frameCount);
+
+    WorkPartitioner::SetParallelism(0);
+
+    ASSERT_EQ(boundaries.size(), 2U);
+    EXPECT_EQ(boundaries[0], 0U);
+    EXPECT_EQ(boundaries[1], frameCount);
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+  TEST(WorkPartitionerTests, BoundariesRespectGranularity) {
+    WorkPartitioner::SetParallelism(7);
+
+    std::size_t frameCount = WorkPartitioner::MinimumFramesPerRange * 7 + 123;
+    std::vector<std::size_t> boundaries = WorkPartitioner::SplitFrameRange(frameCount, 480);
+
+    WorkPartitioner::SetParallelism(0);
+
+    ASSERT_GE(boundaries.size(), 2U);
+    for(std::size_t index = 1; index < boundaries.size() - 1; ++index) {
+      EXPECT_EQ(boundaries[index] % 480, 0U);
+      EXPECT_LT(boundaries[index - 1], boundaries[index]);
+    }
+    EXPECT_EQ(boundaries.back(), frameCount);
+  }
+
+  // ------------------------------------------------------------------------------------------- //
+
+} // namespace Nuclex::OpusTranscoder::Audio